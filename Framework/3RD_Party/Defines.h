@@ -2,7 +2,10 @@
  * Macro defines.
  */
 
-#ifdef DX12_FW_EXPORTS
+#if defined(DX12_FW_STATIC)
+// The sources are compiled into the executable (Tests).
+#define DX12_FW_API
+#elif defined(DX12_FW_EXPORTS)
 #define DX12_FW_API __declspec(dllexport)
 #else
 #define DX12_FW_API __declspec(dllimport)
@@ -0,0 +1,88 @@
+#include "AliasingPlanner.h"
+
+#include <algorithm>
+#include <numeric>
+
+AliasingPlanner::Plan AliasingPlanner::Build(const std::vector<Request>& requests)
+{
+    Plan plan;
+    plan.Placements.resize(requests.size(), { 0, false });
+
+    // Largest first: the big resources get the low offsets, the small ones fill the gaps.
+    std::vector<uint32_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [&requests](uint32_t a, uint32_t b)
+    {
+        if (requests[a].Size != requests[b].Size)
+            return requests[a].Size > requests[b].Size;
+        if (requests[a].FirstPass != requests[b].FirstPass)
+            return requests[a].FirstPass < requests[b].FirstPass;
+        return a < b;
+    });
+
+    std::vector<uint32_t> placed;
+    std::vector<uint32_t> conflicts;
+    placed.reserve(requests.size());
+
+    for (uint32_t index : order)
+    {
+        const Request& request = requests[index];
+        uint64_t alignment = (std::max<uint64_t>)(1, request.Alignment);
+
+        plan.HeapAlignment = (std::max)(plan.HeapAlignment, alignment);
+        plan.UnaliasedSize += AlignUp(request.Size, alignment);
+
+        // The placed resources alive at the same time, by offset.
+        conflicts.clear();
+        for (uint32_t other : placed)
+        {
+            if (LifetimesOverlap(request, requests[other]))
+                conflicts.push_back(other);
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [&plan](uint32_t a, uint32_t b)
+        {
+            if (plan.Placements[a].Offset != plan.Placements[b].Offset)
+                return plan.Placements[a].Offset < plan.Placements[b].Offset;
+            return a < b;
+        });
+
+        // First fit: the lowest gap between the conflicting resources that is big enough.
+        uint64_t offset = 0;
+        for (uint32_t other : conflicts)
+        {
+            uint64_t otherBegin = plan.Placements[other].Offset;
+            uint64_t otherEnd = otherBegin + requests[other].Size;
+
+            if (AlignUp(offset, alignment) + request.Size <= otherBegin)
+                break;
+
+            offset = (std::max)(offset, otherEnd);
+        }
+        offset = AlignUp(offset, alignment);
+
+        plan.Placements[index].Offset = offset;
+        plan.HeapSize = (std::max)(plan.HeapSize, offset + request.Size);
+
+        placed.push_back(index);
+    }
+
+    plan.HeapSize = AlignUp(plan.HeapSize, plan.HeapAlignment);
+
+    // Resources sharing memory (their lifetimes can't overlap, by construction).
+    for (size_t a = 0; a < requests.size(); ++a)
+    {
+        for (size_t b = a + 1; b < requests.size(); ++b)
+        {
+            uint64_t aBegin = plan.Placements[a].Offset;
+            uint64_t bBegin = plan.Placements[b].Offset;
+
+            if (aBegin < bBegin + requests[b].Size && bBegin < aBegin + requests[a].Size)
+            {
+                plan.Placements[a].Aliased = true;
+                plan.Placements[b].Aliased = true;
+            }
+        }
+    }
+
+    return plan;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Packs resources with known lifetimes into a single heap: resources that are never alive
+// at the same time share the same memory.
+// --
+// Interval-graph packing: the resources are placed from the largest to the smallest (ties: earlier first pass,
+// then the request order), each one at the lowest aligned offset that doesn't overlap (in memory) an already
+// placed resource whose lifetime overlaps its own.
+// The plan depends only on the requests, so it's deterministic. No device is used, the planner can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API AliasingPlanner
+{
+public:
+    struct Request
+    {
+        uint64_t Size;
+        uint64_t Alignment;
+        // Lifetime - [FirstPass, LastPass] in the execution order (inclusive).
+        uint32_t FirstPass;
+        uint32_t LastPass;
+    };
+
+    struct Placement
+    {
+        uint64_t Offset;
+        // The memory is shared with another resource: an aliasing barrier is needed before the first use.
+        bool     Aliased;
+    };
+
+    struct Plan
+    {
+        std::vector<Placement>  Placements;         // In the order of the requests.
+        uint64_t                HeapSize = 0;
+        uint64_t                HeapAlignment = 1;
+        // Sum of the aligned sizes - the memory used without aliasing (one allocation per resource).
+        uint64_t                UnaliasedSize = 0;
+
+        uint64_t GetSavedBytes() const { return UnaliasedSize > HeapSize ? UnaliasedSize - HeapSize : 0; }
+    };
+
+    static Plan Build(const std::vector<Request>& requests);
+
+    static bool LifetimesOverlap(const Request& a, const Request& b)
+    {
+        return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+    }
+
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+};
@@ -180,6 +180,8 @@ void Application::Flush()
 	m_DirectCommandQueue->Flush();
 	m_ComputeCommandQueue->Flush();
 	m_CopyCommandQueue->Flush();
+
+	m_CompletedFrame = m_FrameCount;
 }
 
 
@@ -11,6 +11,7 @@
 #include <Framework/3RD_Party/D3D/d3dx12.h>
 #include <Framework/3RD_Party/Timer/HighResolutionClock.h>
 #include <Framework/Events/PixProfiler.h>
+#include <Framework/ThreadPool.h>
 
 // ComPtr
 #include <wrl.h>
@@ -61,8 +62,14 @@ public: // DX12 HELPERs
 	UINT						  GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const;
 	// --
 	PixProfiler&				  GetPixProfiler() { return m_PixProfiler; }
+	// Worker threads shared by the framework CPU jobs (parallel recording, asset processing).
+	ThreadPool&					  GetThreadPool() { return m_ThreadPool; }
 	// --
 	uint64_t&					  GetFrameCount() { return m_FrameCount; }
+	// The last frame the GPU finished (waited for by Window::Present, all of them by Flush): the resources freed
+	// during it and before aren't read anymore.
+	uint64_t					  GetCompletedFrame() const { return m_CompletedFrame; }
+	void						  SetCompletedFrame(uint64_t frame) { m_CompletedFrame = frame; }
 	
 	// SUPPORT checks
 	DXGI_SAMPLE_DESC GetMultisampleQualityLevels(DXGI_FORMAT format, UINT numSamples, D3D12_MULTISAMPLE_QUALITY_LEVEL_FLAGS flags = D3D12_MULTISAMPLE_QUALITY_LEVELS_FLAG_NONE) const;
@@ -118,7 +125,9 @@ private:
 	std::shared_ptr<CommandQueue>		 m_CopyCommandQueue		= nullptr;
 					
 	PixProfiler							 m_PixProfiler;
+	ThreadPool							 m_ThreadPool;
 
 	// Frametimes						 
 	uint64_t							 m_FrameCount			= 0;
+	uint64_t							 m_CompletedFrame		= 0;
 };
\ No newline at end of file
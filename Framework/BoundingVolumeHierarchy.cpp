@@ -0,0 +1,510 @@
+#include "BoundingVolumeHierarchy.h"
+
+#include <Framework/CullingMath.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+using namespace DirectX;
+
+namespace
+{
+    const uint32_t AllPlanes = 0x3F;
+
+    float GetComponent( const XMFLOAT3& v, uint32_t axis )
+    {
+        return ( axis == 0 ) ? v.x : ( ( axis == 1 ) ? v.y : v.z );
+    }
+
+    // Empty box: any grow sets it.
+    struct Bounds
+    {
+        XMFLOAT3 Min = XMFLOAT3( FLT_MAX, FLT_MAX, FLT_MAX );
+        XMFLOAT3 Max = XMFLOAT3( -FLT_MAX, -FLT_MAX, -FLT_MAX );
+
+        void Grow( const XMFLOAT3& point )
+        {
+            Min = XMFLOAT3( std::min( Min.x, point.x ), std::min( Min.y, point.y ), std::min( Min.z, point.z ) );
+            Max = XMFLOAT3( std::max( Max.x, point.x ), std::max( Max.y, point.y ), std::max( Max.z, point.z ) );
+        }
+
+        void Grow( const Bounds& other )
+        {
+            Min = XMFLOAT3( std::min( Min.x, other.Min.x ), std::min( Min.y, other.Min.y ), std::min( Min.z, other.Min.z ) );
+            Max = XMFLOAT3( std::max( Max.x, other.Max.x ), std::max( Max.y, other.Max.y ), std::max( Max.z, other.Max.z ) );
+        }
+
+        // Half the surface area (the SAH only uses ratios).
+        float GetHalfArea() const
+        {
+            if ( Min.x > Max.x )
+                return 0.0f;
+
+            float dx = Max.x - Min.x;
+            float dy = Max.y - Min.y;
+            float dz = Max.z - Min.z;
+            return dx * dy + dy * dz + dz * dx;
+        }
+    };
+
+    Bounds ToBounds( const BoundingBox& box )
+    {
+        Bounds bounds;
+        bounds.Min = XMFLOAT3( box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z );
+        bounds.Max = XMFLOAT3( box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z );
+        return bounds;
+    }
+
+    // CullingMath::IsInFrustum for one plane.
+    // @return -1 outside, 1 fully inside, 0 intersecting.
+    int ClassifyBox( const XMFLOAT4& plane, const XMFLOAT3& center, const XMFLOAT3& extents )
+    {
+        float distance = ( ( plane.x * center.x + plane.y * center.y ) + plane.z * center.z ) + plane.w;
+        float radius = ( std::abs( plane.x ) * extents.x + std::abs( plane.y ) * extents.y ) + std::abs( plane.z ) * extents.z;
+
+        if ( distance + radius < 0.0f )
+            return -1;
+
+        return ( distance - radius >= 0.0f ) ? 1 : 0;
+    }
+
+    // Slab test.
+    // @return the distance where the ray enters the box, or FLT_MAX if it misses it (or beyond maxDistance).
+    float IntersectRay( const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance, const XMFLOAT3& min, const XMFLOAT3& max )
+    {
+        float tx1 = ( min.x - origin.x ) * inverseDirection.x;
+        float tx2 = ( max.x - origin.x ) * inverseDirection.x;
+        float tNear = std::min( tx1, tx2 );
+        float tFar = std::max( tx1, tx2 );
+
+        float ty1 = ( min.y - origin.y ) * inverseDirection.y;
+        float ty2 = ( max.y - origin.y ) * inverseDirection.y;
+        tNear = std::max( tNear, std::min( ty1, ty2 ) );
+        tFar = std::min( tFar, std::max( ty1, ty2 ) );
+
+        float tz1 = ( min.z - origin.z ) * inverseDirection.z;
+        float tz2 = ( max.z - origin.z ) * inverseDirection.z;
+        tNear = std::max( tNear, std::min( tz1, tz2 ) );
+        tFar = std::min( tFar, std::max( tz1, tz2 ) );
+
+        tNear = std::max( tNear, 0.0f );
+        tFar = std::min( tFar, maxDistance );
+
+        return ( tNear <= tFar ) ? tNear : FLT_MAX;
+    }
+}
+
+void BoundingVolumeHierarchy::Build( const std::vector<BoundingBox>& bounds )
+{
+    Build( bounds, BuildSettings() );
+}
+
+void BoundingVolumeHierarchy::Build( const std::vector<BoundingBox>& bounds, const BuildSettings& settings )
+{
+    Clear();
+
+    uint32_t numPrimitives = static_cast<uint32_t>( bounds.size() );
+    if ( numPrimitives == 0 )
+        return;
+
+    m_Bounds = bounds;
+    m_PrimitiveIndices.resize( numPrimitives );
+    std::iota( m_PrimitiveIndices.begin(), m_PrimitiveIndices.end(), 0 );
+    m_PrimitiveLeaves.resize( numPrimitives, InvalidIndex );
+
+    // At most one leaf per primitive.
+    m_Nodes.reserve( 2 * numPrimitives - 1 );
+    m_Parents.reserve( 2 * numPrimitives - 1 );
+
+    std::vector<Bounds> primitiveBounds( numPrimitives );
+    for ( uint32_t i = 0; i < numPrimitives; ++i )
+    {
+        primitiveBounds[i] = ToBounds( bounds[i] );
+    }
+
+    const uint32_t numBins = std::max<uint32_t>( 2, settings.NumBins );
+    const uint32_t maxLeafSize = std::max<uint32_t>( 1, settings.MaxLeafSize );
+
+    struct Bin
+    {
+        Bounds      BinBounds;
+        uint32_t    Count = 0;
+    };
+    std::vector<Bin> bins( numBins );
+    std::vector<float> rightAreas( numBins );
+    std::vector<uint32_t> rightCounts( numBins );
+
+    // The ranges of m_PrimitiveIndices still to split (no recursion, a degenerate split is as deep as the number of boxes).
+    struct Task
+    {
+        uint32_t    NodeIndex;
+        uint32_t    First;
+        uint32_t    Count;
+        uint32_t    Depth;
+    };
+    std::vector<Task> tasks;
+
+    m_Nodes.push_back( Node() );
+    m_Parents.push_back( InvalidIndex );
+    tasks.push_back( { 0, 0, numPrimitives, 1 } );
+
+    while ( !tasks.empty() )
+    {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        m_Depth = std::max( m_Depth, task.Depth );
+
+        uint32_t* indices = &m_PrimitiveIndices[task.First];
+
+        Bounds nodeBounds;
+        Bounds centroidBounds;
+        for ( uint32_t i = 0; i < task.Count; ++i )
+        {
+            const Bounds& box = primitiveBounds[indices[i]];
+            nodeBounds.Grow( box );
+            centroidBounds.Grow( m_Bounds[indices[i]].Center );
+        }
+
+        Node& node = m_Nodes[task.NodeIndex];
+        node.Min = nodeBounds.Min;
+        node.Max = nodeBounds.Max;
+
+        // Best binned split over the 3 axes.
+        uint32_t bestAxis = InvalidIndex;
+        uint32_t bestSplit = 0;     // Bins [0, bestSplit] go left.
+        float bestCost = FLT_MAX;
+
+        for ( uint32_t axis = 0; axis < 3 && task.Count > 1; ++axis )
+        {
+            float centroidMin = GetComponent( centroidBounds.Min, axis );
+            float centroidMax = GetComponent( centroidBounds.Max, axis );
+            if ( !( centroidMax > centroidMin ) )
+                continue;
+
+            float binScale = numBins / ( centroidMax - centroidMin );
+
+            std::fill( bins.begin(), bins.end(), Bin() );
+            for ( uint32_t i = 0; i < task.Count; ++i )
+            {
+                float centroid = GetComponent( m_Bounds[indices[i]].Center, axis );
+                uint32_t bin = std::min( numBins - 1, static_cast<uint32_t>( ( centroid - centroidMin ) * binScale ) );
+
+                bins[bin].BinBounds.Grow( primitiveBounds[indices[i]] );
+                bins[bin].Count++;
+            }
+
+            Bounds rightBounds;
+            uint32_t rightCount = 0;
+            for ( uint32_t bin = numBins - 1; bin > 0; --bin )
+            {
+                rightBounds.Grow( bins[bin].BinBounds );
+                rightCount += bins[bin].Count;
+                rightAreas[bin] = rightBounds.GetHalfArea();
+                rightCounts[bin] = rightCount;
+            }
+
+            Bounds leftBounds;
+            uint32_t leftCount = 0;
+            for ( uint32_t split = 0; split < numBins - 1; ++split )
+            {
+                leftBounds.Grow( bins[split].BinBounds );
+                leftCount += bins[split].Count;
+
+                if ( leftCount == 0 || rightCounts[split + 1] == 0 )
+                    continue;
+
+                float cost = leftBounds.GetHalfArea() * leftCount + rightAreas[split + 1] * rightCounts[split + 1];
+                if ( cost < bestCost )
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        float nodeArea = nodeBounds.GetHalfArea();
+        float leafCost = settings.IntersectionCost * task.Count;
+        float splitCost = ( bestAxis != InvalidIndex && nodeArea > 0.0f )
+            ? settings.TraversalCost + settings.IntersectionCost * bestCost / nodeArea
+            : FLT_MAX;
+
+        bool makeLeaf = task.Count == 1 || ( task.Count <= maxLeafSize && leafCost <= splitCost );
+        if ( makeLeaf )
+        {
+            node.Offset = task.First;
+            node.NumPrimitives = task.Count;
+
+            for ( uint32_t i = 0; i < task.Count; ++i )
+            {
+                m_PrimitiveLeaves[indices[i]] = task.NodeIndex;
+            }
+            continue;
+        }
+
+        uint32_t leftCount = 0;
+        if ( bestAxis != InvalidIndex )
+        {
+            float centroidMin = GetComponent( centroidBounds.Min, bestAxis );
+            float binScale = numBins / ( GetComponent( centroidBounds.Max, bestAxis ) - centroidMin );
+
+            uint32_t* middle = std::partition( indices, indices + task.Count, [&]( uint32_t primitive )
+            {
+                float centroid = GetComponent( m_Bounds[primitive].Center, bestAxis );
+                return std::min( numBins - 1, static_cast<uint32_t>( ( centroid - centroidMin ) * binScale ) ) <= bestSplit;
+            } );
+            leftCount = static_cast<uint32_t>( middle - indices );
+        }
+
+        // All the centroids are at the same place (or no split has both sides): any half will do.
+        if ( leftCount == 0 || leftCount == task.Count )
+        {
+            leftCount = task.Count / 2;
+        }
+
+        uint32_t leftChild = static_cast<uint32_t>( m_Nodes.size() );
+        node.Offset = leftChild;
+        node.NumPrimitives = 0;
+
+        // `node` is not used past this point (no reallocation anyway, the nodes are reserved).
+        m_Nodes.push_back( Node() );
+        m_Nodes.push_back( Node() );
+        m_Parents.push_back( task.NodeIndex );
+        m_Parents.push_back( task.NodeIndex );
+
+        tasks.push_back( { leftChild + 1, task.First + leftCount, task.Count - leftCount, task.Depth + 1 } );
+        tasks.push_back( { leftChild, task.First, leftCount, task.Depth + 1 } );
+    }
+
+    // Copy of the boxes in leaf order, the queries read them sequentially.
+    m_LeafBounds.resize( numPrimitives );
+    m_PrimitivePositions.resize( numPrimitives );
+    for ( uint32_t i = 0; i < numPrimitives; ++i )
+    {
+        m_LeafBounds[i] = m_Bounds[m_PrimitiveIndices[i]];
+        m_PrimitivePositions[m_PrimitiveIndices[i]] = i;
+    }
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+    m_Nodes.clear();
+    m_PrimitiveIndices.clear();
+    m_Bounds.clear();
+    m_LeafBounds.clear();
+    m_PrimitivePositions.clear();
+    m_PrimitiveLeaves.clear();
+    m_Parents.clear();
+    m_Depth = 0;
+}
+
+void BoundingVolumeHierarchy::ComputeNodeBounds( Node& node ) const
+{
+    Bounds nodeBounds;
+
+    if ( node.IsLeaf() )
+    {
+        for ( uint32_t i = 0; i < node.NumPrimitives; ++i )
+        {
+            nodeBounds.Grow( ToBounds( m_LeafBounds[node.Offset + i] ) );
+        }
+    }
+    else
+    {
+        for ( uint32_t child = node.Offset; child < node.Offset + 2; ++child )
+        {
+            nodeBounds.Grow( m_Nodes[child].Min );
+            nodeBounds.Grow( m_Nodes[child].Max );
+        }
+    }
+
+    node.Min = nodeBounds.Min;
+    node.Max = nodeBounds.Max;
+}
+
+void BoundingVolumeHierarchy::UpdateBounds( uint32_t primitive, const BoundingBox& bounds )
+{
+    m_Bounds[primitive] = bounds;
+    m_LeafBounds[m_PrimitivePositions[primitive]] = bounds;
+
+    for ( uint32_t nodeIndex = m_PrimitiveLeaves[primitive]; nodeIndex != InvalidIndex; nodeIndex = m_Parents[nodeIndex] )
+    {
+        Node& node = m_Nodes[nodeIndex];
+
+        XMFLOAT3 previousMin = node.Min;
+        XMFLOAT3 previousMax = node.Max;
+        ComputeNodeBounds( node );
+
+        // The nodes above only depend on the bounds of this one.
+        if ( previousMin.x == node.Min.x && previousMin.y == node.Min.y && previousMin.z == node.Min.z &&
+             previousMax.x == node.Max.x && previousMax.y == node.Max.y && previousMax.z == node.Max.z )
+        {
+            break;
+        }
+    }
+}
+
+void BoundingVolumeHierarchy::Refit()
+{
+    // The children come after their parent.
+    for ( size_t i = m_Nodes.size(); i > 0; --i )
+    {
+        ComputeNodeBounds( m_Nodes[i - 1] );
+    }
+}
+
+uint32_t BoundingVolumeHierarchy::CullFrustum( const XMFLOAT4X4& viewProjection, std::vector<uint32_t>& visible ) const
+{
+    visible.clear();
+    if ( m_Nodes.empty() )
+        return 0;
+
+    CullingMath::View view = CullingMath::MakeView( viewProjection );
+
+    struct Entry
+    {
+        uint32_t    NodeIndex;
+        uint32_t    PlaneMask;  // The planes the node is not fully inside of.
+    };
+    std::vector<Entry> stack;
+    stack.reserve( 2 * m_Depth );
+    stack.push_back( { 0, AllPlanes } );
+
+    uint32_t numVisited = 0;
+
+    while ( !stack.empty() )
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+
+        const Node& node = m_Nodes[entry.NodeIndex];
+        ++numVisited;
+
+        XMFLOAT3 center( ( node.Min.x + node.Max.x ) * 0.5f, ( node.Min.y + node.Max.y ) * 0.5f, ( node.Min.z + node.Max.z ) * 0.5f );
+        XMFLOAT3 extents( ( node.Max.x - node.Min.x ) * 0.5f, ( node.Max.y - node.Min.y ) * 0.5f, ( node.Max.z - node.Min.z ) * 0.5f );
+
+        uint32_t planeMask = entry.PlaneMask;
+        bool outside = false;
+        for ( uint32_t p = 0; p < 6 && planeMask != 0; ++p )
+        {
+            if ( ( planeMask & ( 1 << p ) ) == 0 )
+                continue;
+
+            int side = ClassifyBox( view.FrustumPlanes[p], center, extents );
+            if ( side < 0 )
+            {
+                outside = true;
+                break;
+            }
+            if ( side > 0 )
+            {
+                planeMask &= ~( 1 << p );
+            }
+        }
+
+        if ( outside )
+            continue;
+
+        if ( !node.IsLeaf() )
+        {
+            stack.push_back( { node.Offset + 1, planeMask } );
+            stack.push_back( { node.Offset, planeMask } );
+            continue;
+        }
+
+        for ( uint32_t i = 0; i < node.NumPrimitives; ++i )
+        {
+            const BoundingBox& box = m_LeafBounds[node.Offset + i];
+
+            bool inside = true;
+            for ( uint32_t p = 0; p < 6 && inside; ++p )
+            {
+                if ( planeMask & ( 1 << p ) )
+                {
+                    inside = ClassifyBox( view.FrustumPlanes[p], box.Center, box.Extents ) >= 0;
+                }
+            }
+
+            if ( inside )
+            {
+                visible.push_back( m_PrimitiveIndices[node.Offset + i] );
+            }
+        }
+    }
+
+    return numVisited;
+}
+
+bool BoundingVolumeHierarchy::Raycast( const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, uint32_t& primitive, float& distance ) const
+{
+    primitive = InvalidIndex;
+    distance = maxDistance;
+
+    if ( m_Nodes.empty() )
+        return false;
+
+    // 1 / 0 = inf keeps the slab test working for the axis aligned rays.
+    XMFLOAT3 inverseDirection( 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z );
+
+    if ( IntersectRay( origin, inverseDirection, distance, m_Nodes[0].Min, m_Nodes[0].Max ) == FLT_MAX )
+        return false;
+
+    struct Entry
+    {
+        uint32_t    NodeIndex;
+        float       EntryDistance;
+    };
+    std::vector<Entry> stack;
+    stack.reserve( 2 * m_Depth );
+    stack.push_back( { 0, 0.0f } );
+
+    while ( !stack.empty() )
+    {
+        Entry entry = stack.back();
+        stack.pop_back();
+
+        // A closer hit was found since the node was pushed.
+        if ( entry.EntryDistance > distance )
+            continue;
+
+        const Node& node = m_Nodes[entry.NodeIndex];
+
+        if ( node.IsLeaf() )
+        {
+            for ( uint32_t i = 0; i < node.NumPrimitives; ++i )
+            {
+                Bounds box = ToBounds( m_LeafBounds[node.Offset + i] );
+
+                float hitDistance = IntersectRay( origin, inverseDirection, distance, box.Min, box.Max );
+                if ( hitDistance < distance || ( hitDistance == distance && primitive == InvalidIndex ) )
+                {
+                    distance = hitDistance;
+                    primitive = m_PrimitiveIndices[node.Offset + i];
+                }
+            }
+            continue;
+        }
+
+        const Node& left = m_Nodes[node.Offset];
+        const Node& right = m_Nodes[node.Offset + 1];
+        float leftDistance = IntersectRay( origin, inverseDirection, distance, left.Min, left.Max );
+        float rightDistance = IntersectRay( origin, inverseDirection, distance, right.Min, right.Max );
+
+        // The nearest child is popped first.
+        if ( leftDistance <= rightDistance )
+        {
+            if ( rightDistance != FLT_MAX ) stack.push_back( { node.Offset + 1, rightDistance } );
+            if ( leftDistance != FLT_MAX ) stack.push_back( { node.Offset, leftDistance } );
+        }
+        else
+        {
+            if ( leftDistance != FLT_MAX ) stack.push_back( { node.Offset, leftDistance } );
+            stack.push_back( { node.Offset + 1, rightDistance } );
+        }
+    }
+
+    return primitive != InvalidIndex;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+// Bounding volume hierarchy over world-space AABBs (eg. the mesh parts of a model).
+// --
+// Built top-down with a binned surface area heuristic, flattened into one array of 32-byte nodes (two per cache line).
+// The two children of an interior node are next to each other, and always come after their parent.
+// Queries:
+//   - CullFrustum - hierarchical frustum culling with plane masking: the planes a node is fully inside of are not
+//                   tested again below it, so the cost follows the visible set rather than the number of boxes.
+//   - Raycast     - closest box hit by a ray (picking), children visited front to back.
+// When boxes move, UpdateBounds refits the path to the root (or Refit the whole tree after many changes). The topology
+// is kept, rebuild after large changes to get the SAH quality back.
+// The frustum test is the one of CullingMath::IsInFrustum. No device is used, the hierarchy can be built headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API BoundingVolumeHierarchy
+{
+public:
+    static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    struct Node
+    {
+        DirectX::XMFLOAT3   Min;
+        uint32_t            Offset;         // Leaf: first entry in GetPrimitiveIndices(). Interior: the left child (right = left + 1).
+        DirectX::XMFLOAT3   Max;
+        uint32_t            NumPrimitives;  // 0 for an interior node.
+
+        bool IsLeaf() const { return NumPrimitives > 0; }
+    };
+
+    struct BuildSettings
+    {
+        uint32_t    MaxLeafSize = 4;        // Larger leaves are always split.
+        uint32_t    NumBins = 16;           // SAH candidates per axis.
+        float       TraversalCost = 1.0f;   // SAH cost of visiting a node.
+        float       IntersectionCost = 1.0f;// SAH cost of testing a box.
+    };
+
+    // The box of index i is the primitive i of the queries.
+    void Build( const std::vector<DirectX::BoundingBox>& bounds );
+    void Build( const std::vector<DirectX::BoundingBox>& bounds, const BuildSettings& settings );
+    void Clear();
+
+    // Move a box and refit the nodes above it (stops at the first node that doesn't change).
+    void UpdateBounds( uint32_t primitive, const DirectX::BoundingBox& bounds );
+    // Recompute the bounds of every node (bottom-up), after moving many boxes.
+    void Refit();
+
+    // Write the primitives that intersect the frustum of the view-projection matrix (row vectors), in no particular order.
+    // @return the number of nodes visited.
+    uint32_t CullFrustum( const DirectX::XMFLOAT4X4& viewProjection, std::vector<uint32_t>& visible ) const;
+
+    // Closest primitive box hit by the ray within maxDistance (direction doesn't need to be normalized, the distance
+    // is in units of its length).
+    // @return false if nothing was hit.
+    bool Raycast( const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance,
+                  uint32_t& primitive, float& distance ) const;
+
+    uint32_t GetNumPrimitives() const { return static_cast<uint32_t>( m_Bounds.size() ); }
+    uint32_t GetNumNodes() const { return static_cast<uint32_t>( m_Nodes.size() ); }
+    uint32_t GetDepth() const { return m_Depth; }
+
+    const std::vector<Node>& GetNodes() const { return m_Nodes; }
+    const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+    const DirectX::BoundingBox& GetBounds( uint32_t primitive ) const { return m_Bounds[primitive]; }
+
+private:
+    void ComputeNodeBounds( Node& node ) const;
+
+    std::vector<Node>                   m_Nodes;
+    std::vector<uint32_t>               m_PrimitiveIndices;     // Leaf ranges.
+    std::vector<DirectX::BoundingBox>   m_Bounds;               // Per primitive.
+    std::vector<DirectX::BoundingBox>   m_LeafBounds;           // Per entry of m_PrimitiveIndices.
+    std::vector<uint32_t>               m_PrimitivePositions;   // Per primitive: its entry in m_PrimitiveIndices.
+    std::vector<uint32_t>               m_PrimitiveLeaves;      // Per primitive: its leaf.
+    std::vector<uint32_t>               m_Parents;              // Per node, InvalidIndex for the root.
+    uint32_t                            m_Depth = 0;
+};
@@ -18,6 +18,8 @@
 #include <Framework/Material/IndexBuffer.h>
 // --
 #include <Framework/Material/Texture.h>
+#include <Framework/Material/DDSFile.h>
+#include <Framework/Material/TextureDecoder.h>
 // --
 #include <Framework/Material/RenderTarget.h>
 
@@ -41,9 +43,13 @@
 #include <DirectXMath.h>
 #include <External/DirectXTex/DirectXTex/DirectXTex.h>
 #include <filesystem>
+#include <thread>
 
-std::map<std::wstring, ID3D12Resource* > CommandList::ms_TextureCache;
-std::mutex CommandList::ms_TextureCacheMutex;
+TextureCache CommandList::ms_TextureCache;
+TextureProcessor CommandList::ms_TextureProcessor;
+TextureStreamer CommandList::ms_TextureStreamer;
+std::unordered_map<TextureCache::Key, std::shared_future<std::shared_ptr<const CommandList::DecodedTexture>>, TextureCache::KeyHash> CommandList::ms_TextureDecodes;
+std::mutex CommandList::ms_TextureDecodesMutex;
 
 CommandList::CommandList(D3D12_COMMAND_LIST_TYPE type)
     : m_Application(Application::Get())
@@ -62,8 +68,9 @@ CommandList::CommandList(D3D12_COMMAND_LIST_TYPE type)
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
     {
         m_DynamicDescriptorHeap[i] = std::make_unique<DynamicDescriptorHeap>(static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>( i ) );
-        m_DescriptorHeaps[i] = nullptr;
     }
+
+    InvalidateState();
 }
 
 CommandList::~CommandList()
@@ -224,6 +231,38 @@ void CommandList::CopyBuffer( Buffer& buffer, size_t numElements, size_t element
     buffer.CreateViews( numElements, elementSize );
 }
 
+void CommandList::UpdateBufferRegion( Buffer& buffer, size_t offsetInBytes, size_t sizeInBytes, const void* bufferData )
+{
+    if ( sizeInBytes == 0 )
+        return;
+
+    auto device = m_Application.GetDevice();
+
+    // Intermediate upload buffer, kept alive until the command list is reset (same as CopyBuffer).
+    ComPtr<ID3D12Resource> uploadResource;
+    ThrowIfFailed( device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(sizeInBytes),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&uploadResource)));
+
+    void* mappedData = nullptr;
+    CD3DX12_RANGE readRange( 0, 0 );
+    ThrowIfFailed( uploadResource->Map( 0, &readRange, &mappedData ) );
+    memcpy( mappedData, bufferData, sizeInBytes );
+    uploadResource->Unmap( 0, nullptr );
+
+    TransitionBarrier( buffer, D3D12_RESOURCE_STATE_COPY_DEST );
+    FlushResourceBarriers();
+
+    m_d3d12CommandList->CopyBufferRegion( buffer.GetD3D12Resource().Get(), offsetInBytes, uploadResource.Get(), 0, sizeInBytes );
+
+    TrackResource( uploadResource );
+    TrackResource( buffer );
+}
+
 void CommandList::CopyVertexBuffer( VertexBuffer& vertexBuffer, size_t numVertices, size_t vertexStride, const void* vertexBufferData )
 {
     CopyBuffer( vertexBuffer, numVertices, vertexStride, vertexBufferData );
@@ -247,10 +286,66 @@ void CommandList::CopyStructuredBuffer( StructuredBuffer& structuredBuffer, size
 
 void CommandList::SetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY primitiveTopology )
 {
-    m_d3d12CommandList->IASetPrimitiveTopology( primitiveTopology );
+    if ( FilterStateCall( m_PrimitiveTopology != primitiveTopology ) )
+    {
+        m_PrimitiveTopology = primitiveTopology;
+        m_d3d12CommandList->IASetPrimitiveTopology( primitiveTopology );
+    }
+}
+
+struct CommandList::DecodedTexture
+{
+    // A DDS file read in place (File is open), else the decoded image.
+    DDSFile                 File;
+    DirectX::TexMetadata    Metadata;
+    DirectX::ScratchImage   Image;
+};
+
+std::shared_ptr<const CommandList::DecodedTexture> CommandList::DecodeTextureFile( const std::wstring& fileName )
+{
+    auto decoded = std::make_shared<DecodedTexture>();
+    TextureDecoder::Decode( fileName, decoded->File, decoded->Metadata, decoded->Image );
+    return decoded;
+}
+
+std::shared_ptr<const CommandList::DecodedTexture> CommandList::ProcessTextureFile( const std::wstring& fileName, TextureUsage textureUsage, bool sRGB )
+{
+    std::wstring cachePath = ms_TextureProcessor.GetCachePath( fileName, textureUsage, sRGB );
+    if ( cachePath.empty() )
+    {
+        return DecodeTextureFile( fileName );
+    }
+
+    auto texture = std::make_shared<DecodedTexture>();
+    if ( !ms_TextureProcessor.LoadCached( cachePath, texture->File ) )
+    {
+        TextureDecoder::Decode( fileName, texture->File, texture->Metadata, texture->Image );
+        ms_TextureProcessor.ProcessAndCache( cachePath, textureUsage, sRGB, texture->Metadata, texture->Image, Application::Get().GetThreadPool() );
+    }
+    return texture;
+}
+
+void CommandList::PrefetchTextureFile( const std::wstring& fileName, TextureUsage textureUsage, bool sRGB )
+{
+    TextureCache::Key key = TextureCache::MakeKey( fileName, textureUsage, sRGB );
+    if ( ms_TextureCache.Contains( key ) )
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock( ms_TextureDecodesMutex );
+    if ( ms_TextureDecodes.find( key ) != ms_TextureDecodes.end() )
+    {
+        return;
+    }
+
+    ms_TextureDecodes[key] = Application::Get().GetThreadPool().Submit( [fileName, textureUsage, sRGB]()
+    {
+        return ProcessTextureFile( fileName, textureUsage, sRGB );
+    } ).share();
 }
 
-void CommandList::LoadTextureFromFile( Texture& texture, const std::wstring& fileName, TextureUsage textureUsage )
+void CommandList::LoadTextureFromFile( Texture& texture, const std::wstring& fileName, TextureUsage textureUsage, bool sRGB )
 {
     std::filesystem::path filePath( fileName );
     if ( !std::filesystem::exists( filePath ) )
@@ -258,52 +353,94 @@ void CommandList::LoadTextureFromFile( Texture& texture, const std::wstring& fil
         throw std::exception( "File not found." );
     }
 
-    std::lock_guard<std::mutex> lock(ms_TextureCacheMutex);
-    auto iter = ms_TextureCache.find( fileName );
-    if ( iter != ms_TextureCache.end() )
+    bool isNew = false;
+    TextureCache::Key key = TextureCache::MakeKey( fileName, textureUsage, sRGB );
+    TextureCache::Handle handle = ms_TextureCache.Acquire( key, isNew );
+    if ( !isNew )
     {
-        texture.SetTextureUsage(textureUsage);
-        texture.SetD3D12Resource(iter->second);
+        // Resident, or being loaded by another thread: waits for it (and rethrows its failure). The streaming entry of
+        // the resource is added before its load completes.
+        texture.SetTextureUsage( textureUsage );
+        texture.SetD3D12Resource( TextureCache::GetResource( handle ) );
         texture.CreateViews();
-        texture.SetName(fileName);
+        texture.SetName( fileName );
+        texture.SetCacheHandle( handle );
+        texture.SetStreamedTexture( ms_TextureStreamer.Find( key ) );
+        return;
     }
-    else
+
+    try
     {
-        DirectX::TexMetadata metadata;
-        DirectX::ScratchImage scratchImage;
+        Microsoft::WRL::ComPtr<ID3D12Resource> textureResource = UploadTextureFile( texture, fileName, textureUsage, sRGB );
+        texture.SetCacheHandle( handle );
 
-        if ( filePath.extension() == ".dds" )
-        {
-            ThrowIfFailed( LoadFromDDSFile( 
-                fileName.c_str(),
-                DirectX::DDS_FLAGS_NONE,
-                &metadata,
-                scratchImage));
-        }
-        else if ( filePath.extension() == ".hdr" )
+        D3D12_RESOURCE_DESC resourceDesc = textureResource->GetDesc();
+        D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = m_Application.GetDevice()->GetResourceAllocationInfo( 0, 1, &resourceDesc );
+        ms_TextureCache.Complete( handle, textureResource, allocationInfo.SizeInBytes );
+    }
+    catch ( ... )
+    {
+        ms_TextureCache.Fail( handle, std::current_exception() );
+        throw;
+    }
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> CommandList::UploadTextureFile( Texture& texture, const std::wstring& fileName, TextureUsage textureUsage, bool sRGB )
+{
+    TextureCache::Key key = TextureCache::MakeKey( fileName, textureUsage, sRGB );
+
+    std::shared_future<std::shared_ptr<const DecodedTexture>> pendingDecode;
+    {
+        std::lock_guard<std::mutex> lock( ms_TextureDecodesMutex );
+
+        // Taken by this load.
+        auto decodeIter = ms_TextureDecodes.find( key );
+        if ( decodeIter != ms_TextureDecodes.end() )
         {
-            ThrowIfFailed( LoadFromHDRFile( 
-                fileName.c_str(), 
-                &metadata, 
-                scratchImage ) );
+            pendingDecode = decodeIter->second;
+            ms_TextureDecodes.erase( decodeIter );
         }
-        else if ( filePath.extension() == ".tga" )
+    }
+
+    // Without the lock: the other threads keep loading meanwhile. The waiting thread runs the queued tasks, in case
+    // it's a worker of the pool itself.
+    std::shared_ptr<const DecodedTexture> decoded;
+    if ( pendingDecode.valid() )
+    {
+        while ( pendingDecode.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready )
         {
-            ThrowIfFailed( LoadFromTGAFile( 
-                fileName.c_str(), 
-                &metadata, 
-                scratchImage ) );
+            if ( !m_Application.GetThreadPool().TryRunPendingTask() )
+            {
+                std::this_thread::yield();
+            }
         }
-        else
+        decoded = pendingDecode.get();
+    }
+    else
+    {
+        decoded = ProcessTextureFile( fileName, textureUsage, sRGB );
+    }
+
+    D3D12_RESOURCE_DESC textureDesc = {};
+    std::vector<D3D12_SUBRESOURCE_DATA> subresources;
+    if ( decoded->File.IsOpen() )
+    {
+        // In place: the rows are copied from the mapped file to the upload resource.
+        textureDesc = decoded->File.GetResourceDesc();
+        subresources = decoded->File.GetSubresources();
+
+        // The full chain, as for the decoded images: the mips the file doesn't have are generated below. Not for the
+        // arrays: the subresources of the file are in the order of its own mip count.
+        if ( textureDesc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D || textureDesc.DepthOrArraySize == 1 )
         {
-            ThrowIfFailed( LoadFromWICFile( 
-                fileName.c_str(), 
-                DirectX::WIC_FLAGS_NONE,
-                &metadata, 
-                scratchImage ) );
+            textureDesc.MipLevels = 0;
         }
+    }
+    else
+    {
+        const DirectX::TexMetadata& metadata = decoded->Metadata;
+        const DirectX::ScratchImage& scratchImage = decoded->Image;
 
-        D3D12_RESOURCE_DESC textureDesc = {};
         switch ( metadata.dimension )
         {
             case DirectX::TEX_DIMENSION_TEXTURE1D:
@@ -331,27 +468,7 @@ void CommandList::LoadTextureFromFile( Texture& texture, const std::wstring& fil
                 break;
         }
 
-        auto device = m_Application.GetDevice();
-        Microsoft::WRL::ComPtr<ID3D12Resource> textureResource;
-
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_COMMON,
-            nullptr,
-            IID_PPV_ARGS(&textureResource)));
-
-        texture.SetTextureUsage(textureUsage);
-        texture.SetD3D12Resource(textureResource);
-        texture.CreateViews();
-        texture.SetName(fileName);
-
-        // Update the global state tracker.
-        ResourceStateTracker::AddGlobalResourceState( 
-            textureResource.Get(), D3D12_RESOURCE_STATE_COMMON );
-
-        std::vector<D3D12_SUBRESOURCE_DATA> subresources( scratchImage.GetImageCount() );
+        subresources.resize( scratchImage.GetImageCount() );
         const DirectX::Image* pImages = scratchImage.GetImages();
         for ( int i = 0; i < scratchImage.GetImageCount(); ++i )
         {
@@ -360,21 +477,92 @@ void CommandList::LoadTextureFromFile( Texture& texture, const std::wstring& fil
             subresource.SlicePitch = pImages[i].slicePitch;
             subresource.pData = pImages[i].pixels;
         }
+    }
 
-        CopyTextureSubresource( 
-            texture, 
-            0, 
-            static_cast<uint32_t>( subresources.size() ), 
-            subresources.data() );
+    if ( sRGB )
+    {
+        textureDesc.Format = DirectX::MakeSRGB( textureDesc.Format );
+    }
 
-        if ( subresources.size() < textureResource->GetDesc().MipLevels )
-        {
-            GenerateMips( texture );
-        }
+    auto device = m_Application.GetDevice();
+    Microsoft::WRL::ComPtr<ID3D12Resource> textureResource;
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+        D3D12_HEAP_FLAG_NONE,
+        &textureDesc,
+        D3D12_RESOURCE_STATE_COMMON,
+        nullptr,
+        IID_PPV_ARGS(&textureResource)));
+
+    texture.SetTextureUsage(textureUsage);
+    texture.SetD3D12Resource(textureResource);
+    texture.CreateViews();
+    texture.SetName(fileName);
+
+    // Update the global state tracker.
+    ResourceStateTracker::AddGlobalResourceState( 
+        textureResource.Get(), D3D12_RESOURCE_STATE_COMMON );
+
+    // Streamed: the mip tail now, the other mips by StreamTextureMips (from the decoded texture, kept by the entry).
+    uint32_t firstSubresource = 0;
+    if ( ms_TextureStreamer.IsEnabled() && TextureStreamer::IsStreamable( textureResource->GetDesc(), subresources.size() ) )
+    {
+        firstSubresource = TextureStreamer::GetTailMip( textureResource->GetDesc() );
+    }
+
+    CopyTextureSubresource( 
+        texture, 
+        firstSubresource, 
+        static_cast<uint32_t>( subresources.size() ) - firstSubresource, 
+        subresources.data() + firstSubresource );
+
+    if ( subresources.size() < textureResource->GetDesc().MipLevels )
+    {
+        GenerateMips( texture );
+    }
+
+    texture.SetStreamedTexture( firstSubresource > 0 ? 
+        ms_TextureStreamer.Add( key, textureResource, decoded, std::move( subresources ), firstSubresource ) : nullptr );
+
+    return textureResource;
+}
+
+TextureCache& CommandList::GetTextureCache()
+{
+    return ms_TextureCache;
+}
+
+TextureProcessor& CommandList::GetTextureProcessor()
+{
+    return ms_TextureProcessor;
+}
+
+TextureStreamer& CommandList::GetTextureStreamer()
+{
+    return ms_TextureStreamer;
+}
 
-        // Add the texture resource to the texture cache.
-        ms_TextureCache[fileName] = textureResource.Get();
+void CommandList::StreamTextureMips( uint64_t budgetInBytes )
+{
+    if ( m_d3d12CommandListType == D3D12_COMMAND_LIST_TYPE_COPY )
+    {
+        throw std::exception( "The streamed mips are uploaded on a direct or compute command list." );
     }
+
+    for ( const TextureStreamer::Upload& upload : ms_TextureStreamer.Schedule( budgetInBytes, ms_TextureCache ) )
+    {
+        StreamedTexture& streamedTexture = *upload.Texture;
+        CopyTextureSubresource( streamedTexture.Resource, upload.FirstMip, upload.NumMips, &streamedTexture.Subresources[upload.FirstMip] );
+
+        // Back to the state the draws expect: the ExecuteIndirect path binds its texture table without transitions.
+        TransitionBarrier( streamedTexture.Resource, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE );
+
+        // The views created from now on include the new mips: the copy comes before the draws of this command list.
+        streamedTexture.ResidentMip = upload.FirstMip;
+    }
+
+    FlushResourceBarriers();
 }
 
 void CommandList::GenerateMips( Texture& texture )
@@ -527,7 +715,7 @@ void CommandList::GenerateMips_UAV( Texture& texture, DXGI_FORMAT format )
             m_GenerateMipsPSO = std::make_unique<GenerateMipsPSO>();
         }
 
-        m_d3d12CommandList->SetPipelineState( m_GenerateMipsPSO->GetPipelineState().Get() );
+        SetPipelineState(m_GenerateMipsPSO->GetPipelineState());
         SetComputeRootSignature( m_GenerateMipsPSO->GetRootSignature() );
 
         GenerateMipsCB generateMipsCB;
@@ -670,7 +858,7 @@ void CommandList::PanoToCubemap(const Texture& inPanoTexture, Texture& outCubema
 
         TransitionBarrier(stagingTexture, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
-        m_d3d12CommandList->SetPipelineState(m_PanoToCubemapPSO->GetPipelineState().Get());
+        SetPipelineState(m_PanoToCubemapPSO->GetPipelineState());
         SetComputeRootSignature(m_PanoToCubemapPSO->GetRootSignature());
 
         PanoToCubemapCB panoToCubemapCB {};
@@ -738,7 +926,7 @@ void CommandList::EnvToIrradianceCubemap(const Texture& inCubemapTexture, const
             m_EnvToIrradianceCubemapPSO = std::make_unique<EnvToIrradianceCubemapPSO>();
         }
 
-        m_d3d12CommandList->SetPipelineState(m_EnvToIrradianceCubemapPSO->GetPipelineState().Get());
+        SetPipelineState(m_EnvToIrradianceCubemapPSO->GetPipelineState());
         SetComputeRootSignature(m_EnvToIrradianceCubemapPSO->GetRootSignature());
 
         EnvToIrradianceCubemapCB envToIrradianceCubemapCB {};
@@ -790,7 +978,7 @@ void CommandList::EnvToSpecularPrefilterCubemap(const Texture& inCubemapTexture,
             m_EnvToSpecularPrefilterCubemapPSO = std::make_unique<EnvToSpecularPrefilterCubemapPSO>();
         }
 
-        m_d3d12CommandList->SetPipelineState(m_EnvToSpecularPrefilterCubemapPSO->GetPipelineState().Get());
+        SetPipelineState(m_EnvToSpecularPrefilterCubemapPSO->GetPipelineState());
         SetComputeRootSignature(m_EnvToSpecularPrefilterCubemapPSO->GetRootSignature());
 
         auto pCubemapResource = outSpecularPrefilterTexture.GetD3D12Resource();
@@ -862,7 +1050,7 @@ void CommandList::BrdfLut(const Texture& outBrdfLutTexture)
             m_BrdfLutPSO = std::make_unique<BrdfLutPSO>();
         }
 
-        m_d3d12CommandList->SetPipelineState(m_BrdfLutPSO->GetPipelineState().Get());
+        SetPipelineState(m_BrdfLutPSO->GetPipelineState());
         SetComputeRootSignature(m_BrdfLutPSO->GetRootSignature());
 
         //D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
@@ -900,9 +1088,13 @@ void CommandList::ClearDepthStencilTexture( const Texture& texture, D3D12_CLEAR_
 }
 
 void CommandList::CopyTextureSubresource( Texture& texture, uint32_t firstSubresource, uint32_t numSubresources, D3D12_SUBRESOURCE_DATA* subresourceData )
+{
+    CopyTextureSubresource( texture.GetD3D12Resource(), firstSubresource, numSubresources, subresourceData );
+}
+
+void CommandList::CopyTextureSubresource( Microsoft::WRL::ComPtr<ID3D12Resource> destinationResource, uint32_t firstSubresource, uint32_t numSubresources, const D3D12_SUBRESOURCE_DATA* subresourceData )
 {
     auto device = m_Application.GetDevice();
-    auto destinationResource = texture.GetD3D12Resource();
 
     if ( destinationResource )
     {
@@ -923,7 +1115,7 @@ void CommandList::CopyTextureSubresource( Texture& texture, uint32_t firstSubres
             // This Only Works on COPY Queues! On DIRECT or COMPUTE queues, you must use explicit barriers
 
             // Resource must be in the copy-destination state.
-            TransitionBarrier(texture, D3D12_RESOURCE_STATE_COPY_DEST);
+            TransitionBarrier(destinationResource, D3D12_RESOURCE_STATE_COPY_DEST);
             FlushResourceBarriers();
         }
 
@@ -952,6 +1144,20 @@ void CommandList::CopyTextureSubresource( Texture& texture, uint32_t firstSubres
     }
 }
 
+void CommandList::WriteBufferImmediate( const Resource& buffer, uint64_t offset, uint32_t value )
+{
+    TransitionBarrier( buffer, D3D12_RESOURCE_STATE_COPY_DEST );
+    FlushResourceBarriers();
+
+    D3D12_WRITEBUFFERIMMEDIATE_PARAMETER parameter = {};
+    parameter.Dest = buffer.GetD3D12Resource()->GetGPUVirtualAddress() + offset;
+    parameter.Value = value;
+
+    m_d3d12CommandList->WriteBufferImmediate( 1, &parameter, nullptr );
+
+    TrackResource( buffer );
+}
+
 void CommandList::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData )
 {
     // Constant buffers must be 256-byte aligned.
@@ -961,9 +1167,33 @@ void CommandList::SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex,
     m_d3d12CommandList->SetGraphicsRootConstantBufferView( rootParameterIndex, heapAllococation.GPU );
 }
 
+void CommandList::SetComputeDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData )
+{
+    // Constant buffers must be 256-byte aligned.
+    auto heapAllococation = m_UploadBuffer->Allocate( sizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT );
+    memcpy( heapAllococation.CPU, bufferData, sizeInBytes );
+
+    m_d3d12CommandList->SetComputeRootConstantBufferView( rootParameterIndex, heapAllococation.GPU );
+}
+
 void CommandList::SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants )
 {
-    m_d3d12CommandList->SetGraphicsRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
+    if ( rootParameterIndex >= m_Graphics32BitConstants.size() )
+    {
+        m_Graphics32BitConstants.resize( rootParameterIndex + 1 );
+    }
+
+    auto& currentConstants = m_Graphics32BitConstants[rootParameterIndex];
+    bool changed = currentConstants.size() != numConstants ||
+                   memcmp( currentConstants.data(), constants, numConstants * sizeof( uint32_t ) ) != 0;
+
+    if ( FilterStateCall( changed ) )
+    {
+        const uint32_t* first = static_cast<const uint32_t*>( constants );
+        currentConstants.assign( first, first + numConstants );
+
+        m_d3d12CommandList->SetGraphicsRoot32BitConstants( rootParameterIndex, numConstants, constants, 0 );
+    }
 }
 
 void CommandList::SetCompute32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants )
@@ -977,9 +1207,20 @@ void CommandList::SetVertexBuffer( uint32_t slot, const VertexBuffer& vertexBuff
 
     auto vertexBufferView = vertexBuffer.GetVertexBufferView();
 
-    m_d3d12CommandList->IASetVertexBuffers( slot, 1, &vertexBufferView );
+    assert( slot < D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT );
+    const auto& currentView = m_VertexBufferViews[slot];
+    bool changed = currentView.BufferLocation != vertexBufferView.BufferLocation ||
+                   currentView.SizeInBytes != vertexBufferView.SizeInBytes ||
+                   currentView.StrideInBytes != vertexBufferView.StrideInBytes;
 
-    TrackResource(vertexBuffer);
+    // An unchanged view is already tracked by this command list.
+    if ( FilterStateCall( changed ) )
+    {
+        m_VertexBufferViews[slot] = vertexBufferView;
+        m_d3d12CommandList->IASetVertexBuffers( slot, 1, &vertexBufferView );
+
+        TrackResource(vertexBuffer);
+    }
 }
 
 void CommandList::SetDynamicVertexBuffer( uint32_t slot, size_t numVertices, size_t vertexSize, const void* vertexBufferData )
@@ -994,6 +1235,10 @@ void CommandList::SetDynamicVertexBuffer( uint32_t slot, size_t numVertices, siz
     vertexBufferView.SizeInBytes = static_cast<UINT>( bufferSize );
     vertexBufferView.StrideInBytes = static_cast<UINT>( vertexSize );
 
+    // Upload allocations are never reused within a command list, no need to filter.
+    assert( slot < D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT );
+    m_VertexBufferViews[slot] = vertexBufferView;
+
     m_d3d12CommandList->IASetVertexBuffers( slot, 1, &vertexBufferView );
 }
 
@@ -1003,9 +1248,17 @@ void CommandList::SetIndexBuffer( const IndexBuffer& indexBuffer )
 
     auto indexBufferView = indexBuffer.GetIndexBufferView();
 
-    m_d3d12CommandList->IASetIndexBuffer( &indexBufferView );
+    bool changed = m_IndexBufferView.BufferLocation != indexBufferView.BufferLocation ||
+                   m_IndexBufferView.SizeInBytes != indexBufferView.SizeInBytes ||
+                   m_IndexBufferView.Format != indexBufferView.Format;
+
+    if ( FilterStateCall( changed ) )
+    {
+        m_IndexBufferView = indexBufferView;
+        m_d3d12CommandList->IASetIndexBuffer( &indexBufferView );
 
-    TrackResource(indexBuffer);
+        TrackResource(indexBuffer);
+    }
 }
 
 void CommandList::SetDynamicIndexBuffer( size_t numIndicies, DXGI_FORMAT indexFormat, const void* indexBufferData )
@@ -1021,6 +1274,8 @@ void CommandList::SetDynamicIndexBuffer( size_t numIndicies, DXGI_FORMAT indexFo
     indexBufferView.SizeInBytes = static_cast<UINT>( bufferSize );
     indexBufferView.Format = indexFormat;
 
+    m_IndexBufferView = indexBufferView;
+
     m_d3d12CommandList->IASetIndexBuffer( &indexBufferView );
 }
 
@@ -1042,8 +1297,16 @@ void CommandList::SetViewport(const D3D12_VIEWPORT& viewport)
 void CommandList::SetViewports(const std::vector<D3D12_VIEWPORT>& viewports)
 {
     assert(viewports.size() < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
-    m_d3d12CommandList->RSSetViewports( static_cast<UINT>( viewports.size() ), 
-        viewports.data() );
+
+    bool changed = m_Viewports.size() != viewports.size() ||
+                   memcmp( m_Viewports.data(), viewports.data(), viewports.size() * sizeof( D3D12_VIEWPORT ) ) != 0;
+
+    if ( FilterStateCall( changed ) )
+    {
+        m_Viewports = viewports;
+        m_d3d12CommandList->RSSetViewports( static_cast<UINT>( viewports.size() ), 
+            viewports.data() );
+    }
 }
 
 void CommandList::SetScissorRect(const D3D12_RECT& scissorRect)
@@ -1054,21 +1317,33 @@ void CommandList::SetScissorRect(const D3D12_RECT& scissorRect)
 void CommandList::SetScissorRects(const std::vector<D3D12_RECT>& scissorRects)
 {
     assert( scissorRects.size() < D3D12_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
-    m_d3d12CommandList->RSSetScissorRects( static_cast<UINT>( scissorRects.size() ), 
-        scissorRects.data());
+
+    bool changed = m_ScissorRects.size() != scissorRects.size() ||
+                   memcmp( m_ScissorRects.data(), scissorRects.data(), scissorRects.size() * sizeof( D3D12_RECT ) ) != 0;
+
+    if ( FilterStateCall( changed ) )
+    {
+        m_ScissorRects = scissorRects;
+        m_d3d12CommandList->RSSetScissorRects( static_cast<UINT>( scissorRects.size() ), 
+            scissorRects.data());
+    }
 }
 
 void CommandList::SetPipelineState(Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState)
 {
-    m_d3d12CommandList->SetPipelineState(pipelineState.Get());
+    if ( FilterStateCall( m_PipelineState != pipelineState.Get() ) )
+    {
+        m_PipelineState = pipelineState.Get();
+        m_d3d12CommandList->SetPipelineState(m_PipelineState);
 
-    TrackResource(pipelineState);
+        TrackResource(pipelineState);
+    }
 }
 
 void CommandList::SetGraphicsRootSignature( const RootSignature& rootSignature )
 {
     auto d3d12RootSignature = rootSignature.GetRootSignature().Get();
-    if ( m_RootSignature != d3d12RootSignature )
+    if ( FilterStateCall( m_RootSignature != d3d12RootSignature ) )
     {
         m_RootSignature = d3d12RootSignature;
 
@@ -1077,6 +1352,9 @@ void CommandList::SetGraphicsRootSignature( const RootSignature& rootSignature )
             m_DynamicDescriptorHeap[i]->ParseRootSignature( rootSignature );
         }
 
+        // Changing the root signature clears the root arguments.
+        m_Graphics32BitConstants.clear();
+
         m_d3d12CommandList->SetGraphicsRootSignature(m_RootSignature);
 
         TrackResource(m_RootSignature);
@@ -1086,7 +1364,7 @@ void CommandList::SetGraphicsRootSignature( const RootSignature& rootSignature )
 void CommandList::SetComputeRootSignature( const RootSignature& rootSignature )
 {
     auto d3d12RootSignature = rootSignature.GetRootSignature().Get();
-    if ( m_RootSignature != d3d12RootSignature )
+    if ( FilterStateCall( m_RootSignature != d3d12RootSignature ) )
     {
         m_RootSignature = d3d12RootSignature;
 
@@ -1095,6 +1373,9 @@ void CommandList::SetComputeRootSignature( const RootSignature& rootSignature )
             m_DynamicDescriptorHeap[i]->ParseRootSignature( rootSignature );
         }
 
+        // Changing the root signature clears the root arguments.
+        m_Graphics32BitConstants.clear();
+
         m_d3d12CommandList->SetComputeRootSignature(m_RootSignature);
 
         TrackResource(m_RootSignature);
@@ -1126,6 +1407,14 @@ void CommandList::SetShaderResourceView( uint32_t rootParameterIndex,
     TrackResource(resource);
 }
 
+void CommandList::SetShaderResourceViews( uint32_t rootParameterIndex,
+                                          uint32_t descriptorOffset,
+                                          uint32_t numDescriptors,
+                                          D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptors )
+{
+    m_DynamicDescriptorHeap[D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->StageDescriptors( rootParameterIndex, descriptorOffset, numDescriptors, srcDescriptors );
+}
+
 void CommandList::SetUnorderedAccessView( uint32_t rootParameterIndex, 
                                           uint32_t descrptorOffset,
                                           const Resource& resource,
@@ -1186,8 +1475,19 @@ void CommandList::SetRenderTarget(const RenderTarget& renderTarget )
 
     D3D12_CPU_DESCRIPTOR_HANDLE* pDSV = depthStencilDescriptor.ptr != 0 ? &depthStencilDescriptor : nullptr;
 
-    m_d3d12CommandList->OMSetRenderTargets( static_cast<UINT>( renderTargetDescriptors.size() ),
-        renderTargetDescriptors.data(), FALSE, pDSV );
+    // The transitions above are still needed: the textures may have been used as SRVs in between.
+    bool changed = m_DepthStencilView.ptr != depthStencilDescriptor.ptr ||
+                   m_RenderTargetViews.size() != renderTargetDescriptors.size() ||
+                   memcmp( m_RenderTargetViews.data(), renderTargetDescriptors.data(), renderTargetDescriptors.size() * sizeof( D3D12_CPU_DESCRIPTOR_HANDLE ) ) != 0;
+
+    if ( FilterStateCall( changed ) )
+    {
+        m_RenderTargetViews = renderTargetDescriptors;
+        m_DepthStencilView = depthStencilDescriptor;
+
+        m_d3d12CommandList->OMSetRenderTargets( static_cast<UINT>( renderTargetDescriptors.size() ),
+            renderTargetDescriptors.data(), FALSE, pDSV );
+    }
 }
 
 void CommandList::Draw( uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertex, uint32_t startInstance )
@@ -1226,6 +1526,46 @@ void CommandList::Dispatch( uint32_t numGroupsX, uint32_t numGroupsY, uint32_t n
     m_d3d12CommandList->Dispatch( numGroupsX, numGroupsY, numGroupsZ );
 }
 
+void CommandList::ExecuteIndirect( ID3D12CommandSignature* commandSignature,
+                                   uint32_t maxCommandCount,
+                                   const Resource& argumentBuffer,
+                                   uint64_t argumentBufferOffset,
+                                   const Resource* countBuffer,
+                                   uint64_t countBufferOffset )
+{
+    TransitionBarrier( argumentBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT );
+    if ( countBuffer )
+    {
+        TransitionBarrier( *countBuffer, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT );
+    }
+
+    FlushResourceBarriers();
+
+    for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
+    {
+        m_DynamicDescriptorHeap[i]->CommitStagedDescriptorsForDraw( *this );
+    }
+
+    m_d3d12CommandList->ExecuteIndirect( commandSignature, maxCommandCount,
+        argumentBuffer.GetD3D12Resource().Get(), argumentBufferOffset,
+        countBuffer ? countBuffer->GetD3D12Resource().Get() : nullptr, countBufferOffset );
+
+    // The IA bindings and the root constants are whatever the last command set.
+    for ( auto& vertexBufferView : m_VertexBufferViews )
+    {
+        vertexBufferView = {};
+    }
+    m_IndexBufferView = {};
+    m_Graphics32BitConstants.clear();
+
+    TrackResource( commandSignature );
+    TrackResource( argumentBuffer );
+    if ( countBuffer )
+    {
+        TrackResource( *countBuffer );
+    }
+}
+
 bool CommandList::Close( CommandList& pendingCommandList )
 {
     // Flush any remaining barriers.
@@ -1261,11 +1601,38 @@ void CommandList::Reset()
     for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
     {
         m_DynamicDescriptorHeap[i]->Reset();
+    }
+
+    // The command list is back to the default state.
+    InvalidateState();
+    m_StateFilterStats = StateFilterStats();
+
+    m_ComputeCommandList = nullptr;
+}
+
+void CommandList::InvalidateState()
+{
+    for ( int i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i )
+    {
         m_DescriptorHeaps[i] = nullptr;
     }
 
     m_RootSignature = nullptr;
-    m_ComputeCommandList = nullptr;
+    m_PipelineState = nullptr;
+    m_PrimitiveTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+    for ( auto& vertexBufferView : m_VertexBufferViews )
+    {
+        vertexBufferView = {};
+    }
+    m_IndexBufferView = {};
+
+    m_Viewports.clear();
+    m_ScissorRects.clear();
+    m_RenderTargetViews.clear();
+    m_DepthStencilView = {};
+
+    m_Graphics32BitConstants.clear();
 }
 
 void CommandList::TrackResource(Microsoft::WRL::ComPtr<ID3D12Object> object)
@@ -2,12 +2,18 @@
 
 #include <Framework/3RD_Party/Defines.h>
 
+#include <Framework/Material/TextureCache.h>
+#include <Framework/Material/TextureProcessor.h>
+#include <Framework/Material/TextureStreamer.h>
 #include <Framework/Material/TextureUsage.h>
 
 #include <d3d12.h>
 #include <wrl.h>
 
+#include <future>
 #include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <memory> // for std::unique_ptr
 #include <mutex>  // for std::mutex
@@ -35,6 +41,14 @@ class VertexBuffer;
 
 class DX12_FW_API CommandList
 {
+public:
+    // Pipeline state calls recorded since the last Reset (see the shadow state below).
+    struct StateFilterStats
+    {
+        uint32_t NumStateCalls     = 0;     // PSO, root signature, IA, RS, OM and root constant binds.
+        uint32_t NumFilteredCalls  = 0;     // Binds that matched the current state and were not forwarded to D3D12.
+    };
+
 public:
     CommandList(D3D12_COMMAND_LIST_TYPE type);
     virtual ~CommandList();
@@ -44,11 +58,21 @@ public:
         return m_d3d12CommandListType;
     }
 
+    // Pipeline state set directly on the D3D12 command list bypasses the shadow state,
+    // call InvalidateState() afterwards.
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetGraphicsCommandList() const
     {
         return m_d3d12CommandList;
     }
 
+    // Forget the shadow state: the next binds are always forwarded to D3D12.
+    void InvalidateState();
+
+    const StateFilterStats& GetStateFilterStats() const
+    {
+        return m_StateFilterStats;
+    }
+
     // Transition a resource to a particular state.
     // --
     // @param resource - The resource to transition.
@@ -123,11 +147,49 @@ public:
         CopyStructuredBuffer( structuredBuffer, bufferData.size(), sizeof( T ), bufferData.data() );
     }
 
+    // Copy the contents to a region of an existing buffer (eg. a range of a GeometryPool buffer), the rest of the buffer is untouched.
+    void UpdateBufferRegion( Buffer& buffer, size_t offsetInBytes, size_t sizeInBytes, const void* bufferData );
+
     // Set the current primitive topology for the rendering pipeline.
     void SetPrimitiveTopology( D3D_PRIMITIVE_TOPOLOGY primitiveTopology );
 
     // Load a texture by a filename.
-    void LoadTextureFromFile( Texture& texture, const std::wstring& fileName, TextureUsage textureUsage = TextureUsage::Albedo );
+    // Shared through the texture cache (see TextureCache): a request of a file already loaded (or being loaded) with
+    // the same usage and sRGB flag gets the same resource. Else waits for its decode if PrefetchTextureFile started
+    // it, or decodes it on the calling thread (ProcessTextureFile). A texture that comes with all its mips (processed,
+    // or a DDS file) isn't given mips on the GPU. Only the cache lookups are serialized: several threads can decode (and
+    // record the uploads of) different textures at once. With the texture streamer enabled, only the mip tail of a
+    // streamable texture is uploaded (see TextureStreamer).
+    // @param sRGB - Create the texture with the sRGB variant of its format (sampled as linear values).
+    void LoadTextureFromFile( Texture& texture, const std::wstring& fileName, TextureUsage textureUsage = TextureUsage::Albedo, bool sRGB = false );
+
+    // A texture file read and decoded on the CPU, ready for the upload.
+    struct DecodedTexture;
+
+    // Disk read and decode of a texture file (see TextureDecoder). No device is used, it can run on any thread.
+    // Throws if the file can't be decoded.
+    static std::shared_ptr<const DecodedTexture> DecodeTextureFile( const std::wstring& fileName );
+
+    // The texture of a file as uploaded: if the texture processor is enabled (see TextureProcessor), the processed
+    // texture from its cache, else decoded, processed and cached. Without it, DecodeTextureFile.
+    static std::shared_ptr<const DecodedTexture> ProcessTextureFile( const std::wstring& fileName, TextureUsage textureUsage, bool sRGB );
+
+    // Start the decode (ProcessTextureFile) of a texture file on the thread pool of the application, for a later
+    // LoadTextureFromFile with the same usage and sRGB flag on the recording thread. The files that are in the cache or
+    // already being decoded are skipped.
+    static void PrefetchTextureFile( const std::wstring& fileName, TextureUsage textureUsage = TextureUsage::Albedo, bool sRGB = false );
+
+    // Shared by the command lists: the budget and the statistics.
+    static TextureCache& GetTextureCache();
+    // Shared by the command lists: the cache directory (disabled by default) and the statistics.
+    static TextureProcessor& GetTextureProcessor();
+    // Shared by the command lists: enabled or not (by default), the requests of the frame and the statistics.
+    static TextureStreamer& GetTextureStreamer();
+
+    // Upload the streamed mips of the frame, within the budget (see TextureStreamer), and clamp the views of their
+    // textures to them. Not on a copy command list. Execute it before the command lists that draw with the textures.
+    // The textures are left in D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE.
+    void StreamTextureMips( uint64_t budgetInBytes = TextureStreamer::DefaultBudget );
 
     // Clear a texture.
     void ClearTexture( const Texture& texture, const float clearColor[4] );
@@ -150,6 +212,9 @@ public:
     // Copy subresource data to a texture.
     void CopyTextureSubresource( Texture& texture, uint32_t firstSubresource, uint32_t numSubresources, D3D12_SUBRESOURCE_DATA* subresourceData );
 
+    // Write a 32-bit value to a buffer from the command stream (eg. reset the UAV counter of a structured buffer).
+    void WriteBufferImmediate( const Resource& buffer, uint64_t offset, uint32_t value );
+
     // Set a dynamic constant buffer data to an inline descriptor in the root signature.
     void SetGraphicsDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData );
     
@@ -159,6 +224,15 @@ public:
         SetGraphicsDynamicConstantBuffer( rootParameterIndex, sizeof( T ), &data );
     }
 
+    // Set a dynamic constant buffer data to an inline descriptor in the compute root signature.
+    void SetComputeDynamicConstantBuffer( uint32_t rootParameterIndex, size_t sizeInBytes, const void* bufferData );
+
+    template<typename T>
+    void SetComputeDynamicConstantBuffer( uint32_t rootParameterIndex, const T& data )
+    {
+        SetComputeDynamicConstantBuffer( rootParameterIndex, sizeof( T ), &data );
+    }
+
     // Set a set of 32-bit constants on the graphics pipeline.
     void SetGraphics32BitConstants( uint32_t rootParameterIndex, uint32_t numConstants, const void* constants );
 
@@ -241,6 +315,15 @@ public:
         const D3D12_SHADER_RESOURCE_VIEW_DESC* srv = nullptr
     );
 
+    // Stage a range of contiguous (CPU visible) SRV descriptors in a descriptor table.
+    // The resources are neither transitioned nor tracked, see TransitionBarrier.
+    void SetShaderResourceViews(
+        uint32_t rootParameterIndex,
+        uint32_t descriptorOffset,
+        uint32_t numDescriptors,
+        D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptors
+    );
+
     // Set the UAV on the graphics pipeline.
     void SetUnorderedAccessView( 
         uint32_t rootParameterIndex, 
@@ -262,6 +345,18 @@ public:
 	// Dispatch a compute shader.
 	void Dispatch(uint32_t numGroupsX, uint32_t numGroupsY = 1, uint32_t numGroupsZ = 1);
 
+    // Execute the draws of an argument buffer (see IndirectDrawBuilder).
+    // The argument (and count) buffers are transitioned to D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT.
+    // The commands can change the vertex / index buffers and the root constants, so their shadow state is dropped.
+    // --
+    // @param countBuffer - Optional, holds the number of commands to execute (clamped to maxCommandCount).
+    void ExecuteIndirect( ID3D12CommandSignature* commandSignature,
+                          uint32_t maxCommandCount,
+                          const Resource& argumentBuffer,
+                          uint64_t argumentBufferOffset = 0,
+                          const Resource* countBuffer = nullptr,
+                          uint64_t countBufferOffset = 0 );
+
     /***************************************************************************
      * Methods defined below are only intended to be used by internal classes. *
      ***************************************************************************/
@@ -299,12 +394,28 @@ private:
     // Generate mips for UAV compatible textures.
     void GenerateMips_UAV( Texture& texture, DXGI_FORMAT format );
 
+    void CopyTextureSubresource( Microsoft::WRL::ComPtr<ID3D12Resource> destinationResource, uint32_t firstSubresource, uint32_t numSubresources, const D3D12_SUBRESOURCE_DATA* subresourceData );
+
+    // The decode (prefetched or not), resource creation and upload of a texture file, for a texture cache miss.
+    Microsoft::WRL::ComPtr<ID3D12Resource> UploadTextureFile( Texture& texture, const std::wstring& fileName, TextureUsage textureUsage, bool sRGB );
+
     // Copy the contents of a CPU buffer to a GPU buffer (possibly replacing the previous buffer contents).
     void CopyBuffer( Buffer& buffer, size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE );
 
     // Binds the current descriptor heaps to the command list.
     void BindDescriptorHeaps();
 
+    // Count a pipeline state bind. Returns true if the bind must be forwarded to D3D12.
+    bool FilterStateCall( bool changed )
+    {
+        ++m_StateFilterStats.NumStateCalls;
+        if ( !changed )
+        {
+            ++m_StateFilterStats.NumFilteredCalls;
+        }
+        return changed;
+    }
+
     using TrackedObjects = std::vector < Microsoft::WRL::ComPtr<ID3D12Object> >;
 
     D3D12_COMMAND_LIST_TYPE m_d3d12CommandListType;
@@ -321,6 +432,21 @@ private:
     // signature changes.
     ID3D12RootSignature*                                m_RootSignature;
 
+    // Shadow copy of the pipeline state bound on the command list. Binds that match
+    // the shadow state are dropped. Reset with the command list (the D3D12 defaults).
+    ID3D12PipelineState*                                m_PipelineState;
+    D3D_PRIMITIVE_TOPOLOGY                              m_PrimitiveTopology;
+    D3D12_VERTEX_BUFFER_VIEW                            m_VertexBufferViews[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    D3D12_INDEX_BUFFER_VIEW                             m_IndexBufferView;
+    std::vector<D3D12_VIEWPORT>                         m_Viewports;
+    std::vector<D3D12_RECT>                             m_ScissorRects;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>            m_RenderTargetViews;
+    D3D12_CPU_DESCRIPTOR_HANDLE                         m_DepthStencilView;
+    // Graphics root constants per root parameter (invalidated by a root signature change).
+    std::vector<std::vector<uint32_t>>                  m_Graphics32BitConstants;
+
+    StateFilterStats                                    m_StateFilterStats;
+
     // Resource created in an upload heap. Useful for drawing of dynamic geometry
     // or for uploading constant buffer data that changes every draw call.
     std::unique_ptr<UploadBuffer>                       m_UploadBuffer;
@@ -356,8 +482,13 @@ private:
     TrackedObjects                                      m_TrackedObjects;
 
     // Keep track of loaded textures to avoid loading the same texture multiple times.
-    static std::map<std::wstring, ID3D12Resource*>      ms_TextureCache;
-    static std::mutex                                   ms_TextureCacheMutex;
+    static TextureCache                                 ms_TextureCache;
+    static TextureProcessor                             ms_TextureProcessor;
+    static TextureStreamer                              ms_TextureStreamer;
+    // The decodes started by PrefetchTextureFile, until their LoadTextureFromFile (of the same usage and sRGB flag:
+    // they are processed for it).
+    static std::unordered_map<TextureCache::Key, std::shared_future<std::shared_ptr<const DecodedTexture>>, TextureCache::KeyHash> ms_TextureDecodes;
+    static std::mutex                                   ms_TextureDecodesMutex;
 
     Application&                                        m_Application;
 };
\ No newline at end of file
@@ -10,6 +10,7 @@
 
 #include <thread>
 #include <mutex>
+#include <chrono>
 
 
 // TODO:
@@ -70,9 +71,18 @@ CommandQueue::~CommandQueue()
 
 
 uint64_t CommandQueue::Signal() {
-	// Signal() is being called from multiple threads (CommandQueue and Window threads) concurently, so m_FenceValue has to be atomic
-	uint64_t fenceValue = ++m_FenceValue;
-	m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValue);
+	std::vector<std::shared_ptr<CommandList> > generateMipsCommandLists;
+	uint64_t fenceValue = 0;
+	{
+		std::lock_guard<std::mutex> submissionLock(m_SubmissionMutex);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		fenceValue = SubmitPendingCommandLists(generateMipsCommandLists);
+		m_FrameSubmissionStats.SubmissionTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	ExecuteGenerateMipsCommandLists(generateMipsCommandLists);
+
 	return fenceValue;
 }
 
@@ -85,6 +95,12 @@ bool CommandQueue::IsFenceComplete(uint64_t fenceValue)
 
 void CommandQueue::WaitForFenceValue(uint64_t fenceValue)
 {
+	// A fence value returned in the deferred submission mode is signaled only after the gathered lists are submitted.
+	if (fenceValue > m_FenceValue)
+	{
+		FlushSubmissions();
+	}
+
 	if (!IsFenceComplete(fenceValue)) 
 	{
 		auto event = ::CreateEvent(NULL, FALSE, FALSE, NULL);
@@ -100,6 +116,8 @@ void CommandQueue::WaitForFenceValue(uint64_t fenceValue)
 
 void CommandQueue::Flush()
 {
+	FlushSubmissions();
+
 	std::unique_lock<std::mutex> lock(m_ProcessInFlightCommandListsThreadMutex);
 
 	// Block this thread and wait for notification from a ProccessInFlightCommandLists() thread and Predicate
@@ -138,77 +156,137 @@ uint64_t CommandQueue::ExecuteCommandList(std::shared_ptr<CommandList> commandLi
 
 uint64_t CommandQueue::ExecuteCommandLists(const std::vector<std::shared_ptr<CommandList> >& commandLists)
 {
-	ResourceStateTracker::Lock();
-
-	// (I) Main D3D12 command lists to be executed.
-	std::vector<ID3D12CommandList*> d3d12CommandLists;
-	d3d12CommandLists.reserve(commandLists.size() * 2); // 2x size as each command list have a pendingBarriers command list (with barriers).
-
-	// (I.1) A copy of Main command lists above but wrapped with CommandList:
-	//		1. Used to queue CLs into m_InFlightCommandLists;
-	//		2. Execute won't be called on them;
-	//		3. It's needed to keep track of CommandList in flught:
-	//				a) to be able to RESET them when execution is finished;
-	//				b) put put them back to m_AvailableCommandLists.
-	std::vector<std::shared_ptr<CommandList> > toBeQueued;
-	toBeQueued.reserve(commandLists.size() * 2);        //  2x size as each command list have a pendingBarriers command list (with barriers).
-
-	// (II) Secondary COMPUTE command lists. 
+	// Secondary COMPUTE command lists. 
 	//		1. Specifically for GenerateMips operations.
 	//		2. Storing them separatemy as they will be executed in a different (COMPUTE) queue
 	std::vector<std::shared_ptr<CommandList> > generateMipsCommandLists;
-	generateMipsCommandLists.reserve(commandLists.size());
-
-	for (auto commandList : commandLists)
+	uint64_t fenceValue = 0;
 	{
-		auto pendingBarriersCommandList = GetCommandList();
-		bool hasPendingBarriers = commandList->Close(*pendingBarriersCommandList);
-		pendingBarriersCommandList->Close();
+		// The submission lock keeps the order of the gathered lists equal to the order
+		// in which their final resource states are committed to the ResourceStateTracker.
+		std::lock_guard<std::mutex> submissionLock(m_SubmissionMutex);
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		// (I)   m_PendingD3D12CommandLists - main D3D12 command lists to be executed (2x - each command list have a pendingBarriers command list).
+		// (I.1) m_PendingCommandLists - a copy of Main command lists above but wrapped with CommandList:
+		//		1. Used to queue CLs into m_InFlightCommandLists;
+		//		2. Execute won't be called on them;
+		//		3. It's needed to keep track of CommandList in flught:
+		//				a) to be able to RESET them when execution is finished;
+		//				b) put put them back to m_AvailableCommandLists.
+		ResourceStateTracker::Lock();
+
+		for (auto commandList : commandLists)
+		{
+			const auto& stateFilterStats = commandList->GetStateFilterStats();
+			m_FrameSubmissionStats.NumStateCalls += stateFilterStats.NumStateCalls;
+			m_FrameSubmissionStats.NumFilteredStateCalls += stateFilterStats.NumFilteredCalls;
+
+			auto pendingBarriersCommandList = GetCommandList();
+			bool hasPendingBarriers = commandList->Close(*pendingBarriersCommandList);
+			pendingBarriersCommandList->Close();
+
+			// If there are no pending barriers on the pending command list, there is no reason to 
+			// execute an empty command list on the command queue.
+			if (hasPendingBarriers)
+			{
+				m_PendingD3D12CommandLists.push_back(pendingBarriersCommandList->GetGraphicsCommandList().Get());
+			}
+			m_PendingD3D12CommandLists.push_back(commandList->GetGraphicsCommandList().Get());
+
+			m_PendingCommandLists.push_back(pendingBarriersCommandList);
+			m_PendingCommandLists.push_back(commandList);
+
+			if (auto genMipsCmdList = commandList->GetGenerateMipsCommandList())
+			{
+				m_PendingGenerateMipsCommandLists.push_back(genMipsCmdList);
+			}
+		}
 
-		// If there are no pending barriers on the pending command list, there is no reason to 
-		// execute an empty command list on the command queue.
-		if (hasPendingBarriers)
+		ResourceStateTracker::Unlock();
+
+		if (m_bDeferredSubmission)
+		{
+			// Every Signal() submits the gathered lists first, so the next fence value covers them.
+			fenceValue = m_FenceValue + 1;
+		}
+		else
 		{
-			d3d12CommandLists.push_back(pendingBarriersCommandList->GetGraphicsCommandList().Get());
+			fenceValue = SubmitPendingCommandLists(generateMipsCommandLists);
 		}
-		d3d12CommandLists.push_back(commandList->GetGraphicsCommandList().Get());
 
-		toBeQueued.push_back(pendingBarriersCommandList);
-		toBeQueued.push_back(commandList);
+		m_FrameSubmissionStats.NumExecuteCalls++;
+		m_FrameSubmissionStats.SubmissionTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+	}
+
+	// If there are any command lists that generate mips then execute those
+	// after the initial resource command lists have finished.
+	ExecuteGenerateMipsCommandLists(generateMipsCommandLists);
+
+	return fenceValue;
+}
+
+
+uint64_t CommandQueue::FlushSubmissions()
+{
+	std::vector<std::shared_ptr<CommandList> > generateMipsCommandLists;
+	uint64_t fenceValue = 0;
+	{
+		std::lock_guard<std::mutex> submissionLock(m_SubmissionMutex);
 
-		if (auto genMipsCmdList = commandList->GetGenerateMipsCommandList())
+		if (m_PendingCommandLists.empty())
 		{
-			generateMipsCommandLists.push_back(genMipsCmdList);
+			return m_FenceValue;
 		}
+
+		auto startTime = std::chrono::high_resolution_clock::now();
+		fenceValue = SubmitPendingCommandLists(generateMipsCommandLists);
+		m_FrameSubmissionStats.SubmissionTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
 	}
 
-	UINT numCommandLists = static_cast<UINT>(d3d12CommandLists.size());
-	m_d3d12CommandQueue->ExecuteCommandLists(numCommandLists, d3d12CommandLists.data());
-	uint64_t fenceValue = Signal();
+	ExecuteGenerateMipsCommandLists(generateMipsCommandLists);
+
+	return fenceValue;
+}
 
-	ResourceStateTracker::Unlock();
 
-	// Queue command lists for reuse.
-	for (auto commandList : toBeQueued)
+void CommandQueue::SetDeferredSubmission(bool deferred)
+{
 	{
-		m_InFlightCommandLists.Push({ fenceValue, commandList });
+		std::lock_guard<std::mutex> submissionLock(m_SubmissionMutex);
+		m_bDeferredSubmission = deferred;
 	}
 
-	// If there are any command lists that generate mips then execute those
-	// after the initial resource command lists have finished.
-	if (generateMipsCommandLists.size() > 0)
+	if (!deferred)
 	{
-		auto computeQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
-		computeQueue->Wait(*this);
-		computeQueue->ExecuteCommandLists(generateMipsCommandLists);
+		FlushSubmissions();
 	}
+}
 
-	return fenceValue;
+
+void CommandQueue::EndFrameStats()
+{
+	std::lock_guard<std::mutex> submissionLock(m_SubmissionMutex);
+
+	m_LastFrameSubmissionStats = m_FrameSubmissionStats;
+	m_FrameSubmissionStats = SubmissionStats();
 }
 
 
-void CommandQueue::Wait(const CommandQueue& other)
+CommandQueue::SubmissionStats CommandQueue::GetSubmissionStats() const
 {
+	std::lock_guard<std::mutex> submissionLock(m_SubmissionMutex);
+
+	return m_LastFrameSubmissionStats;
+}
+
+
+void CommandQueue::Wait(CommandQueue& other)
+{
+	// Make sure the other queue's gathered command lists are covered by its fence value.
+	other.FlushSubmissions();
+
 	m_d3d12CommandQueue->Wait(other.m_d3d12Fence.Get(), other.m_FenceValue);
 }
 
@@ -219,6 +297,49 @@ ComPtr<ID3D12CommandQueue> CommandQueue::GetD3D12CommandQueue() const
 }
 
 
+uint64_t CommandQueue::SubmitPendingCommandLists(std::vector<std::shared_ptr<CommandList> >& generateMipsCommandLists)
+{
+	if (!m_PendingD3D12CommandLists.empty())
+	{
+		UINT numCommandLists = static_cast<UINT>(m_PendingD3D12CommandLists.size());
+		m_d3d12CommandQueue->ExecuteCommandLists(numCommandLists, m_PendingD3D12CommandLists.data());
+
+		m_FrameSubmissionStats.NumSubmits++;
+		m_FrameSubmissionStats.NumCommandLists += numCommandLists;
+	}
+
+	// Signal() is being called from multiple threads (CommandQueue and Window threads) concurently, so m_FenceValue has to be atomic
+	uint64_t fenceValue = ++m_FenceValue;
+	m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValue);
+	m_FrameSubmissionStats.NumSignals++;
+
+	// Queue command lists for reuse.
+	for (auto commandList : m_PendingCommandLists)
+	{
+		m_InFlightCommandLists.Push({ fenceValue, commandList });
+	}
+
+	generateMipsCommandLists.insert(generateMipsCommandLists.end(), m_PendingGenerateMipsCommandLists.begin(), m_PendingGenerateMipsCommandLists.end());
+
+	m_PendingCommandLists.clear();
+	m_PendingD3D12CommandLists.clear();
+	m_PendingGenerateMipsCommandLists.clear();
+
+	return fenceValue;
+}
+
+
+void CommandQueue::ExecuteGenerateMipsCommandLists(const std::vector<std::shared_ptr<CommandList> >& generateMipsCommandLists)
+{
+	if (generateMipsCommandLists.size() > 0)
+	{
+		auto computeQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+		computeQueue->Wait(*this);
+		computeQueue->ExecuteCommandLists(generateMipsCommandLists);
+	}
+}
+
+
 void CommandQueue::ProccessInFlightCommandLists()
 {
 	std::unique_lock<std::mutex> lock(m_ProcessInFlightCommandListsThreadMutex, std::defer_lock);
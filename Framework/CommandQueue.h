@@ -8,27 +8,61 @@
 
 #include <memory>	// shared_ptr
 #include <queue>
+#include <vector>
+#include <mutex>
 
 class Application;
 class CommandList;
 
 class DX12_FW_API CommandQueue
 {
+public:
+	// Submission counters of a single frame (see EndFrameStats()).
+	struct SubmissionStats
+	{
+		uint32_t	NumExecuteCalls		= 0;	// ExecuteCommandList(s) calls made by the client.
+		uint32_t	NumSubmits			= 0;	// ID3D12CommandQueue::ExecuteCommandLists calls.
+		uint32_t	NumCommandLists		= 0;	// D3D12 command lists submitted (including pending barrier lists).
+		uint32_t	NumSignals			= 0;	// Fence signals.
+		double		SubmissionTimeMs	= 0.0;	// CPU time spent closing and submitting command lists.
+		uint32_t	NumStateCalls		= 0;	// Pipeline state binds recorded in the executed command lists.
+		uint32_t	NumFilteredStateCalls	= 0;	// Redundant binds dropped by the command lists' shadow state.
+	};
+
 public:
 	CommandQueue(D3D12_COMMAND_LIST_TYPE type);
 	~CommandQueue();
 
+	// Submits any deferred command lists before signaling, so the returned fence value covers all of them.
 	uint64_t Signal();
 	bool IsFenceComplete(uint64_t fenceValue);
 	void WaitForFenceValue(uint64_t fenceValue);
 	void Flush();
 
-	// Wait for another command queue to finish.
-	void Wait(const CommandQueue& other);
+	// Wait for another command queue to finish (including its deferred command lists).
+	void Wait(CommandQueue& other);
 
 	// Returns the fence value to wait for this command list. Also enqueue compute follow-up work on top of primary quque.
+	// --
+	// In deferred submission mode the command lists are closed (pending barriers resolved) but only gathered;
+	// the returned fence value is signaled by the next FlushSubmissions() / Signal().
 	uint64_t ExecuteCommandList(std::shared_ptr<CommandList> commandList);
 	uint64_t ExecuteCommandLists(const std::vector<std::shared_ptr<CommandList> >& commandLists);
+
+	// Deferred submission mode: coalesce all ExecuteCommandList(s) calls into a single 
+	// ID3D12CommandQueue::ExecuteCommandLists at the next sync point (FlushSubmissions, Signal, Wait, Flush).
+	// Disabling the mode flushes the gathered command lists.
+	void SetDeferredSubmission(bool deferred);
+	bool IsDeferredSubmission() const { return m_bDeferredSubmission; }
+
+	// Submit the gathered command lists. Returns the fence value to wait for them
+	// (or the last signaled fence value if nothing was gathered).
+	uint64_t FlushSubmissions();
+
+	// Latch the counters of the current frame. Called once per frame by the Window::Present.
+	void EndFrameStats();
+	// Counters of the last finished frame.
+	SubmissionStats GetSubmissionStats() const;
 	
 	// Get an available command list from the command queue.
 	std::shared_ptr<CommandList> GetCommandList();
@@ -39,6 +73,12 @@ private /*helpers*/:
 	// Free any command lists that are finished processing on the command queue.
 	void ProccessInFlightCommandLists();
 
+	// Submit the gathered command lists and signal the fence. m_SubmissionMutex must be locked.
+	// The GenerateMips follow-up lists are returned to be executed after the mutex is released.
+	uint64_t SubmitPendingCommandLists(std::vector<std::shared_ptr<CommandList> >& generateMipsCommandLists);
+	// Execute GenerateMips compute lists on the compute queue after this queue's work.
+	void ExecuteGenerateMipsCommandLists(const std::vector<std::shared_ptr<CommandList> >& generateMipsCommandLists);
+
 	// Keep track of command allocators that are "in-flight"
 	// The first member is the fence value to wait for, the second is the 
 	// a shared pointer to the "in-flight" command list.
@@ -63,5 +103,17 @@ private /*main*/:
 	std::atomic_bool								m_bProcessInFlightCommandLists;
 	std::mutex										m_ProcessInFlightCommandListsThreadMutex;
 	std::condition_variable							m_ProcessInFlightCommandListsThreadCV;
+
+	// Deferred submission: closed command lists (pending barrier lists included) in submission order.
+	// The flag is set under m_SubmissionMutex, but read without it by the recording threads.
+	std::atomic_bool								m_bDeferredSubmission = false;
+	std::vector<std::shared_ptr<CommandList>>		m_PendingCommandLists;
+	std::vector<ID3D12CommandList*>					m_PendingD3D12CommandLists;
+	std::vector<std::shared_ptr<CommandList>>		m_PendingGenerateMipsCommandLists;
+	mutable std::mutex								m_SubmissionMutex;
+
+	// Stats
+	SubmissionStats									m_FrameSubmissionStats;
+	SubmissionStats									m_LastFrameSubmissionStats;
 };
 
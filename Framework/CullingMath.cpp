@@ -0,0 +1,296 @@
+#include "CullingMath.h"
+
+#include <cmath>
+#include <exception>
+
+using namespace DirectX;
+
+static_assert( sizeof( CullingMath::InstanceBounds ) == 32, "CullingMath::InstanceBounds must match the HLSL struct." );
+static_assert( sizeof( CullingMath::InstanceCone ) == 32, "CullingMath::InstanceCone must match the HLSL struct." );
+static_assert( sizeof( CullingMath::View ) == 160, "CullingMath::View must match the HLSL struct." );
+
+namespace
+{
+    // clip = float4(x, y, z, 1) * viewProjection, in the order of the shader.
+    XMFLOAT4 TransformPoint( float x, float y, float z, const XMFLOAT4 rows[4] )
+    {
+        XMFLOAT4 clip;
+        clip.x = ( ( x * rows[0].x + y * rows[1].x ) + z * rows[2].x ) + rows[3].x;
+        clip.y = ( ( x * rows[0].y + y * rows[1].y ) + z * rows[2].y ) + rows[3].y;
+        clip.z = ( ( x * rows[0].z + y * rows[1].z ) + z * rows[2].z ) + rows[3].z;
+        clip.w = ( ( x * rows[0].w + y * rows[1].w ) + z * rows[2].w ) + rows[3].w;
+        return clip;
+    }
+
+    XMFLOAT4 GetColumn( const XMFLOAT4X4& m, int column )
+    {
+        return XMFLOAT4( m.m[0][column], m.m[1][column], m.m[2][column], m.m[3][column] );
+    }
+
+    XMFLOAT4 Add( const XMFLOAT4& a, const XMFLOAT4& b )
+    {
+        return XMFLOAT4( a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w );
+    }
+
+    XMFLOAT4 Subtract( const XMFLOAT4& a, const XMFLOAT4& b )
+    {
+        return XMFLOAT4( a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w );
+    }
+}
+
+CullingMath::View CullingMath::MakeView( const XMFLOAT4X4& viewProjection )
+{
+    View view;
+    for ( int i = 0; i < 4; ++i )
+    {
+        view.ViewProjection[i] = XMFLOAT4( viewProjection.m[i][0], viewProjection.m[i][1], viewProjection.m[i][2], viewProjection.m[i][3] );
+    }
+
+    // Gribb / Hartmann: -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+    XMFLOAT4 column0 = GetColumn( viewProjection, 0 );
+    XMFLOAT4 column1 = GetColumn( viewProjection, 1 );
+    XMFLOAT4 column2 = GetColumn( viewProjection, 2 );
+    XMFLOAT4 column3 = GetColumn( viewProjection, 3 );
+
+    view.FrustumPlanes[0] = Add( column3, column0 );
+    view.FrustumPlanes[1] = Subtract( column3, column0 );
+    view.FrustumPlanes[2] = Add( column3, column1 );
+    view.FrustumPlanes[3] = Subtract( column3, column1 );
+    view.FrustumPlanes[4] = column2;
+    view.FrustumPlanes[5] = Subtract( column3, column2 );
+
+    return view;
+}
+
+void CullingMath::GetHiZSize( uint32_t depthWidth, uint32_t depthHeight, uint32_t& width, uint32_t& height, uint32_t& numMips )
+{
+    width = std::max<uint32_t>( 1, depthWidth >> 1 );
+    height = std::max<uint32_t>( 1, depthHeight >> 1 );
+
+    uint32_t size = std::max<uint32_t>( width, height );
+    numMips = 1;
+    while ( ( size >> numMips ) != 0 )
+    {
+        ++numMips;
+    }
+}
+
+float CullingMath::ReduceTexel( const std::vector<float>& src, uint32_t srcWidth, uint32_t srcHeight,
+                                uint32_t dstWidth, uint32_t dstHeight, uint32_t x, uint32_t y )
+{
+    uint32_t firstX = 2 * x;
+    uint32_t firstY = 2 * y;
+    uint32_t lastX = ( x == dstWidth - 1 ) ? srcWidth - 1 : firstX + 1;
+    uint32_t lastY = ( y == dstHeight - 1 ) ? srcHeight - 1 : firstY + 1;
+
+    float maxDepth = src[firstY * srcWidth + firstX];
+    for ( uint32_t srcY = firstY; srcY <= lastY; ++srcY )
+    {
+        for ( uint32_t srcX = firstX; srcX <= lastX; ++srcX )
+        {
+            maxDepth = std::max( maxDepth, src[srcY * srcWidth + srcX] );
+        }
+    }
+
+    return maxDepth;
+}
+
+CullingMath::HiZPyramid CullingMath::BuildHiZ( const std::vector<float>& depth, uint32_t depthWidth, uint32_t depthHeight )
+{
+    if ( depthWidth == 0 || depthHeight == 0 || depth.size() != static_cast<size_t>( depthWidth ) * depthHeight )
+    {
+        throw std::exception( "CullingMath: invalid depth buffer." );
+    }
+
+    HiZPyramid hiz;
+    hiz.DepthWidth = depthWidth;
+    hiz.DepthHeight = depthHeight;
+    hiz.DepthTexelSize = XMFLOAT2( 2.0f / static_cast<float>( depthWidth ), 2.0f / static_cast<float>( depthHeight ) );
+
+    uint32_t numMips;
+    GetHiZSize( depthWidth, depthHeight, hiz.Width, hiz.Height, numMips );
+    hiz.Mips.resize( numMips );
+
+    const std::vector<float>* src = &depth;
+    uint32_t srcWidth = depthWidth;
+    uint32_t srcHeight = depthHeight;
+
+    for ( uint32_t mip = 0; mip < numMips; ++mip )
+    {
+        uint32_t dstWidth = hiz.GetMipWidth( mip );
+        uint32_t dstHeight = hiz.GetMipHeight( mip );
+
+        auto& dst = hiz.Mips[mip];
+        dst.resize( static_cast<size_t>( dstWidth ) * dstHeight );
+
+        for ( uint32_t y = 0; y < dstHeight; ++y )
+        {
+            for ( uint32_t x = 0; x < dstWidth; ++x )
+            {
+                dst[y * dstWidth + x] = ReduceTexel( *src, srcWidth, srcHeight, dstWidth, dstHeight, x, y );
+            }
+        }
+
+        src = &dst;
+        srcWidth = dstWidth;
+        srcHeight = dstHeight;
+    }
+
+    return hiz;
+}
+
+bool CullingMath::IsInFrustum( const View& view, const InstanceBounds& bounds )
+{
+    const XMFLOAT3& c = bounds.Center;
+    const XMFLOAT3& e = bounds.Extents;
+
+    for ( const auto& plane : view.FrustumPlanes )
+    {
+        // Signed distance of the center, and the projected radius of the box on the plane normal.
+        float distance = ( ( plane.x * c.x + plane.y * c.y ) + plane.z * c.z ) + plane.w;
+        float radius = ( std::abs( plane.x ) * e.x + std::abs( plane.y ) * e.y ) + std::abs( plane.z ) * e.z;
+
+        if ( distance + radius < 0.0f )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CullingMath::IsBackfacing( const InstanceCone& cone, const XMFLOAT3& cameraPosition )
+{
+    float x = cone.Center.x - cameraPosition.x;
+    float y = cone.Center.y - cameraPosition.y;
+    float z = cone.Center.z - cameraPosition.z;
+
+    // dot(v, axis) - radius * (1 + cutoff) >= cutoff * length(v), for v from the camera to the center: every point of
+    // the sphere is seen within the cutoff of the axis.
+    float distance = ( ( x * cone.Axis.x + y * cone.Axis.y ) + z * cone.Axis.z ) - ( cone.Radius + cone.Radius * cone.Cutoff );
+    if ( distance < 0.0f )
+    {
+        return false;
+    }
+
+    float lengthSquared = ( x * x + y * y ) + z * z;
+    return distance * distance >= ( cone.Cutoff * cone.Cutoff ) * lengthSquared;
+}
+
+uint32_t CullingMath::GetTexelIndex( float c, float w, float texelSize, uint32_t size )
+{
+    // First guess, then walk to the texel whose edges enclose c / w.
+    // The edges are monotonic in p, so the walk ends on the same texel whatever the guess.
+    float guess = ( ( c / w ) * 0.5f + 0.5f ) * static_cast<float>( size );
+    uint32_t p = static_cast<uint32_t>( std::min( std::max( guess, 0.0f ), static_cast<float>( size - 1 ) ) );
+
+    while ( p > 0 && c < ( static_cast<float>( p ) * texelSize - 1.0f ) * w )
+    {
+        --p;
+    }
+    while ( p + 1 < size && c >= ( static_cast<float>( p + 1 ) * texelSize - 1.0f ) * w )
+    {
+        ++p;
+    }
+
+    return p;
+}
+
+CullingMath::HiZRect CullingMath::GetHiZRect( const HiZPyramid& hiz, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY )
+{
+    // Depth texels -> mip 0 texels (the last mip 0 texel also covers the extra depth texel of an odd size).
+    minX = std::min( minX >> 1, hiz.Width - 1 );
+    minY = std::min( minY >> 1, hiz.Height - 1 );
+    maxX = std::min( maxX >> 1, hiz.Width - 1 );
+    maxY = std::min( maxY >> 1, hiz.Height - 1 );
+
+    // The first mip where the rectangle spans at most 2x2 texels.
+    uint32_t extent = std::max( maxX - minX, maxY - minY );
+    uint32_t mip = 0;
+    while ( ( extent >> mip ) != 0 )
+    {
+        ++mip;
+    }
+    mip = std::min( mip, hiz.GetNumMips() - 1 );
+
+    uint32_t mipWidth = hiz.GetMipWidth( mip );
+    uint32_t mipHeight = hiz.GetMipHeight( mip );
+
+    HiZRect rect;
+    rect.Mip = mip;
+    rect.X0 = std::min( minX >> mip, mipWidth - 1 );
+    rect.Y0 = std::min( minY >> mip, mipHeight - 1 );
+    rect.X1 = std::min( maxX >> mip, mipWidth - 1 );
+    rect.Y1 = std::min( maxY >> mip, mipHeight - 1 );
+    return rect;
+}
+
+bool CullingMath::IsOccluded( const View& view, const InstanceBounds& bounds, const HiZPyramid& hiz )
+{
+    const XMFLOAT3& c = bounds.Center;
+    const XMFLOAT3& e = bounds.Extents;
+
+    float clipZ[8];
+    float clipW[8];
+
+    uint32_t minX = hiz.DepthWidth - 1;
+    uint32_t minY = hiz.DepthHeight - 1;
+    uint32_t maxX = 0;
+    uint32_t maxY = 0;
+
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+        float x = ( i & 1 ) ? c.x + e.x : c.x - e.x;
+        float y = ( i & 2 ) ? c.y + e.y : c.y - e.y;
+        float z = ( i & 4 ) ? c.z + e.z : c.z - e.z;
+
+        XMFLOAT4 clip = TransformPoint( x, y, z, view.ViewProjection );
+
+        // Crosses the camera plane: the screen rectangle is unbounded.
+        if ( !( clip.w > 0.0f ) )
+        {
+            return false;
+        }
+
+        uint32_t texelX = GetTexelIndex( clip.x, clip.w, hiz.DepthTexelSize.x, hiz.DepthWidth );
+        uint32_t texelY = GetTexelIndex( -clip.y, clip.w, hiz.DepthTexelSize.y, hiz.DepthHeight );
+
+        minX = std::min( minX, texelX );
+        minY = std::min( minY, texelY );
+        maxX = std::max( maxX, texelX );
+        maxY = std::max( maxY, texelY );
+
+        clipZ[i] = clip.z;
+        clipW[i] = clip.w;
+    }
+
+    HiZRect rect = GetHiZRect( hiz, minX, minY, maxX, maxY );
+    float maxDepth = std::max( std::max( hiz.Load( rect.Mip, rect.X0, rect.Y0 ), hiz.Load( rect.Mip, rect.X1, rect.Y0 ) ),
+                               std::max( hiz.Load( rect.Mip, rect.X0, rect.Y1 ), hiz.Load( rect.Mip, rect.X1, rect.Y1 ) ) );
+
+    // z / w > maxDepth, without the divide (w > 0).
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+        if ( !( clipZ[i] > maxDepth * clipW[i] ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CullingMath::Result CullingMath::Cull( const View& frustumView, const View& hizView, const InstanceBounds& bounds, const HiZPyramid* hiz )
+{
+    if ( !IsInFrustum( frustumView, bounds ) )
+    {
+        return Result::FrustumCulled;
+    }
+
+    if ( hiz && IsOccluded( hizView, bounds, *hiz ) )
+    {
+        return Result::Occluded;
+    }
+
+    return Result::Visible;
+}
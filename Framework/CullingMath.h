@@ -0,0 +1,125 @@
+#pragma once
+
+// CPU reference of the GPU instance culling (Shaders/Culling/CullInstances_CS.hlsl, Shaders/Culling/BuildHiZ_CS.hlsl).
+// --
+// Frustum test: world-space AABB against the 6 planes of the view-projection matrix.
+// Occlusion test: the screen rectangle of the AABB against a max-depth (Hi-Z) pyramid of a depth buffer (LESS, 1 = far).
+// The rectangle spans at most 2x2 texels of the selected mip, and the box is occluded if all its corners are behind
+// the farthest depth of those texels.
+// --
+// The shaders perform the same operations in the same order. Only operations that D3D requires to be correctly
+// rounded are used for the decisions (add, mul, min/max, compares - the shaders are `precise`, so no mad is fused).
+// The perspective divide (2.5 ULP on the GPU) is only used as a first guess: the texel of a corner is settled with
+// exact compares against the texel edges, and the depth test compares z against depth * w.
+// Cone test (clusters): backfacing if the view direction from the camera to any point of the bounding sphere is within
+// the cone axis +- (90 degrees - the cone angle). Squared, so it needs no square root.
+// The results match the GPU bit for bit, as long as the inputs are not denormal (the GPU flushes them).
+// No device is used, the culling can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API CullingMath
+{
+public:
+    // World-space AABB of an instance. Matches the HLSL struct (32 bytes).
+    struct InstanceBounds
+    {
+        DirectX::XMFLOAT3   Center;
+        float               _Padding0;
+        DirectX::XMFLOAT3   Extents;
+        float               _Padding1;
+    };
+
+    // World-space bounding sphere and normal cone of a cluster (see MeshletBuilder::Bounds). Matches the HLSL struct
+    // (32 bytes). Axis = 0 and Cutoff = 1 for no cone.
+    struct InstanceCone
+    {
+        DirectX::XMFLOAT3   Center;
+        float               Radius;
+        DirectX::XMFLOAT3   Axis;
+        float               Cutoff;     // Sine of the cone angle.
+    };
+
+    // Matches the HLSL struct (160 bytes).
+    struct View
+    {
+        // Rows of the view-projection matrix (row vectors: clip = float4(p, 1) * ViewProjection).
+        DirectX::XMFLOAT4   ViewProjection[4];
+        // Left, right, bottom, top, near, far. Normals point inside, not normalized.
+        DirectX::XMFLOAT4   FrustumPlanes[6];
+    };
+
+    // Max-depth pyramid. Mip 0 is half the size of the depth buffer (rounded down, at least 1 texel),
+    // every mip is half the size of the previous one, down to 1x1.
+    struct HiZPyramid
+    {
+        uint32_t                        DepthWidth = 0;
+        uint32_t                        DepthHeight = 0;
+        // 2 / DepthWidth, 2 / DepthHeight - the size of a depth texel in NDC. Passed as-is to the GPU.
+        DirectX::XMFLOAT2               DepthTexelSize = { 0.0f, 0.0f };
+
+        uint32_t                        Width = 0;
+        uint32_t                        Height = 0;
+        std::vector<std::vector<float>> Mips;
+
+        uint32_t GetNumMips() const { return static_cast<uint32_t>( Mips.size() ); }
+        uint32_t GetMipWidth( uint32_t mip ) const { return std::max<uint32_t>( 1, Width >> mip ); }
+        uint32_t GetMipHeight( uint32_t mip ) const { return std::max<uint32_t>( 1, Height >> mip ); }
+        float    Load( uint32_t mip, uint32_t x, uint32_t y ) const { return Mips[mip][y * GetMipWidth( mip ) + x]; }
+    };
+
+    // The texels of the pyramid read by an occlusion test: [X0, X1] x [Y0, Y1] of Mip, at most 2x2.
+    struct HiZRect
+    {
+        uint32_t    Mip;
+        uint32_t    X0;
+        uint32_t    Y0;
+        uint32_t    X1;
+        uint32_t    Y1;
+    };
+
+    enum class Result
+    {
+        FrustumCulled,
+        Occluded,
+        Visible,
+    };
+
+    static View MakeView( const DirectX::XMFLOAT4X4& viewProjection );
+
+    // Size of the pyramid of a depth buffer.
+    static void GetHiZSize( uint32_t depthWidth, uint32_t depthHeight, uint32_t& width, uint32_t& height, uint32_t& numMips );
+
+    // The 2x2 reduction of BuildHiZ_CS: texel (x, y) of the destination is the max of the source texels [2x, 2x+1]^2.
+    // The last row/column also takes the extra source row/column of an odd size.
+    static float ReduceTexel( const std::vector<float>& src, uint32_t srcWidth, uint32_t srcHeight,
+                              uint32_t dstWidth, uint32_t dstHeight, uint32_t x, uint32_t y );
+
+    static HiZPyramid BuildHiZ( const std::vector<float>& depth, uint32_t depthWidth, uint32_t depthHeight );
+
+    static bool IsInFrustum( const View& view, const InstanceBounds& bounds );
+
+    // All the triangles of the cluster face away from the camera (front faces clockwise).
+    static bool IsBackfacing( const InstanceCone& cone, const DirectX::XMFLOAT3& cameraPosition );
+
+    // The texels read for the rectangle of depth texels [minX, maxX] x [minY, maxY]: in the first mip whose texels
+    // are larger than the extent of the rectangle (in mip 0 texels), so it spans at most 2x2 of them (or the last mip).
+    static HiZRect GetHiZRect( const HiZPyramid& hiz, uint32_t minX, uint32_t minY, uint32_t maxX, uint32_t maxY );
+
+    // The pyramid must have been built with the depth buffer rendered with `view`.
+    // Boxes that cross the camera plane (w <= 0) are never occluded.
+    static bool IsOccluded( const View& view, const InstanceBounds& bounds, const HiZPyramid& hiz );
+
+    // @param hiz - nullptr for the frustum test only.
+    static Result Cull( const View& frustumView, const View& hizView, const InstanceBounds& bounds, const HiZPyramid* hiz );
+
+    // The depth texel column of a clip-space position: the largest p in [0, size-1] with c >= (p * texelSize - 1) * w.
+    // (Use -y for the row: NDC y points up, texel rows go down.)
+    static uint32_t GetTexelIndex( float c, float w, float texelSize, uint32_t size );
+};
@@ -0,0 +1,268 @@
+#include "FrameGraph.h"
+
+#include <Framework/Application.h>
+#include <Framework/CommandList.h>
+#include <Framework/CommandQueue.h>
+
+#include <Framework/Material/Resource.h>
+#include <Framework/Material/Texture.h>
+
+#include <cassert>
+
+
+// =====================================================================================
+//										PASS CONTEXT
+// =====================================================================================
+
+
+FrameGraph::PassContext::PassContext(std::shared_ptr<CommandQueue> commandQueue, std::shared_ptr<CommandList> commandList, const wchar_t* passName)
+    : m_CommandQueue(commandQueue)
+    , m_CommandList(commandList)
+    , m_PassName(passName)
+{}
+
+void FrameGraph::PassContext::ExecuteCommandLists(const std::vector<std::shared_ptr<CommandList>>& commandLists)
+{
+    PixProfiler& profiler = Application::Get().GetPixProfiler();
+
+    // The pass marker can't stay open on a closed command list.
+    profiler.PopMarker(m_CommandList->GetGraphicsCommandList().Get());
+
+    std::vector<std::shared_ptr<CommandList>> orderedCommandLists;
+    orderedCommandLists.reserve(commandLists.size() + 1);
+    orderedCommandLists.push_back(m_CommandList);
+    orderedCommandLists.insert(orderedCommandLists.end(), commandLists.begin(), commandLists.end());
+
+    m_CommandQueue->ExecuteCommandLists(orderedCommandLists);
+
+    m_CommandList = m_CommandQueue->GetCommandList();
+    profiler.PushMarker(m_CommandList->GetGraphicsCommandList().Get(), m_PassName);
+}
+
+
+// =====================================================================================
+//										DECLARATION
+// =====================================================================================
+
+
+FrameGraph::FrameGraph()
+{}
+
+FrameGraph::~FrameGraph()
+{}
+
+void FrameGraph::Reset()
+{
+    m_Compiler.Reset();
+    m_PassExecuteFuncs.clear();
+    m_Resources.clear();
+    m_TransientResourcesAllocated = false;
+}
+
+FrameGraph::ResourceHandle FrameGraph::ImportResource(const std::wstring& name, const Resource* resource, D3D12_RESOURCE_STATES initialState)
+{
+    ResourceNode node = {};
+    node.pResource = resource;
+    m_Resources.push_back(node);
+
+    return m_Compiler.ImportResource(name, initialState);
+}
+
+FrameGraph::ResourceHandle FrameGraph::CreateTexture(const std::wstring& name, const D3D12_RESOURCE_DESC& resourceDesc, const D3D12_CLEAR_VALUE* clearValue, TextureUsage textureUsage)
+{
+    ResourceNode node = {};
+    node.pResource = nullptr;
+    node.TransientDesc.Name = name;
+    node.TransientDesc.ResourceDesc = resourceDesc;
+    node.TransientDesc.HasClearValue = (clearValue != nullptr);
+    if (clearValue)
+    {
+        node.TransientDesc.ClearValue = *clearValue;
+    }
+    node.TransientDesc.Usage = textureUsage;
+    m_Resources.push_back(node);
+
+    return m_Compiler.CreateTransientResource(name);
+}
+
+void FrameGraph::MarkOutput(ResourceHandle resource)
+{
+    m_Compiler.MarkOutput(resource);
+}
+
+FrameGraph::PassHandle FrameGraph::AddPass(const std::wstring& name, QueueType queue, ExecuteFunc execute)
+{
+    m_PassExecuteFuncs.push_back(std::move(execute));
+
+    return m_Compiler.AddPass(name, queue);
+}
+
+void FrameGraph::SetNeverCull(PassHandle pass)
+{
+    m_Compiler.SetNeverCull(pass);
+}
+
+void FrameGraph::AddDependency(PassHandle pass, PassHandle dependency)
+{
+    m_Compiler.AddDependency(pass, dependency);
+}
+
+void FrameGraph::Read(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state)
+{
+    m_Compiler.Read(pass, resource, state);
+}
+
+void FrameGraph::Write(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state)
+{
+    m_Compiler.Write(pass, resource, state);
+}
+
+
+// =====================================================================================
+//										COMPILATION
+// =====================================================================================
+
+
+void FrameGraph::Compile()
+{
+    m_TransientResourcesAllocated = false;
+
+    m_Compiler.Compile();
+}
+
+
+// =====================================================================================
+//										EXECUTION
+// =====================================================================================
+
+
+void FrameGraph::AllocateTransientResources()
+{
+    std::vector<TransientResourceAllocator::TextureDesc> descs(m_Compiler.GetStats().NumTransientTextures);
+    for (ResourceHandle resource = 0; resource < m_Resources.size(); ++resource)
+    {
+        const auto& lifetime = m_Compiler.GetLifetime(resource);
+        if (lifetime.TransientIndex == FrameGraphCompiler::InvalidTransientIndex)
+            continue;
+
+        auto& desc = descs[lifetime.TransientIndex];
+        desc = m_Resources[resource].TransientDesc;
+        desc.InitialState = m_Compiler.GetInitialState(resource);
+        desc.FirstPass = lifetime.FirstPass;
+        desc.LastPass = lifetime.LastPass;
+    }
+
+    m_TransientResourceAllocator.Allocate(descs);
+
+    for (ResourceHandle resource = 0; resource < m_Resources.size(); ++resource)
+    {
+        const auto& lifetime = m_Compiler.GetLifetime(resource);
+        if (lifetime.TransientIndex != FrameGraphCompiler::InvalidTransientIndex)
+            m_Resources[resource].pResource = m_TransientResourceAllocator.GetTexture(lifetime.TransientIndex).get();
+    }
+
+    m_TransientResourcesAllocated = true;
+}
+
+void FrameGraph::Execute()
+{
+    auto& app = Application::Get();
+    PixProfiler& profiler = app.GetPixProfiler();
+
+    if (!m_TransientResourcesAllocated)
+    {
+        AllocateTransientResources();
+    }
+
+    auto issueBarriers = [this](CommandList& commandList, const std::vector<Barrier>& barriers)
+    {
+        for (const auto& barrier : barriers)
+        {
+            const Resource* resource = m_Resources[barrier.Resource].pResource;
+            if (resource == nullptr)
+                continue;
+
+            if (barrier.BarrierType == Barrier::Type::Transition)
+                commandList.TransitionBarrier(*resource, barrier.StateAfter);
+            else
+                commandList.UAVBarrier(*resource);
+        }
+
+        // One ResourceBarrier call for the whole set.
+        commandList.FlushResourceBarriers();
+    };
+
+    // The transient textures that take over aliased memory, per pass (in the execution order).
+    std::vector<std::vector<ResourceHandle>> aliasedResources(m_Compiler.GetExecutionOrder().size());
+    for (ResourceHandle resource = 0; resource < m_Resources.size(); ++resource)
+    {
+        const auto& lifetime = m_Compiler.GetLifetime(resource);
+        if (lifetime.TransientIndex != FrameGraphCompiler::InvalidTransientIndex && m_TransientResourceAllocator.IsAliased(lifetime.TransientIndex))
+        {
+            aliasedResources[lifetime.FirstPass].push_back(resource);
+        }
+    }
+
+    uint32_t orderIndex = 0;
+
+    for (const auto& batch : m_Compiler.GetBatches())
+    {
+        auto queueType = (batch.Queue == QueueType::Direct) ? D3D12_COMMAND_LIST_TYPE_DIRECT : D3D12_COMMAND_LIST_TYPE_COMPUTE;
+        auto otherQueueType = (batch.Queue == QueueType::Direct) ? D3D12_COMMAND_LIST_TYPE_COMPUTE : D3D12_COMMAND_LIST_TYPE_DIRECT;
+
+        auto commandQueue = app.GetCommandQueue(queueType);
+
+        // The batches of the other queue were already submitted, so waiting for its last fence covers them.
+        if (!batch.WaitForBatches.empty())
+        {
+            commandQueue->Wait(*app.GetCommandQueue(otherQueueType));
+        }
+
+        PassContext context(commandQueue, commandQueue->GetCommandList(), nullptr);
+
+        for (auto passHandle : batch.Passes)
+        {
+            context.m_PassName = m_Compiler.GetPassName(passHandle).c_str();
+            profiler.PushMarker(context.m_CommandList->GetGraphicsCommandList().Get(), context.m_PassName);
+
+            // Any of the textures sharing the memory may be the previous one (also from the previous frame).
+            for (auto resource : aliasedResources[orderIndex++])
+            {
+                context.m_CommandList->AliasingBarrier(nullptr, m_Resources[resource].pResource->GetD3D12Resource());
+            }
+            issueBarriers(*context.m_CommandList, m_Compiler.GetPassBarriers(passHandle));
+
+            if (m_PassExecuteFuncs[passHandle])
+            {
+                m_PassExecuteFuncs[passHandle](context);
+            }
+
+            const auto& postBarriers = m_Compiler.GetPassPostBarriers(passHandle);
+            if (!postBarriers.empty())
+            {
+                issueBarriers(*context.m_CommandList, postBarriers);
+            }
+
+            profiler.PopMarker(context.m_CommandList->GetGraphicsCommandList().Get());
+        }
+
+        commandQueue->ExecuteCommandList(context.m_CommandList);
+    }
+}
+
+
+// =====================================================================================
+//										RESULTS
+// =====================================================================================
+
+
+std::shared_ptr<Texture> FrameGraph::GetTexture(ResourceHandle resource) const
+{
+    assert(resource < m_Resources.size());
+
+    const auto& lifetime = m_Compiler.GetLifetime(resource);
+    if (!m_TransientResourcesAllocated || lifetime.TransientIndex == FrameGraphCompiler::InvalidTransientIndex)
+        return nullptr;
+
+    return m_TransientResourceAllocator.GetTexture(lifetime.TransientIndex);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+// The FrameGraph describes a frame as a list of passes that declare which resources they read and write.
+// --
+// Compile() is done by the FrameGraphCompiler, on the declarations only (no device or command list is touched):
+// dependencies, culling, execution order, lifetimes of the transient textures, barriers and queue batches.
+// --
+// AllocateTransientResources() places the transient textures in one heap, textures that are never alive at the
+// same time share memory. A transient texture is created in the state of its first access and is returned to it
+// after its last access, so no transition is recorded before the aliasing barrier that activates it.
+// --
+// Execute() records the batches on the Direct / Compute command queues. The barriers are issued through
+// the CommandList (so the ResourceStateTracker still resolves the real before-states).
+
+#include "FrameGraphCompiler.h"
+#include "TransientResourceAllocator.h"
+
+#include <Framework/3RD_Party/Defines.h>
+#include <Framework/Material/TextureUsage.h>
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CommandList;
+class CommandQueue;
+class Resource;
+class Texture;
+
+class DX12_FW_API FrameGraph
+{
+public:
+    using ResourceHandle = FrameGraphCompiler::ResourceHandle;
+    using PassHandle     = FrameGraphCompiler::PassHandle;
+    using QueueType      = FrameGraphCompiler::QueueType;
+    using Barrier        = FrameGraphCompiler::Barrier;
+    using Batch          = FrameGraphCompiler::Batch;
+    using Stats          = FrameGraphCompiler::Stats;
+
+    // Given to the pass while it's being recorded.
+    class DX12_FW_API PassContext
+    {
+    public:
+        CommandList&  GetCommandList() { return *m_CommandList; }
+        CommandQueue& GetCommandQueue() { return *m_CommandQueue; }
+
+        // Execute the pass command list followed by the given command lists (of the same queue, in order)
+        // and continue recording on a new command list. Used by the passes that record in parallel.
+        void ExecuteCommandLists(const std::vector<std::shared_ptr<CommandList>>& commandLists);
+
+    private:
+        friend class FrameGraph;
+
+        PassContext(std::shared_ptr<CommandQueue> commandQueue, std::shared_ptr<CommandList> commandList, const wchar_t* passName);
+
+        std::shared_ptr<CommandQueue>   m_CommandQueue;
+        std::shared_ptr<CommandList>    m_CommandList;
+        const wchar_t*                  m_PassName;
+    };
+
+    using ExecuteFunc = std::function<void(PassContext& context)>;
+
+public:
+    FrameGraph();
+    ~FrameGraph();
+
+    // Remove all the passes and resources (the graph is rebuilt every frame).
+    void Reset();
+
+    // ----- DECLARATION -----
+
+    // Register a resource used by the graph.
+    // @param resource - can be null, Execute() skips the barriers of such resources.
+    // @param initialState - the state the resource is in when the graph starts. If unknown, the first
+    //        access always produces a transition (the ResourceStateTracker drops it if it's redundant).
+    ResourceHandle ImportResource(const std::wstring& name, const Resource* resource, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON);
+
+    // Declare a transient texture: its memory is owned by the graph and can be shared with the transient textures
+    // that are not alive at the same time. The first pass that writes it must clear (or discard) it.
+    // Transient textures used on the compute queue are never aliased (the queues run concurrently).
+    ResourceHandle CreateTexture(const std::wstring& name, const D3D12_RESOURCE_DESC& resourceDesc, const D3D12_CLEAR_VALUE* clearValue = nullptr,
+        TextureUsage textureUsage = TextureUsage::RenderTarget);
+
+    // Outputs are the roots of the culling - e.g. the swap chain back buffer.
+    void MarkOutput(ResourceHandle resource);
+
+    PassHandle AddPass(const std::wstring& name, QueueType queue, ExecuteFunc execute);
+
+    // A pass that must never be culled (e.g. it has side effects outside of the graph).
+    void SetNeverCull(PassHandle pass);
+
+    // The pass runs after the dependency and keeps it alive, for the data the resources don't express.
+    void AddDependency(PassHandle pass, PassHandle dependency);
+
+    // Declare the accesses of a pass. The order of the declarations (of the passes) defines the data flow.
+    void Read(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state);
+    void Write(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state);
+
+    // ----- COMPILATION -----
+
+    // Throws std::exception for invalid declarations (a cycle, or a graphics only state on the compute queue).
+    void Compile();
+
+    // ----- EXECUTION -----
+
+    // Create (or reuse) the memory of the transient textures of the compiled graph.
+    // Called by Execute() if needed, call it before to access the textures outside of the passes.
+    void AllocateTransientResources();
+
+    // Record and submit the compiled batches.
+    void Execute();
+
+    // ----- RESULTS -----
+
+    const FrameGraphCompiler&       GetCompiler() const { return m_Compiler; }
+
+    const std::vector<PassHandle>&  GetExecutionOrder() const { return m_Compiler.GetExecutionOrder(); }
+    const std::vector<Batch>&       GetBatches() const { return m_Compiler.GetBatches(); }
+    const std::vector<Barrier>&     GetPassBarriers(PassHandle pass) const { return m_Compiler.GetPassBarriers(pass); }
+    const std::vector<Barrier>&     GetPassPostBarriers(PassHandle pass) const { return m_Compiler.GetPassPostBarriers(pass); }
+    D3D12_RESOURCE_STATES           GetFinalState(ResourceHandle resource) const { return m_Compiler.GetFinalState(resource); }
+
+    bool                            IsPassCulled(PassHandle pass) const { return m_Compiler.IsPassCulled(pass); }
+    const std::wstring&             GetPassName(PassHandle pass) const { return m_Compiler.GetPassName(pass); }
+    const std::wstring&             GetResourceName(ResourceHandle resource) const { return m_Compiler.GetResourceName(resource); }
+    uint32_t                        GetNumPasses() const { return m_Compiler.GetNumPasses(); }
+    uint32_t                        GetNumResources() const { return m_Compiler.GetNumResources(); }
+
+    bool                            IsTransient(ResourceHandle resource) const { return m_Compiler.IsTransient(resource); }
+    // The texture of a transient resource (null until the transient resources are allocated, or if the resource is unused).
+    std::shared_ptr<Texture>        GetTexture(ResourceHandle resource) const;
+    const TransientResourceAllocator& GetTransientResourceAllocator() const { return m_TransientResourceAllocator; }
+
+    const Stats&                    GetStats() const { return m_Compiler.GetStats(); }
+
+private:
+    // The device side of a resource, the compiler only knows its declaration.
+    struct ResourceNode
+    {
+        const Resource*                         pResource;
+        // Transient textures (the state and the lifetime are set by the compiler).
+        TransientResourceAllocator::TextureDesc TransientDesc;
+    };
+
+    FrameGraphCompiler          m_Compiler;
+    std::vector<ExecuteFunc>    m_PassExecuteFuncs;     // Per pass.
+    std::vector<ResourceNode>   m_Resources;            // Per resource.
+
+    TransientResourceAllocator  m_TransientResourceAllocator;
+    bool                        m_TransientResourcesAllocated = false;
+};
@@ -0,0 +1,663 @@
+#include "FrameGraphCompiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+
+namespace
+{
+    const FrameGraphCompiler::PassHandle InvalidPass = UINT32_MAX;
+
+    void AddUnique(std::vector<FrameGraphCompiler::PassHandle>& passes, FrameGraphCompiler::PassHandle pass)
+    {
+        if (std::find(passes.begin(), passes.end(), pass) == passes.end())
+        {
+            passes.push_back(pass);
+        }
+    }
+}
+
+
+// =====================================================================================
+//										DECLARATION
+// =====================================================================================
+
+
+FrameGraphCompiler::FrameGraphCompiler()
+{}
+
+FrameGraphCompiler::~FrameGraphCompiler()
+{}
+
+void FrameGraphCompiler::Reset()
+{
+    m_Passes.clear();
+    m_Resources.clear();
+    m_ExecutionOrder.clear();
+    m_Batches.clear();
+    m_Stats = Stats();
+}
+
+FrameGraphCompiler::ResourceHandle FrameGraphCompiler::ImportResource(const std::wstring& name, D3D12_RESOURCE_STATES initialState)
+{
+    ResourceNode node;
+    node.Name = name;
+    node.InitialState = initialState;
+    node.FinalState = initialState;
+
+    m_Resources.push_back(node);
+
+    return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+FrameGraphCompiler::ResourceHandle FrameGraphCompiler::CreateTransientResource(const std::wstring& name)
+{
+    // The state is set by Compile() (the state of the first access).
+    ResourceHandle resource = ImportResource(name);
+    m_Resources[resource].Transient = true;
+
+    return resource;
+}
+
+void FrameGraphCompiler::MarkOutput(ResourceHandle resource)
+{
+    assert(resource < m_Resources.size());
+    m_Resources[resource].Output = true;
+}
+
+FrameGraphCompiler::PassHandle FrameGraphCompiler::AddPass(const std::wstring& name, QueueType queue)
+{
+    PassNode node;
+    node.Name = name;
+    node.Queue = queue;
+
+    m_Passes.push_back(std::move(node));
+
+    return static_cast<PassHandle>(m_Passes.size() - 1);
+}
+
+void FrameGraphCompiler::SetNeverCull(PassHandle pass)
+{
+    assert(pass < m_Passes.size());
+    m_Passes[pass].NeverCull = true;
+}
+
+void FrameGraphCompiler::AddDependency(PassHandle pass, PassHandle dependency)
+{
+    assert(pass < m_Passes.size() && dependency < m_Passes.size() && pass != dependency);
+    AddUnique(m_Passes[pass].ExplicitDependencies, dependency);
+}
+
+void FrameGraphCompiler::Read(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state)
+{
+    AddAccess(pass, resource, state, false);
+}
+
+void FrameGraphCompiler::Write(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state)
+{
+    AddAccess(pass, resource, state, true);
+}
+
+void FrameGraphCompiler::AddAccess(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state, bool write)
+{
+    assert(pass < m_Passes.size() && resource < m_Resources.size());
+
+    auto& accesses = m_Passes[pass].Accesses;
+    auto iter = std::find_if(accesses.begin(), accesses.end(), [resource](const ResourceAccess& access) { return access.Resource == resource; });
+
+    if (iter == accesses.end())
+    {
+        accesses.push_back({ resource, state, write });
+        return;
+    }
+
+    // Several accesses of the same resource by one pass are merged in a single one.
+    if (write)
+    {
+        if (iter->Write && iter->State != state)
+        {
+            throw std::exception("FrameGraph: a pass can't write a resource in two different states.");
+        }
+
+        iter->Write = true;
+        iter->State = state;
+    }
+    else if (!iter->Write)
+    {
+        iter->State |= state;
+    }
+}
+
+
+// =====================================================================================
+//										COMPILATION
+// =====================================================================================
+
+
+void FrameGraphCompiler::Compile()
+{
+    m_ExecutionOrder.clear();
+    m_Batches.clear();
+    m_Stats = Stats();
+
+    for (auto& pass : m_Passes)
+    {
+        pass.DataDependencies.clear();
+        pass.OrderDependencies.clear();
+        pass.Barriers.clear();
+        pass.PostBarriers.clear();
+        pass.Culled = false;
+        pass.Batch = 0;
+
+        if (pass.Queue == QueueType::Compute)
+        {
+            for (const auto& access : pass.Accesses)
+            {
+                if (IsGraphicsOnlyState(access.State))
+                {
+                    throw std::exception("FrameGraph: a compute pass uses a graphics only resource state.");
+                }
+            }
+        }
+    }
+
+    BuildDependencies();
+    CullPasses();
+    SortPasses();
+    ComputeLifetimes();
+    ComputeBarriers();
+    BuildBatches();
+
+    m_Stats.NumPasses = static_cast<uint32_t>(m_Passes.size());
+    m_Stats.NumCulledPasses = static_cast<uint32_t>(m_Passes.size() - m_ExecutionOrder.size());
+    m_Stats.NumBatches = static_cast<uint32_t>(m_Batches.size());
+}
+
+void FrameGraphCompiler::BuildDependencies()
+{
+    std::vector<PassHandle>              lastWriter(m_Resources.size(), InvalidPass);
+    std::vector<std::vector<PassHandle>> readersSinceLastWrite(m_Resources.size());
+
+    for (PassHandle passHandle = 0; passHandle < m_Passes.size(); ++passHandle)
+    {
+        auto& pass = m_Passes[passHandle];
+
+        pass.DataDependencies = pass.ExplicitDependencies;
+
+        for (const auto& access : pass.Accesses)
+        {
+            // Read-after-write or write-after-write: the previous writer produces the data of this pass.
+            if (lastWriter[access.Resource] != InvalidPass)
+            {
+                AddUnique(pass.DataDependencies, lastWriter[access.Resource]);
+            }
+
+            // Write-after-read: the readers only have to run before this pass.
+            if (access.Write)
+            {
+                for (auto reader : readersSinceLastWrite[access.Resource])
+                {
+                    if (reader != passHandle)
+                    {
+                        AddUnique(pass.OrderDependencies, reader);
+                    }
+                }
+            }
+        }
+
+        for (const auto& access : pass.Accesses)
+        {
+            if (access.Write)
+            {
+                lastWriter[access.Resource] = passHandle;
+                readersSinceLastWrite[access.Resource].clear();
+            }
+            else
+            {
+                readersSinceLastWrite[access.Resource].push_back(passHandle);
+            }
+        }
+    }
+}
+
+void FrameGraphCompiler::CullPasses()
+{
+    std::vector<bool>       needed(m_Passes.size(), false);
+    std::vector<PassHandle> stack;
+
+    for (PassHandle passHandle = 0; passHandle < m_Passes.size(); ++passHandle)
+    {
+        const auto& pass = m_Passes[passHandle];
+
+        bool writesOutput = std::any_of(pass.Accesses.begin(), pass.Accesses.end(),
+            [this](const ResourceAccess& access) { return access.Write && m_Resources[access.Resource].Output; });
+
+        if (pass.NeverCull || writesOutput)
+        {
+            needed[passHandle] = true;
+            stack.push_back(passHandle);
+        }
+    }
+
+    // Everything the roots (transitively) consume is needed.
+    while (!stack.empty())
+    {
+        PassHandle passHandle = stack.back();
+        stack.pop_back();
+
+        for (auto dependency : m_Passes[passHandle].DataDependencies)
+        {
+            if (!needed[dependency])
+            {
+                needed[dependency] = true;
+                stack.push_back(dependency);
+            }
+        }
+    }
+
+    for (PassHandle passHandle = 0; passHandle < m_Passes.size(); ++passHandle)
+    {
+        m_Passes[passHandle].Culled = !needed[passHandle];
+    }
+}
+
+void FrameGraphCompiler::SortPasses()
+{
+    std::vector<uint32_t>                inDegree(m_Passes.size(), 0);
+    std::vector<std::vector<PassHandle>> dependents(m_Passes.size());
+
+    uint32_t numPasses = 0;
+    for (PassHandle passHandle = 0; passHandle < m_Passes.size(); ++passHandle)
+    {
+        const auto& pass = m_Passes[passHandle];
+        if (pass.Culled)
+            continue;
+
+        ++numPasses;
+
+        auto addEdge = [&](PassHandle dependency)
+        {
+            if (m_Passes[dependency].Culled)
+                return;
+
+            // A pass can be both a data and an order dependency, count the edge once.
+            auto& edges = dependents[dependency];
+            if (std::find(edges.begin(), edges.end(), passHandle) == edges.end())
+            {
+                edges.push_back(passHandle);
+                ++inDegree[passHandle];
+            }
+        };
+
+        for (auto dependency : pass.DataDependencies)
+            addEdge(dependency);
+        for (auto dependency : pass.OrderDependencies)
+            addEdge(dependency);
+    }
+
+    // Ready passes, kept sorted by the declaration order.
+    std::vector<PassHandle> ready;
+    for (PassHandle passHandle = 0; passHandle < m_Passes.size(); ++passHandle)
+    {
+        if (!m_Passes[passHandle].Culled && inDegree[passHandle] == 0)
+            ready.push_back(passHandle);
+    }
+
+    m_ExecutionOrder.reserve(numPasses);
+
+    while (!ready.empty())
+    {
+        // Prefer a pass on the same queue as the last one, to keep the batches long.
+        auto next = ready.begin();
+        if (!m_ExecutionOrder.empty())
+        {
+            QueueType currentQueue = m_Passes[m_ExecutionOrder.back()].Queue;
+            auto sameQueue = std::find_if(ready.begin(), ready.end(), [&](PassHandle pass) { return m_Passes[pass].Queue == currentQueue; });
+            if (sameQueue != ready.end())
+                next = sameQueue;
+        }
+
+        PassHandle passHandle = *next;
+        ready.erase(next);
+        m_ExecutionOrder.push_back(passHandle);
+
+        for (auto dependent : dependents[passHandle])
+        {
+            if (--inDegree[dependent] == 0)
+            {
+                ready.insert(std::upper_bound(ready.begin(), ready.end(), dependent), dependent);
+            }
+        }
+    }
+
+    if (m_ExecutionOrder.size() != numPasses)
+    {
+        throw std::exception("FrameGraph: the pass dependencies contain a cycle.");
+    }
+}
+
+void FrameGraphCompiler::ComputeLifetimes()
+{
+    uint32_t lastOrderIndex = static_cast<uint32_t>(m_ExecutionOrder.size()) - 1;
+
+    for (auto& resource : m_Resources)
+    {
+        resource.TransientLifetime = Lifetime();
+    }
+
+    for (uint32_t orderIndex = 0; orderIndex < m_ExecutionOrder.size(); ++orderIndex)
+    {
+        const auto& pass = m_Passes[m_ExecutionOrder[orderIndex]];
+
+        for (const auto& access : pass.Accesses)
+        {
+            auto& resource = m_Resources[access.Resource];
+            if (!resource.Transient)
+                continue;
+
+            auto& lifetime = resource.TransientLifetime;
+
+            if (lifetime.TransientIndex == InvalidTransientIndex)
+            {
+                lifetime.TransientIndex = m_Stats.NumTransientTextures++;
+                lifetime.FirstPass = orderIndex;
+                lifetime.LastPass = orderIndex;
+                resource.InitialState = access.State;
+            }
+            lifetime.LastPass = (std::max)(lifetime.LastPass, orderIndex);
+
+            // The passes of the other queue can run at the same time: keep the resource alive for the whole frame
+            // (it never shares memory then).
+            if (pass.Queue == QueueType::Compute)
+            {
+                lifetime.FirstPass = 0;
+                lifetime.LastPass = lastOrderIndex;
+            }
+        }
+    }
+}
+
+void FrameGraphCompiler::ComputeBarriers()
+{
+    std::vector<D3D12_RESOURCE_STATES> currentState(m_Resources.size());
+    std::vector<bool>                  lastAccessIsUAVWrite(m_Resources.size(), false);
+    // The last pass on the Direct queue that used the resource (for the transitions the compute queue can't do).
+    std::vector<PassHandle>            lastDirectPass(m_Resources.size(), InvalidPass);
+    std::vector<PassHandle>            lastPass(m_Resources.size(), InvalidPass);
+
+    for (ResourceHandle resource = 0; resource < m_Resources.size(); ++resource)
+    {
+        currentState[resource] = m_Resources[resource].InitialState;
+    }
+
+    // Find the access of a pass to a resource.
+    auto findAccess = [this](PassHandle passHandle, ResourceHandle resource) -> const ResourceAccess*
+    {
+        for (const auto& access : m_Passes[passHandle].Accesses)
+        {
+            if (access.Resource == resource)
+                return &access;
+        }
+        return nullptr;
+    };
+
+    for (size_t orderIndex = 0; orderIndex < m_ExecutionOrder.size(); ++orderIndex)
+    {
+        PassHandle passHandle = m_ExecutionOrder[orderIndex];
+        auto& pass = m_Passes[passHandle];
+
+        for (const auto& access : pass.Accesses)
+        {
+            ResourceHandle resource = access.Resource;
+            D3D12_RESOURCE_STATES stateBefore = currentState[resource];
+            D3D12_RESOURCE_STATES stateAfter = access.State;
+
+            bool needsTransition = false;
+
+            if (access.Write)
+            {
+                if (stateBefore != stateAfter)
+                {
+                    needsTransition = true;
+                }
+                else if (stateAfter == D3D12_RESOURCE_STATE_UNORDERED_ACCESS && lastAccessIsUAVWrite[resource])
+                {
+                    pass.Barriers.push_back({ Barrier::Type::UAV, resource, stateBefore, stateAfter });
+                }
+
+                lastAccessIsUAVWrite[resource] = (stateAfter == D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+            }
+            else
+            {
+                // Already in a read state that covers this read (merged by an earlier transition).
+                bool covered = IsReadOnlyState(stateBefore) && (stateBefore & stateAfter) == stateAfter;
+
+                if (!covered)
+                {
+                    needsTransition = true;
+
+                    // Merge the following reads (until the next write, on the same queue) into one transition.
+                    for (size_t nextIndex = orderIndex + 1; nextIndex < m_ExecutionOrder.size(); ++nextIndex)
+                    {
+                        PassHandle nextPass = m_ExecutionOrder[nextIndex];
+                        if (m_Passes[nextPass].Queue != pass.Queue)
+                            break;
+
+                        const ResourceAccess* nextAccess = findAccess(nextPass, resource);
+                        if (nextAccess == nullptr)
+                            continue;
+                        if (nextAccess->Write)
+                            break;
+
+                        stateAfter |= nextAccess->State;
+                    }
+                }
+
+                lastAccessIsUAVWrite[resource] = false;
+            }
+
+            if (needsTransition)
+            {
+                Barrier barrier = { Barrier::Type::Transition, resource, stateBefore, stateAfter };
+
+                // The compute queue can't transition a resource out of a graphics only state:
+                // do it at the end of the last Direct pass that used the resource.
+                if (pass.Queue == QueueType::Compute && IsGraphicsOnlyState(stateBefore))
+                {
+                    if (lastDirectPass[resource] == InvalidPass)
+                    {
+                        throw std::exception("FrameGraph: a resource enters the graph in a graphics only state and is first used by a compute pass.");
+                    }
+
+                    m_Passes[lastDirectPass[resource]].PostBarriers.push_back(barrier);
+                }
+                else
+                {
+                    pass.Barriers.push_back(barrier);
+                }
+
+                currentState[resource] = stateAfter;
+            }
+
+            if (pass.Queue == QueueType::Direct)
+            {
+                lastDirectPass[resource] = passHandle;
+            }
+            lastPass[resource] = passHandle;
+        }
+    }
+
+    // Return the transient resources to the state they are created in, the next frame starts from there.
+    for (ResourceHandle resource = 0; resource < m_Resources.size(); ++resource)
+    {
+        const auto& node = m_Resources[resource];
+        if (node.TransientLifetime.TransientIndex == InvalidTransientIndex || currentState[resource] == node.InitialState)
+            continue;
+
+        auto& pass = m_Passes[lastPass[resource]];
+        if (pass.Queue == QueueType::Compute && (IsGraphicsOnlyState(currentState[resource]) || IsGraphicsOnlyState(node.InitialState)))
+        {
+            throw std::exception("FrameGraph: a transient texture last used by a compute pass must be first used in a compute compatible state.");
+        }
+
+        pass.PostBarriers.push_back({ Barrier::Type::Transition, resource, currentState[resource], node.InitialState });
+        currentState[resource] = node.InitialState;
+    }
+
+    for (const auto& pass : m_Passes)
+    {
+        m_Stats.NumBarriers += static_cast<uint32_t>(pass.Barriers.size() + pass.PostBarriers.size());
+    }
+
+    for (ResourceHandle resource = 0; resource < m_Resources.size(); ++resource)
+    {
+        m_Resources[resource].FinalState = currentState[resource];
+    }
+}
+
+void FrameGraphCompiler::BuildBatches()
+{
+    for (auto passHandle : m_ExecutionOrder)
+    {
+        auto& pass = m_Passes[passHandle];
+
+        if (m_Batches.empty() || m_Batches.back().Queue != pass.Queue)
+        {
+            Batch batch;
+            batch.Queue = pass.Queue;
+            m_Batches.push_back(batch);
+        }
+
+        uint32_t batchIndex = static_cast<uint32_t>(m_Batches.size() - 1);
+        auto& batch = m_Batches.back();
+
+        pass.Batch = batchIndex;
+        batch.Passes.push_back(passHandle);
+
+        // A dependency on the other queue needs a GPU wait. Waiting for the latest batch
+        // of the other queue covers the earlier ones.
+        auto addWait = [&](PassHandle dependency)
+        {
+            const auto& dependencyPass = m_Passes[dependency];
+            if (dependencyPass.Culled || dependencyPass.Queue == batch.Queue)
+                return;
+
+            if (batch.WaitForBatches.empty())
+                batch.WaitForBatches.push_back(dependencyPass.Batch);
+            else
+                batch.WaitForBatches[0] = std::max(batch.WaitForBatches[0], dependencyPass.Batch);
+        };
+
+        for (auto dependency : pass.DataDependencies)
+            addWait(dependency);
+        for (auto dependency : pass.OrderDependencies)
+            addWait(dependency);
+    }
+
+    for (const auto& batch : m_Batches)
+    {
+        m_Stats.NumCrossQueueWaits += static_cast<uint32_t>(batch.WaitForBatches.size());
+    }
+}
+
+
+// =====================================================================================
+//										RESULTS
+// =====================================================================================
+
+
+const std::vector<FrameGraphCompiler::Barrier>& FrameGraphCompiler::GetPassBarriers(PassHandle pass) const
+{
+    assert(pass < m_Passes.size());
+    return m_Passes[pass].Barriers;
+}
+
+const std::vector<FrameGraphCompiler::Barrier>& FrameGraphCompiler::GetPassPostBarriers(PassHandle pass) const
+{
+    assert(pass < m_Passes.size());
+    return m_Passes[pass].PostBarriers;
+}
+
+uint32_t FrameGraphCompiler::GetPassBatch(PassHandle pass) const
+{
+    assert(pass < m_Passes.size() && !m_Passes[pass].Culled);
+    return m_Passes[pass].Batch;
+}
+
+D3D12_RESOURCE_STATES FrameGraphCompiler::GetInitialState(ResourceHandle resource) const
+{
+    assert(resource < m_Resources.size());
+    return m_Resources[resource].InitialState;
+}
+
+D3D12_RESOURCE_STATES FrameGraphCompiler::GetFinalState(ResourceHandle resource) const
+{
+    assert(resource < m_Resources.size());
+    return m_Resources[resource].FinalState;
+}
+
+bool FrameGraphCompiler::IsPassCulled(PassHandle pass) const
+{
+    assert(pass < m_Passes.size());
+    return m_Passes[pass].Culled;
+}
+
+FrameGraphCompiler::QueueType FrameGraphCompiler::GetPassQueue(PassHandle pass) const
+{
+    assert(pass < m_Passes.size());
+    return m_Passes[pass].Queue;
+}
+
+const std::wstring& FrameGraphCompiler::GetPassName(PassHandle pass) const
+{
+    assert(pass < m_Passes.size());
+    return m_Passes[pass].Name;
+}
+
+const std::wstring& FrameGraphCompiler::GetResourceName(ResourceHandle resource) const
+{
+    assert(resource < m_Resources.size());
+    return m_Resources[resource].Name;
+}
+
+bool FrameGraphCompiler::IsTransient(ResourceHandle resource) const
+{
+    assert(resource < m_Resources.size());
+    return m_Resources[resource].Transient;
+}
+
+const FrameGraphCompiler::Lifetime& FrameGraphCompiler::GetLifetime(ResourceHandle resource) const
+{
+    assert(resource < m_Resources.size());
+    return m_Resources[resource].TransientLifetime;
+}
+
+bool FrameGraphCompiler::IsGraphicsOnlyState(D3D12_RESOURCE_STATES state)
+{
+    const D3D12_RESOURCE_STATES graphicsOnlyStates =
+        D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER |
+        D3D12_RESOURCE_STATE_INDEX_BUFFER |
+        D3D12_RESOURCE_STATE_RENDER_TARGET |
+        D3D12_RESOURCE_STATE_DEPTH_WRITE |
+        D3D12_RESOURCE_STATE_DEPTH_READ |
+        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE |
+        D3D12_RESOURCE_STATE_STREAM_OUT |
+        D3D12_RESOURCE_STATE_RESOLVE_DEST |
+        D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+
+    return (state & graphicsOnlyStates) != 0;
+}
+
+bool FrameGraphCompiler::IsReadOnlyState(D3D12_RESOURCE_STATES state)
+{
+    const D3D12_RESOURCE_STATES writeStates =
+        D3D12_RESOURCE_STATE_RENDER_TARGET |
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+        D3D12_RESOURCE_STATE_DEPTH_WRITE |
+        D3D12_RESOURCE_STATE_STREAM_OUT |
+        D3D12_RESOURCE_STATE_COPY_DEST |
+        D3D12_RESOURCE_STATE_RESOLVE_DEST;
+
+    // COMMON (0) is not a read state - a resource has to leave it explicitly.
+    return state != D3D12_RESOURCE_STATE_COMMON && (state & writeStates) == 0;
+}
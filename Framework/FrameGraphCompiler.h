@@ -0,0 +1,205 @@
+#pragma once
+
+// The compile step of the FrameGraph: passes declare which resources they read and write, Compile() turns
+// the declarations into an execution order, barriers and queue batches.
+// --
+// Only the declarations are used (no device, no command list, no Resource), so it runs headless:
+//   1. Builds the dependency DAG from the declaration order:
+//        read-after-write, write-after-write - data edges (the producer is needed by the consumer);
+//        write-after-read                    - ordering edges only;
+//        AddDependency                       - data edges, in any direction.
+//   2. Culls the passes that don't contribute (through data edges) to an output resource (see MarkOutput).
+//   3. Sorts the remaining passes topologically (Kahn). Ties prefer the queue of the previously scheduled pass
+//      (fewer batches and cross-queue waits), then the declaration order - so the result is deterministic.
+//   4. Computes the lifetimes of the transient resources (see CreateTransientResource).
+//   5. Computes the minimal set of barriers: a transition only when the state changes, consecutive reads
+//      on the same queue are merged into one combined read state, UAV barriers between UAV writes.
+//   6. Splits the order in batches of consecutive passes on the same queue and records the cross-queue waits.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class DX12_FW_API FrameGraphCompiler
+{
+public:
+    using ResourceHandle = uint32_t;
+    using PassHandle     = uint32_t;
+
+    static constexpr uint32_t InvalidTransientIndex = 0xFFFFFFFF;
+
+    enum class QueueType
+    {
+        Direct,
+        Compute
+    };
+
+    struct Barrier
+    {
+        enum class Type
+        {
+            Transition,
+            UAV
+        };
+
+        Type                    BarrierType;
+        ResourceHandle          Resource;
+        D3D12_RESOURCE_STATES   StateBefore;
+        D3D12_RESOURCE_STATES   StateAfter;
+    };
+
+    // A run of consecutive (in the execution order) passes on the same queue.
+    struct Batch
+    {
+        QueueType               Queue;
+        std::vector<PassHandle> Passes;
+        // Batches (on the other queue) that must finish on the GPU before this batch starts.
+        std::vector<uint32_t>   WaitForBatches;
+    };
+
+    // Lifetime of a transient resource - [FirstPass, LastPass] in the execution order (inclusive).
+    struct Lifetime
+    {
+        // In the order of the first uses, InvalidTransientIndex if no pass (left after the culling) uses the resource.
+        uint32_t                TransientIndex = InvalidTransientIndex;
+        uint32_t                FirstPass = 0;
+        uint32_t                LastPass = 0;
+    };
+
+    // Statistics of the last Compile().
+    struct Stats
+    {
+        uint32_t NumPasses          = 0;
+        uint32_t NumCulledPasses    = 0;
+        uint32_t NumBarriers        = 0;
+        uint32_t NumBatches         = 0;
+        uint32_t NumCrossQueueWaits = 0;
+        uint32_t NumTransientTextures = 0;
+    };
+
+public:
+    FrameGraphCompiler();
+    ~FrameGraphCompiler();
+
+    // Remove all the passes and resources.
+    void Reset();
+
+    // ----- DECLARATION -----
+
+    // @param initialState - the state the resource is in when the graph starts. If unknown, the first
+    //        access always produces a transition.
+    ResourceHandle ImportResource(const std::wstring& name, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON);
+
+    // A resource that only lives during the frame: it starts in the state of its first access and is returned
+    // to it after its last access. Transient resources used on the compute queue live for the whole frame.
+    ResourceHandle CreateTransientResource(const std::wstring& name);
+
+    // Outputs are the roots of the culling - e.g. the swap chain back buffer.
+    void MarkOutput(ResourceHandle resource);
+
+    PassHandle AddPass(const std::wstring& name, QueueType queue);
+
+    // A pass that must never be culled (e.g. it has side effects outside of the graph).
+    void SetNeverCull(PassHandle pass);
+
+    // The pass runs after the dependency and keeps it alive, for the data the resources don't express.
+    // Unlike the accesses, the dependency can be declared after the pass (so the declarations can contain a cycle).
+    void AddDependency(PassHandle pass, PassHandle dependency);
+
+    // Declare the accesses of a pass. The order of the declarations (of the passes) defines the data flow.
+    void Read(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state);
+    void Write(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state);
+
+    // ----- COMPILATION -----
+
+    // Throws std::exception for invalid declarations (a cycle, or a graphics only state on the compute queue).
+    void Compile();
+
+    // ----- RESULTS -----
+
+    const std::vector<PassHandle>&  GetExecutionOrder() const { return m_ExecutionOrder; }
+    const std::vector<Batch>&       GetBatches() const { return m_Batches; }
+    // Barriers issued before the pass is recorded.
+    const std::vector<Barrier>&     GetPassBarriers(PassHandle pass) const;
+    // Barriers issued after the pass is recorded (the compute queue can't transition out of graphics only states).
+    const std::vector<Barrier>&     GetPassPostBarriers(PassHandle pass) const;
+    // The batch of a pass that is not culled.
+    uint32_t                        GetPassBatch(PassHandle pass) const;
+    // State of the resource when the graph starts (the first access of a used transient resource).
+    D3D12_RESOURCE_STATES           GetInitialState(ResourceHandle resource) const;
+    // State of the resource at the end of the frame.
+    D3D12_RESOURCE_STATES           GetFinalState(ResourceHandle resource) const;
+
+    bool                            IsPassCulled(PassHandle pass) const;
+    QueueType                       GetPassQueue(PassHandle pass) const;
+    const std::wstring&             GetPassName(PassHandle pass) const;
+    const std::wstring&             GetResourceName(ResourceHandle resource) const;
+    uint32_t                        GetNumPasses() const { return static_cast<uint32_t>(m_Passes.size()); }
+    uint32_t                        GetNumResources() const { return static_cast<uint32_t>(m_Resources.size()); }
+
+    bool                            IsTransient(ResourceHandle resource) const;
+    const Lifetime&                 GetLifetime(ResourceHandle resource) const;
+
+    const Stats&                    GetStats() const { return m_Stats; }
+
+    // True if the state can't be used on the compute queue.
+    static bool IsGraphicsOnlyState(D3D12_RESOURCE_STATES state);
+    // True if the state only contains read states.
+    static bool IsReadOnlyState(D3D12_RESOURCE_STATES state);
+
+private:
+    struct ResourceAccess
+    {
+        ResourceHandle          Resource;
+        D3D12_RESOURCE_STATES   State;
+        bool                    Write;
+    };
+
+    struct PassNode
+    {
+        std::wstring                Name;
+        QueueType                   Queue;
+        std::vector<ResourceAccess> Accesses;
+        bool                        NeverCull = false;
+        std::vector<PassHandle>     ExplicitDependencies;   // See AddDependency.
+
+        // Compile results
+        std::vector<PassHandle>     DataDependencies;       // Producers of the data the pass reads (or overwrites).
+        std::vector<PassHandle>     OrderDependencies;      // Passes that must run before (write-after-read).
+        std::vector<Barrier>        Barriers;
+        std::vector<Barrier>        PostBarriers;           // Transitions out of graphics only states, needed by a following compute pass.
+        bool                        Culled = false;
+        uint32_t                    Batch = 0;
+    };
+
+    struct ResourceNode
+    {
+        std::wstring            Name;
+        D3D12_RESOURCE_STATES   InitialState;
+        D3D12_RESOURCE_STATES   FinalState;
+        bool                    Output = false;
+        bool                    Transient = false;
+        Lifetime                TransientLifetime;
+    };
+
+    void BuildDependencies();
+    void CullPasses();
+    void SortPasses();
+    void ComputeBarriers();
+    void BuildBatches();
+    void ComputeLifetimes();
+
+    void AddAccess(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state, bool write);
+
+    std::vector<PassNode>       m_Passes;
+    std::vector<ResourceNode>   m_Resources;
+
+    std::vector<PassHandle>     m_ExecutionOrder;
+    std::vector<Batch>          m_Batches;
+
+    Stats                       m_Stats;
+};
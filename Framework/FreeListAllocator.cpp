@@ -0,0 +1,112 @@
+#include "FreeListAllocator.h"
+
+#include <exception>
+
+FreeListAllocator::FreeListAllocator( uint32_t capacity )
+{
+    Reset( capacity );
+}
+
+void FreeListAllocator::Reset( uint32_t capacity )
+{
+    m_FreeRangesByOffset.clear();
+    m_FreeRangesBySize.clear();
+    m_Capacity = capacity;
+    m_UsedSize = 0;
+    m_NumAllocations = 0;
+
+    if ( capacity > 0 )
+    {
+        AddFreeRange( 0, capacity );
+    }
+}
+
+uint32_t FreeListAllocator::Allocate( uint32_t size )
+{
+    if ( size == 0 )
+        return InvalidOffset;
+
+    // The smallest free range that fits.
+    auto bySize = m_FreeRangesBySize.lower_bound( { size, 0 } );
+    if ( bySize == m_FreeRangesBySize.end() )
+        return InvalidOffset;
+
+    uint32_t rangeSize = bySize->first;
+    uint32_t offset = bySize->second;
+    RemoveFreeRange( m_FreeRangesByOffset.find( offset ) );
+
+    // The rest of the range stays free.
+    if ( rangeSize > size )
+    {
+        AddFreeRange( offset + size, rangeSize - size );
+    }
+
+    m_UsedSize += size;
+    ++m_NumAllocations;
+    return offset;
+}
+
+void FreeListAllocator::Free( uint32_t offset, uint32_t size )
+{
+    if ( size == 0 || offset >= m_Capacity || size > m_Capacity - offset )
+    {
+        throw std::exception( "FreeListAllocator: the range is out of the capacity." );
+    }
+
+    uint32_t end = offset + size;
+
+    // The first free range after the freed one, and the one before it.
+    auto next = m_FreeRangesByOffset.lower_bound( offset );
+    if ( next != m_FreeRangesByOffset.end() && next->first < end )
+    {
+        throw std::exception( "FreeListAllocator: the range is already free." );
+    }
+
+    auto previous = next;
+    if ( previous != m_FreeRangesByOffset.begin() )
+    {
+        --previous;
+        if ( previous->first + previous->second > offset )
+        {
+            throw std::exception( "FreeListAllocator: the range is already free." );
+        }
+    }
+    else
+    {
+        previous = m_FreeRangesByOffset.end();
+    }
+
+    m_UsedSize -= size;
+    --m_NumAllocations;
+
+    // Merge with the free neighbours.
+    if ( next != m_FreeRangesByOffset.end() && next->first == end )
+    {
+        end += next->second;
+        RemoveFreeRange( next );
+    }
+    if ( previous != m_FreeRangesByOffset.end() && previous->first + previous->second == offset )
+    {
+        offset = previous->first;
+        RemoveFreeRange( previous );
+    }
+
+    AddFreeRange( offset, end - offset );
+}
+
+uint32_t FreeListAllocator::GetLargestFreeRange() const
+{
+    return m_FreeRangesBySize.empty() ? 0 : m_FreeRangesBySize.rbegin()->first;
+}
+
+void FreeListAllocator::AddFreeRange( uint32_t offset, uint32_t size )
+{
+    m_FreeRangesByOffset.insert( { offset, size } );
+    m_FreeRangesBySize.insert( { size, offset } );
+}
+
+void FreeListAllocator::RemoveFreeRange( std::map<uint32_t, uint32_t>::iterator range )
+{
+    m_FreeRangesBySize.erase( { range->second, range->first } );
+    m_FreeRangesByOffset.erase( range );
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Sub-allocates ranges [offset, offset + size) of a fixed capacity (eg. the vertices of a large vertex buffer).
+// --
+// The free ranges are kept twice: by offset, so a freed range is merged with its free neighbours, and by size, so an
+// allocation takes the smallest free range that fits (best fit, less fragmentation than first fit; the lowest offset
+// among the ranges of that size).
+// Allocate and Free are O(log n) in the number of free ranges. The allocated ranges aren't stored: the caller gives
+// the size back to Free.
+// No device is used, the allocator can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+
+class DX12_FW_API FreeListAllocator
+{
+public:
+    static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+    explicit FreeListAllocator( uint32_t capacity = 0 );
+
+    // Free everything, with a new capacity.
+    void Reset( uint32_t capacity );
+
+    // @return the offset of the range, InvalidOffset if no free range is large enough (or size is 0).
+    uint32_t Allocate( uint32_t size );
+    // Throws if the range isn't allocated (out of the capacity, or overlapping a free range).
+    void Free( uint32_t offset, uint32_t size );
+
+    uint32_t GetCapacity() const { return m_Capacity; }
+    uint32_t GetUsedSize() const { return m_UsedSize; }
+    uint32_t GetNumAllocations() const { return m_NumAllocations; }
+    uint32_t GetNumFreeRanges() const { return static_cast<uint32_t>( m_FreeRangesByOffset.size() ); }
+    // The largest allocation that would succeed.
+    uint32_t GetLargestFreeRange() const;
+
+private:
+    void AddFreeRange( uint32_t offset, uint32_t size );
+    void RemoveFreeRange( std::map<uint32_t, uint32_t>::iterator range );
+
+    std::map<uint32_t, uint32_t>                m_FreeRangesByOffset;   // Offset -> size.
+    std::set<std::pair<uint32_t, uint32_t>>     m_FreeRangesBySize;     // (Size, offset): a range is removed in O(log n).
+    uint32_t                                    m_Capacity = 0;
+    uint32_t                                    m_UsedSize = 0;
+    uint32_t                                    m_NumAllocations = 0;
+};
@@ -0,0 +1,270 @@
+#include "FrustumCuller.h"
+
+#include <Framework/CullingMath.h>
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#include <cmath>
+#include <exception>
+
+using namespace DirectX;
+
+namespace
+{
+    bool IsAVXAvailable()
+    {
+        int cpuInfo[4];
+        __cpuid( cpuInfo, 1 );
+
+        bool osxsave = ( cpuInfo[2] & ( 1 << 27 ) ) != 0;
+        bool avx = ( cpuInfo[2] & ( 1 << 28 ) ) != 0;
+        if ( !osxsave || !avx )
+            return false;
+
+        // The OS must save the YMM registers (XMM and YMM state enabled in XCR0).
+        unsigned long long xcr0 = _xgetbv( 0 );
+        return ( xcr0 & 0x6 ) == 0x6;
+    }
+}
+
+FrustumCuller::InstructionSet FrustumCuller::GetBestInstructionSet()
+{
+    static const InstructionSet s_BestInstructionSet = IsAVXAvailable() ? InstructionSet::AVX : InstructionSet::SSE;
+    return s_BestInstructionSet;
+}
+
+bool FrustumCuller::IsSupported( InstructionSet instructionSet )
+{
+    switch ( instructionSet )
+    {
+    case InstructionSet::Scalar:
+    case InstructionSet::SSE:   // Always there on x64.
+        return true;
+    case InstructionSet::AVX:
+        return GetBestInstructionSet() == InstructionSet::AVX;
+    default:
+        return false;
+    }
+}
+
+const char* FrustumCuller::GetInstructionSetName( InstructionSet instructionSet )
+{
+    switch ( instructionSet )
+    {
+    case InstructionSet::Scalar:
+        return "Scalar";
+    case InstructionSet::SSE:
+        return "SSE";
+    case InstructionSet::AVX:
+        return "AVX";
+    default:
+        return "Unknown";
+    }
+}
+
+void FrustumCuller::Reserve( uint32_t numBoxes )
+{
+    m_CenterX.reserve( numBoxes );
+    m_CenterY.reserve( numBoxes );
+    m_CenterZ.reserve( numBoxes );
+    m_ExtentX.reserve( numBoxes );
+    m_ExtentY.reserve( numBoxes );
+    m_ExtentZ.reserve( numBoxes );
+}
+
+void FrustumCuller::Clear()
+{
+    m_CenterX.clear();
+    m_CenterY.clear();
+    m_CenterZ.clear();
+    m_ExtentX.clear();
+    m_ExtentY.clear();
+    m_ExtentZ.clear();
+}
+
+uint32_t FrustumCuller::AddBox( const XMFLOAT3& center, const XMFLOAT3& extents )
+{
+    m_CenterX.push_back( center.x );
+    m_CenterY.push_back( center.y );
+    m_CenterZ.push_back( center.z );
+    m_ExtentX.push_back( extents.x );
+    m_ExtentY.push_back( extents.y );
+    m_ExtentZ.push_back( extents.z );
+
+    return GetNumBoxes() - 1;
+}
+
+void FrustumCuller::Cull( const XMFLOAT4X4& viewProjection, std::vector<uint32_t>& visible ) const
+{
+    Cull( viewProjection, visible, GetBestInstructionSet() );
+}
+
+void FrustumCuller::Cull( const XMFLOAT4X4& viewProjection, std::vector<uint32_t>& visible, InstructionSet instructionSet ) const
+{
+    if ( !IsSupported( instructionSet ) )
+    {
+        throw std::exception( "FrustumCuller: the instruction set is not supported by this CPU." );
+    }
+
+    CullingMath::View view = CullingMath::MakeView( viewProjection );
+
+    // Room for every box, the visible ones are written without a bounds check.
+    visible.resize( GetNumBoxes() );
+    if ( visible.empty() )
+        return;
+
+    uint32_t numVisible = 0;
+    switch ( instructionSet )
+    {
+    case InstructionSet::Scalar:
+        numVisible = CullScalar( view.FrustumPlanes, 0, GetNumBoxes(), visible.data() );
+        break;
+    case InstructionSet::SSE:
+        numVisible = CullSSE( view.FrustumPlanes, visible.data() );
+        break;
+    case InstructionSet::AVX:
+        numVisible = CullAVX( view.FrustumPlanes, visible.data() );
+        break;
+    }
+
+    visible.resize( numVisible );
+}
+
+uint32_t FrustumCuller::CullScalar( const XMFLOAT4 planes[6], uint32_t begin, uint32_t end, uint32_t* visible ) const
+{
+    uint32_t numVisible = 0;
+
+    for ( uint32_t i = begin; i < end; ++i )
+    {
+        bool inside = true;
+        for ( int p = 0; p < 6 && inside; ++p )
+        {
+            const XMFLOAT4& plane = planes[p];
+
+            float distance = ( ( plane.x * m_CenterX[i] + plane.y * m_CenterY[i] ) + plane.z * m_CenterZ[i] ) + plane.w;
+            float radius = ( std::abs( plane.x ) * m_ExtentX[i] + std::abs( plane.y ) * m_ExtentY[i] ) + std::abs( plane.z ) * m_ExtentZ[i];
+
+            inside = !( distance + radius < 0.0f );
+        }
+
+        // Branchless append.
+        visible[numVisible] = i;
+        numVisible += inside ? 1 : 0;
+    }
+
+    return numVisible;
+}
+
+uint32_t FrustumCuller::CullSSE( const XMFLOAT4 planes[6], uint32_t* visible ) const
+{
+    const uint32_t numBoxes = GetNumBoxes();
+    const uint32_t numBlocks = numBoxes / 4;
+
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+    __m128 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+    for ( int p = 0; p < 6; ++p )
+    {
+        planeX[p] = _mm_set1_ps( planes[p].x );
+        planeY[p] = _mm_set1_ps( planes[p].y );
+        planeZ[p] = _mm_set1_ps( planes[p].z );
+        planeW[p] = _mm_set1_ps( planes[p].w );
+        absPlaneX[p] = _mm_set1_ps( std::abs( planes[p].x ) );
+        absPlaneY[p] = _mm_set1_ps( std::abs( planes[p].y ) );
+        absPlaneZ[p] = _mm_set1_ps( std::abs( planes[p].z ) );
+    }
+
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t numVisible = 0;
+
+    for ( uint32_t block = 0; block < numBlocks; ++block )
+    {
+        const uint32_t first = block * 4;
+
+        __m128 centerX = _mm_loadu_ps( &m_CenterX[first] );
+        __m128 centerY = _mm_loadu_ps( &m_CenterY[first] );
+        __m128 centerZ = _mm_loadu_ps( &m_CenterZ[first] );
+        __m128 extentX = _mm_loadu_ps( &m_ExtentX[first] );
+        __m128 extentY = _mm_loadu_ps( &m_ExtentY[first] );
+        __m128 extentZ = _mm_loadu_ps( &m_ExtentZ[first] );
+
+        __m128 inside = _mm_castsi128_ps( _mm_set1_epi32( -1 ) );
+        for ( int p = 0; p < 6; ++p )
+        {
+            __m128 distance = _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( planeX[p], centerX ), _mm_mul_ps( planeY[p], centerY ) ),
+                                                      _mm_mul_ps( planeZ[p], centerZ ) ), planeW[p] );
+            __m128 radius = _mm_add_ps( _mm_add_ps( _mm_mul_ps( absPlaneX[p], extentX ), _mm_mul_ps( absPlaneY[p], extentY ) ),
+                                        _mm_mul_ps( absPlaneZ[p], extentZ ) );
+
+            // !(distance + radius < 0), like the scalar test.
+            inside = _mm_and_ps( inside, _mm_cmpnlt_ps( _mm_add_ps( distance, radius ), zero ) );
+        }
+
+        int mask = _mm_movemask_ps( inside );
+        for ( uint32_t lane = 0; lane < 4; ++lane )
+        {
+            visible[numVisible] = first + lane;
+            numVisible += ( mask >> lane ) & 1;
+        }
+    }
+
+    return numVisible + CullScalar( planes, numBlocks * 4, numBoxes, visible + numVisible );
+}
+
+uint32_t FrustumCuller::CullAVX( const XMFLOAT4 planes[6], uint32_t* visible ) const
+{
+    const uint32_t numBoxes = GetNumBoxes();
+    const uint32_t numBlocks = numBoxes / 8;
+
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+    __m256 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+    for ( int p = 0; p < 6; ++p )
+    {
+        planeX[p] = _mm256_set1_ps( planes[p].x );
+        planeY[p] = _mm256_set1_ps( planes[p].y );
+        planeZ[p] = _mm256_set1_ps( planes[p].z );
+        planeW[p] = _mm256_set1_ps( planes[p].w );
+        absPlaneX[p] = _mm256_set1_ps( std::abs( planes[p].x ) );
+        absPlaneY[p] = _mm256_set1_ps( std::abs( planes[p].y ) );
+        absPlaneZ[p] = _mm256_set1_ps( std::abs( planes[p].z ) );
+    }
+
+    const __m256 zero = _mm256_setzero_ps();
+    uint32_t numVisible = 0;
+
+    for ( uint32_t block = 0; block < numBlocks; ++block )
+    {
+        const uint32_t first = block * 8;
+
+        __m256 centerX = _mm256_loadu_ps( &m_CenterX[first] );
+        __m256 centerY = _mm256_loadu_ps( &m_CenterY[first] );
+        __m256 centerZ = _mm256_loadu_ps( &m_CenterZ[first] );
+        __m256 extentX = _mm256_loadu_ps( &m_ExtentX[first] );
+        __m256 extentY = _mm256_loadu_ps( &m_ExtentY[first] );
+        __m256 extentZ = _mm256_loadu_ps( &m_ExtentZ[first] );
+
+        __m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32( -1 ) );
+        for ( int p = 0; p < 6; ++p )
+        {
+            // Separate mul and add (no FMA), so the results match the scalar test.
+            __m256 distance = _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( planeX[p], centerX ), _mm256_mul_ps( planeY[p], centerY ) ),
+                                                            _mm256_mul_ps( planeZ[p], centerZ ) ), planeW[p] );
+            __m256 radius = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( absPlaneX[p], extentX ), _mm256_mul_ps( absPlaneY[p], extentY ) ),
+                                           _mm256_mul_ps( absPlaneZ[p], extentZ ) );
+
+            inside = _mm256_and_ps( inside, _mm256_cmp_ps( _mm256_add_ps( distance, radius ), zero, _CMP_NLT_UQ ) );
+        }
+
+        int mask = _mm256_movemask_ps( inside );
+        for ( uint32_t lane = 0; lane < 8; ++lane )
+        {
+            visible[numVisible] = first + lane;
+            numVisible += ( mask >> lane ) & 1;
+        }
+    }
+
+    // Leave the AVX state before the SSE code that follows.
+    _mm256_zeroupper();
+
+    return numVisible + CullScalar( planes, numBlocks * 8, numBoxes, visible + numVisible );
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Batch frustum culling of world-space AABBs.
+// --
+// The boxes are stored as structure of arrays (one array per component), so 4 (SSE) or 8 (AVX) boxes are tested
+// against a frustum plane per instruction. The instruction set is picked at run time, with a scalar fallback.
+// The test is the one of CullingMath::IsInFrustum (same operations in the same order), every instruction set
+// gives the same result.
+// No device is used, the culler can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API FrustumCuller
+{
+public:
+    enum class InstructionSet
+    {
+        Scalar,     // 1 box per test.
+        SSE,        // 4 boxes per test.
+        AVX,        // 8 boxes per test.
+    };
+
+    // The widest instruction set supported by the CPU (and the OS, for AVX).
+    static InstructionSet GetBestInstructionSet();
+    static bool IsSupported( InstructionSet instructionSet );
+    static const char* GetInstructionSetName( InstructionSet instructionSet );
+
+    void Reserve( uint32_t numBoxes );
+    void Clear();
+
+    // @return the index of the box.
+    uint32_t AddBox( const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents );
+
+    uint32_t GetNumBoxes() const { return static_cast<uint32_t>( m_CenterX.size() ); }
+
+    // Write the indices of the boxes that intersect the frustum of the view-projection matrix (row vectors),
+    // in increasing order.
+    void Cull( const DirectX::XMFLOAT4X4& viewProjection, std::vector<uint32_t>& visible ) const;
+    void Cull( const DirectX::XMFLOAT4X4& viewProjection, std::vector<uint32_t>& visible, InstructionSet instructionSet ) const;
+
+private:
+    // @return the number of visible boxes in [begin, end), written from visible[0].
+    uint32_t CullScalar( const DirectX::XMFLOAT4 planes[6], uint32_t begin, uint32_t end, uint32_t* visible ) const;
+    uint32_t CullSSE( const DirectX::XMFLOAT4 planes[6], uint32_t* visible ) const;
+    uint32_t CullAVX( const DirectX::XMFLOAT4 planes[6], uint32_t* visible ) const;
+
+    std::vector<float> m_CenterX;
+    std::vector<float> m_CenterY;
+    std::vector<float> m_CenterZ;
+    std::vector<float> m_ExtentX;
+    std::vector<float> m_ExtentY;
+    std::vector<float> m_ExtentZ;
+};
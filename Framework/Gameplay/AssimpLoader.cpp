@@ -3,12 +3,18 @@
 #endif
 
 #include "AssimpLoader.h"
+#include "ModelCache.h"
 
 #include <Framework/3RD_Party/Helpers.h>
+#include <Framework/Application.h>
+#include <Framework/MeshSimplifier.h>
+#include <Framework/VertexCacheOptimizer.h>
+#include <Framework/VertexQuantizer.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/GltfMaterial.h>
 
 #include <DirectXMath.h>
 #include <filesystem>
@@ -37,70 +43,119 @@ namespace
         return result;
     }
 
-    void LoadTextureFromFile(CommandList& commandList, const std::filesystem::path& modelDir, const aiString& texPath, Texture& textureOut, bool& hasTextureOut)
+    // @return false if the texture isn't a file (none, or embedded) or the file doesn't exist.
+    bool GetTextureFilePath(const std::filesystem::path& modelDir, std::string_view texPath, std::wstring& filePathOut)
     {
-        std::string pathStr(texPath.C_Str());
+        std::string pathStr(texPath);
 
         // Skip embedded textures (path starts with *)
-        if (!pathStr.empty() && pathStr[0] != '*')
+        if (pathStr.empty() || pathStr[0] == '*')
+            return false;
+
+        std::filesystem::path fullPath = modelDir / pathStr;
+        if (!std::filesystem::exists(fullPath))
+            return false;
+
+        filePathOut = fullPath.lexically_normal().wstring();
+        return true;
+    }
+
+    void LoadTextureFromFile(CommandList& commandList, const std::filesystem::path& modelDir, std::string_view texPath, Texture& textureOut, bool& hasTextureOut)
+    {
+        std::wstring fullPathW;
+        if (GetTextureFilePath(modelDir, texPath, fullPathW))
         {
-            std::filesystem::path fullPath = modelDir / pathStr;
-            std::wstring fullPathW = fullPath.lexically_normal().wstring();
-            if (std::filesystem::exists(fullPath))
+            try
             {
-                try
-                {
-                    commandList.LoadTextureFromFile(textureOut, fullPathW);
-                    hasTextureOut = true;
-                }
-                catch (...) { /* use default */ }
+                commandList.LoadTextureFromFile(textureOut, fullPathW);
+                hasTextureOut = true;
             }
+            catch (...) { /* use default */ }
         }
     }
-}
 
-std::vector<LoadedMeshPart> AssimpLoader::Load(
-    CommandList& commandList,
-    const std::wstring& modelPath,
-    const Texture& defaultTexture)
-{
-    std::vector<LoadedMeshPart> parts;
-
-    std::filesystem::path path(modelPath);
-    if (!std::filesystem::exists(path))
+    // Start the decodes on the thread pool: LoadMeshPart uploads the textures in order, each as soon as it's decoded.
+    void PrefetchTextures(const ModelCache::MeshData& mesh, const std::filesystem::path& modelDir)
     {
-        ThrowIfFailed(false, "AssimpLoader: Model file not found.");
-        return parts;
+        for (std::string_view texPath : { mesh.DiffuseTexture, mesh.RoughnessTexture, mesh.MetalnessTexture })
+        {
+            std::wstring fullPathW;
+            if (GetTextureFilePath(modelDir, texPath, fullPathW))
+                CommandList::PrefetchTextureFile(fullPathW);
+        }
     }
 
-    std::string narrowPath = ToNarrow(path.lexically_normal().wstring());
-    std::filesystem::path modelDir = path.parent_path();
-
-    Assimp::Importer importer;
-
-    const unsigned int flags =
-        aiProcess_Triangulate |
-        aiProcess_GenNormals |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_FlipUVs |
-        aiProcess_MakeLeftHanded |
-        aiProcess_FlipWindingOrder;
-
-    const aiScene* scene = importer.ReadFile(narrowPath, flags);
-    if (!scene || !scene->HasMeshes())
+    // CPU side of a mesh, read before the GPU buffers are created (the LODs are built from it).
+    struct MeshGeometry
     {
-        ThrowIfFailed(false, importer.GetErrorString());
-        return parts;
+        VertexCollection vertices;
+        IndexCollection indices;                // Every LOD, back to back, the full resolution one first
+        std::vector<uint32_t> lodIndexCounts;
+        DirectX::BoundingBox bounds;
+        std::shared_ptr<MeshletBuilder::MeshletMesh> meshlets;
+        VertexCacheOptimizer::Statistics vertexCacheBefore;
+        VertexCacheOptimizer::Statistics vertexCacheAfter;
+        QuantizedVertexCollection quantizedVertices;
+        VertexQuantizer::Dequantization dequantization = {};
+        VertexQuantizer::Error quantizationError;
+
+        // Material of the file: the factors, the texture paths relative to the model directory.
+        float roughness = Material::White.Roughness;
+        float metalness = Material::White.Metalness;
+        bool alphaTested = false;
+        std::string diffuseTexture;
+        std::string roughnessTexture;
+        std::string metalnessTexture;
+    };
+
+    // Node of the file, depth-first (a node comes after its parent).
+    struct NodeGeometry
+    {
+        uint32_t parent = ModelCache::InvalidNode;
+        XMFLOAT4X4 transform;
+        std::string name;
+        std::vector<uint32_t> meshes;
+    };
+
+    // Box of the vertices, for frustum culling.
+    DirectX::BoundingBox ComputeBounds(const VertexCollection& vertices)
+    {
+        DirectX::BoundingBox bounds;
+        if (!vertices.empty())
+        {
+            XMVECTOR vMin = XMVectorReplicate(std::numeric_limits<float>::max());
+            XMVECTOR vMax = XMVectorReplicate(-std::numeric_limits<float>::max());
+            for (const auto& v : vertices)
+            {
+                XMVECTOR p = XMLoadFloat3(&v.position);
+                vMin = XMVectorMin(vMin, p);
+                vMax = XMVectorMax(vMax, p);
+            }
+            XMStoreFloat3(&bounds.Center, (vMin + vMax) * 0.5f);
+            XMStoreFloat3(&bounds.Extents, (vMax - vMin) * 0.5f);
+        }
+        else
+        {
+            bounds.Center = XMFLOAT3(0, 0, 0);
+            bounds.Extents = XMFLOAT3(0, 0, 0);
+        }
+
+        // Add small padding to avoid false culling at frustum edges
+        const float padding = 0.01f;
+        bounds.Extents.x = std::max(bounds.Extents.x, padding);
+        bounds.Extents.y = std::max(bounds.Extents.y, padding);
+        bounds.Extents.z = std::max(bounds.Extents.z, padding);
+        return bounds;
     }
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    // @return false if the mesh has nothing to draw.
+    bool ReadMeshGeometry(const aiMesh* aiMesh, MeshGeometry& geometry)
     {
-        const aiMesh* aiMesh = scene->mMeshes[i];
         if (!aiMesh->HasFaces())
-            continue;
+            return false;
 
-        VertexCollection vertices;
-        IndexCollection indices;
+        VertexCollection& vertices = geometry.vertices;
+        IndexCollection& indices = geometry.indices;
 
         // Vertices
         for (unsigned int v = 0; v < aiMesh->mNumVertices; ++v)
@@ -129,31 +184,7 @@ std::vector<LoadedMeshPart> AssimpLoader::Load(
         }
 
         // Compute bounding box for frustum culling
-        DirectX::BoundingBox bounds;
-        if (!vertices.empty())
-        {
-            XMVECTOR vMin = XMVectorReplicate(std::numeric_limits<float>::max());
-            XMVECTOR vMax = XMVectorReplicate(-std::numeric_limits<float>::max());
-            for (const auto& v : vertices)
-            {
-                XMVECTOR p = XMLoadFloat3(&v.position);
-                vMin = XMVectorMin(vMin, p);
-                vMax = XMVectorMax(vMax, p);
-            }
-            XMStoreFloat3(&bounds.Center, (vMin + vMax) * 0.5f);
-            XMStoreFloat3(&bounds.Extents, (vMax - vMin) * 0.5f);
-        }
-        else
-        {
-            bounds.Center = XMFLOAT3(0, 0, 0);
-            bounds.Extents = XMFLOAT3(0, 0, 0);
-        }
-
-        // Add small padding to avoid false culling at frustum edges
-        const float padding = 0.01f;
-        bounds.Extents.x = std::max(bounds.Extents.x, padding);
-        bounds.Extents.y = std::max(bounds.Extents.y, padding);
-        bounds.Extents.z = std::max(bounds.Extents.z, padding);
+        geometry.bounds = ComputeBounds(vertices);
 
         // Indices
         for (unsigned int f = 0; f < aiMesh->mNumFaces; ++f)
@@ -161,75 +192,251 @@ std::vector<LoadedMeshPart> AssimpLoader::Load(
             const aiFace& face = aiMesh->mFaces[f];
             if (face.mNumIndices != 3)
                 continue;
-            indices.push_back(static_cast<uint16_t>(face.mIndices[0]));
-            indices.push_back(static_cast<uint16_t>(face.mIndices[1]));
-            indices.push_back(static_cast<uint16_t>(face.mIndices[2]));
+            indices.push_back(face.mIndices[0]);
+            indices.push_back(face.mIndices[1]);
+            indices.push_back(face.mIndices[2]);
         }
+        geometry.lodIndexCounts = { static_cast<uint32_t>(indices.size()) };
 
-        if (vertices.empty() || indices.empty())
-            continue;
-
-        std::unique_ptr<Mesh> mesh = Mesh::CreateFromData(commandList, vertices, indices, true);
-        if (!mesh)
-            continue;
+        return !vertices.empty() && !indices.empty();
+    }
 
-        LoadedMeshPart part;
-        part.mesh = std::move(mesh);
-        part.material = Material::White;
-		part.boundingBox = bounds;
+    // Copy of the (unprocessed) geometry in the space of transform: the normals by its inverse transpose, the winding
+    // flipped if it mirrors.
+    MeshGeometry TransformGeometry(const MeshGeometry& geometry, FXMMATRIX transform)
+    {
+        MeshGeometry transformed = geometry;
 
-        // Diffuse texture
-        bool hasDiffuse = false;
-        bool hasRoughness = false;
-        bool hasMetalness = false;
-        if (aiMesh->mMaterialIndex < scene->mNumMaterials)
+        XMMATRIX normalTransform = XMMatrixTranspose(XMMatrixInverse(nullptr, transform));
+        for (auto& v : transformed.vertices)
         {
-            aiMaterial* mat = scene->mMaterials[aiMesh->mMaterialIndex];
+            XMStoreFloat3(&v.position, XMVector3TransformCoord(XMLoadFloat3(&v.position), transform));
+            XMStoreFloat3(&v.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&v.normal), normalTransform)));
+        }
+        transformed.bounds = ComputeBounds(transformed.vertices);
 
-            // Read PBR scalar factors (glTF 2.0 populates these; FBX usually won't)
+        if (XMVectorGetX(XMMatrixDeterminant(transform)) < 0.0f)
+        {
+            for (size_t i = 0; i + 2 < transformed.indices.size(); i += 3)
             {
-                ai_real aiRoughness = 0.5f;
-                if (mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, aiRoughness) == AI_SUCCESS)
-                {
-                    part.material.Roughness = static_cast<float>(aiRoughness);
-                }
-                else
-                {
-                    part.material.Roughness = 0.5f; // fallback
-                }
-
-                ai_real aiMetalness = 0.0f;
-                if (mat->Get(AI_MATKEY_METALLIC_FACTOR, aiMetalness) == AI_SUCCESS)
-                {
-                    part.material.Metalness = static_cast<float>(aiMetalness);
-                }
-                else
-                {
-                    part.material.Metalness = 0.0f; // fallback
-                }
+                std::swap(transformed.indices[i + 1], transformed.indices[i + 2]);
             }
+        }
+
+        return transformed;
+    }
 
-            aiString diffuseTexPath;
-            if (mat->GetTexture(aiTextureType_DIFFUSE, 0, &diffuseTexPath) == AI_SUCCESS)
+    // PBR factors, alpha mode and texture paths of the material of a mesh.
+    void ReadMeshMaterial(const aiScene* scene, const aiMesh* aiMesh, MeshGeometry& geometry)
+    {
+        if (aiMesh->mMaterialIndex >= scene->mNumMaterials)
+            return;
+
+        aiMaterial* mat = scene->mMaterials[aiMesh->mMaterialIndex];
+
+        // Read PBR scalar factors (glTF 2.0 populates these; FBX usually won't)
+        {
+            ai_real aiRoughness = 0.5f;
+            if (mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, aiRoughness) == AI_SUCCESS)
             {
-				LoadTextureFromFile(commandList, modelDir, diffuseTexPath, part.diffuseTexture, hasDiffuse);
+                geometry.roughness = static_cast<float>(aiRoughness);
+            }
+            else
+            {
+                geometry.roughness = 0.5f; // fallback
             }
 
-            // Roughness texture
-            aiString roughnessTexPath;
-            if (mat->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, 0, &roughnessTexPath) == AI_SUCCESS)
+            ai_real aiMetalness = 0.0f;
+            if (mat->Get(AI_MATKEY_METALLIC_FACTOR, aiMetalness) == AI_SUCCESS)
+            {
+                geometry.metalness = static_cast<float>(aiMetalness);
+            }
+            else
             {
-                LoadTextureFromFile(commandList, modelDir, roughnessTexPath, part.roughnessTexture, hasRoughness);
+                geometry.metalness = 0.0f; // fallback
             }
+        }
 
-            // Metalness texture
-            aiString metalnessTexPath;
-            if (mat->GetTexture(aiTextureType_METALNESS, 0, &metalnessTexPath) == AI_SUCCESS)
+        aiString alphaMode;
+        if (mat->Get(AI_MATKEY_GLTF_ALPHAMODE, alphaMode) == AI_SUCCESS)
+        {
+            geometry.alphaTested = std::string(alphaMode.C_Str()) != "OPAQUE";
+        }
+
+        aiString diffuseTexPath;
+        if (mat->GetTexture(aiTextureType_DIFFUSE, 0, &diffuseTexPath) == AI_SUCCESS)
+        {
+            geometry.diffuseTexture = diffuseTexPath.C_Str();
+        }
+
+        // Roughness texture
+        aiString roughnessTexPath;
+        if (mat->GetTexture(aiTextureType_DIFFUSE_ROUGHNESS, 0, &roughnessTexPath) == AI_SUCCESS)
+        {
+            geometry.roughnessTexture = roughnessTexPath.C_Str();
+        }
+
+        // Metalness texture
+        aiString metalnessTexPath;
+        if (mat->GetTexture(aiTextureType_METALNESS, 0, &metalnessTexPath) == AI_SUCCESS)
+        {
+            geometry.metalnessTexture = metalnessTexPath.C_Str();
+        }
+    }
+
+    // Vertex cache, overdraw and vertex fetch order, meshlets of the mesh (its triangles are reordered to match them,
+    // keeping the cache order within each), then the simplified index lists, LOD 1 and up (numLods counts the full
+    // resolution one), appended to the indices. Last, the quantized copy of the final vertices.
+    void ProcessMeshGeometry(MeshGeometry& geometry, uint32_t numLods, bool buildMeshlets, bool optimizeVertexCache, bool quantizeVertices)
+    {
+        std::vector<XMFLOAT3> positions;
+        positions.reserve(geometry.vertices.size());
+        for (const auto& v : geometry.vertices)
+        {
+            positions.push_back(v.position);
+        }
+
+        if (optimizeVertexCache)
+        {
+            uint32_t numVertices = static_cast<uint32_t>(geometry.vertices.size());
+            geometry.vertexCacheBefore = VertexCacheOptimizer::Analyze(geometry.indices, numVertices);
+
+            std::vector<uint32_t> clusters;
+            VertexCacheOptimizer::OptimizeVertexCache(geometry.indices, numVertices, &clusters);
+            VertexCacheOptimizer::OptimizeOverdraw(positions.data(), geometry.indices, clusters);
+
+            std::vector<uint32_t> remap = VertexCacheOptimizer::OptimizeVertexFetch(geometry.indices, numVertices);
+            geometry.vertices = VertexCacheOptimizer::RemapVertices(geometry.vertices, remap);
+            positions = VertexCacheOptimizer::RemapVertices(positions, remap);
+        }
+
+        if (buildMeshlets)
+        {
+            geometry.meshlets = std::make_shared<MeshletBuilder::MeshletMesh>(
+                MeshletBuilder::Build(positions.data(), static_cast<uint32_t>(positions.size()), geometry.indices));
+            geometry.indices = geometry.meshlets->Indices;
+        }
+
+        std::vector<MeshSimplifier::Lod> lods;
+        if (numLods > 1)
+        {
+            lods = MeshSimplifier::BuildLods(positions.data(), static_cast<uint32_t>(positions.size()), geometry.indices, numLods);
+            lods.erase(lods.begin());
+
+            if (optimizeVertexCache)
             {
-                LoadTextureFromFile(commandList, modelDir, metalnessTexPath, part.metalnessTexture, hasMetalness);
+                for (auto& lod : lods)
+                {
+                    VertexCacheOptimizer::OptimizeVertexCache(lod.Indices, static_cast<uint32_t>(positions.size()));
+                }
             }
         }
 
+        if (optimizeVertexCache)
+        {
+            geometry.vertexCacheAfter = VertexCacheOptimizer::Analyze(geometry.indices, static_cast<uint32_t>(positions.size()));
+        }
+
+        // All the LODs in one index range, the full resolution one first.
+        for (const auto& lod : lods)
+        {
+            geometry.indices.insert(geometry.indices.end(), lod.Indices.begin(), lod.Indices.end());
+            geometry.lodIndexCounts.push_back(static_cast<uint32_t>(lod.Indices.size()));
+        }
+
+        if (quantizeVertices)
+        {
+            // The box of the part (padded, so a flat mesh still has a scale on every axis).
+            const BoundingBox& bounds = geometry.bounds;
+            XMFLOAT3 minimum(bounds.Center.x - bounds.Extents.x, bounds.Center.y - bounds.Extents.y, bounds.Center.z - bounds.Extents.z);
+            XMFLOAT3 maximum(bounds.Center.x + bounds.Extents.x, bounds.Center.y + bounds.Extents.y, bounds.Center.z + bounds.Extents.z);
+            geometry.dequantization = VertexQuantizer::ComputeDequantization(minimum, maximum);
+
+            const VertexPositionNormalTexture& first = geometry.vertices.front();
+            VertexQuantizer::Source source = { &first.position, &first.normal, &first.textureCoordinate, sizeof(VertexPositionNormalTexture) };
+            uint32_t numVertices = static_cast<uint32_t>(geometry.vertices.size());
+
+            geometry.quantizedVertices.resize(numVertices);
+            VertexQuantizer::Encode(source, numVertices, geometry.dequantization, geometry.quantizedVertices.data());
+            geometry.quantizationError = VertexQuantizer::MeasureError(source, numVertices, geometry.dequantization, geometry.quantizedVertices.data());
+        }
+    }
+
+    // Views of the geometry, in the layout of the cache.
+    ModelCache::MeshData GetMeshData(const MeshGeometry& geometry, bool isLoaded)
+    {
+        ModelCache::MeshData mesh;
+        mesh.IsLoaded = isLoaded;
+        if (!isLoaded)
+            return mesh;
+
+        mesh.Bounds = geometry.bounds;
+        mesh.Vertices = geometry.vertices;
+        mesh.Indices = geometry.indices;
+        mesh.LodIndexCounts = geometry.lodIndexCounts;
+        mesh.QuantizedVertices = geometry.quantizedVertices;
+        mesh.Dequantization = geometry.dequantization;
+        mesh.QuantizationError = geometry.quantizationError;
+        if (geometry.meshlets)
+        {
+            mesh.Meshlets = geometry.meshlets->Meshlets;
+            mesh.MeshletBounds = geometry.meshlets->MeshletBounds;
+            mesh.MeshletVertices = geometry.meshlets->Vertices;
+            mesh.MeshletPrimitives = geometry.meshlets->Primitives;
+        }
+        mesh.VertexCacheBefore = geometry.vertexCacheBefore;
+        mesh.VertexCacheAfter = geometry.vertexCacheAfter;
+        mesh.Roughness = geometry.roughness;
+        mesh.Metalness = geometry.metalness;
+        mesh.AlphaTested = geometry.alphaTested;
+        mesh.DiffuseTexture = geometry.diffuseTexture;
+        mesh.RoughnessTexture = geometry.roughnessTexture;
+        mesh.MetalnessTexture = geometry.metalnessTexture;
+        return mesh;
+    }
+
+    // Geometry (GPU buffers and CPU view), bounds, material and textures of a mesh. The vertices and indices are
+    // uploaded from where they are (the vectors of the import, or the mapped cache file), source keeps them for the view.
+    void LoadMeshPart(CommandList& commandList, const ModelCache::MeshData& mesh, const std::shared_ptr<const void>& source,
+        const std::filesystem::path& modelDir, const Texture& defaultTexture, GeometryPool* geometryPool, GeometryPool* quantizedGeometryPool,
+        LoadedMeshPart& part)
+    {
+        std::vector<UINT> lodIndexCounts(mesh.LodIndexCounts.begin(), mesh.LodIndexCounts.end());
+
+        part.mesh = Mesh::CreateFromData(commandList, mesh.Vertices.size(), sizeof(VertexPositionNormalTexture), mesh.Vertices.Data,
+            mesh.Indices.size(), mesh.Indices.Data, lodIndexCounts, geometryPool);
+        if (!mesh.QuantizedVertices.empty())
+        {
+            part.quantizedMesh = Mesh::CreateFromData(commandList, mesh.QuantizedVertices.size(), sizeof(VertexQuantizer::QuantizedVertex),
+                mesh.QuantizedVertices.Data, mesh.Indices.size(), mesh.Indices.Data, lodIndexCounts, quantizedGeometryPool);
+            part.dequantization = mesh.Dequantization;
+            part.quantizationError = mesh.QuantizationError;
+        }
+        part.material = Material::White;
+        part.material.Roughness = mesh.Roughness;
+        part.material.Metalness = mesh.Metalness;
+        part.alphaTested = mesh.AlphaTested;
+		part.boundingBox = mesh.Bounds;
+
+        auto geometry = std::make_shared<LoadedMeshGeometry>();
+        geometry->vertices = mesh.Vertices;
+        geometry->indices = ModelCache::Span<uint32_t>(mesh.Indices.Data, mesh.LodIndexCounts[0]);
+        geometry->meshlets = mesh.Meshlets;
+        geometry->meshletBounds = mesh.MeshletBounds;
+        geometry->meshletVertices = mesh.MeshletVertices;
+        geometry->meshletPrimitives = mesh.MeshletPrimitives;
+        geometry->source = source;
+        part.geometry = std::move(geometry);
+        part.vertexCacheBefore = mesh.VertexCacheBefore;
+        part.vertexCacheAfter = mesh.VertexCacheAfter;
+
+        bool hasDiffuse = false;
+        bool hasRoughness = false;
+        bool hasMetalness = false;
+        LoadTextureFromFile(commandList, modelDir, mesh.DiffuseTexture, part.diffuseTexture, hasDiffuse);
+        LoadTextureFromFile(commandList, modelDir, mesh.RoughnessTexture, part.roughnessTexture, hasRoughness);
+        LoadTextureFromFile(commandList, modelDir, mesh.MetalnessTexture, part.metalnessTexture, hasMetalness);
+
         if (!hasDiffuse)   part.diffuseTexture   = defaultTexture;
         if (!hasRoughness) part.roughnessTexture = defaultTexture;
         if (!hasMetalness) part.metalnessTexture = defaultTexture;
@@ -240,9 +447,319 @@ std::vector<LoadedMeshPart> AssimpLoader::Load(
         {
             part.material.Metalness = 0.0f;
         }
+    }
+
+    // aiMatrix4x4 is row-major for column vectors: the transpose is the same transform for row vectors.
+    XMFLOAT4X4 ToXMFLOAT4X4(const aiMatrix4x4& m)
+    {
+        return XMFLOAT4X4(
+            m.a1, m.b1, m.c1, m.d1,
+            m.a2, m.b2, m.c2, m.d2,
+            m.a3, m.b3, m.c3, m.d3,
+            m.a4, m.b4, m.c4, m.d4);
+    }
+
+    const aiScene* ReadScene(Assimp::Importer& importer, const std::wstring& modelPath, std::filesystem::path& modelDirOut)
+    {
+        std::filesystem::path path(modelPath);
+        if (!std::filesystem::exists(path))
+        {
+            ThrowIfFailed(false, "AssimpLoader: Model file not found.");
+            return nullptr;
+        }
+
+        std::string narrowPath = ToNarrow(path.lexically_normal().wstring());
+        modelDirOut = path.parent_path();
+
+        const unsigned int flags =
+            aiProcess_Triangulate |
+            aiProcess_GenNormals |
+            aiProcess_JoinIdenticalVertices |
+            aiProcess_FlipUVs |
+            aiProcess_MakeLeftHanded |
+            aiProcess_FlipWindingOrder;
+
+        const aiScene* scene = importer.ReadFile(narrowPath, flags);
+        if (!scene || !scene->HasMeshes())
+        {
+            ThrowIfFailed(false, importer.GetErrorString());
+            return nullptr;
+        }
+
+        return scene;
+    }
+
+    // Depth-first, so a node is always after its parent.
+    std::vector<NodeGeometry> ReadNodes(const aiScene* scene)
+    {
+        std::vector<NodeGeometry> nodes;
+        std::vector<std::pair<const aiNode*, uint32_t>> stack;
+        if (scene->mRootNode)
+        {
+            stack.emplace_back(scene->mRootNode, ModelCache::InvalidNode);
+        }
+
+        while (!stack.empty())
+        {
+            const aiNode* aiNode = stack.back().first;
+            uint32_t parent = stack.back().second;
+            stack.pop_back();
+
+            uint32_t node = static_cast<uint32_t>(nodes.size());
+            nodes.push_back({ parent, ToXMFLOAT4X4(aiNode->mTransformation), aiNode->mName.C_Str(), {} });
+
+            for (unsigned int m = 0; m < aiNode->mNumMeshes; ++m)
+            {
+                if (aiNode->mMeshes[m] < scene->mNumMeshes)
+                    nodes.back().meshes.push_back(aiNode->mMeshes[m]);
+            }
+
+            // Reversed, so the children are visited in order.
+            for (unsigned int c = aiNode->mNumChildren; c > 0; --c)
+            {
+                stack.emplace_back(aiNode->mChildren[c - 1], node);
+            }
+        }
+
+        return nodes;
+    }
+
+    // The source file, and for a .gltf its buffers (a .bin of the same name, the usual export). The textures aren't
+    // cached, they are loaded from their files.
+    // @return false if the model can't be read.
+    bool GetCacheKey(const std::filesystem::path& modelPath, uint32_t numLods, uint32_t loaderFlags, ModelCache::Key& key)
+    {
+        if (!ModelCache::HashFile(modelPath.wstring(), key.SourceHash, key.SourceSize))
+            return false;
+
+        std::filesystem::path buffersPath = modelPath;
+        buffersPath.replace_extension(L".bin");
+        uint64_t buffersSize = 0;
+        if (modelPath.extension() == L".gltf" && ModelCache::HashFile(buffersPath.wstring(), key.SourceHash, buffersSize, key.SourceHash))
+        {
+            key.SourceSize += buffersSize;
+        }
+
+        key.NumLods = numLods;
+        key.LoaderFlags = loaderFlags;
+        return true;
+    }
+
+    // GPU resources of the meshes, then the nodes: one part per mesh referenced by a node. source keeps the data of
+    // model (see LoadedMeshGeometry).
+    std::vector<LoadedMeshPart> CreateParts(CommandList& commandList, const ModelCache::ModelData& model, const std::shared_ptr<const void>& source,
+        const std::filesystem::path& modelDir, const Texture& defaultTexture, SceneGraph& sceneGraph, uint32_t parentNode, GeometryPool* geometryPool,
+        GeometryPool* quantizedGeometryPool)
+    {
+        std::vector<LoadedMeshPart> parts;
+
+        // Each mesh is loaded once, the nodes that reference it copy its part (the buffers and the geometry are shared).
+        // The command list isn't free threaded: the GPU resources are created in order.
+        std::vector<LoadedMeshPart> meshParts(model.Meshes.size());
+        for (const auto& mesh : model.Meshes)
+        {
+            if (mesh.IsLoaded)
+                PrefetchTextures(mesh, modelDir);
+        }
+        for (size_t i = 0; i < model.Meshes.size(); ++i)
+        {
+            if (model.Meshes[i].IsLoaded)
+                LoadMeshPart(commandList, model.Meshes[i], source, modelDir, defaultTexture, geometryPool, quantizedGeometryPool, meshParts[i]);
+        }
+
+        std::vector<uint32_t> sceneNodes(model.Nodes.size());
+        for (size_t i = 0; i < model.Nodes.size(); ++i)
+        {
+            const ModelCache::NodeData& nodeData = model.Nodes[i];
+            uint32_t parent = nodeData.Parent == ModelCache::InvalidNode ? parentNode : sceneNodes[nodeData.Parent];
+            uint32_t node = sceneGraph.AddNode(parent, nodeData.Transform, std::string(nodeData.Name));
+            sceneNodes[i] = node;
+
+            for (uint32_t meshIndex : nodeData.Meshes)
+            {
+                if (!model.Meshes[meshIndex].IsLoaded)
+                    continue;
+
+                LoadedMeshPart part = meshParts[meshIndex];
+                part.node = node;
+                parts.push_back(std::move(part));
+            }
+        }
+
+        return parts;
+    }
+}
 
+std::vector<LoadedMeshPart> AssimpLoader::Load(
+    CommandList& commandList,
+    const std::wstring& modelPath,
+    const Texture& defaultTexture)
+{
+    std::vector<LoadedMeshPart> parts;
+
+    Assimp::Importer importer;
+    std::filesystem::path modelDir;
+    const aiScene* scene = ReadScene(importer, modelPath, modelDir);
+    if (!scene)
+        return parts;
+
+    std::vector<bool> isMeshLoaded(scene->mNumMeshes, false);
+    std::vector<MeshGeometry> meshGeometries(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        isMeshLoaded[i] = ReadMeshGeometry(scene->mMeshes[i], meshGeometries[i]);
+        if (isMeshLoaded[i])
+            ReadMeshMaterial(scene, scene->mMeshes[i], meshGeometries[i]);
+    }
+
+    // The world matrices of the nodes relative to the root, from a scene graph of the file alone (same order:
+    // depth-first). The transform of the root itself (eg. a unit scale of the export) is left to the caller.
+    std::vector<NodeGeometry> nodes = ReadNodes(scene);
+    SceneGraph sceneGraph;
+    sceneGraph.Reserve(static_cast<uint32_t>(nodes.size()));
+    for (const auto& node : nodes)
+    {
+        if (node.parent == ModelCache::InvalidNode)
+        {
+            XMFLOAT4X4 identity;
+            XMStoreFloat4x4(&identity, XMMatrixIdentity());
+            sceneGraph.AddNode(SceneGraph::InvalidNode, identity, node.name);
+        }
+        else
+        {
+            sceneGraph.AddNode(node.parent, node.transform, node.name);
+        }
+    }
+    sceneGraph.UpdateWorldMatrices();
+
+    // Kept with the parts, which view their geometry.
+    auto geometriesSource = std::make_shared<std::vector<MeshGeometry>>();
+    std::vector<MeshGeometry>& geometries = *geometriesSource;
+    for (uint32_t node = 0; node < nodes.size(); ++node)
+    {
+        XMMATRIX world = XMLoadFloat4x4(&sceneGraph.GetWorldMatrix(node));
+        for (uint32_t meshIndex : nodes[node].meshes)
+        {
+            if (!isMeshLoaded[meshIndex])
+                continue;
+
+            if (XMMatrixIsIdentity(world))
+                geometries.push_back(meshGeometries[meshIndex]);
+            else
+                geometries.push_back(TransformGeometry(meshGeometries[meshIndex], world));
+            PrefetchTextures(GetMeshData(geometries.back(), true), modelDir);
+        }
+    }
+
+    for (const auto& geometry : geometries)
+    {
+        LoadedMeshPart part;
+        LoadMeshPart(commandList, GetMeshData(geometry, true), geometriesSource, modelDir, defaultTexture, nullptr, nullptr, part);
         parts.push_back(std::move(part));
     }
 
     return parts;
-}
\ No newline at end of file
+}
+
+AssimpLoader::LoadResult AssimpLoader::Load(
+    CommandList& commandList,
+    const std::wstring& modelPath,
+    const Texture& defaultTexture,
+    SceneGraph& sceneGraph,
+    uint32_t parentNode,
+    const LoadOptions& options)
+{
+    LoadResult result;
+    // The nodes of the file are added after the existing ones, their root first.
+    const uint32_t rootNode = sceneGraph.GetNumNodes();
+
+    // Warm start: the processed model, mapped from the cache.
+    std::filesystem::path path(modelPath);
+    std::filesystem::path cachePath;
+    ModelCache::Key cacheKey;
+    if (!options.cacheDirectory.empty())
+    {
+        uint32_t loaderFlags = (options.buildMeshlets ? 1u : 0u) | (options.optimizeVertexCache ? 2u : 0u) | (options.quantizeVertices ? 4u : 0u);
+        if (GetCacheKey(path, options.numLods, loaderFlags, cacheKey))
+        {
+            cachePath = std::filesystem::path(options.cacheDirectory) / path.filename();
+            cachePath += L".meshcache";
+
+            // Kept mapped with the parts, which view their geometry in place.
+            auto cache = std::make_shared<ModelCache>();
+            if (cache->Open(cachePath.wstring(), cacheKey))
+            {
+                result.loadedFromCache = true;
+                result.parts = CreateParts(commandList, cache->GetModel(), cache, path.parent_path(), defaultTexture, sceneGraph, parentNode,
+                    options.geometryPool, options.quantizedGeometryPool);
+                if (sceneGraph.GetNumNodes() > rootNode)
+                    result.rootNode = rootNode;
+                return result;
+            }
+        }
+    }
+
+    Assimp::Importer importer;
+    std::filesystem::path modelDir;
+    const aiScene* scene = ReadScene(importer, modelPath, modelDir);
+    if (!scene)
+        return result;
+
+    std::vector<bool> isMeshLoaded(scene->mNumMeshes, false);
+    // Kept with the parts, which view their geometry.
+    auto geometriesSource = std::make_shared<std::vector<MeshGeometry>>(scene->mNumMeshes);
+    std::vector<MeshGeometry>& geometries = *geometriesSource;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        isMeshLoaded[i] = ReadMeshGeometry(scene->mMeshes[i], geometries[i]);
+        if (isMeshLoaded[i])
+            ReadMeshMaterial(scene, scene->mMeshes[i], geometries[i]);
+    }
+
+    // The meshes are processed independently: one task per mesh, as their sizes vary a lot.
+    if (options.numLods > 1 || options.buildMeshlets || options.optimizeVertexCache || options.quantizeVertices)
+    {
+        Application::Get().GetThreadPool().ParallelFor(scene->mNumMeshes, scene->mNumMeshes,
+            [&](size_t, size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (isMeshLoaded[i])
+                        ProcessMeshGeometry(geometries[i], options.numLods, options.buildMeshlets, options.optimizeVertexCache,
+                            options.quantizeVertices);
+                }
+            });
+    }
+
+    std::vector<NodeGeometry> nodes = ReadNodes(scene);
+
+    ModelCache::ModelData model;
+    for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+    {
+        model.Meshes.push_back(GetMeshData(geometries[i], isMeshLoaded[i]));
+    }
+    for (const auto& node : nodes)
+    {
+        model.Nodes.push_back({ node.parent, node.transform, node.name, node.meshes });
+    }
+
+    // A failed write only costs the next start an import.
+    if (!cachePath.empty())
+    {
+        ModelCache::Write(cachePath.wstring(), cacheKey, model);
+    }
+
+    result.parts = CreateParts(commandList, model, geometriesSource, modelDir, defaultTexture, sceneGraph, parentNode, options.geometryPool,
+        options.quantizedGeometryPool);
+    if (sceneGraph.GetNumNodes() > rootNode)
+        result.rootNode = rootNode;
+
+    // Uploaded, not viewed by the parts.
+    for (MeshGeometry& geometry : geometries)
+    {
+        QuantizedVertexCollection().swap(geometry.quantizedVertices);
+        if (geometry.meshlets)
+            std::vector<uint32_t>().swap(geometry.meshlets->Indices);
+    }
+    return result;
+}
@@ -6,6 +6,11 @@
 #include "Framework/Material/Material.h"
 
 #include <Framework/CommandList.h>
+#include <Framework/Gameplay/ModelCache.h>
+#include <Framework/MeshletBuilder.h>
+#include <Framework/VertexCacheOptimizer.h>
+#include <Framework/VertexQuantizer.h>
+#include <Framework/SceneGraph.h>
 
 #include <DirectXCollision.h>
 
@@ -13,14 +18,42 @@
 #include <vector>
 #include <string>
 
+// CPU geometry of a loaded mesh (object space), eg. for the software occlusion culling: views of the data where the
+// load put it (the buffers of the import, or the mapped cache file), kept alive by source. Loaded with a scene graph,
+// never copied: the parts of the nodes that reference the mesh share it.
+struct LoadedMeshGeometry
+{
+    ModelCache::Span<VertexPositionNormalTexture> vertices;
+    ModelCache::Span<uint32_t> indices;         // The full resolution LOD
+    // Clusters of the full resolution LOD, if built: the indices above (and in the mesh) are in meshlet order.
+    ModelCache::Span<MeshletBuilder::Meshlet> meshlets;
+    ModelCache::Span<MeshletBuilder::Bounds> meshletBounds;
+    ModelCache::Span<uint32_t> meshletVertices;
+    ModelCache::Span<uint32_t> meshletPrimitives;
+    std::shared_ptr<const void> source;
+};
+
 struct LoadedMeshPart
 {
-    std::unique_ptr<Mesh> mesh;
+    std::shared_ptr<Mesh> mesh; // Shared by the parts of the nodes that reference the same mesh
     Texture diffuseTexture;     // Loaded or copied from default
     Texture roughnessTexture;   // R channel = roughness
     Texture metalnessTexture;   // G channel = metalness
     Material material;
     DirectX::BoundingBox boundingBox;
+
+    std::shared_ptr<const LoadedMeshGeometry> geometry;
+    // Of the full resolution LOD before and after the load time optimization, if done.
+    VertexCacheOptimizer::Statistics vertexCacheBefore;
+    VertexCacheOptimizer::Statistics vertexCacheAfter;
+    // Same vertices (and indices) as mesh in VertexQuantized layout, if quantized: the positions are dequantized
+    // with the box of the part.
+    std::shared_ptr<Mesh> quantizedMesh;
+    VertexQuantizer::Dequantization dequantization = {};
+    VertexQuantizer::Error quantizationError;
+    bool alphaTested = false;   // glTF alphaMode MASK or BLEND: doesn't fully cover its triangles
+
+    uint32_t node = SceneGraph::InvalidNode;    // Scene graph node that places the part (object -> world space)
 };
 
 class DX12_FW_API AssimpLoader
@@ -30,8 +63,51 @@ public:
     // commandList: used for CopyVertexBuffer/CopyIndexBuffer and LoadTextureFromFile
     // modelPath: path relative to working dir, e.g. L"Assets/Models/"
     // defaultTexture: used when mesh has no diffuse texture or texture load fails
+    // One part per mesh referenced by a node, with the world matrix of its node relative to the root node of the
+    // file (from a scene graph of the file) baked into its vertices: the transform of the root node itself isn't
+    // applied, the parts are in its space. A mesh referenced by several nodes is copied. LoadedMeshPart::node isn't set.
     static std::vector<LoadedMeshPart> Load(
         CommandList& commandList,
         const std::wstring& modelPath,
         const Texture& defaultTexture);
+
+    // The processing of the meshes of a model load, none by default.
+    struct LoadOptions
+    {
+        // If set, the meshes are sub-allocated from it (see Mesh::CreateFromData)
+        GeometryPool* geometryPool = nullptr;
+        // > 1 simplifies the meshes into up to numLods levels of detail (see MeshSimplifier), on the thread pool
+        uint32_t numLods = 1;
+        // Splits the meshes into clusters (see MeshletBuilder), on the thread pool
+        bool buildMeshlets = false;
+        // Reorders the triangles and vertices of the meshes (see VertexCacheOptimizer), on the thread pool
+        bool optimizeVertexCache = false;
+        // Also encodes the vertices for quantizedMesh (see VertexQuantizer), on the thread pool
+        bool quantizeVertices = false;
+        // If set, the quantized meshes are sub-allocated from it (stride of VertexQuantizer::QuantizedVertex)
+        GeometryPool* quantizedGeometryPool = nullptr;
+        // If set, the processed model is cached there (see ModelCache), for the next loads with the same file and
+        // settings: they skip the import and the processing, the geometry is uploaded from the mapped cache file
+        std::wstring cacheDirectory;
+    };
+
+    struct LoadResult
+    {
+        std::vector<LoadedMeshPart> parts;
+        bool loadedFromCache = false;   // The processed model was mapped from LoadOptions::cacheDirectory
+        // The root node of the file in the scene graph, with the transform of the file (eg. a unit scale of the
+        // export): a caller that places the model in the units of its meshes sets it to identity.
+        uint32_t rootNode = SceneGraph::InvalidNode;
+    };
+
+    // Also adds the node hierarchy of the file to sceneGraph, under parentNode (InvalidNode: as roots).
+    // One part per mesh referenced by a node, with LoadedMeshPart::node set: a mesh referenced by several nodes
+    // gets several parts that share its buffers.
+    static LoadResult Load(
+        CommandList& commandList,
+        const std::wstring& modelPath,
+        const Texture& defaultTexture,
+        SceneGraph& sceneGraph,
+        uint32_t parentNode,
+        const LoadOptions& options);
 };
\ No newline at end of file
@@ -0,0 +1,414 @@
+#include "ModelCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace
+{
+    constexpr uint64_t ArrayAlignment = 16;
+
+    struct ArrayRecord
+    {
+        uint64_t    Offset;     // From the start of the file.
+        uint64_t    Count;      // Elements.
+    };
+
+    struct FileHeader
+    {
+        uint32_t            Magic;
+        uint32_t            Version;
+        ModelCache::Key     Key;
+        uint64_t            FileSize;
+        uint32_t            NumMeshes;
+        uint32_t            NumNodes;
+        uint64_t            MeshesOffset;
+        uint64_t            NodesOffset;
+    };
+
+    struct MeshRecord
+    {
+        uint32_t                            IsLoaded;
+        uint32_t                            AlphaTested;
+        DirectX::XMFLOAT3                   BoundsCenter;
+        DirectX::XMFLOAT3                   BoundsExtents;
+        float                               Roughness;
+        float                               Metalness;
+        VertexQuantizer::Dequantization     Dequantization;
+        VertexQuantizer::Error              QuantizationError;
+        VertexCacheOptimizer::Statistics    VertexCacheBefore;
+        VertexCacheOptimizer::Statistics    VertexCacheAfter;
+        ArrayRecord                         Vertices;
+        ArrayRecord                         Indices;
+        ArrayRecord                         LodIndexCounts;
+        ArrayRecord                         QuantizedVertices;
+        ArrayRecord                         Meshlets;
+        ArrayRecord                         MeshletBounds;
+        ArrayRecord                         MeshletVertices;
+        ArrayRecord                         MeshletPrimitives;
+        ArrayRecord                         DiffuseTexture;
+        ArrayRecord                         RoughnessTexture;
+        ArrayRecord                         MetalnessTexture;
+    };
+
+    struct NodeRecord
+    {
+        uint32_t                Parent;
+        uint32_t                _Padding;
+        DirectX::XMFLOAT4X4     Transform;
+        ArrayRecord             Name;
+        ArrayRecord             Meshes;
+    };
+
+    static_assert( std::is_trivially_copyable<MeshRecord>::value && std::is_trivially_copyable<NodeRecord>::value,
+                   "ModelCache: the records are copied as bytes." );
+    static_assert( sizeof( VertexPositionNormalTexture ) == 32 && sizeof( MeshletBuilder::Meshlet ) == 16 &&
+                   sizeof( MeshletBuilder::Bounds ) == 32, "ModelCache: the file layout changed, increase ModelCache::Version." );
+
+    uint64_t AlignOffset( uint64_t offset )
+    {
+        return ( offset + ArrayAlignment - 1 ) / ArrayAlignment * ArrayAlignment;
+    }
+
+    // The arrays, appended after the records.
+    class FileWriter
+    {
+    public:
+        explicit FileWriter( uint64_t recordsSize )
+            : m_Data( static_cast<size_t>( AlignOffset( recordsSize ) ), 0 )
+        {}
+
+        template<typename T>
+        ArrayRecord Append( const T* data, size_t count )
+        {
+            ArrayRecord record = { 0, count };
+            if ( count == 0 )
+                return record;
+
+            record.Offset = m_Data.size();
+            size_t size = count * sizeof( T );
+            m_Data.resize( static_cast<size_t>( AlignOffset( record.Offset + size ) ), 0 );
+            std::memcpy( m_Data.data() + record.Offset, data, size );
+            return record;
+        }
+
+        template<typename T>
+        ArrayRecord Append( const ModelCache::Span<T>& span ) { return Append( span.Data, span.Count ); }
+        ArrayRecord Append( std::string_view string ) { return Append( string.data(), string.size() ); }
+
+        template<typename T>
+        void WriteRecord( uint64_t offset, const T& record ) { std::memcpy( m_Data.data() + offset, &record, sizeof( T ) ); }
+
+        std::vector<uint8_t>& GetData() { return m_Data; }
+
+    private:
+        std::vector<uint8_t> m_Data;
+    };
+
+    // The arrays, in place in the mapped file.
+    class FileReader
+    {
+    public:
+        FileReader( const uint8_t* data, size_t size )
+            : m_Data( data )
+            , m_Size( size )
+        {}
+
+        // @return false if the array is out of the file or misaligned.
+        template<typename T>
+        bool Read( const ArrayRecord& record, ModelCache::Span<T>& span ) const
+        {
+            span = {};
+            if ( record.Count == 0 )
+                return true;
+
+            if ( record.Offset % alignof( T ) != 0 || record.Offset > m_Size || record.Count > ( m_Size - record.Offset ) / sizeof( T ) )
+                return false;
+
+            span = ModelCache::Span<T>( reinterpret_cast<const T*>( m_Data + record.Offset ), static_cast<size_t>( record.Count ) );
+            return true;
+        }
+
+        bool Read( const ArrayRecord& record, std::string_view& string ) const
+        {
+            ModelCache::Span<char> span;
+            if ( !Read( record, span ) )
+                return false;
+
+            string = std::string_view( span.Data, span.Count );
+            return true;
+        }
+
+    private:
+        const uint8_t*  m_Data;
+        size_t          m_Size;
+    };
+
+    uint64_t RotateLeft( uint64_t x, int bits )
+    {
+        return ( x << bits ) | ( x >> ( 64 - bits ) );
+    }
+
+    constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t HashRound( uint64_t lane, uint64_t word )
+    {
+        return RotateLeft( lane + word * Prime2, 31 ) * Prime1;
+    }
+
+    uint64_t HashBytes( const uint8_t* data, size_t size, uint64_t seed )
+    {
+        const uint8_t* end = data + size;
+        uint64_t hash;
+
+        if ( size >= 32 )
+        {
+            uint64_t lanes[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+            for ( ; end - data >= 32; data += 32 )
+            {
+                for ( int i = 0; i < 4; ++i )
+                {
+                    uint64_t word;
+                    std::memcpy( &word, data + i * 8, 8 );
+                    lanes[i] = HashRound( lanes[i], word );
+                }
+            }
+
+            hash = RotateLeft( lanes[0], 1 ) + RotateLeft( lanes[1], 7 ) + RotateLeft( lanes[2], 12 ) + RotateLeft( lanes[3], 18 );
+            for ( uint64_t lane : lanes )
+            {
+                hash = ( hash ^ HashRound( 0, lane ) ) * Prime1 + Prime4;
+            }
+        }
+        else
+        {
+            hash = seed + Prime5;
+        }
+
+        hash += size;
+
+        for ( ; end - data >= 8; data += 8 )
+        {
+            uint64_t word;
+            std::memcpy( &word, data, 8 );
+            hash = RotateLeft( hash ^ HashRound( 0, word ), 27 ) * Prime1 + Prime4;
+        }
+        for ( ; data < end; ++data )
+        {
+            hash = RotateLeft( hash ^ ( *data * Prime5 ), 11 ) * Prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+}
+
+bool ModelCache::HashFile( const std::wstring& path, uint64_t& hash, uint64_t& size, uint64_t seed )
+{
+    MappedFile file;
+    if ( !file.Open( path ) )
+        return false;
+
+    hash = HashBytes( file.GetData(), file.GetSize(), seed );
+    size = file.GetSize();
+    return true;
+}
+
+bool ModelCache::Write( const std::wstring& path, const Key& key, const ModelData& model )
+{
+    FileHeader header = {};
+    header.Magic = Magic;
+    header.Version = Version;
+    header.Key = key;
+    header.NumMeshes = static_cast<uint32_t>( model.Meshes.size() );
+    header.NumNodes = static_cast<uint32_t>( model.Nodes.size() );
+    header.MeshesOffset = AlignOffset( sizeof( FileHeader ) );
+    header.NodesOffset = AlignOffset( header.MeshesOffset + sizeof( MeshRecord ) * header.NumMeshes );
+
+    FileWriter writer( header.NodesOffset + sizeof( NodeRecord ) * header.NumNodes );
+
+    for ( size_t i = 0; i < model.Meshes.size(); ++i )
+    {
+        const MeshData& mesh = model.Meshes[i];
+
+        MeshRecord record = {};
+        record.IsLoaded = mesh.IsLoaded ? 1 : 0;
+        record.AlphaTested = mesh.AlphaTested ? 1 : 0;
+        record.BoundsCenter = mesh.Bounds.Center;
+        record.BoundsExtents = mesh.Bounds.Extents;
+        record.Roughness = mesh.Roughness;
+        record.Metalness = mesh.Metalness;
+        record.Dequantization = mesh.Dequantization;
+        record.QuantizationError = mesh.QuantizationError;
+        record.VertexCacheBefore = mesh.VertexCacheBefore;
+        record.VertexCacheAfter = mesh.VertexCacheAfter;
+        record.Vertices = writer.Append( mesh.Vertices );
+        record.Indices = writer.Append( mesh.Indices );
+        record.LodIndexCounts = writer.Append( mesh.LodIndexCounts );
+        record.QuantizedVertices = writer.Append( mesh.QuantizedVertices );
+        record.Meshlets = writer.Append( mesh.Meshlets );
+        record.MeshletBounds = writer.Append( mesh.MeshletBounds );
+        record.MeshletVertices = writer.Append( mesh.MeshletVertices );
+        record.MeshletPrimitives = writer.Append( mesh.MeshletPrimitives );
+        record.DiffuseTexture = writer.Append( mesh.DiffuseTexture );
+        record.RoughnessTexture = writer.Append( mesh.RoughnessTexture );
+        record.MetalnessTexture = writer.Append( mesh.MetalnessTexture );
+
+        writer.WriteRecord( header.MeshesOffset + sizeof( MeshRecord ) * i, record );
+    }
+
+    for ( size_t i = 0; i < model.Nodes.size(); ++i )
+    {
+        const NodeData& node = model.Nodes[i];
+
+        NodeRecord record = {};
+        record.Parent = node.Parent;
+        record.Transform = node.Transform;
+        record.Name = writer.Append( node.Name );
+        record.Meshes = writer.Append( node.Meshes );
+
+        writer.WriteRecord( header.NodesOffset + sizeof( NodeRecord ) * i, record );
+    }
+
+    std::vector<uint8_t>& data = writer.GetData();
+    header.FileSize = data.size();
+    writer.WriteRecord( 0, header );
+
+    std::error_code error;
+    std::filesystem::path filePath( path );
+    if ( filePath.has_parent_path() )
+    {
+        std::filesystem::create_directories( filePath.parent_path(), error );
+    }
+
+    std::filesystem::path tempPath = filePath;
+    tempPath += L".tmp";
+    {
+        std::ofstream file( tempPath, std::ios::binary | std::ios::trunc );
+        if ( !file.write( reinterpret_cast<const char*>( data.data() ), static_cast<std::streamsize>( data.size() ) ) )
+        {
+            file.close();
+            std::filesystem::remove( tempPath, error );
+            return false;
+        }
+    }
+
+    std::filesystem::rename( tempPath, filePath, error );
+    if ( error )
+    {
+        std::filesystem::remove( tempPath, error );
+        return false;
+    }
+
+    return true;
+}
+
+bool ModelCache::Open( const std::wstring& path, const Key& key )
+{
+    Close();
+
+    if ( !m_File.Open( path ) )
+        return false;
+
+    const uint8_t* data = m_File.GetData();
+    size_t size = m_File.GetSize();
+
+    FileHeader header;
+    if ( size < sizeof( FileHeader ) )
+    {
+        Close();
+        return false;
+    }
+    std::memcpy( &header, data, sizeof( FileHeader ) );
+
+    if ( header.Magic != Magic || header.Version != Version || !( header.Key == key ) || header.FileSize != size ||
+         header.MeshesOffset % ArrayAlignment != 0 || header.NodesOffset % ArrayAlignment != 0 ||
+         header.MeshesOffset + sizeof( MeshRecord ) * header.NumMeshes > size ||
+         header.NodesOffset + sizeof( NodeRecord ) * header.NumNodes > size )
+    {
+        Close();
+        return false;
+    }
+
+    FileReader reader( data, size );
+    bool isValid = true;
+
+    m_Model.Meshes.resize( header.NumMeshes );
+    for ( uint32_t i = 0; i < header.NumMeshes && isValid; ++i )
+    {
+        const MeshRecord& record = *reinterpret_cast<const MeshRecord*>( data + header.MeshesOffset + sizeof( MeshRecord ) * i );
+        MeshData& mesh = m_Model.Meshes[i];
+
+        mesh.IsLoaded = record.IsLoaded != 0;
+        mesh.AlphaTested = record.AlphaTested != 0;
+        mesh.Bounds = DirectX::BoundingBox( record.BoundsCenter, record.BoundsExtents );
+        mesh.Roughness = record.Roughness;
+        mesh.Metalness = record.Metalness;
+        mesh.Dequantization = record.Dequantization;
+        mesh.QuantizationError = record.QuantizationError;
+        mesh.VertexCacheBefore = record.VertexCacheBefore;
+        mesh.VertexCacheAfter = record.VertexCacheAfter;
+
+        isValid = reader.Read( record.Vertices, mesh.Vertices ) &&
+                  reader.Read( record.Indices, mesh.Indices ) &&
+                  reader.Read( record.LodIndexCounts, mesh.LodIndexCounts ) &&
+                  reader.Read( record.QuantizedVertices, mesh.QuantizedVertices ) &&
+                  reader.Read( record.Meshlets, mesh.Meshlets ) &&
+                  reader.Read( record.MeshletBounds, mesh.MeshletBounds ) &&
+                  reader.Read( record.MeshletVertices, mesh.MeshletVertices ) &&
+                  reader.Read( record.MeshletPrimitives, mesh.MeshletPrimitives ) &&
+                  reader.Read( record.DiffuseTexture, mesh.DiffuseTexture ) &&
+                  reader.Read( record.RoughnessTexture, mesh.RoughnessTexture ) &&
+                  reader.Read( record.MetalnessTexture, mesh.MetalnessTexture );
+
+        // The draws trust the LOD ranges and the quantized copy.
+        uint64_t numIndices = 0;
+        for ( uint32_t count : mesh.LodIndexCounts )
+        {
+            numIndices += count;
+        }
+        isValid = isValid && numIndices == mesh.Indices.size() &&
+                  ( mesh.QuantizedVertices.empty() || mesh.QuantizedVertices.size() == mesh.Vertices.size() ) &&
+                  ( !mesh.IsLoaded || ( !mesh.Vertices.empty() && !mesh.LodIndexCounts.empty() && mesh.LodIndexCounts[0] > 0 ) );
+    }
+
+    m_Model.Nodes.resize( header.NumNodes );
+    for ( uint32_t i = 0; i < header.NumNodes && isValid; ++i )
+    {
+        const NodeRecord& record = *reinterpret_cast<const NodeRecord*>( data + header.NodesOffset + sizeof( NodeRecord ) * i );
+        NodeData& node = m_Model.Nodes[i];
+
+        node.Parent = record.Parent;
+        node.Transform = record.Transform;
+        isValid = reader.Read( record.Name, node.Name ) && reader.Read( record.Meshes, node.Meshes ) &&
+                  ( node.Parent == InvalidNode || node.Parent < i );
+
+        for ( uint32_t mesh : node.Meshes )
+        {
+            isValid = isValid && mesh < header.NumMeshes;
+        }
+    }
+
+    if ( !isValid )
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void ModelCache::Close()
+{
+    m_Model = {};
+    m_File.Close();
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+// Binary cache of a loaded model (the results of AssimpLoader::Load: the processed geometry, bounds, material parameters,
+// texture paths and node hierarchy), so a warm start skips the import and the load time processing.
+// --
+// File: a header, the mesh records, the node records, then the arrays, each at a 16 byte aligned offset. The file is
+// memory mapped and its arrays are used in place: the vertices and indices go from the mapped pages to the upload
+// buffers, with no copy in between. The layout is the one of the structs below (little endian, x64): Version changes
+// with it.
+// --
+// A file is only valid for its Key (the hash and size of the source, the loader settings that change the content):
+// a mismatch, a truncated or a foreign file is a miss, the caller imports the source and writes the cache again.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <Framework/Material/Mesh.h>
+#include <Framework/MappedFile.h>
+#include <Framework/MeshletBuilder.h>
+#include <Framework/VertexCacheOptimizer.h>
+#include <Framework/VertexQuantizer.h>
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class DX12_FW_API ModelCache
+{
+public:
+    static constexpr uint32_t Magic = 0x434D5844;   // "DXMC"
+    static constexpr uint32_t Version = 1;
+    static constexpr uint32_t InvalidNode = UINT32_MAX;
+
+    // Elements in place, in the mapped file (or in the vectors of the caller, for Write).
+    template<typename T>
+    struct Span
+    {
+        const T*    Data = nullptr;
+        size_t      Count = 0;
+
+        Span() = default;
+        Span( const T* data, size_t count ) : Data( data ), Count( count ) {}
+        Span( const std::vector<T>& vector ) : Data( vector.data() ), Count( vector.size() ) {}
+
+        const T*    begin() const { return Data; }
+        const T*    end() const { return Data + Count; }
+        bool        empty() const { return Count == 0; }
+        size_t      size() const { return Count; }
+        const T&    operator[]( size_t i ) const { return Data[i]; }
+    };
+
+    struct Key
+    {
+        uint64_t    SourceHash = 0;     // HashFile of the source file(s).
+        uint64_t    SourceSize = 0;
+        uint32_t    NumLods = 0;
+        uint32_t    LoaderFlags = 0;    // The processing steps of the loader.
+
+        bool operator==( const Key& other ) const
+        {
+            return SourceHash == other.SourceHash && SourceSize == other.SourceSize && NumLods == other.NumLods &&
+                   LoaderFlags == other.LoaderFlags;
+        }
+    };
+
+    // A mesh of the source, processed. IsLoaded is false for a mesh with nothing to draw (the rest is empty).
+    struct MeshData
+    {
+        bool                                    IsLoaded = false;
+        DirectX::BoundingBox                    Bounds;
+        Span<VertexPositionNormalTexture>       Vertices;
+        Span<uint32_t>                          Indices;            // Every LOD, back to back, the full resolution first.
+        Span<uint32_t>                          LodIndexCounts;
+        // If quantized.
+        Span<VertexQuantizer::QuantizedVertex>  QuantizedVertices;
+        VertexQuantizer::Dequantization         Dequantization = {};
+        VertexQuantizer::Error                  QuantizationError;
+        // If built: the meshlet indices are the full resolution LOD of Indices.
+        Span<MeshletBuilder::Meshlet>           Meshlets;
+        Span<MeshletBuilder::Bounds>            MeshletBounds;
+        Span<uint32_t>                          MeshletVertices;
+        Span<uint32_t>                          MeshletPrimitives;
+        VertexCacheOptimizer::Statistics        VertexCacheBefore;
+        VertexCacheOptimizer::Statistics        VertexCacheAfter;
+        // Material: the factors of the source, the texture paths relative to the model directory (empty: none).
+        float                                   Roughness = 0.5f;
+        float                                   Metalness = 0.0f;
+        bool                                    AlphaTested = false;
+        std::string_view                        DiffuseTexture;
+        std::string_view                        RoughnessTexture;
+        std::string_view                        MetalnessTexture;
+    };
+
+    // Depth-first: a node comes after its parent.
+    struct NodeData
+    {
+        uint32_t                Parent = InvalidNode;   // Index in the nodes.
+        DirectX::XMFLOAT4X4     Transform;              // Row vectors.
+        std::string_view        Name;
+        Span<uint32_t>          Meshes;                 // Indices in the meshes.
+    };
+
+    struct ModelData
+    {
+        std::vector<MeshData>   Meshes;
+        std::vector<NodeData>   Nodes;
+    };
+
+    // 64-bit hash of the content of a file (xxHash64 rounds over 4 lanes, a few GB/s), continued from seed.
+    // @return false if the file can't be read.
+    static bool HashFile( const std::wstring& path, uint64_t& hash, uint64_t& size, uint64_t seed = 0 );
+
+    // Writes through a temporary file, renamed at the end: a failed or interrupted write never leaves a partial cache.
+    // Creates the directory of the file if needed.
+    // @return false if the file can't be written.
+    static bool Write( const std::wstring& path, const Key& key, const ModelData& model );
+
+    // Maps the file and checks it against key.
+    // @return false on a miss (no file, other key or version, inconsistent content), the cache is then closed.
+    bool Open( const std::wstring& path, const Key& key );
+    void Close();
+
+    bool                IsOpen() const { return m_File.IsOpen(); }
+    // The spans point into the mapped file: valid until Close.
+    const ModelData&    GetModel() const { return m_Model; }
+    size_t              GetFileSize() const { return m_File.GetSize(); }
+
+private:
+    MappedFile  m_File;
+    ModelData   m_Model;
+};
@@ -0,0 +1,236 @@
+#include "GpuCulling.h"
+
+#include <Framework/CommandList.h>
+#include <Framework/IndirectDrawBuilder.h>
+
+#include <Framework/PSOs/Culling/BuildHiZPSO.h>
+#include <Framework/PSOs/Culling/CullInstancesPSO.h>
+
+#include <Framework/3RD_Party/D3D/d3dx12.h>
+
+#include <exception>
+
+static_assert( sizeof( CullInstancesCB ) == 384, "CullInstancesCB must match CullConstants in CullInstances_CS.hlsl." );
+
+namespace
+{
+    const uint32_t CullGroupSize = 64;      // GROUP_SIZE in CullInstances_CS.hlsl
+    const uint32_t HiZBlockSize = 8;        // BLOCK_SIZE in BuildHiZ_CS.hlsl
+
+    uint32_t DivideRoundingUp( uint32_t value, uint32_t divisor )
+    {
+        return ( value + divisor - 1 ) / divisor;
+    }
+}
+
+GpuCulling::GpuCulling()
+    : m_BuildHiZPSO( std::make_unique<BuildHiZPSO>() )
+    , m_CullInstancesPSO( std::make_unique<CullInstancesPSO>() )
+    , m_Bounds( L"Culling Instance Bounds" )
+    , m_Cones( L"Culling Instance Cones" )
+    , m_HasCones( false )
+    , m_InstanceFlags( L"Culling Instance Flags" )
+    , m_PhaseCommands{ StructuredBuffer( L"Culled Commands Phase 1" ), StructuredBuffer( L"Culled Commands Phase 2" ) }
+    , m_NumInstances( 0 )
+    , m_DepthWidth( 0 )
+    , m_DepthHeight( 0 )
+    , m_HiZWidth( 0 )
+    , m_HiZHeight( 0 )
+    , m_HiZNumMips( 0 )
+    , m_FrustumView{}
+    , m_HiZView{}
+    , m_CameraPosition( 0.0f, 0.0f, 0.0f )
+    , m_HiZValid( false )
+{}
+
+GpuCulling::~GpuCulling()
+{}
+
+void GpuCulling::SetInstances( CommandList& commandList, const std::vector<CullingMath::InstanceBounds>& bounds )
+{
+    // The shader always has a cone buffer bound, it's not read.
+    UploadInstances( commandList, bounds, { CullingMath::InstanceCone{} }, false );
+}
+
+void GpuCulling::SetInstances( CommandList& commandList, const std::vector<CullingMath::InstanceBounds>& bounds,
+                               const std::vector<CullingMath::InstanceCone>& cones )
+{
+    if ( cones.size() != bounds.size() )
+    {
+        throw std::exception( "GpuCulling: one cone per instance is required." );
+    }
+
+    UploadInstances( commandList, bounds, cones, true );
+}
+
+void GpuCulling::UploadInstances( CommandList& commandList, const std::vector<CullingMath::InstanceBounds>& bounds,
+                                  const std::vector<CullingMath::InstanceCone>& cones, bool hasCones )
+{
+    m_NumInstances = static_cast<uint32_t>( bounds.size() );
+    m_HasCones = hasCones;
+    if ( m_NumInstances == 0 )
+        return;
+
+    commandList.CopyStructuredBuffer( m_Bounds, bounds );
+    commandList.CopyStructuredBuffer( m_Cones, cones );
+    commandList.CopyStructuredBuffer( m_InstanceFlags, m_NumInstances, sizeof( uint32_t ), nullptr );
+
+    for ( auto& commands : m_PhaseCommands )
+    {
+        commandList.CopyStructuredBuffer( commands, m_NumInstances, IndirectDrawBuilder::GetByteStride(), nullptr );
+    }
+
+    // The flags of the previous instances don't mean anything for the new ones.
+    m_HiZValid = false;
+}
+
+void GpuCulling::Resize( uint32_t depthWidth, uint32_t depthHeight )
+{
+    if ( m_HiZ && depthWidth == m_DepthWidth && depthHeight == m_DepthHeight )
+        return;
+
+    m_DepthWidth = depthWidth;
+    m_DepthHeight = depthHeight;
+    CullingMath::GetHiZSize( depthWidth, depthHeight, m_HiZWidth, m_HiZHeight, m_HiZNumMips );
+
+    auto hizDesc = CD3DX12_RESOURCE_DESC::Tex2D( DXGI_FORMAT_R32_FLOAT, m_HiZWidth, m_HiZHeight, 1, static_cast<UINT16>( m_HiZNumMips ) );
+    hizDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+
+    // The command lists that still use the previous pyramid keep a reference to it.
+    m_HiZ = std::make_unique<Texture>( hizDesc, nullptr, TextureUsage::Depth, L"Hi-Z Pyramid" );
+    m_HiZValid = false;
+}
+
+void GpuCulling::CullPhase1( CommandList& commandList, const StructuredBuffer& commands, const DirectX::XMFLOAT4X4& viewProjection,
+                             const DirectX::XMFLOAT3& cameraPosition )
+{
+    m_FrustumView = CullingMath::MakeView( viewProjection );
+    m_CameraPosition = cameraPosition;
+
+    Cull( commandList, commands, 1, m_HiZValid );
+}
+
+void GpuCulling::CullPhase2( CommandList& commandList, const StructuredBuffer& commands )
+{
+    if ( !m_HiZValid )
+    {
+        throw std::exception( "GpuCulling: BuildHiZ must be called before CullPhase2." );
+    }
+
+    Cull( commandList, commands, 2, true );
+}
+
+void GpuCulling::Cull( CommandList& commandList, const StructuredBuffer& commands, uint32_t phase, bool useHiZ )
+{
+    if ( !m_HiZ )
+    {
+        throw std::exception( "GpuCulling: Resize must be called before culling." );
+    }
+
+    const StructuredBuffer& outCommands = m_PhaseCommands[phase - 1];
+    const ByteAddressBuffer& counter = outCommands.GetCounterBuffer();
+
+    // Nothing appended yet.
+    commandList.WriteBufferImmediate( counter, 0, 0 );
+
+    if ( m_NumInstances == 0 )
+        return;
+
+    commandList.SetPipelineState( m_CullInstancesPSO->GetPipelineState() );
+    commandList.SetComputeRootSignature( m_CullInstancesPSO->GetRootSignature() );
+
+    CullInstancesCB cullCB = {};
+    cullCB.FrustumView = m_FrustumView;
+    cullCB.HiZView = m_HiZView;
+    cullCB.DepthTexelSize = DirectX::XMFLOAT2( 2.0f / static_cast<float>( m_DepthWidth ), 2.0f / static_cast<float>( m_DepthHeight ) );
+    cullCB.DepthWidth = m_DepthWidth;
+    cullCB.DepthHeight = m_DepthHeight;
+    cullCB.HiZWidth = m_HiZWidth;
+    cullCB.HiZHeight = m_HiZHeight;
+    cullCB.HiZNumMips = m_HiZNumMips;
+    cullCB.UseHiZ = useHiZ ? 1 : 0;
+    cullCB.NumInstances = m_NumInstances;
+    cullCB.Phase = phase;
+    cullCB.UseCones = m_HasCones ? 1 : 0;
+    cullCB.CameraPosition = m_CameraPosition;
+
+    commandList.SetComputeDynamicConstantBuffer( CullInstancesRS::CullCB, cullCB );
+
+    // The pyramid is bound even when it's not used (undefined content on the first frame).
+    commandList.SetShaderResourceView( CullInstancesRS::Inputs, 0, m_Bounds, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+    commandList.SetShaderResourceView( CullInstancesRS::Inputs, 1, commands, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+    commandList.SetShaderResourceView( CullInstancesRS::Inputs, 2, *m_HiZ, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+    commandList.SetShaderResourceView( CullInstancesRS::Inputs, 3, m_Cones, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+
+    commandList.SetUnorderedAccessView( CullInstancesRS::Outputs, 0, m_InstanceFlags, D3D12_RESOURCE_STATE_UNORDERED_ACCESS );
+    commandList.SetUnorderedAccessView( CullInstancesRS::Outputs, 1, outCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS );
+    // The counter is bound through the UAV of the commands.
+    commandList.TransitionBarrier( counter, D3D12_RESOURCE_STATE_UNORDERED_ACCESS );
+
+    commandList.Dispatch( DivideRoundingUp( m_NumInstances, CullGroupSize ) );
+
+    // Phase 2 reads the flags written by phase 1.
+    commandList.UAVBarrier( m_InstanceFlags );
+}
+
+void GpuCulling::BuildHiZ( CommandList& commandList, const Texture& depthTexture )
+{
+    if ( !m_HiZ )
+    {
+        throw std::exception( "GpuCulling: Resize must be called before BuildHiZ." );
+    }
+
+    auto depthDesc = depthTexture.GetD3D12ResourceDesc();
+    if ( depthDesc.Width != m_DepthWidth || depthDesc.Height != m_DepthHeight )
+    {
+        throw std::exception( "GpuCulling: the depth buffer doesn't have the size of the pyramid." );
+    }
+
+    commandList.SetPipelineState( m_BuildHiZPSO->GetPipelineState() );
+    commandList.SetComputeRootSignature( m_BuildHiZPSO->GetRootSignature() );
+
+    BuildHiZCB buildHiZCB;
+    buildHiZCB.SrcWidth = m_DepthWidth;
+    buildHiZCB.SrcHeight = m_DepthHeight;
+
+    for ( uint32_t mip = 0; mip < m_HiZNumMips; ++mip )
+    {
+        buildHiZCB.DstWidth = std::max<uint32_t>( 1, m_HiZWidth >> mip );
+        buildHiZCB.DstHeight = std::max<uint32_t>( 1, m_HiZHeight >> mip );
+
+        commandList.SetCompute32BitConstants( BuildHiZRS::BuildHiZCB, buildHiZCB );
+
+        if ( mip == 0 )
+        {
+            // The default SRV of the depth texture (R32_FLOAT).
+            commandList.SetShaderResourceView( BuildHiZRS::SrcMip, 0, depthTexture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE );
+        }
+        else
+        {
+            D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+            srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+            srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            srvDesc.Texture2D.MostDetailedMip = mip - 1;
+            srvDesc.Texture2D.MipLevels = 1;
+
+            commandList.SetShaderResourceView( BuildHiZRS::SrcMip, 0, *m_HiZ, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, mip - 1, 1, &srvDesc );
+        }
+
+        D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+        uavDesc.Format = DXGI_FORMAT_R32_FLOAT;
+        uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
+        uavDesc.Texture2D.MipSlice = mip;
+
+        commandList.SetUnorderedAccessView( BuildHiZRS::DstMip, 0, *m_HiZ, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, mip, 1, &uavDesc );
+
+        commandList.Dispatch( DivideRoundingUp( buildHiZCB.DstWidth, HiZBlockSize ), DivideRoundingUp( buildHiZCB.DstHeight, HiZBlockSize ) );
+
+        // The transition of the mip to a shader resource (next iteration, or the cull) waits for the writes.
+        buildHiZCB.SrcWidth = buildHiZCB.DstWidth;
+        buildHiZCB.SrcHeight = buildHiZCB.DstHeight;
+    }
+
+    m_HiZView = m_FrustumView;
+    m_HiZValid = true;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+// Two-phase GPU instance culling: frustum test + occlusion test against a max-depth (Hi-Z) pyramid.
+// The commands of an ExecuteIndirect argument buffer (IndirectDrawBuilder::DrawCommand, one per instance) are compacted
+// into the commands of the visible instances. The count is the UAV counter of the output buffer.
+// --
+// Per frame:
+//   1. CullPhase1 - frustum test, then occlusion against the pyramid of the previous frame. Draw GetCommands(0).
+//   2. BuildHiZ   - max-depth pyramid of the depth buffer (the phase 1 draws).
+//   3. CullPhase2 - the instances occluded in phase 1 are tested again against the new pyramid. Draw GetCommands(1).
+// The pyramid is kept for the next frame. It doesn't have the phase 2 draws in it, which only makes it conservative.
+// The three steps only record compute work, so they can run on the compute queue (e.g. as frame graph compute passes,
+// see GetInstanceFlags and GetHiZ for the resources they use).
+// The instances can also be clusters of triangles (MeshletBuilder) with a normal cone: the clusters that face away
+// from the camera are dropped in phase 1, before the frustum test.
+// CPU reference of the math: CullingMath.
+
+#include <Framework/CullingMath.h>
+
+#include <Framework/Material/StructuredBuffer.h>
+#include <Framework/Material/Texture.h>
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <memory>
+#include <vector>
+
+class CommandList;
+class BuildHiZPSO;
+class CullInstancesPSO;
+
+class DX12_FW_API GpuCulling
+{
+public:
+    GpuCulling();
+    ~GpuCulling();
+
+    // Upload the world-space bounds of the instances, in the order of the commands that are culled.
+    void SetInstances(CommandList& commandList, const std::vector<CullingMath::InstanceBounds>& bounds);
+    // With the normal cones of the instances (same order), for the backface test.
+    void SetInstances(CommandList& commandList, const std::vector<CullingMath::InstanceBounds>& bounds,
+                      const std::vector<CullingMath::InstanceCone>& cones);
+
+    // (Re)create the pyramid for the size of the depth buffer. The previous pyramid is dropped if the size changed.
+    void Resize(uint32_t depthWidth, uint32_t depthHeight);
+
+    // @param commands - The commands of all instances (one per instance).
+    // @param cameraPosition - World space, for the backface test of the instances with cones.
+    void CullPhase1(CommandList& commandList, const StructuredBuffer& commands, const DirectX::XMFLOAT4X4& viewProjection,
+                    const DirectX::XMFLOAT3& cameraPosition = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+    // The depth buffer must have the size passed to Resize.
+    void BuildHiZ(CommandList& commandList, const Texture& depthTexture);
+    void CullPhase2(CommandList& commandList, const StructuredBuffer& commands);
+
+    // The commands of the instances drawn in a phase (0 or 1). Pass GetCounterBuffer() as the count buffer of ExecuteIndirect.
+    const StructuredBuffer& GetCommands(uint32_t phase) const
+    {
+        return m_PhaseCommands[phase];
+    }
+
+    // Written by both phases (phase 2 tests again the instances occluded in phase 1).
+    const StructuredBuffer& GetInstanceFlags() const
+    {
+        return m_InstanceFlags;
+    }
+
+    // Written by BuildHiZ, read by both phases. Null until Resize.
+    const Texture* GetHiZ() const
+    {
+        return m_HiZ.get();
+    }
+
+    uint32_t GetNumInstances() const
+    {
+        return m_NumInstances;
+    }
+
+    bool HasCones() const
+    {
+        return m_HasCones;
+    }
+
+    // The pyramid of the previous frame is used in phase 1.
+    bool HasHiZ() const
+    {
+        return m_HiZValid;
+    }
+
+    // Drop the pyramid, eg. after a camera cut (the first phase only does the frustum test).
+    void InvalidateHiZ()
+    {
+        m_HiZValid = false;
+    }
+
+private:
+    void UploadInstances(CommandList& commandList, const std::vector<CullingMath::InstanceBounds>& bounds,
+                         const std::vector<CullingMath::InstanceCone>& cones, bool hasCones);
+    void Cull(CommandList& commandList, const StructuredBuffer& commands, uint32_t phase, bool useHiZ);
+
+    std::unique_ptr<BuildHiZPSO>        m_BuildHiZPSO;
+    std::unique_ptr<CullInstancesPSO>   m_CullInstancesPSO;
+
+    StructuredBuffer                    m_Bounds;
+    StructuredBuffer                    m_Cones;        // A single unused cone without the backface test.
+    bool                                m_HasCones;
+    StructuredBuffer                    m_InstanceFlags;
+    StructuredBuffer                    m_PhaseCommands[2];
+    uint32_t                            m_NumInstances;
+
+    std::unique_ptr<Texture>            m_HiZ;
+    uint32_t                            m_DepthWidth;
+    uint32_t                            m_DepthHeight;
+    uint32_t                            m_HiZWidth;
+    uint32_t                            m_HiZHeight;
+    uint32_t                            m_HiZNumMips;
+
+    CullingMath::View                   m_FrustumView;  // The view of the frame.
+    CullingMath::View                   m_HiZView;      // The view the pyramid was built with.
+    DirectX::XMFLOAT3                   m_CameraPosition;
+    bool                                m_HiZValid;
+};
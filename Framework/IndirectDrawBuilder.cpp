@@ -0,0 +1,95 @@
+#include "IndirectDrawBuilder.h"
+
+#include <exception>
+
+// The command signature describes the arguments back to back.
+static_assert( sizeof( IndirectDrawBuilder::DrawCommand ) ==
+    sizeof( D3D12_VERTEX_BUFFER_VIEW ) + sizeof( D3D12_INDEX_BUFFER_VIEW ) + sizeof( uint32_t ) + sizeof( D3D12_DRAW_INDEXED_ARGUMENTS ),
+    "IndirectDrawBuilder::DrawCommand must not have padding." );
+
+namespace
+{
+    uint32_t GetIndexSize( DXGI_FORMAT format )
+    {
+        switch ( format )
+        {
+        case DXGI_FORMAT_R16_UINT:
+            return 2;
+        case DXGI_FORMAT_R32_UINT:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+}
+
+uint32_t IndirectDrawBuilder::AddDraw( const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView,
+                                       const D3D12_INDEX_BUFFER_VIEW& indexBufferView,
+                                       uint32_t indexCount,
+                                       uint32_t startIndex,
+                                       int32_t baseVertex,
+                                       uint32_t instanceCount,
+                                       uint32_t drawIndex )
+{
+    if ( vertexBufferView.BufferLocation == 0 || vertexBufferView.StrideInBytes == 0 )
+    {
+        throw std::exception( "IndirectDrawBuilder: invalid vertex buffer view." );
+    }
+
+    uint32_t indexSize = GetIndexSize( indexBufferView.Format );
+    if ( indexBufferView.BufferLocation == 0 || indexSize == 0 )
+    {
+        throw std::exception( "IndirectDrawBuilder: invalid index buffer view." );
+    }
+
+    uint64_t endIndex = static_cast<uint64_t>( startIndex ) + indexCount;
+    if ( indexCount == 0 || endIndex * indexSize > indexBufferView.SizeInBytes )
+    {
+        throw std::exception( "IndirectDrawBuilder: the draw is outside of the index buffer." );
+    }
+
+    uint32_t numVertices = vertexBufferView.SizeInBytes / vertexBufferView.StrideInBytes;
+    if ( baseVertex < 0 || static_cast<uint32_t>( baseVertex ) >= numVertices )
+    {
+        throw std::exception( "IndirectDrawBuilder: the base vertex is outside of the vertex buffer." );
+    }
+
+    DrawCommand command = {};
+    command.VertexBufferView = vertexBufferView;
+    command.IndexBufferView = indexBufferView;
+    command.DrawIndex = ( drawIndex == CommandIndex ) ? static_cast<uint32_t>( m_Commands.size() ) : drawIndex;
+    command.DrawArguments.IndexCountPerInstance = indexCount;
+    command.DrawArguments.InstanceCount = instanceCount;
+    command.DrawArguments.StartIndexLocation = startIndex;
+    command.DrawArguments.BaseVertexLocation = baseVertex;
+    command.DrawArguments.StartInstanceLocation = 0;
+
+    m_Commands.push_back( command );
+
+    return command.DrawIndex;
+}
+
+void IndirectDrawBuilder::Clear()
+{
+    m_Commands.clear();
+}
+
+std::vector<D3D12_INDIRECT_ARGUMENT_DESC> IndirectDrawBuilder::GetArgumentDescs( uint32_t drawIndexRootParameter )
+{
+    std::vector<D3D12_INDIRECT_ARGUMENT_DESC> argumentDescs( 4 );
+
+    argumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW;
+    argumentDescs[0].VertexBuffer.Slot = 0;
+
+    argumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW;
+
+    argumentDescs[2].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    argumentDescs[2].Constant.RootParameterIndex = drawIndexRootParameter;
+    argumentDescs[2].Constant.DestOffsetIn32BitValues = 0;
+    argumentDescs[2].Constant.Num32BitValuesToSet = 1;
+
+    // The draw arguments must be the last argument of the command.
+    argumentDescs[3].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    return argumentDescs;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Builds the argument buffer of an ExecuteIndirect draw: one DrawCommand per draw.
+// The command signature must be created from GetArgumentDescs() / GetByteStride(), so it matches the layout.
+// --
+// Each command binds its own vertex and index buffer, and sets a 32-bit root constant (the draw index)
+// that the shaders use to fetch the per-draw data (material, texture indices) from a structured buffer.
+// No device is used, the builder can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <d3d12.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API IndirectDrawBuilder
+{
+public:
+    // The draw index of a command is its position in the argument buffer, unless several commands share the same
+    // per-draw data (eg. the clusters of a mesh).
+    static constexpr uint32_t CommandIndex = UINT32_MAX;
+
+    // The arguments are tightly packed (no padding), in the order of GetArgumentDescs().
+    struct DrawCommand
+    {
+        D3D12_VERTEX_BUFFER_VIEW        VertexBufferView;
+        D3D12_INDEX_BUFFER_VIEW         IndexBufferView;
+        uint32_t                        DrawIndex;
+        D3D12_DRAW_INDEXED_ARGUMENTS    DrawArguments;
+    };
+
+    // Append a draw. Throws if the draw reads outside of the index buffer.
+    // @return the draw index of the command (by default its position in the argument buffer).
+    uint32_t AddDraw( const D3D12_VERTEX_BUFFER_VIEW& vertexBufferView,
+                      const D3D12_INDEX_BUFFER_VIEW& indexBufferView,
+                      uint32_t indexCount,
+                      uint32_t startIndex = 0,
+                      int32_t baseVertex = 0,
+                      uint32_t instanceCount = 1,
+                      uint32_t drawIndex = CommandIndex );
+
+    void Clear();
+
+    const std::vector<DrawCommand>& GetCommands() const { return m_Commands; }
+    uint32_t                        GetNumCommands() const { return static_cast<uint32_t>( m_Commands.size() ); }
+    size_t                          GetByteSize() const { return m_Commands.size() * sizeof( DrawCommand ); }
+
+    // The indirect arguments of a DrawCommand (see D3D12_COMMAND_SIGNATURE_DESC).
+    // @param drawIndexRootParameter - The 32-bit constants root parameter that receives the draw index.
+    static std::vector<D3D12_INDIRECT_ARGUMENT_DESC> GetArgumentDescs( uint32_t drawIndexRootParameter );
+    static uint32_t GetByteStride() { return static_cast<uint32_t>( sizeof( DrawCommand ) ); }
+
+private:
+    std::vector<DrawCommand> m_Commands;
+};
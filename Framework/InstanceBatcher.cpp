@@ -0,0 +1,56 @@
+#include "InstanceBatcher.h"
+
+void InstanceBatcher::Reserve( uint32_t numDraws )
+{
+    m_DrawItems.reserve( numDraws );
+    m_DrawBatches.reserve( numDraws );
+    m_Instances.reserve( numDraws );
+}
+
+void InstanceBatcher::Clear()
+{
+    m_DrawItems.clear();
+    m_DrawBatches.clear();
+    m_Batches.clear();
+    m_Instances.clear();
+    m_BatchIndices.clear();
+}
+
+void InstanceBatcher::AddDraw( uint64_t batchKey, uint32_t item )
+{
+    auto result = m_BatchIndices.insert( { batchKey, static_cast<uint32_t>( m_Batches.size() ) } );
+    if ( result.second )
+    {
+        m_Batches.push_back( { batchKey, 0, 0 } );
+    }
+
+    uint32_t batch = result.first->second;
+    ++m_Batches[batch].NumInstances;
+
+    m_DrawItems.push_back( item );
+    m_DrawBatches.push_back( batch );
+}
+
+void InstanceBatcher::Build()
+{
+    // Exclusive prefix sum of the instance counts.
+    uint32_t firstInstance = 0;
+    for ( Batch& batch : m_Batches )
+    {
+        batch.FirstInstance = firstInstance;
+        firstInstance += batch.NumInstances;
+    }
+
+    // Scatter the items, each batch fills its range in draw order.
+    std::vector<uint32_t> cursors( m_Batches.size() );
+    for ( size_t i = 0; i < m_Batches.size(); ++i )
+    {
+        cursors[i] = m_Batches[i].FirstInstance;
+    }
+
+    m_Instances.resize( m_DrawItems.size() );
+    for ( size_t i = 0; i < m_DrawItems.size(); ++i )
+    {
+        m_Instances[cursors[m_DrawBatches[i]]++] = m_DrawItems[i];
+    }
+}
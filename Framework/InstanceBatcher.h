@@ -0,0 +1,47 @@
+#pragma once
+
+// Groups the draws that can be issued as one instanced draw (same mesh, same material, ...).
+// --
+// The caller gives each draw a batch key (eg. mesh id and material id packed in 64 bits) and an item (its draw, or
+// its instance data). Build puts the items of each batch next to each other: the instance data can then be written
+// to a buffer in that order, a batch being the range [FirstInstance, FirstInstance + NumInstances).
+// The batches are in the order of their first draw, the instances of a batch in the order of their draws (stable).
+// O(n): one hash lookup per draw, then a counting sort.
+// No device is used, the batcher can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class DX12_FW_API InstanceBatcher
+{
+public:
+    struct Batch
+    {
+        uint64_t    Key;
+        uint32_t    FirstInstance;  // Into GetInstances().
+        uint32_t    NumInstances;
+    };
+
+    void Reserve( uint32_t numDraws );
+    void Clear();
+    void AddDraw( uint64_t batchKey, uint32_t item );
+
+    // Group the draws added since the last Clear.
+    void Build();
+
+    uint32_t GetNumDraws() const { return static_cast<uint32_t>( m_DrawItems.size() ); }
+    const std::vector<Batch>& GetBatches() const { return m_Batches; }
+    // The items, batch by batch.
+    const std::vector<uint32_t>& GetInstances() const { return m_Instances; }
+
+private:
+    std::vector<uint32_t>                   m_DrawItems;
+    std::vector<uint32_t>                   m_DrawBatches;      // Per draw: its batch.
+    std::vector<Batch>                      m_Batches;
+    std::vector<uint32_t>                   m_Instances;
+    std::unordered_map<uint64_t, uint32_t>  m_BatchIndices;     // Key -> batch.
+};
@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+#include <utility>
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept
+{
+    *this = std::move( other );
+}
+
+MappedFile& MappedFile::operator=( MappedFile&& other ) noexcept
+{
+    if ( this != &other )
+    {
+        Close();
+        std::swap( m_File, other.m_File );
+        std::swap( m_Mapping, other.m_Mapping );
+        std::swap( m_Data, other.m_Data );
+        std::swap( m_Size, other.m_Size );
+        std::swap( m_IsOpen, other.m_IsOpen );
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open( const std::wstring& path )
+{
+    Close();
+
+    HANDLE file = CreateFileW( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+    if ( file == INVALID_HANDLE_VALUE )
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( file, &size ) || static_cast<uint64_t>( size.QuadPart ) > SIZE_MAX )
+    {
+        CloseHandle( file );
+        return false;
+    }
+
+    m_File = file;
+    m_Size = static_cast<size_t>( size.QuadPart );
+    m_IsOpen = true;
+
+    // A mapping can't be created for an empty file.
+    if ( m_Size == 0 )
+    {
+        return true;
+    }
+
+    m_Mapping = CreateFileMappingW( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if ( m_Mapping )
+    {
+        m_Data = static_cast<const uint8_t*>( MapViewOfFile( m_Mapping, FILE_MAP_READ, 0, 0, 0 ) );
+    }
+
+    if ( !m_Data )
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if ( m_Data )
+    {
+        UnmapViewOfFile( m_Data );
+    }
+    if ( m_Mapping )
+    {
+        CloseHandle( m_Mapping );
+    }
+    if ( m_File )
+    {
+        CloseHandle( m_File );
+    }
+
+    m_File = nullptr;
+    m_Mapping = nullptr;
+    m_Data = nullptr;
+    m_Size = 0;
+    m_IsOpen = false;
+}
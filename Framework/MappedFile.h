@@ -0,0 +1,39 @@
+#pragma once
+
+// Read-only view of a whole file, memory mapped: the pages are read on their first access (from the OS file cache when
+// it is warm), the data is used in place with no copy in the process heap.
+// --
+// The view is valid until Close (or the destructor): the pointers into it must not outlive the MappedFile.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class DX12_FW_API MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+    MappedFile( MappedFile&& other ) noexcept;
+    MappedFile& operator=( MappedFile&& other ) noexcept;
+    ~MappedFile();
+
+    // Closes the current file first.
+    // @return false if the file can't be opened or mapped (eg. it doesn't exist). An empty file opens with no data.
+    bool Open( const std::wstring& path );
+    void Close();
+
+    bool            IsOpen() const { return m_IsOpen; }
+    const uint8_t*  GetData() const { return m_Data; }
+    size_t          GetSize() const { return m_Size; }
+
+private:
+    void*           m_File = nullptr;       // HANDLE
+    void*           m_Mapping = nullptr;    // HANDLE
+    const uint8_t*  m_Data = nullptr;
+    size_t          m_Size = 0;
+    bool            m_IsOpen = false;
+};
@@ -0,0 +1,217 @@
+#include "DDSFile.h"
+
+#include <Framework/3RD_Party/D3D/d3dx12.h>
+
+#include <External/DirectXTex/DirectXTex/DirectXTex.h>
+#include <External/DirectXTex/DirectXTex/DDS.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    // The legacy pixel formats stored as their DXGI format. DXGI_FORMAT_UNKNOWN: converted on load, or not a format.
+    DXGI_FORMAT GetLegacyFormat( const DirectX::DDS_PIXELFORMAT& pixelFormat )
+    {
+        if ( pixelFormat.flags & DDS_FOURCC )
+        {
+            switch ( pixelFormat.fourCC )
+            {
+                case MAKEFOURCC( 'D', 'X', 'T', '1' ): return DXGI_FORMAT_BC1_UNORM;
+                case MAKEFOURCC( 'D', 'X', 'T', '2' ):
+                case MAKEFOURCC( 'D', 'X', 'T', '3' ): return DXGI_FORMAT_BC2_UNORM;
+                case MAKEFOURCC( 'D', 'X', 'T', '4' ):
+                case MAKEFOURCC( 'D', 'X', 'T', '5' ): return DXGI_FORMAT_BC3_UNORM;
+                case MAKEFOURCC( 'A', 'T', 'I', '1' ):
+                case MAKEFOURCC( 'B', 'C', '4', 'U' ): return DXGI_FORMAT_BC4_UNORM;
+                case MAKEFOURCC( 'B', 'C', '4', 'S' ): return DXGI_FORMAT_BC4_SNORM;
+                case MAKEFOURCC( 'A', 'T', 'I', '2' ):
+                case MAKEFOURCC( 'B', 'C', '5', 'U' ): return DXGI_FORMAT_BC5_UNORM;
+                case MAKEFOURCC( 'B', 'C', '5', 'S' ): return DXGI_FORMAT_BC5_SNORM;
+                // D3DFORMAT values.
+                case 36:  return DXGI_FORMAT_R16G16B16A16_UNORM;
+                case 110: return DXGI_FORMAT_R16G16B16A16_SNORM;
+                case 111: return DXGI_FORMAT_R16_FLOAT;
+                case 112: return DXGI_FORMAT_R16G16_FLOAT;
+                case 113: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+                case 114: return DXGI_FORMAT_R32_FLOAT;
+                case 115: return DXGI_FORMAT_R32G32_FLOAT;
+                case 116: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+                default:  return DXGI_FORMAT_UNKNOWN;
+            }
+        }
+
+        if ( ( pixelFormat.flags & DDS_RGB ) && pixelFormat.RGBBitCount == 32 )
+        {
+            uint32_t r = pixelFormat.RBitMask;
+            uint32_t g = pixelFormat.GBitMask;
+            uint32_t b = pixelFormat.BBitMask;
+            uint32_t a = ( pixelFormat.flags & DDS_ALPHAPIXELS ) ? pixelFormat.ABitMask : 0;
+
+            if ( r == 0x000000ff && g == 0x0000ff00 && b == 0x00ff0000 && a == 0xff000000 )
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            if ( r == 0x00ff0000 && g == 0x0000ff00 && b == 0x000000ff && a == 0xff000000 )
+                return DXGI_FORMAT_B8G8R8A8_UNORM;
+            if ( r == 0x00ff0000 && g == 0x0000ff00 && b == 0x000000ff && a == 0 )
+                return DXGI_FORMAT_B8G8R8X8_UNORM;
+            if ( r == 0x0000ffff && g == 0xffff0000 && b == 0 && a == 0 )
+                return DXGI_FORMAT_R16G16_UNORM;
+        }
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+}
+
+bool DDSFile::Open( const std::wstring& path )
+{
+    Close();
+
+    if ( !m_File.Open( path ) )
+        return false;
+
+    const uint8_t* data = m_File.GetData();
+    size_t size = m_File.GetSize();
+    size_t offset = sizeof( uint32_t ) + sizeof( DirectX::DDS_HEADER );
+
+    if ( size < offset || *reinterpret_cast<const uint32_t*>( data ) != DirectX::DDS_MAGIC )
+    {
+        Close();
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const DirectX::DDS_HEADER*>( data + sizeof( uint32_t ) );
+    if ( header->size != sizeof( DirectX::DDS_HEADER ) || header->ddspf.size != sizeof( DirectX::DDS_PIXELFORMAT ) )
+    {
+        Close();
+        return false;
+    }
+
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    D3D12_RESOURCE_DIMENSION dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    uint64_t width = header->width;
+    uint32_t height = std::max( 1u, header->height );
+    uint32_t depth = 1;
+    uint32_t arraySize = 1;
+    uint32_t mipLevels = std::max( 1u, header->mipMapCount );
+
+    if ( ( header->ddspf.flags & DDS_FOURCC ) && header->ddspf.fourCC == MAKEFOURCC( 'D', 'X', '1', '0' ) )
+    {
+        if ( size < offset + sizeof( DirectX::DDS_HEADER_DXT10 ) )
+        {
+            Close();
+            return false;
+        }
+
+        const auto* header10 = reinterpret_cast<const DirectX::DDS_HEADER_DXT10*>( data + offset );
+        offset += sizeof( DirectX::DDS_HEADER_DXT10 );
+
+        format = header10->dxgiFormat;
+        arraySize = header10->arraySize;
+        switch ( header10->resourceDimension )
+        {
+            case DirectX::DDS_DIMENSION_TEXTURE1D:
+                dimension = D3D12_RESOURCE_DIMENSION_TEXTURE1D;
+                height = 1;
+                break;
+            case DirectX::DDS_DIMENSION_TEXTURE2D:
+                if ( header10->miscFlag & DirectX::DDS_RESOURCE_MISC_TEXTURECUBE )
+                {
+                    m_IsCubemap = true;
+                    arraySize *= 6;
+                }
+                break;
+            case DirectX::DDS_DIMENSION_TEXTURE3D:
+                dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+                depth = std::max( 1u, header->depth );
+                if ( arraySize != 1 )
+                    arraySize = 0;
+                break;
+            default:
+                arraySize = 0;
+                break;
+        }
+    }
+    else
+    {
+        format = GetLegacyFormat( header->ddspf );
+        if ( header->flags & DDS_HEADER_FLAGS_VOLUME )
+        {
+            dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+            depth = std::max( 1u, header->depth );
+        }
+        else if ( header->caps2 & DDS_CUBEMAP )
+        {
+            // The partial cubemaps of D3D9 aren't textures D3D12 can create.
+            m_IsCubemap = true;
+            arraySize = ( ( header->caps2 & DDS_CUBEMAP_ALLFACES ) == DDS_CUBEMAP_ALLFACES ) ? 6 : 0;
+        }
+    }
+
+    uint32_t maxMipLevels = 1;
+    for ( uint64_t extent = std::max<uint64_t>( { width, height, depth } ); extent > 1; extent /= 2 )
+    {
+        ++maxMipLevels;
+    }
+
+    if ( format == DXGI_FORMAT_UNKNOWN || arraySize == 0 || width == 0 || arraySize > D3D12_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION ||
+         mipLevels > maxMipLevels || DirectX::IsTypeless( format ) || DirectX::IsPlanar( format ) || DirectX::IsPalettized( format ) ||
+         DirectX::IsVideo( format ) )
+    {
+        Close();
+        return false;
+    }
+
+    // The file layout: for each array slice, its mips (each one with all its depth slices).
+    m_Subresources.reserve( static_cast<size_t>( arraySize ) * mipLevels );
+    for ( uint32_t slice = 0; slice < arraySize; ++slice )
+    {
+        size_t mipWidth = static_cast<size_t>( width );
+        size_t mipHeight = height;
+        size_t mipDepth = depth;
+        for ( uint32_t mip = 0; mip < mipLevels; ++mip )
+        {
+            size_t rowPitch = 0;
+            size_t slicePitch = 0;
+            if ( FAILED( DirectX::ComputePitch( format, mipWidth, mipHeight, rowPitch, slicePitch ) ) ||
+                 slicePitch * mipDepth > size - offset )
+            {
+                Close();
+                return false;
+            }
+
+            D3D12_SUBRESOURCE_DATA subresource;
+            subresource.pData = data + offset;
+            subresource.RowPitch = static_cast<LONG_PTR>( rowPitch );
+            subresource.SlicePitch = static_cast<LONG_PTR>( slicePitch );
+            m_Subresources.push_back( subresource );
+
+            offset += slicePitch * mipDepth;
+            mipWidth = std::max<size_t>( 1, mipWidth / 2 );
+            mipHeight = std::max<size_t>( 1, mipHeight / 2 );
+            mipDepth = std::max<size_t>( 1, mipDepth / 2 );
+        }
+    }
+
+    switch ( dimension )
+    {
+        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+            m_Desc = CD3DX12_RESOURCE_DESC::Tex1D( format, width, static_cast<UINT16>( arraySize ), static_cast<UINT16>( mipLevels ) );
+            break;
+        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+            m_Desc = CD3DX12_RESOURCE_DESC::Tex3D( format, width, height, static_cast<UINT16>( depth ), static_cast<UINT16>( mipLevels ) );
+            break;
+        default:
+            m_Desc = CD3DX12_RESOURCE_DESC::Tex2D( format, width, height, static_cast<UINT16>( arraySize ), static_cast<UINT16>( mipLevels ) );
+            break;
+    }
+
+    return true;
+}
+
+void DDSFile::Close()
+{
+    m_File.Close();
+    m_Desc = {};
+    m_IsCubemap = false;
+    m_Subresources.clear();
+}
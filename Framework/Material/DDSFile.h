@@ -0,0 +1,42 @@
+#pragma once
+
+// A DDS file memory mapped and parsed in place: the subresources point into the mapped view, so an upload copies the
+// rows from the file cache pages to the upload heap directly (UpdateSubresources goes from the row pitch of the file to
+// the 256 byte aligned pitch of the footprint). No decoded copy of the texture in the process heap.
+// --
+// Only the files whose pixels are uploaded as stored: a DX10 header, the block compressed and float FourCCs, and the
+// 32-bit RGBA/BGRA masks. Open refuses the others (24-bit, palettized, luminance, 4:4:4:4...: DirectXTex expands them
+// to 32-bit on load) and the truncated files: the caller falls back to LoadFromDDSFile.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <Framework/MappedFile.h>
+
+#include <d3d12.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class DX12_FW_API DDSFile
+{
+public:
+    // @return false if the file can't be mapped, or isn't a DDS file this class reads (the file is then closed).
+    bool Open( const std::wstring& path );
+    void Close();
+
+    bool                                        IsOpen() const { return m_File.IsOpen(); }
+    // The texture as stored: every mip and array slice (6 per cubemap) of the file.
+    const D3D12_RESOURCE_DESC&                  GetResourceDesc() const { return m_Desc; }
+    bool                                        IsCubemap() const { return m_IsCubemap; }
+    // In the subresource order of D3D12 (the mips of the first array slice, then of the next one...), pointing into
+    // the mapped view: valid until Close.
+    const std::vector<D3D12_SUBRESOURCE_DATA>&  GetSubresources() const { return m_Subresources; }
+    size_t                                      GetFileSize() const { return m_File.GetSize(); }
+
+private:
+    MappedFile                          m_File;
+    D3D12_RESOURCE_DESC                 m_Desc = {};
+    bool                                m_IsCubemap = false;
+    std::vector<D3D12_SUBRESOURCE_DATA> m_Subresources;
+};
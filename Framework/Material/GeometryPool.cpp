@@ -0,0 +1,172 @@
+#include "GeometryPool.h"
+
+#include <Framework/CommandList.h>
+
+#include <algorithm>
+#include <exception>
+
+namespace
+{
+    uint64_t AlignResourceSize( uint64_t size )
+    {
+        return ( size + GeometryPool::ResourceAlignment - 1 ) / GeometryPool::ResourceAlignment * GeometryPool::ResourceAlignment;
+    }
+}
+
+GeometryPool::GeometryPool( uint32_t vertexStride, uint32_t verticesPerBlock, uint32_t indicesPerBlock )
+    : m_VertexStride( vertexStride )
+    , m_VerticesPerBlock( verticesPerBlock )
+    , m_IndicesPerBlock( indicesPerBlock )
+{}
+
+GeometryPool::~GeometryPool() = default;
+
+GeometryPool::Allocation GeometryPool::Allocate( CommandList& commandList, uint32_t numVertices, const void* vertexData, uint32_t numIndices, const uint32_t* indexData )
+{
+    if ( numVertices == 0 || numIndices == 0 )
+    {
+        throw std::exception( "GeometryPool: empty mesh." );
+    }
+
+    Allocation allocation;
+    allocation.NumVertices = numVertices;
+    allocation.NumIndices = numIndices;
+
+    DXGI_FORMAT indexFormat = IndexBuffer::SelectIndexFormat( numVertices );
+
+    // The first block of the index format with room for both ranges.
+    for ( uint32_t block = 0; block < m_Blocks.size() && !allocation.IsValid(); ++block )
+    {
+        if ( m_Blocks[block]->IndexFormat != indexFormat )
+            continue;
+
+        uint32_t baseVertex = m_Blocks[block]->VertexAllocator.Allocate( numVertices );
+        if ( baseVertex == FreeListAllocator::InvalidOffset )
+            continue;
+
+        uint32_t startIndex = m_Blocks[block]->IndexAllocator.Allocate( numIndices );
+        if ( startIndex == FreeListAllocator::InvalidOffset )
+        {
+            m_Blocks[block]->VertexAllocator.Free( baseVertex, numVertices );
+            continue;
+        }
+
+        allocation.Block = block;
+        allocation.BaseVertex = baseVertex;
+        allocation.StartIndex = startIndex;
+    }
+
+    if ( !allocation.IsValid() )
+    {
+        allocation.Block = CreateBlock( commandList, numVertices, numIndices, indexFormat );
+        allocation.BaseVertex = m_Blocks[allocation.Block]->VertexAllocator.Allocate( numVertices );
+        allocation.StartIndex = m_Blocks[allocation.Block]->IndexAllocator.Allocate( numIndices );
+    }
+
+    Block& block = *m_Blocks[allocation.Block];
+    commandList.UpdateBufferRegion( block.Vertices, static_cast<size_t>( allocation.BaseVertex ) * m_VertexStride,
+        static_cast<size_t>( numVertices ) * m_VertexStride, vertexData );
+    if ( indexFormat == DXGI_FORMAT_R16_UINT )
+    {
+        std::vector<uint16_t> indices16( indexData, indexData + numIndices );
+        commandList.UpdateBufferRegion( block.Indices, static_cast<size_t>( allocation.StartIndex ) * block.IndexSize,
+            static_cast<size_t>( numIndices ) * block.IndexSize, indices16.data() );
+    }
+    else
+    {
+        commandList.UpdateBufferRegion( block.Indices, static_cast<size_t>( allocation.StartIndex ) * block.IndexSize,
+            static_cast<size_t>( numIndices ) * block.IndexSize, indexData );
+    }
+
+    ++m_NumAllocations;
+    m_SeparateBuffersSize += AlignResourceSize( static_cast<uint64_t>( numVertices ) * m_VertexStride ) +
+                             AlignResourceSize( static_cast<uint64_t>( numIndices ) * block.IndexSize );
+
+    return allocation;
+}
+
+void GeometryPool::Free( const Allocation& allocation, uint64_t frameNumber )
+{
+    if ( !allocation.IsValid() )
+        return;
+
+    m_StaleAllocations.push( { allocation, frameNumber } );
+
+    // Not an allocation anymore, its ranges stay used until released.
+    --m_NumAllocations;
+    m_SeparateBuffersSize -= AlignResourceSize( static_cast<uint64_t>( allocation.NumVertices ) * m_VertexStride ) +
+                             AlignResourceSize( static_cast<uint64_t>( allocation.NumIndices ) * m_Blocks[allocation.Block]->IndexSize );
+}
+
+void GeometryPool::ReleaseStaleAllocations( uint64_t completedFrame )
+{
+    while ( !m_StaleAllocations.empty() && m_StaleAllocations.front().FrameNumber <= completedFrame )
+    {
+        const Allocation& allocation = m_StaleAllocations.front().Ranges;
+
+        Block& block = *m_Blocks[allocation.Block];
+        block.VertexAllocator.Free( allocation.BaseVertex, allocation.NumVertices );
+        block.IndexAllocator.Free( allocation.StartIndex, allocation.NumIndices );
+
+        m_StaleAllocations.pop();
+    }
+}
+
+uint32_t GeometryPool::GetNumBlocks( DXGI_FORMAT indexFormat ) const
+{
+    return static_cast<uint32_t>( std::count_if( m_Blocks.begin(), m_Blocks.end(),
+        [indexFormat]( const auto& block ) { return block->IndexFormat == indexFormat; } ) );
+}
+
+uint64_t GeometryPool::GetCapacityInBytes() const
+{
+    uint64_t size = 0;
+    for ( const auto& block : m_Blocks )
+    {
+        size += static_cast<uint64_t>( block->VertexAllocator.GetCapacity() ) * m_VertexStride +
+                static_cast<uint64_t>( block->IndexAllocator.GetCapacity() ) * block->IndexSize;
+    }
+    return size;
+}
+
+uint64_t GeometryPool::GetUsedSizeInBytes() const
+{
+    uint64_t size = 0;
+    for ( const auto& block : m_Blocks )
+    {
+        size += static_cast<uint64_t>( block->VertexAllocator.GetUsedSize() ) * m_VertexStride +
+                static_cast<uint64_t>( block->IndexAllocator.GetUsedSize() ) * block->IndexSize;
+    }
+    return size;
+}
+
+uint32_t GeometryPool::GetNumFreeRanges() const
+{
+    uint32_t numFreeRanges = 0;
+    for ( const auto& block : m_Blocks )
+    {
+        numFreeRanges += block->VertexAllocator.GetNumFreeRanges() + block->IndexAllocator.GetNumFreeRanges();
+    }
+    return numFreeRanges;
+}
+
+uint32_t GeometryPool::CreateBlock( CommandList& commandList, uint32_t numVertices, uint32_t numIndices, DXGI_FORMAT indexFormat )
+{
+    auto block = std::make_unique<Block>();
+    block->IndexFormat = indexFormat;
+    block->IndexSize = ( indexFormat == DXGI_FORMAT_R16_UINT ) ? sizeof( uint16_t ) : sizeof( uint32_t );
+
+    // Large enough for the mesh that didn't fit anywhere.
+    uint32_t blockVertices = std::max( m_VerticesPerBlock, numVertices );
+    uint32_t blockIndices = std::max( m_IndicesPerBlock, numIndices );
+
+    // No data: the ranges are filled by Allocate.
+    commandList.CopyVertexBuffer( block->Vertices, blockVertices, m_VertexStride, nullptr );
+    commandList.CopyIndexBuffer( block->Indices, blockIndices, indexFormat, nullptr );
+
+    block->VertexAllocator.Reset( blockVertices );
+    block->IndexAllocator.Reset( blockIndices );
+
+    m_Blocks.push_back( std::move( block ) );
+    return static_cast<uint32_t>( m_Blocks.size() - 1 );
+}
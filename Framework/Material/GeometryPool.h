@@ -0,0 +1,105 @@
+#pragma once
+
+// Vertex and index data of many meshes, sub-allocated from a few large buffers.
+// --
+// A block is one vertex buffer and one index buffer, each with a FreeListAllocator over its elements. A mesh is a
+// range of vertices and a range of indices of the same block, drawn with baseVertex / startIndex: the meshes of a
+// block share their IA bindings, so the draws don't rebind the vertex and index buffers (and an ExecuteIndirect draw
+// can address all of them). A new block is created when the data doesn't fit in the existing ones.
+// The index buffer of a block is R16_UINT or R32_UINT: a mesh goes to the blocks of the narrowest format its vertex
+// count allows (IndexBuffer::SelectIndexFormat), so only the meshes of more than 65535 vertices pay for 32-bit indices.
+// --
+// Free doesn't return the ranges to the allocators at once: the frames in flight may still draw the mesh. They are
+// queued with the frame number they were freed in, and ReleaseStaleAllocations returns them once the GPU finished that
+// frame (as the stale descriptors of DescriptorAllocatorPage).
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <Framework/FreeListAllocator.h>
+
+#include "IndexBuffer.h"
+#include "VertexBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <vector>
+
+class CommandList;
+
+class DX12_FW_API GeometryPool
+{
+public:
+    static constexpr uint32_t InvalidBlock = UINT32_MAX;
+
+    // Committed buffers are 64 KB aligned: the size the data of an allocation would take in its own buffers.
+    static constexpr uint64_t ResourceAlignment = 64 * 1024;
+
+    struct Allocation
+    {
+        uint32_t    Block = InvalidBlock;
+        uint32_t    BaseVertex = 0;
+        uint32_t    NumVertices = 0;
+        uint32_t    StartIndex = 0;
+        uint32_t    NumIndices = 0;
+
+        bool IsValid() const { return Block != InvalidBlock; }
+    };
+
+    // @param verticesPerBlock / indicesPerBlock - The capacity of the blocks (a larger mesh gets a block of its size).
+    GeometryPool( uint32_t vertexStride, uint32_t verticesPerBlock = 1u << 20, uint32_t indicesPerBlock = 1u << 22 );
+    ~GeometryPool();
+
+    // Copy the vertices and indices into the pool (the indices are relative to the first vertex, narrowed to 16 bits
+    // when the mesh goes to a 16-bit block).
+    // Throws if the mesh has no vertices or no indices.
+    Allocation Allocate( CommandList& commandList, uint32_t numVertices, const void* vertexData, uint32_t numIndices, const uint32_t* indexData );
+    // @param frameNumber - The current frame (Application::GetFrameCount): the ranges are reused once it's completed.
+    void Free( const Allocation& allocation, uint64_t frameNumber );
+    // Return the ranges freed during the frames up to completedFrame (Application::GetCompletedFrame) to the allocators.
+    void ReleaseStaleAllocations( uint64_t completedFrame );
+
+    const VertexBuffer& GetVertexBuffer( uint32_t block ) const { return m_Blocks[block]->Vertices; }
+    const IndexBuffer&  GetIndexBuffer( uint32_t block ) const { return m_Blocks[block]->Indices; }
+
+    uint32_t GetVertexStride() const { return m_VertexStride; }
+    uint32_t GetNumBlocks() const { return static_cast<uint32_t>( m_Blocks.size() ); }
+    uint32_t GetNumBlocks( DXGI_FORMAT indexFormat ) const;
+    uint32_t GetNumAllocations() const { return m_NumAllocations; }
+    // Freed, waiting for their frame to complete.
+    uint32_t GetNumStaleAllocations() const { return static_cast<uint32_t>( m_StaleAllocations.size() ); }
+    // Sizes of the block buffers and of the allocated ranges.
+    uint64_t GetCapacityInBytes() const;
+    uint64_t GetUsedSizeInBytes() const;
+    // What the allocations would take as separate committed vertex and index buffers (2 resources each).
+    uint64_t GetSeparateBuffersSizeInBytes() const { return m_SeparateBuffersSize; }
+    // Free ranges of all the blocks (vertices and indices), 2 per block when nothing is fragmented.
+    uint32_t GetNumFreeRanges() const;
+
+private:
+    struct Block
+    {
+        DXGI_FORMAT         IndexFormat;
+        uint32_t            IndexSize;
+        VertexBuffer        Vertices;
+        IndexBuffer         Indices;
+        FreeListAllocator   VertexAllocator;
+        FreeListAllocator   IndexAllocator;
+    };
+
+    struct StaleAllocation
+    {
+        Allocation  Ranges;
+        uint64_t    FrameNumber;    // The frame the allocation was freed in.
+    };
+
+    uint32_t CreateBlock( CommandList& commandList, uint32_t numVertices, uint32_t numIndices, DXGI_FORMAT indexFormat );
+
+    std::vector<std::unique_ptr<Block>> m_Blocks;
+    std::queue<StaleAllocation>         m_StaleAllocations;     // In the order of their frames.
+    uint32_t                            m_VertexStride;
+    uint32_t                            m_VerticesPerBlock;
+    uint32_t                            m_IndicesPerBlock;
+    uint32_t                            m_NumAllocations = 0;
+    uint64_t                            m_SeparateBuffersSize = 0;
+};
@@ -21,6 +21,13 @@ public:
         return m_IndexFormat;
     }
 
+    // The narrowest format for indices into numVertices vertices: R16_UINT up to 65535 vertices (the largest index,
+    // 65534, stays below the 0xFFFF strip cut value), else R32_UINT.
+    static DXGI_FORMAT SelectIndexFormat(size_t numVertices)
+    {
+        return (numVertices <= 0xFFFF) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    }
+
     // Get the index buffer view for biding to the Input Assembler stage.
     D3D12_INDEX_BUFFER_VIEW GetIndexBufferView() const
     {
@@ -2,6 +2,7 @@
 
 #include "../Application.h"
 
+#include <algorithm>
 #include <stdexcept>
 
 using namespace DirectX;
@@ -14,28 +15,90 @@ const D3D12_INPUT_ELEMENT_DESC VertexPositionNormalTexture::InputElements[] =
     { "TEXCOORD",   0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 };
 
+// VertexQuantizer::QuantizedVertex: the w of the position is unused.
+const D3D12_INPUT_ELEMENT_DESC VertexQuantized::InputElements[] =
+{
+    { "POSITION",   0, DXGI_FORMAT_R16G16B16A16_UNORM,  0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL",     0, DXGI_FORMAT_R16G16_SNORM,        0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TEXCOORD",   0, DXGI_FORMAT_R16G16_FLOAT,        0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
 Mesh::Mesh()
     : m_IndexCount(0)
+    , m_GeometryPool(nullptr)
 {}
 
 Mesh::~Mesh()
 {
     // Allocated resources will be cleaned automatically when the pointers go out of scope.
+    // The ranges of a pooled mesh go back to the pool once the frames in flight are done with them.
+    if (m_GeometryPool)
+        m_GeometryPool->Free(m_PoolAllocation, Application::Get().GetFrameCount());
+}
+
+const VertexBuffer& Mesh::GetVertexBuffer() const
+{
+    return m_GeometryPool ? m_GeometryPool->GetVertexBuffer(m_PoolAllocation.Block) : m_VertexBuffer;
+}
+
+const IndexBuffer& Mesh::GetIndexBuffer() const
+{
+    return m_GeometryPool ? m_GeometryPool->GetIndexBuffer(m_PoolAllocation.Block) : m_IndexBuffer;
 }
 
 void Mesh::Draw(CommandList& commandList)
 {
+    Draw(commandList, 1);
+}
+
+void Mesh::Draw(CommandList& commandList, uint32_t instanceCount, uint32_t startInstance)
+{
+    DrawLod(commandList, 0, instanceCount, startInstance);
+}
+
+void Mesh::DrawLod(CommandList& commandList, uint32_t lod, uint32_t instanceCount, uint32_t startInstance)
+{
+    lod = std::min(lod, GetNumLods() - 1);
+
     commandList.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    commandList.SetVertexBuffer(0, m_VertexBuffer);
-    commandList.SetIndexBuffer(m_IndexBuffer);
-    commandList.DrawIndexed(m_IndexCount);
+    // Unchanged between the meshes of a pool block (the command list filters the redundant IA bindings).
+    commandList.SetVertexBuffer(0, GetVertexBuffer());
+    commandList.SetIndexBuffer(GetIndexBuffer());
+    commandList.DrawIndexed(GetIndexCount(lod), instanceCount, GetStartIndex(lod), GetBaseVertex(), startInstance);
+}
+
+std::unique_ptr<Mesh> Mesh::CreateFromData(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, bool rhcoords, GeometryPool* geometryPool)
+{
+    return CreateFromData(commandList, vertices, indices, { static_cast<UINT>(indices.size()) }, rhcoords, geometryPool);
+}
+
+std::unique_ptr<Mesh> Mesh::CreateFromData(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices,
+    const std::vector<UINT>& lodIndexCounts, bool rhcoords, GeometryPool* geometryPool)
+{
+    std::unique_ptr<Mesh> mesh(new Mesh());
+
+    mesh->Initialize(commandList, vertices, indices, lodIndexCounts, rhcoords, geometryPool);
+
+    return mesh;
 }
 
-std::unique_ptr<Mesh> Mesh::CreateFromData(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, bool rhcoords)
+std::unique_ptr<Mesh> Mesh::CreateFromData(CommandList& commandList, const QuantizedVertexCollection& vertices, const IndexCollection& indices,
+    const std::vector<UINT>& lodIndexCounts, GeometryPool* geometryPool)
 {
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(commandList, vertices, indices, rhcoords);
+    mesh->InitializeBuffers(commandList, vertices.size(), sizeof(VertexQuantizer::QuantizedVertex), vertices.data(), indices.size(), indices.data(),
+        lodIndexCounts, geometryPool);
+
+    return mesh;
+}
+
+std::unique_ptr<Mesh> Mesh::CreateFromData(CommandList& commandList, size_t numVertices, size_t vertexStride, const void* vertexData,
+    size_t numIndices, const uint32_t* indexData, const std::vector<UINT>& lodIndexCounts, GeometryPool* geometryPool)
+{
+    std::unique_ptr<Mesh> mesh(new Mesh());
+
+    mesh->InitializeBuffers(commandList, numVertices, vertexStride, vertexData, numIndices, indexData, lodIndexCounts, geometryPool);
 
     return mesh;
 }
@@ -92,20 +155,20 @@ std::unique_ptr<Mesh> Mesh::CreateSphere(CommandList& commandList, float diamete
             size_t nextI = i + 1;
             size_t nextJ = (j + 1) % stride;
 
-            indices.push_back(static_cast<uint16_t>( i * stride + j ));
-            indices.push_back(static_cast<uint16_t>(nextI * stride + j));
-            indices.push_back(static_cast<uint16_t>(i * stride + nextJ));
+            indices.push_back(static_cast<uint32_t>( i * stride + j ));
+            indices.push_back(static_cast<uint32_t>(nextI * stride + j));
+            indices.push_back(static_cast<uint32_t>(i * stride + nextJ));
 
-            indices.push_back(static_cast<uint16_t>(i * stride + nextJ));
-            indices.push_back(static_cast<uint16_t>(nextI * stride + j));
-            indices.push_back(static_cast<uint16_t>(nextI * stride + nextJ));
+            indices.push_back(static_cast<uint32_t>(i * stride + nextJ));
+            indices.push_back(static_cast<uint32_t>(nextI * stride + j));
+            indices.push_back(static_cast<uint32_t>(nextI * stride + nextJ));
         }
     }
 
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(commandList, vertices, indices, rhcoords);
+    mesh->Initialize(commandList, vertices, indices, { static_cast<UINT>(indices.size()) }, rhcoords);
 
     return mesh;
 }
@@ -151,13 +214,13 @@ std::unique_ptr<Mesh> Mesh::CreateCube(CommandList& commandList, float size, boo
 
         // Six indices (two triangles) per face.
         size_t vbase = vertices.size();
-        indices.push_back(static_cast<uint16_t>(vbase + 0));
-        indices.push_back(static_cast<uint16_t>(vbase + 1));
-        indices.push_back(static_cast<uint16_t>(vbase + 2));
+        indices.push_back(static_cast<uint32_t>(vbase + 0));
+        indices.push_back(static_cast<uint32_t>(vbase + 1));
+        indices.push_back(static_cast<uint32_t>(vbase + 2));
 
-        indices.push_back(static_cast<uint16_t>(vbase + 0));
-        indices.push_back(static_cast<uint16_t>(vbase + 2));
-        indices.push_back(static_cast<uint16_t>(vbase + 3));
+        indices.push_back(static_cast<uint32_t>(vbase + 0));
+        indices.push_back(static_cast<uint32_t>(vbase + 2));
+        indices.push_back(static_cast<uint32_t>(vbase + 3));
 
         // Four vertices per face.
         vertices.push_back(VertexPositionNormalTexture((normal - side1 - side2) * size, normal, textureCoordinates[0]));
@@ -169,7 +232,7 @@ std::unique_ptr<Mesh> Mesh::CreateCube(CommandList& commandList, float size, boo
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(commandList, vertices, indices, rhcoords);
+    mesh->Initialize(commandList, vertices, indices, { static_cast<UINT>(indices.size()) }, rhcoords);
 
     return mesh;
 }
@@ -212,9 +275,9 @@ static void CreateCylinderCap(VertexCollection& vertices, IndexCollection& indic
         }
 
         size_t vbase = vertices.size();
-        indices.push_back(static_cast<uint16_t>(vbase));
-        indices.push_back(static_cast<uint16_t>(vbase + i1));
-        indices.push_back(static_cast<uint16_t>(vbase + i2));
+        indices.push_back(static_cast<uint32_t>(vbase));
+        indices.push_back(static_cast<uint32_t>(vbase + i1));
+        indices.push_back(static_cast<uint32_t>(vbase + i2));
     }
 
     // Which end of the cylinder is this?
@@ -275,9 +338,9 @@ std::unique_ptr<Mesh> Mesh::CreateCone(CommandList& commandList, float diameter,
         vertices.push_back(VertexPositionNormalTexture(topOffset, normal, g_XMZero));
         vertices.push_back(VertexPositionNormalTexture(pt, normal, textureCoordinate + g_XMIdentityR1));
 
-        indices.push_back(static_cast<uint16_t>(i * 2));
-        indices.push_back(static_cast<uint16_t>((i * 2 + 3) % (stride * 2)));
-        indices.push_back(static_cast<uint16_t>((i * 2 + 1) % (stride * 2)));
+        indices.push_back(static_cast<uint32_t>(i * 2));
+        indices.push_back(static_cast<uint32_t>((i * 2 + 3) % (stride * 2)));
+        indices.push_back(static_cast<uint32_t>((i * 2 + 1) % (stride * 2)));
     }
 
     // Create flat triangle fan caps to seal the bottom.
@@ -286,7 +349,7 @@ std::unique_ptr<Mesh> Mesh::CreateCone(CommandList& commandList, float diameter,
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(commandList, vertices, indices, rhcoords);
+    mesh->Initialize(commandList, vertices, indices, { static_cast<UINT>(indices.size()) }, rhcoords);
 
     return mesh;
 }
@@ -336,20 +399,20 @@ std::unique_ptr<Mesh> Mesh::CreateTorus(CommandList& commandList, float diameter
             size_t nextI = (i + 1) % stride;
             size_t nextJ = (j + 1) % stride;
 
-            indices.push_back(static_cast<uint16_t>(i * stride + j));
-            indices.push_back(static_cast<uint16_t>(i * stride + nextJ));
-            indices.push_back(static_cast<uint16_t>(nextI * stride + j));
+            indices.push_back(static_cast<uint32_t>(i * stride + j));
+            indices.push_back(static_cast<uint32_t>(i * stride + nextJ));
+            indices.push_back(static_cast<uint32_t>(nextI * stride + j));
 
-            indices.push_back(static_cast<uint16_t>(i * stride + nextJ));
-            indices.push_back(static_cast<uint16_t>(nextI * stride + nextJ));
-            indices.push_back(static_cast<uint16_t>(nextI * stride + j));
+            indices.push_back(static_cast<uint32_t>(i * stride + nextJ));
+            indices.push_back(static_cast<uint32_t>(nextI * stride + nextJ));
+            indices.push_back(static_cast<uint32_t>(nextI * stride + j));
         }
     }
 
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(commandList, vertices, indices, rhcoords);
+    mesh->Initialize(commandList, vertices, indices, { static_cast<UINT>(indices.size()) }, rhcoords);
 
     return mesh;
 }
@@ -371,7 +434,7 @@ std::unique_ptr<Mesh> Mesh::CreatePlane(CommandList& commandList, float width, f
 
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(commandList, vertices, indices, rhcoords);
+    mesh->Initialize(commandList, vertices, indices, { static_cast<UINT>(indices.size()) }, rhcoords);
 
     return mesh;
 }
@@ -392,16 +455,55 @@ static void ReverseWinding(IndexCollection& indices, VertexCollection& vertices)
     }
 }
 
-void Mesh::Initialize(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, bool rhcoords)
+void Mesh::Initialize(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, const std::vector<UINT>& lodIndexCounts,
+    bool rhcoords, GeometryPool* geometryPool)
 {
-    if (vertices.size() >= USHRT_MAX)
-        throw std::exception("Too many vertices for 16-bit index buffer");
-
     if (!rhcoords)
         ReverseWinding(indices, vertices);
 
-    commandList.CopyVertexBuffer(m_VertexBuffer, vertices);
-    commandList.CopyIndexBuffer(m_IndexBuffer, indices);
+    InitializeBuffers(commandList, vertices.size(), sizeof(VertexPositionNormalTexture), vertices.data(), indices.size(), indices.data(),
+        lodIndexCounts, geometryPool);
+}
+
+void Mesh::InitializeBuffers(CommandList& commandList, size_t numVertices, size_t vertexStride, const void* vertexData, size_t numIndices,
+    const uint32_t* indexData, const std::vector<UINT>& lodIndexCounts, GeometryPool* geometryPool)
+{
+    if (numVertices >= UINT_MAX)
+        throw std::exception("Too many vertices for 32-bit index buffer");
+
+    UINT startIndex = 0;
+    for (UINT indexCount : lodIndexCounts)
+    {
+        m_Lods.push_back({ startIndex, indexCount });
+        startIndex += indexCount;
+    }
+    if (m_Lods.empty() || startIndex != numIndices)
+        throw std::exception("The LOD index counts don't add up to the index count");
+
+    if (geometryPool)
+    {
+        if (geometryPool->GetVertexStride() != vertexStride)
+            throw std::exception("The vertex stride of the geometry pool doesn't match the vertices");
+
+        m_PoolAllocation = geometryPool->Allocate(commandList, static_cast<uint32_t>(numVertices), vertexData,
+            static_cast<uint32_t>(numIndices), indexData);
+        m_GeometryPool = geometryPool;
+    }
+    else
+    {
+        commandList.CopyVertexBuffer(m_VertexBuffer, numVertices, vertexStride, vertexData);
+
+        // Half the index data when the vertices allow it.
+        if (IndexBuffer::SelectIndexFormat(numVertices) == DXGI_FORMAT_R16_UINT)
+        {
+            std::vector<uint16_t> indices16(indexData, indexData + numIndices);
+            commandList.CopyIndexBuffer(m_IndexBuffer, indices16);
+        }
+        else
+        {
+            commandList.CopyIndexBuffer(m_IndexBuffer, numIndices, DXGI_FORMAT_R32_UINT, indexData);
+        }
+    }
 
-    m_IndexCount = static_cast<UINT>(indices.size());
+    m_IndexCount = m_Lods[0].IndexCount;
 }
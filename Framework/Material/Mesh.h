@@ -4,6 +4,8 @@
 #include "../CommandList.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
+#include "GeometryPool.h"
+#include "../VertexQuantizer.h"
 
 #include <DirectXMath.h>
 #include <d3d12.h>
@@ -40,16 +42,57 @@ struct DX12_FW_API VertexPositionNormalTexture
     static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
 };
 
+// Half the size of VertexPositionNormalTexture: position in the box of the mesh, octahedral normal, half float texture
+// coordinate (see VertexQuantizer). The vertex shader dequantizes the position with the box of the mesh.
+struct DX12_FW_API VertexQuantized
+{
+    static const int InputElementCount = 3;
+    static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+};
+
 using VertexCollection = std::vector<VertexPositionNormalTexture>;
-using IndexCollection = std::vector<uint16_t>;
+using QuantizedVertexCollection = std::vector<VertexQuantizer::QuantizedVertex>;
+// 32-bit on the CPU: the index buffers are R16_UINT when the vertex count allows it (IndexBuffer::SelectIndexFormat).
+using IndexCollection = std::vector<uint32_t>;
 
 class DX12_FW_API Mesh
 {
 public:
 
     void Draw(CommandList& commandList);
-
-    static std::unique_ptr<Mesh> CreateFromData(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, bool rhcoords = false);
+    // Instanced draw: SV_InstanceID goes from 0 to instanceCount - 1 (startInstance only offsets the per-instance vertex data).
+    void Draw(CommandList& commandList, uint32_t instanceCount, uint32_t startInstance = 0);
+    // Draw a level of detail (0 = full resolution, clamped to the last LOD).
+    void DrawLod(CommandList& commandList, uint32_t lod, uint32_t instanceCount = 1, uint32_t startInstance = 0);
+
+    // The pool buffers for a mesh of a GeometryPool (shared with the other meshes of its block).
+    const VertexBuffer& GetVertexBuffer() const;
+    const IndexBuffer&  GetIndexBuffer() const;
+    UINT                GetIndexCount() const { return m_IndexCount; }
+    // Where the mesh starts in its buffers (0 for a mesh with its own buffers).
+    UINT                GetStartIndex() const { return m_PoolAllocation.StartIndex; }
+    INT                 GetBaseVertex() const { return static_cast<INT>(m_PoolAllocation.BaseVertex); }
+
+    // The LODs are ranges of the index buffer, after the full resolution indices (they share the vertices).
+    UINT                GetNumLods() const { return static_cast<UINT>(m_Lods.size()); }
+    UINT                GetIndexCount(UINT lod) const { return m_Lods[lod].IndexCount; }
+    UINT                GetStartIndex(UINT lod) const { return GetStartIndex() + m_Lods[lod].StartIndex; }
+
+    // @param geometryPool - Sub-allocate the vertices and indices from the pool (which must outlive the mesh),
+    //                       nullptr for separate buffers.
+    static std::unique_ptr<Mesh> CreateFromData(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, bool rhcoords = false, GeometryPool* geometryPool = nullptr);
+    // With LODs: indices holds the triangles of every LOD back to back (full resolution first), lodIndexCounts the
+    // number of indices of each LOD.
+    static std::unique_ptr<Mesh> CreateFromData(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices,
+        const std::vector<UINT>& lodIndexCounts, bool rhcoords = false, GeometryPool* geometryPool = nullptr);
+    // Quantized vertices, taken as they are (no winding change): the geometryPool must have a stride of
+    // sizeof(VertexQuantizer::QuantizedVertex).
+    static std::unique_ptr<Mesh> CreateFromData(CommandList& commandList, const QuantizedVertexCollection& vertices, const IndexCollection& indices,
+        const std::vector<UINT>& lodIndexCounts, GeometryPool* geometryPool = nullptr);
+    // Vertices of any layout (vertexStride bytes each), taken as they are, eg. in place in a memory mapped file: the
+    // data is only read during the call. The geometryPool must have a stride of vertexStride.
+    static std::unique_ptr<Mesh> CreateFromData(CommandList& commandList, size_t numVertices, size_t vertexStride, const void* vertexData,
+        size_t numIndices, const uint32_t* indexData, const std::vector<UINT>& lodIndexCounts, GeometryPool* geometryPool = nullptr);
 
     static std::unique_ptr<Mesh> CreateCube(CommandList& commandList, float size = 1, bool rhcoords = false);
     static std::unique_ptr<Mesh> CreateSphere(CommandList& commandList, float diameter = 1, size_t tessellation = 16, bool rhcoords = false);
@@ -66,10 +109,23 @@ private:
     Mesh(const Mesh& copy) = delete;
     virtual ~Mesh();
 
-    void Initialize(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, bool rhcoords);
+    void Initialize(CommandList& commandList, VertexCollection& vertices, IndexCollection& indices, const std::vector<UINT>& lodIndexCounts,
+        bool rhcoords, GeometryPool* geometryPool = nullptr);
+    void InitializeBuffers(CommandList& commandList, size_t numVertices, size_t vertexStride, const void* vertexData, size_t numIndices,
+        const uint32_t* indexData, const std::vector<UINT>& lodIndexCounts, GeometryPool* geometryPool);
 
     VertexBuffer m_VertexBuffer;
     IndexBuffer m_IndexBuffer;
 
+    GeometryPool* m_GeometryPool;
+    GeometryPool::Allocation m_PoolAllocation;
+
     UINT m_IndexCount;
+
+    struct Lod
+    {
+        UINT StartIndex;    // Relative to the start of the mesh.
+        UINT IndexCount;
+    };
+    std::vector<Lod> m_Lods;
 };
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "MipStreamingScheduler.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace
+{
+    struct Candidate
+    {
+        float                               Priority;
+        MipStreamingScheduler::TextureId    Texture;
+
+        // The highest priority on top of the queue, then the lowest id.
+        bool operator<( const Candidate& other ) const
+        {
+            return Priority != other.Priority ? Priority < other.Priority : Texture > other.Texture;
+        }
+    };
+
+    uint32_t GetMipSize( uint32_t width, uint32_t height, uint32_t mip )
+    {
+        return std::max( 1u, std::max( width, height ) >> mip );
+    }
+}
+
+float MipStreamingScheduler::EstimateScreenSize( float radius, float distance, float projectionScale )
+{
+    if ( distance <= radius )
+        return MaxScreenSize;
+
+    return std::min( 2.0f * radius * projectionScale / distance, MaxScreenSize );
+}
+
+uint32_t MipStreamingScheduler::SelectMip( uint32_t width, uint32_t height, uint32_t numMips, float screenSize )
+{
+    if ( numMips == 0 )
+        return 0;
+    if ( screenSize <= 0.0f )
+        return numMips - 1;
+
+    uint32_t mip = 0;
+    while ( mip + 1 < numMips && static_cast<float>( GetMipSize( width, height, mip + 1 ) ) >= screenSize )
+    {
+        ++mip;
+    }
+    return mip;
+}
+
+MipStreamingScheduler::TextureId MipStreamingScheduler::Add( uint32_t width, uint32_t height, std::vector<uint64_t> mipSizes, uint32_t residentMip )
+{
+    TextureId id;
+    if ( !m_FreeIds.empty() )
+    {
+        id = m_FreeIds.back();
+        m_FreeIds.pop_back();
+    }
+    else
+    {
+        id = static_cast<TextureId>( m_Entries.size() );
+        m_Entries.emplace_back();
+    }
+
+    Entry& entry = m_Entries[id];
+    entry.Width = width;
+    entry.Height = height;
+    entry.MipSizes = std::move( mipSizes );
+    entry.ResidentMip = std::min( residentMip, static_cast<uint32_t>( entry.MipSizes.size() ) );
+    entry.ScreenSize = 0.0f;
+    entry.InUse = true;
+
+    ++m_Stats.NumTextures;
+    return id;
+}
+
+void MipStreamingScheduler::Remove( TextureId id )
+{
+    if ( id >= m_Entries.size() || !m_Entries[id].InUse )
+        return;
+
+    m_Entries[id] = Entry();
+    m_FreeIds.push_back( id );
+    --m_Stats.NumTextures;
+}
+
+void MipStreamingScheduler::Request( TextureId id, float screenSize )
+{
+    if ( id >= m_Entries.size() || !m_Entries[id].InUse )
+        return;
+
+    Entry& entry = m_Entries[id];
+    entry.ScreenSize = std::max( entry.ScreenSize, screenSize );
+}
+
+std::vector<MipStreamingScheduler::Upload> MipStreamingScheduler::Schedule( uint64_t budgetInBytes )
+{
+    auto getPriority = []( const Entry& entry )
+    {
+        return entry.ScreenSize / static_cast<float>( GetMipSize( entry.Width, entry.Height, entry.ResidentMip ) );
+    };
+    auto isStreaming = []( const Entry& entry )
+    {
+        uint32_t numMips = static_cast<uint32_t>( entry.MipSizes.size() );
+        return entry.ResidentMip > SelectMip( entry.Width, entry.Height, numMips, entry.ScreenSize );
+    };
+
+    std::priority_queue<Candidate> candidates;
+    for ( TextureId id = 0; id < m_Entries.size(); ++id )
+    {
+        const Entry& entry = m_Entries[id];
+        if ( entry.InUse && isStreaming( entry ) )
+        {
+            candidates.push( { getPriority( entry ), id } );
+        }
+    }
+
+    std::vector<Upload> uploads;
+    uint64_t scheduledBytes = 0;
+    while ( !candidates.empty() )
+    {
+        TextureId id = candidates.top().Texture;
+        Entry& entry = m_Entries[id];
+
+        // In order: a smaller mip further down the queue waits for this one.
+        uint32_t mip = entry.ResidentMip - 1;
+        uint64_t sizeInBytes = entry.MipSizes[mip];
+        if ( !uploads.empty() && scheduledBytes + sizeInBytes > budgetInBytes )
+            break;
+
+        candidates.pop();
+        uploads.push_back( { id, mip, sizeInBytes } );
+        scheduledBytes += sizeInBytes;
+        entry.ResidentMip = mip;
+
+        if ( isStreaming( entry ) )
+        {
+            candidates.push( { getPriority( entry ), id } );
+        }
+    }
+
+    m_Stats.NumUploads += uploads.size();
+    m_Stats.UploadedBytes += scheduledBytes;
+    m_Stats.NumStreaming = 0;
+    m_Stats.PendingBytes = 0;
+    for ( Entry& entry : m_Entries )
+    {
+        if ( entry.InUse && isStreaming( entry ) )
+        {
+            uint32_t requestedMip = SelectMip( entry.Width, entry.Height, static_cast<uint32_t>( entry.MipSizes.size() ), entry.ScreenSize );
+            ++m_Stats.NumStreaming;
+            for ( uint32_t mip = requestedMip; mip < entry.ResidentMip; ++mip )
+            {
+                m_Stats.PendingBytes += entry.MipSizes[mip];
+            }
+        }
+        entry.ScreenSize = 0.0f;
+    }
+
+    return uploads;
+}
+
+uint32_t MipStreamingScheduler::GetResidentMip( TextureId id ) const
+{
+    return id < m_Entries.size() ? m_Entries[id].ResidentMip : 0;
+}
+
+uint32_t MipStreamingScheduler::GetNumMips( TextureId id ) const
+{
+    return id < m_Entries.size() ? static_cast<uint32_t>( m_Entries[id].MipSizes.size() ) : 0;
+}
+
+MipStreamingScheduler::Stats MipStreamingScheduler::GetStats() const
+{
+    return m_Stats;
+}
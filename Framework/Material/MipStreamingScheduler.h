@@ -0,0 +1,85 @@
+#pragma once
+
+// The order of the mip uploads of the streamed textures (see TextureStreamer): which mip of which texture next, within
+// a budget of bytes per frame. No device, no resource: the textures are ids with a size and the byte size of each mip.
+// --
+// Residency: a texture has its mips [ResidentMip, NumMips) uploaded, from the tail (the coarse mips, uploaded at load)
+// to mip 0. A mip is only uploaded after the next coarser one: the resident mips stay contiguous, a single clamp of the
+// views (ResourceMinLODClamp) covers them.
+// --
+// Requests: the screen size of the texture this frame, in pixels (the largest one of its requests), from the bounds
+// of what it is drawn on (EstimateScreenSize). It selects the requested mip, the least detailed one with a texel per
+// pixel (SelectMip). A texture not requested (not visible) gets no uploads; its resident mips stay.
+// --
+// Priority: the magnification of the resident mip, screen size / texels (the most blurry texture first). Uploading a
+// mip halves it: the next mip of a large texture comes after the first ones of the others. Ties: the lower id.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API MipStreamingScheduler
+{
+public:
+    using TextureId = uint32_t;
+    static constexpr TextureId InvalidId = UINT32_MAX;
+
+    struct Upload
+    {
+        TextureId   Texture;
+        uint32_t    Mip;
+        uint64_t    SizeInBytes;
+    };
+
+    struct Stats
+    {
+        uint32_t    NumTextures = 0;
+        uint32_t    NumStreaming = 0;       // Requested at a more detailed mip than the resident one, after the last Schedule.
+        uint64_t    PendingBytes = 0;       // Their requested mips that aren't resident.
+        uint64_t    NumUploads = 0;
+        uint64_t    UploadedBytes = 0;
+    };
+
+    // The screen height, in pixels, of a sphere at a distance (of its center) from the camera.
+    // @param projectionScale - The pixels of a unit at a distance of 1: viewport height / (2 tan(fovY / 2)).
+    // The camera inside the sphere: MaxScreenSize.
+    static float EstimateScreenSize( float radius, float distance, float projectionScale );
+    static constexpr float MaxScreenSize = 16384.0f;
+
+    // The least detailed mip with at least screenSize texels along the largest dimension (0 if none has). No request
+    // (screenSize <= 0): the last mip.
+    static uint32_t SelectMip( uint32_t width, uint32_t height, uint32_t numMips, float screenSize );
+
+    // @param mipSizes - The size of each mip, in bytes (the number of mips).
+    // @param residentMip - The most detailed mip already uploaded.
+    TextureId Add( uint32_t width, uint32_t height, std::vector<uint64_t> mipSizes, uint32_t residentMip );
+    void Remove( TextureId id );
+
+    void Request( TextureId id, float screenSize );
+
+    // The uploads of the frame, in priority order: the highest priority mips within the budget (at least one, a mip
+    // larger than the budget isn't skipped forever). They are resident once returned: the caller records them before
+    // the draws that sample them. Clears the requests.
+    std::vector<Upload> Schedule( uint64_t budgetInBytes );
+
+    uint32_t GetResidentMip( TextureId id ) const;
+    uint32_t GetNumMips( TextureId id ) const;
+
+    Stats GetStats() const;
+
+private:
+    struct Entry
+    {
+        uint32_t                Width = 0;
+        uint32_t                Height = 0;
+        std::vector<uint64_t>   MipSizes;
+        uint32_t                ResidentMip = 0;
+        float                   ScreenSize = 0.0f;      // Of the frame, 0: not requested.
+        bool                    InUse = false;
+    };
+
+    std::vector<Entry>      m_Entries;
+    std::vector<TextureId>  m_FreeIds;
+    Stats                   m_Stats;
+};
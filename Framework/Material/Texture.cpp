@@ -1,5 +1,7 @@
 #include "Texture.h"
 
+#include "TextureStreamer.h"
+
 #include <Framework/ResourceStateTracker.h>
 #include <Framework/Application.h>
 
@@ -35,6 +37,8 @@ Texture::Texture(Microsoft::WRL::ComPtr<ID3D12Resource> resource,
 Texture::Texture(const Texture& copy)
     : Resource(copy)
 	, m_TextureUsage(copy.m_TextureUsage)
+    , m_CacheHandle(copy.m_CacheHandle)
+    , m_StreamedTexture(copy.m_StreamedTexture)
 {
     CreateViews();
 }
@@ -42,6 +46,8 @@ Texture::Texture(const Texture& copy)
 Texture::Texture(Texture&& copy)
     : Resource(std::move(copy))
 	, m_TextureUsage(copy.m_TextureUsage)
+    , m_CacheHandle(std::move(copy.m_CacheHandle))
+    , m_StreamedTexture(std::move(copy.m_StreamedTexture))
 {
     CreateViews();
 }
@@ -50,6 +56,8 @@ Texture& Texture::operator=(const Texture& other)
 {
     Resource::operator=(other);
     m_TextureUsage = other.m_TextureUsage;
+    m_CacheHandle = other.m_CacheHandle;
+    m_StreamedTexture = other.m_StreamedTexture;
 
     CreateViews();
 
@@ -59,6 +67,8 @@ Texture& Texture::operator=(Texture&& other)
 {
     Resource::operator=(std::move(other));
     m_TextureUsage = other.m_TextureUsage;
+    m_CacheHandle = std::move(other.m_CacheHandle);
+    m_StreamedTexture = std::move(other.m_StreamedTexture);
 
     CreateViews();
 
@@ -81,6 +91,8 @@ void Texture::Resize(uint32_t width, uint32_t height, uint32_t depthOrArraySize
         }
 
         ResourceStateTracker::RemoveGlobalResourceState(m_d3d12Resource.Get());
+        m_CacheHandle.reset();
+        m_StreamedTexture.reset();
 
         resDesc.Width = std::max( width, 1u );
         resDesc.Height = std::max( height, 1u );
@@ -251,6 +263,23 @@ DescriptorAllocation Texture::CreateUnorderedAccessView(const D3D12_UNORDERED_AC
 
 D3D12_CPU_DESCRIPTOR_HANDLE Texture::GetShaderResourceView(const D3D12_SHADER_RESOURCE_VIEW_DESC* srvDesc) const
 {
+    // A streamed texture: the default view without the mips that aren't uploaded yet (one view per resident mip).
+    if (!srvDesc && m_StreamedTexture)
+    {
+        uint32_t residentMip = m_StreamedTexture->ResidentMip.load();
+        if (residentMip > 0)
+        {
+            D3D12_SHADER_RESOURCE_VIEW_DESC clampedDesc = {};
+            clampedDesc.Format = GetD3D12ResourceDesc().Format;
+            clampedDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            clampedDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+            clampedDesc.Texture2D.MostDetailedMip = 0;
+            clampedDesc.Texture2D.MipLevels = UINT(-1);
+            clampedDesc.Texture2D.ResourceMinLODClamp = static_cast<float>(residentMip);
+            return GetShaderResourceView(&clampedDesc);
+        }
+    }
+
     std::size_t hash = 0;
     if (srvDesc)
     {
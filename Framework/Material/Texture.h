@@ -12,6 +12,7 @@
 #include <unordered_map>
 
 class Application;
+struct StreamedTexture;
 
 class DX12_FW_API Texture : public Resource
 {
@@ -98,6 +99,25 @@ public:
     static DXGI_FORMAT GetTypelessFormat(DXGI_FORMAT format);
     static DXGI_FORMAT GetUAVCompatableFormat(DXGI_FORMAT format);
 
+    // The TextureCache entry of the resource, if it was loaded through the cache: the entry can't be evicted while a
+    // texture holds it. Copied with the texture, released by Resize (a new resource).
+    void SetCacheHandle(std::shared_ptr<const void> cacheHandle)
+    {
+        m_CacheHandle = std::move(cacheHandle);
+    }
+
+    // The streaming state of the resource, if its mips are streamed (see TextureStreamer): the default SRV is clamped
+    // to its resident mip. Copied with the texture, released by Resize.
+    void SetStreamedTexture(std::shared_ptr<const StreamedTexture> streamedTexture)
+    {
+        m_StreamedTexture = std::move(streamedTexture);
+    }
+
+    const std::shared_ptr<const StreamedTexture>& GetStreamedTexture() const
+    {
+        return m_StreamedTexture;
+    }
+
 protected:
 
 private:
@@ -114,4 +134,6 @@ private:
     DescriptorAllocation                                        m_DepthStencilView;
 
     TextureUsage                                                m_TextureUsage;
+    std::shared_ptr<const void>                                 m_CacheHandle;
+    std::shared_ptr<const StreamedTexture>                      m_StreamedTexture;
 };
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <filesystem>
+#include <functional>
+
+size_t TextureCache::KeyHash::operator()( const Key& key ) const
+{
+    size_t hash = std::hash<std::wstring>()( key.Path );
+    hash ^= ( static_cast<size_t>( key.Usage ) * 2 + ( key.SRGB ? 1 : 0 ) + 0x9E3779B9 ) + ( hash << 6 ) + ( hash >> 2 );
+    return hash;
+}
+
+TextureCache::TextureCache( uint64_t budgetInBytes )
+    : m_Budget( budgetInBytes )
+{}
+
+TextureCache::Key TextureCache::MakeKey( const std::wstring& fileName, TextureUsage usage, bool sRGB )
+{
+    std::error_code error;
+    std::filesystem::path path = std::filesystem::absolute( fileName, error );
+    if ( error )
+    {
+        path = fileName;
+    }
+
+    // The paths are case insensitive on Windows.
+    Key key;
+    key.Path = path.lexically_normal().wstring();
+    std::transform( key.Path.begin(), key.Path.end(), key.Path.begin(), []( wchar_t c ) { return static_cast<wchar_t>( std::towlower( c ) ); } );
+    key.Usage = usage;
+    key.SRGB = sRGB;
+    return key;
+}
+
+TextureCache::Handle TextureCache::Acquire( const Key& key, bool& isNew )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    auto iter = m_Entries.find( key );
+    if ( iter != m_Entries.end() )
+    {
+        Entry* entry = iter->second.get();
+        m_Lru.splice( m_Lru.begin(), m_Lru, entry->LruPosition );
+        ++m_NumHits;
+        isNew = false;
+        return iter->second;
+    }
+
+    Handle handle = std::make_shared<Entry>();
+    handle->CacheKey = key;
+    handle->Resource = handle->Promise.get_future().share();
+    m_Lru.push_front( handle.get() );
+    handle->LruPosition = m_Lru.begin();
+    m_Entries.emplace( key, handle );
+
+    ++m_NumMisses;
+    isNew = true;
+    return handle;
+}
+
+void TextureCache::Complete( const Handle& handle, Microsoft::WRL::ComPtr<ID3D12Resource> resource, uint64_t sizeInBytes )
+{
+    handle->Promise.set_value( std::move( resource ) );
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    handle->SizeInBytes = sizeInBytes;
+    handle->IsResident = true;
+    m_ResidentBytes += sizeInBytes;
+
+    TrimLocked();
+}
+
+void TextureCache::Fail( const Handle& handle, std::exception_ptr exception )
+{
+    handle->Promise.set_exception( exception );
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    auto iter = m_Entries.find( handle->CacheKey );
+    if ( iter != m_Entries.end() && iter->second == handle )
+    {
+        m_Lru.erase( handle->LruPosition );
+        m_Entries.erase( iter );
+    }
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> TextureCache::GetResource( const Handle& handle )
+{
+    return handle->Resource.get();
+}
+
+bool TextureCache::Contains( const Key& key ) const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return m_Entries.find( key ) != m_Entries.end();
+}
+
+void TextureCache::SetBudget( uint64_t budgetInBytes )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    m_Budget = budgetInBytes;
+    TrimLocked();
+}
+
+void TextureCache::Trim()
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    TrimLocked();
+}
+
+void TextureCache::TrimLocked()
+{
+    // From the least recently requested. Only the cache holds a handle of an entry not in use: no other one can be
+    // created without the lock, so the count can't go up under it.
+    auto iter = m_Lru.end();
+    while ( m_ResidentBytes > m_Budget && iter != m_Lru.begin() )
+    {
+        --iter;
+        Entry* entry = *iter;
+        auto entryIter = m_Entries.find( entry->CacheKey );
+        if ( !entry->IsResident || entryIter->second.use_count() > 1 )
+            continue;
+
+        m_ResidentBytes -= entry->SizeInBytes;
+        ++m_NumEvictions;
+        iter = m_Lru.erase( iter );
+        m_Entries.erase( entryIter );
+    }
+}
+
+TextureCache::Stats TextureCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    Stats stats;
+    stats.NumHits = m_NumHits;
+    stats.NumMisses = m_NumMisses;
+    stats.NumEvictions = m_NumEvictions;
+    stats.ResidentBytes = m_ResidentBytes;
+    stats.NumEntries = static_cast<uint32_t>( m_Entries.size() );
+    for ( const auto& entry : m_Entries )
+    {
+        if ( entry.second.use_count() > 1 )
+            ++stats.NumEntriesInUse;
+    }
+    return stats;
+}
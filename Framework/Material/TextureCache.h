@@ -0,0 +1,107 @@
+#pragma once
+
+// The textures loaded from files, shared by the loads of the same file with the same settings.
+// --
+// Key: the normalized path (absolute, lexically normal, lower case), the usage and the sRGB flag, hashed.
+// Entry: a shared future of the resource. The first request of a key creates the entry and loads the texture (then
+// Complete or Fail), the concurrent requests of the key wait for that load instead of loading the file again.
+// Handle: a reference to the entry, kept by the textures that use it (Texture::SetCacheHandle): an entry is in use
+// while a handle other than the cache's own exists.
+// Eviction: least recently requested first, among the resident entries not in use, while the resident bytes exceed
+// the budget. The cache only drops its reference: a command list in flight keeps the resource alive (TrackedObjects).
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include "TextureUsage.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class DX12_FW_API TextureCache
+{
+public:
+    static constexpr uint64_t UnlimitedBudget = UINT64_MAX;
+
+    struct Key
+    {
+        std::wstring    Path;
+        TextureUsage    Usage = TextureUsage::Albedo;
+        bool            SRGB = false;
+
+        bool operator==( const Key& other ) const { return Path == other.Path && Usage == other.Usage && SRGB == other.SRGB; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()( const Key& key ) const;
+    };
+
+    struct Entry
+    {
+        Key                                                             CacheKey;
+        std::promise<Microsoft::WRL::ComPtr<ID3D12Resource>>            Promise;
+        std::shared_future<Microsoft::WRL::ComPtr<ID3D12Resource>>      Resource;
+        uint64_t                                                        SizeInBytes = 0;
+        bool                                                            IsResident = false;     // Completed.
+        std::list<Entry*>::iterator                                     LruPosition;
+    };
+    using Handle = std::shared_ptr<Entry>;
+
+    struct Stats
+    {
+        uint64_t    NumHits = 0;            // Requests of a resident or loading key.
+        uint64_t    NumMisses = 0;
+        uint64_t    NumEvictions = 0;
+        uint64_t    ResidentBytes = 0;
+        uint32_t    NumEntries = 0;         // Resident or loading.
+        uint32_t    NumEntriesInUse = 0;
+
+        double GetHitRate() const { return NumHits + NumMisses > 0 ? static_cast<double>( NumHits ) / ( NumHits + NumMisses ) : 0.0; }
+    };
+
+    explicit TextureCache( uint64_t budgetInBytes = UnlimitedBudget );
+
+    static Key MakeKey( const std::wstring& fileName, TextureUsage usage, bool sRGB );
+
+    // The entry of the key, created if there is none (isNew): then the caller loads it, and must call Complete or Fail.
+    Handle Acquire( const Key& key, bool& isNew );
+    // The resident size is the allocation size of the resource. Evicts down to the budget.
+    void Complete( const Handle& handle, Microsoft::WRL::ComPtr<ID3D12Resource> resource, uint64_t sizeInBytes );
+    // The entry is removed (a later request loads the file again), the waiting requests get the exception.
+    void Fail( const Handle& handle, std::exception_ptr exception );
+
+    // Waits for the load of the entry. Rethrows its failure.
+    static Microsoft::WRL::ComPtr<ID3D12Resource> GetResource( const Handle& handle );
+
+    bool Contains( const Key& key ) const;
+
+    // Evicts down to the new budget.
+    void SetBudget( uint64_t budgetInBytes );
+    uint64_t GetBudget() const { return m_Budget; }
+    // Evicts the least recently requested entries not in use while over the budget (the textures released since the
+    // last call can make room). Called by Complete and SetBudget.
+    void Trim();
+
+    Stats GetStats() const;
+
+private:
+    void TrimLocked();
+
+    std::unordered_map<Key, Handle, KeyHash>    m_Entries;
+    std::list<Entry*>                           m_Lru;      // Most recently requested first.
+    uint64_t                                    m_Budget;
+    uint64_t                                    m_ResidentBytes = 0;
+    uint64_t                                    m_NumHits = 0;
+    uint64_t                                    m_NumMisses = 0;
+    uint64_t                                    m_NumEvictions = 0;
+    mutable std::mutex                          m_Mutex;
+};
@@ -0,0 +1,57 @@
+#include "TextureDecoder.h"
+
+#include "DDSFile.h"
+
+#include <Framework/3RD_Party/Helpers.h>
+
+#include <External/DirectXTex/DirectXTex/DirectXTex.h>
+
+#include <filesystem>
+
+void TextureDecoder::Decode( const std::wstring& fileName, DDSFile& file, DirectX::TexMetadata& metadata, DirectX::ScratchImage& image )
+{
+    std::filesystem::path filePath( fileName );
+    if ( filePath.extension() == ".dds" && file.Open( fileName ) )
+    {
+        return;
+    }
+
+    // WIC needs COM on the decoding thread (the thread pool workers don't initialize it).
+    HRESULT comResult = CoInitializeEx( nullptr, COINIT_MULTITHREADED );
+    struct ComScope
+    {
+        bool Initialized;
+        ~ComScope() { if ( Initialized ) CoUninitialize(); }
+    } comScope = { SUCCEEDED( comResult ) };
+
+    if ( filePath.extension() == ".dds" )
+    {
+        ThrowIfFailed( LoadFromDDSFile( 
+            fileName.c_str(),
+            DirectX::DDS_FLAGS_NONE,
+            &metadata,
+            image ) );
+    }
+    else if ( filePath.extension() == ".hdr" )
+    {
+        ThrowIfFailed( LoadFromHDRFile( 
+            fileName.c_str(), 
+            &metadata, 
+            image ) );
+    }
+    else if ( filePath.extension() == ".tga" )
+    {
+        ThrowIfFailed( LoadFromTGAFile( 
+            fileName.c_str(), 
+            &metadata, 
+            image ) );
+    }
+    else
+    {
+        ThrowIfFailed( LoadFromWICFile( 
+            fileName.c_str(), 
+            DirectX::WIC_FLAGS_NONE,
+            &metadata, 
+            image ) );
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// Disk read and decode of a texture file on the CPU: DDS, HDR, TGA, else WIC (PNG, JPEG, BMP...). A DDS file stored in
+// a format D3D12 uses as is is only mapped (see DDSFile), its upload reads the mapped view; the other DDS files are
+// decoded by DirectXTex (LoadFromDDSFile expands them).
+// No device is used, the files can be decoded on any thread (COM is initialized for WIC on the calling thread).
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <string>
+
+namespace DirectX
+{
+    class ScratchImage;
+    struct TexMetadata;
+}
+
+class DDSFile;
+
+class DX12_FW_API TextureDecoder
+{
+public:
+    // Either opens file (the DDS files DDSFile reads), or decodes the file into metadata and image.
+    // Throws if the file can't be decoded.
+    static void Decode( const std::wstring& fileName, DDSFile& file, DirectX::TexMetadata& metadata, DirectX::ScratchImage& image );
+};
@@ -0,0 +1,243 @@
+#include "TextureProcessor.h"
+
+#include "DDSFile.h"
+
+#include <Framework/3RD_Party/Helpers.h>
+#include <Framework/ThreadPool.h>
+#include <Framework/Gameplay/ModelCache.h>
+
+#include <External/DirectXTex/DirectXTex/DirectXTex.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cwctype>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr size_t BlockSize = 4;
+
+    bool IsFloatFormat( DXGI_FORMAT format )
+    {
+        switch ( format )
+        {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R32G32B32_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R11G11B10_FLOAT:
+            case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // The block rows [FirstBlockRow, EndBlockRow) of an image.
+    struct EncodeStrip
+    {
+        size_t  Image;
+        size_t  FirstBlockRow;
+        size_t  EndBlockRow;
+    };
+}
+
+DXGI_FORMAT TextureProcessor::SelectFormat( TextureUsage usage, const DirectX::TexMetadata& metadata )
+{
+    if ( usage == TextureUsage::RenderTarget || DirectX::IsCompressed( metadata.format ) )
+        return DXGI_FORMAT_UNKNOWN;
+
+    if ( metadata.width % BlockSize != 0 || metadata.height % BlockSize != 0 )
+        return DXGI_FORMAT_UNKNOWN;
+
+    if ( IsFloatFormat( metadata.format ) )
+        return DXGI_FORMAT_BC6H_UF16;
+
+    switch ( usage )
+    {
+        case TextureUsage::Normalmap:
+            return DXGI_FORMAT_BC5_UNORM;
+        case TextureUsage::Heightmap:
+            return DXGI_FORMAT_BC4_UNORM;
+        default:
+            return DXGI_FORMAT_BC7_UNORM;
+    }
+}
+
+void TextureProcessor::Process( DirectX::ScratchImage& image, DXGI_FORMAT format, bool sRGB, ThreadPool& threadPool )
+{
+    if ( DirectX::IsCompressed( image.GetMetadata().format ) )
+        return;
+
+    // The mips of a source that has none. Not the WIC filters: they ignore the sRGB flag, and need COM on the thread.
+    const DirectX::TexMetadata& sourceMetadata = image.GetMetadata();
+    if ( sourceMetadata.mipLevels == 1 && ( sourceMetadata.width > 1 || sourceMetadata.height > 1 ) )
+    {
+        DWORD filter = DirectX::TEX_FILTER_DEFAULT | DirectX::TEX_FILTER_FORCE_NON_WIC | ( sRGB ? DirectX::TEX_FILTER_SRGB : 0 );
+
+        DirectX::ScratchImage mipChain;
+        if ( sourceMetadata.dimension == DirectX::TEX_DIMENSION_TEXTURE3D )
+        {
+            ThrowIfFailed( DirectX::GenerateMipMaps3D( image.GetImages(), image.GetImageCount(), sourceMetadata, filter, 0, mipChain ) );
+        }
+        else
+        {
+            ThrowIfFailed( DirectX::GenerateMipMaps( image.GetImages(), image.GetImageCount(), sourceMetadata, filter, 0, mipChain ) );
+        }
+        image = std::move( mipChain );
+    }
+
+    if ( format == DXGI_FORMAT_UNKNOWN )
+        return;
+
+    DirectX::TexMetadata compressedMetadata = image.GetMetadata();
+    compressedMetadata.format = format;
+
+    DirectX::ScratchImage compressed;
+    ThrowIfFailed( compressed.Initialize( compressedMetadata ) );
+
+    // Same image order in both: mip, array item (or depth slice).
+    const DirectX::Image* sourceImages = image.GetImages();
+    const DirectX::Image* compressedImages = compressed.GetImages();
+
+    std::vector<EncodeStrip> strips;
+    for ( size_t i = 0; i < image.GetImageCount(); ++i )
+    {
+        size_t numBlockRows = ( sourceImages[i].height + BlockSize - 1 ) / BlockSize;
+        for ( size_t blockRow = 0; blockRow < numBlockRows; blockRow += StripBlockRows )
+        {
+            strips.push_back( { i, blockRow, std::min<size_t>( blockRow + StripBlockRows, numBlockRows ) } );
+        }
+    }
+
+    // The encoders of the block formats are per block: a strip of block rows is a valid image of its own, and its
+    // blocks are the rows of the compressed image. Quick BC7 (mostly mode 6): the full search is 10x slower for
+    // little gain on textures that are sampled filtered.
+    DWORD compressFlags = ( format == DXGI_FORMAT_BC7_UNORM ) ? DirectX::TEX_COMPRESS_BC7_QUICK : DirectX::TEX_COMPRESS_DEFAULT;
+
+    threadPool.ParallelFor( strips.size(), strips.size(), [&]( size_t, size_t begin, size_t end )
+    {
+        for ( size_t s = begin; s < end; ++s )
+        {
+            const EncodeStrip& strip = strips[s];
+            const DirectX::Image& source = sourceImages[strip.Image];
+            const DirectX::Image& destination = compressedImages[strip.Image];
+
+            size_t firstRow = strip.FirstBlockRow * BlockSize;
+            size_t numRows = std::min( source.height, strip.EndBlockRow * BlockSize ) - firstRow;
+
+            DirectX::Image sourceStrip = source;
+            sourceStrip.height = numRows;
+            sourceStrip.pixels = source.pixels + firstRow * source.rowPitch;
+            sourceStrip.slicePitch = numRows * source.rowPitch;
+
+            DirectX::ScratchImage encoded;
+            ThrowIfFailed( DirectX::Compress( sourceStrip, format, compressFlags, DirectX::TEX_THRESHOLD_DEFAULT, encoded ) );
+
+            const DirectX::Image* encodedImage = encoded.GetImage( 0, 0, 0 );
+            std::memcpy( destination.pixels + strip.FirstBlockRow * destination.rowPitch, encodedImage->pixels, encodedImage->slicePitch );
+        }
+    } );
+
+    image = std::move( compressed );
+}
+
+void TextureProcessor::SetCacheDirectory( const std::wstring& cacheDirectory )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    m_CacheDirectory = cacheDirectory;
+}
+
+std::wstring TextureProcessor::GetCacheDirectory() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return m_CacheDirectory;
+}
+
+bool TextureProcessor::IsEnabled() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return !m_CacheDirectory.empty();
+}
+
+std::wstring TextureProcessor::GetCachePath( const std::wstring& fileName, TextureUsage usage, bool sRGB ) const
+{
+    std::wstring cacheDirectory = GetCacheDirectory();
+    if ( cacheDirectory.empty() )
+        return {};
+
+    std::wstring extension = std::filesystem::path( fileName ).extension().wstring();
+    std::transform( extension.begin(), extension.end(), extension.begin(), []( wchar_t c ) { return static_cast<wchar_t>( std::towlower( c ) ); } );
+    if ( extension == L".dds" )
+        return {};
+
+    // Seeded with the version: a new processing never reads the files of the previous one.
+    uint64_t hash = 0;
+    uint64_t size = 0;
+    if ( !ModelCache::HashFile( fileName, hash, size, Version ) )
+        return {};
+
+    wchar_t name[64];
+    swprintf_s( name, L"%016llX_%u%s.dds", static_cast<unsigned long long>( hash ), static_cast<uint32_t>( usage ), sRGB ? L"_srgb" : L"" );
+    return ( std::filesystem::path( cacheDirectory ) / name ).wstring();
+}
+
+bool TextureProcessor::LoadCached( const std::wstring& cachePath, DDSFile& file )
+{
+    // ProcessAndCache writes a DX10 header: every format it writes is read in place.
+    if ( !file.Open( cachePath ) )
+        return false;
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    ++m_Stats.NumCacheHits;
+    return true;
+}
+
+void TextureProcessor::ProcessAndCache( const std::wstring& cachePath, TextureUsage usage, bool sRGB, DirectX::TexMetadata& metadata,
+                                        DirectX::ScratchImage& image, ThreadPool& threadPool )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    uint64_t sourceBytes = image.GetPixelsSize();
+    DXGI_FORMAT format = SelectFormat( usage, metadata );
+    Process( image, format, sRGB, threadPool );
+    metadata = image.GetMetadata();
+
+    double encodeMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - start ).count();
+
+    // A temporary file per thread: two sources with the same content can be processed at once.
+    std::error_code error;
+    std::filesystem::path path( cachePath );
+    std::filesystem::create_directories( path.parent_path(), error );
+
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += L".tmp" + std::to_wstring( std::hash<std::thread::id>()( std::this_thread::get_id() ) );
+    if ( SUCCEEDED( DirectX::SaveToDDSFile( image.GetImages(), image.GetImageCount(), metadata, DirectX::DDS_FLAGS_FORCE_DX10_EXT, temporaryPath.c_str() ) ) )
+    {
+        std::filesystem::rename( temporaryPath, path, error );
+    }
+    std::filesystem::remove( temporaryPath, error );
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    ++m_Stats.NumProcessed;
+    if ( format == DXGI_FORMAT_UNKNOWN )
+        ++m_Stats.NumUncompressed;
+    m_Stats.EncodeMilliseconds += encodeMilliseconds;
+    m_Stats.SourceBytes += sourceBytes;
+    m_Stats.ProcessedBytes += image.GetPixelsSize();
+}
+
+TextureProcessor::Stats TextureProcessor::GetStats() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return m_Stats;
+}
+
+void TextureProcessor::ResetStats()
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    m_Stats = Stats();
+}
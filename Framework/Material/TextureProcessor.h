@@ -0,0 +1,85 @@
+#pragma once
+
+// Load time processing of the texture files: the full mip chain, block compressed in the format of the usage, kept in a
+// DDS cache so the next loads upload the file as is (no decode of the source, no mip generation on the GPU).
+// --
+// Formats: BC6H for the HDR (float) sources, BC5 for the normal maps (RG, the shader rebuilds Z), BC4 for the
+// single channel maps (heightmap), BC7 for the rest (albedo, and the packed occlusion/roughness/metalness maps that
+// use more than one channel). 1 byte per texel (BC4: 0.5) instead of 4 (RGBA8) or 16 (RGBA32F). The sRGB flag stays a
+// view of the load (MakeSRGB of the stored UNORM format): the mips of an sRGB texture are filtered in linear space.
+// --
+// Not compressed: a render target usage, a source already block compressed, or a top level with a size that isn't a
+// multiple of the block size (D3D12 requires it). Such a texture still gets its mip chain.
+// --
+// Cache: content addressed, <hash of the source file>_<usage>[_srgb].dds in the cache directory. An edited source has
+// another name, Version changes the names when the processing does. The files are written through a temporary file.
+// --
+// Encoding: each image is split in strips of block rows, compressed by the thread pool (the calling thread included).
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include "TextureUsage.h"
+
+#include <dxgiformat.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace DirectX
+{
+    class ScratchImage;
+    struct TexMetadata;
+}
+
+class DDSFile;
+class ThreadPool;
+
+class DX12_FW_API TextureProcessor
+{
+public:
+    static constexpr uint32_t Version = 1;
+    static constexpr uint32_t StripBlockRows = 16;      // 64 texel rows per encoding task.
+
+    struct Stats
+    {
+        uint32_t    NumProcessed = 0;           // Decoded and processed (then written to the cache).
+        uint32_t    NumCacheHits = 0;
+        uint32_t    NumUncompressed = 0;        // Processed without block compression (see above).
+        double      EncodeMilliseconds = 0.0;   // Mips and compression, summed over the processed textures.
+        uint64_t    SourceBytes = 0;            // The decoded top levels, as they would be uploaded without processing.
+        uint64_t    ProcessedBytes = 0;         // The processed mip chains.
+    };
+
+    // DXGI_FORMAT_UNKNOWN: not compressed.
+    static DXGI_FORMAT SelectFormat( TextureUsage usage, const DirectX::TexMetadata& metadata );
+
+    // Replaces image with its full mip chain, in format (if not DXGI_FORMAT_UNKNOWN). Throws on failure.
+    static void Process( DirectX::ScratchImage& image, DXGI_FORMAT format, bool sRGB, ThreadPool& threadPool );
+
+    // Empty: disabled, the textures are uploaded as decoded.
+    void SetCacheDirectory( const std::wstring& cacheDirectory );
+    std::wstring GetCacheDirectory() const;
+    bool IsEnabled() const;
+
+    // The cache file of the content of fileName. Empty if disabled, if the source can't be read, or if it is already a
+    // DDS file (used as is).
+    std::wstring GetCachePath( const std::wstring& fileName, TextureUsage usage, bool sRGB ) const;
+
+    // Maps the cache file: its subresources are uploaded from the mapped view (see DDSFile).
+    // @return false on a miss (no file, or not readable).
+    bool LoadCached( const std::wstring& cachePath, DDSFile& file );
+
+    // Processes the decoded image of a source file in place and writes it to cachePath. A failed write only costs the
+    // processing at the next load.
+    void ProcessAndCache( const std::wstring& cachePath, TextureUsage usage, bool sRGB, DirectX::TexMetadata& metadata,
+                          DirectX::ScratchImage& image, ThreadPool& threadPool );
+
+    Stats GetStats() const;
+    void ResetStats();
+
+private:
+    std::wstring        m_CacheDirectory;
+    Stats               m_Stats;
+    mutable std::mutex  m_Mutex;
+};
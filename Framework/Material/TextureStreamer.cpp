@@ -0,0 +1,147 @@
+#include "TextureStreamer.h"
+
+#include "Texture.h"
+
+#include <algorithm>
+
+bool TextureStreamer::IsStreamable( const D3D12_RESOURCE_DESC& resourceDesc, size_t numSubresources )
+{
+    return resourceDesc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D && resourceDesc.DepthOrArraySize == 1 &&
+           numSubresources == resourceDesc.MipLevels && GetTailMip( resourceDesc ) > 0;
+}
+
+uint32_t TextureStreamer::GetTailMip( const D3D12_RESOURCE_DESC& resourceDesc )
+{
+    uint64_t size = std::max<uint64_t>( resourceDesc.Width, resourceDesc.Height );
+    uint32_t mip = 0;
+    while ( mip + 1u < resourceDesc.MipLevels && ( size >> mip ) > TailSize )
+    {
+        ++mip;
+    }
+    return mip;
+}
+
+void TextureStreamer::SetEnabled( bool enabled )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    m_Enabled = enabled;
+}
+
+bool TextureStreamer::IsEnabled() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return m_Enabled;
+}
+
+TextureStreamer::Handle TextureStreamer::Add( const TextureCache::Key& key, Microsoft::WRL::ComPtr<ID3D12Resource> resource, std::shared_ptr<const void> source,
+                                              std::vector<D3D12_SUBRESOURCE_DATA> subresources, uint32_t residentMip )
+{
+    D3D12_RESOURCE_DESC resourceDesc = resource->GetDesc();
+
+    // The sizes as stored: the upload footprints only differ by the alignment of the rows.
+    std::vector<uint64_t> mipSizes( subresources.size() );
+    for ( size_t mip = 0; mip < subresources.size(); ++mip )
+    {
+        mipSizes[mip] = static_cast<uint64_t>( subresources[mip].SlicePitch );
+    }
+
+    Handle texture = std::make_shared<StreamedTexture>();
+    texture->CacheKey = key;
+    texture->Resource = std::move( resource );
+    texture->Source = std::move( source );
+    texture->Subresources = std::move( subresources );
+    texture->ResidentMip = residentMip;
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    texture->Id = m_Scheduler.Add( static_cast<uint32_t>( resourceDesc.Width ), resourceDesc.Height, std::move( mipSizes ), residentMip );
+
+    Handle& entry = m_Textures[key];
+    if ( entry )
+    {
+        m_Scheduler.Remove( entry->Id );
+    }
+    entry = texture;
+    return texture;
+}
+
+TextureStreamer::Handle TextureStreamer::Find( const TextureCache::Key& key ) const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    auto iter = m_Textures.find( key );
+    return iter != m_Textures.end() ? iter->second : nullptr;
+}
+
+void TextureStreamer::Request( const Texture& texture, float screenSize )
+{
+    const StreamedTexture* streamedTexture = texture.GetStreamedTexture().get();
+    if ( !streamedTexture )
+        return;
+
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    m_Scheduler.Request( streamedTexture->Id, screenSize );
+}
+
+std::vector<TextureStreamer::Upload> TextureStreamer::Schedule( uint64_t budgetInBytes, const TextureCache& textureCache )
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+
+    // Evicted, and released by the textures: no load can get the entry anymore.
+    for ( auto iter = m_Textures.begin(); iter != m_Textures.end(); )
+    {
+        if ( iter->second.use_count() == 1 && !textureCache.Contains( iter->first ) )
+        {
+            m_Scheduler.Remove( iter->second->Id );
+            iter = m_Textures.erase( iter );
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    std::vector<MipStreamingScheduler::Upload> mipUploads = m_Scheduler.Schedule( budgetInBytes );
+    if ( mipUploads.empty() )
+        return {};
+
+    std::unordered_map<MipStreamingScheduler::TextureId, Handle> textures;
+    for ( const auto& entry : m_Textures )
+    {
+        textures[entry.second->Id] = entry.second;
+    }
+
+    // The mips of a texture come from the coarsest one: the last one is the first mip of the range.
+    std::vector<Upload> uploads;
+    std::unordered_map<MipStreamingScheduler::TextureId, size_t> uploadIndices;
+    for ( const MipStreamingScheduler::Upload& mipUpload : mipUploads )
+    {
+        auto indexIter = uploadIndices.find( mipUpload.Texture );
+        if ( indexIter == uploadIndices.end() )
+        {
+            uploadIndices[mipUpload.Texture] = uploads.size();
+            uploads.push_back( { textures[mipUpload.Texture], mipUpload.Mip, 1 } );
+        }
+        else
+        {
+            Upload& upload = uploads[indexIter->second];
+            upload.FirstMip = mipUpload.Mip;
+            ++upload.NumMips;
+        }
+    }
+
+    ++m_ResidencyVersion;
+    return uploads;
+}
+
+uint64_t TextureStreamer::GetResidencyVersion() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return m_ResidencyVersion;
+}
+
+MipStreamingScheduler::Stats TextureStreamer::GetStats() const
+{
+    std::lock_guard<std::mutex> lock( m_Mutex );
+    return m_Scheduler.GetStats();
+}
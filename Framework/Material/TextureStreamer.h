@@ -0,0 +1,92 @@
+#pragma once
+
+// Streamed textures: a large texture loaded with its full mip chain (processed, or a DDS file) is created with all its
+// mips, but LoadTextureFromFile only uploads its tail (the mips of TailSize texels and less): the material can be drawn
+// at once. The other mips are uploaded by CommandList::StreamTextureMips, within a budget per frame, in the order of
+// MipStreamingScheduler, from the source the texture keeps (the mapped DDS file, or the decoded image).
+// --
+// Views: the default SRV of a streamed texture (Texture::GetShaderResourceView) is clamped to its resident mip with
+// ResourceMinLODClamp, the mips not uploaded yet are never sampled. The views created from a desc aren't clamped.
+// --
+// Lifetime: an entry is kept by its textures (Texture::SetStreamedTexture), and by the streamer while the texture
+// cache holds its resource (a later load of the file gets the entry with the resource). Schedule drops the others.
+// --
+// Only the 2D textures with a single array slice and all their mips in the file are streamed. Disabled by default.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include "MipStreamingScheduler.h"
+#include "TextureCache.h"
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class Texture;
+
+struct StreamedTexture
+{
+    TextureCache::Key                           CacheKey;
+    Microsoft::WRL::ComPtr<ID3D12Resource>      Resource;
+    std::shared_ptr<const void>                 Source;             // Keeps the data of Subresources.
+    std::vector<D3D12_SUBRESOURCE_DATA>         Subresources;       // Every mip.
+    MipStreamingScheduler::TextureId            Id = MipStreamingScheduler::InvalidId;
+    std::atomic<uint32_t>                       ResidentMip{ 0 };   // The most detailed mip uploaded.
+};
+
+class DX12_FW_API TextureStreamer
+{
+public:
+    static constexpr uint32_t TailSize = 64;
+    static constexpr uint64_t DefaultBudget = _4MB;     // Per frame.
+
+    using Handle = std::shared_ptr<StreamedTexture>;
+
+    // The mips [FirstMip, FirstMip + NumMips) of a texture.
+    struct Upload
+    {
+        Handle      Texture;
+        uint32_t    FirstMip;
+        uint32_t    NumMips;
+    };
+
+    // @param numSubresources - The subresources of the source.
+    static bool IsStreamable( const D3D12_RESOURCE_DESC& resourceDesc, size_t numSubresources );
+    // The most detailed mip of the tail.
+    static uint32_t GetTailMip( const D3D12_RESOURCE_DESC& resourceDesc );
+
+    // The loads that follow are streamed (or not).
+    void SetEnabled( bool enabled );
+    bool IsEnabled() const;
+
+    // A texture whose mips [residentMip, end) are uploaded. Replaces the entry of a previous load of the key.
+    Handle Add( const TextureCache::Key& key, Microsoft::WRL::ComPtr<ID3D12Resource> resource, std::shared_ptr<const void> source,
+                std::vector<D3D12_SUBRESOURCE_DATA> subresources, uint32_t residentMip );
+    // Null if the texture of the key isn't streamed.
+    Handle Find( const TextureCache::Key& key ) const;
+
+    // The screen size of the texture this frame, in pixels (see MipStreamingScheduler). Ignored if not streamed.
+    void Request( const Texture& texture, float screenSize );
+
+    // The uploads of the frame within the budget, the mips of a texture in one. The caller uploads them and then sets
+    // their ResidentMip (CommandList::StreamTextureMips). Drops the entries the cache evicted.
+    std::vector<Upload> Schedule( uint64_t budgetInBytes, const TextureCache& textureCache );
+
+    // Changes with the resident mips: the views copied out of the textures (descriptor tables) are stale.
+    uint64_t GetResidencyVersion() const;
+
+    MipStreamingScheduler::Stats GetStats() const;
+
+private:
+    std::unordered_map<TextureCache::Key, Handle, TextureCache::KeyHash>    m_Textures;
+    MipStreamingScheduler                                                   m_Scheduler;
+    bool                                                                    m_Enabled = false;
+    uint64_t                                                                m_ResidencyVersion = 0;
+    mutable std::mutex                                                      m_Mutex;
+};
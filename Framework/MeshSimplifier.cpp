@@ -0,0 +1,442 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace DirectX;
+
+namespace
+{
+    // Collapses that turn a remaining triangle by more than ~75 degrees are rejected (it would fold over).
+    const double MinNormalCosine = 0.25;
+    // Border quadrics are heavier than the triangle ones: the silhouette of open meshes (eg. the cloths) is kept.
+    const double BorderWeight = 10.0;
+
+    struct Vector
+    {
+        double x, y, z;
+    };
+
+    Vector ToVector( const XMFLOAT3& p ) { return { p.x, p.y, p.z }; }
+    Vector Subtract( const Vector& a, const Vector& b ) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Vector Cross( const Vector& a, const Vector& b ) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    double Dot( const Vector& a, const Vector& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    double Length( const Vector& a ) { return std::sqrt( Dot( a, a ) ); }
+
+    // Weighted sum of squared distances to planes (a, b, c, d): the upper half of the symmetric 4x4 matrix.
+    struct Quadric
+    {
+        double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+        double b2 = 0.0, bc = 0.0, bd = 0.0;
+        double c2 = 0.0, cd = 0.0;
+        double d2 = 0.0;
+        double Weight = 0.0;
+
+        void AddPlane( const Vector& n, double d, double weight )
+        {
+            a2 += n.x * n.x * weight; ab += n.x * n.y * weight; ac += n.x * n.z * weight; ad += n.x * d * weight;
+            b2 += n.y * n.y * weight; bc += n.y * n.z * weight; bd += n.y * d * weight;
+            c2 += n.z * n.z * weight; cd += n.z * d * weight;
+            d2 += d * d * weight;
+            Weight += weight;
+        }
+
+        void Add( const Quadric& q )
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            Weight += q.Weight;
+        }
+
+        // Weighted mean of the squared distances of p to the planes.
+        double Evaluate( const Vector& p ) const
+        {
+            double error = a2 * p.x * p.x + 2.0 * ab * p.x * p.y + 2.0 * ac * p.x * p.z + 2.0 * ad * p.x +
+                           b2 * p.y * p.y + 2.0 * bc * p.y * p.z + 2.0 * bd * p.y +
+                           c2 * p.z * p.z + 2.0 * cd * p.z +
+                           d2;
+            return Weight > 0.0 ? std::max( error, 0.0 ) / Weight : 0.0;
+        }
+    };
+
+    enum class VertexKind : uint8_t
+    {
+        Manifold,   // Moves anywhere along its edges.
+        Border,     // On an open border: only moves along the border.
+        Locked,     // On an attribute seam: never moves.
+    };
+
+    struct Collapse
+    {
+        uint32_t    From;
+        uint32_t    To;
+        double      Cost;
+    };
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify( const XMFLOAT3* positions, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                                                uint32_t targetIndexCount, float maxError, float* resultError )
+{
+    std::vector<uint32_t> result( indices.begin(), indices.begin() + indices.size() / 3 * 3 );
+    if ( resultError )
+    {
+        *resultError = 0.0f;
+    }
+    if ( result.size() <= targetIndexCount )
+        return result;
+
+    std::vector<Vector> points( numVertices );
+    for ( uint32_t v = 0; v < numVertices; ++v )
+    {
+        points[v] = ToVector( positions[v] );
+    }
+
+    // 1. Vertices at the same position (attribute seams) share their id in the topology, and are locked.
+    std::vector<uint32_t> order( numVertices );
+    std::iota( order.begin(), order.end(), 0u );
+    auto byPosition = [positions]( uint32_t a, uint32_t b )
+    {
+        const XMFLOAT3& pa = positions[a];
+        const XMFLOAT3& pb = positions[b];
+        if ( pa.x != pb.x ) return pa.x < pb.x;
+        if ( pa.y != pb.y ) return pa.y < pb.y;
+        if ( pa.z != pb.z ) return pa.z < pb.z;
+        return a < b;
+    };
+    std::sort( order.begin(), order.end(), byPosition );
+
+    std::vector<uint32_t> positionIds( numVertices );
+    std::vector<VertexKind> kinds( numVertices, VertexKind::Manifold );
+    for ( size_t begin = 0; begin < order.size(); )
+    {
+        size_t end = begin + 1;
+        while ( end < order.size() &&
+                positions[order[begin]].x == positions[order[end]].x &&
+                positions[order[begin]].y == positions[order[end]].y &&
+                positions[order[begin]].z == positions[order[end]].z )
+        {
+            ++end;
+        }
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            positionIds[order[i]] = order[begin];
+            if ( end - begin > 1 )
+            {
+                kinds[order[i]] = VertexKind::Locked;
+            }
+        }
+        begin = end;
+    }
+
+    // Triangles of each position (CSR), rebuilt every pass: an edge is on a border when no triangle of its end has
+    // it the other way around.
+    std::vector<uint32_t> adjacencyOffsets( numVertices + 1 );
+    std::vector<uint32_t> adjacency;
+    auto buildAdjacency = [&]()
+    {
+        std::fill( adjacencyOffsets.begin(), adjacencyOffsets.end(), 0u );
+        for ( uint32_t index : result )
+        {
+            ++adjacencyOffsets[positionIds[index] + 1];
+        }
+        for ( uint32_t v = 0; v < numVertices; ++v )
+        {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+
+        adjacency.resize( result.size() );
+        std::vector<uint32_t> cursors( adjacencyOffsets.begin(), adjacencyOffsets.end() - 1 );
+        for ( size_t i = 0; i < result.size(); ++i )
+        {
+            adjacency[cursors[positionIds[result[i]]]++] = static_cast<uint32_t>( i / 3 );
+        }
+    };
+    auto hasEdge = [&]( uint32_t a, uint32_t b )
+    {
+        uint32_t positionA = positionIds[a];
+        uint32_t positionB = positionIds[b];
+        for ( uint32_t t = adjacencyOffsets[positionA]; t < adjacencyOffsets[positionA + 1]; ++t )
+        {
+            const uint32_t* triangle = &result[adjacency[t] * 3];
+            for ( uint32_t e = 0; e < 3; ++e )
+            {
+                if ( positionIds[triangle[e]] == positionA && positionIds[triangle[( e + 1 ) % 3]] == positionB )
+                    return true;
+            }
+        }
+        return false;
+    };
+    auto isBorderEdge = [&hasEdge]( uint32_t a, uint32_t b )
+    {
+        return !hasEdge( b, a ) || !hasEdge( a, b );
+    };
+
+    // 2. Quadrics of the triangle planes (area weighted) and of the border edges.
+    buildAdjacency();
+
+    std::vector<Quadric> quadrics( numVertices );
+    for ( size_t i = 0; i < result.size(); i += 3 )
+    {
+        const uint32_t triangle[3] = { result[i], result[i + 1], result[i + 2] };
+
+        Vector normal = Cross( Subtract( points[triangle[1]], points[triangle[0]] ), Subtract( points[triangle[2]], points[triangle[0]] ) );
+        double length = Length( normal );
+        if ( length == 0.0 )
+            continue;
+
+        normal = { normal.x / length, normal.y / length, normal.z / length };
+        double d = -Dot( normal, points[triangle[0]] );
+        for ( uint32_t v : triangle )
+        {
+            quadrics[v].AddPlane( normal, d, length * 0.5 );
+        }
+
+        for ( uint32_t e = 0; e < 3; ++e )
+        {
+            uint32_t a = triangle[e];
+            uint32_t b = triangle[( e + 1 ) % 3];
+            if ( hasEdge( b, a ) )
+                continue;
+
+            if ( kinds[a] == VertexKind::Manifold ) kinds[a] = VertexKind::Border;
+            if ( kinds[b] == VertexKind::Manifold ) kinds[b] = VertexKind::Border;
+
+            // Plane through the edge, perpendicular to the triangle.
+            Vector edge = Subtract( points[b], points[a] );
+            Vector borderNormal = Cross( edge, normal );
+            double borderLength = Length( borderNormal );
+            if ( borderLength == 0.0 )
+                continue;
+
+            borderNormal = { borderNormal.x / borderLength, borderNormal.y / borderLength, borderNormal.z / borderLength };
+            double borderD = -Dot( borderNormal, points[a] );
+            quadrics[a].AddPlane( borderNormal, borderD, Dot( edge, edge ) * BorderWeight );
+            quadrics[b].AddPlane( borderNormal, borderD, Dot( edge, edge ) * BorderWeight );
+        }
+    }
+
+    // 3. Collapse passes.
+    const double maxCost = static_cast<double>( maxError ) * maxError;
+    double worstCost = 0.0;
+
+    const uint32_t InvalidVertex = UINT32_MAX;
+    std::vector<Collapse> bestCollapses( numVertices );
+    std::vector<Collapse> candidates;
+
+    auto isCheaper = []( const Collapse& a, const Collapse& b )
+    {
+        if ( a.Cost != b.Cost ) return a.Cost < b.Cost;
+        if ( a.From != b.From ) return a.From < b.From;
+        return a.To < b.To;
+    };
+
+    std::vector<uint8_t> isTouched( numVertices );
+    std::vector<uint32_t> collapseTo( numVertices );
+
+    auto isAllowed = [&kinds, &isBorderEdge]( uint32_t from, uint32_t to )
+    {
+        switch ( kinds[from] )
+        {
+        case VertexKind::Manifold:
+            return true;
+        case VertexKind::Border:
+            return isBorderEdge( from, to );
+        default:
+            return false;
+        }
+    };
+
+    // Moving `from` to `to` mustn't flip the triangles of `from` that remain (a vertex that moves isn't on a seam: its
+    // position id is its index).
+    auto flipsTriangles = [&]( uint32_t from, uint32_t to )
+    {
+        for ( uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a )
+        {
+            const uint32_t* triangle = &result[adjacency[a] * 3];
+            if ( triangle[0] == to || triangle[1] == to || triangle[2] == to )
+                continue;
+
+            Vector p[3], q[3];
+            for ( uint32_t v = 0; v < 3; ++v )
+            {
+                p[v] = points[triangle[v]];
+                q[v] = triangle[v] == from ? points[to] : p[v];
+            }
+
+            Vector before = Cross( Subtract( p[1], p[0] ), Subtract( p[2], p[0] ) );
+            Vector after = Cross( Subtract( q[1], q[0] ), Subtract( q[2], q[0] ) );
+            if ( Dot( before, after ) <= MinNormalCosine * Length( before ) * Length( after ) )
+                return true;
+        }
+        return false;
+    };
+
+    for ( bool firstPass = true; result.size() > targetIndexCount; firstPass = false )
+    {
+        const size_t numTriangles = result.size() / 3;
+        // The collapses of the previous pass changed the triangles.
+        if ( !firstPass )
+        {
+            buildAdjacency();
+        }
+
+        // Candidates: the cheapest collapse of each vertex, over both ways of every edge (an inner edge is seen once
+        // per side). A vertex moves at most once per pass anyway.
+        std::fill( bestCollapses.begin(), bestCollapses.end(), Collapse{ InvalidVertex, InvalidVertex, 0.0 } );
+        for ( size_t i = 0; i < result.size(); i += 3 )
+        {
+            for ( uint32_t e = 0; e < 3; ++e )
+            {
+                uint32_t a = result[i + e];
+                uint32_t b = result[i + ( e + 1 ) % 3];
+                bool isBorder = isBorderEdge( a, b );
+
+                for ( uint32_t direction = 0; direction < ( isBorder ? 2u : 1u ); ++direction )
+                {
+                    uint32_t from = direction == 0 ? a : b;
+                    uint32_t to = direction == 0 ? b : a;
+                    if ( !isAllowed( from, to ) )
+                        continue;
+
+                    Quadric quadric = quadrics[from];
+                    quadric.Add( quadrics[to] );
+                    Collapse collapse = { from, to, quadric.Evaluate( points[to] ) };
+
+                    Collapse& best = bestCollapses[from];
+                    if ( best.From == InvalidVertex || isCheaper( collapse, best ) )
+                    {
+                        best = collapse;
+                    }
+                }
+            }
+        }
+
+        candidates.clear();
+        for ( const Collapse& collapse : bestCollapses )
+        {
+            if ( collapse.From != InvalidVertex && collapse.Cost <= maxCost )
+            {
+                candidates.push_back( collapse );
+            }
+        }
+        std::sort( candidates.begin(), candidates.end(), isCheaper );
+        if ( candidates.empty() )
+            break;
+
+        // The cheapest collapses with disjoint neighbourhoods, until enough triangles are gone.
+        std::fill( isTouched.begin(), isTouched.end(), uint8_t( 0 ) );
+        std::iota( collapseTo.begin(), collapseTo.end(), 0u );
+
+        const size_t trianglesToRemove = numTriangles - targetIndexCount / 3;
+        size_t numRemoved = 0;
+        size_t numCollapses = 0;
+
+        // Most candidates are skipped (their neighbourhood is touched): instead of going further down the list, the
+        // expensive collapses wait for the next pass, where the skipped cheap ones are candidates again.
+        size_t collapseGoal = std::min( candidates.size() - 1, trianglesToRemove / 2 );
+        double passMaxCost = candidates[collapseGoal].Cost * 1.5;
+
+        for ( const Collapse& collapse : candidates )
+        {
+            if ( collapse.Cost > passMaxCost )
+                break;
+            if ( isTouched[collapse.From] || isTouched[collapse.To] )
+                continue;
+            if ( flipsTriangles( collapse.From, collapse.To ) )
+                continue;
+
+            collapseTo[collapse.From] = collapse.To;
+            worstCost = std::max( worstCost, collapse.Cost );
+            ++numCollapses;
+
+            for ( uint32_t a = adjacencyOffsets[collapse.From]; a < adjacencyOffsets[collapse.From + 1]; ++a )
+            {
+                const uint32_t* triangle = &result[adjacency[a] * 3];
+                isTouched[triangle[0]] = isTouched[triangle[1]] = isTouched[triangle[2]] = 1;
+                if ( triangle[0] == collapse.To || triangle[1] == collapse.To || triangle[2] == collapse.To )
+                {
+                    ++numRemoved;
+                }
+            }
+
+            if ( numRemoved >= trianglesToRemove )
+                break;
+        }
+
+        if ( numCollapses == 0 )
+            break;
+
+        for ( uint32_t v = 0; v < numVertices; ++v )
+        {
+            if ( collapseTo[v] != v )
+            {
+                quadrics[collapseTo[v]].Add( quadrics[v] );
+            }
+        }
+
+        // Remap the triangles, the collapsed ones are degenerate.
+        size_t numIndices = 0;
+        for ( size_t i = 0; i < result.size(); i += 3 )
+        {
+            uint32_t a = collapseTo[result[i]];
+            uint32_t b = collapseTo[result[i + 1]];
+            uint32_t c = collapseTo[result[i + 2]];
+            if ( a == b || b == c || a == c )
+                continue;
+
+            result[numIndices++] = a;
+            result[numIndices++] = b;
+            result[numIndices++] = c;
+        }
+        result.resize( numIndices );
+    }
+
+    if ( resultError )
+    {
+        *resultError = static_cast<float>( std::sqrt( worstCost ) );
+    }
+    return result;
+}
+
+std::vector<MeshSimplifier::Lod> MeshSimplifier::BuildLods( const XMFLOAT3* positions, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                                                            uint32_t maxLods, float reduction, float maxRelativeError )
+{
+    std::vector<Lod> lods( 1 );
+    lods[0].Indices = indices;
+    if ( indices.empty() )
+        return lods;
+
+    // Size of the bounds of the referenced vertices.
+    XMFLOAT3 minimum = positions[indices[0]];
+    XMFLOAT3 maximum = minimum;
+    for ( uint32_t index : indices )
+    {
+        const XMFLOAT3& p = positions[index];
+        minimum = XMFLOAT3( std::min( minimum.x, p.x ), std::min( minimum.y, p.y ), std::min( minimum.z, p.z ) );
+        maximum = XMFLOAT3( std::max( maximum.x, p.x ), std::max( maximum.y, p.y ), std::max( maximum.z, p.z ) );
+    }
+    float size = static_cast<float>( Length( Subtract( ToVector( maximum ), ToVector( minimum ) ) ) );
+
+    while ( lods.size() < maxLods )
+    {
+        const Lod& previous = lods.back();
+        uint32_t targetIndexCount = static_cast<uint32_t>( previous.Indices.size() / 3 * reduction ) * 3;
+
+        Lod lod;
+        float error = 0.0f;
+        lod.Indices = Simplify( positions, numVertices, previous.Indices, targetIndexCount, maxRelativeError * size, &error );
+        // Simplified from the previous LOD: the errors add up.
+        lod.Error = previous.Error + error;
+
+        if ( lod.Indices.empty() || lod.Indices.size() * 10 > previous.Indices.size() * 9 )
+            break;
+
+        lods.push_back( std::move( lod ) );
+    }
+
+    return lods;
+}
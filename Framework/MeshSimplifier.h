@@ -0,0 +1,41 @@
+#pragma once
+
+// Quadric error metric (QEM) simplification of indexed triangle lists, for the LODs of a mesh.
+// --
+// Edges are collapsed onto one of their vertices: a LOD only has new indices, it is drawn with the vertex buffer of
+// the mesh. Each vertex accumulates the plane quadrics of its triangles (area weighted) and the cost of moving u to v
+// is the error of the summed quadrics at v, in squared distance.
+// The collapses are done in passes: the candidate edges are sorted by cost and the cheapest ones are applied as long
+// as their neighbourhoods don't overlap, skipping those that would flip a triangle.
+// Open borders only collapse along themselves and attribute seams (vertices with the same position) are locked, so
+// a LOD has no cracks.
+// Deterministic (the ties are broken by vertex index), no shared state: the meshes can be simplified in parallel.
+// No device is used, the simplifier can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API MeshSimplifier
+{
+public:
+    struct Lod
+    {
+        std::vector<uint32_t>   Indices;
+        float                   Error = 0.0f;   // Distance, in the units of the positions.
+    };
+
+    // Collapse edges until there are at most targetIndexCount indices, or the next collapse would exceed maxError.
+    // @param resultError - The largest error of the applied collapses (distance), can be nullptr.
+    static std::vector<uint32_t> Simplify( const DirectX::XMFLOAT3* positions, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                                           uint32_t targetIndexCount, float maxError, float* resultError = nullptr );
+
+    // The first LOD is the input, each next one targets `reduction` of the triangles of the previous one (and is
+    // simplified from it). The chain ends early when a LOD can't remove a tenth of the triangles of the previous one.
+    // @param maxRelativeError - The error limit of each LOD, relative to the size of the mesh bounds.
+    static std::vector<Lod> BuildLods( const DirectX::XMFLOAT3* positions, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                                       uint32_t maxLods, float reduction = 0.5f, float maxRelativeError = 0.02f );
+};
@@ -0,0 +1,326 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+using namespace DirectX;
+
+namespace
+{
+    // The normals of a meshlet must stay within ~84 degrees of the cone axis, or the cone can't cull anything useful.
+    const float MinConeCosine = 0.1f;
+
+    // The free triangles of the input order that are candidates when a meshlet has no free neighbour left.
+    const uint32_t SeedWindow = 64;
+
+    const uint32_t InvalidTriangle = UINT32_MAX;
+    const uint16_t NotInMeshlet = UINT16_MAX;
+
+    XMFLOAT3 Subtract( const XMFLOAT3& a, const XMFLOAT3& b ) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    XMFLOAT3 Cross( const XMFLOAT3& a, const XMFLOAT3& b ) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    float Dot( const XMFLOAT3& a, const XMFLOAT3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    // The meshlet being grown.
+    struct OpenMeshlet
+    {
+        std::vector<uint32_t>   Vertices;
+        std::vector<uint32_t>   Triangles;
+        double                  CenterSum[3] = { 0.0, 0.0, 0.0 };   // Of the triangle centroids.
+
+        XMFLOAT3 GetCenter() const
+        {
+            double scale = 1.0 / static_cast<double>( Triangles.size() );
+            return XMFLOAT3( static_cast<float>( CenterSum[0] * scale ), static_cast<float>( CenterSum[1] * scale ),
+                             static_cast<float>( CenterSum[2] * scale ) );
+        }
+    };
+}
+
+MeshletBuilder::MeshletMesh MeshletBuilder::Build( const XMFLOAT3* positions, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                                                   uint32_t maxVertices, uint32_t maxTriangles )
+{
+    if ( maxVertices < 3 || maxVertices > 256 || maxTriangles < 1 || maxTriangles > 512 )
+    {
+        throw std::exception( "MeshletBuilder: the meshlet limits are out of range." );
+    }
+
+    const uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+
+    MeshletMesh result;
+    result.Indices.reserve( numTriangles * 3 );
+    result.Primitives.reserve( numTriangles );
+    if ( numTriangles == 0 )
+        return result;
+
+    // Vertex -> triangles (CSR), and the number of triangles of each vertex that are not in a meshlet yet.
+    std::vector<uint32_t> triangleOffsets( numVertices + 1, 0 );
+    for ( uint32_t index : indices )
+    {
+        ++triangleOffsets[index + 1];
+    }
+    for ( uint32_t v = 0; v < numVertices; ++v )
+    {
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    }
+
+    std::vector<uint32_t> liveTriangles( numVertices );
+    for ( uint32_t v = 0; v < numVertices; ++v )
+    {
+        liveTriangles[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+    }
+
+    std::vector<uint32_t> vertexTriangles( indices.size() );
+    {
+        std::vector<uint32_t> fill( triangleOffsets.begin(), triangleOffsets.end() - 1 );
+        for ( uint32_t t = 0; t < numTriangles; ++t )
+        {
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                vertexTriangles[fill[indices[t * 3 + corner]]++] = t;
+            }
+        }
+    }
+
+    std::vector<XMFLOAT3> centroids( numTriangles );
+    for ( uint32_t t = 0; t < numTriangles; ++t )
+    {
+        const XMFLOAT3& p0 = positions[indices[t * 3 + 0]];
+        const XMFLOAT3& p1 = positions[indices[t * 3 + 1]];
+        const XMFLOAT3& p2 = positions[indices[t * 3 + 2]];
+        centroids[t] = XMFLOAT3( ( p0.x + p1.x + p2.x ) / 3.0f, ( p0.y + p1.y + p2.y ) / 3.0f, ( p0.z + p1.z + p2.z ) / 3.0f );
+    }
+
+    std::vector<bool> isEmitted( numTriangles, false );
+    std::vector<uint16_t> localIndex( numVertices, NotInMeshlet );
+
+    // The distinct vertices of the triangle that the meshlet doesn't have yet.
+    auto countNewVertices = [&indices, &localIndex]( uint32_t t )
+    {
+        uint32_t a = indices[t * 3 + 0];
+        uint32_t b = indices[t * 3 + 1];
+        uint32_t c = indices[t * 3 + 2];
+
+        uint32_t count = localIndex[a] == NotInMeshlet ? 1 : 0;
+        count += ( localIndex[b] == NotInMeshlet && b != a ) ? 1 : 0;
+        count += ( localIndex[c] == NotInMeshlet && c != a && c != b ) ? 1 : 0;
+        return count;
+    };
+
+    OpenMeshlet meshlet;
+
+    auto flush = [&]()
+    {
+        OpenMeshlet& m = meshlet;
+
+        // The triangles in input order, so a meshlet keeps the vertex cache order of an optimized index list.
+        std::sort( m.Triangles.begin(), m.Triangles.end() );
+
+        Meshlet output;
+        output.VertexOffset = static_cast<uint32_t>( result.Vertices.size() );
+        output.VertexCount = static_cast<uint32_t>( m.Vertices.size() );
+        output.TriangleOffset = static_cast<uint32_t>( result.Primitives.size() );
+        output.TriangleCount = static_cast<uint32_t>( m.Triangles.size() );
+
+        result.Vertices.insert( result.Vertices.end(), m.Vertices.begin(), m.Vertices.end() );
+        for ( uint32_t t : m.Triangles )
+        {
+            uint32_t a = indices[t * 3 + 0];
+            uint32_t b = indices[t * 3 + 1];
+            uint32_t c = indices[t * 3 + 2];
+
+            result.Indices.push_back( a );
+            result.Indices.push_back( b );
+            result.Indices.push_back( c );
+            result.Primitives.push_back( static_cast<uint32_t>( localIndex[a] ) | ( static_cast<uint32_t>( localIndex[b] ) << 8 ) |
+                                         ( static_cast<uint32_t>( localIndex[c] ) << 16 ) );
+        }
+
+        result.Meshlets.push_back( output );
+        result.MeshletBounds.push_back( ComputeBounds( positions, &result.Indices[output.TriangleOffset * 3], output.TriangleCount ) );
+
+        for ( uint32_t v : m.Vertices )
+        {
+            localIndex[v] = NotInMeshlet;
+        }
+        m = OpenMeshlet();
+    };
+
+    uint32_t nextSeed = 0;
+    for ( uint32_t numEmitted = 0; numEmitted < numTriangles; ++numEmitted )
+    {
+        // The free triangle around the meshlet with the fewest new vertices, then the closest to its center.
+        uint32_t best = InvalidTriangle;
+        uint32_t bestNewVertices = 0;
+        float bestDistance = 0.0f;
+
+        if ( !meshlet.Triangles.empty() )
+        {
+            XMFLOAT3 center = meshlet.GetCenter();
+
+            for ( uint32_t v : meshlet.Vertices )
+            {
+                if ( liveTriangles[v] == 0 )
+                    continue;
+
+                for ( uint32_t i = triangleOffsets[v]; i < triangleOffsets[v + 1]; ++i )
+                {
+                    uint32_t t = vertexTriangles[i];
+                    if ( isEmitted[t] )
+                        continue;
+
+                    uint32_t newVertices = countNewVertices( t );
+                    if ( meshlet.Vertices.size() + newVertices > maxVertices )
+                        continue;
+
+                    XMFLOAT3 offset = Subtract( centroids[t], center );
+                    float distance = Dot( offset, offset );
+
+                    if ( best == InvalidTriangle || newVertices < bestNewVertices ||
+                         ( newVertices == bestNewVertices && ( distance < bestDistance || ( distance == bestDistance && t < best ) ) ) )
+                    {
+                        best = t;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+        }
+
+        // No neighbour fits (eg. the meshlet covers a whole small piece): the closest of the next free triangles of the
+        // input order, which is usually coherent. A new meshlet if none of them fits.
+        if ( best == InvalidTriangle )
+        {
+            while ( isEmitted[nextSeed] )
+            {
+                ++nextSeed;
+            }
+            best = nextSeed;
+
+            if ( !meshlet.Triangles.empty() )
+            {
+                XMFLOAT3 center = meshlet.GetCenter();
+                bool fits = false;
+
+                uint32_t numCandidates = 0;
+                for ( uint32_t t = nextSeed; t < numTriangles && numCandidates < SeedWindow; ++t )
+                {
+                    if ( isEmitted[t] )
+                        continue;
+                    ++numCandidates;
+
+                    if ( meshlet.Vertices.size() + countNewVertices( t ) > maxVertices )
+                        continue;
+
+                    XMFLOAT3 offset = Subtract( centroids[t], center );
+                    float distance = Dot( offset, offset );
+                    if ( !fits || distance < bestDistance )
+                    {
+                        best = t;
+                        bestDistance = distance;
+                        fits = true;
+                    }
+                }
+
+                if ( !fits )
+                {
+                    flush();
+                }
+            }
+        }
+
+        isEmitted[best] = true;
+        for ( uint32_t corner = 0; corner < 3; ++corner )
+        {
+            uint32_t v = indices[best * 3 + corner];
+            if ( localIndex[v] == NotInMeshlet )
+            {
+                localIndex[v] = static_cast<uint16_t>( meshlet.Vertices.size() );
+                meshlet.Vertices.push_back( v );
+            }
+            --liveTriangles[v];
+        }
+
+        meshlet.Triangles.push_back( best );
+        meshlet.CenterSum[0] += centroids[best].x;
+        meshlet.CenterSum[1] += centroids[best].y;
+        meshlet.CenterSum[2] += centroids[best].z;
+
+        if ( meshlet.Triangles.size() == maxTriangles )
+        {
+            flush();
+        }
+    }
+
+    if ( !meshlet.Triangles.empty() )
+    {
+        flush();
+    }
+
+    return result;
+}
+
+MeshletBuilder::Bounds MeshletBuilder::ComputeBounds( const XMFLOAT3* positions, const uint32_t* indices, uint32_t numTriangles )
+{
+    Bounds bounds = {};
+    bounds.ConeCutoff = 1.0f;
+    if ( numTriangles == 0 )
+        return bounds;
+
+    // Sphere around the center of the box.
+    XMFLOAT3 minimum = positions[indices[0]];
+    XMFLOAT3 maximum = minimum;
+    for ( uint32_t i = 1; i < numTriangles * 3; ++i )
+    {
+        const XMFLOAT3& p = positions[indices[i]];
+        minimum = XMFLOAT3( std::min( minimum.x, p.x ), std::min( minimum.y, p.y ), std::min( minimum.z, p.z ) );
+        maximum = XMFLOAT3( std::max( maximum.x, p.x ), std::max( maximum.y, p.y ), std::max( maximum.z, p.z ) );
+    }
+    bounds.Center = XMFLOAT3( ( minimum.x + maximum.x ) * 0.5f, ( minimum.y + maximum.y ) * 0.5f, ( minimum.z + maximum.z ) * 0.5f );
+
+    float radiusSquared = 0.0f;
+    for ( uint32_t i = 0; i < numTriangles * 3; ++i )
+    {
+        XMFLOAT3 offset = Subtract( positions[indices[i]], bounds.Center );
+        radiusSquared = std::max( radiusSquared, Dot( offset, offset ) );
+    }
+    bounds.Radius = std::sqrt( radiusSquared );
+
+    // Cone around the mean of the unit normals (clockwise front faces: cross(p1 - p0, p2 - p0) points out).
+    std::vector<XMFLOAT3> normals;
+    normals.reserve( numTriangles );
+    XMFLOAT3 axis( 0.0f, 0.0f, 0.0f );
+    for ( uint32_t t = 0; t < numTriangles; ++t )
+    {
+        const XMFLOAT3& p0 = positions[indices[t * 3 + 0]];
+        XMFLOAT3 normal = Cross( Subtract( positions[indices[t * 3 + 1]], p0 ), Subtract( positions[indices[t * 3 + 2]], p0 ) );
+
+        float length = std::sqrt( Dot( normal, normal ) );
+        if ( length == 0.0f )
+            continue;   // Degenerate, never rasterized.
+
+        normal = XMFLOAT3( normal.x / length, normal.y / length, normal.z / length );
+        normals.push_back( normal );
+        axis = XMFLOAT3( axis.x + normal.x, axis.y + normal.y, axis.z + normal.z );
+    }
+
+    float axisLength = std::sqrt( Dot( axis, axis ) );
+    if ( normals.empty() || axisLength == 0.0f )
+        return bounds;
+
+    axis = XMFLOAT3( axis.x / axisLength, axis.y / axisLength, axis.z / axisLength );
+
+    float minCosine = 1.0f;
+    for ( const XMFLOAT3& normal : normals )
+    {
+        minCosine = std::min( minCosine, Dot( axis, normal ) );
+    }
+    if ( minCosine <= MinConeCosine )
+        return bounds;
+
+    // The view directions within 90 - angle of the axis see all the triangles from the back: cutoff = sin(angle).
+    bounds.ConeAxis = axis;
+    bounds.ConeCutoff = std::sqrt( 1.0f - minCosine * minCosine );
+
+    return bounds;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Splits an indexed triangle list into meshlets (clusters) of at most 64 vertices and 124 triangles, with their
+// bounding sphere and normal cone, for cluster culling.
+// --
+// A meshlet is grown from a seed triangle: the next triangle is the one of its vertices' triangles that adds the
+// fewest new vertices (then the closest to its center), so the meshlets are compact and share few vertices. When no
+// neighbour fits, the meshlet takes the next free triangle of the input order, and starts over from there when full.
+// --
+// The output serves both paths:
+//   - Indexed draws: the triangles are reordered so each meshlet is a contiguous range of Indices. Its draw is
+//     TriangleCount * 3 indices from TriangleOffset * 3, with the vertex buffer of the mesh. Within a meshlet the
+//     triangles keep their input order (eg. from VertexCacheOptimizer).
+//   - Mesh shaders: Vertices has the unique vertices of each meshlet (from VertexOffset), Primitives the triangles in
+//     local vertex indices, 8 bits each (i0 | i1 << 8 | i2 << 16, from TriangleOffset).
+// --
+// Normal cone: a meshlet is backfacing from every point p with
+//   dot(Center - p, ConeAxis) >= ConeCutoff * length(Center - p) + Radius
+// (see CullingMath::IsBackfacing). The front faces are clockwise (the D3D default), meshlets whose normals spread
+// too much get ConeAxis = 0 and ConeCutoff = 1, which is never culled.
+// Deterministic, no shared state: the meshes can be processed in parallel.
+// No device is used, the builder can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API MeshletBuilder
+{
+public:
+    // The limits of the mesh shader path (the output of a mesh shader group).
+    static constexpr uint32_t MaxVertices = 64;
+    static constexpr uint32_t MaxTriangles = 124;
+
+    struct Meshlet
+    {
+        uint32_t    VertexOffset;
+        uint32_t    VertexCount;
+        uint32_t    TriangleOffset;
+        uint32_t    TriangleCount;
+    };
+
+    // Object space, same layout as CullingMath::InstanceCone (32 bytes).
+    struct Bounds
+    {
+        DirectX::XMFLOAT3   Center;
+        float               Radius;
+        DirectX::XMFLOAT3   ConeAxis;
+        float               ConeCutoff;
+    };
+
+    struct MeshletMesh
+    {
+        std::vector<Meshlet>    Meshlets;
+        std::vector<Bounds>     MeshletBounds;  // Per meshlet.
+        std::vector<uint32_t>   Vertices;       // Mesh vertex indices.
+        std::vector<uint32_t>   Primitives;     // Per triangle, packed local vertex indices.
+        std::vector<uint32_t>   Indices;        // The input triangles, in meshlet order.
+
+        uint32_t GetNumMeshlets() const { return static_cast<uint32_t>( Meshlets.size() ); }
+    };
+
+    // Throws if the limits are not in [3, 256] vertices and [1, 512] triangles.
+    static MeshletMesh Build( const DirectX::XMFLOAT3* positions, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                              uint32_t maxVertices = MaxVertices, uint32_t maxTriangles = MaxTriangles );
+
+    // Bounding sphere and normal cone of a triangle list.
+    static Bounds ComputeBounds( const DirectX::XMFLOAT3* positions, const uint32_t* indices, uint32_t numTriangles );
+};
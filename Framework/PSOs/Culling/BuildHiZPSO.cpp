@@ -0,0 +1,51 @@
+#include "BuildHiZPSO.h"
+
+// For compiled Shader bytecode - g_BuildHiZ_CS
+// "_Output/Bin/$(Platform)/$(Configuration)/$(ProjectName)/Shaders/BuildHiZ_CS.h"
+#include <BuildHiZ_CS.h>
+
+#include <Framework/Application.h>
+
+#include <Framework/3RD_Party/D3D/d3dx12.h>
+#include <Framework/3RD_Party/Helpers.h>
+
+
+BuildHiZPSO::BuildHiZPSO()
+{
+    auto& app   = Application::Get();
+    auto device = app.GetDevice();
+
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData = {};
+    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+    {
+        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+    }
+
+    CD3DX12_DESCRIPTOR_RANGE1 srcMip(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+    CD3DX12_DESCRIPTOR_RANGE1 dstMip(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE);
+
+    CD3DX12_ROOT_PARAMETER1 rootParameters[BuildHiZRS::NumRootParameters];
+    rootParameters[BuildHiZRS::BuildHiZCB].InitAsConstants(sizeof(BuildHiZCB) / 4, 0);
+    rootParameters[BuildHiZRS::SrcMip].InitAsDescriptorTable(1, &srcMip);
+    rootParameters[BuildHiZRS::DstMip].InitAsDescriptorTable(1, &dstMip);
+
+    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc(BuildHiZRS::NumRootParameters, rootParameters);
+
+    m_RootSignature.SetRootSignatureDesc(rootSignatureDesc.Desc_1_1, featureData.HighestVersion);
+
+    struct PipelineStateStream
+    {
+        CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+        CD3DX12_PIPELINE_STATE_STREAM_CS CS;
+    } pipelineStateStream;
+
+    pipelineStateStream.pRootSignature = m_RootSignature.GetRootSignature().Get();
+    pipelineStateStream.CS = { g_BuildHiZ_CS, sizeof(g_BuildHiZ_CS) };
+
+    D3D12_PIPELINE_STATE_STREAM_DESC pipelineStateStreamDesc = {
+        sizeof(PipelineStateStream), &pipelineStateStream
+    };
+
+    ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&m_PipelineState)));
+}
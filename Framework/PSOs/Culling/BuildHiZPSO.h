@@ -0,0 +1,51 @@
+#pragma once
+
+// Hi-Z pyramid shader - reduces one mip of the max-depth pyramid used by the GPU occlusion culling
+
+#include <Framework/RootSignature.h>
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+struct BuildHiZCB
+{
+    uint32_t SrcWidth;
+    uint32_t SrcHeight;
+    uint32_t DstWidth;
+    uint32_t DstHeight;
+};
+
+// I don't use scoped enums to avoid the explicit cast that is required to 
+// treat these as root indices into the root signature.
+namespace BuildHiZRS
+{
+    enum
+    {
+        BuildHiZCB,
+        SrcMip,
+        DstMip,
+        NumRootParameters
+    };
+}
+
+class BuildHiZPSO
+{
+public:
+    BuildHiZPSO();
+
+    const RootSignature& GetRootSignature() const
+    {
+        return m_RootSignature;
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState() const
+    {
+        return m_PipelineState;
+    }
+
+private:
+    RootSignature m_RootSignature;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_PipelineState;
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+// Instance culling shader - frustum + Hi-Z occlusion test of the instances, compacts the visible
+// draws into an ExecuteIndirect argument buffer (see GpuCulling)
+
+#include <Framework/CullingMath.h>
+#include <Framework/RootSignature.h>
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+
+// Matches CullConstants in CullInstances_CS.hlsl.
+struct CullInstancesCB
+{
+    CullingMath::View   FrustumView;
+    CullingMath::View   HiZView;
+    DirectX::XMFLOAT2   DepthTexelSize;
+    uint32_t            DepthWidth;
+    uint32_t            DepthHeight;
+    uint32_t            HiZWidth;
+    uint32_t            HiZHeight;
+    uint32_t            HiZNumMips;
+    uint32_t            UseHiZ;
+    uint32_t            NumInstances;
+    uint32_t            Phase;
+    uint32_t            UseCones;
+    uint32_t            _Padding0;
+    DirectX::XMFLOAT3   CameraPosition;
+    uint32_t            _Padding1;
+};
+
+// I don't use scoped enums to avoid the explicit cast that is required to 
+// treat these as root indices into the root signature.
+namespace CullInstancesRS
+{
+    enum
+    {
+        CullCB,
+        Inputs,     // Bounds (t0), Commands (t1), HiZ (t2), Cones (t3)
+        Outputs,    // InstanceFlags (u0), OutCommands (u1)
+        NumRootParameters
+    };
+}
+
+class CullInstancesPSO
+{
+public:
+    CullInstancesPSO();
+
+    const RootSignature& GetRootSignature() const
+    {
+        return m_RootSignature;
+    }
+
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> GetPipelineState() const
+    {
+        return m_PipelineState;
+    }
+
+private:
+    RootSignature m_RootSignature;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_PipelineState;
+};
@@ -0,0 +1,60 @@
+#include "ParallelCommandListRecorder.h"
+
+#include <Framework/Application.h>
+#include <Framework/CommandList.h>
+#include <Framework/CommandQueue.h>
+
+#include <algorithm>
+#include <chrono>
+
+ParallelCommandListRecorder::ParallelCommandListRecorder(uint32_t numThreads, size_t minDrawsPerCommandList)
+    : m_NumThreads(1)
+    , m_MinDrawsPerCommandList(std::max<size_t>(1, minDrawsPerCommandList))
+{
+    SetNumThreads(numThreads);
+}
+
+void ParallelCommandListRecorder::SetNumThreads(uint32_t numThreads)
+{
+    m_NumThreads = std::clamp(numThreads, 1u, GetMaxNumThreads());
+}
+
+uint32_t ParallelCommandListRecorder::GetMaxNumThreads()
+{
+    return Application::Get().GetThreadPool().GetNumThreads() + 1;
+}
+
+std::vector<std::shared_ptr<CommandList>> ParallelCommandListRecorder::Record(CommandQueue& commandQueue, size_t numDraws, const SetupFunc& setup, const RecordFunc& record)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    size_t maxCommandLists = (numDraws + m_MinDrawsPerCommandList - 1) / m_MinDrawsPerCommandList;
+    size_t numCommandLists = std::max<size_t>(1, std::min<size_t>(m_NumThreads, maxCommandLists));
+
+    std::vector<std::shared_ptr<CommandList>> commandLists(numCommandLists);
+    for (auto& commandList : commandLists)
+    {
+        commandList = commandQueue.GetCommandList();
+    }
+
+    if (numDraws == 0)
+    {
+        setup(*commandLists[0]);
+    }
+    else
+    {
+        Application::Get().GetThreadPool().ParallelFor(numDraws, numCommandLists,
+            [&](size_t chunk, size_t begin, size_t end)
+            {
+                CommandList& commandList = *commandLists[chunk];
+
+                setup(commandList);
+                record(commandList, begin, end);
+            });
+    }
+
+    m_LastRecordTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    m_LastNumCommandLists = static_cast<uint32_t>(numCommandLists);
+
+    return commandLists;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Records a draw list on N command lists in parallel.
+// --
+// Every worker CommandList already owns its DynamicDescriptorHeaps, UploadBuffer and ResourceStateTracker,
+// so workers don't share any recording state. The shared setup (render target, viewport, root signature, PSO, ...)
+// is recorded at the start of each worker list by the SetupFunc.
+// --
+// The returned command lists are in draw order. Pass them to CommandQueue::ExecuteCommandLists in that order:
+// the queue closes them one by one under the ResourceStateTracker lock, so the pending barriers and final
+// resource states of the workers are merged deterministically (same result as a serial recording).
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class CommandList;
+class CommandQueue;
+
+class DX12_FW_API ParallelCommandListRecorder
+{
+public:
+    // Records the state shared by all workers.
+    using SetupFunc  = std::function<void(CommandList& commandList)>;
+    // Records the draws [begin, end) of the draw list.
+    using RecordFunc = std::function<void(CommandList& commandList, size_t begin, size_t end)>;
+
+    // @param numThreads - number of command lists to record in parallel (the calling thread records the first one).
+    // @param minDrawsPerCommandList - don't split the draw list finer than that, small lists cost more than they save.
+    explicit ParallelCommandListRecorder(uint32_t numThreads = 1, size_t minDrawsPerCommandList = 64);
+
+    // Get command lists from the queue, record [0, numDraws) split in contiguous ranges and return the lists in order.
+    // The lists are not executed.
+    std::vector<std::shared_ptr<CommandList>> Record(CommandQueue& commandQueue, size_t numDraws, const SetupFunc& setup, const RecordFunc& record);
+
+    void     SetNumThreads(uint32_t numThreads);
+    uint32_t GetNumThreads() const { return m_NumThreads; }
+
+    // Max number of threads the recorder can use (thread pool workers + the calling thread).
+    static uint32_t GetMaxNumThreads();
+
+    // Stats of the last Record call.
+    double   GetLastRecordTimeMs() const { return m_LastRecordTimeMs; }
+    uint32_t GetLastNumCommandLists() const { return m_LastNumCommandLists; }
+
+private:
+    uint32_t    m_NumThreads;
+    size_t      m_MinDrawsPerCommandList;
+
+    double      m_LastRecordTimeMs      = 0.0;
+    uint32_t    m_LastNumCommandLists   = 0;
+};
@@ -0,0 +1,88 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+uint64_t RenderQueue::MakeKey( uint32_t pass, uint32_t pipelineState, uint32_t material, uint32_t texture, float depth )
+{
+    const uint32_t maxDepth = ( 1u << DepthBits ) - 1;
+    float clampedDepth = std::min( std::max( depth, 0.0f ), 1.0f );
+    uint64_t quantizedDepth = static_cast<uint64_t>( clampedDepth * maxDepth );
+
+    uint64_t key = pass & ( ( 1u << PassBits ) - 1 );
+    key = ( key << PipelineStateBits ) | ( pipelineState & ( ( 1u << PipelineStateBits ) - 1 ) );
+    key = ( key << MaterialBits ) | ( material & ( ( 1u << MaterialBits ) - 1 ) );
+    key = ( key << TextureBits ) | ( texture & ( ( 1u << TextureBits ) - 1 ) );
+    key = ( key << DepthBits ) | quantizedDepth;
+    return key;
+}
+
+void RenderQueue::Reserve( uint32_t numEntries )
+{
+    m_Entries.reserve( numEntries );
+    m_Scratch.reserve( numEntries );
+}
+
+void RenderQueue::Clear()
+{
+    m_Entries.clear();
+}
+
+void RenderQueue::Push( uint64_t key, uint32_t item )
+{
+    m_Entries.push_back( { key, item } );
+}
+
+void RenderQueue::Sort()
+{
+    m_NumSortPasses = 0;
+
+    const size_t numEntries = m_Entries.size();
+    if ( numEntries < 2 )
+        return;
+
+    // Histograms of the 8 bytes at once.
+    uint32_t histograms[8][256] = {};
+    for ( const Entry& entry : m_Entries )
+    {
+        for ( uint32_t byte = 0; byte < 8; ++byte )
+        {
+            ++histograms[byte][( entry.Key >> ( byte * 8 ) ) & 0xFF];
+        }
+    }
+
+    m_Scratch.resize( numEntries );
+    Entry* source = m_Entries.data();
+    Entry* destination = m_Scratch.data();
+
+    for ( uint32_t byte = 0; byte < 8; ++byte )
+    {
+        uint32_t* histogram = histograms[byte];
+
+        // Every key has the same byte: the pass wouldn't move anything.
+        if ( histogram[( source[0].Key >> ( byte * 8 ) ) & 0xFF] == numEntries )
+            continue;
+
+        // Exclusive prefix sum: the first output slot of each byte value.
+        uint32_t offset = 0;
+        for ( uint32_t value = 0; value < 256; ++value )
+        {
+            uint32_t count = histogram[value];
+            histogram[value] = offset;
+            offset += count;
+        }
+
+        for ( size_t i = 0; i < numEntries; ++i )
+        {
+            destination[histogram[( source[i].Key >> ( byte * 8 ) ) & 0xFF]++] = source[i];
+        }
+
+        std::swap( source, destination );
+        ++m_NumSortPasses;
+    }
+
+    // After an odd number of passes the sorted entries are in the scratch buffer.
+    if ( source != m_Entries.data() )
+    {
+        m_Entries.swap( m_Scratch );
+    }
+}
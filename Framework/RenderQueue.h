@@ -0,0 +1,53 @@
+#pragma once
+
+// Draw list sorted by 64-bit state keys, rebuilt every frame.
+// --
+// Key layout, most significant first:
+//   pass (4 bits) | pipeline state (8 bits) | material (14 bits) | texture set (14 bits) | depth (24 bits)
+// Draws that share the expensive state end up next to each other, and within the same state they go front to back.
+// The ids are the caller's (eg. indices into tables built at load time), values out of range are masked.
+// --
+// Sort is an LSD radix sort on the key bytes (O(n), stable): the histograms of the 8 bytes are computed in a single
+// pass, and the bytes that are the same for every key (eg. a single pass or pipeline state) are skipped.
+// No device is used, the queue can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API RenderQueue
+{
+public:
+    static constexpr uint32_t PassBits          = 4;
+    static constexpr uint32_t PipelineStateBits = 8;
+    static constexpr uint32_t MaterialBits      = 14;
+    static constexpr uint32_t TextureBits       = 14;
+    static constexpr uint32_t DepthBits         = 24;
+
+    struct Entry
+    {
+        uint64_t    Key;
+        uint32_t    Item;       // The caller's draw (eg. a mesh part index).
+    };
+
+    // @param depth - normalized [0, 1] (0 = near), clamped.
+    static uint64_t MakeKey( uint32_t pass, uint32_t pipelineState, uint32_t material, uint32_t texture, float depth );
+
+    void Reserve( uint32_t numEntries );
+    void Clear();
+    void Push( uint64_t key, uint32_t item );
+
+    // Sort the entries by key (equal keys keep their push order).
+    void Sort();
+
+    uint32_t GetNumEntries() const { return static_cast<uint32_t>( m_Entries.size() ); }
+    const std::vector<Entry>& GetEntries() const { return m_Entries; }
+    // Radix passes of the last Sort (the skipped bytes don't count).
+    uint32_t GetNumSortPasses() const { return m_NumSortPasses; }
+
+private:
+    std::vector<Entry>  m_Entries;
+    std::vector<Entry>  m_Scratch;      // Ping-pong buffer of the radix passes.
+    uint32_t            m_NumSortPasses = 0;
+};
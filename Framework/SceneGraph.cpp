@@ -0,0 +1,91 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+#include <exception>
+
+using namespace DirectX;
+
+void SceneGraph::Reserve( uint32_t numNodes )
+{
+    m_Parents.reserve( numNodes );
+    m_LocalMatrices.reserve( numNodes );
+    m_WorldMatrices.reserve( numNodes );
+    m_Dirty.reserve( numNodes );
+    m_Names.reserve( numNodes );
+}
+
+void SceneGraph::Clear()
+{
+    m_Parents.clear();
+    m_LocalMatrices.clear();
+    m_WorldMatrices.clear();
+    m_Dirty.clear();
+    m_Names.clear();
+    m_NumDirty = 0;
+}
+
+uint32_t SceneGraph::AddNode( uint32_t parent, const XMFLOAT4X4& localMatrix, const std::string& name )
+{
+    if ( parent != InvalidNode && parent >= GetNumNodes() )
+    {
+        throw std::exception( "SceneGraph: the parent must be added before its children." );
+    }
+
+    m_Parents.push_back( parent );
+    m_LocalMatrices.push_back( localMatrix );
+    m_WorldMatrices.push_back( localMatrix );
+    m_Dirty.push_back( 1 );
+    m_Names.push_back( name );
+    ++m_NumDirty;
+
+    return GetNumNodes() - 1;
+}
+
+void SceneGraph::SetLocalMatrix( uint32_t node, const XMFLOAT4X4& localMatrix )
+{
+    m_LocalMatrices[node] = localMatrix;
+    m_NumDirty += m_Dirty[node] ? 0 : 1;
+    m_Dirty[node] = 1;
+}
+
+uint32_t SceneGraph::UpdateWorldMatrices()
+{
+    if ( m_NumDirty == 0 )
+        return 0;
+
+    const uint32_t numNodes = GetNumNodes();
+    const uint32_t* parents = m_Parents.data();
+    const XMFLOAT4X4* localMatrices = m_LocalMatrices.data();
+    XMFLOAT4X4* worldMatrices = m_WorldMatrices.data();
+    uint8_t* dirty = m_Dirty.data();
+
+    // Parents come first: their flag and world matrix are final when their children are reached.
+    uint32_t numUpdated = 0;
+    for ( uint32_t node = 0; node < numNodes; ++node )
+    {
+        const uint32_t parent = parents[node];
+        if ( parent == InvalidNode )
+        {
+            if ( dirty[node] )
+            {
+                worldMatrices[node] = localMatrices[node];
+                ++numUpdated;
+            }
+            continue;
+        }
+
+        dirty[node] |= dirty[parent];
+        if ( !dirty[node] )
+            continue;
+
+        XMMATRIX world = XMMatrixMultiply( XMLoadFloat4x4( &localMatrices[node] ), XMLoadFloat4x4( &worldMatrices[parent] ) );
+        XMStoreFloat4x4( &worldMatrices[node], world );
+        ++numUpdated;
+    }
+
+    // The flags are only read during the pass.
+    std::fill( m_Dirty.begin(), m_Dirty.end(), static_cast<uint8_t>( 0 ) );
+    m_NumDirty = 0;
+
+    return numUpdated;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// Transform hierarchy (eg. the aiNode tree of a model), stored as flat arrays indexed by node.
+// --
+// A node is always added after its parent, so the parent indices are sorted topologically (parent < child) and the
+// world matrices are propagated in a single linear pass over the arrays: world = local * world[parent] (row vectors).
+// Setting a local matrix flags the node, UpdateWorldMatrices recomputes the flagged nodes and everything below them
+// (a node is dirty if its parent was), the other world matrices are kept.
+// One matrix at a time (DirectXMath, SIMD across a row): a batch of the nodes of one depth across the lanes needs
+// their matrices transposed in and out of these arrays, which costs more than the multiply it vectorizes.
+// No device is used, the graph can be built and updated headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class DX12_FW_API SceneGraph
+{
+public:
+    static constexpr uint32_t InvalidNode = 0xFFFFFFFF;
+
+    void Reserve( uint32_t numNodes );
+    void Clear();
+
+    // @param parent - an existing node, or InvalidNode for a root.
+    // @return the index of the node (always the largest index so far).
+    uint32_t AddNode( uint32_t parent, const DirectX::XMFLOAT4X4& localMatrix, const std::string& name );
+
+    void SetLocalMatrix( uint32_t node, const DirectX::XMFLOAT4X4& localMatrix );
+
+    // Recompute the world matrices of the dirty nodes and their descendants.
+    // @return the number of world matrices recomputed.
+    uint32_t UpdateWorldMatrices();
+
+    uint32_t GetNumNodes() const { return static_cast<uint32_t>( m_Parents.size() ); }
+    uint32_t GetParent( uint32_t node ) const { return m_Parents[node]; }
+    const std::string& GetName( uint32_t node ) const { return m_Names[node]; }
+    const DirectX::XMFLOAT4X4& GetLocalMatrix( uint32_t node ) const { return m_LocalMatrices[node]; }
+    // Up to date after UpdateWorldMatrices.
+    const DirectX::XMFLOAT4X4& GetWorldMatrix( uint32_t node ) const { return m_WorldMatrices[node]; }
+    bool IsDirty( uint32_t node ) const { return m_Dirty[node] != 0; }
+
+private:
+    std::vector<uint32_t>               m_Parents;
+    std::vector<DirectX::XMFLOAT4X4>    m_LocalMatrices;
+    std::vector<DirectX::XMFLOAT4X4>    m_WorldMatrices;
+    std::vector<uint8_t>                m_Dirty;
+    std::vector<std::string>            m_Names;
+    uint32_t                            m_NumDirty = 0;     // Nodes flagged since the last update.
+};
@@ -0,0 +1,45 @@
+// Builds one mip of the Hi-Z pyramid: each texel is the max (farthest) depth of the 2x2 source texels under it.
+// The last row/column also takes the extra source row/column of an odd size, so no depth texel is missed.
+// Mip 0 is reduced from the depth buffer, the next mips from the previous mip.
+// CPU reference: CullingMath::ReduceTexel (Framework/CullingMath.cpp).
+
+#define BLOCK_SIZE 8
+
+struct BuildHiZConstants
+{
+    uint2 SrcSize;
+    uint2 DstSize;
+};
+
+ConstantBuffer<BuildHiZConstants> BuildHiZCB : register(b0);
+
+Texture2D<float>    SrcMip : register(t0);
+RWTexture2D<float>  DstMip : register(u0);
+
+[numthreads(BLOCK_SIZE, BLOCK_SIZE, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= BuildHiZCB.DstSize.x || DTid.y >= BuildHiZCB.DstSize.y)
+    {
+        return;
+    }
+
+    uint2 first = DTid.xy * 2;
+    uint2 last;
+    last.x = (DTid.x == BuildHiZCB.DstSize.x - 1) ? BuildHiZCB.SrcSize.x - 1 : first.x + 1;
+    last.y = (DTid.y == BuildHiZCB.DstSize.y - 1) ? BuildHiZCB.SrcSize.y - 1 : first.y + 1;
+
+    float maxDepth = SrcMip.Load(int3(first, 0));
+
+    [loop]
+    for (uint y = first.y; y <= last.y; ++y)
+    {
+        [loop]
+        for (uint x = first.x; x <= last.x; ++x)
+        {
+            maxDepth = max(maxDepth, SrcMip.Load(int3(x, y, 0)));
+        }
+    }
+
+    DstMip[DTid.xy] = maxDepth;
+}
@@ -0,0 +1,269 @@
+// GPU instance culling: frustum test + Hi-Z occlusion test, one thread per instance.
+// The commands of the visible instances are appended to an ExecuteIndirect argument buffer, its UAV counter
+// is the count buffer of the draw.
+// --
+// Phase 1: backface test of the cluster cones (UseCones), frustum test, then occlusion against the pyramid of the
+//          previous frame (HiZView is the previous view). The occluded instances are flagged for phase 2.
+// Phase 2: the pyramid was rebuilt from the depth of the phase 1 draws (HiZView is the current view).
+//          The flagged instances are tested again, the ones that are visible now are appended.
+// --
+// CPU reference: CullingMath (Framework/CullingMath.cpp). The decisions must match it bit for bit:
+// same operations in the same order, all `precise` (no fused mad), and the divide is only used as a first guess.
+
+#define GROUP_SIZE 64
+
+#define PHASE_1 1
+#define PHASE_2 2
+
+// Instance flags
+#define FLAG_NONE     0
+#define FLAG_OCCLUDED 1 // Occluded in phase 1, tested again in phase 2.
+
+struct InstanceBounds
+{
+    float3 Center;
+    float  _Padding0;
+    float3 Extents;
+    float  _Padding1;
+};
+
+// Bounding sphere and normal cone (Axis = 0, Cutoff = 1 for none).
+struct InstanceCone
+{
+    float3 Center;
+    float  Radius;
+    float3 Axis;
+    float  Cutoff;
+};
+
+// Same layout as IndirectDrawBuilder::DrawCommand (56 bytes).
+struct DrawCommand
+{
+    uint2 VertexBufferLocation;
+    uint  VertexBufferSize;
+    uint  VertexBufferStride;
+    uint2 IndexBufferLocation;
+    uint  IndexBufferSize;
+    uint  IndexBufferFormat;
+    uint  DrawIndex;
+    uint  IndexCountPerInstance;
+    uint  InstanceCount;
+    uint  StartIndexLocation;
+    int   BaseVertexLocation;
+    uint  StartInstanceLocation;
+};
+
+struct View
+{
+    float4 ViewProjection[4]; // Rows (row vectors).
+    float4 FrustumPlanes[6];  // Left, right, bottom, top, near, far.
+};
+
+struct CullConstants
+{
+    View   FrustumView;
+    View   HiZView;
+    float2 DepthTexelSize;    // 2 / depth size (computed on the CPU).
+    uint2  DepthSize;
+    uint2  HiZSize;           // Mip 0.
+    uint   HiZNumMips;
+    uint   UseHiZ;
+    uint   NumInstances;
+    uint   Phase;
+    uint   UseCones;
+    uint   _Padding0;
+    float3 CameraPosition;
+    uint   _Padding1;
+};
+
+ConstantBuffer<CullConstants>       CullCB          : register(b0);
+
+StructuredBuffer<InstanceBounds>    Bounds          : register(t0);
+StructuredBuffer<DrawCommand>       Commands        : register(t1);
+Texture2D<float>                    HiZ             : register(t2);
+StructuredBuffer<InstanceCone>      Cones           : register(t3);
+
+RWStructuredBuffer<uint>            InstanceFlags   : register(u0);
+AppendStructuredBuffer<DrawCommand> OutCommands     : register(u1);
+
+bool IsInFrustum(InstanceBounds bounds, View view)
+{
+    float3 c = bounds.Center;
+    float3 e = bounds.Extents;
+
+    [unroll]
+    for (uint i = 0; i < 6; ++i)
+    {
+        float4 plane = view.FrustumPlanes[i];
+
+        precise float distance = ((plane.x * c.x + plane.y * c.y) + plane.z * c.z) + plane.w;
+        precise float radius = (abs(plane.x) * e.x + abs(plane.y) * e.y) + abs(plane.z) * e.z;
+        precise float farthest = distance + radius;
+
+        if (farthest < 0.0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Every point of the sphere is seen within the cutoff of the axis: all the triangles face away (see CullingMath::IsBackfacing).
+bool IsBackfacing(InstanceCone cone, float3 cameraPosition)
+{
+    precise float x = cone.Center.x - cameraPosition.x;
+    precise float y = cone.Center.y - cameraPosition.y;
+    precise float z = cone.Center.z - cameraPosition.z;
+
+    precise float distance = ((x * cone.Axis.x + y * cone.Axis.y) + z * cone.Axis.z) - (cone.Radius + cone.Radius * cone.Cutoff);
+    if (distance < 0.0)
+    {
+        return false;
+    }
+
+    precise float lengthSquared = (x * x + y * y) + z * z;
+    precise float limit = (cone.Cutoff * cone.Cutoff) * lengthSquared;
+    precise float distanceSquared = distance * distance;
+    return distanceSquared >= limit;
+}
+
+// The largest p in [0, size-1] with c >= (p * texelSize - 1) * w (see CullingMath::GetTexelIndex).
+uint GetTexelIndex(float c, float w, float texelSize, uint size)
+{
+    float guess = ((c / w) * 0.5 + 0.5) * float(size);
+    uint p = uint(clamp(guess, 0.0, float(size - 1)));
+
+    [loop]
+    while (p > 0)
+    {
+        precise float edge = (float(p) * texelSize - 1.0) * w;
+        if (c >= edge)
+        {
+            break;
+        }
+        --p;
+    }
+
+    [loop]
+    while (p + 1 < size)
+    {
+        precise float edge = (float(p + 1) * texelSize - 1.0) * w;
+        if (c < edge)
+        {
+            break;
+        }
+        ++p;
+    }
+
+    return p;
+}
+
+bool IsOccluded(InstanceBounds bounds, View view)
+{
+    float3 c = bounds.Center;
+    float3 e = bounds.Extents;
+
+    float clipZ[8];
+    float clipW[8];
+
+    uint2 minTexel = CullCB.DepthSize - 1;
+    uint2 maxTexel = uint2(0, 0);
+
+    [unroll]
+    for (uint i = 0; i < 8; ++i)
+    {
+        precise float x = (i & 1) ? c.x + e.x : c.x - e.x;
+        precise float y = (i & 2) ? c.y + e.y : c.y - e.y;
+        precise float z = (i & 4) ? c.z + e.z : c.z - e.z;
+
+        precise float4 clip = ((x * view.ViewProjection[0] + y * view.ViewProjection[1]) + z * view.ViewProjection[2]) + view.ViewProjection[3];
+
+        // Crosses the camera plane: the screen rectangle is unbounded.
+        if (!(clip.w > 0.0))
+        {
+            return false;
+        }
+
+        uint2 texel;
+        texel.x = GetTexelIndex(clip.x, clip.w, CullCB.DepthTexelSize.x, CullCB.DepthSize.x);
+        texel.y = GetTexelIndex(-clip.y, clip.w, CullCB.DepthTexelSize.y, CullCB.DepthSize.y);
+
+        minTexel = min(minTexel, texel);
+        maxTexel = max(maxTexel, texel);
+
+        clipZ[i] = clip.z;
+        clipW[i] = clip.w;
+    }
+
+    // Depth texels -> mip 0 texels.
+    minTexel = min(minTexel >> 1, CullCB.HiZSize - 1);
+    maxTexel = min(maxTexel >> 1, CullCB.HiZSize - 1);
+
+    // The first mip where the rectangle spans at most 2x2 texels.
+    uint extent = max(maxTexel.x - minTexel.x, maxTexel.y - minTexel.y);
+    uint mip = (extent == 0) ? 0 : firstbithigh(extent) + 1;
+    mip = min(mip, CullCB.HiZNumMips - 1);
+
+    uint2 mipSize = max(CullCB.HiZSize >> mip, uint2(1, 1));
+    uint2 texel0 = min(minTexel >> mip, mipSize - 1);
+    uint2 texel1 = min(maxTexel >> mip, mipSize - 1);
+
+    float maxDepth = max(max(HiZ.Load(int3(texel0.x, texel0.y, mip)), HiZ.Load(int3(texel1.x, texel0.y, mip))),
+                         max(HiZ.Load(int3(texel0.x, texel1.y, mip)), HiZ.Load(int3(texel1.x, texel1.y, mip))));
+
+    // z / w > maxDepth, without the divide (w > 0).
+    [unroll]
+    for (uint j = 0; j < 8; ++j)
+    {
+        precise float farthestZ = maxDepth * clipW[j];
+        if (!(clipZ[j] > farthestZ))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 DTid : SV_DispatchThreadID)
+{
+    uint instance = DTid.x;
+    if (instance >= CullCB.NumInstances)
+    {
+        return;
+    }
+
+    InstanceBounds bounds = Bounds[instance];
+
+    if (CullCB.Phase == PHASE_1)
+    {
+        InstanceFlags[instance] = FLAG_NONE;
+
+        if (CullCB.UseCones != 0 && IsBackfacing(Cones[instance], CullCB.CameraPosition))
+        {
+            return;
+        }
+
+        if (!IsInFrustum(bounds, CullCB.FrustumView))
+        {
+            return;
+        }
+
+        if (CullCB.UseHiZ != 0 && IsOccluded(bounds, CullCB.HiZView))
+        {
+            InstanceFlags[instance] = FLAG_OCCLUDED;
+            return;
+        }
+    }
+    else
+    {
+        if (InstanceFlags[instance] != FLAG_OCCLUDED || IsOccluded(bounds, CullCB.HiZView))
+        {
+            return;
+        }
+    }
+
+    OutCommands.Append(Commands[instance]);
+}
@@ -0,0 +1,499 @@
+#include "SoftwareOcclusionCuller.h"
+
+#include <Framework/ThreadPool.h>
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <exception>
+
+using namespace DirectX;
+
+namespace
+{
+    // Outcodes of a clip-space vertex.
+    const uint32_t OutsideLeft      = 1 << 0;
+    const uint32_t OutsideRight     = 1 << 1;
+    const uint32_t OutsideBottom    = 1 << 2;
+    const uint32_t OutsideTop       = 1 << 3;
+    const uint32_t OutsideNear      = 1 << 4;
+    const uint32_t OutsideFar       = 1 << 5;
+
+    uint32_t GetOutcode( const XMFLOAT4& clip )
+    {
+        uint32_t outcode = 0;
+        outcode |= ( clip.x < -clip.w ) ? OutsideLeft : 0;
+        outcode |= ( clip.x > clip.w ) ? OutsideRight : 0;
+        outcode |= ( clip.y < -clip.w ) ? OutsideBottom : 0;
+        outcode |= ( clip.y > clip.w ) ? OutsideTop : 0;
+        outcode |= ( clip.z < 0.0f ) ? OutsideNear : 0;
+        outcode |= ( clip.z > clip.w ) ? OutsideFar : 0;
+        return outcode;
+    }
+
+    // Row vectors, same order of operations as CullingMath.
+    XMFLOAT4 TransformPoint( const XMFLOAT4X4& m, const XMFLOAT3& p )
+    {
+        return XMFLOAT4(
+            ( ( p.x * m.m[0][0] + p.y * m.m[1][0] ) + p.z * m.m[2][0] ) + m.m[3][0],
+            ( ( p.x * m.m[0][1] + p.y * m.m[1][1] ) + p.z * m.m[2][1] ) + m.m[3][1],
+            ( ( p.x * m.m[0][2] + p.y * m.m[1][2] ) + p.z * m.m[2][2] ) + m.m[3][2],
+            ( ( p.x * m.m[0][3] + p.y * m.m[1][3] ) + p.z * m.m[2][3] ) + m.m[3][3] );
+    }
+
+    XMFLOAT4 Lerp( const XMFLOAT4& a, const XMFLOAT4& b, float t )
+    {
+        return XMFLOAT4( a.x + ( b.x - a.x ) * t, a.y + ( b.y - a.y ) * t, a.z + ( b.z - a.z ) * t, a.w + ( b.w - a.w ) * t );
+    }
+}
+
+void SoftwareOcclusionCuller::Resize( uint32_t width, uint32_t height )
+{
+    m_Width = std::max<uint32_t>( TileSize, ( width + TileSize - 1 ) / TileSize * TileSize );
+    m_Height = std::max<uint32_t>( TileSize, ( height + TileSize - 1 ) / TileSize * TileSize );
+    m_NumTilesX = m_Width / TileSize;
+    m_NumTilesY = m_Height / TileSize;
+
+    // Nothing rendered yet: nothing is occluded.
+    m_Depth.assign( m_Width * m_Height, 1.0f );
+    m_TileMaxDepth.assign( m_NumTilesX * m_NumTilesY, 1.0f );
+}
+
+uint32_t SoftwareOcclusionCuller::AddOccluder( const std::vector<XMFLOAT3>& positions, const std::vector<uint32_t>& indices )
+{
+    Occluder occluder;
+    occluder.Positions = positions;
+    occluder.Indices = indices;
+    m_Occluders.push_back( std::move( occluder ) );
+
+    return GetNumOccluders() - 1;
+}
+
+void SoftwareOcclusionCuller::ClearOccluders()
+{
+    m_Occluders.clear();
+}
+
+void SoftwareOcclusionCuller::RenderOccluders( const XMFLOAT4X4& viewProjection, ThreadPool* threadPool )
+{
+    RenderOccluders( viewProjection, threadPool, Implementation::SSE );
+}
+
+void SoftwareOcclusionCuller::RenderOccluders( const XMFLOAT4X4& viewProjection, ThreadPool* threadPool, Implementation implementation )
+{
+    if ( m_Depth.empty() )
+    {
+        throw std::exception( "SoftwareOcclusionCuller: Resize must be called before RenderOccluders." );
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    m_ViewProjection = viewProjection;
+    std::fill( m_Depth.begin(), m_Depth.end(), 1.0f );
+
+    size_t numThreads = threadPool ? threadPool->GetNumThreads() + 1 : 1;
+
+    // 1. Transform, clip and set up the triangles, per chunk of occluders.
+    size_t numOccluderChunks = std::max<size_t>( 1, std::min( numThreads, m_Occluders.size() ) );
+    m_Triangles.resize( numOccluderChunks );
+    for ( auto& triangles : m_Triangles )
+    {
+        triangles.clear();
+    }
+
+    auto setupTriangles = [this]( size_t chunk, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            SetupTriangles( m_Occluders[i], m_Triangles[chunk] );
+        }
+    };
+
+    if ( threadPool && numOccluderChunks > 1 )
+    {
+        threadPool->ParallelFor( m_Occluders.size(), numOccluderChunks, setupTriangles );
+    }
+    else
+    {
+        setupTriangles( 0, 0, m_Occluders.size() );
+    }
+
+    // 2. Rasterize bands of tile rows. Two bands per thread, the triangles are rarely spread evenly over the screen.
+    size_t numBands = std::min<size_t>( m_NumTilesY, 2 * numThreads );
+
+    auto rasterizeBands = [this, implementation]( size_t, size_t beginTileRow, size_t endTileRow )
+    {
+        for ( size_t tileRow = beginTileRow; tileRow < endTileRow; ++tileRow )
+        {
+            RasterizeBand( static_cast<int32_t>( tileRow * TileSize ), static_cast<int32_t>( ( tileRow + 1 ) * TileSize - 1 ), implementation );
+        }
+    };
+
+    if ( threadPool && numBands > 1 )
+    {
+        threadPool->ParallelFor( m_NumTilesY, numBands, rasterizeBands );
+    }
+    else
+    {
+        rasterizeBands( 0, 0, m_NumTilesY );
+    }
+
+    m_Stats.NumOccluderTriangles = 0;
+    for ( const auto& occluder : m_Occluders )
+    {
+        m_Stats.NumOccluderTriangles += static_cast<uint32_t>( occluder.Indices.size() / 3 );
+    }
+
+    m_Stats.NumRasterizedTriangles = 0;
+    for ( const auto& triangles : m_Triangles )
+    {
+        m_Stats.NumRasterizedTriangles += static_cast<uint32_t>( triangles.size() );
+    }
+
+    m_Stats.RasterTimeMs = std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - startTime ).count();
+}
+
+void SoftwareOcclusionCuller::SetupTriangles( const Occluder& occluder, std::vector<Triangle>& triangles ) const
+{
+    std::vector<XMFLOAT4> clip( occluder.Positions.size() );
+    std::vector<uint32_t> outcodes( occluder.Positions.size() );
+    for ( size_t i = 0; i < clip.size(); ++i )
+    {
+        clip[i] = TransformPoint( m_ViewProjection, occluder.Positions[i] );
+        outcodes[i] = GetOutcode( clip[i] );
+    }
+
+    for ( size_t i = 0; i + 2 < occluder.Indices.size(); i += 3 )
+    {
+        uint32_t i0 = occluder.Indices[i];
+        uint32_t i1 = occluder.Indices[i + 1];
+        uint32_t i2 = occluder.Indices[i + 2];
+
+        // All the vertices outside of the same plane.
+        if ( outcodes[i0] & outcodes[i1] & outcodes[i2] )
+            continue;
+
+        XMFLOAT4 vertices[4] = { clip[i0], clip[i1], clip[i2] };
+
+        if ( ( ( outcodes[i0] | outcodes[i1] | outcodes[i2] ) & OutsideNear ) == 0 )
+        {
+            SetupTriangle( vertices, 3, triangles );
+            continue;
+        }
+
+        // Clip against the near plane (z >= 0): a triangle or a quad.
+        XMFLOAT4 clipped[4];
+        uint32_t numClipped = 0;
+        for ( uint32_t v = 0; v < 3; ++v )
+        {
+            const XMFLOAT4& current = vertices[v];
+            const XMFLOAT4& next = vertices[( v + 1 ) % 3];
+
+            if ( current.z >= 0.0f )
+            {
+                clipped[numClipped++] = current;
+            }
+            if ( ( current.z >= 0.0f ) != ( next.z >= 0.0f ) )
+            {
+                clipped[numClipped++] = Lerp( current, next, current.z / ( current.z - next.z ) );
+            }
+        }
+
+        SetupTriangle( clipped, numClipped, triangles );
+    }
+}
+
+void SoftwareOcclusionCuller::SetupTriangle( const XMFLOAT4* clip, uint32_t numVertices, std::vector<Triangle>& triangles ) const
+{
+    // Screen space: pixel (x, y) covers [x, x + 1) x [y, y + 1), y down.
+    XMFLOAT3 screen[4];
+    for ( uint32_t v = 0; v < numVertices; ++v )
+    {
+        // On the near plane after clipping, w > 0 for a perspective projection.
+        if ( !( clip[v].w > 0.0f ) )
+            return;
+
+        float invW = 1.0f / clip[v].w;
+        screen[v].x = ( clip[v].x * invW * 0.5f + 0.5f ) * m_Width;
+        screen[v].y = ( 0.5f - clip[v].y * invW * 0.5f ) * m_Height;
+        screen[v].z = clip[v].z * invW;
+    }
+
+    // Fan.
+    for ( uint32_t v = 1; v + 1 < numVertices; ++v )
+    {
+        const XMFLOAT3& a = screen[0];
+        const XMFLOAT3& b = screen[v];
+        const XMFLOAT3& c = screen[v + 1];
+
+        float area = ( b.x - a.x ) * ( c.y - a.y ) - ( b.y - a.y ) * ( c.x - a.x );
+        if ( !( std::abs( area ) > 0.0f ) || !std::isfinite( area ) )
+            continue;
+
+        float minX = std::min( a.x, std::min( b.x, c.x ) );
+        float maxX = std::max( a.x, std::max( b.x, c.x ) );
+        float minY = std::min( a.y, std::min( b.y, c.y ) );
+        float maxY = std::max( a.y, std::max( b.y, c.y ) );
+
+        // The pixels whose center is in the bounding box, clamped to the screen.
+        float firstX = std::max( 0.0f, std::ceil( minX - 0.5f ) );
+        float lastX = std::min( m_Width - 1.0f, std::floor( maxX - 0.5f ) );
+        float firstY = std::max( 0.0f, std::ceil( minY - 0.5f ) );
+        float lastY = std::min( m_Height - 1.0f, std::floor( maxY - 0.5f ) );
+        if ( firstX > lastX || firstY > lastY )
+            continue;
+
+        Triangle triangle;
+        triangle.MinX = static_cast<int32_t>( firstX );
+        triangle.MaxX = static_cast<int32_t>( lastX );
+        triangle.MinY = static_cast<int32_t>( firstY );
+        triangle.MaxY = static_cast<int32_t>( lastY );
+
+        // Positive inside, whatever the winding (two-sided).
+        const XMFLOAT3* edges[3][2] = { { &a, &b }, { &b, &c }, { &c, &a } };
+        float sign = ( area > 0.0f ) ? 1.0f : -1.0f;
+        for ( uint32_t e = 0; e < 3; ++e )
+        {
+            const XMFLOAT3& p0 = *edges[e][0];
+            const XMFLOAT3& p1 = *edges[e][1];
+            triangle.EdgeA[e] = ( p0.y - p1.y ) * sign;
+            triangle.EdgeB[e] = ( p1.x - p0.x ) * sign;
+            triangle.EdgeC[e] = ( p0.x * p1.y - p0.y * p1.x ) * sign;
+        }
+
+        // z / w is linear in screen space.
+        float invArea = 1.0f / area;
+        triangle.DepthA = ( ( b.z - a.z ) * ( c.y - a.y ) - ( c.z - a.z ) * ( b.y - a.y ) ) * invArea;
+        triangle.DepthB = ( ( c.z - a.z ) * ( b.x - a.x ) - ( b.z - a.z ) * ( c.x - a.x ) ) * invArea;
+        triangle.DepthC = a.z - triangle.DepthA * a.x - triangle.DepthB * a.y;
+
+        triangles.push_back( triangle );
+    }
+}
+
+void SoftwareOcclusionCuller::RasterizeBand( int32_t minY, int32_t maxY, Implementation implementation )
+{
+    for ( const auto& triangles : m_Triangles )
+    {
+        for ( const Triangle& triangle : triangles )
+        {
+            if ( triangle.MaxY < minY || triangle.MinY > maxY )
+                continue;
+
+            if ( implementation == Implementation::SSE )
+            {
+                RasterizeSSE( triangle, minY, maxY );
+            }
+            else
+            {
+                RasterizeScalar( triangle, minY, maxY );
+            }
+        }
+    }
+
+    // Max depth of the tiles of the band.
+    for ( uint32_t tileY = minY / TileSize; tileY <= static_cast<uint32_t>( maxY ) / TileSize; ++tileY )
+    {
+        for ( uint32_t tileX = 0; tileX < m_NumTilesX; ++tileX )
+        {
+            float maxDepth = 0.0f;
+            for ( uint32_t y = tileY * TileSize; y < ( tileY + 1 ) * TileSize; ++y )
+            {
+                const float* row = &m_Depth[y * m_Width + tileX * TileSize];
+                for ( uint32_t x = 0; x < TileSize; ++x )
+                {
+                    maxDepth = std::max( maxDepth, row[x] );
+                }
+            }
+            m_TileMaxDepth[tileY * m_NumTilesX + tileX] = maxDepth;
+        }
+    }
+}
+
+void SoftwareOcclusionCuller::RasterizeScalar( const Triangle& triangle, int32_t minY, int32_t maxY )
+{
+    int32_t firstY = std::max( triangle.MinY, minY );
+    int32_t lastY = std::min( triangle.MaxY, maxY );
+
+    for ( int32_t y = firstY; y <= lastY; ++y )
+    {
+        float py = static_cast<float>( y ) + 0.5f;
+        float* row = &m_Depth[y * m_Width];
+
+        for ( int32_t x = triangle.MinX; x <= triangle.MaxX; ++x )
+        {
+            float px = static_cast<float>( x ) + 0.5f;
+
+            bool inside = true;
+            for ( uint32_t e = 0; e < 3; ++e )
+            {
+                inside &= ( triangle.EdgeA[e] * px + triangle.EdgeB[e] * py ) + triangle.EdgeC[e] >= 0.0f;
+            }
+
+            if ( inside )
+            {
+                float depth = ( triangle.DepthA * px + triangle.DepthB * py ) + triangle.DepthC;
+                row[x] = ( row[x] < depth ) ? row[x] : depth;
+            }
+        }
+    }
+}
+
+void SoftwareOcclusionCuller::RasterizeSSE( const Triangle& triangle, int32_t minY, int32_t maxY )
+{
+    int32_t firstY = std::max( triangle.MinY, minY );
+    int32_t lastY = std::min( triangle.MaxY, maxY );
+
+    // Groups of 4 pixels, aligned on 4 (the width is a multiple of 8).
+    const __m128 half = _mm_set1_ps( 0.5f );
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i laneOffsets = _mm_setr_epi32( 0, 1, 2, 3 );
+    const __m128i minX = _mm_set1_epi32( triangle.MinX - 1 );
+    const __m128i maxX = _mm_set1_epi32( triangle.MaxX + 1 );
+
+    __m128 edgeA[3], edgeB[3], edgeC[3];
+    for ( uint32_t e = 0; e < 3; ++e )
+    {
+        edgeA[e] = _mm_set1_ps( triangle.EdgeA[e] );
+        edgeB[e] = _mm_set1_ps( triangle.EdgeB[e] );
+        edgeC[e] = _mm_set1_ps( triangle.EdgeC[e] );
+    }
+    const __m128 depthA = _mm_set1_ps( triangle.DepthA );
+    const __m128 depthB = _mm_set1_ps( triangle.DepthB );
+    const __m128 depthC = _mm_set1_ps( triangle.DepthC );
+
+    for ( int32_t y = firstY; y <= lastY; ++y )
+    {
+        __m128 py = _mm_set1_ps( static_cast<float>( y ) + 0.5f );
+        float* row = &m_Depth[y * m_Width];
+
+        __m128 edgeBY[3];
+        for ( uint32_t e = 0; e < 3; ++e )
+        {
+            edgeBY[e] = _mm_mul_ps( edgeB[e], py );
+        }
+        __m128 depthBY = _mm_mul_ps( depthB, py );
+
+        // Span of the row between the edges, one pixel wider than the roots: it only bounds the loop, the edge tests
+        // below still decide (same pixels as the scalar loop).
+        float spanMinX = static_cast<float>( triangle.MinX );
+        float spanMaxX = static_cast<float>( triangle.MaxX );
+        for ( uint32_t e = 0; e < 3; ++e )
+        {
+            float rowOffset = triangle.EdgeB[e] * ( static_cast<float>( y ) + 0.5f ) + triangle.EdgeC[e];
+            if ( triangle.EdgeA[e] > 0.0f )
+            {
+                spanMinX = std::max( spanMinX, std::floor( -rowOffset / triangle.EdgeA[e] - 0.5f ) - 1.0f );
+            }
+            else if ( triangle.EdgeA[e] < 0.0f )
+            {
+                spanMaxX = std::min( spanMaxX, std::ceil( -rowOffset / triangle.EdgeA[e] - 0.5f ) + 1.0f );
+            }
+        }
+        if ( !( spanMinX <= spanMaxX ) )
+            continue;
+
+        int32_t rowMaxX = static_cast<int32_t>( spanMaxX );
+        for ( int32_t x = static_cast<int32_t>( spanMinX ) & ~3; x <= rowMaxX; x += 4 )
+        {
+            __m128i xs = _mm_add_epi32( _mm_set1_epi32( x ), laneOffsets );
+            __m128 px = _mm_add_ps( _mm_cvtepi32_ps( xs ), half );
+
+            // Only the pixels of the bounding box, like the scalar loop.
+            __m128 inside = _mm_castsi128_ps( _mm_and_si128( _mm_cmpgt_epi32( xs, minX ), _mm_cmplt_epi32( xs, maxX ) ) );
+            for ( uint32_t e = 0; e < 3; ++e )
+            {
+                __m128 edge = _mm_add_ps( _mm_add_ps( _mm_mul_ps( edgeA[e], px ), edgeBY[e] ), edgeC[e] );
+                inside = _mm_and_ps( inside, _mm_cmpge_ps( edge, zero ) );
+            }
+
+            if ( _mm_movemask_ps( inside ) == 0 )
+                continue;
+
+            __m128 depth = _mm_add_ps( _mm_add_ps( _mm_mul_ps( depthA, px ), depthBY ), depthC );
+            __m128 previous = _mm_loadu_ps( row + x );
+            // minps: previous < depth ? previous : depth.
+            __m128 nearest = _mm_min_ps( previous, depth );
+            _mm_storeu_ps( row + x, _mm_or_ps( _mm_and_ps( inside, nearest ), _mm_andnot_ps( inside, previous ) ) );
+        }
+    }
+}
+
+bool SoftwareOcclusionCuller::IsOccluded( const BoundingBox& box ) const
+{
+    if ( m_Depth.empty() )
+        return false;
+
+    float minX = FLT_MAX, maxX = -FLT_MAX;
+    float minY = FLT_MAX, maxY = -FLT_MAX;
+    float minDepth = FLT_MAX;
+
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+        XMFLOAT3 corner(
+            ( i & 1 ) ? box.Center.x + box.Extents.x : box.Center.x - box.Extents.x,
+            ( i & 2 ) ? box.Center.y + box.Extents.y : box.Center.y - box.Extents.y,
+            ( i & 4 ) ? box.Center.z + box.Extents.z : box.Center.z - box.Extents.z );
+
+        XMFLOAT4 clip = TransformPoint( m_ViewProjection, corner );
+
+        // In front of the near plane (or behind the camera): the screen rectangle is unbounded.
+        if ( !( clip.w > 0.0f ) || clip.z < 0.0f )
+            return false;
+
+        float invW = 1.0f / clip.w;
+        float x = ( clip.x * invW * 0.5f + 0.5f ) * m_Width;
+        float y = ( 0.5f - clip.y * invW * 0.5f ) * m_Height;
+
+        minX = std::min( minX, x );
+        maxX = std::max( maxX, x );
+        minY = std::min( minY, y );
+        maxY = std::max( maxY, y );
+        minDepth = std::min( minDepth, clip.z * invW );
+    }
+
+    // Every pixel the rectangle touches (not only the covered centers), clamped to the screen.
+    float firstX = std::max( 0.0f, std::floor( minX ) );
+    float lastX = std::min( m_Width - 1.0f, std::floor( maxX ) );
+    float firstY = std::max( 0.0f, std::floor( minY ) );
+    float lastY = std::min( m_Height - 1.0f, std::floor( maxY ) );
+
+    // Off-screen: left to the frustum culling.
+    if ( firstX > lastX || firstY > lastY )
+        return false;
+
+    uint32_t x0 = static_cast<uint32_t>( firstX );
+    uint32_t x1 = static_cast<uint32_t>( lastX );
+    uint32_t y0 = static_cast<uint32_t>( firstY );
+    uint32_t y1 = static_cast<uint32_t>( lastY );
+
+    for ( uint32_t tileY = y0 / TileSize; tileY <= y1 / TileSize; ++tileY )
+    {
+        for ( uint32_t tileX = x0 / TileSize; tileX <= x1 / TileSize; ++tileX )
+        {
+            // The whole tile is in front of the box.
+            if ( m_TileMaxDepth[tileY * m_NumTilesX + tileX] < minDepth )
+                continue;
+
+            uint32_t tileX0 = std::max( x0, tileX * TileSize );
+            uint32_t tileX1 = std::min( x1, tileX * TileSize + TileSize - 1 );
+            uint32_t tileY0 = std::max( y0, tileY * TileSize );
+            uint32_t tileY1 = std::min( y1, tileY * TileSize + TileSize - 1 );
+
+            for ( uint32_t y = tileY0; y <= tileY1; ++y )
+            {
+                const float* row = &m_Depth[y * m_Width];
+                for ( uint32_t x = tileX0; x <= tileX1; ++x )
+                {
+                    if ( !( row[x] < minDepth ) )
+                        return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// CPU occlusion culling: the occluder meshes are rasterized into a low-resolution depth buffer, the boxes of the
+// occludees are then tested against it. Nothing is read back from the GPU.
+// --
+// Depth is z / w of the view-projection matrix (D3D, LESS, 1 = far). The buffer keeps the nearest occluder depth at the
+// pixel centers, and the max depth of every 8x8 tile on top of it: a box is occluded if its nearest depth is behind the
+// buffer over its whole screen rectangle, most tiles are settled by their max depth alone.
+// The triangles are clipped against the near plane and rasterized two-sided (4 pixels per instruction with SSE). The
+// rows are split in bands rasterized in parallel, a band only writes its own rows.
+// The scalar rasterizer is the reference: it performs the same operations in the same order, every implementation and
+// thread count gives the same depth buffer.
+// --
+// Occluders must be opaque (no alpha test): any pixel they cover hides what's behind it.
+// No device is used, the culler can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+class DX12_FW_API SoftwareOcclusionCuller
+{
+public:
+    static constexpr uint32_t TileSize = 8;
+
+    enum class Implementation
+    {
+        Scalar,     // Reference, 1 pixel at a time.
+        SSE,        // 4 pixels at a time.
+    };
+
+    struct Stats
+    {
+        uint32_t    NumOccluderTriangles = 0;
+        uint32_t    NumRasterizedTriangles = 0;     // After clipping and culling (off-screen, zero area).
+        double      RasterTimeMs = 0.0;
+    };
+
+    // @param width, height - rounded up to a multiple of TileSize.
+    void Resize( uint32_t width, uint32_t height );
+
+    // World-space triangle list.
+    // @return the index of the occluder.
+    uint32_t AddOccluder( const std::vector<DirectX::XMFLOAT3>& positions, const std::vector<uint32_t>& indices );
+    void ClearOccluders();
+
+    uint32_t GetNumOccluders() const { return static_cast<uint32_t>( m_Occluders.size() ); }
+
+    // Clear the depth buffer and rasterize every occluder with the view-projection matrix (row vectors).
+    // @param threadPool - nullptr to run on the calling thread only.
+    void RenderOccluders( const DirectX::XMFLOAT4X4& viewProjection, ThreadPool* threadPool );
+    void RenderOccluders( const DirectX::XMFLOAT4X4& viewProjection, ThreadPool* threadPool, Implementation implementation );
+
+    // Test a world-space box against the occluders of the last RenderOccluders.
+    // The boxes that cross the near plane are never occluded.
+    bool IsOccluded( const DirectX::BoundingBox& box ) const;
+
+    uint32_t GetWidth() const { return m_Width; }
+    uint32_t GetHeight() const { return m_Height; }
+    // Row-major, m_Width x m_Height.
+    const std::vector<float>& GetDepthBuffer() const { return m_Depth; }
+    const Stats& GetStats() const { return m_Stats; }
+
+private:
+    struct Occluder
+    {
+        std::vector<DirectX::XMFLOAT3>  Positions;
+        std::vector<uint32_t>           Indices;
+    };
+
+    // Setup of a screen-space triangle: edge functions and depth plane, E(x, y) = (A * x + B * y) + C.
+    struct Triangle
+    {
+        float       EdgeA[3];
+        float       EdgeB[3];
+        float       EdgeC[3];
+        float       DepthA;
+        float       DepthB;
+        float       DepthC;
+        int32_t     MinX;
+        int32_t     MinY;
+        int32_t     MaxX;   // Inclusive.
+        int32_t     MaxY;
+    };
+
+    // Clip, project and set up the triangles of an occluder.
+    void SetupTriangles( const Occluder& occluder, std::vector<Triangle>& triangles ) const;
+    void SetupTriangle( const DirectX::XMFLOAT4* clip, uint32_t numVertices, std::vector<Triangle>& triangles ) const;
+
+    // Rasterize rows [minY, maxY] and compute the max depth of their tiles (minY and maxY + 1 are multiples of TileSize).
+    void RasterizeBand( int32_t minY, int32_t maxY, Implementation implementation );
+    void RasterizeScalar( const Triangle& triangle, int32_t minY, int32_t maxY );
+    void RasterizeSSE( const Triangle& triangle, int32_t minY, int32_t maxY );
+
+    std::vector<Occluder>               m_Occluders;
+
+    DirectX::XMFLOAT4X4                 m_ViewProjection = {};
+    uint32_t                            m_Width = 0;
+    uint32_t                            m_Height = 0;
+    uint32_t                            m_NumTilesX = 0;
+    uint32_t                            m_NumTilesY = 0;
+    std::vector<float>                  m_Depth;
+    std::vector<float>                  m_TileMaxDepth;
+
+    // Set up triangles, per chunk of occluders.
+    std::vector<std::vector<Triangle>>  m_Triangles;
+
+    Stats                               m_Stats;
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+ /**
+  *  @file ThreadPool.h
+  *
+  *  @brief Fixed size pool of worker threads.
+  *         Tasks are std::function<void()> jobs, results are returned through std::future.
+  */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    /**
+     * Create the pool.
+     * @param numThreads The number of worker threads. 0 - use (hardware_concurrency - 1),
+     * as the calling thread also takes part in ParallelFor.
+     */
+    explicit ThreadPool(uint32_t numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * The number of worker threads (not counting the calling thread).
+     */
+    uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_Threads.size()); }
+
+    /**
+     * Queue a task. The returned future rethrows an exception thrown by the task.
+     */
+    template<typename Func>
+    auto Submit(Func&& func) -> std::future<typename std::invoke_result<Func>::type>;
+
+    /**
+     * Split [0, count) into numChunks contiguous ranges and call func(chunkIndex, begin, end) for each.
+     * The calling thread runs chunks too, then blocks until the chunks taken by the workers are done. It only
+     * runs the chunks of this call: the other queued tasks never delay its return.
+     * Nested calls don't deadlock, the chunks no worker took are run by their caller.
+     * The chunk boundaries depend only on (count, numChunks), so the results are deterministic
+     * as long as func writes to per-chunk or per-item outputs.
+     */
+    template<typename Func>
+    void ParallelFor(size_t count, size_t numChunks, Func&& func);
+
+    /**
+     * Run one queued task on the calling thread.
+     * Used while waiting on a future of Submit so a blocked worker still makes progress.
+     * @returns false if there was nothing to run.
+     */
+    bool TryRunPendingTask();
+
+private:
+    void WorkerThread();
+
+    std::vector<std::thread>            m_Threads;
+    std::queue<std::function<void()>>   m_Tasks;
+
+    std::mutex                          m_Mutex;
+    std::condition_variable             m_CV;
+    bool                                m_bStop = false;
+};
+
+inline ThreadPool::ThreadPool(uint32_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = (std::max)(1u, std::thread::hardware_concurrency()) - 1;
+        numThreads = (std::max)(1u, numThreads);
+    }
+
+    m_Threads.reserve(numThreads);
+    for (uint32_t i = 0; i < numThreads; ++i)
+    {
+        m_Threads.emplace_back(&ThreadPool::WorkerThread, this);
+    }
+}
+
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_CV.notify_all();
+
+    for (auto& thread : m_Threads)
+    {
+        thread.join();
+    }
+}
+
+template<typename Func>
+auto ThreadPool::Submit(Func&& func) -> std::future<typename std::invoke_result<Func>::type>
+{
+    using ResultType = typename std::invoke_result<Func>::type;
+
+    // std::function requires a copyable callable, so the packaged_task is shared.
+    auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+    auto future = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Tasks.emplace([task]() { (*task)(); });
+    }
+    m_CV.notify_one();
+
+    return future;
+}
+
+template<typename Func>
+void ThreadPool::ParallelFor(size_t count, size_t numChunks, Func&& func)
+{
+    if (count == 0)
+        return;
+
+    numChunks = (std::max<size_t>)(1, (std::min)(numChunks, count));
+
+    // Shared with the queued helpers: one can start after this call returned, it then finds no chunk left.
+    struct Chunks
+    {
+        std::atomic<size_t>     next{ 0 };
+        std::atomic<size_t>     numDone{ 0 };
+        std::mutex              mutex;
+        std::exception_ptr      exception;
+    };
+    auto chunks = std::make_shared<Chunks>();
+
+    // Takes chunks until none is left. func is only called for a taken chunk, which this call waits for.
+    auto runChunks = [chunks, &func, count, numChunks]()
+    {
+        for (size_t chunk = chunks->next++; chunk < numChunks; chunk = chunks->next++)
+        {
+            try
+            {
+                func(chunk, count * chunk / numChunks, count * (chunk + 1) / numChunks);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(chunks->mutex);
+                if (!chunks->exception)
+                    chunks->exception = std::current_exception();
+            }
+            ++chunks->numDone;
+        }
+    };
+
+    if (numChunks > 1)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (size_t helper = 1; helper < numChunks; ++helper)
+            {
+                m_Tasks.emplace(runChunks);
+            }
+        }
+        for (size_t helper = 1; helper < numChunks; ++helper)
+        {
+            m_CV.notify_one();
+        }
+    }
+
+    runChunks();
+
+    // Only the chunks running on the workers are left.
+    while (chunks->numDone < numChunks)
+    {
+        std::this_thread::yield();
+    }
+
+    if (chunks->exception)
+    {
+        std::rethrow_exception(chunks->exception);
+    }
+}
+
+inline bool ThreadPool::TryRunPendingTask()
+{
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Tasks.empty())
+            return false;
+
+        task = std::move(m_Tasks.front());
+        m_Tasks.pop();
+    }
+
+    task();
+
+    return true;
+}
+
+inline void ThreadPool::WorkerThread()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_CV.wait(lock, [this] { return m_bStop || !m_Tasks.empty(); });
+
+            if (m_bStop && m_Tasks.empty())
+                return;
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop();
+        }
+
+        task();
+    }
+}
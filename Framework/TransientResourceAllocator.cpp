@@ -0,0 +1,191 @@
+#include "TransientResourceAllocator.h"
+
+#include <Framework/Application.h>
+#include <Framework/ResourceStateTracker.h>
+
+#include <Framework/Material/Texture.h>
+
+#include <Framework/3RD_Party/D3D/d3dx12.h>
+#include <Framework/3RD_Party/Helpers.h>
+
+#include <cassert>
+#include <cstring>
+#include <exception>
+
+namespace
+{
+    bool IsDepthStencil(const D3D12_RESOURCE_DESC& desc)
+    {
+        return (desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) != 0;
+    }
+
+    // Compared member by member: the struct has padding.
+    bool ResourceDescsEqual(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+    {
+        return a.Dimension == b.Dimension &&
+               a.Alignment == b.Alignment &&
+               a.Width == b.Width &&
+               a.Height == b.Height &&
+               a.DepthOrArraySize == b.DepthOrArraySize &&
+               a.MipLevels == b.MipLevels &&
+               a.Format == b.Format &&
+               a.SampleDesc.Count == b.SampleDesc.Count &&
+               a.SampleDesc.Quality == b.SampleDesc.Quality &&
+               a.Layout == b.Layout &&
+               a.Flags == b.Flags;
+    }
+
+    bool ClearValuesEqual(const TransientResourceAllocator::TextureDesc& a, const TransientResourceAllocator::TextureDesc& b)
+    {
+        if (a.HasClearValue != b.HasClearValue)
+            return false;
+        if (!a.HasClearValue)
+            return true;
+        if (a.ClearValue.Format != b.ClearValue.Format)
+            return false;
+
+        // Only the active member of the union is meaningful.
+        if (IsDepthStencil(a.ResourceDesc))
+        {
+            return a.ClearValue.DepthStencil.Depth == b.ClearValue.DepthStencil.Depth &&
+                   a.ClearValue.DepthStencil.Stencil == b.ClearValue.DepthStencil.Stencil;
+        }
+
+        return std::memcmp(a.ClearValue.Color, b.ClearValue.Color, sizeof(a.ClearValue.Color)) == 0;
+    }
+}
+
+TransientResourceAllocator::TransientResourceAllocator()
+{}
+
+TransientResourceAllocator::~TransientResourceAllocator()
+{}
+
+void TransientResourceAllocator::Allocate(const std::vector<TextureDesc>& descs)
+{
+    if (IsAllocated(descs))
+        return;
+
+    auto& app = Application::Get();
+    auto device = app.GetDevice();
+
+    // The textures of the previous heap may still be in use.
+    if (m_Heap)
+    {
+        app.Flush();
+    }
+    Release();
+
+    if (descs.empty())
+        return;
+
+    // Tier 1 heaps can only hold one category of resources.
+    D3D12_FEATURE_DATA_D3D12_OPTIONS options = {};
+    ThrowIfFailed(device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &options, sizeof(options)));
+    bool onlyRenderTargets = (options.ResourceHeapTier == D3D12_RESOURCE_HEAP_TIER_1);
+
+    std::vector<AliasingPlanner::Request> requests;
+    requests.reserve(descs.size());
+
+    for (const auto& desc : descs)
+    {
+        if (onlyRenderTargets && !(desc.ResourceDesc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)))
+        {
+            throw std::exception("TransientResourceAllocator: resource heap tier 1 only supports render target and depth stencil textures.");
+        }
+
+        D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->GetResourceAllocationInfo(0, 1, &desc.ResourceDesc);
+        requests.push_back({ allocationInfo.SizeInBytes, allocationInfo.Alignment, desc.FirstPass, desc.LastPass });
+    }
+
+    m_Plan = AliasingPlanner::Build(requests);
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    heapDesc.Alignment = (m_Plan.HeapAlignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) ?
+        D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heapDesc.SizeInBytes = AliasingPlanner::AlignUp(m_Plan.HeapSize, heapDesc.Alignment);
+    heapDesc.Flags = onlyRenderTargets ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+
+    ThrowIfFailed(device->CreateHeap(&heapDesc, IID_PPV_ARGS(&m_Heap)));
+    m_Heap->SetName(L"Transient Resource Heap");
+
+    m_Textures.reserve(descs.size());
+    for (size_t i = 0; i < descs.size(); ++i)
+    {
+        const auto& desc = descs[i];
+
+        D3D12_CLEAR_VALUE clearValue = desc.ClearValue;
+        if (clearValue.Format == DXGI_FORMAT_R32_TYPELESS && IsDepthStencil(desc.ResourceDesc))
+        {
+            clearValue.Format = DXGI_FORMAT_D32_FLOAT;
+        }
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+        ThrowIfFailed(device->CreatePlacedResource(
+            m_Heap.Get(),
+            m_Plan.Placements[i].Offset,
+            &desc.ResourceDesc,
+            desc.InitialState,
+            desc.HasClearValue ? &clearValue : nullptr,
+            IID_PPV_ARGS(&resource)
+        ));
+
+        ResourceStateTracker::AddGlobalResourceState(resource.Get(), desc.InitialState);
+
+        m_Textures.push_back(std::make_shared<Texture>(resource, desc.Usage, desc.Name));
+    }
+
+    m_Descs = descs;
+    ++m_NumHeapAllocations;
+}
+
+void TransientResourceAllocator::Release()
+{
+    for (const auto& texture : m_Textures)
+    {
+        ResourceStateTracker::RemoveGlobalResourceState(texture->GetD3D12Resource().Get());
+    }
+
+    m_Textures.clear();
+    m_Descs.clear();
+    m_Heap.Reset();
+    m_Plan = AliasingPlanner::Plan();
+}
+
+std::shared_ptr<Texture> TransientResourceAllocator::GetTexture(uint32_t index) const
+{
+    assert(index < m_Textures.size());
+    return m_Textures[index];
+}
+
+bool TransientResourceAllocator::IsAliased(uint32_t index) const
+{
+    assert(index < m_Plan.Placements.size());
+    return m_Plan.Placements[index].Aliased;
+}
+
+bool TransientResourceAllocator::IsAllocated(const std::vector<TextureDesc>& descs) const
+{
+    if (!m_Heap || descs.size() != m_Descs.size())
+        return false;
+
+    for (size_t i = 0; i < descs.size(); ++i)
+    {
+        const auto& a = descs[i];
+        const auto& b = m_Descs[i];
+
+        if (a.Name != b.Name ||
+            !ResourceDescsEqual(a.ResourceDesc, b.ResourceDesc) ||
+            !ClearValuesEqual(a, b) ||
+            a.Usage != b.Usage ||
+            a.InitialState != b.InitialState ||
+            a.FirstPass != b.FirstPass ||
+            a.LastPass != b.LastPass)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Places the transient textures of a frame (render targets that only live for a few passes) in a single ID3D12Heap.
+// Textures that are never alive at the same time share the same memory (see AliasingPlanner).
+// --
+// The heap and the placed textures are only recreated when the descriptions or the lifetimes change
+// (e.g. on a resize). The GPU is flushed before the previous heap is released.
+// --
+// A placed render target / depth stencil has undefined content after it takes over aliased memory,
+// so the first pass that writes it must clear (or discard) it.
+
+#include "AliasingPlanner.h"
+
+#include <Framework/3RD_Party/Defines.h>
+#include <Framework/Material/TextureUsage.h>
+
+#include <d3d12.h>
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Texture;
+
+class DX12_FW_API TransientResourceAllocator
+{
+public:
+    struct TextureDesc
+    {
+        std::wstring            Name;
+        D3D12_RESOURCE_DESC     ResourceDesc;
+        D3D12_CLEAR_VALUE       ClearValue;
+        bool                    HasClearValue;
+        TextureUsage            Usage;
+        // The state the texture is created in.
+        D3D12_RESOURCE_STATES   InitialState;
+        // Lifetime - [FirstPass, LastPass] in the execution order (inclusive).
+        uint32_t                FirstPass;
+        uint32_t                LastPass;
+    };
+
+    TransientResourceAllocator();
+    ~TransientResourceAllocator();
+
+    // Create the heap and the textures. Does nothing if the descriptions are the same as the last call.
+    void Allocate(const std::vector<TextureDesc>& descs);
+
+    // Release the textures and the heap (the GPU must not use them anymore).
+    void Release();
+
+    uint32_t                    GetNumTextures() const { return static_cast<uint32_t>(m_Textures.size()); }
+    std::shared_ptr<Texture>    GetTexture(uint32_t index) const;
+    // The texture shares memory with another one - an aliasing barrier is needed before its first use.
+    bool                        IsAliased(uint32_t index) const;
+
+    const AliasingPlanner::Plan& GetPlan() const { return m_Plan; }
+    // Number of times the heap was (re)created.
+    uint32_t                    GetNumHeapAllocations() const { return m_NumHeapAllocations; }
+
+private:
+    bool IsAllocated(const std::vector<TextureDesc>& descs) const;
+
+    Microsoft::WRL::ComPtr<ID3D12Heap>      m_Heap;
+    std::vector<TextureDesc>                m_Descs;
+    std::vector<std::shared_ptr<Texture>>   m_Textures;
+    AliasingPlanner::Plan                   m_Plan;
+    uint32_t                                m_NumHeapAllocations = 0;
+};
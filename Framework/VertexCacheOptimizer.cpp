@@ -0,0 +1,349 @@
+#include "VertexCacheOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+    XMFLOAT3 Subtract( const XMFLOAT3& a, const XMFLOAT3& b ) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    XMFLOAT3 Cross( const XMFLOAT3& a, const XMFLOAT3& b ) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    float Dot( const XMFLOAT3& a, const XMFLOAT3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    // FIFO cache with timestamps: a vertex stays in the cache until cacheSize misses followed its own.
+    class VertexCache
+    {
+    public:
+        VertexCache( uint32_t numVertices, uint32_t cacheSize )
+            : m_MissTime( numVertices, 0 )
+            , m_Time( cacheSize + 1 )
+            , m_CacheSize( cacheSize )
+        {}
+
+        // Misses since the last one of the vertex, > cacheSize when it's not in the cache.
+        uint32_t GetAge( uint32_t v ) const { return m_Time - m_MissTime[v]; }
+        bool Contains( uint32_t v ) const { return GetAge( v ) <= m_CacheSize; }
+
+        // @return 1 on a miss (a vertex shader invocation), else 0.
+        uint32_t Access( uint32_t v )
+        {
+            if ( Contains( v ) )
+                return 0;
+
+            m_MissTime[v] = m_Time++;
+            return 1;
+        }
+
+        void Flush() { m_Time += m_CacheSize + 1; }
+
+    private:
+        std::vector<uint32_t>   m_MissTime;
+        uint32_t                m_Time;
+        uint32_t                m_CacheSize;
+    };
+}
+
+void VertexCacheOptimizer::OptimizeVertexCache( std::vector<uint32_t>& indices, uint32_t numVertices, std::vector<uint32_t>* clusters, uint32_t cacheSize )
+{
+    const uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+    if ( clusters )
+    {
+        clusters->clear();
+    }
+    if ( numTriangles == 0 )
+        return;
+
+    // Vertex -> triangles (CSR), and the number of triangles of each vertex that are not emitted yet.
+    std::vector<uint32_t> triangleOffsets( numVertices + 1, 0 );
+    for ( uint32_t t = 0; t < numTriangles * 3; ++t )
+    {
+        ++triangleOffsets[indices[t] + 1];
+    }
+    for ( uint32_t v = 0; v < numVertices; ++v )
+    {
+        triangleOffsets[v + 1] += triangleOffsets[v];
+    }
+
+    std::vector<uint32_t> liveTriangles( numVertices );
+    for ( uint32_t v = 0; v < numVertices; ++v )
+    {
+        liveTriangles[v] = triangleOffsets[v + 1] - triangleOffsets[v];
+    }
+
+    std::vector<uint32_t> vertexTriangles( numTriangles * 3 );
+    {
+        std::vector<uint32_t> fill( triangleOffsets.begin(), triangleOffsets.end() - 1 );
+        for ( uint32_t t = 0; t < numTriangles; ++t )
+        {
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                vertexTriangles[fill[indices[t * 3 + corner]]++] = t;
+            }
+        }
+    }
+
+    std::vector<bool> isEmitted( numTriangles, false );
+    std::vector<uint32_t> deadEnds;     // The emitted vertices, most recent last.
+    std::vector<uint32_t> candidates;   // The vertices of the last fan.
+    std::vector<uint32_t> result;
+    result.reserve( indices.size() );
+    deadEnds.reserve( numTriangles * 3 );
+
+    VertexCache cache( numVertices, cacheSize );
+
+    // A recent vertex with triangles left, else the next one of the input order.
+    uint32_t cursor = 0;
+    auto skipDeadEnd = [&]()
+    {
+        while ( !deadEnds.empty() )
+        {
+            uint32_t v = deadEnds.back();
+            deadEnds.pop_back();
+            if ( liveTriangles[v] > 0 )
+                return v;
+        }
+        for ( ; cursor < numVertices; ++cursor )
+        {
+            if ( liveTriangles[cursor] > 0 )
+                return cursor;
+        }
+        return InvalidVertex;
+    };
+
+    uint32_t fanning = skipDeadEnd();
+    if ( clusters )
+    {
+        clusters->push_back( 0 );
+    }
+
+    while ( fanning != InvalidVertex )
+    {
+        // The fan: all the triangles left around the vertex.
+        candidates.clear();
+        for ( uint32_t i = triangleOffsets[fanning]; i < triangleOffsets[fanning + 1]; ++i )
+        {
+            uint32_t t = vertexTriangles[i];
+            if ( isEmitted[t] )
+                continue;
+            isEmitted[t] = true;
+
+            for ( uint32_t corner = 0; corner < 3; ++corner )
+            {
+                uint32_t v = indices[t * 3 + corner];
+                result.push_back( v );
+                deadEnds.push_back( v );
+                candidates.push_back( v );
+                --liveTriangles[v];
+                cache.Access( v );
+            }
+        }
+
+        // The oldest candidate that would still be in the cache after its own fan (at most 2 new vertices per
+        // triangle), else any candidate with triangles left.
+        uint32_t next = InvalidVertex;
+        int64_t bestPriority = -1;
+        for ( uint32_t v : candidates )
+        {
+            if ( liveTriangles[v] == 0 )
+                continue;
+
+            int64_t priority = 0;
+            if ( cache.GetAge( v ) + 2 * liveTriangles[v] <= cacheSize )
+            {
+                priority = cache.GetAge( v );
+            }
+            if ( priority > bestPriority )
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        // Dead end: the order jumps, a new cluster starts.
+        if ( next == InvalidVertex )
+        {
+            next = skipDeadEnd();
+            if ( clusters && next != InvalidVertex )
+            {
+                clusters->push_back( static_cast<uint32_t>( result.size() / 3 ) );
+            }
+        }
+
+        fanning = next;
+    }
+
+    indices.swap( result );
+}
+
+void VertexCacheOptimizer::OptimizeOverdraw( const XMFLOAT3* positions, std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+                                             float threshold, uint32_t cacheSize )
+{
+    const uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+    if ( numTriangles == 0 || clusters.empty() )
+        return;
+
+    uint32_t numVertices = 0;
+    for ( uint32_t t = 0; t < numTriangles * 3; ++t )
+    {
+        numVertices = std::max<uint32_t>( numVertices, indices[t] + 1 );
+    }
+
+    VertexCache cache( numVertices, cacheSize );
+    auto countMisses = [&]( uint32_t t )
+    {
+        return cache.Access( indices[t * 3 + 0] ) + cache.Access( indices[t * 3 + 1] ) + cache.Access( indices[t * 3 + 2] );
+    };
+
+    // Split each cluster where the ACMR since the last split gets within the threshold of the cluster's.
+    std::vector<uint32_t> subClusters;
+    for ( size_t c = 0; c < clusters.size(); ++c )
+    {
+        uint32_t start = clusters[c];
+        uint32_t end = ( c + 1 < clusters.size() ) ? clusters[c + 1] : numTriangles;
+        if ( start >= end )
+            continue;
+
+        cache.Flush();
+        uint32_t clusterMisses = 0;
+        for ( uint32_t t = start; t < end; ++t )
+        {
+            clusterMisses += countMisses( t );
+        }
+        float clusterThreshold = threshold * static_cast<float>( clusterMisses ) / static_cast<float>( end - start );
+
+        subClusters.push_back( start );
+        cache.Flush();
+        uint32_t misses = 0;
+        uint32_t count = 0;
+        for ( uint32_t t = start; t < end; ++t )
+        {
+            misses += countMisses( t );
+            ++count;
+
+            if ( t + 1 < end && static_cast<float>( misses ) <= clusterThreshold * static_cast<float>( count ) )
+            {
+                subClusters.push_back( t + 1 );
+                cache.Flush();
+                misses = 0;
+                count = 0;
+            }
+        }
+
+        // The tail never got there: merged into the previous sub-cluster.
+        if ( subClusters.back() != start && static_cast<float>( misses ) > clusterThreshold * static_cast<float>( count ) )
+        {
+            subClusters.pop_back();
+        }
+    }
+
+    // Mesh center: the mean of the triangle vertices.
+    XMFLOAT3 meshCenter( 0.0f, 0.0f, 0.0f );
+    for ( uint32_t t = 0; t < numTriangles * 3; ++t )
+    {
+        const XMFLOAT3& p = positions[indices[t]];
+        meshCenter = XMFLOAT3( meshCenter.x + p.x, meshCenter.y + p.y, meshCenter.z + p.z );
+    }
+    float scale = 1.0f / static_cast<float>( numTriangles * 3 );
+    meshCenter = XMFLOAT3( meshCenter.x * scale, meshCenter.y * scale, meshCenter.z * scale );
+
+    // How much a sub-cluster faces away from the center (clockwise front faces: cross(p1 - p0, p2 - p0) points out),
+    // with its area weighted centroid and mean normal.
+    struct SortKey
+    {
+        float       Key;
+        uint32_t    SubCluster;
+    };
+    std::vector<SortKey> keys( subClusters.size() );
+    for ( size_t c = 0; c < subClusters.size(); ++c )
+    {
+        uint32_t start = subClusters[c];
+        uint32_t end = ( c + 1 < subClusters.size() ) ? subClusters[c + 1] : numTriangles;
+
+        XMFLOAT3 centroid( 0.0f, 0.0f, 0.0f );
+        XMFLOAT3 normal( 0.0f, 0.0f, 0.0f );
+        float area = 0.0f;
+        for ( uint32_t t = start; t < end; ++t )
+        {
+            const XMFLOAT3& p0 = positions[indices[t * 3 + 0]];
+            const XMFLOAT3& p1 = positions[indices[t * 3 + 1]];
+            const XMFLOAT3& p2 = positions[indices[t * 3 + 2]];
+
+            XMFLOAT3 triangleNormal = Cross( Subtract( p1, p0 ), Subtract( p2, p0 ) );
+            float triangleArea = std::sqrt( Dot( triangleNormal, triangleNormal ) );
+
+            centroid.x += ( p0.x + p1.x + p2.x ) * triangleArea;
+            centroid.y += ( p0.y + p1.y + p2.y ) * triangleArea;
+            centroid.z += ( p0.z + p1.z + p2.z ) * triangleArea;
+            normal = XMFLOAT3( normal.x + triangleNormal.x, normal.y + triangleNormal.y, normal.z + triangleNormal.z );
+            area += triangleArea;
+        }
+
+        float normalLength = std::sqrt( Dot( normal, normal ) );
+        float key = 0.0f;
+        if ( area > 0.0f && normalLength > 0.0f )
+        {
+            float centroidScale = 1.0f / ( area * 3.0f );
+            centroid = XMFLOAT3( centroid.x * centroidScale, centroid.y * centroidScale, centroid.z * centroidScale );
+            key = Dot( Subtract( centroid, meshCenter ), normal ) / normalLength;
+        }
+        keys[c] = { key, static_cast<uint32_t>( c ) };
+    }
+
+    // Outer first, ties in the cache order.
+    std::sort( keys.begin(), keys.end(), []( const SortKey& a, const SortKey& b )
+    {
+        return a.Key > b.Key || ( a.Key == b.Key && a.SubCluster < b.SubCluster );
+    } );
+
+    std::vector<uint32_t> result;
+    result.reserve( numTriangles * 3 );
+    for ( const SortKey& key : keys )
+    {
+        uint32_t start = subClusters[key.SubCluster];
+        uint32_t end = ( key.SubCluster + 1 < subClusters.size() ) ? subClusters[key.SubCluster + 1] : numTriangles;
+        result.insert( result.end(), indices.begin() + start * 3, indices.begin() + end * 3 );
+    }
+
+    indices.swap( result );
+}
+
+std::vector<uint32_t> VertexCacheOptimizer::OptimizeVertexFetch( std::vector<uint32_t>& indices, uint32_t numVertices )
+{
+    std::vector<uint32_t> remap( numVertices, InvalidVertex );
+    uint32_t numUsedVertices = 0;
+    for ( uint32_t& index : indices )
+    {
+        if ( remap[index] == InvalidVertex )
+        {
+            remap[index] = numUsedVertices++;
+        }
+        index = remap[index];
+    }
+    return remap;
+}
+
+VertexCacheOptimizer::Statistics VertexCacheOptimizer::Analyze( const std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t cacheSize )
+{
+    Statistics statistics;
+    const uint32_t numTriangles = static_cast<uint32_t>( indices.size() / 3 );
+    if ( numTriangles == 0 )
+        return statistics;
+
+    VertexCache cache( numVertices, cacheSize );
+    std::vector<bool> isUsed( numVertices, false );
+    uint32_t numUsedVertices = 0;
+    for ( uint32_t t = 0; t < numTriangles * 3; ++t )
+    {
+        statistics.NumTransforms += cache.Access( indices[t] );
+        if ( !isUsed[indices[t]] )
+        {
+            isUsed[indices[t]] = true;
+            ++numUsedVertices;
+        }
+    }
+
+    statistics.Acmr = static_cast<float>( statistics.NumTransforms ) / static_cast<float>( numTriangles );
+    statistics.Atvr = static_cast<float>( statistics.NumTransforms ) / static_cast<float>( numUsedVertices );
+    return statistics;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+// Load time reordering of indexed triangle lists for the vertex processing of the GPU.
+// --
+// OptimizeVertexCache: Tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+// The triangles are emitted in fans around a vertex, the next fanning vertex is the one of the last fans that is still
+// in the cache and has triangles left. When there is none (a dead end), the order jumps: the jumps split the output
+// into clusters of good locality.
+// OptimizeOverdraw: the clusters (further split while the cache stays within a threshold of their ACMR) are sorted so
+// those that face away from the center of the mesh come first, they tend to occlude the others from most views.
+// OptimizeVertexFetch: the vertices in the order of their first use, so the vertex fetches walk the buffer linearly.
+// --
+// The cache is a FIFO of CacheSize vertices, the same model for the optimization and for Analyze:
+//   - ACMR (average cache miss ratio): vertex shader invocations per triangle, 3 without reuse, ~0.5 at best.
+//   - ATVR (average transform to vertex ratio): invocations per referenced vertex, 1 at best.
+// Deterministic, no shared state: the meshes can be processed in parallel.
+// No device is used, the optimizer can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class DX12_FW_API VertexCacheOptimizer
+{
+public:
+    static constexpr uint32_t CacheSize = 16;
+    static constexpr uint32_t InvalidVertex = UINT32_MAX;
+
+    struct Statistics
+    {
+        float       Acmr = 0.0f;
+        float       Atvr = 0.0f;
+        uint32_t    NumTransforms = 0;  // Cache misses.
+    };
+
+    // Reorder the triangles in place (each keeps its winding).
+    // @param clusters - Receives the first triangle of each cluster (the dead ends of the order), for OptimizeOverdraw.
+    static void OptimizeVertexCache( std::vector<uint32_t>& indices, uint32_t numVertices, std::vector<uint32_t>* clusters = nullptr,
+                                     uint32_t cacheSize = CacheSize );
+
+    // Reorder the clusters of OptimizeVertexCache in place.
+    // @param threshold - How much worse than its cluster's ACMR a sub-cluster can be (1.05 = 5%): > 1 gives more,
+    //                    smaller clusters to sort, at the cost of the vertex cache.
+    static void OptimizeOverdraw( const DirectX::XMFLOAT3* positions, std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+                                  float threshold = 1.05f, uint32_t cacheSize = CacheSize );
+
+    // Renumber the vertices in the order of their first use (in place in the indices), the unused ones are dropped.
+    // @return The new index of each vertex (InvalidVertex if unused), for RemapVertices.
+    static std::vector<uint32_t> OptimizeVertexFetch( std::vector<uint32_t>& indices, uint32_t numVertices );
+
+    template<typename T>
+    static std::vector<T> RemapVertices( const std::vector<T>& vertices, const std::vector<uint32_t>& remap )
+    {
+        uint32_t numUsedVertices = 0;
+        for ( uint32_t index : remap )
+        {
+            if ( index != InvalidVertex )
+                numUsedVertices = std::max<uint32_t>( numUsedVertices, index + 1 );
+        }
+
+        std::vector<T> result( numUsedVertices );
+        for ( size_t v = 0; v < vertices.size(); ++v )
+        {
+            if ( remap[v] != InvalidVertex )
+                result[remap[v]] = vertices[v];
+        }
+        return result;
+    }
+
+    static Statistics Analyze( const std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t cacheSize = CacheSize );
+};
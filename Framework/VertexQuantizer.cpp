@@ -0,0 +1,496 @@
+#include "VertexQuantizer.h"
+
+#include <intrin.h>
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <exception>
+
+using namespace DirectX;
+
+namespace
+{
+    // AVX, F16C, and the OS saves the YMM registers.
+    bool IsAVXAvailable()
+    {
+        int cpuInfo[4];
+        __cpuid( cpuInfo, 1 );
+
+        bool osxsave = ( cpuInfo[2] & ( 1 << 27 ) ) != 0;
+        bool avx = ( cpuInfo[2] & ( 1 << 28 ) ) != 0;
+        bool f16c = ( cpuInfo[2] & ( 1 << 29 ) ) != 0;
+        if ( !osxsave || !avx || !f16c )
+            return false;
+
+        unsigned long long xcr0 = _xgetbv( 0 );
+        return ( xcr0 & 0x6 ) == 0x6;
+    }
+
+    // Per axis: unorm = ( position - Offset ) * Factor, in [0, 65535].
+    struct EncodeConstants
+    {
+        float   Offset[3];
+        float   Factor[3];
+    };
+
+    template<typename T>
+    const T* At( const T* base, size_t stride, uint32_t index )
+    {
+        return reinterpret_cast<const T*>( reinterpret_cast<const uint8_t*>( base ) + stride * index );
+    }
+
+    // Same NaN behaviour as _mm_max_ps / _mm_min_ps (the second operand), so all the kernels agree.
+    float Max( float a, float b ) { return a > b ? a : b; }
+    float Min( float a, float b ) { return a < b ? a : b; }
+
+    uint32_t AsUint( float f ) { uint32_t u; std::memcpy( &u, &f, sizeof( u ) ); return u; }
+    float AsFloat( uint32_t u ) { float f; std::memcpy( &f, &u, sizeof( f ) ); return f; }
+
+    // Round to nearest even, as F16C (F. Giesen, "float->half variants"). NaN -> 0x7E00, too large -> infinity.
+    uint16_t FloatToHalf( float value )
+    {
+        const uint32_t f16Max = ( 127 + 16 ) << 23;
+        const uint32_t minNormal = ( 127 - 14 ) << 23;
+        const uint32_t subnormalMagic = ( ( 127 - 15 ) + ( 23 - 10 ) + 1 ) << 23;
+
+        uint32_t u = AsUint( value );
+        uint32_t sign = u & 0x80000000u;
+        u ^= sign;
+
+        uint32_t half;
+        if ( u >= f16Max )
+        {
+            half = u > 0x7F800000u ? 0x7E00 : 0x7C00;
+        }
+        else if ( u < minNormal )
+        {
+            // The float addition aligns the mantissa and rounds it.
+            half = AsUint( AsFloat( u ) + AsFloat( subnormalMagic ) ) - subnormalMagic;
+        }
+        else
+        {
+            uint32_t mantissaOdd = ( u >> 13 ) & 1;
+            u += 0xFFF - ( ( 127 - 15 ) << 23 );
+            u += mantissaOdd;
+            half = u >> 13;
+        }
+
+        return static_cast<uint16_t>( half | ( sign >> 16 ) );
+    }
+
+    float HalfToFloat( uint16_t half )
+    {
+        uint32_t sign = static_cast<uint32_t>( half & 0x8000 ) << 16;
+        uint32_t exponent = ( half >> 10 ) & 0x1F;
+        uint32_t mantissa = half & 0x3FF;
+
+        if ( exponent == 0 )
+        {
+            float f = std::ldexp( static_cast<float>( mantissa ), -24 );
+            return sign ? -f : f;
+        }
+        if ( exponent == 0x1F )
+            return AsFloat( sign | 0x7F800000u | ( mantissa << 13 ) );
+
+        return AsFloat( sign | ( ( exponent + 127 - 15 ) << 23 ) | ( mantissa << 13 ) );
+    }
+
+    void EncodeScalar( const VertexQuantizer::Source& source, uint32_t begin, uint32_t end, const EncodeConstants& constants,
+                       VertexQuantizer::QuantizedVertex* output )
+    {
+        for ( uint32_t i = begin; i < end; ++i )
+        {
+            const XMFLOAT3& p = *At( source.Positions, source.Stride, i );
+            const XMFLOAT3& n = *At( source.Normals, source.Stride, i );
+            const XMFLOAT2& t = *At( source.TexCoords, source.Stride, i );
+            VertexQuantizer::QuantizedVertex& vertex = output[i];
+
+            const float position[3] = { p.x, p.y, p.z };
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                float unorm = Min( Max( ( position[axis] - constants.Offset[axis] ) * constants.Factor[axis], 0.0f ), 65535.0f );
+                vertex.Position[axis] = static_cast<uint16_t>( std::lrint( unorm ) );
+            }
+            vertex.Position[3] = 0;
+
+            // Octahedral: onto the L1 unit sphere, the lower half folded over the upper one.
+            float l1 = Max( ( std::fabs( n.x ) + std::fabs( n.y ) ) + std::fabs( n.z ), FLT_MIN );
+            float x = n.x / l1;
+            float y = n.y / l1;
+            if ( !( n.z >= 0.0f ) )
+            {
+                float foldedX = ( 1.0f - std::fabs( y ) ) * ( x >= 0.0f ? 1.0f : -1.0f );
+                float foldedY = ( 1.0f - std::fabs( x ) ) * ( y >= 0.0f ? 1.0f : -1.0f );
+                x = foldedX;
+                y = foldedY;
+            }
+            vertex.Normal[0] = static_cast<int16_t>( std::lrint( Min( Max( x, -1.0f ), 1.0f ) * 32767.0f ) );
+            vertex.Normal[1] = static_cast<int16_t>( std::lrint( Min( Max( y, -1.0f ), 1.0f ) * 32767.0f ) );
+
+            vertex.TexCoord[0] = FloatToHalf( t.x );
+            vertex.TexCoord[1] = FloatToHalf( t.y );
+        }
+    }
+
+    // --------------------------------------------------------------------------------
+    //                                  SSE / AVX
+    // --------------------------------------------------------------------------------
+
+    __m128 Load3( const XMFLOAT3* p )
+    {
+        __m128 xy = _mm_castpd_ps( _mm_load_sd( reinterpret_cast<const double*>( p ) ) );
+        __m128 z = _mm_load_ss( &p->z );
+        return _mm_movelh_ps( xy, z );
+    }
+
+    __m128 Load2( const XMFLOAT2* p )
+    {
+        return _mm_castpd_ps( _mm_load_sd( reinterpret_cast<const double*>( p ) ) );
+    }
+
+    // 4 vertices from i, to structure of arrays.
+    void Load4( const XMFLOAT3* base, size_t stride, uint32_t i, __m128& x, __m128& y, __m128& z )
+    {
+        __m128 r0 = Load3( At( base, stride, i + 0 ) );
+        __m128 r1 = Load3( At( base, stride, i + 1 ) );
+        __m128 r2 = Load3( At( base, stride, i + 2 ) );
+        __m128 r3 = Load3( At( base, stride, i + 3 ) );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        x = r0;
+        y = r1;
+        z = r2;
+    }
+
+    void Load4( const XMFLOAT2* base, size_t stride, uint32_t i, __m128& u, __m128& v )
+    {
+        __m128 uv01 = _mm_unpacklo_ps( Load2( At( base, stride, i + 0 ) ), Load2( At( base, stride, i + 1 ) ) );    // u0 u1 v0 v1
+        __m128 uv23 = _mm_unpacklo_ps( Load2( At( base, stride, i + 2 ) ), Load2( At( base, stride, i + 3 ) ) );    // u2 u3 v2 v3
+        u = _mm_movelh_ps( uv01, uv23 );
+        v = _mm_movehl_ps( uv23, uv01 );
+    }
+
+    __m128 Select( __m128 mask, __m128 a, __m128 b )
+    {
+        return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+    }
+
+    __m256 Select( __m256 mask, __m256 a, __m256 b )
+    {
+        return _mm256_or_ps( _mm256_and_ps( mask, a ), _mm256_andnot_ps( mask, b ) );
+    }
+
+    // FloatToHalf, 4 lanes (the half in the low 16 bits).
+    __m128i FloatToHalfSSE( __m128 value )
+    {
+        const __m128 signMask = _mm_set1_ps( -0.0f );
+        const __m128i f16Max = _mm_set1_epi32( ( 127 + 16 ) << 23 );
+        const __m128i minNormal = _mm_set1_epi32( ( 127 - 14 ) << 23 );
+        const __m128i subnormalMagic = _mm_set1_epi32( ( ( 127 - 15 ) + ( 23 - 10 ) + 1 ) << 23 );
+        const __m128i normalBias = _mm_set1_epi32( 0xFFF - ( ( 127 - 15 ) << 23 ) );
+
+        __m128 sign = _mm_and_ps( value, signMask );
+        __m128 absolute = _mm_andnot_ps( signMask, value );
+        __m128i u = _mm_castps_si128( absolute );
+
+        __m128i isNaN = _mm_castps_si128( _mm_cmpunord_ps( absolute, absolute ) );
+        __m128i special = _mm_or_si128( _mm_and_si128( isNaN, _mm_set1_epi32( 0x200 ) ), _mm_set1_epi32( 0x7C00 ) );
+
+        __m128i subnormal = _mm_sub_epi32( _mm_castps_si128( _mm_add_ps( absolute, _mm_castsi128_ps( subnormalMagic ) ) ), subnormalMagic );
+
+        __m128i mantissaOdd = _mm_srai_epi32( _mm_slli_epi32( u, 31 - 13 ), 31 );   // -1 if odd.
+        __m128i normal = _mm_srli_epi32( _mm_sub_epi32( _mm_add_epi32( u, normalBias ), mantissaOdd ), 13 );
+
+        __m128i isSubnormal = _mm_cmpgt_epi32( minNormal, u );
+        __m128i isRegular = _mm_cmpgt_epi32( f16Max, u );
+        __m128i half = _mm_or_si128( _mm_and_si128( isSubnormal, subnormal ), _mm_andnot_si128( isSubnormal, normal ) );
+        half = _mm_or_si128( _mm_and_si128( isRegular, half ), _mm_andnot_si128( isRegular, special ) );
+
+        return _mm_or_si128( half, _mm_srli_epi32( _mm_castps_si128( sign ), 16 ) );
+    }
+
+    // 4 vertices, each component in a 32 bit lane (uv: u | v << 16). The transpose writes a vertex per register.
+    void Store4( __m128i px, __m128i py, __m128i pz, __m128i nx, __m128i ny, __m128i uv, VertexQuantizer::QuantizedVertex* output )
+    {
+        __m128 xy = _mm_castsi128_ps( _mm_or_si128( px, _mm_slli_epi32( py, 16 ) ) );
+        __m128 zw = _mm_castsi128_ps( pz );
+        __m128 normal = _mm_castsi128_ps( _mm_or_si128( _mm_and_si128( nx, _mm_set1_epi32( 0xFFFF ) ), _mm_slli_epi32( ny, 16 ) ) );
+        __m128 texCoord = _mm_castsi128_ps( uv );
+        _MM_TRANSPOSE4_PS( xy, zw, normal, texCoord );
+
+        float* destination = reinterpret_cast<float*>( output );
+        _mm_storeu_ps( destination + 0, xy );
+        _mm_storeu_ps( destination + 4, zw );
+        _mm_storeu_ps( destination + 8, normal );
+        _mm_storeu_ps( destination + 12, texCoord );
+    }
+
+    uint32_t EncodeSSE( const VertexQuantizer::Source& source, uint32_t numVertices, const EncodeConstants& constants,
+                        VertexQuantizer::QuantizedVertex* output )
+    {
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps( 1.0f );
+        const __m128 minusOne = _mm_set1_ps( -1.0f );
+        const __m128 unormMax = _mm_set1_ps( 65535.0f );
+        const __m128 snormMax = _mm_set1_ps( 32767.0f );
+        const __m128 signMask = _mm_set1_ps( -0.0f );
+        const __m128 minL1 = _mm_set1_ps( FLT_MIN );
+
+        __m128 offset[3], factor[3];
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            offset[axis] = _mm_set1_ps( constants.Offset[axis] );
+            factor[axis] = _mm_set1_ps( constants.Factor[axis] );
+        }
+
+        uint32_t end = numVertices & ~3u;
+        for ( uint32_t i = 0; i < end; i += 4 )
+        {
+            __m128 position[3], nx, ny, nz, u, v;
+            Load4( source.Positions, source.Stride, i, position[0], position[1], position[2] );
+            Load4( source.Normals, source.Stride, i, nx, ny, nz );
+            Load4( source.TexCoords, source.Stride, i, u, v );
+
+            __m128i unorm[3];
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                __m128 scaled = _mm_mul_ps( _mm_sub_ps( position[axis], offset[axis] ), factor[axis] );
+                unorm[axis] = _mm_cvtps_epi32( _mm_min_ps( _mm_max_ps( scaled, zero ), unormMax ) );
+            }
+
+            __m128 l1 = _mm_add_ps( _mm_add_ps( _mm_andnot_ps( signMask, nx ), _mm_andnot_ps( signMask, ny ) ), _mm_andnot_ps( signMask, nz ) );
+            l1 = _mm_max_ps( l1, minL1 );
+            __m128 x = _mm_div_ps( nx, l1 );
+            __m128 y = _mm_div_ps( ny, l1 );
+            __m128 foldedX = _mm_mul_ps( _mm_sub_ps( one, _mm_andnot_ps( signMask, y ) ), Select( _mm_cmpge_ps( x, zero ), one, minusOne ) );
+            __m128 foldedY = _mm_mul_ps( _mm_sub_ps( one, _mm_andnot_ps( signMask, x ) ), Select( _mm_cmpge_ps( y, zero ), one, minusOne ) );
+            __m128 upper = _mm_cmpge_ps( nz, zero );
+            x = Select( upper, x, foldedX );
+            y = Select( upper, y, foldedY );
+            __m128i snormX = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( x, minusOne ), one ), snormMax ) );
+            __m128i snormY = _mm_cvtps_epi32( _mm_mul_ps( _mm_min_ps( _mm_max_ps( y, minusOne ), one ), snormMax ) );
+
+            __m128i uv = _mm_or_si128( FloatToHalfSSE( u ), _mm_slli_epi32( FloatToHalfSSE( v ), 16 ) );
+
+            Store4( unorm[0], unorm[1], unorm[2], snormX, snormY, uv, output + i );
+        }
+
+        return end;
+    }
+
+    __m256 Load8( __m128 low, __m128 high )
+    {
+        return _mm256_insertf128_ps( _mm256_castps128_ps256( low ), high, 1 );
+    }
+
+    // The integer operations are SSE2 (AVX2 is not required), on the 2 halves.
+    uint32_t EncodeAVX( const VertexQuantizer::Source& source, uint32_t numVertices, const EncodeConstants& constants,
+                        VertexQuantizer::QuantizedVertex* output )
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps( 1.0f );
+        const __m256 minusOne = _mm256_set1_ps( -1.0f );
+        const __m256 unormMax = _mm256_set1_ps( 65535.0f );
+        const __m256 snormMax = _mm256_set1_ps( 32767.0f );
+        const __m256 signMask = _mm256_set1_ps( -0.0f );
+        const __m256 minL1 = _mm256_set1_ps( FLT_MIN );
+
+        __m256 offset[3], factor[3];
+        for ( int axis = 0; axis < 3; ++axis )
+        {
+            offset[axis] = _mm256_set1_ps( constants.Offset[axis] );
+            factor[axis] = _mm256_set1_ps( constants.Factor[axis] );
+        }
+
+        uint32_t end = numVertices & ~7u;
+        for ( uint32_t i = 0; i < end; i += 8 )
+        {
+            __m128 p[2][3], n[2][3], t[2][2];
+            for ( uint32_t half = 0; half < 2; ++half )
+            {
+                Load4( source.Positions, source.Stride, i + half * 4, p[half][0], p[half][1], p[half][2] );
+                Load4( source.Normals, source.Stride, i + half * 4, n[half][0], n[half][1], n[half][2] );
+                Load4( source.TexCoords, source.Stride, i + half * 4, t[half][0], t[half][1] );
+            }
+
+            __m256i unorm[3];
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                __m256 scaled = _mm256_mul_ps( _mm256_sub_ps( Load8( p[0][axis], p[1][axis] ), offset[axis] ), factor[axis] );
+                unorm[axis] = _mm256_cvtps_epi32( _mm256_min_ps( _mm256_max_ps( scaled, zero ), unormMax ) );
+            }
+
+            __m256 nx = Load8( n[0][0], n[1][0] );
+            __m256 ny = Load8( n[0][1], n[1][1] );
+            __m256 nz = Load8( n[0][2], n[1][2] );
+            __m256 l1 = _mm256_add_ps( _mm256_add_ps( _mm256_andnot_ps( signMask, nx ), _mm256_andnot_ps( signMask, ny ) ), _mm256_andnot_ps( signMask, nz ) );
+            l1 = _mm256_max_ps( l1, minL1 );
+            __m256 x = _mm256_div_ps( nx, l1 );
+            __m256 y = _mm256_div_ps( ny, l1 );
+            __m256 foldedX = _mm256_mul_ps( _mm256_sub_ps( one, _mm256_andnot_ps( signMask, y ) ),
+                                            Select( _mm256_cmp_ps( x, zero, _CMP_GE_OQ ), one, minusOne ) );
+            __m256 foldedY = _mm256_mul_ps( _mm256_sub_ps( one, _mm256_andnot_ps( signMask, x ) ),
+                                            Select( _mm256_cmp_ps( y, zero, _CMP_GE_OQ ), one, minusOne ) );
+            __m256 upper = _mm256_cmp_ps( nz, zero, _CMP_GE_OQ );
+            x = Select( upper, x, foldedX );
+            y = Select( upper, y, foldedY );
+            __m256i snormX = _mm256_cvtps_epi32( _mm256_mul_ps( _mm256_min_ps( _mm256_max_ps( x, minusOne ), one ), snormMax ) );
+            __m256i snormY = _mm256_cvtps_epi32( _mm256_mul_ps( _mm256_min_ps( _mm256_max_ps( y, minusOne ), one ), snormMax ) );
+
+            // 8 halves each, interleaved to u | v << 16 per vertex.
+            __m128i halfU = _mm256_cvtps_ph( Load8( t[0][0], t[1][0] ), _MM_FROUND_TO_NEAREST_INT );
+            __m128i halfV = _mm256_cvtps_ph( Load8( t[0][1], t[1][1] ), _MM_FROUND_TO_NEAREST_INT );
+            __m128i uv[2] = { _mm_unpacklo_epi16( halfU, halfV ), _mm_unpackhi_epi16( halfU, halfV ) };
+
+            Store4( _mm256_castsi256_si128( unorm[0] ), _mm256_castsi256_si128( unorm[1] ), _mm256_castsi256_si128( unorm[2] ),
+                    _mm256_castsi256_si128( snormX ), _mm256_castsi256_si128( snormY ), uv[0], output + i );
+            Store4( _mm256_extractf128_si256( unorm[0], 1 ), _mm256_extractf128_si256( unorm[1], 1 ), _mm256_extractf128_si256( unorm[2], 1 ),
+                    _mm256_extractf128_si256( snormX, 1 ), _mm256_extractf128_si256( snormY, 1 ), uv[1], output + i + 4 );
+        }
+
+        // The upper halves of the YMM registers are dirty, avoid the SSE transition penalty of the caller.
+        _mm256_zeroupper();
+
+        return end;
+    }
+}
+
+VertexQuantizer::InstructionSet VertexQuantizer::GetBestInstructionSet()
+{
+    static const InstructionSet s_BestInstructionSet = IsAVXAvailable() ? InstructionSet::AVX : InstructionSet::SSE;
+    return s_BestInstructionSet;
+}
+
+bool VertexQuantizer::IsSupported( InstructionSet instructionSet )
+{
+    switch ( instructionSet )
+    {
+    case InstructionSet::Scalar:
+    case InstructionSet::SSE:   // Always there on x64.
+        return true;
+    case InstructionSet::AVX:
+        return GetBestInstructionSet() == InstructionSet::AVX;
+    default:
+        return false;
+    }
+}
+
+const char* VertexQuantizer::GetInstructionSetName( InstructionSet instructionSet )
+{
+    switch ( instructionSet )
+    {
+    case InstructionSet::Scalar:
+        return "Scalar";
+    case InstructionSet::SSE:
+        return "SSE";
+    case InstructionSet::AVX:
+        return "AVX + F16C";
+    default:
+        return "Unknown";
+    }
+}
+
+VertexQuantizer::Dequantization VertexQuantizer::ComputeDequantization( const XMFLOAT3& minimum, const XMFLOAT3& maximum )
+{
+    Dequantization dequantization = {};
+    dequantization.PositionOffset = minimum;
+    dequantization.PositionScale = XMFLOAT3( maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z );
+    return dequantization;
+}
+
+void VertexQuantizer::Encode( const Source& source, uint32_t numVertices, const Dequantization& dequantization, QuantizedVertex* output )
+{
+    Encode( source, numVertices, dequantization, output, GetBestInstructionSet() );
+}
+
+void VertexQuantizer::Encode( const Source& source, uint32_t numVertices, const Dequantization& dequantization, QuantizedVertex* output,
+                              InstructionSet instructionSet )
+{
+    if ( !IsSupported( instructionSet ) )
+    {
+        throw std::exception( "VertexQuantizer: the instruction set is not supported by this CPU." );
+    }
+
+    // A flat box (eg. a plane) has its axis at the offset.
+    const float scale[3] = { dequantization.PositionScale.x, dequantization.PositionScale.y, dequantization.PositionScale.z };
+    EncodeConstants constants = { { dequantization.PositionOffset.x, dequantization.PositionOffset.y, dequantization.PositionOffset.z } };
+    for ( int axis = 0; axis < 3; ++axis )
+        constants.Factor[axis] = scale[axis] > 0.0f ? 65535.0f / scale[axis] : 0.0f;
+
+    // The vectorized kernels leave the remainder to the scalar one.
+    uint32_t begin = 0;
+    switch ( instructionSet )
+    {
+    case InstructionSet::SSE:
+        begin = EncodeSSE( source, numVertices, constants, output );
+        break;
+    case InstructionSet::AVX:
+        begin = EncodeAVX( source, numVertices, constants, output );
+        break;
+    default:
+        break;
+    }
+
+    EncodeScalar( source, begin, numVertices, constants, output );
+}
+
+void VertexQuantizer::Decode( const QuantizedVertex& vertex, const Dequantization& dequantization, XMFLOAT3& position, XMFLOAT3& normal,
+                              XMFLOAT2& texCoord )
+{
+    // The input assembler: UNORM = q / 65535, SNORM = max(q / 32767, -1).
+    const XMFLOAT3& offset = dequantization.PositionOffset;
+    const XMFLOAT3& scale = dequantization.PositionScale;
+    position.x = offset.x + ( vertex.Position[0] / 65535.0f ) * scale.x;
+    position.y = offset.y + ( vertex.Position[1] / 65535.0f ) * scale.y;
+    position.z = offset.z + ( vertex.Position[2] / 65535.0f ) * scale.z;
+
+    // The vertex shader: unfold the lower half, then normalize.
+    float x = std::max( vertex.Normal[0] / 32767.0f, -1.0f );
+    float y = std::max( vertex.Normal[1] / 32767.0f, -1.0f );
+    float z = 1.0f - std::fabs( x ) - std::fabs( y );
+    float t = std::min( std::max( -z, 0.0f ), 1.0f );
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+    float length = std::sqrt( x * x + y * y + z * z );
+    normal = XMFLOAT3( x / length, y / length, z / length );
+
+    texCoord = XMFLOAT2( HalfToFloat( vertex.TexCoord[0] ), HalfToFloat( vertex.TexCoord[1] ) );
+}
+
+VertexQuantizer::Error VertexQuantizer::MeasureError( const Source& source, uint32_t numVertices, const Dequantization& dequantization,
+                                                      const QuantizedVertex* vertices )
+{
+    const float radiansToDegrees = 180.0f / 3.14159265f;
+
+    Error error;
+    for ( uint32_t i = 0; i < numVertices; ++i )
+    {
+        XMFLOAT3 position, normal;
+        XMFLOAT2 texCoord;
+        Decode( vertices[i], dequantization, position, normal, texCoord );
+
+        const XMFLOAT3& p = *At( source.Positions, source.Stride, i );
+        const XMFLOAT3& n = *At( source.Normals, source.Stride, i );
+        const XMFLOAT2& t = *At( source.TexCoords, source.Stride, i );
+
+        float dx = position.x - p.x;
+        float dy = position.y - p.y;
+        float dz = position.z - p.z;
+        error.Position = std::max( error.Position, std::sqrt( dx * dx + dy * dy + dz * dz ) );
+
+        // A degenerate source normal has no direction to compare.
+        float length = std::sqrt( n.x * n.x + n.y * n.y + n.z * n.z );
+        if ( length > 0.0f )
+        {
+            float cosine = ( n.x * normal.x + n.y * normal.y + n.z * normal.z ) / length;
+            float angle = std::acos( std::min( std::max( cosine, -1.0f ), 1.0f ) ) * radiansToDegrees;
+            error.NormalDegrees = std::max( error.NormalDegrees, angle );
+        }
+
+        error.TexCoord = std::max( error.TexCoord, std::max( std::fabs( texCoord.x - t.x ), std::fabs( texCoord.y - t.y ) ) );
+    }
+
+    return error;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+// Encoding of the float vertices (position, normal, texture coordinate) into a 16 byte layout, half of
+// VertexPositionNormalTexture, for the passes that are bound by the vertex fetch.
+// --
+// QuantizedVertex, with the input layout formats (decoded by the input assembler, then by the vertex shader):
+//   - Position: R16G16B16A16_UNORM, in the box of the mesh (Dequantization, w unused).
+//   - Normal:   R16G16_SNORM, octahedral (the unit sphere folded onto a square, see OctahedralEncode in GBuffer_PS.hlsl).
+//   - TexCoord: R16G16_FLOAT, rounded to nearest even.
+// The encoding is done 1 (scalar), 4 (SSE) or 8 (AVX + F16C) vertices at a time, the instruction set is picked at run
+// time. The kernels do the same float operations in the same order: every instruction set gives the same bits.
+// Decode is the vertex shader decoding, MeasureError reports the largest errors of a mesh.
+// No device is used, the quantizer can run headless.
+
+#include <Framework/3RD_Party/Defines.h>
+
+#include <DirectXMath.h>
+
+#include <cstddef>
+#include <cstdint>
+
+class DX12_FW_API VertexQuantizer
+{
+public:
+    enum class InstructionSet
+    {
+        Scalar,     // 1 vertex per iteration.
+        SSE,        // 4 vertices per iteration (the half floats in software).
+        AVX,        // 8 vertices per iteration (the half floats with F16C).
+    };
+
+    // The widest instruction set supported by the CPU (and the OS, for AVX).
+    static InstructionSet GetBestInstructionSet();
+    static bool IsSupported( InstructionSet instructionSet );
+    static const char* GetInstructionSetName( InstructionSet instructionSet );
+
+    struct QuantizedVertex
+    {
+        uint16_t    Position[4];
+        int16_t     Normal[2];
+        uint16_t    TexCoord[2];
+    };
+
+    // position = PositionOffset + unorm * PositionScale, the constants of the vertex shader.
+    struct Dequantization
+    {
+        DirectX::XMFLOAT3   PositionOffset;
+        float               _Padding0;
+        DirectX::XMFLOAT3   PositionScale;
+        float               _Padding1;
+    };
+
+    // The vertices to encode, of any layout: Stride bytes from a vertex to the next one, for each of the 3 pointers.
+    struct Source
+    {
+        const DirectX::XMFLOAT3*    Positions;
+        const DirectX::XMFLOAT3*    Normals;
+        const DirectX::XMFLOAT2*    TexCoords;
+        size_t                      Stride;
+    };
+
+    // The largest decoding errors of a mesh.
+    struct Error
+    {
+        float   Position = 0.0f;        // Distance, in the units of the positions.
+        float   NormalDegrees = 0.0f;   // Angle to the source normal.
+        float   TexCoord = 0.0f;        // Per component.
+    };
+
+    // The box of the positions (minimum / maximum corners).
+    static Dequantization ComputeDequantization( const DirectX::XMFLOAT3& minimum, const DirectX::XMFLOAT3& maximum );
+
+    // The positions out of the box are clamped to it.
+    static void Encode( const Source& source, uint32_t numVertices, const Dequantization& dequantization, QuantizedVertex* output );
+    static void Encode( const Source& source, uint32_t numVertices, const Dequantization& dequantization, QuantizedVertex* output,
+                        InstructionSet instructionSet );
+
+    // The normal is normalized.
+    static void Decode( const QuantizedVertex& vertex, const Dequantization& dequantization, DirectX::XMFLOAT3& position,
+                        DirectX::XMFLOAT3& normal, DirectX::XMFLOAT2& texCoord );
+
+    static Error MeasureError( const Source& source, uint32_t numVertices, const Dequantization& dequantization, const QuantizedVertex* vertices );
+};
+
+static_assert( sizeof( VertexQuantizer::QuantizedVertex ) == 16, "VertexQuantizer::QuantizedVertex must match the input layout." );
+static_assert( sizeof( VertexQuantizer::Dequantization ) == 32, "VertexQuantizer::Dequantization must match the shader constants." );
@@ -126,6 +126,10 @@ UINT32 Window::Present(const Texture& texture)
 	commandList->TransitionBarrier(backBuffer, D3D12_RESOURCE_STATE_PRESENT);
 	commandQueue->ExecuteCommandList(commandList);
 
+	// Present is a sync point for the deferred submission mode:
+	// all the command lists gathered during the frame go to the GPU in a single ExecuteCommandLists.
+	commandQueue->FlushSubmissions();
+
 	// If tearing is supported, it is recommended to always use the 
 	// DXGI_PRESENT_ALLOW_TEARING flag when presenting with a sync interval of 0.
 	// The requirements for using the DXGI_PRESENT_ALLOW_TEARING flag when 
@@ -145,6 +149,7 @@ UINT32 Window::Present(const Texture& texture)
 
 	m_FenceValues[m_CurrentBackBufferIndex] = commandQueue->Signal();
 	m_FrameValues[m_CurrentBackBufferIndex] = Application::Get().GetFrameCount();
+	commandQueue->EndFrameStats();
 	
 	// Updating current back buffer index:
 	// When using the DXGI_SWAP_EFFECT_FLIP_DISCARD flip model, the order of 
@@ -155,6 +160,7 @@ UINT32 Window::Present(const Texture& texture)
 	// --
 	// Buffer 3 frames in flight - by waiting not for the previous frame, but a frame before the prev one.
 	commandQueue->WaitForFenceValue(m_FenceValues[m_CurrentBackBufferIndex]);
+	Application::Get().SetCompletedFrame(m_FrameValues[m_CurrentBackBufferIndex]);
 
 	return m_CurrentBackBufferIndex;
 }
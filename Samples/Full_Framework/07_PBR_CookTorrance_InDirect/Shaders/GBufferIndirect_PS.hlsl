@@ -0,0 +1,94 @@
+// G-Buffer pixel shader of the ExecuteIndirect path (see GBuffer_PS.hlsl for the regular path).
+// The whole model is drawn by a single ExecuteIndirect: the material and the textures of a draw
+// are fetched with the draw index that the command signature writes into DrawCB.
+
+struct GBufferPSInput
+{
+    float3 NormalWS   : NORMAL;
+    float2 TexCoord   : TEXCOORD;
+};
+
+struct GBufferOutput
+{
+    float4 RT0 : SV_Target0; // Albedo (RGB) + AO placeholder (A=1)
+    float4 RT1 : SV_Target1; // Oct-encoded world-space normal (RG), BA unused
+    float4 RT2 : SV_Target2; // Roughness (R) + Metalness (G) + EmissiveMask (B)
+};
+
+struct Material
+{
+    float4 Emissive;
+    float4 Ambient;
+    float4 Diffuse;
+    float4 Specular;
+    float Roughness;    // 0 = smooth, 1 = rough
+    float Metalness;    // 0 = dielectric, 1 = metal
+    float EmissiveMask; // 0 = non-emissive, 1 = emissive
+    float _Padding;
+    // Total:              16 * 5 = 80 bytes
+};
+
+struct DrawData
+{
+    Material Material;
+    uint DiffuseTextureIndex;
+    uint RoughnessTextureIndex;
+    uint MetalnessTextureIndex;
+    uint _Padding;
+    // Total:              80 + 16 = 96 bytes
+};
+
+struct DrawConstants
+{
+    uint DrawIndex;
+};
+
+ConstantBuffer<DrawConstants>   DrawCB                  : register(b1);
+
+StructuredBuffer<DrawData>      DrawDataSB              : register(t0, space2);
+// The unique textures of the model, indexed by DrawData.
+Texture2D                       Textures[]              : register(t0, space1);
+
+SamplerState                    LinearRepeatSampler     : register(s0);
+
+// Same as GBuffer_PS.hlsl: packs a normalized unit sphere normal (3d in [-1,1]) into two values (2d in [0,1]).
+float2 OctahedralEncode(float3 n)
+{
+    n /= (abs(n.x) + abs(n.y) + abs(n.z));
+
+    float2 oct;
+    oct.x = n.z >= 0.0 ? n.x : (1.0 - abs(n.y)) * (n.x >= 0.0 ? 1.0 : -1.0);
+    oct.y = n.z >= 0.0 ? n.y : (1.0 - abs(n.x)) * (n.y >= 0.0 ? 1.0 : -1.0);
+    return oct * 0.5 + 0.5;
+}
+
+
+GBufferOutput main(GBufferPSInput IN)
+{
+    GBufferOutput output;
+
+    // The draw index is the same for the whole draw, so the texture indices are uniform.
+    DrawData drawData = DrawDataSB[DrawCB.DrawIndex];
+    Material material = drawData.Material;
+
+    float4 diffuse = Textures[drawData.DiffuseTextureIndex].Sample(LinearRepeatSampler, IN.TexCoord);
+
+    // Alpha test
+    clip(diffuse.a - 0.1f);
+
+    float3 albedo    = (material.Diffuse * diffuse).rgb;
+    float3 normalWS  = normalize(IN.NormalWS);
+    float2 octNormal = OctahedralEncode(normalWS);
+
+    // ORM (Occlusion, Roughness, Metalness) map in the metalness texture slot.
+    float3 orm = Textures[drawData.MetalnessTextureIndex].Sample(LinearRepeatSampler, IN.TexCoord).rgb;
+
+    float roughness = orm.g * material.Roughness; // G = roughness
+    float metalness = orm.b * material.Metalness; // B = metalness
+
+    output.RT0 = float4(albedo, 1.0); // AO=1 placeholder
+    output.RT1 = float4(octNormal, 0.0, 0.0);
+    output.RT2 = float4(roughness, metalness, material.EmissiveMask, 0.0);
+
+    return output;
+}
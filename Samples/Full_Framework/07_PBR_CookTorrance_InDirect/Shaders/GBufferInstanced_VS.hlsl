@@ -0,0 +1,52 @@
+// G-Buffer vertex shader of the instanced draws (see GBuffer_VS.hlsl for a single draw).
+// A batch draws the instances [FirstInstance, FirstInstance + instance count) of the instance buffer: SV_InstanceID
+// starts at 0 for every draw, so the first instance of the batch is a root constant. Same output as GBuffer_VS.hlsl,
+// the pixel shader is GBuffer_PS.hlsl.
+
+struct InstancedMat
+{
+    matrix ViewProjectionMatrix;
+};
+
+struct DrawConstants
+{
+    uint FirstInstance;
+};
+
+struct InstanceData
+{
+    matrix ModelMatrix;
+    matrix InverseTransposeModelMatrix;
+};
+
+ConstantBuffer<InstancedMat> MatCB : register(b0);
+ConstantBuffer<DrawConstants> DrawCB : register(b1);
+StructuredBuffer<InstanceData> Instances : register(t0, space2);
+
+struct VertexPositionNormalTexture
+{
+    float3 Position : POSITION;
+    float3 Normal   : NORMAL;
+    float2 TexCoord : TEXCOORD;
+};
+
+struct GBufferVSOutput
+{
+    float3 NormalWS   : NORMAL;
+    float2 TexCoord   : TEXCOORD;
+    float4 Position   : SV_Position;
+};
+
+GBufferVSOutput main(VertexPositionNormalTexture IN, uint InstanceID : SV_InstanceID)
+{
+    InstanceData instance = Instances[DrawCB.FirstInstance + InstanceID];
+
+    GBufferVSOutput OUT;
+
+    float4 positionWS = mul(instance.ModelMatrix, float4(IN.Position, 1.0f));
+    OUT.Position = mul(MatCB.ViewProjectionMatrix, positionWS);
+    OUT.NormalWS = mul((float3x3)instance.InverseTransposeModelMatrix, IN.Normal);
+    OUT.TexCoord = IN.TexCoord;
+
+    return OUT;
+}
@@ -0,0 +1,60 @@
+// G-Buffer vertex shader of the quantized vertices (see VertexQuantizer.h), 16 bytes instead of 32.
+// The input assembler expands the formats to floats: the position is a UNORM in the box of the mesh part, the normal
+// an octahedral SNORM, the texture coordinate a half. Same output as GBuffer_VS.hlsl, the pixel shader is GBuffer_PS.hlsl.
+
+struct Mat
+{
+    matrix ModelMatrix;
+    matrix ModelViewMatrix;
+    matrix InverseTransposeModelMatrix;
+    matrix ModelViewProjectionMatrix;
+};
+
+// position = PositionOffset + unorm * PositionScale (VertexQuantizer::Dequantization)
+struct Dequantization
+{
+    float3 PositionOffset;
+    float  _Padding0;
+    float3 PositionScale;
+    float  _Padding1;
+};
+
+ConstantBuffer<Mat> MatCB : register(b0);
+ConstantBuffer<Dequantization> DequantizationCB : register(b1);
+
+struct VertexQuantized
+{
+    float4 Position : POSITION;     // R16G16B16A16_UNORM, w unused
+    float2 Normal   : NORMAL;       // R16G16_SNORM, octahedral
+    float2 TexCoord : TEXCOORD;     // R16G16_FLOAT
+};
+
+struct GBufferVSOutput
+{
+    float3 NormalWS   : NORMAL;
+    float2 TexCoord   : TEXCOORD;
+    float4 Position   : SV_Position;
+};
+
+// The octahedron in [-1, 1]^2 back to the unit sphere (the lower half was folded over the corners).
+float3 OctahedralDecode(float2 f)
+{
+    float3 n = float3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = saturate(-n.z);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+GBufferVSOutput main(VertexQuantized IN)
+{
+    GBufferVSOutput OUT;
+
+    float3 position = DequantizationCB.PositionOffset + IN.Position.xyz * DequantizationCB.PositionScale;
+
+    OUT.Position = mul(MatCB.ModelViewProjectionMatrix, float4(position, 1.0f));
+    OUT.NormalWS = mul((float3x3)MatCB.InverseTransposeModelMatrix, OctahedralDecode(IN.Normal));
+    OUT.TexCoord = IN.TexCoord;
+
+    return OUT;
+}
@@ -3,9 +3,13 @@
 #include <Framework/Application.h>
 #include <Framework/CommandQueue.h>
 #include <Framework/CommandList.h>
+#include <Framework/IndirectDrawBuilder.h>
 
 #include <Framework/Gameplay/Light.h>
 #include <Framework/Material/Material.h>
+#include <Framework/Material/MipStreamingScheduler.h>
+#include <Framework/MeshletBuilder.h>
+#include <Framework/MeshSimplifier.h>
 
 #include <Framework/3RD_Party/Helpers.h>
 
@@ -20,6 +24,16 @@ using namespace Microsoft::WRL;
 using namespace DirectX;
 
 #include <algorithm> // For std::min and std::max.
+#include <cfloat>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
 #if defined(min)
 #undef min
 #endif
@@ -42,6 +56,23 @@ struct Mat
     XMMATRIX ModelViewProjectionMatrix;
 };
 
+// Per-instance data of the instanced G-Buffer draws (StructuredBuffer<InstanceData> in GBufferInstanced_VS.hlsl).
+struct InstanceData
+{
+    XMMATRIX ModelMatrix;
+    XMMATRIX InverseTransposeModelMatrix;
+};
+
+// Per-draw data of the ExecuteIndirect G-Buffer path (StructuredBuffer<DrawData> in GBufferIndirect_PS.hlsl).
+struct IndirectDrawData
+{
+    Material PartMaterial;
+    uint32_t DiffuseTextureIndex;   // Into the unique textures (Sample7::m_IndirectTextures).
+    uint32_t RoughnessTextureIndex;
+    uint32_t MetalnessTextureIndex;
+    uint32_t _Padding;
+};
+
 struct DeferredLightingCommon
 {
     XMMATRIX InverseViewProjectionMatrix;
@@ -122,9 +153,30 @@ enum GbufferRootParams
     MatricesCB_GBuffer,         // ConstantBuffer<Mat> MatCB : register(b0);                            <- vs
     MaterialCB_GBuffer,         // ConstantBuffer<Material> MaterialCB : register( b0, space1 );        <- ps
     Textures_GBuffer,           // Texture2D DiffuseTexture : register( t0 );                           <- ps
+    Dequantization_GBuffer,     // ConstantBuffer<Dequantization> DequantizationCB : register(b1);      <- vs (quantized vertices)
     NumRootParameters_Gbuffer
 };
 
+enum GbufferInstancedRootParams
+{
+    MatricesCB_GBufferInstanced,    // ConstantBuffer<InstancedMat> MatCB : register(b0);                   <- vs
+    DrawConstants_GBufferInstanced, // ConstantBuffer<DrawConstants> DrawCB : register(b1);                 <- vs
+    Instances_GBufferInstanced,     // StructuredBuffer<InstanceData> Instances : register(t0, space2);     <- vs
+    MaterialCB_GBufferInstanced,    // ConstantBuffer<Material> MaterialCB : register( b0, space1 );        <- ps
+    Textures_GBufferInstanced,      // Texture2D DiffuseTexture : register( t0 );                           <- ps
+    NumRootParameters_GBufferInstanced
+};
+
+enum GbufferIndirectRootParams
+{
+    MatricesCB_GBufferIndirect,     // ConstantBuffer<Mat> MatCB : register(b0);                            <- vs
+    DrawIndex_GBufferIndirect,      // ConstantBuffer<DrawConstants> DrawCB : register(b1);                 <- vs, ps (set by the command signature)
+    DrawData_GBufferIndirect,       // StructuredBuffer<DrawData> DrawDataSB : register(t0, space2);        <- ps
+                                    // StructuredBuffer<Dequantization> DequantizationSB : register(t1, space2); <- vs (quantized vertices)
+    Textures_GBufferIndirect,       // Texture2D Textures[] : register(t0, space1);                         <- ps
+    NumRootParameters_GBufferIndirect
+};
+
 enum DeferredRootParams
 {
     DeferredLightingCommonCB_Deferred,  // b0                                                           <- ps
@@ -142,6 +194,16 @@ enum DeferredRootParams
 
 TonemapParameters g_TonemapParameters;
 
+// Render target formats. The render targets themselves are transient frame graph textures (see Sample7::BuildFrameGraph).
+const DXGI_FORMAT g_HDRFormat           = DXGI_FORMAT_R16G16B16A16_FLOAT;
+const DXGI_FORMAT g_DepthBufferFormat   = DXGI_FORMAT_R32_TYPELESS;
+const DXGI_FORMAT g_DepthStencilFormat  = DXGI_FORMAT_D32_FLOAT;     // DSV format of the depth buffer.
+const DXGI_FORMAT g_GBufferFormats[]    = {
+    DXGI_FORMAT_R8G8B8A8_UNORM,     // Albedo(RGB) + AO(A)
+    DXGI_FORMAT_R10G10B10A2_UNORM,  // Oct-encoded world-space Normal(RG), unused(BA)
+    DXGI_FORMAT_R8G8B8A8_UNORM,     // Roughness + Metalness + Emissive (RGB), unused (A)
+};
+
 
 // =====================================================================================
 //								      Helper Funcs
@@ -176,6 +238,17 @@ XMMATRIX XM_CALLCONV LookAtMatrix(FXMVECTOR Position, FXMVECTOR Direction, FXMVE
 }
 
 
+// Local matrix of the model root node: the nodes of the file are placed under it in the scene graph.
+static XMMATRIX GetModelWorldMatrix()
+{
+    float scale = 1 / 10.0f;
+
+    XMMATRIX translationMatrix = XMMatrixTranslation(0.0f, 0.0f, 0.0f);
+    XMMATRIX rotationMatrix = XMMatrixIdentity();
+    XMMATRIX scaleMatrix = XMMatrixScaling(scale, scale, scale);
+    return scaleMatrix * rotationMatrix * translationMatrix;
+}
+
 // =====================================================================================
 //								        Sample
 // =====================================================================================
@@ -183,6 +256,7 @@ XMMATRIX XM_CALLCONV LookAtMatrix(FXMVECTOR Position, FXMVECTOR Direction, FXMVE
 
 Sample7::Sample7()
     : Game()
+    , m_GBufferRecorder(ParallelCommandListRecorder::GetMaxNumThreads())
     , m_ScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX))
     , m_Forward(0)
     , m_Backward(0)
@@ -250,25 +324,139 @@ bool Sample7::LoadContent()
     std::wstring shaderBytecodeDir = solutionDir + L"Shaders\\" + PROJECT_NAME;
 
     // Load some textures
+    CommandList::GetTextureProcessor().SetCacheDirectory(TEXTURE_CACHE_DIRECTORY);
     copyCommandList->LoadTextureFromFile(m_DefaultTexture, L"Assets/Textures/DefaultWhite.bmp");
     copyCommandList->LoadTextureFromFile(m_GraceCathedralPanoTexture, L"Assets/Textures/grace-new.hdr");
 
     // Create Meshes
     m_SphereMesh = Mesh::CreateSphere(*copyCommandList);
     m_ConeMesh = Mesh::CreateCone(*copyCommandList);
+    m_LargeSphereMesh = Mesh::CreateSphere(*copyCommandList, 1.0f, 192);
+
+    CreateInstancingTestScene();
 
     // Create an inverted (reverse winding order) cube so the insides are not clipped.
     m_SkyboxMesh = Mesh::CreateCube(*copyCommandList, 1.0f, true);
 
 	// Load Sponza model with multiple mesh parts, materials, and textures.
     {
-        m_LoadedMeshParts = AssimpLoader::Load(*copyCommandList, L"Assets/Models/glTF/Sponza.gltf", m_DefaultTexture);
+        // One mesh part per mesh referenced by a node, placed by the world matrix of its node.
+        XMFLOAT4X4 modelMatrix;
+        XMStoreFloat4x4(&modelMatrix, GetModelWorldMatrix());
+        m_SceneGraph.Clear();
+        uint32_t modelNode = m_SceneGraph.AddNode(SceneGraph::InvalidNode, modelMatrix, "Sponza");
+        CommandList::GetTextureCache().SetBudget(static_cast<uint64_t>(m_TextureCacheBudgetMB) * 1024 * 1024);
+        // The model's textures only: the textures above are read whole by the passes that convert them.
+        CommandList::GetTextureStreamer().SetEnabled(true);
+        AssimpLoader::LoadOptions loadOptions;
+        loadOptions.geometryPool = &m_GeometryPool;
+        loadOptions.numLods = NUM_MESH_LODS;
+        loadOptions.buildMeshlets = true;
+        loadOptions.optimizeVertexCache = true;
+        loadOptions.quantizeVertices = true;
+        loadOptions.quantizedGeometryPool = &m_QuantizedGeometryPool;
+        loadOptions.cacheDirectory = MESH_CACHE_DIRECTORY;
+
+        auto loadStart = std::chrono::high_resolution_clock::now();
+        AssimpLoader::LoadResult model = AssimpLoader::Load(*copyCommandList, L"Assets/Models/glTF/Sponza.gltf", m_DefaultTexture, m_SceneGraph,
+            modelNode, loadOptions);
+        m_LoadedMeshParts = std::move(model.parts);
+        m_MeshLoadedFromCache = model.loadedFromCache;
+        // The model matrix is in the units of the meshes: the transform of the file's root node (a unit scale) is dropped.
+        if (model.rootNode != SceneGraph::InvalidNode)
+        {
+            XMFLOAT4X4 identity;
+            XMStoreFloat4x4(&identity, XMMatrixIdentity());
+            m_SceneGraph.SetLocalMatrix(model.rootNode, identity);
+        }
+        m_MeshLoadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
 
-        // [OPT_2] Sort the loaded mesh parts by their diffuse texture to minimize texture binding changes when rendering.
-        std::sort(m_LoadedMeshParts.begin(), m_LoadedMeshParts.end(),
-            [](const LoadedMeshPart& a, const LoadedMeshPart& b) {
-                return &a.diffuseTexture < &b.diffuseTexture;
-            });
+        char buffer[128];
+        sprintf_s(buffer, "Model load: %.1f ms (%s)\n", m_MeshLoadTimeMs, m_MeshLoadedFromCache ? "warm start, mesh cache" : "cold start, imported");
+        OutputDebugStringA(buffer);
+
+        TextureProcessor::Stats processingStats = CommandList::GetTextureProcessor().GetStats();
+        sprintf_s(buffer, "Texture processing: %u encoded in %.0f ms (%.1f MB -> %.1f MB), %u from the DDS cache\n", processingStats.NumProcessed,
+            processingStats.EncodeMilliseconds, processingStats.SourceBytes / (1024.0 * 1024.0), processingStats.ProcessedBytes / (1024.0 * 1024.0),
+            processingStats.NumCacheHits);
+        OutputDebugStringA(buffer);
+
+        MipStreamingScheduler::Stats streamingStats = CommandList::GetTextureStreamer().GetStats();
+        sprintf_s(buffer, "Mip streaming: %u textures loaded with their mip tail\n", streamingStats.NumTextures);
+        OutputDebugStringA(buffer);
+
+        // Each mesh once (the parts of several nodes share it).
+        {
+            std::set<const Mesh*> meshes;
+            uint64_t numTriangles = 0;
+            uint64_t numVertices = 0;
+            uint64_t numTransformsBefore = 0;
+            uint64_t numTransformsAfter = 0;
+            for (const auto& part : m_LoadedMeshParts)
+            {
+                if (part.vertexCacheAfter.NumTransforms == 0 || !meshes.insert(part.mesh.get()).second)
+                    continue;
+
+                numTriangles += part.geometry->indices.size() / 3;
+                numVertices += part.geometry->vertices.size();
+                numTransformsBefore += part.vertexCacheBefore.NumTransforms;
+                numTransformsAfter += part.vertexCacheAfter.NumTransforms;
+            }
+
+            if (numTriangles > 0)
+            {
+                m_VertexCacheBefore.NumTransforms = static_cast<uint32_t>(numTransformsBefore);
+                m_VertexCacheBefore.Acmr = static_cast<float>(numTransformsBefore) / numTriangles;
+                m_VertexCacheBefore.Atvr = static_cast<float>(numTransformsBefore) / numVertices;
+                m_VertexCacheAfter.NumTransforms = static_cast<uint32_t>(numTransformsAfter);
+                m_VertexCacheAfter.Acmr = static_cast<float>(numTransformsAfter) / numTriangles;
+                m_VertexCacheAfter.Atvr = static_cast<float>(numTransformsAfter) / numVertices;
+            }
+        }
+
+        // Quantized vertices: the size of each mesh once, and the largest decoding error.
+        {
+            std::set<const Mesh*> meshes;
+            m_HasQuantizedVertices = !m_LoadedMeshParts.empty();
+            m_NumModelVertices = 0;
+            m_QuantizationError = VertexQuantizer::Error();
+            for (const auto& part : m_LoadedMeshParts)
+            {
+                m_HasQuantizedVertices = m_HasQuantizedVertices && part.quantizedMesh;
+                if (!meshes.insert(part.mesh.get()).second)
+                    continue;
+
+                m_NumModelVertices += part.geometry->vertices.size();
+                m_QuantizationError.Position = std::max(m_QuantizationError.Position, part.quantizationError.Position);
+                m_QuantizationError.NormalDegrees = std::max(m_QuantizationError.NormalDegrees, part.quantizationError.NormalDegrees);
+                m_QuantizationError.TexCoord = std::max(m_QuantizationError.TexCoord, part.quantizationError.TexCoord);
+            }
+            m_QuantizedVertices = m_QuantizedVertices && m_HasQuantizedVertices;
+        }
+        m_MeshPartLods.assign(m_LoadedMeshParts.size(), 0);
+        m_SceneGraph.UpdateWorldMatrices();
+
+        // [OPT_2] State ids of the sort keys: the draws are sorted every frame (RenderGBuffer).
+        AssignMeshPartStateIds();
+
+        // [OPT_1] World-space bounds of the mesh parts, frustum culled (BVH, or SoA SIMD) every frame.
+        std::vector<DirectX::BoundingBox> partBounds;
+        partBounds.reserve(m_LoadedMeshParts.size());
+        m_MeshPartCuller.Clear();
+        m_MeshPartCuller.Reserve(static_cast<uint32_t>(m_LoadedMeshParts.size()));
+        for (const auto& part : m_LoadedMeshParts)
+        {
+            DirectX::BoundingBox worldBounds;
+            part.boundingBox.Transform(worldBounds, GetMeshPartWorldMatrix(part));
+            m_MeshPartCuller.AddBox(worldBounds.Center, worldBounds.Extents);
+            partBounds.push_back(worldBounds);
+        }
+        m_MeshPartBVH.Build(partBounds);
+
+        SetupOccluders();
+
+        // Argument and per-draw data buffers of the ExecuteIndirect G-Buffer path.
+        BuildIndirectDraws(*copyCommandList);
     }
 
     // Create a Cubemap for the HDR panorama.
@@ -341,72 +529,17 @@ bool Sample7::LoadContent()
     
     // -------------------------------------------------------------
 
-    // Create an HDR intermediate render target.
-    DXGI_FORMAT HDRFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
-    DXGI_FORMAT depthBufferFormat = DXGI_FORMAT_R32_TYPELESS;
-
-    // Create an off-screen render target with a single color buffer and a depth buffer.
-    // Array size of 1, and 1 mip level since this is an off-screen render target that won't be sampled from.
-	auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(HDRFormat, m_Width, m_Height, 1, 1);  
-    colorDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-
-    D3D12_CLEAR_VALUE colorClearValue;
-    colorClearValue.Format = colorDesc.Format;
-    colorClearValue.Color[0] = 0.4f;
-    colorClearValue.Color[1] = 0.6f;
-    colorClearValue.Color[2] = 0.9f;
-    colorClearValue.Color[3] = 1.0f;
-
-    Texture HDRTexture = Texture(colorDesc, &colorClearValue, TextureUsage::RenderTarget, L"HDR Texture");
-
-    // Create a depth buffer for the HDR render target.
-    auto depthDesc = CD3DX12_RESOURCE_DESC::Tex2D(depthBufferFormat, m_Width, m_Height, 1, 1);
-    depthDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
-
-    D3D12_CLEAR_VALUE depthClearValue;
-	depthClearValue.Format = depthDesc.Format;
-    depthClearValue.DepthStencil = { 1.0f, 0 };
-
-    // Making depth buffer shared_ptr as GBuffer RT and HDR RT are having shared ownership of the buffer
-    std::shared_ptr<Texture> sharedDepthTexture = std::make_shared<Texture>(depthDesc, &depthClearValue, TextureUsage::Depth, L"Depth Render Target");
-
-    // Attach the HDR texture to the HDR render target.
-    m_HDRRenderTarget.AttachTexture(AttachmentPoint::Color0, HDRTexture);
-    m_HDRRenderTarget.AttachTextureShared(AttachmentPoint::DepthStencil, sharedDepthTexture);
+    // The HDR render target, the depth buffer and the G-Buffer are transient frame graph textures, placed in a shared heap
+    // every frame (see BuildFrameGraph). The PSOs only need their formats.
+    D3D12_RT_FORMAT_ARRAY hdrRTVFormats = {};
+    hdrRTVFormats.NumRenderTargets = 1;
+    hdrRTVFormats.RTFormats[0] = g_HDRFormat;
 
-    // Create G-Buffer render target with multiple color attachments
+    D3D12_RT_FORMAT_ARRAY gbufferRTVFormats = {};
+    gbufferRTVFormats.NumRenderTargets = NUM_GBUFFER_RTS;
+    for (int i = 0; i < NUM_GBUFFER_RTS; ++i)
     {
-        DXGI_FORMAT gbufferFormats[NUM_GBUFFER_RTS] = {
-            DXGI_FORMAT_R8G8B8A8_UNORM,     // Albedo(RGB) + AO(A)
-			DXGI_FORMAT_R10G10B10A2_UNORM,  // Oct-encoded world-space Normal(RG), unused(BA)
-			DXGI_FORMAT_R8G8B8A8_UNORM,     // Roughness + Metalness + Emissive (RGB), unused (A)
-        };
-
-        // Just one mip is enough.
-        auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(gbufferFormats[0], m_Width, m_Height, 1, 1);
-        colorDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
-        // --
-        colorClearValue.Format = gbufferFormats[0];
-        colorClearValue.Color[0] = 0.0f;
-        colorClearValue.Color[1] = 0.0f;
-        colorClearValue.Color[2] = 0.0f;
-        colorClearValue.Color[3] = 0.0f;
-        // --
-        Texture gbufferRT0 = Texture(colorDesc, &colorClearValue, TextureUsage::RenderTarget, L"GBuffer RT0");
-    
-		colorDesc.Format = gbufferFormats[1];
-        colorClearValue.Format = gbufferFormats[1];
-        Texture gbufferRT1 = Texture(colorDesc, &colorClearValue, TextureUsage::RenderTarget, L"GBuffer RT1");
-
-        colorDesc.Format = gbufferFormats[2];
-        colorClearValue.Format = gbufferFormats[2];
-        Texture gbufferRT2 = Texture(colorDesc, &colorClearValue, TextureUsage::RenderTarget, L"GBuffer RT2");
-
-        // Create G-Buffer with multiple render targets
-        m_GBufferRT.AttachTexture(AttachmentPoint::Color0, gbufferRT0);
-        m_GBufferRT.AttachTexture(AttachmentPoint::Color1, gbufferRT1);
-        m_GBufferRT.AttachTexture(AttachmentPoint::Color2, gbufferRT2);
-        m_GBufferRT.AttachTextureShared(AttachmentPoint::DepthStencil, sharedDepthTexture);
+        gbufferRTVFormats.RTFormats[i] = g_GBufferFormats[i];
     }
 
 
@@ -466,7 +599,7 @@ bool Sample7::LoadContent()
         skyboxPipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
         skyboxPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vs.Get());
         skyboxPipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(ps.Get());
-        skyboxPipelineStateStream.RTVFormats = m_HDRRenderTarget.GetRenderTargetFormats();
+        skyboxPipelineStateStream.RTVFormats = hdrRTVFormats;
 
         D3D12_PIPELINE_STATE_STREAM_DESC skyboxPipelineStateStreamDesc = {
             sizeof(SkyboxPipelineState), &skyboxPipelineStateStream
@@ -531,6 +664,7 @@ bool Sample7::LoadContent()
         rootParameters[GbufferRootParams::MatricesCB_GBuffer].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);  // b0, SPACE0 - VERTEX shader
         rootParameters[GbufferRootParams::MaterialCB_GBuffer].InitAsConstantBufferView(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);   // b0, SPACE1 - PIXEL  shader
         rootParameters[GbufferRootParams::Textures_GBuffer].InitAsDescriptorTable(1, &descriptorRange, D3D12_SHADER_VISIBILITY_PIXEL);                          // t0, t1, t2 - DESCRIPTOR HEAP see descriptorRange
+        rootParameters[GbufferRootParams::Dequantization_GBuffer].InitAsConstants(sizeof(VertexQuantizer::Dequantization) / 4, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX); // b1 - VERTEX shader (quantized PSO only)
         
 
         CD3DX12_STATIC_SAMPLER_DESC linearRepeatSampler(0, D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR);                                                         // s0 
@@ -576,13 +710,174 @@ bool Sample7::LoadContent()
         gbufferPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vs.Get());
         gbufferPipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(ps.Get());
         gbufferPipelineStateStream.DepthStencil = depthStencilDesc;
-        gbufferPipelineStateStream.DSVFormat  = m_GBufferRT.GetDepthStencilFormat();
-        gbufferPipelineStateStream.RTVFormats = m_GBufferRT.GetRenderTargetFormats();
+        gbufferPipelineStateStream.DSVFormat  = g_DepthStencilFormat;
+        gbufferPipelineStateStream.RTVFormats = gbufferRTVFormats;
 
         D3D12_PIPELINE_STATE_STREAM_DESC gbufferPipelineStateStreamDesc = {
             sizeof(PipelineStateStream), &gbufferPipelineStateStream
         };
         ThrowIfFailed(device->CreatePipelineState(&gbufferPipelineStateStreamDesc, IID_PPV_ARGS(&m_GBufferPSO)));
+
+        // === G-Buffer Quantized PSO (the same with the VertexQuantized layout) ===
+
+        ComPtr<ID3DBlob> quantizedVS;
+        ThrowIfFailed(D3DReadFileToBlob((shaderBytecodeDir + L"\\GBufferQuantized_VS.cso").c_str(), &quantizedVS));
+
+        gbufferPipelineStateStream.InputLayout = { VertexQuantized::InputElements, VertexQuantized::InputElementCount };
+        gbufferPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(quantizedVS.Get());
+        ThrowIfFailed(device->CreatePipelineState(&gbufferPipelineStateStreamDesc, IID_PPV_ARGS(&m_GBufferQuantizedPSO)));
+    }
+
+    // [G-Buffer Instanced] - Root Signature and PSO (instancing test scene)
+    {
+        // === G-Buffer Instanced Root Signature (the G-Buffer one + the instance buffer) ===
+
+        CD3DX12_DESCRIPTOR_RANGE1 descriptorRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 3, 0);  // t0 = diffuse, t1 = roughness, t2 = metalness
+        // --
+        CD3DX12_ROOT_PARAMETER1 rootParameters[GbufferInstancedRootParams::NumRootParameters_GBufferInstanced];
+        rootParameters[GbufferInstancedRootParams::MatricesCB_GBufferInstanced].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);     // b0 - VERTEX shader
+        rootParameters[GbufferInstancedRootParams::DrawConstants_GBufferInstanced].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_VERTEX);                                      // b1 - VERTEX shader
+        rootParameters[GbufferInstancedRootParams::Instances_GBufferInstanced].InitAsShaderResourceView(0, 2, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);   // t0, SPACE2 - VERTEX shader
+        rootParameters[GbufferInstancedRootParams::MaterialCB_GBufferInstanced].InitAsConstantBufferView(0, 1, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_PIXEL);   // b0, SPACE1 - PIXEL  shader
+        rootParameters[GbufferInstancedRootParams::Textures_GBufferInstanced].InitAsDescriptorTable(1, &descriptorRange, D3D12_SHADER_VISIBILITY_PIXEL);                           // t0, t1, t2
+
+        CD3DX12_STATIC_SAMPLER_DESC linearRepeatSampler(0, D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR);                                                                            // s0
+
+        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
+        rootSignatureDescription.Init_1_1(GbufferInstancedRootParams::NumRootParameters_GBufferInstanced, rootParameters, 1, &linearRepeatSampler, rootSignatureFlags);
+
+        m_GBufferInstancedRootSignature.SetRootSignatureDesc(rootSignatureDescription.Desc_1_1, featureData.HighestVersion);
+
+        // === G-Buffer Instanced PSO (same pixel shader as the regular G-Buffer PSO) ===
+
+        ComPtr<ID3DBlob> vs, ps;
+        ThrowIfFailed(D3DReadFileToBlob((shaderBytecodeDir + L"\\GBufferInstanced_VS.cso").c_str(), &vs));
+        ThrowIfFailed(D3DReadFileToBlob((shaderBytecodeDir + L"\\GBuffer_PS.cso").c_str(), &ps));
+
+        CD3DX12_DEPTH_STENCIL_DESC1 depthStencilDesc(D3D12_DEFAULT);
+        depthStencilDesc.DepthEnable = TRUE;
+        depthStencilDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+        depthStencilDesc.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+
+        struct PipelineStateStream
+        {
+            CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+            CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT InputLayout;
+            CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimitiveTopologyType;
+            CD3DX12_PIPELINE_STATE_STREAM_VS VS;
+            CD3DX12_PIPELINE_STATE_STREAM_PS PS;
+            CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL1 DepthStencil;
+            CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
+            CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+        } gbufferPipelineStateStream;
+
+        gbufferPipelineStateStream.pRootSignature = m_GBufferInstancedRootSignature.GetRootSignature().Get();
+        gbufferPipelineStateStream.InputLayout = { VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount };
+        gbufferPipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        gbufferPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vs.Get());
+        gbufferPipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(ps.Get());
+        gbufferPipelineStateStream.DepthStencil = depthStencilDesc;
+        gbufferPipelineStateStream.DSVFormat  = g_DepthStencilFormat;
+        gbufferPipelineStateStream.RTVFormats = gbufferRTVFormats;
+
+        D3D12_PIPELINE_STATE_STREAM_DESC gbufferPipelineStateStreamDesc = {
+            sizeof(PipelineStateStream), &gbufferPipelineStateStream
+        };
+        ThrowIfFailed(device->CreatePipelineState(&gbufferPipelineStateStreamDesc, IID_PPV_ARGS(&m_GBufferInstancedPSO)));
+    }
+
+    // [G-Buffer Indirect] - Root Signature, PSO and Command Signature
+    if (m_NumIndirectDraws > 0)
+    {
+        // === G-Buffer Indirect Root Signature ===
+
+        uint32_t numTextures = static_cast<uint32_t>(m_IndirectTextures.size());
+
+        CD3DX12_DESCRIPTOR_RANGE1 drawDataRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 2, 0, 2);             // t0, SPACE2 = per-draw data, t1 = dequantization
+        CD3DX12_DESCRIPTOR_RANGE1 texturesRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, numTextures, 0, 1);   // t0..tN, SPACE1 = unique textures of the model
+        // --
+        CD3DX12_ROOT_PARAMETER1 rootParameters[GbufferIndirectRootParams::NumRootParameters_GBufferIndirect];
+        rootParameters[GbufferIndirectRootParams::MatricesCB_GBufferIndirect].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);  // b0 - VERTEX shader
+        rootParameters[GbufferIndirectRootParams::DrawIndex_GBufferIndirect].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_ALL);                                            // b1 - VERTEX and PIXEL shaders
+        rootParameters[GbufferIndirectRootParams::DrawData_GBufferIndirect].InitAsDescriptorTable(1, &drawDataRange, D3D12_SHADER_VISIBILITY_ALL);
+        rootParameters[GbufferIndirectRootParams::Textures_GBufferIndirect].InitAsDescriptorTable(1, &texturesRange, D3D12_SHADER_VISIBILITY_PIXEL);
+
+        CD3DX12_STATIC_SAMPLER_DESC linearRepeatSampler(0, D3D12_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR);                                                                        // s0
+
+        D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
+            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS |
+            D3D12_ROOT_SIGNATURE_FLAG_DENY_GEOMETRY_SHADER_ROOT_ACCESS;
+
+        CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
+        rootSignatureDescription.Init_1_1(GbufferIndirectRootParams::NumRootParameters_GBufferIndirect, rootParameters, 1, &linearRepeatSampler, rootSignatureFlags);
+
+        m_GBufferIndirectRootSignature.SetRootSignatureDesc(rootSignatureDescription.Desc_1_1, featureData.HighestVersion);
+
+        // === G-Buffer Indirect PSO (same vertex shader as the regular G-Buffer PSO) ===
+
+        ComPtr<ID3DBlob> vs, ps;
+        ThrowIfFailed(D3DReadFileToBlob((shaderBytecodeDir + L"\\GBuffer_VS.cso").c_str(), &vs));
+        ThrowIfFailed(D3DReadFileToBlob((shaderBytecodeDir + L"\\GBufferIndirect_PS.cso").c_str(), &ps));
+
+        CD3DX12_DEPTH_STENCIL_DESC1 depthStencilDesc(D3D12_DEFAULT);
+        depthStencilDesc.DepthEnable = TRUE;
+        depthStencilDesc.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+        depthStencilDesc.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
+
+        struct PipelineStateStream
+        {
+            CD3DX12_PIPELINE_STATE_STREAM_ROOT_SIGNATURE pRootSignature;
+            CD3DX12_PIPELINE_STATE_STREAM_INPUT_LAYOUT InputLayout;
+            CD3DX12_PIPELINE_STATE_STREAM_PRIMITIVE_TOPOLOGY PrimitiveTopologyType;
+            CD3DX12_PIPELINE_STATE_STREAM_VS VS;
+            CD3DX12_PIPELINE_STATE_STREAM_PS PS;
+            CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL1 DepthStencil;
+            CD3DX12_PIPELINE_STATE_STREAM_DEPTH_STENCIL_FORMAT DSVFormat;
+            CD3DX12_PIPELINE_STATE_STREAM_RENDER_TARGET_FORMATS RTVFormats;
+        } gbufferPipelineStateStream;
+
+        gbufferPipelineStateStream.pRootSignature = m_GBufferIndirectRootSignature.GetRootSignature().Get();
+        gbufferPipelineStateStream.InputLayout = { VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount };
+        gbufferPipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+        gbufferPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vs.Get());
+        gbufferPipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(ps.Get());
+        gbufferPipelineStateStream.DepthStencil = depthStencilDesc;
+        gbufferPipelineStateStream.DSVFormat  = g_DepthStencilFormat;
+        gbufferPipelineStateStream.RTVFormats = gbufferRTVFormats;
+
+        D3D12_PIPELINE_STATE_STREAM_DESC gbufferPipelineStateStreamDesc = {
+            sizeof(PipelineStateStream), &gbufferPipelineStateStream
+        };
+        ThrowIfFailed(device->CreatePipelineState(&gbufferPipelineStateStreamDesc, IID_PPV_ARGS(&m_GBufferIndirectPSO)));
+
+        // === G-Buffer Indirect Quantized PSO (the box of each draw from the per-draw data) ===
+
+        ComPtr<ID3DBlob> quantizedVS;
+        ThrowIfFailed(D3DReadFileToBlob((shaderBytecodeDir + L"\\GBufferIndirectQuantized_VS.cso").c_str(), &quantizedVS));
+
+        gbufferPipelineStateStream.InputLayout = { VertexQuantized::InputElements, VertexQuantized::InputElementCount };
+        gbufferPipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(quantizedVS.Get());
+        ThrowIfFailed(device->CreatePipelineState(&gbufferPipelineStateStreamDesc, IID_PPV_ARGS(&m_GBufferIndirectQuantizedPSO)));
+
+        // === Command Signature: VB view + IB view + draw index (root constant) + DrawIndexed arguments ===
+
+        auto argumentDescs = IndirectDrawBuilder::GetArgumentDescs(GbufferIndirectRootParams::DrawIndex_GBufferIndirect);
+
+        D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc = {};
+        commandSignatureDesc.ByteStride = IndirectDrawBuilder::GetByteStride();
+        commandSignatureDesc.NumArgumentDescs = static_cast<UINT>(argumentDescs.size());
+        commandSignatureDesc.pArgumentDescs = argumentDescs.data();
+
+        // The root signature is required, the command signature changes root arguments.
+        ThrowIfFailed(device->CreateCommandSignature(&commandSignatureDesc, m_GBufferIndirectRootSignature.GetRootSignature().Get(), IID_PPV_ARGS(&m_GBufferCommandSignature)));
     }
 
     // [Deferred Lighting] - Root Signature and PSO
@@ -651,8 +946,8 @@ bool Sample7::LoadContent()
         depthStencilDesc.DepthFunc = D3D12_COMPARISON_FUNC_LESS;
         // --
         deferredPipelineStateStream.DepthStencil = depthStencilDesc;
-        deferredPipelineStateStream.DSVFormat  = m_HDRRenderTarget.GetDepthStencilFormat();    // HDR output
-        deferredPipelineStateStream.RTVFormats = m_HDRRenderTarget.GetRenderTargetFormats();   // HDR output
+        deferredPipelineStateStream.DSVFormat  = g_DepthStencilFormat;  // HDR output
+        deferredPipelineStateStream.RTVFormats = hdrRTVFormats;         // HDR output
 
         D3D12_PIPELINE_STATE_STREAM_DESC deferredPipelineStateStreamDesc = {
             sizeof(DeferredPipelineStateStream), &deferredPipelineStateStream
@@ -671,9 +966,35 @@ bool Sample7::LoadContent()
 
 	    // Wait for Compute queue to finish the cubemap generation before we start rendering.
         //copyCommandQueue->Flush();
+
+        // The ExecuteIndirect path doesn't bind the vertex / index buffers and the textures of the
+        // mesh parts itself (so it can't transition them): move them to their read states once.
+        auto directCommandQueue = app.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+        auto directCommandList = directCommandQueue->GetCommandList();
+
+        for (const auto& part : m_LoadedMeshParts)
+        {
+            directCommandList->TransitionBarrier(part.mesh->GetVertexBuffer(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+            directCommandList->TransitionBarrier(part.mesh->GetIndexBuffer(), D3D12_RESOURCE_STATE_INDEX_BUFFER);
+            if (part.quantizedMesh)
+            {
+                directCommandList->TransitionBarrier(part.quantizedMesh->GetVertexBuffer(), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+                directCommandList->TransitionBarrier(part.quantizedMesh->GetIndexBuffer(), D3D12_RESOURCE_STATE_INDEX_BUFFER);
+            }
+        }
+        for (const Texture* texture : m_IndirectTextures)
+        {
+            directCommandList->TransitionBarrier(*texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        }
+
+        fenceValue = directCommandQueue->ExecuteCommandList(directCommandList);
+        directCommandQueue->WaitForFenceValue(fenceValue);
     }
     PIX_END_GPU_CAPTURE(profiler, g_CaptureGPUTraceOnLoadAssets);
 
+    // Gather the per-frame Direct command lists (scene + GUI/Present) into a single submission at Present.
+    Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)->SetDeferredSubmission(true);
+
     return true;
 }
 
@@ -685,8 +1006,9 @@ void Sample7::RescaleRenderTargets(float scale)
     width = clamp<uint32_t>(width, 1, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
     height = clamp<uint32_t>(height, 1, D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
 
-    m_HDRRenderTarget.Resize(width, height);
-    m_GBufferRT.Resize(width, height);
+    // The transient render targets are recreated with the new size by the frame graph of the next frame.
+    m_RenderWidth = width;
+    m_RenderHeight = height;
 }
 
 void Sample7::OnResize(ResizeEventArgs& e)
@@ -703,6 +1025,9 @@ void Sample7::OnResize(ResizeEventArgs& e)
         m_Camera.set_Projection(fov, aspectRatio, 0.1f, 200.0f);
 
         RescaleRenderTargets(m_RenderScale);
+
+        // Same aspect ratio as the window.
+        m_OcclusionCuller.Resize(OCCLUSION_BUFFER_WIDTH, static_cast<uint32_t>(OCCLUSION_BUFFER_WIDTH * m_Height / m_Width));
     }
 }
 
@@ -719,6 +1044,11 @@ void Sample7::OnUpdate()
 
     Game::OnUpdate();
 
+    // The ranges of the meshes destroyed during the completed frames can be reused.
+    uint64_t completedFrame = Application::Get().GetCompletedFrame();
+    m_GeometryPool.ReleaseStaleAllocations(completedFrame);
+    m_QuantizedGeometryPool.ReleaseStaleAllocations(completedFrame);
+
     double elapsedTime = Game::GetUpdateDeltaSeconds();
 
     totalTime += elapsedTime;
@@ -877,6 +1207,7 @@ void Sample7::OnGUI()
 {
     static bool showDemoWindow = false;
     static bool showOptions = true;
+    static bool showStats = false;
 
     if (ImGui::BeginMainMenuBar())
     {
@@ -893,6 +1224,7 @@ void Sample7::OnGUI()
         {
             ImGui::MenuItem("ImGui Demo", nullptr, &showDemoWindow);
             ImGui::MenuItem("Tonemapping", nullptr, &showOptions);
+            ImGui::MenuItem("Stats", nullptr, &showStats);
 
             ImGui::EndMenu();
         }
@@ -913,6 +1245,13 @@ void Sample7::OnGUI()
                 app.SetFullscreen(fullscreen);
             }
 
+            auto directCommandQueue = app.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+            bool batchSubmissions = directCommandQueue->IsDeferredSubmission();
+            if (ImGui::MenuItem("Batch Submissions", nullptr, &batchSubmissions))
+            {
+                directCommandQueue->SetDeferredSubmission(batchSubmissions);
+            }
+
             ImGui::EndMenu();
         }
 
@@ -1032,249 +1371,1350 @@ void Sample7::OnGUI()
 
         ImGui::End();
     }
-}
 
-void XM_CALLCONV ComputeMatrices(FXMMATRIX model, CXMMATRIX view, CXMMATRIX viewProjection, Mat& mat)
-{
-    mat.ModelMatrix = model;
-    mat.ModelViewMatrix = model * view;
-    mat.InverseTransposeModelMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, model));
-    mat.ModelViewProjectionMatrix = model * viewProjection;
-}
+    if (showStats)
+    {
+        ImGui::Begin("Stats", &showStats);
+        {
+            // Submission stats of the last presented frame (Direct queue).
+            auto submissionStats = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT)->GetSubmissionStats();
 
-void Sample7::OnRender()
-{
-    Game::OnRender();
+            ImGui::Text("Submission");
+            ImGui::Text("  ExecuteCommandList calls: %u", submissionStats.NumExecuteCalls);
+            ImGui::Text("  Submits (ExecuteCommandLists): %u", submissionStats.NumSubmits);
+            ImGui::Text("  Command lists: %u", submissionStats.NumCommandLists);
+            ImGui::Text("  Fence signals: %u", submissionStats.NumSignals);
+            ImGui::Text("  CPU time: %.3f ms", submissionStats.SubmissionTimeMs);
 
-    auto& app = Application::Get();
-    auto commandQueue = app.GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
-    auto commandList = commandQueue->GetCommandList();
-    PixProfiler& profiler = app.GetPixProfiler();
+            ImGui::Text("State binds: %u", submissionStats.NumStateCalls);
+            ImGui::Text("  Filtered (redundant): %u", submissionStats.NumFilteredStateCalls);
 
+            ImGui::Separator();
 
-    // 1. Clear the render targets.
-    {
-        PIX_SCOPE_MARKER(profiler, commandList->GetGraphicsCommandList().Get(), L"CLEAR - RTV & DSV");
-        
-        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
+            auto& benchmark = m_RecordingBenchmark;
 
-        commandList->ClearTexture(*m_HDRRenderTarget.GetTexture(AttachmentPoint::Color0), clearColor);
-        commandList->ClearDepthStencilTexture(*m_HDRRenderTarget.GetTexture(AttachmentPoint::DepthStencil), D3D12_CLEAR_FLAG_DEPTH);
-    }
+            ImGui::Text("G-Buffer recording");
+            if (m_NumIndirectDraws > 0)
+            {
+                ImGui::Checkbox("ExecuteIndirect (whole model)", &m_IndirectGBuffer);
+                if (m_IndirectGBuffer)
+                {
+                    ImGui::Checkbox("  GPU culling (frustum + Hi-Z)", &m_GpuCulling);
+                    if (m_NumMeshletDraws > 0)
+                    {
+                        ImGui::Checkbox("  Meshlets (cluster + backface cone culling)", &m_ClusterCulling);
+                    }
+                    if (m_ClusterCulling && m_NumMeshletDraws > 0)
+                    {
+                        // CPU count with the same test as the shader (the GPU counts aren't read back).
+                        XMFLOAT3 cameraPosition;
+                        XMStoreFloat3(&cameraPosition, m_Camera.get_Translation());
+                        uint32_t numBackfacing = 0;
+                        for (const auto& cone : m_MeshletCones)
+                        {
+                            numBackfacing += CullingMath::IsBackfacing(cone, cameraPosition) ? 1 : 0;
+                        }
+                        ImGui::Text("    %u meshlets, %u facing away from the camera", m_NumMeshletDraws, numBackfacing);
+                    }
+                }
+            }
+            ImGui::Checkbox("Parallel recording", &m_ParallelGBufferRecording);
 
-    commandList->SetRenderTarget(m_HDRRenderTarget);
-    commandList->SetViewport(m_HDRRenderTarget.GetViewport());
-    commandList->SetScissorRect(m_ScissorRect);
+            int numThreads = static_cast<int>(m_GBufferRecorder.GetNumThreads());
+            if (ImGui::SliderInt("Threads", &numThreads, 1, static_cast<int>(ParallelCommandListRecorder::GetMaxNumThreads())))
+            {
+                m_GBufferRecorder.SetNumThreads(static_cast<uint32_t>(numThreads));
+            }
 
-    // 2. Render the skybox.
-    {
-        PIX_SCOPE_MARKER(profiler, commandList->GetGraphicsCommandList().Get(), L"SKYBOX");
+            bool drawMeshlets = m_ClusterCulling && m_NumMeshletDraws > 0;
+            size_t numDraws = m_IndirectGBuffer ? (drawMeshlets ? m_NumMeshletDraws : m_NumIndirectDraws) : m_VisibleMeshParts.size();
+            // The GPU culled count stays on the GPU (no readback).
+            const char* drawsFormat = (m_IndirectGBuffer && m_GpuCulling) ? "  Draws: <= %zu (GPU culled), command lists: %u" : "  Draws: %zu, command lists: %u";
+            ImGui::Text(drawsFormat, numDraws, m_GBufferNumCommandLists);
+            ImGui::Text("  CPU time: %.3f ms", m_GBufferRecordTimeMs);
 
-        // The view matrix should only consider the camera's rotation, but not the translation.
-        auto viewMatrix = XMMatrixTranspose(XMMatrixRotationQuaternion(m_Camera.get_Rotation()));
-        auto projMatrix = m_Camera.get_ProjectionMatrix();
-        auto viewProjMatrix = viewMatrix * projMatrix;
+            if (benchmark.Running)
+            {
+                ImGui::Text("  Benchmarking %u thread(s)...", benchmark.NumThreads);
+            }
+            else if (ImGui::Button("Benchmark thread count"))
+            {
+                benchmark = RecordingBenchmark();
+                benchmark.Running = true;
+                benchmark.NumThreads = 1;
 
-        commandList->SetPipelineState(m_SkyboxPipelineState);
-        commandList->SetGraphicsRootSignature(m_SkyboxSignature);
+                m_ParallelGBufferRecording = true;
+                m_GBufferRecorder.SetNumThreads(benchmark.NumThreads);
+            }
 
-        commandList->SetGraphics32BitConstants(0, viewProjMatrix);
+            for (size_t i = 0; i < benchmark.AverageTimeMs.size(); ++i)
+            {
+                ImGui::Text("  %zu thread(s): %.3f ms", i + 1, benchmark.AverageTimeMs[i]);
+            }
 
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-        srvDesc.Format = m_GraceCathedralCubemap.GetD3D12ResourceDesc().Format;
-        srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-        srvDesc.TextureCube.MipLevels = (UINT)-1; // Use all mips.
+            ImGui::Separator();
 
-        // TODO: Need a better way to bind a cubemap.
-        commandList->SetShaderResourceView(1, 0, m_GraceCathedralCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, &srvDesc);
+            ImGui::Checkbox("Sort draws (64-bit state keys)", &m_SortDraws);
+            ImGui::Text("  %u materials, %u texture sets, sort time: %.3f ms (%u radix passes)", m_NumMaterials, m_NumTextureSets, m_DrawSortTimeMs,
+                m_SortDraws ? m_RenderQueue.GetNumSortPasses() : 0);
+            ImGui::Text("  Binds: %u matrices, %u materials, %u textures", m_NumMatricesBinds.load(), m_NumMaterialBinds.load(), m_NumTextureBinds.load());
 
-        m_SkyboxMesh->Draw(*commandList);
-    }
+            ImGui::Separator();
 
-	// 3. Render the scene (model + debug shapes) in HDR to an off-screen render target, using either forward or deferred rendering.
-    {
-        XMMATRIX viewMatrix = m_Camera.get_ViewMatrix();
-        XMMATRIX viewProjectionMatrix = viewMatrix * m_Camera.get_ProjectionMatrix();
+            ImGui::Checkbox("Distance LODs", &m_DistanceLods);
+            ImGui::Text("  %.2f M triangles drawn, parts per LOD: %u / %u / %u / %u", m_NumGBufferTriangles.load() / 1000000.0,
+                m_NumPartsPerLod[0], m_NumPartsPerLod[1], m_NumPartsPerLod[2], m_NumPartsPerLod[3]);
+            ImGui::Text("  Model load: %.0f ms (%s)", m_MeshLoadTimeMs, m_MeshLoadedFromCache ? "warm start, mesh cache" : "cold start, imported");
+            ImGui::SameLine();
+            if (ImGui::Button("Clear mesh cache"))
+            {
+                std::error_code error;
+                std::filesystem::remove_all(MESH_CACHE_DIRECTORY, error);
+                m_MeshCacheCleared = true;
+            }
+            if (m_MeshCacheCleared)
+            {
+                ImGui::Text("  Cleared: the next start imports the model.");
+            }
+            {
+                TextureCache& textureCache = CommandList::GetTextureCache();
+                TextureCache::Stats stats = textureCache.GetStats();
+                ImGui::Text("Texture cache: %u textures (%u in use), %.1f MB resident, %llu evicted", stats.NumEntries, stats.NumEntriesInUse,
+                    stats.ResidentBytes / (1024.0 * 1024.0), stats.NumEvictions);
+                ImGui::Text("  Hit rate: %.1f%% (%llu hits, %llu misses)", stats.GetHitRate() * 100.0, stats.NumHits, stats.NumMisses);
+                if (ImGui::SliderInt("Texture cache budget (MB)", &m_TextureCacheBudgetMB, 0, 4096))
+                {
+                    textureCache.SetBudget(static_cast<uint64_t>(m_TextureCacheBudgetMB) * 1024 * 1024);
+                }
+            }
+            {
+                // The source sizes don't have mips: the uncompressed chains would be 4/3 of them.
+                TextureProcessor::Stats stats = CommandList::GetTextureProcessor().GetStats();
+                ImGui::Text("Texture processing: %u encoded (%u not compressed) in %.0f ms, %u from the DDS cache", stats.NumProcessed,
+                    stats.NumUncompressed, stats.EncodeMilliseconds, stats.NumCacheHits);
+                if (stats.NumProcessed > 0)
+                {
+                    ImGui::Text("  %.1f MB decoded -> %.1f MB with mips (%.1fx smaller than RGBA with mips)", stats.SourceBytes / (1024.0 * 1024.0),
+                        stats.ProcessedBytes / (1024.0 * 1024.0), stats.SourceBytes * 4.0 / 3.0 / stats.ProcessedBytes);
+                }
+                if (ImGui::Button("Clear texture processing cache"))
+                {
+                    std::error_code error;
+                    std::filesystem::remove_all(TEXTURE_CACHE_DIRECTORY, error);
+                    m_TextureProcessingCacheCleared = true;
+                }
+                if (m_TextureProcessingCacheCleared)
+                {
+                    ImGui::Text("  Cleared: the next start encodes the textures again.");
+                }
+            }
+            {
+                MipStreamingScheduler::Stats stats = CommandList::GetTextureStreamer().GetStats();
+                ImGui::Checkbox("Stream texture mips", &m_MipStreaming);
+                ImGui::SliderInt("Mip streaming budget (KB per frame)", &m_MipStreamingBudgetKB, 64, 65536);
+                ImGui::Text("  %u streamed textures, %u still streaming (%.1f MB pending)", stats.NumTextures, stats.NumStreaming,
+                    stats.PendingBytes / (1024.0 * 1024.0));
+                ImGui::Text("  %llu mips uploaded (%.1f MB)", stats.NumUploads, stats.UploadedBytes / (1024.0 * 1024.0));
+            }
 
-        RenderDeferred(commandList, viewMatrix, viewProjectionMatrix);
-    }
+            ImGui::Text("Vertex cache (FIFO %u): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", VertexCacheOptimizer::CacheSize,
+                m_VertexCacheBefore.Acmr, m_VertexCacheAfter.Acmr, m_VertexCacheBefore.Atvr, m_VertexCacheAfter.Atvr);
+            if (ImGui::TreeNode("Vertex cache per mesh part"))
+            {
+                for (size_t i = 0; i < m_LoadedMeshParts.size(); ++i)
+                {
+                    const LoadedMeshPart& part = m_LoadedMeshParts[i];
+                    ImGui::Text("%zu: %zu triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", i, part.geometry->indices.size() / 3,
+                        part.vertexCacheBefore.Acmr, part.vertexCacheAfter.Acmr, part.vertexCacheBefore.Atvr, part.vertexCacheAfter.Atvr);
+                }
+                ImGui::TreePop();
+            }
 
-    // 4. FSQ Posteffect: perform HDR -> SDR tonemapping directly to the Window's render target.
-    {
-        PIX_SCOPE_MARKER(profiler, commandList->GetGraphicsCommandList().Get(), L"HDR_to_SDR");
+            ImGui::Separator();
 
-        commandList->SetRenderTarget(app.GetRenderTarget());
-        commandList->SetViewport(app.GetRenderTarget().GetViewport());
-        commandList->SetScissorRect(m_ScissorRect);
-        commandList->SetPipelineState(m_SDRPipelineState);
-        commandList->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        commandList->SetGraphicsRootSignature(m_SDRRootSignature);
-        commandList->SetGraphics32BitConstants(0, g_TonemapParameters);
-        commandList->SetShaderResourceView(1, 0, *m_HDRRenderTarget.GetTexture(Color0), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            const double toMB = 1.0 / (1024.0 * 1024.0);
+            if (m_HasQuantizedVertices)
+            {
+                ImGui::Checkbox("Quantized vertices", &m_QuantizedVertices);
+            }
+            ImGui::Text("  %llu vertices, %zu -> %zu bytes each (%.2f MB -> %.2f MB)", m_NumModelVertices, sizeof(VertexPositionNormalTexture),
+                sizeof(VertexQuantizer::QuantizedVertex), m_NumModelVertices * sizeof(VertexPositionNormalTexture) * toMB,
+                m_NumModelVertices * sizeof(VertexQuantizer::QuantizedVertex) * toMB);
+            ImGui::Text("  Max error: position %.5f, normal %.3f deg, texture coordinate %.5f", m_QuantizationError.Position,
+                m_QuantizationError.NormalDegrees, m_QuantizationError.TexCoord);
 
-        commandList->Draw(3);
-    }
+            ImGui::Separator();
 
-	// 5. Execute the command list.
-    commandQueue->ExecuteCommandList(commandList);
+            ImGui::Text("Geometry pool: %u meshes in %u block(s) (%u with 32-bit indices), %u free ranges", m_GeometryPool.GetNumAllocations(),
+                m_GeometryPool.GetNumBlocks(), m_GeometryPool.GetNumBlocks(DXGI_FORMAT_R32_UINT), m_GeometryPool.GetNumFreeRanges());
+            ImGui::Text("  Used %.2f MB / %.2f MB (separate buffers: %.2f MB, %u resources)", m_GeometryPool.GetUsedSizeInBytes() * toMB,
+                m_GeometryPool.GetCapacityInBytes() * toMB, m_GeometryPool.GetSeparateBuffersSizeInBytes() * toMB, m_GeometryPool.GetNumAllocations() * 2);
+            ImGui::Text("  Quantized: %u meshes in %u block(s), used %.2f MB / %.2f MB", m_QuantizedGeometryPool.GetNumAllocations(),
+                m_QuantizedGeometryPool.GetNumBlocks(), m_QuantizedGeometryPool.GetUsedSizeInBytes() * toMB, m_QuantizedGeometryPool.GetCapacityInBytes() * toMB);
 
-    // 6. Render GUI.
-    OnGUI();
+            ImGui::Separator();
 
-    // 7. Present
-    app.Present();
-}
+            ImGui::Checkbox("Instancing test scene", &m_InstancingTestScene);
+            if (m_InstancingTestScene)
+            {
+                ImGui::Checkbox("  Automatic instancing", &m_AutoInstancing);
+                ImGui::Text("  %u spheres, %u materials: %u draws (%u saved), CPU time: %.3f ms", NUM_TEST_SPHERES, NUM_TEST_MATERIALS,
+                    m_NumTestSceneDraws, NUM_TEST_SPHERES - m_NumTestSceneDraws, m_TestSceneRecordTimeMs);
+            }
+
+            ImGui::Separator();
+
+            ImGui::Text("Frustum culling (%s)", FrustumCuller::GetInstructionSetName(FrustumCuller::GetBestInstructionSet()));
+            ImGui::Checkbox("BVH culling", &m_BVHCulling);
+            ImGui::Text("  Mesh parts: %zu visible / %u, CPU time: %.3f ms", m_VisibleMeshParts.size(), m_MeshPartCuller.GetNumBoxes(), m_FrustumCullTimeMs);
+            if (m_BVHCulling)
+            {
+                ImGui::Text("  BVH: %u nodes visited / %u, depth %u", m_NumVisitedBVHNodes, m_MeshPartBVH.GetNumNodes(), m_MeshPartBVH.GetDepth());
+            }
+            if (m_PickedMeshPart != BoundingVolumeHierarchy::InvalidIndex)
+            {
+                ImGui::Text("  Picked mesh part (right click): %u", m_PickedMeshPart);
+            }
+            else
+            {
+                ImGui::Text("  Picked mesh part (right click): none");
+            }
+
+            const SoftwareOcclusionCuller::Stats& occlusionStats = m_OcclusionCuller.GetStats();
+            ImGui::Checkbox("Software occlusion culling", &m_SoftwareOcclusion);
+            ImGui::Text("  Occluders: %u (%u triangles, %u rasterized), %ux%u", m_OcclusionCuller.GetNumOccluders(), occlusionStats.NumOccluderTriangles,
+                occlusionStats.NumRasterizedTriangles, m_OcclusionCuller.GetWidth(), m_OcclusionCuller.GetHeight());
+            ImGui::Text("  Occluded mesh parts: %u, CPU time: %.3f ms (raster %.3f ms)", m_NumOccludedMeshParts, m_OcclusionCullTimeMs, occlusionStats.RasterTimeMs);
+
+            ImGui::Separator();
+
+            // Frame graph of the last rendered frame.
+            const FrameGraph::Stats& frameGraphStats = m_FrameGraph.GetStats();
+            ImGui::Text("Frame Graph");
+            ImGui::Text("  Passes: %u (culled: %u)", frameGraphStats.NumPasses, frameGraphStats.NumCulledPasses);
+            ImGui::Text("  Barriers: %u", frameGraphStats.NumBarriers);
+            ImGui::Text("  Batches: %u (cross-queue waits: %u)", frameGraphStats.NumBatches, frameGraphStats.NumCrossQueueWaits);
+            for (FrameGraph::PassHandle pass : m_FrameGraph.GetExecutionOrder())
+            {
+                ImGui::Text("  %ls (%zu barriers)", m_FrameGraph.GetPassName(pass).c_str(), m_FrameGraph.GetPassBarriers(pass).size());
+            }
+
+            // Transient render targets: memory with aliasing vs one allocation per render target.
+            const auto& transientAllocator = m_FrameGraph.GetTransientResourceAllocator();
+            const auto& aliasingPlan = transientAllocator.GetPlan();
+            ImGui::Text("Transient Render Targets: %u", frameGraphStats.NumTransientTextures);
+            ImGui::Text("  Heap: %.2f MB (without aliasing: %.2f MB)", aliasingPlan.HeapSize * toMB, aliasingPlan.UnaliasedSize * toMB);
+            ImGui::Text("  VRAM saved: %.2f MB", aliasingPlan.GetSavedBytes() * toMB);
+            ImGui::Text("  Heap allocations: %u", transientAllocator.GetNumHeapAllocations());
+        }
+        ImGui::End();
+    }
+}
+
+void XM_CALLCONV ComputeMatrices(FXMMATRIX model, CXMMATRIX view, CXMMATRIX viewProjection, Mat& mat)
+{
+    mat.ModelMatrix = model;
+    mat.ModelViewMatrix = model * view;
+    mat.InverseTransposeModelMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, model));
+    mat.ModelViewProjectionMatrix = model * viewProjection;
+}
+
+void Sample7::OnRender()
+{
+    Game::OnRender();
 
-void Sample7::RenderDeferred(std::shared_ptr<CommandList> commandList, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix)
-{
     auto& app = Application::Get();
-    PixProfiler& profiler = app.GetPixProfiler();
 
-    // === PASS 1: G-Buffer Generation ===
+    XMMATRIX viewMatrix = m_Camera.get_ViewMatrix();
+    XMMATRIX viewProjectionMatrix = viewMatrix * m_Camera.get_ProjectionMatrix();
+
+    // 1. Declare the passes of the frame and the render targets they read / write.
+    BuildFrameGraph(viewMatrix, viewProjectionMatrix);
+
+    // 2. Order the passes, cull the ones that don't contribute to the back buffer, compute the barriers.
+    m_FrameGraph.Compile();
+
+    // 3. Place the transient render targets in memory, the passes bind them through the RenderTargets.
+    m_FrameGraph.AllocateTransientResources();
+    AttachRenderTargets();
+
+    // 4. Record and execute the passes.
+    m_FrameGraph.Execute();
+
+    UpdateRecordingBenchmark();
+
+    // 5. Render GUI.
+    OnGUI();
+
+    // 6. Present
+    app.Present();
+}
+
+void Sample7::BuildFrameGraph(DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix)
+{
+    using QueueType = FrameGraph::QueueType;
+
+    auto& app = Application::Get();
+
+    m_FrameGraph.Reset();
+
+    // Transient render targets, at the render scale.
+    // Array size of 1, and 1 mip level since these are off-screen render targets.
+    auto colorDesc = CD3DX12_RESOURCE_DESC::Tex2D(g_HDRFormat, m_RenderWidth, m_RenderHeight, 1, 1);
+    colorDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+    D3D12_CLEAR_VALUE colorClearValue = {};
+    colorClearValue.Format = g_HDRFormat;
+    colorClearValue.Color[0] = 0.4f;
+    colorClearValue.Color[1] = 0.6f;
+    colorClearValue.Color[2] = 0.9f;
+    colorClearValue.Color[3] = 1.0f;
+
+    auto depthDesc = CD3DX12_RESOURCE_DESC::Tex2D(g_DepthBufferFormat, m_RenderWidth, m_RenderHeight, 1, 1);
+    depthDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL;
+
+    D3D12_CLEAR_VALUE depthClearValue = {};
+    depthClearValue.Format = g_DepthBufferFormat;
+    depthClearValue.DepthStencil = { 1.0f, 0 };
+
+    auto& handles = m_RenderTargetHandles;
+
+    handles.HDRColor = m_FrameGraph.CreateTexture(L"HDR Texture", colorDesc, &colorClearValue);
+    handles.Depth    = m_FrameGraph.CreateTexture(L"Depth Render Target", depthDesc, &depthClearValue, TextureUsage::Depth); // Shared by the HDR RT and the G-Buffer.
+
+    for (int i = 0; i < NUM_GBUFFER_RTS; ++i)
+    {
+        colorDesc.Format = g_GBufferFormats[i];
+        colorClearValue.Format = g_GBufferFormats[i];
+        colorClearValue.Color[0] = colorClearValue.Color[1] = colorClearValue.Color[2] = colorClearValue.Color[3] = 0.0f;
+
+        handles.GBuffer[i] = m_FrameGraph.CreateTexture(L"GBuffer RT" + std::to_wstring(i), colorDesc, &colorClearValue);
+    }
+
+    auto hdrColor       = handles.HDRColor;
+    auto depth          = handles.Depth;
+    auto gbufferAlbedo  = handles.GBuffer[0];
+    auto gbufferNormal  = handles.GBuffer[1];
+    auto gbufferPBR     = handles.GBuffer[2];
+    auto backBuffer     = m_FrameGraph.ImportResource(L"Back Buffer", app.GetRenderTarget().GetTexture(AttachmentPoint::Color0));
+
+    m_FrameGraph.MarkOutput(backBuffer);
+
+    // 1. Clear the HDR render target and render the skybox.
+    auto skyboxPass = m_FrameGraph.AddPass(L"SKYBOX", QueueType::Direct, [this](FrameGraph::PassContext& context)
+    {
+        RenderSkybox(context.GetCommandList());
+    });
+    m_FrameGraph.Write(skyboxPass, hdrColor, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    m_FrameGraph.Write(skyboxPass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // GPU culling of the ExecuteIndirect path: compute passes around the two G-Buffer phases.
+    const bool gpuCulling = m_IndirectGBuffer && m_GpuCulling;
+    IndirectCommands indirect = GetIndirectCommands();
+
+    FrameGraph::ResourceHandle arguments = 0, instanceFlags = 0, hiz = 0;
+    FrameGraph::ResourceHandle phaseCommands[2] = {}, phaseCounters[2] = {};
+    if (gpuCulling)
+    {
+        // The pyramid has the size of the depth buffer.
+        indirect.Culling->Resize(m_RenderWidth, m_RenderHeight);
+
+        arguments       = m_FrameGraph.ImportResource(L"Indirect Arguments", indirect.Arguments);
+        instanceFlags   = m_FrameGraph.ImportResource(L"Culling Instance Flags", &indirect.Culling->GetInstanceFlags());
+        hiz             = m_FrameGraph.ImportResource(L"Hi-Z Pyramid", indirect.Culling->GetHiZ());
+        for (uint32_t phase = 0; phase < 2; ++phase)
+        {
+            const auto& commands = indirect.Culling->GetCommands(phase);
+            phaseCommands[phase] = m_FrameGraph.ImportResource(L"Culled Commands Phase " + std::to_wstring(phase + 1), &commands);
+            phaseCounters[phase] = m_FrameGraph.ImportResource(L"Culled Commands Counter Phase " + std::to_wstring(phase + 1), &commands.GetCounterBuffer());
+        }
+    }
+
+    // The inputs of a culling phase: the commands of all the instances, and the pyramid (of the previous frame in phase 1).
+    auto declareCulling = [&](FrameGraph::PassHandle pass, uint32_t phase)
+    {
+        m_FrameGraph.Read(pass, arguments, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(pass, hiz, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(pass, instanceFlags, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_FrameGraph.Write(pass, phaseCommands[phase], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_FrameGraph.Write(pass, phaseCounters[phase], D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    };
+
+    // The draws of a G-Buffer phase.
+    auto declareGBuffer = [&](FrameGraph::PassHandle pass, uint32_t phase)
+    {
+        m_FrameGraph.Write(pass, gbufferAlbedo, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        m_FrameGraph.Write(pass, gbufferNormal, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        m_FrameGraph.Write(pass, gbufferPBR, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        m_FrameGraph.Write(pass, depth, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+        if (gpuCulling)
+        {
+            m_FrameGraph.Read(pass, phaseCommands[phase], D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+            m_FrameGraph.Read(pass, phaseCounters[phase], D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT);
+        }
+    };
+
+    // 2. GPU culling phase 1: frustum test, then occlusion against the pyramid of the previous frame.
+    if (gpuCulling)
+    {
+        auto pass = m_FrameGraph.AddPass(L"GPU_CULLING_PHASE_1", QueueType::Compute, [this, viewProjectionMatrix](FrameGraph::PassContext& context)
+        {
+            XMFLOAT4X4 viewProjection;
+            XMStoreFloat4x4(&viewProjection, viewProjectionMatrix);
+            XMFLOAT3 cameraPosition;
+            XMStoreFloat3(&cameraPosition, m_Camera.get_Translation());
+
+            IndirectCommands indirect = GetIndirectCommands();
+            indirect.Culling->CullPhase1(context.GetCommandList(), *indirect.Arguments, viewProjection, cameraPosition);
+        });
+        declareCulling(pass, 0);
+
+        // The culled commands of the previous frame may still be drawn on the Direct queue: the compute queue waits
+        // for it (through the skybox batch) before they are overwritten.
+        m_FrameGraph.AddDependency(pass, skyboxPass);
+    }
+
+    // 3. Render the scene into the G-Buffer (the instances visible in phase 1 with the GPU culling).
+    {
+        auto pass = m_FrameGraph.AddPass(L"G-BUFFER", QueueType::Direct, [this, viewMatrix, viewProjectionMatrix](FrameGraph::PassContext& context)
+        {
+            RenderGBuffer(context, viewMatrix, viewProjectionMatrix);
+        });
+        declareGBuffer(pass, 0);
+    }
+
+    if (gpuCulling)
+    {
+        // 4. The max-depth pyramid of the phase 1 draws.
+        {
+            auto pass = m_FrameGraph.AddPass(L"GPU_CULLING_HI_Z", QueueType::Compute, [this](FrameGraph::PassContext& context)
+            {
+                GetIndirectCommands().Culling->BuildHiZ(context.GetCommandList(), *m_GBufferRT.GetTexture(AttachmentPoint::DepthStencil));
+            });
+            m_FrameGraph.Read(pass, depth, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+            m_FrameGraph.Write(pass, hiz, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+
+        // 5. GPU culling phase 2: the instances occluded in phase 1, against the new pyramid.
+        {
+            auto pass = m_FrameGraph.AddPass(L"GPU_CULLING_PHASE_2", QueueType::Compute, [this](FrameGraph::PassContext& context)
+            {
+                IndirectCommands indirect = GetIndirectCommands();
+                indirect.Culling->CullPhase2(context.GetCommandList(), *indirect.Arguments);
+            });
+            declareCulling(pass, 1);
+        }
+
+        // 6. Render the instances that became visible into the G-Buffer.
+        {
+            auto pass = m_FrameGraph.AddPass(L"G-BUFFER_PHASE_2", QueueType::Direct, [this, viewMatrix, viewProjectionMatrix](FrameGraph::PassContext& context)
+            {
+                auto startTime = std::chrono::high_resolution_clock::now();
+
+                CommandList& commandList = context.GetCommandList();
+                IndirectCommands indirect = GetIndirectCommands();
+                const auto& phase2Commands = indirect.Culling->GetCommands(1);
+                SetupGBufferIndirect(commandList, viewMatrix, viewProjectionMatrix);
+                RecordGBufferIndirect(commandList, phase2Commands, indirect.NumCommands, &phase2Commands.GetCounterBuffer());
+
+                // On top of the G-BUFFER pass, in its own batch.
+                m_GBufferRecordTimeMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+                ++m_GBufferNumCommandLists;
+            });
+            declareGBuffer(pass, 1);
+        }
+    }
+
+    // 7. Deferred lighting into the HDR render target.
+    {
+        auto pass = m_FrameGraph.AddPass(L"DEFERRED_LIGHTING", QueueType::Direct, [this, viewProjectionMatrix](FrameGraph::PassContext& context)
+        {
+            RenderDeferredLighting(context.GetCommandList(), viewProjectionMatrix);
+        });
+        m_FrameGraph.Read(pass, gbufferAlbedo, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(pass, gbufferNormal, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(pass, gbufferPBR, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Read(pass, depth, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(pass, hdrColor, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+
+    // 8. FSQ Posteffect: perform HDR -> SDR tonemapping directly to the Window's render target.
+    {
+        auto pass = m_FrameGraph.AddPass(L"HDR_to_SDR", QueueType::Direct, [this](FrameGraph::PassContext& context)
+        {
+            RenderHDRtoSDR(context.GetCommandList());
+        });
+        m_FrameGraph.Read(pass, hdrColor, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        m_FrameGraph.Write(pass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+}
+
+void Sample7::AttachRenderTargets()
+{
+    const auto& handles = m_RenderTargetHandles;
+
+    auto depthTexture = m_FrameGraph.GetTexture(handles.Depth);
+
+    m_HDRRenderTarget.AttachTextureShared(AttachmentPoint::Color0, m_FrameGraph.GetTexture(handles.HDRColor));
+    m_HDRRenderTarget.AttachTextureShared(AttachmentPoint::DepthStencil, depthTexture);
+
+    for (int i = 0; i < NUM_GBUFFER_RTS; ++i)
+    {
+        m_GBufferRT.AttachTextureShared(static_cast<AttachmentPoint>(AttachmentPoint::Color0 + i), m_FrameGraph.GetTexture(handles.GBuffer[i]));
+    }
+    m_GBufferRT.AttachTextureShared(AttachmentPoint::DepthStencil, depthTexture);
+}
+
+void Sample7::RenderSkybox(CommandList& commandList)
+{
+    FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
+
+    commandList.ClearTexture(*m_HDRRenderTarget.GetTexture(AttachmentPoint::Color0), clearColor);
+    commandList.ClearDepthStencilTexture(*m_HDRRenderTarget.GetTexture(AttachmentPoint::DepthStencil), D3D12_CLEAR_FLAG_DEPTH);
+
+    commandList.SetRenderTarget(m_HDRRenderTarget);
+    commandList.SetViewport(m_HDRRenderTarget.GetViewport());
+    commandList.SetScissorRect(m_ScissorRect);
+
+    // The view matrix should only consider the camera's rotation, but not the translation.
+    auto viewMatrix = XMMatrixTranspose(XMMatrixRotationQuaternion(m_Camera.get_Rotation()));
+    auto projMatrix = m_Camera.get_ProjectionMatrix();
+    auto viewProjMatrix = viewMatrix * projMatrix;
+
+    commandList.SetPipelineState(m_SkyboxPipelineState);
+    commandList.SetGraphicsRootSignature(m_SkyboxSignature);
+
+    commandList.SetGraphics32BitConstants(0, viewProjMatrix);
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = m_GraceCathedralCubemap.GetD3D12ResourceDesc().Format;
+    srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+    srvDesc.TextureCube.MipLevels = (UINT)-1; // Use all mips.
+
+    // TODO: Need a better way to bind a cubemap.
+    commandList.SetShaderResourceView(1, 0, m_GraceCathedralCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, &srvDesc);
+
+    m_SkyboxMesh->Draw(commandList);
+}
+
+void Sample7::RenderGBuffer(FrameGraph::PassContext& context, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix)
+{
+    CommandList& commandList = context.GetCommandList();
+
+    // Per scene graph node, set when the node changes between two draws.
+    std::vector<Mat> nodeMatrices(m_SceneGraph.GetNumNodes());
+    for (uint32_t node = 0; node < m_SceneGraph.GetNumNodes(); ++node)
     {
-        PIX_SCOPE_MARKER(profiler, commandList->GetGraphicsCommandList().Get(), L"G-BUFFER");
+        ComputeMatrices(XMLoadFloat4x4(&m_SceneGraph.GetWorldMatrix(node)), viewMatrix, viewProjectionMatrix, nodeMatrices[node]);
+    }
 
-        commandList->SetRenderTarget(m_GBufferRT);
-        commandList->SetViewport(m_GBufferRT.GetViewport());
-        commandList->SetScissorRect(m_ScissorRect);
+    // [OPT_1] Frustum culling in World space - camera frustum vs the AABBs of the mesh parts, either through the BVH
+    // or all of them (4/8 boxes per test).
+    // Done up front, so the draw list can be split evenly between the recording threads.
+    // (The ExecuteIndirect path culls on the GPU.)
+    m_VisibleMeshParts.clear();
+    m_NumVisitedBVHNodes = 0;
+    if (!m_IndirectGBuffer)
+    {
+        XMFLOAT4X4 viewProjection;
+        XMStoreFloat4x4(&viewProjection, viewProjectionMatrix);
+
+        auto cullStart = std::chrono::high_resolution_clock::now();
+        if (m_BVHCulling)
+        {
+            m_NumVisitedBVHNodes = m_MeshPartBVH.CullFrustum(viewProjection, m_VisibleMeshParts);
+            // Back to the load order, the draw order doesn't depend on the traversal.
+            std::sort(m_VisibleMeshParts.begin(), m_VisibleMeshParts.end());
+        }
+        else
+        {
+            m_MeshPartCuller.Cull(viewProjection, m_VisibleMeshParts);
+        }
+        m_FrustumCullTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
 
-        // Clear G-Buffer
-        FLOAT clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-        commandList->ClearTexture(*m_GBufferRT.GetTexture(AttachmentPoint::Color0), clearColor);
-        commandList->ClearTexture(*m_GBufferRT.GetTexture(AttachmentPoint::Color1), clearColor);
-        commandList->ClearTexture(*m_GBufferRT.GetTexture(AttachmentPoint::Color2), clearColor);
-        commandList->ClearDepthStencilTexture(*m_GBufferRT.GetTexture(AttachmentPoint::DepthStencil), D3D12_CLEAR_FLAG_DEPTH);
+        // [OPT_3] Software occlusion culling of what's left: the occluders are drawn in any case.
+        m_NumOccludedMeshParts = 0;
+        if (m_SoftwareOcclusion && m_OcclusionCuller.GetNumOccluders() > 0)
+        {
+            auto occlusionStart = std::chrono::high_resolution_clock::now();
+            m_OcclusionCuller.RenderOccluders(viewProjection, &Application::Get().GetThreadPool());
+
+            auto isOccluded = [this](uint32_t part)
+            {
+                return !m_IsOccluder[part] && m_OcclusionCuller.IsOccluded(m_MeshPartBVH.GetBounds(part));
+            };
+            auto end = std::remove_if(m_VisibleMeshParts.begin(), m_VisibleMeshParts.end(), isOccluded);
+            m_NumOccludedMeshParts = static_cast<uint32_t>(m_VisibleMeshParts.end() - end);
+            m_VisibleMeshParts.erase(end, m_VisibleMeshParts.end());
+            m_OcclusionCullTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - occlusionStart).count();
+        }
+
+        // [OPT_2] Sort by state (material, then textures), front to back within the same state.
+        m_DrawSortTimeMs = 0.0;
+        if (m_SortDraws)
+        {
+            auto sortStart = std::chrono::high_resolution_clock::now();
+
+            m_RenderQueue.Clear();
+            m_RenderQueue.Reserve(static_cast<uint32_t>(m_VisibleMeshParts.size()));
+            for (uint32_t part : m_VisibleMeshParts)
+            {
+                XMVECTOR center = XMLoadFloat3(&m_MeshPartBVH.GetBounds(part).Center);
+                // Projected depth (z / w): not linear, but in the same order as the view distance.
+                float depth = XMVectorGetZ(XMVector3TransformCoord(center, viewProjectionMatrix));
+                m_RenderQueue.Push(RenderQueue::MakeKey(0, 0, m_MeshPartMaterialIds[part], m_MeshPartTextureSetIds[part], depth), part);
+            }
+            m_RenderQueue.Sort();
+
+            const auto& entries = m_RenderQueue.GetEntries();
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                m_VisibleMeshParts[i] = entries[i].Item;
+            }
+            m_DrawSortTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sortStart).count();
+        }
+
+        SelectMeshPartLods(m_Camera.get_Translation());
+    }
+
+    m_NumMatricesBinds = 0;
+    m_NumMaterialBinds = 0;
+    m_NumTextureBinds = 0;
+    m_NumGBufferTriangles = 0;
+
+    // State shared by every command list recording G-Buffer draws.
+    auto setupGBuffer = [this](CommandList& gbufferCommandList)
+    {
+        gbufferCommandList.SetRenderTarget(m_GBufferRT);
+        gbufferCommandList.SetViewport(m_GBufferRT.GetViewport());
+        gbufferCommandList.SetScissorRect(m_ScissorRect);
 
         // Set G-Buffer PSO
-        commandList->SetPipelineState(m_GBufferPSO);
-        commandList->SetGraphicsRootSignature(m_GBufferRootSignature);
+        gbufferCommandList.SetPipelineState(m_QuantizedVertices ? m_GBufferQuantizedPSO : m_GBufferPSO);
+        gbufferCommandList.SetGraphicsRootSignature(m_GBufferRootSignature);
+    };
+
+    auto recordGBuffer = [this, &nodeMatrices](CommandList& gbufferCommandList, size_t begin, size_t end)
+    {
+        RecordGBufferDraws(gbufferCommandList, nodeMatrices, begin, end);
+    };
+
+    // Clear G-Buffer
+    FLOAT clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    commandList.ClearTexture(*m_GBufferRT.GetTexture(AttachmentPoint::Color0), clearColor);
+    commandList.ClearTexture(*m_GBufferRT.GetTexture(AttachmentPoint::Color1), clearColor);
+    commandList.ClearTexture(*m_GBufferRT.GetTexture(AttachmentPoint::Color2), clearColor);
+    commandList.ClearDepthStencilTexture(*m_GBufferRT.GetTexture(AttachmentPoint::DepthStencil), D3D12_CLEAR_FLAG_DEPTH);
+
+    // The streamed mips requested by the parts of this frame, uploaded before the draws: this command list is executed
+    // before the worker ones.
+    if (m_MipStreaming)
+    {
+        RequestTextureMips(m_Camera.get_Translation());
+        commandList.StreamTextureMips(static_cast<uint64_t>(m_MipStreamingBudgetKB) * 1024);
+    }
+    if (m_IndirectGBuffer && m_IndirectTextureResidency != CommandList::GetTextureStreamer().GetResidencyVersion())
+    {
+        UpdateIndirectTextureSRVs();
+    }
+
+    if (m_IndirectGBuffer)
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        IndirectCommands indirect = GetIndirectCommands();
+        SetupGBufferIndirect(commandList, viewMatrix, viewProjectionMatrix);
+
+        if (m_GpuCulling)
+        {
+            // Phase 1: the instances visible in the pyramid of the previous frame.
+            const auto& phase1Commands = indirect.Culling->GetCommands(0);
+            RecordGBufferIndirect(commandList, phase1Commands, indirect.NumCommands, &phase1Commands.GetCounterBuffer());
+        }
+        else
+        {
+            RecordGBufferIndirect(commandList, *indirect.Arguments, indirect.NumCommands);
+        }
+
+        m_GBufferRecordTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+        m_GBufferNumCommandLists = 1;
+    }
+    else if (m_ParallelGBufferRecording)
+    {
+        // Record the draws on the worker command lists, and submit them in order right after the clears.
+        // The next passes continue on a fresh command list.
+        auto commandLists = m_GBufferRecorder.Record(context.GetCommandQueue(), m_VisibleMeshParts.size(), setupGBuffer, recordGBuffer);
+        context.ExecuteCommandLists(commandLists);
+
+        m_GBufferRecordTimeMs = m_GBufferRecorder.GetLastRecordTimeMs();
+        m_GBufferNumCommandLists = m_GBufferRecorder.GetLastNumCommandLists();
+    }
+    else
+    {
+        auto startTime = std::chrono::high_resolution_clock::now();
 
         // Render meshes into G-Buffer (same loop as forward, but no lights needed)
-        // RENDER MODEL
+        setupGBuffer(commandList);
+        recordGBuffer(commandList, 0, m_VisibleMeshParts.size());
+
+        m_GBufferRecordTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+        m_GBufferNumCommandLists = 1;
+    }
+
+    // After the worker lists when recording in parallel: the context has a new command list.
+    if (m_InstancingTestScene)
+    {
+        RenderInstancingTestScene(context.GetCommandList(), viewMatrix, viewProjectionMatrix);
+    }
+}
+
+void Sample7::RenderDeferredLighting(CommandList& commandList, DirectX::CXMMATRIX viewProjectionMatrix)
+{
+    commandList.SetRenderTarget(m_HDRRenderTarget);
+    commandList.SetViewport(m_HDRRenderTarget.GetViewport());
+    commandList.SetScissorRect(m_ScissorRect);
+
+    commandList.SetPipelineState(m_DeferredLightingPSO);
+    commandList.SetGraphicsRootSignature(m_DeferredLightingRootSignature);
+
+    DeferredLightingCommon deferredLightingCommon;
+    deferredLightingCommon.NumPointLights = static_cast<uint32_t>(m_PointLights.size());
+    deferredLightingCommon.NumSpotLights = static_cast<uint32_t>(m_SpotLights.size());
+    deferredLightingCommon.InverseViewProjectionMatrix = XMMatrixInverse(nullptr, viewProjectionMatrix);
+    XMStoreFloat3(&deferredLightingCommon.CameraPositionWS, m_Camera.get_Translation()); // set deferredLightingCommon.CameraPositionW
+    deferredLightingCommon.LightingViewMode = static_cast<uint32_t>(m_LightingViewMode);
+
+    // CBs:
+    commandList.SetGraphics32BitConstants(DeferredRootParams::DeferredLightingCommonCB_Deferred, deferredLightingCommon);
+
+    // SRVs:
+    // 0-1: Light buffers
+    commandList.SetGraphicsDynamicStructuredBuffer(DeferredRootParams::PointLights_Deferred, m_PointLights);
+    commandList.SetGraphicsDynamicStructuredBuffer(DeferredRootParams::SpotLights_Deferred, m_SpotLights);
+
+    // 2-5: G-Buffer textures
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 0, *m_GBufferRT.GetTexture(AttachmentPoint::Color0), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);         // G-Buffer: AlbedoAO
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 1, *m_GBufferRT.GetTexture(AttachmentPoint::Color1), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);         // G-Buffer: Normal
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 2, *m_GBufferRT.GetTexture(AttachmentPoint::Color2), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);         // G-Buffer: PBR
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 3, *m_GBufferRT.GetTexture(AttachmentPoint::DepthStencil), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);   // G-Buffer: Depth
+
+    // 6-8: IBL textures
+    D3D12_SHADER_RESOURCE_VIEW_DESC irrSrvDesc = {};
+    irrSrvDesc.Format = m_IrradianceCubemap.GetD3D12ResourceDesc().Format;
+    irrSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    irrSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+    irrSrvDesc.TextureCube.MipLevels = 1;   // irradiance has 1 mip
+    
+    D3D12_SHADER_RESOURCE_VIEW_DESC specSrvDesc = irrSrvDesc;
+    specSrvDesc.Format = m_SpecularPrefilterCubemap.GetD3D12ResourceDesc().Format;
+    specSrvDesc.TextureCube.MipLevels = (UINT)-1;   // all mips
+
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 4, m_IrradianceCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, &irrSrvDesc);
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 5, m_SpecularPrefilterCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, &specSrvDesc);
+    commandList.SetShaderResourceView(DeferredRootParams::Textures_Deferred, 6, m_BrdfLut, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    // Draw full-screen triangle
+    commandList.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    commandList.Draw(3);
+}
+
+void Sample7::RenderHDRtoSDR(CommandList& commandList)
+{
+    auto& app = Application::Get();
+
+    commandList.SetRenderTarget(app.GetRenderTarget());
+    commandList.SetViewport(app.GetRenderTarget().GetViewport());
+    commandList.SetScissorRect(m_ScissorRect);
+    commandList.SetPipelineState(m_SDRPipelineState);
+    commandList.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    commandList.SetGraphicsRootSignature(m_SDRRootSignature);
+    commandList.SetGraphics32BitConstants(0, g_TonemapParameters);
+    commandList.SetShaderResourceView(1, 0, *m_HDRRenderTarget.GetTexture(Color0), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    commandList.Draw(3);
+}
+
+void Sample7::UpdateRecordingBenchmark()
+{
+    static const uint32_t NumFramesPerThreadCount = 120;
+
+    auto& benchmark = m_RecordingBenchmark;
+    if (!benchmark.Running)
+        return;
+
+    benchmark.TotalTimeMs += m_GBufferRecordTimeMs;
+    if (++benchmark.NumFrames < NumFramesPerThreadCount)
+        return;
+
+    double averageTimeMs = benchmark.TotalTimeMs / benchmark.NumFrames;
+    benchmark.AverageTimeMs.push_back(averageTimeMs);
+
+    char buffer[256];
+    sprintf_s(buffer, "G-Buffer recording: %u thread(s), %zu draws - %.3f ms\n", benchmark.NumThreads, m_VisibleMeshParts.size(), averageTimeMs);
+    OutputDebugStringA(buffer);
+
+    benchmark.NumFrames = 0;
+    benchmark.TotalTimeMs = 0.0;
+
+    if (benchmark.NumThreads >= ParallelCommandListRecorder::GetMaxNumThreads())
+    {
+        benchmark.Running = false;
+    }
+    else
+    {
+        m_GBufferRecorder.SetNumThreads(++benchmark.NumThreads);
+    }
+}
+
+void Sample7::SetupOccluders()
+{
+    m_OcclusionCuller.ClearOccluders();
+    m_IsOccluder.assign(m_LoadedMeshParts.size(), false);
+
+    // The best occluders cover a large area with few triangles (walls, floors, columns). Alpha tested parts (plants,
+    // chains) have holes, they can't hide anything.
+    std::vector<std::pair<float, uint32_t>> candidates;
+    for (uint32_t i = 0; i < m_LoadedMeshParts.size(); ++i)
+    {
+        const LoadedMeshPart& part = m_LoadedMeshParts[i];
+        if (part.alphaTested || part.geometry->indices.empty())
+            continue;
+
+        const XMFLOAT3& extents = m_MeshPartBVH.GetBounds(i).Extents;
+        float halfArea = extents.x * extents.y + extents.y * extents.z + extents.z * extents.x;
+        candidates.emplace_back(halfArea / (part.geometry->indices.size() / 3), i);
+    }
+    std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<float, uint32_t>>());
+
+    uint32_t numTriangles = 0;
+    for (const auto& candidate : candidates)
+    {
+        const LoadedMeshPart& part = m_LoadedMeshParts[candidate.second];
+        const LoadedMeshGeometry& geometry = *part.geometry;
+        uint32_t partTriangles = static_cast<uint32_t>(geometry.indices.size() / 3);
+        if (numTriangles + partTriangles > MAX_OCCLUDER_TRIANGLES)
+            continue;
+
+        // The culler keeps its own copy: world space positions.
+        std::vector<XMFLOAT3> positions(geometry.vertices.size());
+        XMVector3TransformCoordStream(positions.data(), sizeof(XMFLOAT3), &geometry.vertices[0].position, sizeof(VertexPositionNormalTexture),
+            geometry.vertices.size(), GetMeshPartWorldMatrix(part));
+
+        m_OcclusionCuller.AddOccluder(positions, std::vector<uint32_t>(geometry.indices.begin(), geometry.indices.end()));
+        m_IsOccluder[candidate.second] = true;
+        numTriangles += partTriangles;
+    }
+}
+
+XMMATRIX Sample7::GetMeshPartWorldMatrix(const LoadedMeshPart& part) const
+{
+    return XMLoadFloat4x4(&m_SceneGraph.GetWorldMatrix(part.node));
+}
+
+void Sample7::CreateInstancingTestScene()
+{
+    // A grid of small spheres over the floor of the atrium, the materials in a random order.
+    const uint32_t gridWidth = 200;
+    const uint32_t gridDepth = NUM_TEST_SPHERES / gridWidth;
+    const float spacing = 0.12f;
+    const float radius = 0.04f;
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<uint32_t> materialDistribution(0, NUM_TEST_MATERIALS - 1);
+
+    m_TestSphereWorldMatrices.resize(NUM_TEST_SPHERES);
+    m_TestSphereMaterials.resize(NUM_TEST_SPHERES);
+    for (uint32_t i = 0; i < NUM_TEST_SPHERES; ++i)
+    {
+        float x = (static_cast<float>(i % gridWidth) - gridWidth * 0.5f) * spacing;
+        float z = (static_cast<float>(i / gridWidth) - gridDepth * 0.5f) * spacing;
+
+        XMMATRIX worldMatrix = XMMatrixScaling(radius, radius, radius) * XMMatrixTranslation(x, 0.5f, z);
+        XMStoreFloat4x4(&m_TestSphereWorldMatrices[i], worldMatrix);
+        m_TestSphereMaterials[i] = materialDistribution(random);
+    }
+
+    m_TestMaterials = { Material::Red, Material::Green, Material::Blue, Material::Cyan,
+                        Material::Magenta, Material::Yellow, Material::Gold, Material::Silver };
+
+    m_InstanceBatcher.Reserve(NUM_TEST_SPHERES);
+}
+
+void Sample7::RenderInstancingTestScene(CommandList& commandList, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    commandList.SetRenderTarget(m_GBufferRT);
+    commandList.SetViewport(m_GBufferRT.GetViewport());
+    commandList.SetScissorRect(m_ScissorRect);
+
+    if (m_AutoInstancing)
+    {
+        commandList.SetPipelineState(m_GBufferInstancedPSO);
+        commandList.SetGraphicsRootSignature(m_GBufferInstancedRootSignature);
+
+        // Same mesh for every sphere: the batch key is the material.
+        m_InstanceBatcher.Clear();
+        for (uint32_t i = 0; i < NUM_TEST_SPHERES; ++i)
+        {
+            m_InstanceBatcher.AddDraw(m_TestSphereMaterials[i], i);
+        }
+        m_InstanceBatcher.Build();
+
+        // The instance data of all the batches, uploaded once.
+        const auto& instances = m_InstanceBatcher.GetInstances();
+        std::vector<InstanceData> instanceData(instances.size());
+        for (size_t i = 0; i < instances.size(); ++i)
         {
-            float scale = 1 / 10.0f;
+            XMMATRIX worldMatrix = XMLoadFloat4x4(&m_TestSphereWorldMatrices[instances[i]]);
+            instanceData[i].ModelMatrix = worldMatrix;
+            instanceData[i].InverseTransposeModelMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, worldMatrix));
+        }
 
-            XMMATRIX translationMatrix = XMMatrixTranslation(0.0f, 0.0f, 0.0f);
-            XMMATRIX rotationMatrix = XMMatrixIdentity();
-            XMMATRIX scaleMatrix = XMMatrixScaling(scale, scale, scale);
-            XMMATRIX worldMatrix = scaleMatrix * rotationMatrix * translationMatrix;
+        XMMATRIX matrices = viewProjectionMatrix;
+        commandList.SetGraphicsDynamicConstantBuffer(GbufferInstancedRootParams::MatricesCB_GBufferInstanced, matrices);
+        commandList.SetGraphicsDynamicStructuredBuffer(GbufferInstancedRootParams::Instances_GBufferInstanced, instanceData);
+        commandList.SetShaderResourceView(GbufferInstancedRootParams::Textures_GBufferInstanced, 0, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        commandList.SetShaderResourceView(GbufferInstancedRootParams::Textures_GBufferInstanced, 1, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        commandList.SetShaderResourceView(GbufferInstancedRootParams::Textures_GBufferInstanced, 2, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
+        for (const auto& batch : m_InstanceBatcher.GetBatches())
+        {
+            commandList.SetGraphics32BitConstants(GbufferInstancedRootParams::DrawConstants_GBufferInstanced, batch.FirstInstance);
+            commandList.SetGraphicsDynamicConstantBuffer(GbufferInstancedRootParams::MaterialCB_GBufferInstanced, m_TestMaterials[batch.Key]);
+            m_SphereMesh->Draw(commandList, batch.NumInstances);
+        }
+
+        m_NumTestSceneDraws = static_cast<uint32_t>(m_InstanceBatcher.GetBatches().size());
+    }
+    else
+    {
+        commandList.SetPipelineState(m_GBufferPSO);
+        commandList.SetGraphicsRootSignature(m_GBufferRootSignature);
+
+        commandList.SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 0, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        commandList.SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 1, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        commandList.SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 2, m_DefaultTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+        // One draw per sphere, the material only set when it changes.
+        uint32_t currentMaterial = UINT32_MAX;
+        for (uint32_t i = 0; i < NUM_TEST_SPHERES; ++i)
+        {
             Mat matrices;
-            ComputeMatrices(worldMatrix, viewMatrix, viewProjectionMatrix, matrices);
-            // --
-            commandList->SetGraphicsDynamicConstantBuffer(GbufferRootParams::MatricesCB_GBuffer, matrices);
+            ComputeMatrices(XMLoadFloat4x4(&m_TestSphereWorldMatrices[i]), viewMatrix, viewProjectionMatrix, matrices);
+            commandList.SetGraphicsDynamicConstantBuffer(GbufferRootParams::MatricesCB_GBuffer, matrices);
+
+            if (m_TestSphereMaterials[i] != currentMaterial)
+            {
+                currentMaterial = m_TestSphereMaterials[i];
+                commandList.SetGraphicsDynamicConstantBuffer(GbufferRootParams::MaterialCB_GBuffer, m_TestMaterials[currentMaterial]);
+            }
+
+            m_SphereMesh->Draw(commandList);
+        }
 
-            // Returns the frustum in view (camera) space
-            // --
-            // The projection matrix transforms from view space -> clip/projection space.
-            // So when you create a frustum from the projection matrix, the resulting planes represent the 
-            // view volume boundaries in the coordinate system where the camera is at the origin � which is view space.
-            DirectX::BoundingFrustum cameraFrustum;
-            DirectX::BoundingFrustum::CreateFromMatrix(cameraFrustum, m_Camera.get_ProjectionMatrix());
+        m_NumTestSceneDraws = NUM_TEST_SPHERES;
+    }
+
+    m_TestSceneRecordTimeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void Sample7::RecordGBufferDraws(CommandList& commandList, const std::vector<Mat>& nodeMatrices, size_t begin, size_t end)
+{
+    uint32_t currentNode = SceneGraph::InvalidNode;
+    uint32_t currentMaterial = UINT32_MAX;
+
+    const ID3D12Resource* currentDiffuse = nullptr;
+    const ID3D12Resource* currentRoughness = nullptr;
+    const ID3D12Resource* currentMetalness = nullptr;
+
+    uint32_t numMatricesBinds = 0;
+    uint32_t numMaterialBinds = 0;
+    uint32_t numTextureBinds = 0;
+    uint64_t numTriangles = 0;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint32_t partIndex = m_VisibleMeshParts[i];
+        const auto& part = m_LoadedMeshParts[partIndex];
+
+        if (part.node != currentNode)
+        {
+            commandList.SetGraphicsDynamicConstantBuffer(GbufferRootParams::MatricesCB_GBuffer, nodeMatrices[part.node]);
+            currentNode = part.node;
+            ++numMatricesBinds;
+        }
 
-            // Transform the Frustum from View to World space
-            XMMATRIX inverseView = XMMatrixInverse(nullptr, viewMatrix);
-            cameraFrustum.Transform(cameraFrustum, inverseView);
+        // [OPT_2] Only change material and textures if different (equal materials share an id, textures are compared
+        // by resource): the sorted draws share them as long as possible.
 
-            Material* currentMaterial = nullptr;
+        if (m_MeshPartMaterialIds[partIndex] != currentMaterial)
+        {
+            commandList.SetGraphicsDynamicConstantBuffer(GbufferRootParams::MaterialCB_GBuffer, part.material);
+            currentMaterial = m_MeshPartMaterialIds[partIndex];
+            ++numMaterialBinds;
+        }
+
+        if (part.diffuseTexture.GetD3D12Resource().Get() != currentDiffuse)
+        {
+            commandList.SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 0, part.diffuseTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            currentDiffuse = part.diffuseTexture.GetD3D12Resource().Get();
+            ++numTextureBinds;
+        }
+
+        if (part.roughnessTexture.GetD3D12Resource().Get() != currentRoughness)
+        {
+            commandList.SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 1, part.roughnessTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            currentRoughness = part.roughnessTexture.GetD3D12Resource().Get();
+            ++numTextureBinds;
+        }
+
+        if (part.metalnessTexture.GetD3D12Resource().Get() != currentMetalness)
+        {
+            commandList.SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 2, part.metalnessTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+            currentMetalness = part.metalnessTexture.GetD3D12Resource().Get();
+            ++numTextureBinds;
+        }
+
+        // The quantized mesh has the same LODs.
+        Mesh& mesh = m_QuantizedVertices ? *part.quantizedMesh : *part.mesh;
+        if (m_QuantizedVertices)
+        {
+            commandList.SetGraphics32BitConstants(GbufferRootParams::Dequantization_GBuffer, part.dequantization);
+        }
+
+        uint32_t lod = std::min<uint32_t>(m_DistanceLods ? m_MeshPartLods[partIndex] : 0, mesh.GetNumLods() - 1);
+        mesh.DrawLod(commandList, lod);
+        numTriangles += mesh.GetIndexCount(lod) / 3;
+    }
+
+    m_NumMatricesBinds += numMatricesBinds;
+    m_NumMaterialBinds += numMaterialBinds;
+    m_NumTextureBinds += numTextureBinds;
+    m_NumGBufferTriangles += numTriangles;
+}
+
+void Sample7::SelectMeshPartLods(FXMVECTOR cameraPosition)
+{
+    // Projected radius of the bounding sphere, as a fraction of the half height of the screen: LOD i is drawn above
+    // LOD_THRESHOLDS[i] (and LOD_THRESHOLDS[i - 1] below).
+    static const float LOD_THRESHOLDS[NUM_MESH_LODS] = { 0.25f, 0.12f, 0.05f, 0.0f };
+
+    const float tanHalfFov = std::tan(XMConvertToRadians(m_Camera.get_FoV()) * 0.5f);
+
+    std::fill(std::begin(m_NumPartsPerLod), std::end(m_NumPartsPerLod), 0);
+
+    for (uint32_t part : m_VisibleMeshParts)
+    {
+        const BoundingBox& bounds = m_MeshPartBVH.GetBounds(part);
+        float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+        float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - cameraPosition));
 
-            Texture* currentDiffuse = nullptr;
-            Texture* currentRoughness = nullptr;
-            Texture* currentMetalness = nullptr;
+        // Inside the sphere: as close as it gets.
+        float size = distance > radius ? radius / (distance * tanHalfFov) : FLT_MAX;
 
-            for (auto& part : m_LoadedMeshParts)
+        uint32_t lod = m_MeshPartLods[part];
+        float lower = LOD_THRESHOLDS[lod] * (1.0f - LOD_HYSTERESIS);
+        float upper = lod > 0 ? LOD_THRESHOLDS[lod - 1] * (1.0f + LOD_HYSTERESIS) : FLT_MAX;
+        if (size < lower || size >= upper)
+        {
+            lod = 0;
+            while (size < LOD_THRESHOLDS[lod])
             {
-                // Transform the mesh part's bounding box to World space
-                DirectX::BoundingBox worldBounds;
-                part.boundingBox.Transform(worldBounds, worldMatrix);
+                ++lod;
+            }
+            m_MeshPartLods[part] = static_cast<uint8_t>(lod);
+        }
 
-                // [OPT_1] Frustum culling in World space - cameraFrustum vs AABB of mesh part
-                if (!worldBounds.Intersects(cameraFrustum))
-                    continue;
+        ++m_NumPartsPerLod[lod];
+    }
+}
 
-                // [OPT_2] Only change material and textures if different
+void Sample7::RequestTextureMips(FXMVECTOR cameraPosition)
+{
+    // The pixels of a unit at a distance of 1.
+    const float projectionScale = m_RenderHeight / (2.0f * std::tan(XMConvertToRadians(m_Camera.get_FoV()) * 0.5f));
 
-                if (&part.material != currentMaterial)
-                {
-                    commandList->SetGraphicsDynamicConstantBuffer(GbufferRootParams::MaterialCB_GBuffer, part.material);
-                    currentMaterial = &part.material;
-                }
+    TextureStreamer& textureStreamer = CommandList::GetTextureStreamer();
+    auto requestPart = [&](uint32_t part)
+    {
+        const BoundingBox& bounds = m_MeshPartBVH.GetBounds(part);
+        float radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents)));
+        float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Center) - cameraPosition));
 
-                if (&part.diffuseTexture != currentDiffuse)
-                {
-                    commandList->SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 0, part.diffuseTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-                    currentDiffuse = &part.diffuseTexture;
-                }
+        // As if the textures were mapped once over the part: their texels cover its projected size.
+        float screenSize = MipStreamingScheduler::EstimateScreenSize(radius, distance, projectionScale);
+
+        const LoadedMeshPart& meshPart = m_LoadedMeshParts[part];
+        textureStreamer.Request(meshPart.diffuseTexture, screenSize);
+        textureStreamer.Request(meshPart.roughnessTexture, screenSize);
+        textureStreamer.Request(meshPart.metalnessTexture, screenSize);
+    };
+
+    // The ExecuteIndirect path culls on the GPU.
+    if (m_IndirectGBuffer)
+    {
+        for (uint32_t part = 0; part < static_cast<uint32_t>(m_LoadedMeshParts.size()); ++part)
+        {
+            requestPart(part);
+        }
+    }
+    else
+    {
+        for (uint32_t part : m_VisibleMeshParts)
+        {
+            requestPart(part);
+        }
+    }
+}
+
+void Sample7::AssignMeshPartStateIds()
+{
+    std::vector<const Material*> materials;
+    std::map<std::tuple<ID3D12Resource*, ID3D12Resource*, ID3D12Resource*>, uint32_t> textureSets;
+
+    m_MeshPartMaterialIds.resize(m_LoadedMeshParts.size());
+    m_MeshPartTextureSetIds.resize(m_LoadedMeshParts.size());
+
+    for (size_t i = 0; i < m_LoadedMeshParts.size(); ++i)
+    {
+        const LoadedMeshPart& part = m_LoadedMeshParts[i];
+
+        // Few unique materials: a linear search is enough.
+        auto material = std::find_if(materials.begin(), materials.end(), [&part](const Material* other)
+        {
+            return std::memcmp(other, &part.material, sizeof(Material)) == 0;
+        });
+        m_MeshPartMaterialIds[i] = static_cast<uint32_t>(material - materials.begin());
+        if (material == materials.end())
+        {
+            materials.push_back(&part.material);
+        }
+
+        auto textureSet = std::make_tuple(part.diffuseTexture.GetD3D12Resource().Get(), part.roughnessTexture.GetD3D12Resource().Get(),
+            part.metalnessTexture.GetD3D12Resource().Get());
+        m_MeshPartTextureSetIds[i] = textureSets.insert({ textureSet, static_cast<uint32_t>(textureSets.size()) }).first->second;
+    }
+
+    m_NumMaterials = static_cast<uint32_t>(materials.size());
+    m_NumTextureSets = static_cast<uint32_t>(textureSets.size());
+}
+
+void Sample7::BuildIndirectDraws(CommandList& commandList)
+{
+    auto& app = Application::Get();
+
+    // The G-Buffer vertex shader has a single model matrix for the whole ExecuteIndirect: the path is only available
+    // when every mesh part has the same world matrix (eg. a single node, or nodes without transform).
+    m_NumIndirectDraws = 0;
+    for (const auto& part : m_LoadedMeshParts)
+    {
+        const XMFLOAT4X4& worldMatrix = m_SceneGraph.GetWorldMatrix(part.node);
+        if (std::memcmp(&worldMatrix, &m_SceneGraph.GetWorldMatrix(m_LoadedMeshParts.front().node), sizeof(XMFLOAT4X4)) != 0)
+        {
+            m_IndirectGBuffer = false;
+            return;
+        }
+    }
+
+    // The mesh parts share the loaded textures: gather the unique ones (by resource).
+    std::map<ID3D12Resource*, uint32_t> textureIndices;
+    auto getTextureIndex = [this, &textureIndices](const Texture& texture)
+    {
+        auto result = textureIndices.insert({ texture.GetD3D12Resource().Get(), static_cast<uint32_t>(m_IndirectTextures.size()) });
+        if (result.second)
+        {
+            m_IndirectTextures.push_back(&texture);
+        }
+        return result.first->second;
+    };
 
-                if (&part.roughnessTexture != currentRoughness)
+    IndirectDrawBuilder builder;
+    std::vector<IndirectDrawData> drawData;
+    drawData.reserve(m_LoadedMeshParts.size());
+
+    // World-space bounds for the GPU culling, in the order of the commands.
+    std::vector<CullingMath::InstanceBounds> instanceBounds;
+    instanceBounds.reserve(m_LoadedMeshParts.size());
+
+    // The same per-draw data for the meshlets of a part: their DrawIndex is the one of the part.
+    IndirectDrawBuilder meshletBuilder;
+    std::vector<CullingMath::InstanceBounds> meshletBounds;
+    m_MeshletCones.clear();
+
+    // The same commands with the quantized meshes (same draw indices, indices and culling data).
+    IndirectDrawBuilder quantizedBuilder;
+    IndirectDrawBuilder quantizedMeshletBuilder;
+    std::vector<VertexQuantizer::Dequantization> dequantization;
+    dequantization.reserve(m_LoadedMeshParts.size());
+
+    for (const auto& part : m_LoadedMeshParts)
+    {
+        const Mesh& mesh = *part.mesh;
+        uint32_t drawIndex = builder.AddDraw(mesh.GetVertexBuffer().GetVertexBufferView(), mesh.GetIndexBuffer().GetIndexBufferView(),
+            mesh.GetIndexCount(), mesh.GetStartIndex(), mesh.GetBaseVertex());
+
+        const Mesh* quantizedMesh = m_HasQuantizedVertices ? part.quantizedMesh.get() : nullptr;
+        if (quantizedMesh)
+        {
+            quantizedBuilder.AddDraw(quantizedMesh->GetVertexBuffer().GetVertexBufferView(), quantizedMesh->GetIndexBuffer().GetIndexBufferView(),
+                quantizedMesh->GetIndexCount(), quantizedMesh->GetStartIndex(), quantizedMesh->GetBaseVertex());
+        }
+        dequantization.push_back(part.dequantization);
+
+        const LoadedMeshGeometry& geometry = *part.geometry;
+        if (!geometry.meshlets.empty())
+        {
+            XMMATRIX worldMatrix = GetMeshPartWorldMatrix(part);
+            // The cones are only scaled uniformly (the length of the axis after the transform).
+            for (size_t m = 0; m < geometry.meshlets.size(); ++m)
+            {
+                const MeshletBuilder::Meshlet& meshlet = geometry.meshlets[m];
+                const MeshletBuilder::Bounds& objectBounds = geometry.meshletBounds[m];
+
+                meshletBuilder.AddDraw(mesh.GetVertexBuffer().GetVertexBufferView(), mesh.GetIndexBuffer().GetIndexBufferView(),
+                    meshlet.TriangleCount * 3, mesh.GetStartIndex() + meshlet.TriangleOffset * 3, mesh.GetBaseVertex(), 1, drawIndex);
+                if (quantizedMesh)
                 {
-                    commandList->SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 1, part.roughnessTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-                    currentRoughness = &part.roughnessTexture;
+                    quantizedMeshletBuilder.AddDraw(quantizedMesh->GetVertexBuffer().GetVertexBufferView(), quantizedMesh->GetIndexBuffer().GetIndexBufferView(),
+                        meshlet.TriangleCount * 3, quantizedMesh->GetStartIndex() + meshlet.TriangleOffset * 3, quantizedMesh->GetBaseVertex(), 1, drawIndex);
                 }
 
-                if (&part.metalnessTexture != currentMetalness)
+                // The box of the meshlet's vertices for the frustum and Hi-Z tests, the sphere and the cone for the backface test.
+                std::vector<XMFLOAT3> points(meshlet.VertexCount);
+                for (uint32_t v = 0; v < meshlet.VertexCount; ++v)
                 {
-                    commandList->SetShaderResourceView(GbufferRootParams::Textures_GBuffer, 2, part.metalnessTexture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-                    currentMetalness = &part.metalnessTexture;
+                    points[v] = geometry.vertices[geometry.meshletVertices[meshlet.VertexOffset + v]].position;
                 }
-
-                part.mesh->Draw(*commandList);
+                DirectX::BoundingBox box;
+                DirectX::BoundingBox::CreateFromPoints(box, points.size(), points.data(), sizeof(XMFLOAT3));
+                box.Transform(box, worldMatrix);
+
+                CullingMath::InstanceBounds bounds = {};
+                bounds.Center = box.Center;
+                bounds.Extents = box.Extents;
+                meshletBounds.push_back(bounds);
+
+                XMVECTOR axis = XMVector3TransformNormal(XMLoadFloat3(&objectBounds.ConeAxis), worldMatrix);
+                float scale = XMVectorGetX(XMVector3Length(XMVector3TransformNormal(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), worldMatrix)));
+
+                CullingMath::InstanceCone cone = {};
+                XMStoreFloat3(&cone.Center, XMVector3TransformCoord(XMLoadFloat3(&objectBounds.Center), worldMatrix));
+                cone.Radius = objectBounds.Radius * scale;
+                XMStoreFloat3(&cone.Axis, objectBounds.ConeCutoff < 1.0f ? XMVector3Normalize(axis) : XMVectorZero());
+                cone.Cutoff = objectBounds.ConeCutoff;
+                m_MeshletCones.push_back(cone);
             }
         }
+
+        IndirectDrawData data;
+        data.PartMaterial = part.material;
+        data.DiffuseTextureIndex = getTextureIndex(part.diffuseTexture);
+        data.RoughnessTextureIndex = getTextureIndex(part.roughnessTexture);
+        data.MetalnessTextureIndex = getTextureIndex(part.metalnessTexture);
+        data._Padding = 0;
+        drawData.push_back(data);
+
+        DirectX::BoundingBox worldBounds;
+        part.boundingBox.Transform(worldBounds, GetMeshPartWorldMatrix(part));
+
+        CullingMath::InstanceBounds bounds = {};
+        bounds.Center = worldBounds.Center;
+        bounds.Extents = worldBounds.Extents;
+        instanceBounds.push_back(bounds);
     }
 
-    // === PASS 2: Deferred Lighting ===
+    m_NumIndirectDraws = builder.GetNumCommands();
+    if (m_NumIndirectDraws == 0)
+        return;
+
+    commandList.CopyStructuredBuffer(m_IndirectArgumentBuffer, builder.GetNumCommands(), IndirectDrawBuilder::GetByteStride(), builder.GetCommands().data());
+    commandList.CopyStructuredBuffer(m_IndirectDrawDataBuffer, drawData);
+    // Also without quantized meshes: the shaders see the whole descriptor table.
+    commandList.CopyStructuredBuffer(m_IndirectDequantizationBuffer, dequantization);
+    if (m_HasQuantizedVertices)
     {
-        PIX_SCOPE_MARKER(profiler, commandList->GetGraphicsCommandList().Get(), L"DEFERRED_LIGHTING");
+        commandList.CopyStructuredBuffer(m_QuantizedArgumentBuffer, quantizedBuilder.GetNumCommands(), IndirectDrawBuilder::GetByteStride(),
+            quantizedBuilder.GetCommands().data());
+    }
 
-        commandList->SetRenderTarget(m_HDRRenderTarget);
-        commandList->SetViewport(m_HDRRenderTarget.GetViewport());
-        commandList->SetScissorRect(m_ScissorRect);
+    m_InstanceCulling.SetInstances(commandList, instanceBounds);
 
-        commandList->SetPipelineState(m_DeferredLightingPSO);
-        commandList->SetGraphicsRootSignature(m_DeferredLightingRootSignature);
+    // Only when every mesh part has meshlets.
+    m_NumMeshletDraws = 0;
+    if (meshletBuilder.GetNumCommands() > 0 && std::all_of(m_LoadedMeshParts.begin(), m_LoadedMeshParts.end(),
+        [](const LoadedMeshPart& part) { return !part.geometry->meshlets.empty(); }))
+    {
+        m_NumMeshletDraws = meshletBuilder.GetNumCommands();
+        commandList.CopyStructuredBuffer(m_MeshletArgumentBuffer, m_NumMeshletDraws, IndirectDrawBuilder::GetByteStride(), meshletBuilder.GetCommands().data());
+        if (m_HasQuantizedVertices)
+        {
+            commandList.CopyStructuredBuffer(m_QuantizedMeshletArgumentBuffer, m_NumMeshletDraws, IndirectDrawBuilder::GetByteStride(),
+                quantizedMeshletBuilder.GetCommands().data());
+        }
+        m_MeshletCulling.SetInstances(commandList, meshletBounds, m_MeshletCones);
+    }
 
-        DeferredLightingCommon deferredLightingCommon;
-        deferredLightingCommon.NumPointLights = static_cast<uint32_t>(m_PointLights.size());
-        deferredLightingCommon.NumSpotLights = static_cast<uint32_t>(m_SpotLights.size());
-        deferredLightingCommon.InverseViewProjectionMatrix = XMMatrixInverse(nullptr, viewProjectionMatrix);
-        XMStoreFloat3(&deferredLightingCommon.CameraPositionWS, m_Camera.get_Translation()); // set deferredLightingCommon.CameraPositionW
-        deferredLightingCommon.LightingViewMode = static_cast<uint32_t>(m_LightingViewMode);
+    // Contiguous copies of the texture SRVs, so the whole table is staged with a single call.
+    uint32_t numTextures = static_cast<uint32_t>(m_IndirectTextures.size());
+    m_IndirectTextureSRVs = app.AllocateDescriptors(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, numTextures);
+    UpdateIndirectTextureSRVs();
+}
 
-        // CBs:
-        commandList->SetGraphics32BitConstants(DeferredRootParams::DeferredLightingCommonCB_Deferred, deferredLightingCommon);
+void Sample7::UpdateIndirectTextureSRVs()
+{
+    auto device = Application::Get().GetDevice();
 
-        // SRVs:
-        // 0-1: Light buffers
-        commandList->SetGraphicsDynamicStructuredBuffer(DeferredRootParams::PointLights_Deferred, m_PointLights);
-        commandList->SetGraphicsDynamicStructuredBuffer(DeferredRootParams::SpotLights_Deferred, m_SpotLights);
+    // Staged by the draws when they are recorded: the command lists already recorded keep their copies.
+    m_IndirectTextureResidency = CommandList::GetTextureStreamer().GetResidencyVersion();
+    for (uint32_t i = 0; i < static_cast<uint32_t>(m_IndirectTextures.size()); ++i)
+    {
+        device->CopyDescriptorsSimple(1, m_IndirectTextureSRVs.GetDescriptorHandle(i), m_IndirectTextures[i]->GetShaderResourceView(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+}
 
-        // 2-5: G-Buffer textures
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 0, *m_GBufferRT.GetTexture(AttachmentPoint::Color0), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);         // G-Buffer: AlbedoAO
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 1, *m_GBufferRT.GetTexture(AttachmentPoint::Color1), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);         // G-Buffer: Normal
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 2, *m_GBufferRT.GetTexture(AttachmentPoint::Color2), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);         // G-Buffer: PBR
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 3, *m_GBufferRT.GetTexture(AttachmentPoint::DepthStencil), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);   // G-Buffer: Depth
+Sample7::IndirectCommands Sample7::GetIndirectCommands()
+{
+    bool drawMeshlets = m_ClusterCulling && m_NumMeshletDraws > 0;
 
-        // 6-8: IBL textures
-        D3D12_SHADER_RESOURCE_VIEW_DESC irrSrvDesc = {};
-        irrSrvDesc.Format = m_IrradianceCubemap.GetD3D12ResourceDesc().Format;
-        irrSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        irrSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
-        irrSrvDesc.TextureCube.MipLevels = 1;   // irradiance has 1 mip
-        
-        D3D12_SHADER_RESOURCE_VIEW_DESC specSrvDesc = irrSrvDesc;
-        specSrvDesc.Format = m_SpecularPrefilterCubemap.GetD3D12ResourceDesc().Format;
-        specSrvDesc.TextureCube.MipLevels = (UINT)-1;   // all mips
+    IndirectCommands indirect;
+    indirect.Arguments = m_QuantizedVertices ? (drawMeshlets ? &m_QuantizedMeshletArgumentBuffer : &m_QuantizedArgumentBuffer) :
+        (drawMeshlets ? &m_MeshletArgumentBuffer : &m_IndirectArgumentBuffer);
+    indirect.NumCommands = drawMeshlets ? m_NumMeshletDraws : m_NumIndirectDraws;
+    indirect.Culling = drawMeshlets ? &m_MeshletCulling : &m_InstanceCulling;
+
+    return indirect;
+}
 
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 4, m_IrradianceCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, &irrSrvDesc);
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 5, m_SpecularPrefilterCubemap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, &specSrvDesc);
-        commandList->SetShaderResourceView(DeferredRootParams::Textures_Deferred, 6, m_BrdfLut, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+void Sample7::SetupGBufferIndirect(CommandList& commandList, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix)
+{
+    // A single model matrix for every command: BuildIndirectDraws checked that the parts share their world matrix.
+    Mat matrices;
+    ComputeMatrices(GetMeshPartWorldMatrix(m_LoadedMeshParts.front()), viewMatrix, viewProjectionMatrix, matrices);
 
-        // Draw full-screen triangle
-        commandList->SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        commandList->Draw(3);
-    }
+    commandList.SetRenderTarget(m_GBufferRT);
+    commandList.SetViewport(m_GBufferRT.GetViewport());
+    commandList.SetScissorRect(m_ScissorRect);
+
+    commandList.SetPipelineState(m_QuantizedVertices ? m_GBufferIndirectQuantizedPSO : m_GBufferIndirectPSO);
+    commandList.SetGraphicsRootSignature(m_GBufferIndirectRootSignature);
+
+    commandList.SetGraphicsDynamicConstantBuffer(GbufferIndirectRootParams::MatricesCB_GBufferIndirect, matrices);
+}
+
+void Sample7::RecordGBufferIndirect(CommandList& commandList, const StructuredBuffer& commands, uint32_t maxCommands, const Resource* countBuffer)
+{
+    // The vertex / index buffers and the draw index are set by the commands.
+    commandList.SetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    commandList.SetShaderResourceView(GbufferIndirectRootParams::DrawData_GBufferIndirect, 0, m_IndirectDrawDataBuffer, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    commandList.SetShaderResourceView(GbufferIndirectRootParams::DrawData_GBufferIndirect, 1, m_IndirectDequantizationBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    // No transition of the textures: they stay in D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE (StreamTextureMips moves
+    // the streamed ones back after their copies).
+    commandList.SetShaderResourceViews(GbufferIndirectRootParams::Textures_GBufferIndirect, 0, m_IndirectTextureSRVs.GetNumHandles(), m_IndirectTextureSRVs.GetDescriptorHandle());
+
+    commandList.ExecuteIndirect(m_GBufferCommandSignature.Get(), maxCommands, commands, 0, countBuffer);
 }
 
 static bool g_AllowFullscreenToggle = true;
@@ -1415,6 +2855,31 @@ void Sample7::OnMouseMoved(MouseMotionEventArgs& e)
 }
 
 
+void Sample7::OnMouseButtonPressed(MouseButtonEventArgs& e)
+{
+    Game::OnMouseButtonPressed(e);
+
+    if (!ImGui::GetIO().WantCaptureMouse && e.Button == MouseButtonEventArgs::Right)
+    {
+        // Ray from the near to the far plane, through the center of the pixel.
+        float x = (2.0f * (e.X + 0.5f)) / m_Width - 1.0f;
+        float y = 1.0f - (2.0f * (e.Y + 0.5f)) / m_Height;
+
+        XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, m_Camera.get_ViewMatrix() * m_Camera.get_ProjectionMatrix());
+
+        XMFLOAT3 origin, farPoint;
+        XMStoreFloat3(&origin, XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), inverseViewProjection));
+        XMStoreFloat3(&farPoint, XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), inverseViewProjection));
+        XMFLOAT3 direction(farPoint.x - origin.x, farPoint.y - origin.y, farPoint.z - origin.z);
+
+        float distance;
+        if (!m_MeshPartBVH.Raycast(origin, direction, 1.0f, m_PickedMeshPart, distance))
+        {
+            m_PickedMeshPart = BoundingVolumeHierarchy::InvalidIndex;
+        }
+    }
+}
+
 void Sample7::OnMouseWheel(MouseWheelEventArgs& e)
 {
     Game::OnMouseWheel(e);
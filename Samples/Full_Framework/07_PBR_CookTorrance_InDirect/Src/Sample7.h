@@ -5,8 +5,22 @@
 #include <Framework/Material/Texture.h>
 #include <Framework/Material/RenderTarget.h>
 #include <Framework/Material/Mesh.h>
+#include <Framework/Material/GeometryPool.h>
+#include <Framework/Material/StructuredBuffer.h>
 // --
 #include <Framework/RootSignature.h>
+#include <Framework/DescriptorAllocation.h>
+#include <Framework/ParallelCommandListRecorder.h>
+#include <Framework/BoundingVolumeHierarchy.h>
+#include <Framework/FrameGraph.h>
+#include <Framework/FrustumCuller.h>
+#include <Framework/GpuCulling.h>
+#include <Framework/InstanceBatcher.h>
+#include <Framework/RenderQueue.h>
+#include <Framework/SceneGraph.h>
+#include <Framework/SoftwareOcclusionCuller.h>
+#include <Framework/VertexCacheOptimizer.h>
+#include <Framework/VertexQuantizer.h>
 
 #include <Framework/Gameplay/AssimpLoader.h>
 #include <Framework/Gameplay/Camera.h>
@@ -16,6 +30,8 @@
 
 #include <DirectXMath.h>
 
+#include <atomic>
+
 enum class LightingViewMode : uint32_t
 {
     Final = 0,           // Normal lit output
@@ -33,6 +49,9 @@ enum class LightingViewMode : uint32_t
 
 const bool g_CaptureGPUTraceOnLoadAssets = false;
 
+// Matrices constant buffer of the G-Buffer pass (Sample7.cpp).
+struct Mat;
+
 class Sample7 : public Game
 {
 public:
@@ -48,7 +67,44 @@ protected:
     virtual void OnUpdate() override;
     virtual void OnRender() override;
 
-    void RenderDeferred(std::shared_ptr<CommandList> commandList, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix);
+    // Declare the render passes of the frame in m_FrameGraph.
+    void BuildFrameGraph(DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix);
+    // Attach the transient textures of the frame graph to m_HDRRenderTarget and m_GBufferRT.
+    void AttachRenderTargets();
+
+    // Frame graph passes.
+    void RenderSkybox(CommandList& commandList);
+    // With parallel G-Buffer recording, the worker lists are executed through the context
+    // and the next passes continue on a new command list.
+    // With the GPU culling, only the phase 1 draws (see BuildFrameGraph for the culling passes).
+    void RenderGBuffer(FrameGraph::PassContext& context, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix);
+    void RenderDeferredLighting(CommandList& commandList, DirectX::CXMMATRIX viewProjectionMatrix);
+    void RenderHDRtoSDR(CommandList& commandList);
+    // Record the G-Buffer draws of m_VisibleMeshParts[begin, end).
+    // @param nodeMatrices - The matrices of each scene graph node.
+    void RecordGBufferDraws(CommandList& commandList, const std::vector<Mat>& nodeMatrices, size_t begin, size_t end);
+
+    // World matrix of the scene graph node of the part.
+    DirectX::XMMATRIX GetMeshPartWorldMatrix(const LoadedMeshPart& part) const;
+
+    // Build the argument and per-draw data buffers of the ExecuteIndirect path (all the mesh parts).
+    void BuildIndirectDraws(CommandList& commandList);
+    // Copy the current SRVs of m_IndirectTextures to m_IndirectTextureSRVs (the streamed textures change theirs).
+    void UpdateIndirectTextureSRVs();
+    // The commands of the ExecuteIndirect path: one per mesh part, or per meshlet (same per-draw data, finer culling).
+    struct IndirectCommands
+    {
+        const StructuredBuffer* Arguments;      // The quantized commands only differ by their vertex / index buffer views.
+        uint32_t                NumCommands;
+        GpuCulling*             Culling;        // Each has its own flags and pyramid history.
+    };
+    IndirectCommands GetIndirectCommands();
+    // Set the G-Buffer render target, PSO, root signature and matrices of the ExecuteIndirect draws.
+    void SetupGBufferIndirect(CommandList& commandList, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix);
+    // Draw the commands with a single ExecuteIndirect (PSO, root signature and matrices already set).
+    // @param maxCommands - The number of commands of the buffer.
+    // @param countBuffer - The number of commands to draw (GPU culling), nullptr for all of them.
+    void RecordGBufferIndirect(CommandList& commandList, const StructuredBuffer& commands, uint32_t maxCommands, const Resource* countBuffer = nullptr);
 
     // Invoked by the registered window when a key is pressed while the window has focus.
     virtual void OnKeyPressed(KeyEventArgs& e) override;
@@ -59,6 +115,9 @@ protected:
     // Invoked when the mouse is moved over the registered window.
     virtual void OnMouseMoved(MouseMotionEventArgs& e);
 
+    // Invoked when a mouse button is pressed over the registered window (right click picks a mesh part).
+    virtual void OnMouseButtonPressed(MouseButtonEventArgs& e) override;
+
     // Invoked when the mouse wheel is scrolled while the registered window has focus.
     virtual void OnMouseWheel(MouseWheelEventArgs& e) override;
 
@@ -78,7 +137,7 @@ private: /* DEFERRED RENDERING */
     LightingViewMode m_LightingViewMode = LightingViewMode::Final;
 
     static const int NUM_GBUFFER_RTS = 3;   // GBuff RTs: RT0=AlbedoAO, RT1=Normal, RT2=Roughness,Metalness,EmissiveMask
-	RenderTarget m_GBufferRT;               // Will hold multiple Color attachment Textures and a Depth buffer for the G-Buffer pass.
+	RenderTarget m_GBufferRT;               // Will hold multiple Color attachment Textures and a Depth buffer for the G-Buffer pass (transient, see AttachRenderTargets).
 
     // Root signatures for deferred path
     RootSignature m_GBufferRootSignature;
@@ -88,10 +147,177 @@ private: /* DEFERRED RENDERING */
     Microsoft::WRL::ComPtr<ID3D12PipelineState> m_GBufferPSO;
     Microsoft::WRL::ComPtr<ID3D12PipelineState> m_DeferredLightingPSO;
 
+    // World-space bounds of the mesh parts (SoA, and a hierarchy over them), in the order of m_LoadedMeshParts.
+    FrustumCuller           m_MeshPartCuller;
+    BoundingVolumeHierarchy m_MeshPartBVH;
+    bool                    m_BVHCulling = true;
+    uint32_t                m_NumVisitedBVHNodes = 0;
+    uint32_t                m_PickedMeshPart = BoundingVolumeHierarchy::InvalidIndex;
+    // Indices (into m_LoadedMeshParts) of the mesh parts that passed the frustum culling.
+    std::vector<uint32_t>   m_VisibleMeshParts;
+    double                  m_FrustumCullTimeMs = 0.0;
+
+    // CPU occlusion culling of the visible mesh parts: the largest opaque parts (walls, columns) are rasterized into a
+    // low-resolution depth buffer, the boxes of the other parts are tested against it.
+    static const uint32_t       OCCLUSION_BUFFER_WIDTH = 320;
+    static const uint32_t       MAX_OCCLUDER_TRIANGLES = 8192;
+    bool                        m_SoftwareOcclusion = true;
+    SoftwareOcclusionCuller     m_OcclusionCuller;
+    std::vector<bool>           m_IsOccluder;           // Per mesh part.
+    uint32_t                    m_NumOccludedMeshParts = 0;
+    double                      m_OcclusionCullTimeMs = 0.0;
+
+    // Pick the occluders among the mesh parts and give them to m_OcclusionCuller.
+    void SetupOccluders();
+
+    // [OPT_2] State sorting of the visible mesh parts: material and texture set ids are assigned at load time (equal
+    // values share an id), the draws are sorted every frame by RenderQueue keys.
+    bool                    m_SortDraws = true;
+    RenderQueue             m_RenderQueue;
+    std::vector<uint32_t>   m_MeshPartMaterialIds;      // Per mesh part.
+    std::vector<uint32_t>   m_MeshPartTextureSetIds;    // Per mesh part: diffuse, roughness and metalness.
+    uint32_t                m_NumMaterials = 0;
+    uint32_t                m_NumTextureSets = 0;
+    double                  m_DrawSortTimeMs = 0.0;
+    // Binds recorded by RecordGBufferDraws in the last frame (all the command lists).
+    std::atomic<uint32_t>   m_NumMatricesBinds{ 0 };
+    std::atomic<uint32_t>   m_NumMaterialBinds{ 0 };
+    std::atomic<uint32_t>   m_NumTextureBinds{ 0 };
+
+    // Give the same id to the parts with equal materials, and to the parts with the same textures.
+    void AssignMeshPartStateIds();
+
+    // Distance LODs: the meshes are simplified at load time (MeshSimplifier, the LODs are ranges of the same index
+    // buffers), a visible part draws the LOD picked by the projected size of its bounding sphere. A part only changes
+    // LOD once its size is LOD_HYSTERESIS past the thresholds of its current one, so it doesn't flicker between two.
+    static const uint32_t   NUM_MESH_LODS = 4;
+    static constexpr float  LOD_HYSTERESIS = 0.2f;
+    bool                    m_DistanceLods = true;
+    std::vector<uint8_t>    m_MeshPartLods;             // Per mesh part, kept between the frames.
+    uint32_t                m_NumPartsPerLod[NUM_MESH_LODS] = {};
+    double                  m_MeshLoadTimeMs = 0.0;     // Model load, LODs included.
+    // The processed model is cached there: the next starts map it instead of importing the file (see ModelCache).
+    static constexpr const wchar_t* MESH_CACHE_DIRECTORY = L"Cache/Models";
+    bool                    m_MeshLoadedFromCache = false;  // Warm start.
+    bool                    m_MeshCacheCleared = false;
+
+    // VRAM budget of the texture cache: the textures no mesh part uses anymore are evicted beyond it (see TextureCache).
+    int                                 m_TextureCacheBudgetMB = 1024;
+    // The textures are given their mips and block compressed once, the DDS files are kept there (see TextureProcessor).
+    static constexpr const wchar_t* TEXTURE_CACHE_DIRECTORY = L"Cache/Textures";
+    bool                                m_TextureProcessingCacheCleared = false;
+
+    // Mip streaming (see TextureStreamer): the model's large textures are loaded with their mip tail only, the other
+    // mips are uploaded in the order of the screen size of the parts drawn with them, m_MipStreamingBudgetKB per frame.
+    bool                                m_MipStreaming = true;              // Off: no uploads (the textures stay clamped).
+    int                                 m_MipStreamingBudgetKB = 4096;
+
+    // Request the mips of the textures of the parts drawn this frame (all of them on the ExecuteIndirect path).
+    void RequestTextureMips(DirectX::FXMVECTOR cameraPosition);
+    std::atomic<uint64_t>   m_NumGBufferTriangles{ 0 }; // Recorded by RecordGBufferDraws in the last frame.
+
+    // Update m_MeshPartLods for the visible mesh parts.
+    void SelectMeshPartLods(DirectX::FXMVECTOR cameraPosition);
+
+    // Post-transform cache of the model's meshes (full resolution) before and after the load time optimization
+    // (VertexCacheOptimizer), summed over the meshes: ACMR per triangle, ATVR per vertex.
+    VertexCacheOptimizer::Statistics    m_VertexCacheBefore;
+    VertexCacheOptimizer::Statistics    m_VertexCacheAfter;
+
+    // Quantized vertices (VertexQuantizer, 16 bytes instead of 32): the model's meshes are also loaded in that layout,
+    // drawn instead of the float ones when m_QuantizedVertices is set (regular and ExecuteIndirect paths).
+    bool                                            m_QuantizedVertices = true;
+    bool                                            m_HasQuantizedVertices = false;     // Every mesh part has a quantized mesh.
+    uint64_t                                        m_NumModelVertices = 0;             // Each mesh once.
+    VertexQuantizer::Error                          m_QuantizationError;                // The largest of the mesh parts.
+    Microsoft::WRL::ComPtr<ID3D12PipelineState>     m_GBufferQuantizedPSO;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState>     m_GBufferIndirectQuantizedPSO;
+    StructuredBuffer                                m_QuantizedArgumentBuffer;          // IndirectDrawBuilder::DrawCommand per mesh part.
+    StructuredBuffer                                m_QuantizedMeshletArgumentBuffer;   // IndirectDrawBuilder::DrawCommand per meshlet.
+    StructuredBuffer                                m_IndirectDequantizationBuffer;     // VertexQuantizer::Dequantization per mesh part.
+
+    // Instancing test scene: a grid of spheres with a few materials, drawn after the model into the G-Buffer.
+    // With automatic instancing the spheres are grouped by material (InstanceBatcher), one instanced draw per group.
+    static const uint32_t                           NUM_TEST_SPHERES = 10000;
+    static const uint32_t                           NUM_TEST_MATERIALS = 8;
+    bool                                            m_InstancingTestScene = false;
+    bool                                            m_AutoInstancing = true;
+    InstanceBatcher                                 m_InstanceBatcher;
+    std::vector<DirectX::XMFLOAT4X4>                m_TestSphereWorldMatrices;
+    std::vector<uint32_t>                           m_TestSphereMaterials;      // Per sphere, into m_TestMaterials.
+    std::vector<Material>                           m_TestMaterials;
+    RootSignature                                   m_GBufferInstancedRootSignature;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState>     m_GBufferInstancedPSO;
+    uint32_t                                        m_NumTestSceneDraws = 0;
+    double                                          m_TestSceneRecordTimeMs = 0.0;
+
+    // Place the spheres of the instancing test scene.
+    void CreateInstancingTestScene();
+    // Draw the test scene into the G-Buffer, one draw per sphere or one instanced draw per material.
+    void RenderInstancingTestScene(CommandList& commandList, DirectX::CXMMATRIX viewMatrix, DirectX::CXMMATRIX viewProjectionMatrix);
+
+    // Parallel G-Buffer recording
+    bool                        m_ParallelGBufferRecording = false;
+    ParallelCommandListRecorder m_GBufferRecorder;
+    double                      m_GBufferRecordTimeMs = 0.0;
+    uint32_t                    m_GBufferNumCommandLists = 0;
+
+    // ExecuteIndirect G-Buffer path: one command per mesh part, built once at load time.
+    // Without GPU culling, the commands of all the mesh parts are executed.
+    bool                                            m_IndirectGBuffer = false;
+    RootSignature                                   m_GBufferIndirectRootSignature;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState>     m_GBufferIndirectPSO;
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature>  m_GBufferCommandSignature;
+    StructuredBuffer                                m_IndirectArgumentBuffer;   // IndirectDrawBuilder::DrawCommand per mesh part.
+    StructuredBuffer                                m_IndirectDrawDataBuffer;   // IndirectDrawData (material, texture indices) per mesh part.
+    std::vector<const Texture*>                     m_IndirectTextures;         // The unique textures of the mesh parts.
+    DescriptorAllocation                            m_IndirectTextureSRVs;      // Contiguous SRVs of m_IndirectTextures.
+    uint64_t                                        m_IndirectTextureResidency = 0; // TextureStreamer::GetResidencyVersion of the copies.
+    uint32_t                                        m_NumIndirectDraws = 0;
+
+    // GPU culling of the ExecuteIndirect path (replaces the CPU frustum culling): frustum + two-phase Hi-Z occlusion.
+    bool                                            m_GpuCulling = true;
+    GpuCulling                                      m_InstanceCulling;
+
+    // Cluster culling of the ExecuteIndirect path: one command per meshlet (built at load time, see MeshletBuilder)
+    // with the per-draw data of its mesh part. The GPU culling also drops the meshlets that face away (normal cones).
+    bool                                            m_ClusterCulling = true;
+    StructuredBuffer                                m_MeshletArgumentBuffer;    // IndirectDrawBuilder::DrawCommand per meshlet.
+    std::vector<CullingMath::InstanceCone>          m_MeshletCones;             // World space, per meshlet.
+    uint32_t                                        m_NumMeshletDraws = 0;
+    GpuCulling                                      m_MeshletCulling;
+
+    // Recording time vs thread count benchmark: each thread count is measured over a number of frames.
+    struct RecordingBenchmark
+    {
+        bool                Running = false;
+        uint32_t            NumThreads = 0;
+        uint32_t            NumFrames = 0;
+        double              TotalTimeMs = 0.0;
+        std::vector<double> AverageTimeMs;  // Per thread count (index 0 - 1 thread).
+    };
+    RecordingBenchmark m_RecordingBenchmark;
+
+    void UpdateRecordingBenchmark();
+
+    // Rebuilt and compiled every frame from the passes in BuildFrameGraph.
+    FrameGraph m_FrameGraph;
+
+    // Frame graph handles of the transient render targets (of the current frame).
+    struct RenderTargetHandles
+    {
+        FrameGraph::ResourceHandle HDRColor;
+        FrameGraph::ResourceHandle Depth;
+        FrameGraph::ResourceHandle GBuffer[NUM_GBUFFER_RTS];
+    };
+    RenderTargetHandles m_RenderTargetHandles = {};
+
 private:
     // Some geometry to render.
     std::unique_ptr<Mesh> m_SphereMesh;
     std::unique_ptr<Mesh> m_ConeMesh;
+    // More than 65535 vertices: 32-bit indices (see IndexBuffer::SelectIndexFormat).
+    std::unique_ptr<Mesh> m_LargeSphereMesh;
 
     std::unique_ptr<Mesh> m_SkyboxMesh;
 
@@ -144,10 +370,21 @@ private:
 
     // Scale the HDR render target to a fraction of the window size.
     float m_RenderScale;
+    // Size of the render targets (window size * render scale).
+    uint32_t m_RenderWidth = 1;
+    uint32_t m_RenderHeight = 1;
 
     // Define some lights.
     std::vector<PointLight> m_PointLights;
     std::vector<SpotLight> m_SpotLights;
 
+    // Vertex and index data of the model's meshes, in a few shared buffers (declared before the mesh parts: their
+    // meshes give their ranges back to the pool when destroyed, reused once the frame completes, see OnUpdate).
+    GeometryPool m_GeometryPool{ sizeof(VertexPositionNormalTexture), 1u << 18, 1u << 20 };
+    // The same meshes with quantized vertices.
+    GeometryPool m_QuantizedGeometryPool{ sizeof(VertexQuantizer::QuantizedVertex), 1u << 18, 1u << 20 };
+
+    // Model root node and the node hierarchy of the file, LoadedMeshPart::node places each part.
+    SceneGraph m_SceneGraph;
     std::vector<LoadedMeshPart> m_LoadedMeshParts;
 };
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "Test.h"
+
+#include <Framework/AliasingPlanner.h>
+
+#include <random>
+
+namespace
+{
+    using Request = AliasingPlanner::Request;
+
+    bool MemoryOverlaps( const AliasingPlanner::Plan& plan, const std::vector<Request>& requests, size_t a, size_t b )
+    {
+        uint64_t aBegin = plan.Placements[a].Offset;
+        uint64_t bBegin = plan.Placements[b].Offset;
+        return aBegin < bBegin + requests[b].Size && bBegin < aBegin + requests[a].Size;
+    }
+
+    // The invariants of any plan: aligned placements in the heap, no memory shared by resources alive at the same
+    // time, and the aliased flags set exactly on the resources that share memory.
+    void CheckPlan( const AliasingPlanner::Plan& plan, const std::vector<Request>& requests )
+    {
+        REQUIRE( plan.Placements.size() == requests.size() );
+        CHECK( plan.HeapSize % plan.HeapAlignment == 0 );
+
+        for ( size_t a = 0; a < requests.size(); ++a )
+        {
+            uint64_t alignment = requests[a].Alignment ? requests[a].Alignment : 1;
+            CHECK( plan.Placements[a].Offset % alignment == 0 );
+            CHECK( plan.HeapAlignment % alignment == 0 );
+            CHECK( plan.Placements[a].Offset + requests[a].Size <= plan.HeapSize );
+
+            bool aliased = false;
+            for ( size_t b = 0; b < requests.size(); ++b )
+            {
+                if ( a == b || !MemoryOverlaps( plan, requests, a, b ) )
+                    continue;
+
+                CHECK( !AliasingPlanner::LifetimesOverlap( requests[a], requests[b] ) );
+                aliased = true;
+            }
+            CHECK( plan.Placements[a].Aliased == aliased );
+        }
+    }
+
+    std::vector<Request> MakeRandomRequests( uint32_t seed, size_t count )
+    {
+        std::mt19937 random( seed );
+        std::vector<Request> requests( count );
+        for ( Request& request : requests )
+        {
+            request.Size = 1 + random() % ( 4 << 20 );
+            request.Alignment = random() % 2 ? 65536 : 256;
+            request.FirstPass = random() % 32;
+            request.LastPass = request.FirstPass + random() % 8;
+        }
+        return requests;
+    }
+}
+
+TEST( AliasingPlanner_Empty )
+{
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( {} );
+    CHECK( plan.Placements.empty() );
+    CHECK( plan.HeapSize == 0 );
+    CHECK( plan.GetSavedBytes() == 0 );
+}
+
+TEST( AliasingPlanner_DisjointLifetimesShareMemory )
+{
+    std::vector<Request> requests = {
+        { 1024, 256, 0, 1 },
+        { 1024, 256, 2, 3 },
+    };
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( requests );
+    CheckPlan( plan, requests );
+
+    CHECK( plan.Placements[0].Offset == 0 );
+    CHECK( plan.Placements[1].Offset == 0 );
+    CHECK( plan.Placements[0].Aliased );
+    CHECK( plan.Placements[1].Aliased );
+    CHECK( plan.HeapSize == 1024 );
+    CHECK( plan.UnaliasedSize == 2048 );
+    CHECK( plan.GetSavedBytes() == 1024 );
+}
+
+TEST( AliasingPlanner_OverlappingLifetimesDontShareMemory )
+{
+    // Passes [0, 2] and [2, 3]: the lifetimes are inclusive, both are alive in pass 2.
+    std::vector<Request> requests = {
+        { 1024, 256, 0, 2 },
+        { 1024, 256, 2, 3 },
+    };
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( requests );
+    CheckPlan( plan, requests );
+
+    CHECK( plan.Placements[0].Offset == 0 );
+    CHECK( plan.Placements[1].Offset == 1024 );
+    CHECK( !plan.Placements[0].Aliased );
+    CHECK( !plan.Placements[1].Aliased );
+    CHECK( plan.HeapSize == 2048 );
+    CHECK( plan.GetSavedBytes() == 0 );
+}
+
+TEST( AliasingPlanner_SmallResourceFillsGap )
+{
+    // 0 and 1 are alive together, 2 only after 1: 2 goes where 1 was, not after it.
+    std::vector<Request> requests = {
+        { 4096, 256, 0, 3 },
+        { 2048, 256, 0, 1 },
+        { 1024, 256, 2, 3 },
+    };
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( requests );
+    CheckPlan( plan, requests );
+
+    CHECK( plan.Placements[0].Offset == 0 );
+    CHECK( plan.Placements[1].Offset == 4096 );
+    CHECK( plan.Placements[2].Offset == 4096 );
+    CHECK( !plan.Placements[0].Aliased );
+    CHECK( plan.Placements[1].Aliased );
+    CHECK( plan.Placements[2].Aliased );
+    CHECK( plan.HeapSize == 6144 );
+}
+
+TEST( AliasingPlanner_Alignment )
+{
+    std::vector<Request> requests = {
+        { 100, 256, 0, 1 },
+        { 50, 65536, 0, 1 },
+        { 10, 0, 0, 1 },      // No alignment: 1.
+    };
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( requests );
+    CheckPlan( plan, requests );
+
+    CHECK( plan.Placements[0].Offset == 0 );
+    CHECK( plan.Placements[1].Offset == 65536 );
+    CHECK( plan.Placements[2].Offset == 100 );
+    CHECK( plan.HeapAlignment == 65536 );
+    CHECK( plan.HeapSize == 131072 );
+    CHECK( plan.UnaliasedSize == 256 + 65536 + 10 );
+}
+
+TEST( AliasingPlanner_LargestFirst )
+{
+    // In the request order the small resources come first, they are placed after the large ones.
+    std::vector<Request> requests = {
+        { 256, 256, 0, 0 },
+        { 512, 256, 0, 0 },
+        { 1024, 256, 0, 0 },
+    };
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( requests );
+    CheckPlan( plan, requests );
+
+    CHECK( plan.Placements[2].Offset == 0 );
+    CHECK( plan.Placements[1].Offset == 1024 );
+    CHECK( plan.Placements[0].Offset == 1536 );
+}
+
+TEST( AliasingPlanner_TiesByFirstPassThenOrder )
+{
+    std::vector<Request> requests = {
+        { 512, 256, 1, 2 },
+        { 512, 256, 0, 2 },
+        { 512, 256, 1, 2 },
+    };
+    AliasingPlanner::Plan plan = AliasingPlanner::Build( requests );
+    CheckPlan( plan, requests );
+
+    CHECK( plan.Placements[1].Offset == 0 );
+    CHECK( plan.Placements[0].Offset == 512 );
+    CHECK( plan.Placements[2].Offset == 1024 );
+}
+
+TEST( AliasingPlanner_Deterministic )
+{
+    std::vector<Request> requests = MakeRandomRequests( 29, 256 );
+
+    AliasingPlanner::Plan first = AliasingPlanner::Build( requests );
+    AliasingPlanner::Plan second = AliasingPlanner::Build( requests );
+    CheckPlan( first, requests );
+
+    REQUIRE( first.Placements.size() == second.Placements.size() );
+    for ( size_t i = 0; i < requests.size(); ++i )
+    {
+        CHECK( first.Placements[i].Offset == second.Placements[i].Offset );
+        CHECK( first.Placements[i].Aliased == second.Placements[i].Aliased );
+    }
+    CHECK( first.HeapSize == second.HeapSize );
+    CHECK( first.HeapAlignment == second.HeapAlignment );
+    CHECK( first.UnaliasedSize == second.UnaliasedSize );
+    CHECK( first.HeapSize <= first.UnaliasedSize );
+}
+
+TEST( AliasingPlanner_RandomPlansAreValid )
+{
+    for ( uint32_t seed = 0; seed < 16; ++seed )
+    {
+        std::vector<Request> requests = MakeRandomRequests( seed, 64 );
+        CheckPlan( AliasingPlanner::Build( requests ), requests );
+    }
+}
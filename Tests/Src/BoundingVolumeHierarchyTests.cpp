@@ -0,0 +1,213 @@
+#include "Test.h"
+#include "TestGeometry.h"
+
+#include <Framework/BoundingVolumeHierarchy.h>
+#include <Framework/FrustumCuller.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+    FrustumCuller MakeCuller( const std::vector<BoundingBox>& boxes )
+    {
+        FrustumCuller culler;
+        culler.Reserve( static_cast<uint32_t>( boxes.size() ) );
+        for ( const BoundingBox& box : boxes )
+        {
+            culler.AddBox( box.Center, box.Extents );
+        }
+        return culler;
+    }
+
+    // Rays from the camera of TestGeometry::MakeViewProjection, within its field of view, 1000 units long.
+    std::vector<std::pair<XMFLOAT3, XMFLOAT3>> MakeRays( uint32_t numRays )
+    {
+        std::mt19937 random( 5678 );
+        std::uniform_real_distribution<float> slope( -0.6f, 0.6f );
+
+        std::vector<std::pair<XMFLOAT3, XMFLOAT3>> rays( numRays );
+        for ( auto& ray : rays )
+        {
+            ray.first = XMFLOAT3( 0.0f, 0.0f, 0.0f );
+            ray.second = XMFLOAT3( 1000.0f * slope( random ), 1000.0f * slope( random ) * 9.0f / 16.0f, 1000.0f );
+        }
+        return rays;
+    }
+
+    // The entry distance of the ray into the closest box (in units of the direction), FLT_MAX if it hits none.
+    float RaycastAllBoxes( const std::vector<BoundingBox>& boxes, const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance )
+    {
+        const float o[3] = { origin.x, origin.y, origin.z };
+        const float d[3] = { direction.x, direction.y, direction.z };
+
+        float closest = FLT_MAX;
+        for ( const BoundingBox& box : boxes )
+        {
+            const float c[3] = { box.Center.x, box.Center.y, box.Center.z };
+            const float e[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+
+            float tNear = 0.0f;
+            float tFar = maxDistance;
+            for ( int axis = 0; axis < 3; ++axis )
+            {
+                float t1 = ( c[axis] - e[axis] - o[axis] ) / d[axis];
+                float t2 = ( c[axis] + e[axis] - o[axis] ) / d[axis];
+                tNear = std::max( tNear, std::min( t1, t2 ) );
+                tFar = std::min( tFar, std::max( t1, t2 ) );
+            }
+            if ( tNear <= tFar )
+            {
+                closest = std::min( closest, tNear );
+            }
+        }
+        return closest;
+    }
+}
+
+// The same boxes as testing all of them (the BVH gives them in no particular order).
+TEST( BoundingVolumeHierarchy_CullFrustum )
+{
+    XMFLOAT4X4 viewProjection = TestGeometry::MakeViewProjection();
+
+    for ( uint32_t numBoxes : { 1u, 5u, 1000u, 10000u } )
+    {
+        std::vector<BoundingBox> boxes = TestGeometry::MakeRandomBoxes( numBoxes );
+
+        BoundingVolumeHierarchy bvh;
+        bvh.Build( boxes );
+        CHECK( bvh.GetNumPrimitives() == numBoxes );
+
+        std::vector<uint32_t> visible;
+        uint32_t numVisited = bvh.CullFrustum( viewProjection, visible );
+        CHECK( numVisited <= bvh.GetNumNodes() );
+        std::sort( visible.begin(), visible.end() );
+
+        std::vector<uint32_t> expected;
+        MakeCuller( boxes ).Cull( viewProjection, expected, FrustumCuller::InstructionSet::Scalar );
+        CHECK( visible == expected );
+    }
+
+    BoundingVolumeHierarchy empty;
+    empty.Build( {} );
+    std::vector<uint32_t> visible( 1 );
+    CHECK( empty.CullFrustum( viewProjection, visible ) == 0 );
+    CHECK( visible.empty() );
+}
+
+// The closest box, as testing all of them.
+TEST( BoundingVolumeHierarchy_Raycast )
+{
+    std::vector<BoundingBox> boxes = TestGeometry::MakeRandomBoxes( 10000 );
+    BoundingVolumeHierarchy bvh;
+    bvh.Build( boxes );
+
+    uint32_t numHits = 0;
+    for ( const auto& ray : MakeRays( 1000 ) )
+    {
+        uint32_t primitive;
+        float distance;
+        bool hit = bvh.Raycast( ray.first, ray.second, 1.0f, primitive, distance );
+
+        float expected = RaycastAllBoxes( boxes, ray.first, ray.second, 1.0f );
+        REQUIRE( hit == ( expected != FLT_MAX ) );
+        if ( hit )
+        {
+            CHECK( primitive < boxes.size() );
+            CHECK( std::abs( distance - expected ) <= 1e-5f );
+            CHECK( std::abs( RaycastAllBoxes( { boxes[primitive] }, ray.first, ray.second, 1.0f ) - distance ) <= 1e-5f );
+            ++numHits;
+        }
+    }
+    // The rays hit and miss.
+    CHECK( numHits > 0 );
+    CHECK( numHits < 1000 );
+}
+
+// Moved boxes are found at their new place.
+TEST( BoundingVolumeHierarchy_UpdateBounds )
+{
+    std::vector<BoundingBox> boxes = TestGeometry::MakeRandomBoxes( 1000 );
+    BoundingVolumeHierarchy bvh;
+    bvh.Build( boxes );
+
+    // Behind the camera, then in front of it.
+    std::mt19937 random( 42 );
+    std::uniform_int_distribution<uint32_t> index( 0, 999 );
+    for ( uint32_t i = 0; i < 100; ++i )
+    {
+        uint32_t primitive = index( random );
+        boxes[primitive].Center.z = ( i % 2 ) ? -boxes[primitive].Center.z : 50.0f;
+        bvh.UpdateBounds( primitive, boxes[primitive] );
+    }
+
+    XMFLOAT4X4 viewProjection = TestGeometry::MakeViewProjection();
+    std::vector<uint32_t> visible;
+    bvh.CullFrustum( viewProjection, visible );
+    std::sort( visible.begin(), visible.end() );
+
+    std::vector<uint32_t> expected;
+    MakeCuller( boxes ).Cull( viewProjection, expected, FrustumCuller::InstructionSet::Scalar );
+    CHECK( visible == expected );
+
+    bvh.Refit();
+    bvh.CullFrustum( viewProjection, visible );
+    std::sort( visible.begin(), visible.end() );
+    CHECK( visible == expected );
+}
+
+BENCHMARK( BoundingVolumeHierarchy_Benchmark )
+{
+    const uint32_t NumIterations = 100;
+    XMFLOAT4X4 viewProjection = TestGeometry::MakeViewProjection();
+    std::vector<std::pair<XMFLOAT3, XMFLOAT3>> rays = MakeRays( 1000 );
+
+    for ( uint32_t numBoxes : { 1000u, 10000u, 100000u } )
+    {
+        std::vector<BoundingBox> boxes = TestGeometry::MakeRandomBoxes( numBoxes );
+
+        Test::Stopwatch buildStopwatch;
+        BoundingVolumeHierarchy bvh;
+        bvh.Build( boxes );
+        double buildTimeMs = buildStopwatch.GetElapsedMs();
+
+        FrustumCuller culler = MakeCuller( boxes );
+        std::vector<uint32_t> visible;
+        visible.reserve( numBoxes );
+
+        uint32_t numVisitedNodes = 0;
+        Test::Stopwatch cullStopwatch;
+        for ( uint32_t i = 0; i < NumIterations; ++i )
+        {
+            numVisitedNodes = bvh.CullFrustum( viewProjection, visible );
+        }
+        double cullTimeMs = cullStopwatch.GetElapsedMs() / NumIterations;
+        size_t numVisible = visible.size();
+
+        Test::Stopwatch flatCullStopwatch;
+        for ( uint32_t i = 0; i < NumIterations; ++i )
+        {
+            culler.Cull( viewProjection, visible );
+        }
+        double flatCullTimeMs = flatCullStopwatch.GetElapsedMs() / NumIterations;
+        CHECK( visible.size() == numVisible );
+
+        Test::Stopwatch raycastStopwatch;
+        for ( const auto& ray : rays )
+        {
+            uint32_t primitive;
+            float distance;
+            bvh.Raycast( ray.first, ray.second, 1.0f, primitive, distance );
+        }
+        double raycastTimeUs = 1000.0 * raycastStopwatch.GetElapsedMs() / rays.size();
+
+        std::printf( "    %u boxes - build %.3f ms, cull %.4f ms (%u nodes), all boxes %.4f ms, ray %.2f us\n", numBoxes, buildTimeMs,
+                     cullTimeMs, numVisitedNodes, flatCullTimeMs, raycastTimeUs );
+    }
+}
@@ -0,0 +1,312 @@
+#include "Test.h"
+
+#include <Framework/CullingMath.h>
+
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    // clip = (x, y, z, 1): NDC is the world space, the depth is z.
+    const XMFLOAT4X4 Identity(
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f );
+
+    // clip = (x, y, z - 1, z): a perspective divide, the near plane at z = 1, no far plane.
+    const XMFLOAT4X4 Perspective(
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 1.0f,
+        0.0f, 0.0f, -1.0f, 0.0f );
+
+    CullingMath::InstanceBounds MakeBounds( float x, float y, float z, float ex, float ey, float ez )
+    {
+        CullingMath::InstanceBounds bounds = {};
+        bounds.Center = XMFLOAT3( x, y, z );
+        bounds.Extents = XMFLOAT3( ex, ey, ez );
+        return bounds;
+    }
+
+    std::vector<float> MakeRandomDepth( uint32_t width, uint32_t height, uint32_t seed )
+    {
+        std::mt19937 random( seed );
+        std::uniform_real_distribution<float> depth( 0.0f, 1.0f );
+        std::vector<float> values( static_cast<size_t>( width ) * height );
+        for ( float& value : values )
+        {
+            value = depth( random );
+        }
+        return values;
+    }
+
+    // The depth texels [first, last] under the texels [first, last] of a mip, one axis: a texel covers 2 texels of
+    // the level below, the last one also the extra texel of an odd size.
+    void GetFootprint( const CullingMath::HiZPyramid& hiz, uint32_t mip, uint32_t size0, bool isX, uint32_t& first, uint32_t& last )
+    {
+        for ( int level = static_cast<int>( mip ); level >= 0; --level )
+        {
+            uint32_t size = isX ? hiz.GetMipWidth( level ) : hiz.GetMipHeight( level );
+            uint32_t belowSize = level > 0 ? ( isX ? hiz.GetMipWidth( level - 1 ) : hiz.GetMipHeight( level - 1 ) ) : size0;
+            last = ( last == size - 1 ) ? belowSize - 1 : 2 * last + 1;
+            first = 2 * first;
+        }
+    }
+}
+
+TEST( CullingMath_HiZSize )
+{
+    uint32_t width, height, numMips;
+    CullingMath::GetHiZSize( 1920, 1080, width, height, numMips );
+    CHECK( width == 960 && height == 540 && numMips == 10 );
+
+    CullingMath::GetHiZSize( 7, 5, width, height, numMips );
+    CHECK( width == 3 && height == 2 && numMips == 2 );
+
+    CullingMath::GetHiZSize( 1, 1, width, height, numMips );
+    CHECK( width == 1 && height == 1 && numMips == 1 );
+
+    CHECK_THROWS( CullingMath::BuildHiZ( {}, 0, 0 ) );
+    CHECK_THROWS( CullingMath::BuildHiZ( std::vector<float>( 10 ), 4, 4 ) );
+}
+
+// Every texel is the max of the depth texels under it, the extra row/column of an odd size included.
+TEST( CullingMath_HiZMaxReduction )
+{
+    for ( uint32_t size : { 0x0101u, 0x0303u, 0x0705u, 0x0D09u, 0x1010u, 0x2F03u, 0x0121u } )
+    {
+        uint32_t depthWidth = size >> 8;
+        uint32_t depthHeight = size & 0xFF;
+        std::vector<float> depth = MakeRandomDepth( depthWidth, depthHeight, size );
+        CullingMath::HiZPyramid hiz = CullingMath::BuildHiZ( depth, depthWidth, depthHeight );
+
+        REQUIRE( hiz.GetNumMips() > 0 );
+        CHECK( hiz.GetMipWidth( hiz.GetNumMips() - 1 ) == 1 );
+        CHECK( hiz.GetMipHeight( hiz.GetNumMips() - 1 ) == 1 );
+
+        for ( uint32_t mip = 0; mip < hiz.GetNumMips(); ++mip )
+        {
+            for ( uint32_t y = 0; y < hiz.GetMipHeight( mip ); ++y )
+            {
+                for ( uint32_t x = 0; x < hiz.GetMipWidth( mip ); ++x )
+                {
+                    uint32_t firstX = x, lastX = x, firstY = y, lastY = y;
+                    GetFootprint( hiz, mip, depthWidth, true, firstX, lastX );
+                    GetFootprint( hiz, mip, depthHeight, false, firstY, lastY );
+
+                    float expected = 0.0f;
+                    for ( uint32_t dy = firstY; dy <= std::min( lastY, depthHeight - 1 ); ++dy )
+                    {
+                        for ( uint32_t dx = firstX; dx <= std::min( lastX, depthWidth - 1 ); ++dx )
+                        {
+                            expected = std::max( expected, depth[dy * depthWidth + dx] );
+                        }
+                    }
+                    CHECK( hiz.Load( mip, x, y ) == expected );
+                }
+            }
+        }
+    }
+
+    // 5x3: a single far texel in the last column and row is only under the extra texels of mip 0.
+    std::vector<float> depth( 5 * 3, 0.25f );
+    depth[2 * 5 + 4] = 1.0f;
+    CullingMath::HiZPyramid hiz = CullingMath::BuildHiZ( depth, 5, 3 );
+    CHECK( hiz.Width == 2 && hiz.Height == 1 );
+    CHECK( hiz.Load( 0, 0, 0 ) == 0.25f );
+    CHECK( hiz.Load( 0, 1, 0 ) == 1.0f );
+    CHECK( hiz.Load( hiz.GetNumMips() - 1, 0, 0 ) == 1.0f );
+}
+
+// The largest texel whose left edge is at or before c / w, clamped, without the divide deciding.
+TEST( CullingMath_TexelIndex )
+{
+    // 4 texels, edges at -1, -0.5, 0, 0.5.
+    CHECK( CullingMath::GetTexelIndex( 0.0f, 1.0f, 0.5f, 4 ) == 2 );
+    CHECK( CullingMath::GetTexelIndex( -0.5f, 1.0f, 0.5f, 4 ) == 1 );
+    CHECK( CullingMath::GetTexelIndex( std::nextafter( 0.0f, -1.0f ), 1.0f, 0.5f, 4 ) == 1 );
+    CHECK( CullingMath::GetTexelIndex( -1.0f, 1.0f, 0.5f, 4 ) == 0 );
+    CHECK( CullingMath::GetTexelIndex( -3.0f, 1.0f, 0.5f, 4 ) == 0 );
+    CHECK( CullingMath::GetTexelIndex( 3.0f, 1.0f, 0.5f, 4 ) == 3 );
+    CHECK( CullingMath::GetTexelIndex( 1.0f, 2.0f, 0.5f, 4 ) == 3 );
+    CHECK( CullingMath::GetTexelIndex( std::nextafter( 1.0f, 0.0f ), 2.0f, 0.5f, 4 ) == 2 );
+
+    std::mt19937 random( 7 );
+    std::uniform_real_distribution<float> clip( -3.0f, 3.0f );
+    std::uniform_real_distribution<float> w( 0.01f, 100.0f );
+    for ( uint32_t size : { 1u, 2u, 7u, 1080u, 1920u } )
+    {
+        float texelSize = 2.0f / static_cast<float>( size );
+        for ( int i = 0; i < 2000; ++i )
+        {
+            float cw = w( random );
+            float c = clip( random ) * cw;
+
+            uint32_t expected = 0;
+            for ( uint32_t p = 0; p < size; ++p )
+            {
+                if ( c >= ( static_cast<float>( p ) * texelSize - 1.0f ) * cw )
+                    expected = p;
+            }
+            CHECK( CullingMath::GetTexelIndex( c, cw, texelSize, size ) == expected );
+        }
+    }
+}
+
+// At most 2x2 texels of the first mip coarse enough, covering the rectangle.
+TEST( CullingMath_HiZRect )
+{
+    CullingMath::HiZPyramid hiz = CullingMath::BuildHiZ( std::vector<float>( 64 * 16, 0.5f ), 64, 16 );
+    REQUIRE( hiz.Width == 32 && hiz.Height == 8 && hiz.GetNumMips() == 6 );
+
+    CullingMath::HiZRect rect = CullingMath::GetHiZRect( hiz, 4, 4, 5, 5 );
+    CHECK( rect.Mip == 0 && rect.X0 == 2 && rect.X1 == 2 && rect.Y0 == 2 && rect.Y1 == 2 );
+
+    // Mip 0 texels [1, 2]: extent 1, mip 1 texels [0, 1].
+    rect = CullingMath::GetHiZRect( hiz, 2, 0, 5, 0 );
+    CHECK( rect.Mip == 1 && rect.X0 == 0 && rect.X1 == 1 && rect.Y0 == 0 && rect.Y1 == 0 );
+
+    // Mip 0 texels [0, 3]: extent 3, mip 2.
+    rect = CullingMath::GetHiZRect( hiz, 0, 0, 7, 7 );
+    CHECK( rect.Mip == 2 && rect.X0 == 0 && rect.X1 == 0 && rect.Y0 == 0 && rect.Y1 == 0 );
+
+    // The whole buffer: the last mip (1x1), clamped.
+    rect = CullingMath::GetHiZRect( hiz, 0, 0, 63, 15 );
+    CHECK( rect.Mip == 5 && rect.X0 == 0 && rect.X1 == 0 && rect.Y0 == 0 && rect.Y1 == 0 );
+
+    std::mt19937 random( 3 );
+    for ( int i = 0; i < 5000; ++i )
+    {
+        uint32_t x0 = random() % 64, x1 = random() % 64, y0 = random() % 16, y1 = random() % 16;
+        uint32_t minX = std::min( x0, x1 ), maxX = std::max( x0, x1 ), minY = std::min( y0, y1 ), maxY = std::max( y0, y1 );
+        rect = CullingMath::GetHiZRect( hiz, minX, minY, maxX, maxY );
+
+        CHECK( rect.Mip < hiz.GetNumMips() );
+        CHECK( rect.X0 <= rect.X1 && rect.X1 - rect.X0 <= 1 );
+        CHECK( rect.Y0 <= rect.Y1 && rect.Y1 - rect.Y0 <= 1 );
+        CHECK( rect.X1 < hiz.GetMipWidth( rect.Mip ) && rect.Y1 < hiz.GetMipHeight( rect.Mip ) );
+
+        // The texels cover the mip 0 texels of the rectangle.
+        uint32_t mip0MinX = std::min( minX >> 1, hiz.Width - 1 ), mip0MaxX = std::min( maxX >> 1, hiz.Width - 1 );
+        uint32_t mip0MinY = std::min( minY >> 1, hiz.Height - 1 ), mip0MaxY = std::min( maxY >> 1, hiz.Height - 1 );
+        CHECK( ( rect.X0 << rect.Mip ) <= mip0MinX && ( ( rect.X1 + 1 ) << rect.Mip ) > mip0MaxX );
+        CHECK( ( rect.Y0 << rect.Mip ) <= mip0MinY && ( ( rect.Y1 + 1 ) << rect.Mip ) > mip0MaxY );
+
+        // And the mip before was too fine.
+        uint32_t extent = std::max( mip0MaxX - mip0MinX, mip0MaxY - mip0MinY );
+        if ( rect.Mip > 0 )
+        {
+            CHECK( ( extent >> ( rect.Mip - 1 ) ) != 0 );
+        }
+    }
+}
+
+// Occluded only if every corner is strictly behind the farthest depth of the texels read.
+TEST( CullingMath_OcclusionThreshold )
+{
+    CullingMath::View view = CullingMath::MakeView( Identity );
+    CullingMath::HiZPyramid hiz = CullingMath::BuildHiZ( std::vector<float>( 16 * 16, 0.5f ), 16, 16 );
+
+    CHECK( CullingMath::IsOccluded( view, MakeBounds( 0.0f, 0.0f, 0.75f, 0.1f, 0.1f, 0.2f ), hiz ) );
+    CHECK( !CullingMath::IsOccluded( view, MakeBounds( 0.0f, 0.0f, 0.6f, 0.1f, 0.1f, 0.2f ), hiz ) );
+    CHECK( !CullingMath::IsOccluded( view, MakeBounds( 0.0f, 0.0f, 0.25f, 0.1f, 0.1f, 0.2f ), hiz ) );
+
+    // The nearest corner exactly on the depth: visible. One ULP behind: occluded.
+    CHECK( !CullingMath::IsOccluded( view, MakeBounds( 0.0f, 0.0f, 0.75f, 0.1f, 0.1f, 0.25f ), hiz ) );
+    CHECK( CullingMath::IsOccluded( view, MakeBounds( 0.0f, 0.0f, std::nextafter( 0.75f, 1.0f ), 0.1f, 0.1f, 0.25f ), hiz ) );
+
+    // Same with a perspective divide: the depth of z is (z - 1) / z = 0.5 at z = 2.
+    CullingMath::View perspectiveView = CullingMath::MakeView( Perspective );
+    CHECK( CullingMath::IsOccluded( perspectiveView, MakeBounds( 0.0f, 0.0f, 3.0f, 0.1f, 0.1f, 0.5f ), hiz ) );
+    CHECK( !CullingMath::IsOccluded( perspectiveView, MakeBounds( 0.0f, 0.0f, 2.5f, 0.1f, 0.1f, 0.5f ), hiz ) );
+    CHECK( CullingMath::IsOccluded( perspectiveView, MakeBounds( 0.0f, 0.0f, std::nextafter( 2.5f, 3.0f ), 0.1f, 0.1f, 0.5f ), hiz ) );
+
+    // Crossing the camera plane (w <= 0): never occluded, even behind a depth of 0.
+    CullingMath::HiZPyramid nearHiZ = CullingMath::BuildHiZ( std::vector<float>( 16 * 16, 0.0f ), 16, 16 );
+    CHECK( CullingMath::IsOccluded( perspectiveView, MakeBounds( 0.0f, 0.0f, 5.0f, 1.0f, 1.0f, 1.0f ), nearHiZ ) );
+    CHECK( !CullingMath::IsOccluded( perspectiveView, MakeBounds( 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f ), nearHiZ ) );
+}
+
+// A hole in the depth under the rectangle makes the box visible, one away from the texels read doesn't.
+TEST( CullingMath_OcclusionHoles )
+{
+    CullingMath::View view = CullingMath::MakeView( Identity );
+    const uint32_t size = 64;
+    // Depth texels [40, 43] x [40, 43] (NDC x and -y in [0.2525, 0.3725]): mip 0 texels [20, 21], mip 1 texel 10.
+    CullingMath::InstanceBounds bounds = MakeBounds( 0.3125f, -0.3125f, 0.9f, 0.06f, 0.06f, 0.05f );
+
+    std::vector<float> depth( size * size, 0.5f );
+    CHECK( CullingMath::IsOccluded( view, bounds, CullingMath::BuildHiZ( depth, size, size ) ) );
+
+    std::vector<float> underBox = depth;
+    underBox[42 * size + 41] = 1.0f;
+    CHECK( !CullingMath::IsOccluded( view, bounds, CullingMath::BuildHiZ( underBox, size, size ) ) );
+
+    std::vector<float> elsewhere = depth;
+    elsewhere[10 * size + 10] = 1.0f;
+    elsewhere[44 * size + 44] = 1.0f;
+    CHECK( CullingMath::IsOccluded( view, bounds, CullingMath::BuildHiZ( elsewhere, size, size ) ) );
+
+    // Cull: the frustum first, then the pyramid if any.
+    CullingMath::HiZPyramid hiz = CullingMath::BuildHiZ( depth, size, size );
+    CHECK( CullingMath::Cull( view, view, bounds, &hiz ) == CullingMath::Result::Occluded );
+    CHECK( CullingMath::Cull( view, view, bounds, nullptr ) == CullingMath::Result::Visible );
+    CHECK( CullingMath::Cull( view, view, MakeBounds( 3.0f, 0.0f, 0.5f, 0.5f, 0.5f, 0.1f ), &hiz ) == CullingMath::Result::FrustumCulled );
+    CHECK( CullingMath::Cull( view, view, MakeBounds( 0.0f, 0.0f, 0.25f, 0.1f, 0.1f, 0.1f ), &hiz ) == CullingMath::Result::Visible );
+}
+
+// Backfacing if every point of the sphere is seen within the cutoff of the cone axis.
+TEST( CullingMath_ConeBackfacing )
+{
+    const XMFLOAT3 camera( 0.0f, 0.0f, 0.0f );
+    // 30 degrees.
+    CullingMath::InstanceCone cone = { XMFLOAT3( 0.0f, 0.0f, 10.0f ), 1.0f, XMFLOAT3( 0.0f, 0.0f, 1.0f ), 0.5f };
+    CHECK( CullingMath::IsBackfacing( cone, camera ) );
+
+    // Facing the camera.
+    CullingMath::InstanceCone facing = cone;
+    facing.Axis = XMFLOAT3( 0.0f, 0.0f, -1.0f );
+    CHECK( !CullingMath::IsBackfacing( facing, camera ) );
+
+    // No cone.
+    CullingMath::InstanceCone none = { XMFLOAT3( 0.0f, 0.0f, 10.0f ), 1.0f, XMFLOAT3( 0.0f, 0.0f, 0.0f ), 1.0f };
+    CHECK( !CullingMath::IsBackfacing( none, camera ) );
+
+    // The camera within the sphere.
+    CullingMath::InstanceCone inside = cone;
+    inside.Center = XMFLOAT3( 0.0f, 0.0f, 0.5f );
+    CHECK( !CullingMath::IsBackfacing( inside, camera ) );
+
+    // Seen from the side: the axis is 90 degrees off the view direction.
+    CHECK( !CullingMath::IsBackfacing( cone, XMFLOAT3( -10.0f, 0.0f, 10.0f ) ) );
+
+    // Against the inequality in double precision, away from the boundary.
+    std::mt19937 random( 11 );
+    std::uniform_real_distribution<float> position( -10.0f, 10.0f );
+    std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+    uint32_t numBackfacing = 0;
+    for ( int i = 0; i < 20000; ++i )
+    {
+        CullingMath::InstanceCone c = {};
+        c.Center = XMFLOAT3( position( random ), position( random ), position( random ) );
+        c.Radius = unit( random ) * 2.0f;
+        double ax = position( random ), ay = position( random ), az = position( random );
+        double length = std::sqrt( ax * ax + ay * ay + az * az );
+        c.Axis = XMFLOAT3( static_cast<float>( ax / length ), static_cast<float>( ay / length ), static_cast<float>( az / length ) );
+        c.Cutoff = unit( random );
+
+        double vx = c.Center.x, vy = c.Center.y, vz = c.Center.z;
+        double lhs = vx * c.Axis.x + vy * c.Axis.y + vz * c.Axis.z - c.Radius * ( 1.0 + c.Cutoff );
+        double rhs = c.Cutoff * std::sqrt( vx * vx + vy * vy + vz * vz );
+        if ( std::abs( lhs - rhs ) < 1e-3 )
+            continue;
+
+        bool expected = lhs >= rhs;
+        CHECK( CullingMath::IsBackfacing( c, camera ) == expected );
+        numBackfacing += expected ? 1 : 0;
+    }
+    CHECK( numBackfacing > 0 );
+}
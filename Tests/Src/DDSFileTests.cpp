@@ -0,0 +1,239 @@
+#include "Test.h"
+#include "TestFiles.h"
+
+#include <Framework/Material/DDSFile.h>
+
+#include <External/DirectXTex/DirectXTex/DirectXTex.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+namespace
+{
+    // Random bytes in every subresource: any format, block compressed included, is a valid texture.
+    void FillImages( const DirectX::ScratchImage& image, uint32_t seed )
+    {
+        std::mt19937 random( seed );
+        std::generate( image.GetPixels(), image.GetPixels() + image.GetPixelsSize(), [&]() { return static_cast<uint8_t>( random() ); } );
+    }
+
+    void SaveImages( const DirectX::ScratchImage& image, const std::wstring& fileName )
+    {
+        REQUIRE( SUCCEEDED( DirectX::SaveToDDSFile( image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::DDS_FLAGS_NONE,
+                                                    fileName.c_str() ) ) );
+    }
+
+    // The subresources of the mapped file are the images LoadFromDDSFile decodes, in the same order.
+    bool IsSameAsDecoded( const DDSFile& file, const std::wstring& fileName )
+    {
+        DirectX::TexMetadata metadata;
+        DirectX::ScratchImage image;
+        if ( FAILED( DirectX::LoadFromDDSFile( fileName.c_str(), DirectX::DDS_FLAGS_NONE, &metadata, image ) ) )
+            return false;
+
+        const D3D12_RESOURCE_DESC& desc = file.GetResourceDesc();
+        if ( desc.Width != metadata.width || desc.Height != metadata.height || static_cast<size_t>( desc.MipLevels ) != metadata.mipLevels ||
+             desc.Format != metadata.format || file.GetSubresources().size() != image.GetImageCount() )
+            return false;
+
+        for ( size_t i = 0; i < image.GetImageCount(); ++i )
+        {
+            const DirectX::Image& decoded = image.GetImages()[i];
+            const D3D12_SUBRESOURCE_DATA& mapped = file.GetSubresources()[i];
+            if ( static_cast<size_t>( mapped.RowPitch ) != decoded.rowPitch || static_cast<size_t>( mapped.SlicePitch ) != decoded.slicePitch ||
+                 std::memcmp( mapped.pData, decoded.pixels, decoded.slicePitch ) != 0 )
+                return false;
+        }
+        return true;
+    }
+
+    // Stands for the upload resource: the rows of a subresource at the pitch of its copy footprint, as
+    // UpdateSubresources writes them. Returns the bytes copied.
+    size_t CopyRows( const D3D12_SUBRESOURCE_DATA& subresource, std::vector<uint8_t>& uploadMemory )
+    {
+        size_t rowPitch = static_cast<size_t>( subresource.RowPitch );
+        size_t numRows = static_cast<size_t>( subresource.SlicePitch ) / rowPitch;
+        size_t footprintPitch = ( rowPitch + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1 ) / D3D12_TEXTURE_DATA_PITCH_ALIGNMENT * D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+        if ( uploadMemory.size() < footprintPitch * numRows )
+        {
+            uploadMemory.resize( footprintPitch * numRows );
+        }
+        for ( size_t row = 0; row < numRows; ++row )
+        {
+            std::memcpy( uploadMemory.data() + row * footprintPitch, static_cast<const uint8_t*>( subresource.pData ) + row * rowPitch, rowPitch );
+        }
+        return rowPitch * numRows;
+    }
+}
+
+// Mipmapped textures, an array and a cubemap: mapped in place, with the layout DirectXTex decodes.
+TEST( DDSFile_MatchesDirectXTex )
+{
+    TestFiles::TemporaryDirectory directory;
+
+    struct Texture
+    {
+        const wchar_t*  Name;
+        DXGI_FORMAT     Format;
+        size_t          ArraySize;
+        bool            IsCubemap;
+    };
+    const Texture textures[] =
+    {
+        { L"RGBA8.dds",     DXGI_FORMAT_R8G8B8A8_UNORM,         1, false },
+        { L"BC1.dds",       DXGI_FORMAT_BC1_UNORM,              1, false },
+        { L"BC7Array.dds",  DXGI_FORMAT_BC7_UNORM_SRGB,         3, false },
+        { L"RGBA16F.dds",   DXGI_FORMAT_R16G16B16A16_FLOAT,     1, true },
+    };
+
+    uint32_t seed = 1;
+    for ( const Texture& texture : textures )
+    {
+        DirectX::ScratchImage image;
+        if ( texture.IsCubemap )
+        {
+            REQUIRE( SUCCEEDED( image.InitializeCube( texture.Format, 32, 32, 1, 0 ) ) );
+        }
+        else
+        {
+            REQUIRE( SUCCEEDED( image.Initialize2D( texture.Format, 64, 32, texture.ArraySize, 0 ) ) );
+        }
+        FillImages( image, seed++ );
+
+        std::wstring fileName = directory.GetFile( texture.Name );
+        SaveImages( image, fileName );
+
+        DDSFile file;
+        REQUIRE( file.Open( fileName ) );
+        CHECK( file.IsOpen() );
+        CHECK( file.IsCubemap() == texture.IsCubemap );
+        CHECK( static_cast<size_t>( file.GetResourceDesc().DepthOrArraySize ) == ( texture.IsCubemap ? 6 : texture.ArraySize ) );
+        CHECK( static_cast<size_t>( file.GetResourceDesc().MipLevels ) == image.GetMetadata().mipLevels );
+        CHECK( IsSameAsDecoded( file, fileName ) );
+
+        file.Close();
+        CHECK( !file.IsOpen() );
+        CHECK( file.GetSubresources().empty() );
+    }
+}
+
+// The files Open refuses: the caller falls back to LoadFromDDSFile (or fails).
+TEST( DDSFile_Refused )
+{
+    TestFiles::TemporaryDirectory directory;
+
+    DirectX::ScratchImage image;
+    REQUIRE( SUCCEEDED( image.Initialize2D( DXGI_FORMAT_BC1_UNORM, 64, 64, 1, 0 ) ) );
+    FillImages( image, 1 );
+    std::wstring validFile = directory.GetFile( L"Valid.dds" );
+    SaveImages( image, validFile );
+
+    std::vector<char> bytes;
+    {
+        std::ifstream stream( validFile, std::ios::binary );
+        bytes.assign( std::istreambuf_iterator<char>( stream ), std::istreambuf_iterator<char>() );
+    }
+    REQUIRE( bytes.size() > 128 );
+
+    auto writeFile = [&]( const wchar_t* name, size_t size )
+    {
+        std::wstring fileName = directory.GetFile( name );
+        std::ofstream stream( fileName, std::ios::binary );
+        stream.write( bytes.data(), static_cast<std::streamsize>( size ) );
+        return fileName;
+    };
+
+    DDSFile file;
+    CHECK( !file.Open( directory.GetFile( L"Missing.dds" ) ) );
+
+    // The smallest mips are missing.
+    CHECK( !file.Open( writeFile( L"Truncated.dds", bytes.size() - 1 ) ) );
+    CHECK( !file.IsOpen() );
+    CHECK( file.GetSubresources().empty() );
+
+    // The header only.
+    CHECK( !file.Open( writeFile( L"Header.dds", 64 ) ) );
+    CHECK( !file.IsOpen() );
+
+    // Not a DDS file.
+    bytes.assign( bytes.size(), 'x' );
+    CHECK( !file.Open( writeFile( L"Garbage.dds", bytes.size() ) ) );
+    CHECK( !file.IsOpen() );
+}
+
+// Read and upload copy of the DDS files: LoadFromDDSFile into a decoded copy vs. the file mapped and read in place.
+BENCHMARK( DDSFile_Benchmark )
+{
+    const uint32_t NumFiles = 8;
+
+    TestFiles::TemporaryDirectory directory;
+
+    std::vector<std::wstring> fileNames;
+    for ( uint32_t i = 0; i < NumFiles; ++i )
+    {
+        DirectX::ScratchImage image;
+        REQUIRE( SUCCEEDED( image.Initialize2D( i % 2 ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_BC7_UNORM, 2048, 2048, 1, 0 ) ) );
+        FillImages( image, i + 1 );
+        fileNames.push_back( directory.GetFile( L"Texture" + std::to_wstring( i ) + L".dds" ) );
+        SaveImages( image, fileNames.back() );
+    }
+
+    std::vector<uint8_t> uploadMemory;
+    size_t largestDecodedCopy = 0;
+    auto loadDecoded = [&]()
+    {
+        size_t copiedBytes = 0;
+        for ( const auto& fileName : fileNames )
+        {
+            DirectX::TexMetadata metadata;
+            DirectX::ScratchImage image;
+            REQUIRE( SUCCEEDED( DirectX::LoadFromDDSFile( fileName.c_str(), DirectX::DDS_FLAGS_NONE, &metadata, image ) ) );
+
+            largestDecodedCopy = std::max( largestDecodedCopy, image.GetPixelsSize() );
+            for ( size_t i = 0; i < image.GetImageCount(); ++i )
+            {
+                const DirectX::Image& subimage = image.GetImages()[i];
+                D3D12_SUBRESOURCE_DATA subresource = { subimage.pixels, static_cast<LONG_PTR>( subimage.rowPitch ), static_cast<LONG_PTR>( subimage.slicePitch ) };
+                copiedBytes += CopyRows( subresource, uploadMemory );
+            }
+        }
+        return copiedBytes;
+    };
+    auto loadMapped = [&]()
+    {
+        size_t copiedBytes = 0;
+        for ( const auto& fileName : fileNames )
+        {
+            DDSFile file;
+            REQUIRE( file.Open( fileName ) );
+            for ( const auto& subresource : file.GetSubresources() )
+            {
+                copiedBytes += CopyRows( subresource, uploadMemory );
+            }
+        }
+        return copiedBytes;
+    };
+
+    // First pass not timed: the files are in the OS file cache, the upload memory is allocated.
+    loadMapped();
+
+    Test::Stopwatch stopwatch;
+    size_t decodedBytes = loadDecoded();
+    double decodedMs = stopwatch.GetElapsedMs();
+
+    stopwatch = Test::Stopwatch();
+    size_t mappedBytes = loadMapped();
+    double mappedMs = stopwatch.GetElapsedMs();
+
+    CHECK( decodedBytes == mappedBytes );
+
+    double copiedMB = mappedBytes / ( 1024.0 * 1024.0 );
+    std::printf( "    %u DDS files, %.1f MB\n", NumFiles, copiedMB );
+    std::printf( "    LoadFromDDSFile - %.1f ms (%.0f MB/s, up to %.1f MB decoded copy)\n", decodedMs, copiedMB * 1000.0 / decodedMs,
+                 largestDecodedCopy / ( 1024.0 * 1024.0 ) );
+    std::printf( "    Mapped          - %.1f ms (%.0f MB/s, no copy)\n", mappedMs, copiedMB * 1000.0 / mappedMs );
+}
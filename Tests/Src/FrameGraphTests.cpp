@@ -0,0 +1,357 @@
+#include "Test.h"
+
+#include <Framework/FrameGraphCompiler.h>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace
+{
+    using QueueType = FrameGraphCompiler::QueueType;
+    using Barrier = FrameGraphCompiler::Barrier;
+
+    const D3D12_RESOURCE_STATES RenderTarget = D3D12_RESOURCE_STATE_RENDER_TARGET;
+    const D3D12_RESOURCE_STATES PixelShaderResource = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    const D3D12_RESOURCE_STATES NonPixelShaderResource = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+    const D3D12_RESOURCE_STATES UnorderedAccess = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+    const D3D12_RESOURCE_STATES DepthWrite = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+
+    // The position of a pass in the execution order.
+    size_t GetOrderIndex( const FrameGraphCompiler& graph, FrameGraphCompiler::PassHandle pass )
+    {
+        const auto& order = graph.GetExecutionOrder();
+        return std::find( order.begin(), order.end(), pass ) - order.begin();
+    }
+
+    // The barriers of a pass on one resource.
+    std::vector<Barrier> GetBarriers( const std::vector<Barrier>& barriers, FrameGraphCompiler::ResourceHandle resource )
+    {
+        std::vector<Barrier> result;
+        std::copy_if( barriers.begin(), barriers.end(), std::back_inserter( result ), [resource]( const Barrier& barrier ) { return barrier.Resource == resource; } );
+        return result;
+    }
+
+    bool IsTransition( const Barrier& barrier, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after )
+    {
+        return barrier.BarrierType == Barrier::Type::Transition && barrier.StateBefore == before && barrier.StateAfter == after;
+    }
+}
+
+// Only the passes that (transitively, through their data) write an output are kept, with the never culled ones.
+TEST( FrameGraph_CullUnusedOutputs )
+{
+    FrameGraphCompiler graph;
+    auto backBuffer = graph.ImportResource( L"Back Buffer", D3D12_RESOURCE_STATE_COMMON );
+    auto used = graph.CreateTransientResource( L"Used" );
+    auto unused = graph.CreateTransientResource( L"Unused" );
+    auto unusedChain = graph.CreateTransientResource( L"Unused Chain" );
+    graph.MarkOutput( backBuffer );
+
+    auto writeUnused = graph.AddPass( L"Write Unused", QueueType::Direct );
+    graph.Write( writeUnused, unused, RenderTarget );
+
+    auto writeUsed = graph.AddPass( L"Write Used", QueueType::Direct );
+    graph.Write( writeUsed, used, RenderTarget );
+
+    // Reads an unused result into another unused one.
+    auto readUnused = graph.AddPass( L"Read Unused", QueueType::Direct );
+    graph.Read( readUnused, unused, PixelShaderResource );
+    graph.Write( readUnused, unusedChain, RenderTarget );
+
+    auto sideEffect = graph.AddPass( L"Side Effect", QueueType::Compute );
+    graph.SetNeverCull( sideEffect );
+
+    auto present = graph.AddPass( L"Present", QueueType::Direct );
+    graph.Read( present, used, PixelShaderResource );
+    graph.Write( present, backBuffer, RenderTarget );
+
+    // Overwrites the used texture after it's read: a write-after-read doesn't make the pass needed.
+    auto overwrite = graph.AddPass( L"Overwrite", QueueType::Direct );
+    graph.Write( overwrite, used, RenderTarget );
+
+    graph.Compile();
+
+    CHECK( graph.IsPassCulled( writeUnused ) );
+    CHECK( graph.IsPassCulled( readUnused ) );
+    CHECK( graph.IsPassCulled( overwrite ) );
+    CHECK( !graph.IsPassCulled( writeUsed ) );
+    CHECK( !graph.IsPassCulled( sideEffect ) );
+    CHECK( !graph.IsPassCulled( present ) );
+    CHECK( graph.GetExecutionOrder().size() == 3 );
+    CHECK( graph.GetStats().NumPasses == 6 );
+    CHECK( graph.GetStats().NumCulledPasses == 3 );
+
+    // The textures of the culled passes are never allocated.
+    CHECK( graph.GetLifetime( unused ).TransientIndex == FrameGraphCompiler::InvalidTransientIndex );
+    CHECK( graph.GetLifetime( unusedChain ).TransientIndex == FrameGraphCompiler::InvalidTransientIndex );
+    CHECK( graph.GetLifetime( used ).TransientIndex == 0 );
+    CHECK( graph.GetStats().NumTransientTextures == 1 );
+
+    // Without any output or never culled pass, everything goes.
+    FrameGraphCompiler empty;
+    auto texture = empty.CreateTransientResource( L"Texture" );
+    auto pass = empty.AddPass( L"Pass", QueueType::Direct );
+    empty.Write( pass, texture, RenderTarget );
+    empty.Compile();
+    CHECK( empty.IsPassCulled( pass ) );
+    CHECK( empty.GetExecutionOrder().empty() );
+    CHECK( empty.GetBatches().empty() );
+}
+
+// Every edge is respected. Ties go to the queue of the previous pass, then to the declaration order.
+TEST( FrameGraph_TopologicalOrder )
+{
+    FrameGraphCompiler graph;
+    auto backBuffer = graph.ImportResource( L"Back Buffer" );
+    auto color = graph.CreateTransientResource( L"Color" );
+    auto buffer = graph.CreateTransientResource( L"Buffer" );
+    graph.MarkOutput( backBuffer );
+
+    auto render = graph.AddPass( L"Render", QueueType::Direct );
+    graph.Write( render, color, RenderTarget );
+
+    // Independent of the Direct passes.
+    auto compute = graph.AddPass( L"Compute", QueueType::Compute );
+    graph.Write( compute, buffer, UnorderedAccess );
+
+    auto post = graph.AddPass( L"Post", QueueType::Direct );
+    graph.Read( post, color, PixelShaderResource );
+    graph.Write( post, backBuffer, RenderTarget );
+
+    auto consume = graph.AddPass( L"Consume", QueueType::Compute );
+    graph.Read( consume, buffer, NonPixelShaderResource );
+    graph.SetNeverCull( consume );
+
+    // Overwrites what Post reads: after it (write-after-read), even though it doesn't need its data.
+    auto overwrite = graph.AddPass( L"Overwrite", QueueType::Direct );
+    graph.Write( overwrite, color, RenderTarget );
+    graph.Write( overwrite, backBuffer, RenderTarget );
+
+    graph.Compile();
+
+    // Post runs right after Render (same queue) although Compute is declared before it.
+    std::vector<FrameGraphCompiler::PassHandle> expected = { render, post, overwrite, compute, consume };
+    CHECK( graph.GetExecutionOrder() == expected );
+    CHECK( graph.GetBatches().size() == 2 );
+
+    // A dependency declared on a later pass moves it first.
+    FrameGraphCompiler explicitGraph;
+    auto first = explicitGraph.AddPass( L"First", QueueType::Direct );
+    auto second = explicitGraph.AddPass( L"Second", QueueType::Direct );
+    auto third = explicitGraph.AddPass( L"Third", QueueType::Direct );
+    explicitGraph.SetNeverCull( first );
+    explicitGraph.AddDependency( first, third );
+    explicitGraph.AddDependency( third, second );
+    explicitGraph.Compile();
+    CHECK( GetOrderIndex( explicitGraph, second ) < GetOrderIndex( explicitGraph, third ) );
+    CHECK( GetOrderIndex( explicitGraph, third ) < GetOrderIndex( explicitGraph, first ) );
+    CHECK( explicitGraph.GetExecutionOrder().size() == 3 );
+}
+
+// A transition only when the state changes, the consecutive reads of a queue share one, UAV barriers between UAV writes.
+TEST( FrameGraph_BarrierMerging )
+{
+    FrameGraphCompiler graph;
+    auto backBuffer = graph.ImportResource( L"Back Buffer", D3D12_RESOURCE_STATE_COMMON );
+    // Already in the state of its first access.
+    auto history = graph.ImportResource( L"History", RenderTarget );
+    auto uav = graph.ImportResource( L"UAV", UnorderedAccess );
+    graph.MarkOutput( backBuffer );
+
+    auto render = graph.AddPass( L"Render", QueueType::Direct );
+    graph.Write( render, history, RenderTarget );
+
+    auto readPixel = graph.AddPass( L"Read Pixel", QueueType::Direct );
+    graph.Read( readPixel, history, PixelShaderResource );
+
+    auto readNonPixel = graph.AddPass( L"Read Non Pixel", QueueType::Direct );
+    graph.Read( readNonPixel, history, NonPixelShaderResource );
+    graph.Write( readNonPixel, uav, UnorderedAccess );
+
+    auto writeUAV = graph.AddPass( L"Write UAV", QueueType::Direct );
+    graph.Write( writeUAV, uav, UnorderedAccess );
+
+    auto rewrite = graph.AddPass( L"Rewrite", QueueType::Direct );
+    graph.Read( rewrite, uav, NonPixelShaderResource );
+    graph.Write( rewrite, history, RenderTarget );
+
+    auto present = graph.AddPass( L"Present", QueueType::Direct );
+    graph.Read( present, history, PixelShaderResource );
+    graph.Read( present, uav, PixelShaderResource );
+    graph.Write( present, backBuffer, RenderTarget );
+
+    for ( auto pass : { readPixel, readNonPixel, writeUAV } )
+    {
+        graph.SetNeverCull( pass );
+    }
+
+    graph.Compile();
+
+    CHECK( GetBarriers( graph.GetPassBarriers( render ), history ).empty() );
+
+    // One transition to both read states, the second read is covered.
+    auto readBarriers = GetBarriers( graph.GetPassBarriers( readPixel ), history );
+    REQUIRE( readBarriers.size() == 1 );
+    CHECK( IsTransition( readBarriers[0], RenderTarget, PixelShaderResource | NonPixelShaderResource ) );
+    CHECK( GetBarriers( graph.GetPassBarriers( readNonPixel ), history ).empty() );
+
+    // The first UAV write follows the initial state, the second one waits for it.
+    CHECK( GetBarriers( graph.GetPassBarriers( readNonPixel ), uav ).empty() );
+    auto uavBarriers = GetBarriers( graph.GetPassBarriers( writeUAV ), uav );
+    REQUIRE( uavBarriers.size() == 1 );
+    CHECK( uavBarriers[0].BarrierType == Barrier::Type::UAV );
+
+    // The two reads of the UAV merge into one transition in Rewrite.
+    auto rewriteBarriers = GetBarriers( graph.GetPassBarriers( rewrite ), uav );
+    REQUIRE( rewriteBarriers.size() == 1 );
+    CHECK( IsTransition( rewriteBarriers[0], UnorderedAccess, NonPixelShaderResource | PixelShaderResource ) );
+    CHECK( GetBarriers( graph.GetPassBarriers( present ), uav ).empty() );
+
+    // Written in between: a new transition for the next read.
+    auto historyBarriers = GetBarriers( graph.GetPassBarriers( rewrite ), history );
+    REQUIRE( historyBarriers.size() == 1 );
+    CHECK( IsTransition( historyBarriers[0], PixelShaderResource | NonPixelShaderResource, RenderTarget ) );
+    auto presentBarriers = GetBarriers( graph.GetPassBarriers( present ), history );
+    REQUIRE( presentBarriers.size() == 1 );
+    CHECK( IsTransition( presentBarriers[0], RenderTarget, PixelShaderResource ) );
+
+    CHECK( graph.GetFinalState( history ) == PixelShaderResource );
+    CHECK( graph.GetFinalState( backBuffer ) == RenderTarget );
+    // History: 3 transitions, UAV: 1 UAV barrier + 1 transition, back buffer: 1 transition.
+    CHECK( graph.GetStats().NumBarriers == 6 );
+}
+
+// A dependency on a pass that (transitively) depends on it can't be ordered.
+TEST( FrameGraph_Cycle )
+{
+    FrameGraphCompiler graph;
+    auto output = graph.ImportResource( L"Output" );
+    auto texture = graph.CreateTransientResource( L"Texture" );
+    graph.MarkOutput( output );
+
+    auto produce = graph.AddPass( L"Produce", QueueType::Direct );
+    graph.Write( produce, texture, RenderTarget );
+
+    auto consume = graph.AddPass( L"Consume", QueueType::Direct );
+    graph.Read( consume, texture, PixelShaderResource );
+    graph.Write( consume, output, RenderTarget );
+
+    graph.Compile();
+    CHECK( graph.GetExecutionOrder().size() == 2 );
+
+    graph.AddDependency( produce, consume );
+    CHECK_THROWS( graph.Compile() );
+
+    // Through a pass that is only ordered (write-after-read).
+    FrameGraphCompiler orderGraph;
+    auto orderOutput = orderGraph.ImportResource( L"Output" );
+    auto orderTexture = orderGraph.ImportResource( L"Texture" );
+    orderGraph.MarkOutput( orderOutput );
+
+    auto read = orderGraph.AddPass( L"Read", QueueType::Direct );
+    orderGraph.Read( read, orderTexture, PixelShaderResource );
+    orderGraph.SetNeverCull( read );
+
+    auto write = orderGraph.AddPass( L"Write", QueueType::Direct );
+    orderGraph.Write( write, orderTexture, RenderTarget );
+    orderGraph.Write( write, orderOutput, RenderTarget );
+
+    orderGraph.AddDependency( read, write );
+    CHECK_THROWS( orderGraph.Compile() );
+
+    // A culled pass doesn't make a cycle.
+    FrameGraphCompiler culledGraph;
+    auto kept = culledGraph.AddPass( L"Kept", QueueType::Direct );
+    auto culledA = culledGraph.AddPass( L"Culled A", QueueType::Direct );
+    auto culledB = culledGraph.AddPass( L"Culled B", QueueType::Direct );
+    culledGraph.SetNeverCull( kept );
+    culledGraph.AddDependency( culledA, culledB );
+    culledGraph.AddDependency( culledB, culledA );
+    culledGraph.Compile();
+    CHECK( culledGraph.GetExecutionOrder().size() == 1 );
+}
+
+// Direct -> Compute -> Direct: the compute queue can't leave the graphics only states, the Direct pass does it after
+// its work. Each queue change is a batch that waits for the other queue.
+TEST( FrameGraph_ComputeQueueHandoff )
+{
+    FrameGraphCompiler graph;
+    auto backBuffer = graph.ImportResource( L"Back Buffer" );
+    auto depth = graph.CreateTransientResource( L"Depth" );
+    auto hiz = graph.CreateTransientResource( L"Hi-Z" );
+    auto color = graph.CreateTransientResource( L"Color" );
+    graph.MarkOutput( backBuffer );
+
+    auto gbuffer = graph.AddPass( L"G-Buffer", QueueType::Direct );
+    graph.Write( gbuffer, depth, DepthWrite );
+    graph.Write( gbuffer, color, RenderTarget );
+
+    auto buildHiZ = graph.AddPass( L"Build Hi-Z", QueueType::Compute );
+    graph.Read( buildHiZ, depth, NonPixelShaderResource );
+    graph.Write( buildHiZ, hiz, UnorderedAccess );
+
+    auto lighting = graph.AddPass( L"Lighting", QueueType::Direct );
+    graph.Read( lighting, hiz, PixelShaderResource );
+    graph.Read( lighting, depth, PixelShaderResource );
+    graph.Read( lighting, color, PixelShaderResource );
+    graph.Write( lighting, backBuffer, RenderTarget );
+
+    graph.Compile();
+
+    std::vector<FrameGraphCompiler::PassHandle> expected = { gbuffer, buildHiZ, lighting };
+    CHECK( graph.GetExecutionOrder() == expected );
+
+    // The depth leaves DEPTH_WRITE at the end of the G-Buffer pass, not in the compute pass.
+    auto postBarriers = GetBarriers( graph.GetPassPostBarriers( gbuffer ), depth );
+    REQUIRE( postBarriers.size() == 1 );
+    CHECK( IsTransition( postBarriers[0], DepthWrite, NonPixelShaderResource ) );
+    CHECK( GetBarriers( graph.GetPassBarriers( buildHiZ ), depth ).empty() );
+    CHECK( GetBarriers( graph.GetPassBarriers( buildHiZ ), hiz ).empty() );
+
+    // Back on the Direct queue: a transition to the pixel shader reads, the depth is returned to its first state after.
+    auto hizBarriers = GetBarriers( graph.GetPassBarriers( lighting ), hiz );
+    REQUIRE( hizBarriers.size() == 1 );
+    CHECK( IsTransition( hizBarriers[0], UnorderedAccess, PixelShaderResource ) );
+    auto depthBarriers = GetBarriers( graph.GetPassBarriers( lighting ), depth );
+    REQUIRE( depthBarriers.size() == 1 );
+    CHECK( IsTransition( depthBarriers[0], NonPixelShaderResource, PixelShaderResource ) );
+    auto depthReturn = GetBarriers( graph.GetPassPostBarriers( lighting ), depth );
+    REQUIRE( depthReturn.size() == 1 );
+    CHECK( IsTransition( depthReturn[0], PixelShaderResource, DepthWrite ) );
+    CHECK( graph.GetFinalState( depth ) == DepthWrite );
+
+    const auto& batches = graph.GetBatches();
+    REQUIRE( batches.size() == 3 );
+    CHECK( batches[0].Queue == QueueType::Direct && batches[0].WaitForBatches.empty() );
+    CHECK( batches[1].Queue == QueueType::Compute && batches[1].WaitForBatches == std::vector<uint32_t>{ 0 } );
+    CHECK( batches[2].Queue == QueueType::Direct && batches[2].WaitForBatches == std::vector<uint32_t>{ 1 } );
+    CHECK( graph.GetPassBatch( buildHiZ ) == 1 );
+    CHECK( graph.GetStats().NumCrossQueueWaits == 2 );
+
+    // Used on the compute queue: alive for the whole frame (never aliased). The others only between their uses.
+    CHECK( graph.GetLifetime( hiz ).FirstPass == 0 );
+    CHECK( graph.GetLifetime( hiz ).LastPass == 2 );
+    CHECK( graph.GetLifetime( color ).FirstPass == 0 );
+    CHECK( graph.GetLifetime( color ).LastPass == 2 );
+    CHECK( graph.GetInitialState( hiz ) == UnorderedAccess );
+}
+
+// The compute queue can't use, or leave, a graphics only state that no Direct pass can handle.
+TEST( FrameGraph_ComputeQueueErrors )
+{
+    FrameGraphCompiler graphicsState;
+    auto texture = graphicsState.ImportResource( L"Texture" );
+    auto pass = graphicsState.AddPass( L"Compute", QueueType::Compute );
+    graphicsState.Read( pass, texture, PixelShaderResource );
+    graphicsState.SetNeverCull( pass );
+    CHECK_THROWS( graphicsState.Compile() );
+
+    // Enters the graph as a render target, nothing on the Direct queue transitions it before.
+    FrameGraphCompiler enteringState;
+    auto renderTarget = enteringState.ImportResource( L"Render Target", RenderTarget );
+    auto computePass = enteringState.AddPass( L"Compute", QueueType::Compute );
+    enteringState.Read( computePass, renderTarget, NonPixelShaderResource );
+    enteringState.SetNeverCull( computePass );
+    CHECK_THROWS( enteringState.Compile() );
+}
@@ -0,0 +1,156 @@
+#include "Test.h"
+
+#include <Framework/FreeListAllocator.h>
+
+#include <algorithm>
+#include <random>
+
+TEST( FreeListAllocator_BestFit )
+{
+    FreeListAllocator allocator( 1000 );
+    uint32_t a = allocator.Allocate( 100 );
+    uint32_t b = allocator.Allocate( 300 );
+    uint32_t c = allocator.Allocate( 50 );
+    uint32_t d = allocator.Allocate( 100 );
+    CHECK( a == 0 );
+    CHECK( b == 100 );
+    CHECK( c == 400 );
+    CHECK( d == 450 );
+
+    // Free ranges of 100, 50 and 450 (the end): 40 goes in the smallest one that fits.
+    allocator.Free( a, 100 );
+    allocator.Free( c, 50 );
+    CHECK( allocator.GetNumFreeRanges() == 3 );
+    CHECK( allocator.Allocate( 40 ) == 400 );
+    CHECK( allocator.Allocate( 60 ) == 0 );
+    CHECK( allocator.Allocate( 450 ) == 550 );
+    // Left: 40 at 60, 10 at 440.
+    CHECK( allocator.Allocate( 41 ) == FreeListAllocator::InvalidOffset );
+    CHECK( allocator.Allocate( 0 ) == FreeListAllocator::InvalidOffset );
+    CHECK( allocator.GetLargestFreeRange() == 40 );
+    CHECK( allocator.Allocate( 10 ) == 440 );
+    CHECK( allocator.Allocate( 40 ) == 60 );
+    CHECK( allocator.GetUsedSize() == 1000 );
+    CHECK( allocator.GetLargestFreeRange() == 0 );
+}
+
+TEST( FreeListAllocator_InvalidFrees )
+{
+    FreeListAllocator allocator( 1000 );
+    uint32_t offset = allocator.Allocate( 100 );
+    allocator.Allocate( 100 );
+
+    CHECK_THROWS( allocator.Free( 950, 100 ) );
+    CHECK_THROWS( allocator.Free( 1000, 1 ) );
+    CHECK_THROWS( allocator.Free( offset, 0 ) );
+    // Overlapping the free range after the allocations.
+    CHECK_THROWS( allocator.Free( 150, 100 ) );
+
+    allocator.Free( offset, 100 );
+    // Twice, or overlapping the free range before.
+    CHECK_THROWS( allocator.Free( offset, 100 ) );
+    CHECK_THROWS( allocator.Free( 50, 100 ) );
+
+    CHECK( allocator.GetUsedSize() == 100 );
+    CHECK( allocator.GetNumAllocations() == 1 );
+}
+
+TEST( FreeListAllocator_SameSizeRanges )
+{
+    // Many free ranges of the same size: the one removed on a merge is the right one.
+    FreeListAllocator allocator( 64 * 16 );
+    for ( uint32_t i = 0; i < 64; ++i )
+    {
+        CHECK( allocator.Allocate( 16 ) == i * 16 );
+    }
+    for ( uint32_t i = 0; i < 64; i += 2 )
+    {
+        allocator.Free( i * 16, 16 );
+    }
+    CHECK( allocator.GetNumFreeRanges() == 32 );
+    CHECK( allocator.GetLargestFreeRange() == 16 );
+
+    allocator.Free( 33 * 16, 16 );
+    CHECK( allocator.GetNumFreeRanges() == 31 );
+    CHECK( allocator.GetLargestFreeRange() == 48 );
+    CHECK( allocator.Allocate( 48 ) == 32 * 16 );
+    CHECK( allocator.GetLargestFreeRange() == 16 );
+
+    // Among the free ranges of the best fit size, the lowest offset.
+    CHECK( allocator.Allocate( 16 ) == 0 );
+    CHECK( allocator.Allocate( 16 ) == 2 * 16 );
+    allocator.Free( 0, 16 );
+    CHECK( allocator.Allocate( 16 ) == 0 );
+}
+
+// Random allocations and frees, checked against a map of the allocated elements.
+TEST( FreeListAllocator_Random )
+{
+    const uint32_t capacity = 1u << 20;
+    const uint32_t numOperations = 100000;
+
+    FreeListAllocator allocator( capacity );
+    std::vector<bool> isAllocated( capacity, false );
+
+    struct Range
+    {
+        uint32_t Offset;
+        uint32_t Size;
+    };
+    std::vector<Range> ranges;
+
+    std::mt19937 random( 7 );
+    std::uniform_int_distribution<uint32_t> sizeDistribution( 1, 4096 );
+
+    // 2 allocations for 1 free: the allocator fills up, then runs near its capacity.
+    for ( uint32_t operation = 0; operation < numOperations; ++operation )
+    {
+        if ( ranges.empty() || random() % 3 != 0 )
+        {
+            uint32_t size = sizeDistribution( random );
+            uint32_t offset = allocator.Allocate( size );
+            if ( offset == FreeListAllocator::InvalidOffset )
+            {
+                // The allocation failed with a large enough free range.
+                REQUIRE( allocator.GetLargestFreeRange() < size );
+                continue;
+            }
+
+            for ( uint32_t i = offset; i < offset + size; ++i )
+            {
+                // Overlapping allocations.
+                REQUIRE( i < capacity && !isAllocated[i] );
+                isAllocated[i] = true;
+            }
+            ranges.push_back( { offset, size } );
+        }
+        else
+        {
+            size_t index = random() % ranges.size();
+            Range range = ranges[index];
+            ranges[index] = ranges.back();
+            ranges.pop_back();
+
+            allocator.Free( range.Offset, range.Size );
+            std::fill( isAllocated.begin() + range.Offset, isAllocated.begin() + range.Offset + range.Size, false );
+        }
+    }
+
+    uint32_t usedSize = 0;
+    for ( const Range& range : ranges )
+    {
+        usedSize += range.Size;
+    }
+    CHECK( usedSize == allocator.GetUsedSize() );
+    CHECK( ranges.size() == allocator.GetNumAllocations() );
+    CHECK( allocator.GetNumFreeRanges() > 1 );
+
+    // Freeing everything must merge the free ranges back into one.
+    for ( const Range& range : ranges )
+    {
+        allocator.Free( range.Offset, range.Size );
+    }
+    CHECK( allocator.GetNumFreeRanges() == 1 );
+    CHECK( allocator.GetLargestFreeRange() == capacity );
+    CHECK( allocator.GetUsedSize() == 0 );
+}
@@ -0,0 +1,112 @@
+#include "Test.h"
+#include "TestGeometry.h"
+
+#include <Framework/CullingMath.h>
+#include <Framework/FrustumCuller.h>
+
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+    const FrustumCuller::InstructionSet InstructionSets[] = {
+        FrustumCuller::InstructionSet::Scalar,
+        FrustumCuller::InstructionSet::SSE,
+        FrustumCuller::InstructionSet::AVX,
+    };
+
+    FrustumCuller MakeCuller( const std::vector<BoundingBox>& boxes )
+    {
+        FrustumCuller culler;
+        culler.Reserve( static_cast<uint32_t>( boxes.size() ) );
+        for ( const BoundingBox& box : boxes )
+        {
+            culler.AddBox( box.Center, box.Extents );
+        }
+        return culler;
+    }
+}
+
+// Every instruction set gives the boxes of CullingMath::IsInFrustum, in increasing order. The counts aren't multiples
+// of 8: the scalar tail of the SIMD paths is covered.
+TEST( FrustumCuller_MatchesCullingMath )
+{
+    XMFLOAT4X4 viewProjection = TestGeometry::MakeViewProjection();
+    CullingMath::View view = CullingMath::MakeView( viewProjection );
+
+    for ( uint32_t numBoxes : { 0u, 1u, 7u, 1003u } )
+    {
+        std::vector<BoundingBox> boxes = TestGeometry::MakeRandomBoxes( numBoxes );
+        FrustumCuller culler = MakeCuller( boxes );
+
+        std::vector<uint32_t> expected;
+        for ( uint32_t i = 0; i < numBoxes; ++i )
+        {
+            CullingMath::InstanceBounds bounds = {};
+            bounds.Center = boxes[i].Center;
+            bounds.Extents = boxes[i].Extents;
+            if ( CullingMath::IsInFrustum( view, bounds ) )
+            {
+                expected.push_back( i );
+            }
+        }
+
+        for ( FrustumCuller::InstructionSet instructionSet : InstructionSets )
+        {
+            if ( !FrustumCuller::IsSupported( instructionSet ) )
+                continue;
+
+            std::vector<uint32_t> visible;
+            culler.Cull( viewProjection, visible, instructionSet );
+            CHECK( visible == expected );
+        }
+    }
+}
+
+TEST( FrustumCuller_Unsupported )
+{
+    CHECK( FrustumCuller::IsSupported( FrustumCuller::InstructionSet::Scalar ) );
+    CHECK( FrustumCuller::IsSupported( FrustumCuller::GetBestInstructionSet() ) );
+    if ( !FrustumCuller::IsSupported( FrustumCuller::InstructionSet::AVX ) )
+    {
+        std::vector<uint32_t> visible;
+        CHECK_THROWS( FrustumCuller().Cull( TestGeometry::MakeViewProjection(), visible, FrustumCuller::InstructionSet::AVX ) );
+    }
+}
+
+BENCHMARK( FrustumCuller_Benchmark )
+{
+    const uint32_t NumIterations = 100;
+    XMFLOAT4X4 viewProjection = TestGeometry::MakeViewProjection();
+
+    for ( uint32_t numBoxes : { 1000u, 10000u, 100000u } )
+    {
+        FrustumCuller culler = MakeCuller( TestGeometry::MakeRandomBoxes( numBoxes ) );
+
+        std::vector<uint32_t> referenceVisible;
+        std::vector<uint32_t> visible;
+        visible.reserve( numBoxes );
+
+        for ( FrustumCuller::InstructionSet instructionSet : InstructionSets )
+        {
+            if ( !FrustumCuller::IsSupported( instructionSet ) )
+                continue;
+
+            Test::Stopwatch stopwatch;
+            for ( uint32_t i = 0; i < NumIterations; ++i )
+            {
+                culler.Cull( viewProjection, visible, instructionSet );
+            }
+            double averageTimeMs = stopwatch.GetElapsedMs() / NumIterations;
+
+            // The scalar path is the reference.
+            if ( instructionSet == FrustumCuller::InstructionSet::Scalar )
+                referenceVisible = visible;
+            CHECK( visible == referenceVisible );
+
+            std::printf( "    %u boxes, %-6s: %.4f ms (%zu visible)\n", numBoxes, FrustumCuller::GetInstructionSetName( instructionSet ),
+                         averageTimeMs, visible.size() );
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include "Test.h"
+#include "TestGeometry.h"
+
+#include <Framework/Material/IndexBuffer.h>
+#include <Framework/MeshletBuilder.h>
+#include <Framework/MeshSimplifier.h>
+#include <Framework/VertexCacheOptimizer.h>
+
+#include <algorithm>
+
+namespace
+{
+    uint32_t GetMaxIndex( const std::vector<uint32_t>& indices )
+    {
+        return indices.empty() ? 0 : *std::max_element( indices.begin(), indices.end() );
+    }
+}
+
+TEST( IndexFormat_Select )
+{
+    CHECK( IndexBuffer::SelectIndexFormat( 0 ) == DXGI_FORMAT_R16_UINT );
+    // The small sphere of the sample: 17 * 33 vertices.
+    CHECK( IndexBuffer::SelectIndexFormat( 17 * 33 ) == DXGI_FORMAT_R16_UINT );
+    // The largest index is 65534, below the strip cut value.
+    CHECK( IndexBuffer::SelectIndexFormat( 0xFFFF ) == DXGI_FORMAT_R16_UINT );
+    CHECK( IndexBuffer::SelectIndexFormat( 0x10000 ) == DXGI_FORMAT_R32_UINT );
+    // The large sphere: 193 * 385 vertices.
+    CHECK( IndexBuffer::SelectIndexFormat( 193 * 385 ) == DXGI_FORMAT_R32_UINT );
+}
+
+// More than 65535 vertices: the indices stay 32-bit through the load-time processing of a mesh.
+TEST( IndexFormat_LargeMesh )
+{
+    TestGeometry::Mesh mesh = TestGeometry::MakeGrid( 300, 300 );
+    uint32_t numVertices = static_cast<uint32_t>( mesh.Positions.size() );
+    REQUIRE( IndexBuffer::SelectIndexFormat( numVertices ) == DXGI_FORMAT_R32_UINT );
+    REQUIRE( GetMaxIndex( mesh.Indices ) == numVertices - 1 );
+
+    std::vector<uint32_t> indices = mesh.Indices;
+    VertexCacheOptimizer::OptimizeVertexCache( indices, numVertices );
+    CHECK( GetMaxIndex( indices ) == numVertices - 1 );
+
+    std::vector<uint32_t> remap = VertexCacheOptimizer::OptimizeVertexFetch( indices, numVertices );
+    CHECK( GetMaxIndex( indices ) == numVertices - 1 );
+    std::vector<DirectX::XMFLOAT3> positions = VertexCacheOptimizer::RemapVertices( mesh.Positions, remap );
+    REQUIRE( positions.size() == numVertices );
+
+    std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::BuildLods( positions.data(), numVertices, indices, 3 );
+    REQUIRE( lods.size() > 1 );
+    for ( const MeshSimplifier::Lod& lod : lods )
+    {
+        // The LODs index the vertex buffer of the mesh: the same format.
+        CHECK( GetMaxIndex( lod.Indices ) < numVertices );
+    }
+    CHECK( GetMaxIndex( lods.front().Indices ) > 0xFFFF );
+    CHECK( lods[1].Indices.size() < lods[0].Indices.size() );
+
+    MeshletBuilder::MeshletMesh meshlets = MeshletBuilder::Build( positions.data(), numVertices, indices );
+    CHECK( meshlets.Indices.size() == indices.size() );
+    CHECK( GetMaxIndex( meshlets.Vertices ) == numVertices - 1 );
+    for ( const MeshletBuilder::Meshlet& meshlet : meshlets.Meshlets )
+    {
+        for ( uint32_t t = 0; t < meshlet.TriangleCount * 3; ++t )
+        {
+            uint32_t local = ( meshlets.Primitives[meshlet.TriangleOffset + t / 3] >> ( 8 * ( t % 3 ) ) ) & 0xFF;
+            REQUIRE( meshlets.Vertices[meshlet.VertexOffset + local] == meshlets.Indices[meshlet.TriangleOffset * 3 + t] );
+        }
+    }
+}
+
+// Up to 65535 vertices, every index fits in 16 bits (Mesh narrows them for the R16_UINT buffer).
+TEST( IndexFormat_SmallMesh )
+{
+    TestGeometry::Mesh mesh = TestGeometry::MakeGrid( 255, 257 );
+    uint32_t numVertices = static_cast<uint32_t>( mesh.Positions.size() );
+    REQUIRE( numVertices == 0xFFFF );
+    CHECK( IndexBuffer::SelectIndexFormat( numVertices ) == DXGI_FORMAT_R16_UINT );
+
+    std::vector<MeshSimplifier::Lod> lods = MeshSimplifier::BuildLods( mesh.Positions.data(), numVertices, mesh.Indices, 3 );
+    for ( const MeshSimplifier::Lod& lod : lods )
+    {
+        CHECK( GetMaxIndex( lod.Indices ) < 0xFFFF );
+    }
+}
@@ -0,0 +1,233 @@
+#include "Test.h"
+
+#include <Framework/IndirectDrawBuilder.h>
+
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+    using DrawCommand = IndirectDrawBuilder::DrawCommand;
+
+    // The size of an argument in the command, as ExecuteIndirect reads it.
+    uint32_t GetArgumentSize( const D3D12_INDIRECT_ARGUMENT_DESC& argumentDesc )
+    {
+        switch ( argumentDesc.Type )
+        {
+        case D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW:
+            return sizeof( D3D12_VERTEX_BUFFER_VIEW );
+        case D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW:
+            return sizeof( D3D12_INDEX_BUFFER_VIEW );
+        case D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT:
+            return argumentDesc.Constant.Num32BitValuesToSet * sizeof( uint32_t );
+        case D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED:
+            return sizeof( D3D12_DRAW_INDEXED_ARGUMENTS );
+        default:
+            return 0;
+        }
+    }
+
+    D3D12_VERTEX_BUFFER_VIEW MakeVertexBufferView( uint64_t bufferLocation, uint32_t numVertices, uint32_t stride )
+    {
+        return { bufferLocation, numVertices * stride, stride };
+    }
+
+    D3D12_INDEX_BUFFER_VIEW MakeIndexBufferView( uint64_t bufferLocation, uint32_t numIndices, DXGI_FORMAT format )
+    {
+        uint32_t indexSize = format == DXGI_FORMAT_R16_UINT ? 2 : 4;
+        return { bufferLocation, numIndices * indexSize, format };
+    }
+
+    // A mesh part as the sample draws it: its own buffers, a range of the index buffer.
+    struct Part
+    {
+        D3D12_VERTEX_BUFFER_VIEW    VertexBufferView;
+        D3D12_INDEX_BUFFER_VIEW     IndexBufferView;
+        uint32_t                    IndexCount;
+        uint32_t                    StartIndex;
+        int32_t                     BaseVertex;
+    };
+
+    const Part Parts[] = {
+        { MakeVertexBufferView( 0x10000, 1000, 32 ), MakeIndexBufferView( 0x80000, 3000, DXGI_FORMAT_R16_UINT ), 3000, 0, 0 },
+        { MakeVertexBufferView( 0x20000, 500, 16 ), MakeIndexBufferView( 0x90000, 6000, DXGI_FORMAT_R32_UINT ), 1500, 4500, 250 },
+        { MakeVertexBufferView( 0x20000, 500, 16 ), MakeIndexBufferView( 0x90000, 6000, DXGI_FORMAT_R32_UINT ), 3, 0, 499 },
+    };
+}
+
+TEST( IndirectDrawBuilder_LayoutMatchesCommandSignature )
+{
+    const uint32_t rootParameter = 3;
+    std::vector<D3D12_INDIRECT_ARGUMENT_DESC> argumentDescs = IndirectDrawBuilder::GetArgumentDescs( rootParameter );
+    REQUIRE( argumentDescs.size() == 4 );
+
+    CHECK( argumentDescs[0].Type == D3D12_INDIRECT_ARGUMENT_TYPE_VERTEX_BUFFER_VIEW );
+    CHECK( argumentDescs[0].VertexBuffer.Slot == 0 );
+    CHECK( argumentDescs[1].Type == D3D12_INDIRECT_ARGUMENT_TYPE_INDEX_BUFFER_VIEW );
+    CHECK( argumentDescs[2].Type == D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT );
+    CHECK( argumentDescs[2].Constant.RootParameterIndex == rootParameter );
+    CHECK( argumentDescs[2].Constant.DestOffsetIn32BitValues == 0 );
+    CHECK( argumentDescs[2].Constant.Num32BitValuesToSet == 1 );
+    // The draw must be the last argument.
+    CHECK( argumentDescs[3].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED );
+
+    // The members of DrawCommand where the command signature reads the arguments, back to back.
+    const size_t memberOffsets[] = {
+        offsetof( DrawCommand, VertexBufferView ),
+        offsetof( DrawCommand, IndexBufferView ),
+        offsetof( DrawCommand, DrawIndex ),
+        offsetof( DrawCommand, DrawArguments ),
+    };
+    uint32_t offset = 0;
+    for ( size_t i = 0; i < argumentDescs.size(); ++i )
+    {
+        CHECK( memberOffsets[i] == offset );
+        offset += GetArgumentSize( argumentDescs[i] );
+    }
+    CHECK( offset == IndirectDrawBuilder::GetByteStride() );
+    CHECK( sizeof( DrawCommand ) == IndirectDrawBuilder::GetByteStride() );
+}
+
+TEST( IndirectDrawBuilder_ArgumentBufferStride )
+{
+    IndirectDrawBuilder builder;
+    for ( const Part& part : Parts )
+    {
+        builder.AddDraw( part.VertexBufferView, part.IndexBufferView, part.IndexCount, part.StartIndex, part.BaseVertex );
+    }
+    REQUIRE( builder.GetNumCommands() == 3 );
+    CHECK( builder.GetByteSize() == 3 * IndirectDrawBuilder::GetByteStride() );
+
+    // The argument buffer is a copy of the commands: command i starts at i * stride.
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>( builder.GetCommands().data() );
+    for ( uint32_t i = 0; i < builder.GetNumCommands(); ++i )
+    {
+        const uint8_t* command = bytes + i * IndirectDrawBuilder::GetByteStride();
+
+        D3D12_VERTEX_BUFFER_VIEW vertexBufferView;
+        std::memcpy( &vertexBufferView, command + offsetof( DrawCommand, VertexBufferView ), sizeof( vertexBufferView ) );
+        CHECK( vertexBufferView.BufferLocation == Parts[i].VertexBufferView.BufferLocation );
+
+        uint32_t drawIndex;
+        std::memcpy( &drawIndex, command + offsetof( DrawCommand, DrawIndex ), sizeof( drawIndex ) );
+        CHECK( drawIndex == i );
+    }
+}
+
+TEST( IndirectDrawBuilder_IndexFormatValidation )
+{
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView = MakeVertexBufferView( 0x10000, 100, 32 );
+    D3D12_INDEX_BUFFER_VIEW indexBufferView = MakeIndexBufferView( 0x80000, 300, DXGI_FORMAT_R16_UINT );
+
+    IndirectDrawBuilder builder;
+    builder.AddDraw( vertexBufferView, indexBufferView, 300 );
+    indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+    builder.AddDraw( vertexBufferView, indexBufferView, 150 );
+
+    // Only the 16 and 32-bit index formats.
+    indexBufferView.Format = DXGI_FORMAT_UNKNOWN;
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3 ) );
+    indexBufferView.Format = DXGI_FORMAT_R8_UINT;
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3 ) );
+    indexBufferView.Format = DXGI_FORMAT_R32_FLOAT;
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3 ) );
+
+    // The same range fits 16-bit indices, not 32-bit ones.
+    indexBufferView.Format = DXGI_FORMAT_R16_UINT;
+    builder.AddDraw( vertexBufferView, indexBufferView, 3, 297 );
+    indexBufferView.Format = DXGI_FORMAT_R32_UINT;
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3, 297 ) );
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 0 ) );
+
+    indexBufferView.BufferLocation = 0;
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3 ) );
+
+    // The failed draws aren't added.
+    CHECK( builder.GetNumCommands() == 3 );
+}
+
+TEST( IndirectDrawBuilder_VertexBufferValidation )
+{
+    D3D12_VERTEX_BUFFER_VIEW vertexBufferView = MakeVertexBufferView( 0x10000, 100, 32 );
+    D3D12_INDEX_BUFFER_VIEW indexBufferView = MakeIndexBufferView( 0x80000, 300, DXGI_FORMAT_R32_UINT );
+
+    IndirectDrawBuilder builder;
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3, 0, 100 ) );
+    CHECK_THROWS( builder.AddDraw( vertexBufferView, indexBufferView, 3, 0, -1 ) );
+
+    D3D12_VERTEX_BUFFER_VIEW noStride = vertexBufferView;
+    noStride.StrideInBytes = 0;
+    CHECK_THROWS( builder.AddDraw( noStride, indexBufferView, 3 ) );
+
+    D3D12_VERTEX_BUFFER_VIEW noBuffer = vertexBufferView;
+    noBuffer.BufferLocation = 0;
+    CHECK_THROWS( builder.AddDraw( noBuffer, indexBufferView, 3 ) );
+
+    CHECK( builder.GetNumCommands() == 0 );
+}
+
+TEST( IndirectDrawBuilder_CommandPerPart )
+{
+    const uint32_t instanceCounts[] = { 1, 1, 4 };
+
+    IndirectDrawBuilder builder;
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        const Part& part = Parts[i];
+        uint32_t drawIndex = builder.AddDraw( part.VertexBufferView, part.IndexBufferView, part.IndexCount, part.StartIndex, part.BaseVertex,
+                                              instanceCounts[i] );
+        CHECK( drawIndex == i );
+    }
+
+    REQUIRE( builder.GetNumCommands() == 3 );
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        const Part& part = Parts[i];
+        const DrawCommand& command = builder.GetCommands()[i];
+
+        CHECK( command.VertexBufferView.BufferLocation == part.VertexBufferView.BufferLocation );
+        CHECK( command.VertexBufferView.SizeInBytes == part.VertexBufferView.SizeInBytes );
+        CHECK( command.VertexBufferView.StrideInBytes == part.VertexBufferView.StrideInBytes );
+
+        CHECK( command.IndexBufferView.BufferLocation == part.IndexBufferView.BufferLocation );
+        CHECK( command.IndexBufferView.SizeInBytes == part.IndexBufferView.SizeInBytes );
+        CHECK( command.IndexBufferView.Format == part.IndexBufferView.Format );
+
+        // The root constant.
+        CHECK( command.DrawIndex == i );
+
+        CHECK( command.DrawArguments.IndexCountPerInstance == part.IndexCount );
+        CHECK( command.DrawArguments.InstanceCount == instanceCounts[i] );
+        CHECK( command.DrawArguments.StartIndexLocation == part.StartIndex );
+        CHECK( command.DrawArguments.BaseVertexLocation == part.BaseVertex );
+        CHECK( command.DrawArguments.StartInstanceLocation == 0 );
+    }
+}
+
+TEST( IndirectDrawBuilder_SharedDrawIndex )
+{
+    // The meshlets of a part: a command each, all with the per-draw data of the part.
+    const Part& part = Parts[1];
+    const uint32_t partDrawIndex = 7;
+
+    IndirectDrawBuilder builder;
+    for ( uint32_t meshlet = 0; meshlet < 4; ++meshlet )
+    {
+        uint32_t drawIndex = builder.AddDraw( part.VertexBufferView, part.IndexBufferView, 372, part.StartIndex + meshlet * 372, part.BaseVertex,
+                                              1, partDrawIndex );
+        CHECK( drawIndex == partDrawIndex );
+    }
+
+    REQUIRE( builder.GetNumCommands() == 4 );
+    for ( uint32_t meshlet = 0; meshlet < 4; ++meshlet )
+    {
+        const DrawCommand& command = builder.GetCommands()[meshlet];
+        CHECK( command.DrawIndex == partDrawIndex );
+        CHECK( command.DrawArguments.StartIndexLocation == part.StartIndex + meshlet * 372 );
+    }
+
+    // The default draw index counts from the start again.
+    builder.Clear();
+    CHECK( builder.GetNumCommands() == 0 );
+    CHECK( builder.AddDraw( part.VertexBufferView, part.IndexBufferView, 3 ) == 0 );
+}
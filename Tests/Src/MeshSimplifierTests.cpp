@@ -0,0 +1,161 @@
+#include "Test.h"
+#include "TestGeometry.h"
+
+#include <Framework/ThreadPool.h>
+#include <Framework/MeshSimplifier.h>
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+    std::vector<MeshSimplifier::Lod> BuildLods( const TestGeometry::Mesh& mesh, uint32_t maxLods )
+    {
+        return MeshSimplifier::BuildLods( mesh.Positions.data(), static_cast<uint32_t>( mesh.Positions.size() ), mesh.Indices, maxLods );
+    }
+
+    // Indices of existing vertices, whole triangles, none degenerate.
+    bool IsValid( const std::vector<uint32_t>& indices, size_t numVertices )
+    {
+        if ( indices.size() % 3 != 0 )
+            return false;
+
+        for ( size_t t = 0; t < indices.size(); t += 3 )
+        {
+            uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+            if ( a >= numVertices || b >= numVertices || c >= numVertices || a == b || b == c || a == c )
+                return false;
+        }
+        return true;
+    }
+}
+
+// The first LOD is the input, the next ones have fewer triangles and a larger error.
+TEST( MeshSimplifier_BuildLods )
+{
+    TestGeometry::Mesh mesh = TestGeometry::MakeGrid( 100, 100 );
+    std::vector<MeshSimplifier::Lod> lods = BuildLods( mesh, 4 );
+    REQUIRE( lods.size() > 1 );
+    CHECK( lods.size() <= 4 );
+    CHECK( lods[0].Indices == mesh.Indices );
+    CHECK( lods[0].Error == 0.0f );
+
+    for ( size_t lod = 1; lod < lods.size(); ++lod )
+    {
+        CHECK( IsValid( lods[lod].Indices, mesh.Positions.size() ) );
+        // At least a tenth of the triangles removed.
+        CHECK( lods[lod].Indices.size() * 10 <= lods[lod - 1].Indices.size() * 9 );
+        CHECK( lods[lod].Error >= lods[lod - 1].Error );
+        // Within 2% of the size of the bounds (100 units).
+        CHECK( lods[lod].Error <= 2.0f );
+    }
+}
+
+// A flat grid loses its inner vertices for free, and keeps its corners (the borders only collapse along themselves).
+TEST( MeshSimplifier_FlatGrid )
+{
+    TestGeometry::Mesh mesh = TestGeometry::MakeGrid( 20, 20 );
+    for ( XMFLOAT3& position : mesh.Positions )
+    {
+        position.z = 0.0f;
+    }
+
+    float error = -1.0f;
+    std::vector<uint32_t> indices = MeshSimplifier::Simplify( mesh.Positions.data(), 400, mesh.Indices, 0, 1e-3f, &error );
+    CHECK( IsValid( indices, mesh.Positions.size() ) );
+    CHECK( indices.size() * 4 < mesh.Indices.size() );
+    CHECK( error >= 0.0f );
+    CHECK( error <= 1e-3f );
+
+    for ( uint32_t corner : { 0u, 19u, 380u, 399u } )
+    {
+        CHECK( std::find( indices.begin(), indices.end(), corner ) != indices.end() );
+    }
+
+    // No error allowed on a curved mesh: the collapses that would move it are skipped.
+    TestGeometry::Mesh curved = TestGeometry::MakeGrid( 20, 20 );
+    indices = MeshSimplifier::Simplify( curved.Positions.data(), 400, curved.Indices, 0, 0.0f, &error );
+    CHECK( error == 0.0f );
+    CHECK( IsValid( indices, curved.Positions.size() ) );
+}
+
+// The same LODs whatever the thread.
+TEST( MeshSimplifier_Parallel )
+{
+    std::vector<TestGeometry::Mesh> meshes = TestGeometry::MakeGrids( 8 );
+
+    std::vector<std::vector<MeshSimplifier::Lod>> serialLods( meshes.size() );
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        serialLods[i] = BuildLods( meshes[i], 4 );
+    }
+
+    ThreadPool threadPool( 3 );
+    std::vector<std::vector<MeshSimplifier::Lod>> parallelLods( meshes.size() );
+    threadPool.ParallelFor( meshes.size(), meshes.size(), [&]( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            parallelLods[i] = BuildLods( meshes[i], 4 );
+        }
+    } );
+
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        REQUIRE( serialLods[i].size() == parallelLods[i].size() );
+        for ( size_t lod = 0; lod < serialLods[i].size(); ++lod )
+        {
+            CHECK( serialLods[i][lod].Indices == parallelLods[i][lod].Indices );
+            CHECK( serialLods[i][lod].Error == parallelLods[i][lod].Error );
+        }
+    }
+}
+
+BENCHMARK( MeshSimplifier_Benchmark )
+{
+    const uint32_t NumLods = 4;
+    std::vector<TestGeometry::Mesh> meshes = TestGeometry::MakeGrids( 32 );
+
+    uint64_t numTriangles = 0;
+    for ( const TestGeometry::Mesh& mesh : meshes )
+    {
+        numTriangles += mesh.Indices.size() / 3;
+    }
+
+    std::vector<std::vector<MeshSimplifier::Lod>> serialLods( meshes.size() );
+    Test::Stopwatch serialStopwatch;
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        serialLods[i] = BuildLods( meshes[i], NumLods );
+    }
+    double serialTimeMs = serialStopwatch.GetElapsedMs();
+
+    ThreadPool threadPool;
+    std::vector<std::vector<MeshSimplifier::Lod>> parallelLods( meshes.size() );
+    Test::Stopwatch parallelStopwatch;
+    threadPool.ParallelFor( meshes.size(), meshes.size(), [&]( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            parallelLods[i] = BuildLods( meshes[i], NumLods );
+        }
+    } );
+    double parallelTimeMs = parallelStopwatch.GetElapsedMs();
+
+    uint64_t numLodTriangles = 0;
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        REQUIRE( serialLods[i].size() == parallelLods[i].size() );
+        for ( size_t lod = 0; lod < serialLods[i].size(); ++lod )
+        {
+            CHECK( serialLods[i][lod].Indices == parallelLods[i][lod].Indices );
+            numLodTriangles += serialLods[i][lod].Indices.size() / 3;
+        }
+    }
+
+    std::printf( "    %zu meshes, %.2f M triangles -> %.2f M in all the LODs. 1 thread: %.1f ms (%.2f M tri/s), %u threads: %.1f ms (%.2f M tri/s)\n",
+                 meshes.size(), numTriangles / 1000000.0, numLodTriangles / 1000000.0, serialTimeMs, numTriangles / ( serialTimeMs * 1000.0 ),
+                 threadPool.GetNumThreads() + 1, parallelTimeMs, numTriangles / ( parallelTimeMs * 1000.0 ) );
+}
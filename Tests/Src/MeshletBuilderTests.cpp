@@ -0,0 +1,169 @@
+#include "Test.h"
+#include "TestGeometry.h"
+
+#include <Framework/ThreadPool.h>
+#include <Framework/MeshletBuilder.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <tuple>
+#include <utility>
+
+using namespace DirectX;
+
+namespace
+{
+    MeshletBuilder::MeshletMesh Build( const TestGeometry::Mesh& mesh, uint32_t maxVertices = MeshletBuilder::MaxVertices,
+                                       uint32_t maxTriangles = MeshletBuilder::MaxTriangles )
+    {
+        return MeshletBuilder::Build( mesh.Positions.data(), static_cast<uint32_t>( mesh.Positions.size() ), mesh.Indices, maxVertices, maxTriangles );
+    }
+
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> GetSortedTriangles( const std::vector<uint32_t>& indices )
+    {
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> triangles;
+        for ( size_t t = 0; t + 2 < indices.size(); t += 3 )
+        {
+            triangles.emplace_back( indices[t], indices[t + 1], indices[t + 2] );
+        }
+        std::sort( triangles.begin(), triangles.end() );
+        return triangles;
+    }
+
+    // Within the limits, the primitives match the indices, and the same triangles as the input.
+    bool IsValid( const MeshletBuilder::MeshletMesh& result, const TestGeometry::Mesh& mesh, uint32_t maxVertices, uint32_t maxTriangles )
+    {
+        if ( result.MeshletBounds.size() != result.Meshlets.size() )
+            return false;
+
+        uint32_t nextTriangle = 0;
+        for ( const MeshletBuilder::Meshlet& meshlet : result.Meshlets )
+        {
+            if ( meshlet.VertexCount > maxVertices || meshlet.TriangleCount > maxTriangles || meshlet.TriangleCount == 0 )
+                return false;
+            // Contiguous ranges of Indices.
+            if ( meshlet.TriangleOffset != nextTriangle )
+                return false;
+            nextTriangle += meshlet.TriangleCount;
+
+            for ( uint32_t t = 0; t < meshlet.TriangleCount * 3; ++t )
+            {
+                uint32_t local = ( result.Primitives[meshlet.TriangleOffset + t / 3] >> ( 8 * ( t % 3 ) ) ) & 0xFF;
+                if ( local >= meshlet.VertexCount || result.Vertices[meshlet.VertexOffset + local] != result.Indices[meshlet.TriangleOffset * 3 + t] )
+                    return false;
+            }
+        }
+        return nextTriangle * 3 == result.Indices.size() && GetSortedTriangles( result.Indices ) == GetSortedTriangles( mesh.Indices );
+    }
+}
+
+TEST( MeshletBuilder_Build )
+{
+    TestGeometry::Mesh mesh = TestGeometry::MakeGrid( 100, 80 );
+    MeshletBuilder::MeshletMesh result = Build( mesh );
+    CHECK( IsValid( result, mesh, MeshletBuilder::MaxVertices, MeshletBuilder::MaxTriangles ) );
+
+    // Compact meshlets on a grid: close to the limits on average.
+    size_t numTriangles = mesh.Indices.size() / 3;
+    CHECK( result.GetNumMeshlets() * MeshletBuilder::MaxTriangles < numTriangles * 2 );
+
+    // The bounds contain the vertices of their meshlet.
+    for ( uint32_t m = 0; m < result.GetNumMeshlets(); ++m )
+    {
+        const MeshletBuilder::Meshlet& meshlet = result.Meshlets[m];
+        const MeshletBuilder::Bounds& bounds = result.MeshletBounds[m];
+        for ( uint32_t v = 0; v < meshlet.VertexCount; ++v )
+        {
+            const XMFLOAT3& position = mesh.Positions[result.Vertices[meshlet.VertexOffset + v]];
+            float dx = position.x - bounds.Center.x, dy = position.y - bounds.Center.y, dz = position.z - bounds.Center.z;
+            CHECK( dx * dx + dy * dy + dz * dz <= bounds.Radius * bounds.Radius * 1.0001f + 1e-6f );
+        }
+    }
+}
+
+TEST( MeshletBuilder_Limits )
+{
+    TestGeometry::Mesh mesh = TestGeometry::MakeGrid( 40, 40 );
+    for ( auto limits : { std::make_pair( 3u, 1u ), std::make_pair( 16u, 8u ), std::make_pair( 256u, 512u ) } )
+    {
+        CHECK( IsValid( Build( mesh, limits.first, limits.second ), mesh, limits.first, limits.second ) );
+    }
+
+    CHECK_THROWS( Build( mesh, 2, 124 ) );
+    CHECK_THROWS( Build( mesh, 257, 124 ) );
+    CHECK_THROWS( Build( mesh, 64, 0 ) );
+    CHECK_THROWS( Build( mesh, 64, 513 ) );
+}
+
+// The same meshlets whatever the thread.
+TEST( MeshletBuilder_Parallel )
+{
+    std::vector<TestGeometry::Mesh> meshes = TestGeometry::MakeGrids( 8 );
+
+    ThreadPool threadPool( 3 );
+    std::vector<MeshletBuilder::MeshletMesh> parallelMeshlets( meshes.size() );
+    threadPool.ParallelFor( meshes.size(), meshes.size(), [&]( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            parallelMeshlets[i] = Build( meshes[i] );
+        }
+    } );
+
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        MeshletBuilder::MeshletMesh serialMeshlets = Build( meshes[i] );
+        CHECK( serialMeshlets.Indices == parallelMeshlets[i].Indices );
+        CHECK( serialMeshlets.Primitives == parallelMeshlets[i].Primitives );
+        CHECK( serialMeshlets.Vertices == parallelMeshlets[i].Vertices );
+    }
+}
+
+BENCHMARK( MeshletBuilder_Benchmark )
+{
+    std::vector<TestGeometry::Mesh> meshes = TestGeometry::MakeGrids( 32 );
+
+    uint64_t numTriangles = 0;
+    for ( const TestGeometry::Mesh& mesh : meshes )
+    {
+        numTriangles += mesh.Indices.size() / 3;
+    }
+
+    std::vector<MeshletBuilder::MeshletMesh> serialMeshlets( meshes.size() );
+    Test::Stopwatch serialStopwatch;
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        serialMeshlets[i] = Build( meshes[i] );
+    }
+    double serialTimeMs = serialStopwatch.GetElapsedMs();
+
+    ThreadPool threadPool;
+    std::vector<MeshletBuilder::MeshletMesh> parallelMeshlets( meshes.size() );
+    Test::Stopwatch parallelStopwatch;
+    threadPool.ParallelFor( meshes.size(), meshes.size(), [&]( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            parallelMeshlets[i] = Build( meshes[i] );
+        }
+    } );
+    double parallelTimeMs = parallelStopwatch.GetElapsedMs();
+
+    uint64_t numMeshlets = 0;
+    uint64_t numMeshletVertices = 0;
+    for ( size_t i = 0; i < meshes.size(); ++i )
+    {
+        CHECK( serialMeshlets[i].Indices == parallelMeshlets[i].Indices );
+        CHECK( serialMeshlets[i].Primitives == parallelMeshlets[i].Primitives );
+        CHECK( serialMeshlets[i].Vertices == parallelMeshlets[i].Vertices );
+        CHECK( IsValid( serialMeshlets[i], meshes[i], MeshletBuilder::MaxVertices, MeshletBuilder::MaxTriangles ) );
+
+        numMeshlets += serialMeshlets[i].Meshlets.size();
+        numMeshletVertices += serialMeshlets[i].Vertices.size();
+    }
+
+    std::printf( "    %llu meshlets (%.1f triangles, %.1f vertices on average). 1 thread: %.1f ms (%.2f M tri/s), %u threads: %.1f ms (%.2f M tri/s)\n",
+                 static_cast<unsigned long long>( numMeshlets ), static_cast<double>( numTriangles ) / numMeshlets,
+                 static_cast<double>( numMeshletVertices ) / numMeshlets, serialTimeMs, numTriangles / ( serialTimeMs * 1000.0 ),
+                 threadPool.GetNumThreads() + 1, parallelTimeMs, numTriangles / ( parallelTimeMs * 1000.0 ) );
+}
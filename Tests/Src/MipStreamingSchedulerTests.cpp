@@ -0,0 +1,97 @@
+#include "Test.h"
+
+#include <Framework/Material/MipStreamingScheduler.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace
+{
+    // Square BC7 textures (1 byte per texel).
+    std::vector<uint64_t> MakeMipSizes( uint32_t size )
+    {
+        std::vector<uint64_t> mipSizes;
+        for ( ; size > 0; size /= 2 )
+        {
+            mipSizes.push_back( std::max<uint64_t>( 16, static_cast<uint64_t>( size ) * size ) );
+        }
+        return mipSizes;
+    }
+}
+
+TEST( MipStreamingScheduler_SelectMip )
+{
+    CHECK( MipStreamingScheduler::SelectMip( 1024, 1024, 11, 1024.0f ) == 0 );
+    // Between two mips: the least detailed one with a texel per pixel.
+    CHECK( MipStreamingScheduler::SelectMip( 1024, 512, 11, 300.0f ) == 1 );
+    // No request: the last mip.
+    CHECK( MipStreamingScheduler::SelectMip( 1024, 1024, 11, 0.0f ) == 10 );
+}
+
+TEST( MipStreamingScheduler_EstimateScreenSize )
+{
+    // The camera inside the sphere.
+    CHECK( MipStreamingScheduler::EstimateScreenSize( 1.0f, 0.5f, 100.0f ) == MipStreamingScheduler::MaxScreenSize );
+    CHECK( MipStreamingScheduler::EstimateScreenSize( 1.0f, 10.0f, 100.0f ) == 20.0f );
+}
+
+// The most magnified first, the mips of a texture in order, ties to the lower id.
+TEST( MipStreamingScheduler_PriorityOrder )
+{
+    MipStreamingScheduler scheduler;
+    auto largeTexture = scheduler.Add( 1024, 1024, MakeMipSizes( 1024 ), 4 );
+    auto smallTexture = scheduler.Add( 256, 256, MakeMipSizes( 256 ), 2 );
+    scheduler.Request( largeTexture, 1024.0f );
+    scheduler.Request( smallTexture, 256.0f );
+    auto uploads = scheduler.Schedule( UINT64_MAX );
+
+    const std::pair<uint32_t, uint32_t> expected[] = { { largeTexture, 3 }, { largeTexture, 2 }, { largeTexture, 1 }, { smallTexture, 1 },
+        { largeTexture, 0 }, { smallTexture, 0 } };
+    REQUIRE( uploads.size() == std::size( expected ) );
+    for ( size_t i = 0; i < uploads.size(); ++i )
+    {
+        CHECK( uploads[i].Texture == expected[i].first );
+        CHECK( uploads[i].Mip == expected[i].second );
+    }
+
+    // Resident once scheduled.
+    CHECK( scheduler.GetResidentMip( largeTexture ) == 0 );
+    CHECK( scheduler.GetResidentMip( smallTexture ) == 0 );
+}
+
+// At least one upload per frame, and none past the first one that doesn't fit.
+TEST( MipStreamingScheduler_Budget )
+{
+    MipStreamingScheduler scheduler;
+    auto texture = scheduler.Add( 1024, 1024, MakeMipSizes( 1024 ), 4 );
+    scheduler.Request( texture, 1024.0f );
+    auto uploads = scheduler.Schedule( 1 );
+    REQUIRE( uploads.size() == 1 );
+    CHECK( uploads[0].Mip == 3 );
+
+    scheduler.Request( texture, 1024.0f );
+    uploads = scheduler.Schedule( 256 * 256 + 128 * 128 );
+    REQUIRE( uploads.size() == 1 );
+    CHECK( uploads[0].Mip == 2 );
+    CHECK( scheduler.GetStats().NumStreaming == 1 );
+}
+
+// No request: no upload, and the requests of a frame don't carry over.
+TEST( MipStreamingScheduler_Requests )
+{
+    MipStreamingScheduler scheduler;
+    auto texture = scheduler.Add( 1024, 1024, MakeMipSizes( 1024 ), 4 );
+    CHECK( scheduler.Schedule( UINT64_MAX ).empty() );
+
+    scheduler.Request( texture, 128.0f );
+    auto uploads = scheduler.Schedule( UINT64_MAX );
+    REQUIRE( uploads.size() == 1 );
+    CHECK( uploads[0].Mip == 3 );
+    CHECK( scheduler.Schedule( UINT64_MAX ).empty() );
+
+    // The id is reused.
+    scheduler.Remove( texture );
+    CHECK( scheduler.GetStats().NumTextures == 0 );
+    CHECK( scheduler.Add( 64, 64, MakeMipSizes( 64 ), 0 ) == texture );
+}
@@ -0,0 +1,197 @@
+#include "Test.h"
+
+#include <Framework/SceneGraph.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    XMFLOAT4X4 Multiply( const XMFLOAT4X4& a, const XMFLOAT4X4& b )
+    {
+        XMFLOAT4X4 result;
+        for ( int row = 0; row < 4; ++row )
+        {
+            for ( int column = 0; column < 4; ++column )
+            {
+                result.m[row][column] = a.m[row][0] * b.m[0][column] + a.m[row][1] * b.m[1][column] +
+                                        a.m[row][2] * b.m[2][column] + a.m[row][3] * b.m[3][column];
+            }
+        }
+        return result;
+    }
+
+    // A rotation about z then y, then a translation (row vectors).
+    XMFLOAT4X4 MakeMatrix( float angleZ, float angleY, const XMFLOAT3& translation )
+    {
+        float cz = std::cos( angleZ ), sz = std::sin( angleZ );
+        float cy = std::cos( angleY ), sy = std::sin( angleY );
+        XMFLOAT4X4 rotationZ( cz, sz, 0.0f, 0.0f, -sz, cz, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f );
+        XMFLOAT4X4 rotationY( cy, 0.0f, -sy, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, sy, 0.0f, cy, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f );
+        XMFLOAT4X4 result = Multiply( rotationZ, rotationY );
+        result.m[3][0] = translation.x;
+        result.m[3][1] = translation.y;
+        result.m[3][2] = translation.z;
+        return result;
+    }
+
+    // Random tree: the parent of a node is any node before it (a few roots).
+    SceneGraph MakeRandomGraph( uint32_t numNodes, std::mt19937& random )
+    {
+        std::uniform_real_distribution<float> offset( -1.0f, 1.0f );
+        std::uniform_real_distribution<float> angle( -3.14159265f, 3.14159265f );
+
+        SceneGraph sceneGraph;
+        sceneGraph.Reserve( numNodes );
+        for ( uint32_t i = 0; i < numNodes; ++i )
+        {
+            uint32_t parent = SceneGraph::InvalidNode;
+            if ( i > 0 && i % 1000 != 0 )
+            {
+                parent = std::uniform_int_distribution<uint32_t>( 0, i - 1 )( random );
+            }
+            XMFLOAT4X4 localMatrix = MakeMatrix( angle( random ), angle( random ), XMFLOAT3( offset( random ), offset( random ), offset( random ) ) );
+            sceneGraph.AddNode( parent, localMatrix, "" );
+        }
+        return sceneGraph;
+    }
+
+    // The world matrices from the local ones, node by node.
+    bool CheckWorldMatrices( const SceneGraph& sceneGraph )
+    {
+        std::vector<XMFLOAT4X4> expected( sceneGraph.GetNumNodes() );
+        for ( uint32_t node = 0; node < sceneGraph.GetNumNodes(); ++node )
+        {
+            uint32_t parent = sceneGraph.GetParent( node );
+            expected[node] = parent == SceneGraph::InvalidNode ? sceneGraph.GetLocalMatrix( node )
+                                                               : Multiply( sceneGraph.GetLocalMatrix( node ), expected[parent] );
+
+            const XMFLOAT4X4& world = sceneGraph.GetWorldMatrix( node );
+            for ( int i = 0; i < 16; ++i )
+            {
+                float value = expected[node].m[i / 4][i % 4];
+                if ( std::abs( world.m[i / 4][i % 4] - value ) > 1e-4f * ( 1.0f + std::abs( value ) ) )
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+TEST( SceneGraph_WorldMatrices )
+{
+    std::mt19937 random( 4321 );
+    SceneGraph sceneGraph = MakeRandomGraph( 10000, random );
+    CHECK( sceneGraph.UpdateWorldMatrices() == 10000 );
+    CHECK( CheckWorldMatrices( sceneGraph ) );
+}
+
+// Only the flagged nodes and their descendants are recomputed.
+TEST( SceneGraph_DirtyNodes )
+{
+    std::mt19937 random( 1234 );
+    SceneGraph sceneGraph = MakeRandomGraph( 5000, random );
+    sceneGraph.UpdateWorldMatrices();
+    CHECK( sceneGraph.UpdateWorldMatrices() == 0 );
+
+    std::uniform_int_distribution<uint32_t> node( 0, sceneGraph.GetNumNodes() - 1 );
+    for ( uint32_t i = 0; i < 20; ++i )
+    {
+        uint32_t dirtyNode = node( random );
+        XMFLOAT4X4 localMatrix = sceneGraph.GetLocalMatrix( dirtyNode );
+        localMatrix.m[3][0] += 1.0f;
+        sceneGraph.SetLocalMatrix( dirtyNode, localMatrix );
+
+        // The parent of a descendant is the dirty node or one of its descendants: it comes before it.
+        std::vector<bool> isDescendant( sceneGraph.GetNumNodes(), false );
+        isDescendant[dirtyNode] = true;
+        uint32_t numDescendants = 0;
+        for ( uint32_t other = dirtyNode + 1; other < sceneGraph.GetNumNodes(); ++other )
+        {
+            uint32_t parent = sceneGraph.GetParent( other );
+            if ( parent != SceneGraph::InvalidNode && isDescendant[parent] )
+            {
+                isDescendant[other] = true;
+                ++numDescendants;
+            }
+        }
+
+        CHECK( sceneGraph.IsDirty( dirtyNode ) );
+        CHECK( sceneGraph.UpdateWorldMatrices() == 1 + numDescendants );
+        CHECK( !sceneGraph.IsDirty( dirtyNode ) );
+    }
+    CHECK( CheckWorldMatrices( sceneGraph ) );
+}
+
+TEST( SceneGraph_AddNode )
+{
+    SceneGraph sceneGraph;
+    XMFLOAT4X4 localMatrix = MakeMatrix( 0.5f, 0.25f, XMFLOAT3( 1.0f, 2.0f, 3.0f ) );
+    uint32_t root = sceneGraph.AddNode( SceneGraph::InvalidNode, localMatrix, "Root" );
+    uint32_t child = sceneGraph.AddNode( root, localMatrix, "Child" );
+    CHECK( root == 0 );
+    CHECK( child == 1 );
+    CHECK( sceneGraph.GetParent( child ) == root );
+    CHECK( sceneGraph.GetName( child ) == "Child" );
+
+    // The parent must come first.
+    CHECK_THROWS( sceneGraph.AddNode( 2, localMatrix, "" ) );
+
+    sceneGraph.UpdateWorldMatrices();
+    CHECK( CheckWorldMatrices( sceneGraph ) );
+}
+
+BENCHMARK( SceneGraph_Benchmark )
+{
+    static const uint32_t NumNodes = 100000;
+    static const uint32_t NumDirtyNodes = NumNodes / 100;
+    static const uint32_t NumIterations = 20;
+
+    std::mt19937 random( 4321 );
+    SceneGraph sceneGraph = MakeRandomGraph( NumNodes, random );
+    sceneGraph.UpdateWorldMatrices();
+
+    std::vector<uint32_t> dirtyNodes( NumDirtyNodes );
+    std::uniform_int_distribution<uint32_t> node( 0, NumNodes - 1 );
+    for ( uint32_t& dirtyNode : dirtyNodes )
+    {
+        dirtyNode = node( random );
+    }
+
+    // The local matrices are set outside of the timing, only the propagation is measured.
+    auto measure = [&sceneGraph]( const char* name, const auto& setDirty )
+    {
+        double totalTimeMs = 0.0;
+        uint32_t numUpdated = 0;
+        for ( uint32_t i = 0; i < NumIterations; ++i )
+        {
+            setDirty();
+            Test::Stopwatch stopwatch;
+            numUpdated = sceneGraph.UpdateWorldMatrices();
+            totalTimeMs += stopwatch.GetElapsedMs();
+        }
+        std::printf( "    %u nodes, %-9s: %.3f ms (%u updated)\n", sceneGraph.GetNumNodes(), name, totalTimeMs / NumIterations, numUpdated );
+    };
+
+    measure( "all dirty", [&sceneGraph]()
+    {
+        for ( uint32_t i = 0; i < sceneGraph.GetNumNodes(); ++i )
+        {
+            sceneGraph.SetLocalMatrix( i, sceneGraph.GetLocalMatrix( i ) );
+        }
+    } );
+    measure( "1% dirty", [&sceneGraph, &dirtyNodes]()
+    {
+        for ( uint32_t dirtyNode : dirtyNodes )
+        {
+            sceneGraph.SetLocalMatrix( dirtyNode, sceneGraph.GetLocalMatrix( dirtyNode ) );
+        }
+    } );
+    measure( "clean", []() {} );
+
+    CHECK( CheckWorldMatrices( sceneGraph ) );
+}
@@ -0,0 +1,224 @@
+#include "Test.h"
+
+#include <Framework/SoftwareOcclusionCuller.h>
+#include <Framework/ThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    const uint32_t  Width = 320;
+    const uint32_t  Height = 192;
+    const float     NearZ = 0.1f;
+    const float     FarZ = 100.0f;
+    const float     TanHalfFovY = 0.5f;
+
+    // A camera at the origin looking down +z: view space is world space. Row vectors, D3D depth (0 near, 1 far).
+    XMFLOAT4X4 MakeViewProjection()
+    {
+        float aspect = static_cast<float>( Width ) / Height;
+        float q = FarZ / ( FarZ - NearZ );
+
+        XMFLOAT4X4 m = {};
+        m.m[0][0] = 1.0f / ( TanHalfFovY * aspect );
+        m.m[1][1] = 1.0f / TanHalfFovY;
+        m.m[2][2] = q;
+        m.m[2][3] = 1.0f;
+        m.m[3][2] = -q * NearZ;
+        return m;
+    }
+
+    // The depth of the plane z = viewZ.
+    float GetDepth( float viewZ )
+    {
+        return FarZ / ( FarZ - NearZ ) * ( 1.0f - NearZ / viewZ );
+    }
+
+    // A rectangle facing the camera at viewZ, as two triangles.
+    void AddQuad( SoftwareOcclusionCuller& culler, float minX, float minY, float maxX, float maxY, float viewZ )
+    {
+        std::vector<XMFLOAT3> positions = {
+            XMFLOAT3( minX, minY, viewZ ), XMFLOAT3( maxX, minY, viewZ ), XMFLOAT3( maxX, maxY, viewZ ), XMFLOAT3( minX, maxY, viewZ ),
+        };
+        culler.AddOccluder( positions, { 0, 1, 2, 0, 2, 3 } );
+    }
+
+    BoundingBox MakeBox( float x, float y, float z, float extent )
+    {
+        BoundingBox box;
+        box.Center = XMFLOAT3( x, y, z );
+        box.Extents = XMFLOAT3( extent, extent, extent );
+        return box;
+    }
+
+    // Random triangles in and around the frustum (some cross the near plane, some are off-screen), a few large quads
+    // so that some of the occludees are hidden.
+    void AddRandomOccluders( SoftwareOcclusionCuller& culler, std::mt19937& random )
+    {
+        std::uniform_real_distribution<float> lateral( -1.0f, 1.0f );
+        std::uniform_real_distribution<float> depth( -1.0f, 40.0f );
+
+        for ( uint32_t i = 0; i < 64; ++i )
+        {
+            std::vector<XMFLOAT3> positions( 3 );
+            for ( XMFLOAT3& position : positions )
+            {
+                position.z = depth( random );
+                // Roughly within the frustum at that depth, with some margin.
+                float reach = 1.2f * std::abs( position.z ) * TanHalfFovY * 2.0f + 1.0f;
+                position.x = lateral( random ) * reach;
+                position.y = lateral( random ) * reach;
+            }
+            culler.AddOccluder( positions, { 0, 1, 2 } );
+        }
+
+        for ( uint32_t i = 0; i < 4; ++i )
+        {
+            float z = 5.0f + 5.0f * i;
+            float x = lateral( random ) * z * 0.5f;
+            float y = lateral( random ) * z * 0.3f;
+            AddQuad( culler, x - z * 0.4f, y - z * 0.3f, x + z * 0.4f, y + z * 0.3f, z );
+        }
+    }
+}
+
+TEST( SoftwareOcclusionCuller_RenderBeforeResizeThrows )
+{
+    SoftwareOcclusionCuller culler;
+    CHECK_THROWS( culler.RenderOccluders( MakeViewProjection(), nullptr ) );
+    CHECK( !culler.IsOccluded( MakeBox( 0.0f, 0.0f, 10.0f, 1.0f ) ) );
+}
+
+TEST( SoftwareOcclusionCuller_QuadMatchesReference )
+{
+    SoftwareOcclusionCuller culler;
+    culler.Resize( Width, Height );
+
+    const float quadZ = 10.0f;
+    const float minX = -3.0f, minY = -2.0f, maxX = 4.0f, maxY = 1.5f;
+    AddQuad( culler, minX, minY, maxX, maxY, quadZ );
+
+    for ( auto implementation : { SoftwareOcclusionCuller::Implementation::Scalar, SoftwareOcclusionCuller::Implementation::SSE } )
+    {
+        culler.RenderOccluders( MakeViewProjection(), nullptr, implementation );
+        CHECK( culler.GetStats().NumRasterizedTriangles == 2 );
+
+        // The reference: the view ray of each pixel center against the quad. The pixels within one pixel of the
+        // edges are left to the fill rules.
+        float aspect = static_cast<float>( Width ) / Height;
+        float pixelSize = 2.0f * TanHalfFovY * quadZ / Height;
+        float expectedDepth = GetDepth( quadZ );
+
+        uint32_t numCovered = 0;
+        uint32_t numMismatches = 0;
+        for ( uint32_t y = 0; y < Height; ++y )
+        {
+            for ( uint32_t x = 0; x < Width; ++x )
+            {
+                float viewX = ( ( x + 0.5f ) / Width * 2.0f - 1.0f ) * TanHalfFovY * aspect * quadZ;
+                float viewY = ( 1.0f - ( y + 0.5f ) / Height * 2.0f ) * TanHalfFovY * quadZ;
+                float distance = std::min( std::min( viewX - minX, maxX - viewX ), std::min( viewY - minY, maxY - viewY ) );
+                if ( std::abs( distance ) < pixelSize )
+                    continue;
+
+                float depth = culler.GetDepthBuffer()[y * Width + x];
+                bool covered = distance > 0.0f;
+                numCovered += covered ? 1 : 0;
+                if ( covered ? std::abs( depth - expectedDepth ) > 1e-5f : depth != 1.0f )
+                    ++numMismatches;
+            }
+        }
+        CHECK( numCovered > 1000 );
+        CHECK( numMismatches == 0 );
+    }
+}
+
+TEST( SoftwareOcclusionCuller_Occludees )
+{
+    SoftwareOcclusionCuller culler;
+    culler.Resize( Width, Height );
+    // Nothing rendered: nothing is occluded.
+    CHECK( !culler.IsOccluded( MakeBox( 0.0f, 0.0f, 20.0f, 1.0f ) ) );
+
+    AddQuad( culler, -4.0f, -3.0f, 4.0f, 3.0f, 10.0f );
+    culler.RenderOccluders( MakeViewProjection(), nullptr );
+
+    // Behind the quad, within its silhouette.
+    CHECK( culler.IsOccluded( MakeBox( 0.0f, 0.0f, 20.0f, 1.0f ) ) );
+    CHECK( culler.IsOccluded( MakeBox( 5.0f, 3.0f, 40.0f, 2.0f ) ) );
+    // In front of the quad, or crossing it.
+    CHECK( !culler.IsOccluded( MakeBox( 0.0f, 0.0f, 5.0f, 1.0f ) ) );
+    CHECK( !culler.IsOccluded( MakeBox( 0.0f, 0.0f, 10.0f, 0.5f ) ) );
+    // Behind, but partly outside of the silhouette.
+    CHECK( !culler.IsOccluded( MakeBox( 7.0f, 0.0f, 20.0f, 1.0f ) ) );
+    // Crossing the near plane, behind the camera.
+    CHECK( !culler.IsOccluded( MakeBox( 0.0f, 0.0f, 0.0f, 1.0f ) ) );
+    CHECK( !culler.IsOccluded( MakeBox( 0.0f, 0.0f, -20.0f, 1.0f ) ) );
+    // Off-screen.
+    CHECK( !culler.IsOccluded( MakeBox( 200.0f, 0.0f, 20.0f, 1.0f ) ) );
+}
+
+TEST( SoftwareOcclusionCuller_ImplementationsMatchReference )
+{
+    std::mt19937 random( 35 );
+
+    SoftwareOcclusionCuller culler;
+    culler.Resize( Width, Height );
+    AddRandomOccluders( culler, random );
+
+    std::uniform_real_distribution<float> lateral( -20.0f, 20.0f );
+    std::uniform_real_distribution<float> depth( 1.0f, 60.0f );
+    std::uniform_real_distribution<float> extent( 0.1f, 2.0f );
+    std::vector<BoundingBox> occludees( 512 );
+    for ( BoundingBox& box : occludees )
+    {
+        box = MakeBox( lateral( random ), lateral( random ), depth( random ), extent( random ) );
+    }
+
+    ThreadPool threadPool( 3 );
+
+    // The single-threaded scalar rasterizer is the reference, every other run must give the same depth buffer.
+    struct Run
+    {
+        SoftwareOcclusionCuller::Implementation Implementation;
+        ThreadPool*                             Pool;
+    };
+    const Run runs[] = {
+        { SoftwareOcclusionCuller::Implementation::Scalar,  nullptr },
+        { SoftwareOcclusionCuller::Implementation::Scalar,  &threadPool },
+        { SoftwareOcclusionCuller::Implementation::SSE,     nullptr },
+        { SoftwareOcclusionCuller::Implementation::SSE,     &threadPool },
+    };
+
+    std::vector<float> referenceDepth;
+    std::vector<bool> referenceOccluded;
+    for ( const Run& run : runs )
+    {
+        culler.RenderOccluders( MakeViewProjection(), run.Pool, run.Implementation );
+
+        std::vector<bool> occluded;
+        for ( const BoundingBox& box : occludees )
+        {
+            occluded.push_back( culler.IsOccluded( box ) );
+        }
+
+        if ( referenceDepth.empty() )
+        {
+            referenceDepth = culler.GetDepthBuffer();
+            referenceOccluded = occluded;
+            continue;
+        }
+
+        CHECK( culler.GetDepthBuffer() == referenceDepth );
+        CHECK( occluded == referenceOccluded );
+    }
+
+    // The scene tests both outcomes.
+    size_t numOccluded = std::count( referenceOccluded.begin(), referenceOccluded.end(), true );
+    CHECK( numOccluded > 0 );
+    CHECK( numOccluded < occludees.size() );
+}
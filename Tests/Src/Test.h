@@ -0,0 +1,88 @@
+#pragma once
+
+// A minimal test harness for the modules of the framework that don't need a device.
+// --
+// TEST( Name ) defines and registers a test. CHECK records a failure and goes on, REQUIRE ends the test,
+// CHECK_THROWS expects an exception. main runs every test (or the ones whose name contains the first
+// argument) and returns the number of failed tests.
+// --
+// BENCHMARK( Name ) defines a test that only runs with --benchmarks: it prints its timings (Test::Stopwatch),
+// and checks that the paths it times give the same results.
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace Test
+{
+    struct Case
+    {
+        const char* Name;
+        void        ( *Function )();
+        bool        IsBenchmark;
+    };
+
+    std::vector<Case>& GetCases();
+
+    void ReportFailure( const char* file, int line, const char* expression );
+
+    struct Registrar
+    {
+        Registrar( const char* name, void ( *function )(), bool isBenchmark = false )
+        {
+            GetCases().push_back( { name, function, isBenchmark } );
+        }
+    };
+
+    class Stopwatch
+    {
+    public:
+        double GetElapsedMs() const
+        {
+            return std::chrono::duration<double, std::milli>( std::chrono::high_resolution_clock::now() - m_Start ).count();
+        }
+
+    private:
+        std::chrono::high_resolution_clock::time_point m_Start = std::chrono::high_resolution_clock::now();
+    };
+
+    // Thrown by REQUIRE, caught by main.
+    struct RequireFailed {};
+}
+
+#define TEST( name )                                                \
+    static void name();                                             \
+    static Test::Registrar name##_Registrar( #name, &name );        \
+    static void name()
+
+#define BENCHMARK( name )                                           \
+    static void name();                                             \
+    static Test::Registrar name##_Registrar( #name, &name, true );  \
+    static void name()
+
+#define CHECK( expression )                                         \
+    do                                                              \
+    {                                                               \
+        if ( !( expression ) )                                      \
+            Test::ReportFailure( __FILE__, __LINE__, #expression ); \
+    } while ( false )
+
+#define REQUIRE( expression )                                       \
+    do                                                              \
+    {                                                               \
+        if ( !( expression ) )                                      \
+        {                                                           \
+            Test::ReportFailure( __FILE__, __LINE__, #expression ); \
+            throw Test::RequireFailed();                            \
+        }                                                           \
+    } while ( false )
+
+#define CHECK_THROWS( expression )                                  \
+    do                                                              \
+    {                                                               \
+        bool thrown = false;                                        \
+        try { expression; }                                         \
+        catch ( ... ) { thrown = true; }                            \
+        if ( !thrown )                                              \
+            Test::ReportFailure( __FILE__, __LINE__, "throws: " #expression ); \
+    } while ( false )
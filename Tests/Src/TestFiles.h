@@ -0,0 +1,35 @@
+#pragma once
+
+// The files of the tests that read from disk are written there by the tests: they don't depend on the assets.
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+namespace TestFiles
+{
+    // Created empty, deleted with the test.
+    class TemporaryDirectory
+    {
+    public:
+        TemporaryDirectory()
+            : m_Path( std::filesystem::temp_directory_path() / L"DX12_FW_Tests" )
+        {
+            std::filesystem::remove_all( m_Path );
+            std::filesystem::create_directories( m_Path );
+        }
+        ~TemporaryDirectory()
+        {
+            std::error_code error;
+            std::filesystem::remove_all( m_Path, error );
+        }
+
+        TemporaryDirectory( const TemporaryDirectory& ) = delete;
+        TemporaryDirectory& operator=( const TemporaryDirectory& ) = delete;
+
+        std::wstring GetFile( const std::wstring& name ) const { return ( m_Path / name ).wstring(); }
+
+    private:
+        std::filesystem::path m_Path;
+    };
+}
@@ -0,0 +1,74 @@
+#include "TestGeometry.h"
+
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+TestGeometry::Mesh TestGeometry::MakeGrid( uint32_t width, uint32_t height )
+{
+    Mesh mesh;
+    mesh.Positions.reserve( width * height );
+    for ( uint32_t y = 0; y < height; ++y )
+    {
+        for ( uint32_t x = 0; x < width; ++x )
+        {
+            float z = 0.5f * std::sin( x * 0.15f ) * std::cos( y * 0.1f );
+            mesh.Positions.push_back( XMFLOAT3( static_cast<float>( x ), static_cast<float>( y ), z ) );
+        }
+    }
+
+    mesh.Indices.reserve( ( width - 1 ) * ( height - 1 ) * 6 );
+    for ( uint32_t y = 0; y + 1 < height; ++y )
+    {
+        for ( uint32_t x = 0; x + 1 < width; ++x )
+        {
+            uint32_t v = y * width + x;
+            mesh.Indices.insert( mesh.Indices.end(), { v, v + width, v + 1, v + 1, v + width, v + width + 1 } );
+        }
+    }
+
+    return mesh;
+}
+
+std::vector<TestGeometry::Mesh> TestGeometry::MakeGrids( uint32_t numMeshes )
+{
+    std::vector<Mesh> meshes;
+    for ( uint32_t i = 0; i < numMeshes; ++i )
+    {
+        meshes.push_back( MakeGrid( 32 + 16 * ( i % 8 ), 32 + 24 * ( i / 8 ) ) );
+    }
+    return meshes;
+}
+
+std::vector<BoundingBox> TestGeometry::MakeRandomBoxes( uint32_t numBoxes, uint32_t seed )
+{
+    std::mt19937 random( seed );
+    std::uniform_real_distribution<float> offset( -100.0f, 100.0f );
+    std::uniform_real_distribution<float> extent( 0.1f, 5.0f );
+
+    std::vector<BoundingBox> boxes( numBoxes );
+    for ( BoundingBox& box : boxes )
+    {
+        box.Center = XMFLOAT3( offset( random ), offset( random ), offset( random ) );
+        box.Extents = XMFLOAT3( extent( random ), extent( random ), extent( random ) );
+    }
+    return boxes;
+}
+
+XMFLOAT4X4 TestGeometry::MakeViewProjection()
+{
+    const float nearZ = 0.1f;
+    const float farZ = 1000.0f;
+    const float height = 1.0f / std::tan( 0.5f * 3.14159265f / 3.0f );
+    const float width = height * 9.0f / 16.0f;
+    const float range = farZ / ( farZ - nearZ );
+
+    XMFLOAT4X4 viewProjection = {};
+    viewProjection.m[0][0] = width;
+    viewProjection.m[1][1] = height;
+    viewProjection.m[2][2] = range;
+    viewProjection.m[2][3] = 1.0f;
+    viewProjection.m[3][2] = -range * nearZ;
+    return viewProjection;
+}
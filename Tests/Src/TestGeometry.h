@@ -0,0 +1,30 @@
+#pragma once
+
+// Synthetic inputs shared by the tests: the tests don't load assets.
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace TestGeometry
+{
+    struct Mesh
+    {
+        std::vector<DirectX::XMFLOAT3>  Positions;
+        std::vector<uint32_t>           Indices;
+    };
+
+    // A height field of width x height vertices, 2 triangles per cell, with waves so that its LODs have an error.
+    Mesh MakeGrid( uint32_t width, uint32_t height );
+    // Grids of different sizes, the meshes of a model.
+    std::vector<Mesh> MakeGrids( uint32_t numMeshes );
+
+    // Boxes spread over [-100, 100]^3 around the origin, the same ones for a seed.
+    std::vector<DirectX::BoundingBox> MakeRandomBoxes( uint32_t numBoxes, uint32_t seed = 1234 );
+
+    // A camera at the origin looking down +z: 60 degrees vertical field of view, 16:9, near 0.1, far 1000.
+    // Row vectors, left-handed, like XMMatrixPerspectiveFovLH (built by hand: the tests don't need DirectXMath's functions).
+    DirectX::XMFLOAT4X4 MakeViewProjection();
+}
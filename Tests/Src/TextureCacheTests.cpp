@@ -0,0 +1,231 @@
+#include "Test.h"
+
+#include <Framework/Material/TextureCache.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// The entries are completed without a resource: the cache never looks into it.
+namespace
+{
+    TextureCache::Key MakeKey( const wchar_t* name )
+    {
+        return TextureCache::MakeKey( name, TextureUsage::Albedo, false );
+    }
+
+    // A resident entry, not in use once the returned handle is released.
+    TextureCache::Handle Load( TextureCache& cache, const wchar_t* name, uint64_t sizeInBytes )
+    {
+        bool isNew = false;
+        TextureCache::Handle handle = cache.Acquire( MakeKey( name ), isNew );
+        REQUIRE( isNew );
+        cache.Complete( handle, nullptr, sizeInBytes );
+        return handle;
+    }
+}
+
+// Same file whatever the case and the path, not with other settings.
+TEST( TextureCache_MakeKey )
+{
+    TextureCache::Key key = TextureCache::MakeKey( L"Assets/Textures/Brick.png", TextureUsage::Albedo, true );
+    CHECK( key == TextureCache::MakeKey( L"assets/models/../textures/brick.PNG", TextureUsage::Albedo, true ) );
+    CHECK( TextureCache::KeyHash()( key ) == TextureCache::KeyHash()( TextureCache::MakeKey( L"ASSETS/TEXTURES/BRICK.PNG", TextureUsage::Albedo, true ) ) );
+    CHECK( !( key == TextureCache::MakeKey( L"Assets/Textures/Brick.png", TextureUsage::Albedo, false ) ) );
+    CHECK( !( key == TextureCache::MakeKey( L"Assets/Textures/Brick.png", TextureUsage::Normalmap, true ) ) );
+}
+
+// Over the budget, the least recently requested entries go first.
+TEST( TextureCache_LruEviction )
+{
+    TextureCache cache( 300 );
+    Load( cache, L"a.png", 100 );
+    Load( cache, L"b.png", 100 );
+    Load( cache, L"c.png", 100 );
+    CHECK( cache.GetStats().ResidentBytes == 300 );
+    CHECK( cache.GetStats().NumEvictions == 0 );
+
+    // a is requested again: b is the least recently requested.
+    bool isNew = true;
+    cache.Acquire( MakeKey( L"a.png" ), isNew );
+    CHECK( !isNew );
+
+    Load( cache, L"d.png", 100 );
+    CHECK( cache.Contains( MakeKey( L"a.png" ) ) );
+    CHECK( !cache.Contains( MakeKey( L"b.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"c.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"d.png" ) ) );
+
+    Load( cache, L"e.png", 100 );
+    CHECK( !cache.Contains( MakeKey( L"c.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"a.png" ) ) );
+
+    TextureCache::Stats stats = cache.GetStats();
+    CHECK( stats.NumEvictions == 2 );
+    CHECK( stats.ResidentBytes == 300 );
+    CHECK( stats.NumEntries == 3 );
+    CHECK( stats.NumHits == 1 );
+    CHECK( stats.NumMisses == 5 );
+}
+
+// An entry with a handle outside of the cache is skipped, even the least recently requested.
+TEST( TextureCache_InUseNotEvicted )
+{
+    TextureCache cache( 200 );
+    TextureCache::Handle a = Load( cache, L"a.png", 100 );
+    Load( cache, L"b.png", 100 );
+    TextureCache::Handle c = Load( cache, L"c.png", 100 );
+
+    CHECK( cache.Contains( MakeKey( L"a.png" ) ) );
+    CHECK( !cache.Contains( MakeKey( L"b.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"c.png" ) ) );
+    CHECK( cache.GetStats().NumEntriesInUse == 2 );
+
+    // Everything left is in use: the cache stays over the budget.
+    cache.SetBudget( 0 );
+    CHECK( cache.GetStats().ResidentBytes == 200 );
+
+    // Released since: the next trim makes room.
+    a.reset();
+    cache.Trim();
+    CHECK( !cache.Contains( MakeKey( L"a.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"c.png" ) ) );
+    CHECK( cache.GetStats().ResidentBytes == 100 );
+}
+
+// A loading entry isn't resident: it's never evicted, and doesn't count in the budget until completed.
+TEST( TextureCache_LoadingNotEvicted )
+{
+    TextureCache cache( 100 );
+    bool isNew = false;
+    TextureCache::Handle loading = cache.Acquire( MakeKey( L"loading.png" ), isNew );
+    REQUIRE( isNew );
+
+    Load( cache, L"a.png", 100 );
+    Load( cache, L"b.png", 100 );
+    CHECK( cache.Contains( MakeKey( L"loading.png" ) ) );
+    CHECK( !cache.Contains( MakeKey( L"a.png" ) ) );
+    CHECK( cache.GetStats().ResidentBytes == 100 );
+
+    // Completed while its loader holds it: b makes room.
+    cache.Complete( loading, nullptr, 50 );
+    CHECK( cache.Contains( MakeKey( L"loading.png" ) ) );
+    CHECK( !cache.Contains( MakeKey( L"b.png" ) ) );
+    CHECK( cache.GetStats().ResidentBytes == 50 );
+}
+
+// SetBudget evicts down to the new budget, from the least recently requested.
+TEST( TextureCache_TrimToBudget )
+{
+    TextureCache cache;
+    for ( const wchar_t* name : { L"0.png", L"1.png", L"2.png", L"3.png", L"4.png", L"5.png" } )
+    {
+        Load( cache, name, 64 );
+    }
+    CHECK( cache.GetStats().ResidentBytes == 6 * 64 );
+    CHECK( cache.GetStats().NumEvictions == 0 );
+
+    cache.SetBudget( 200 );
+    CHECK( cache.GetBudget() == 200 );
+    TextureCache::Stats stats = cache.GetStats();
+    CHECK( stats.ResidentBytes == 3 * 64 );
+    CHECK( stats.NumEvictions == 3 );
+    CHECK( !cache.Contains( MakeKey( L"2.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"3.png" ) ) );
+    CHECK( cache.Contains( MakeKey( L"5.png" ) ) );
+
+    // An entry larger than the budget stays while it's used, not after.
+    TextureCache::Handle large = Load( cache, L"large.png", 1000 );
+    CHECK( cache.Contains( MakeKey( L"large.png" ) ) );
+    CHECK( cache.GetStats().ResidentBytes == 1000 );
+    large.reset();
+    cache.Trim();
+    CHECK( !cache.Contains( MakeKey( L"large.png" ) ) );
+    CHECK( cache.GetStats().ResidentBytes == 0 );
+}
+
+// The concurrent requests of a key get the entry of the first one and wait for its load.
+TEST( TextureCache_ConcurrentRequests )
+{
+    TextureCache cache;
+    const uint32_t numThreads = 8;
+
+    std::atomic<uint32_t> numNew{ 0 };
+    std::atomic<uint32_t> numLoaded{ 0 };
+    std::vector<TextureCache::Handle> handles( numThreads );
+    std::vector<std::thread> threads;
+    for ( uint32_t i = 0; i < numThreads; ++i )
+    {
+        threads.emplace_back( [&, i]()
+        {
+            bool isNew = false;
+            handles[i] = cache.Acquire( MakeKey( L"shared.png" ), isNew );
+            if ( isNew )
+            {
+                ++numNew;
+                // The others are waiting meanwhile.
+                std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+                cache.Complete( handles[i], nullptr, 100 );
+            }
+            TextureCache::GetResource( handles[i] );
+            ++numLoaded;
+        } );
+    }
+    for ( auto& thread : threads )
+    {
+        thread.join();
+    }
+
+    CHECK( numNew == 1 );
+    CHECK( numLoaded == numThreads );
+    for ( uint32_t i = 1; i < numThreads; ++i )
+    {
+        CHECK( handles[i] == handles[0] );
+    }
+
+    TextureCache::Stats stats = cache.GetStats();
+    CHECK( stats.NumMisses == 1 );
+    CHECK( stats.NumHits == numThreads - 1 );
+    CHECK( stats.NumEntries == 1 );
+    CHECK( stats.ResidentBytes == 100 );
+}
+
+// The waiting requests get the exception of a failed load, and the next request loads the file again.
+TEST( TextureCache_Fail )
+{
+    TextureCache cache;
+    bool isNew = false;
+    TextureCache::Handle loader = cache.Acquire( MakeKey( L"missing.png" ), isNew );
+    REQUIRE( isNew );
+    TextureCache::Handle waiter = cache.Acquire( MakeKey( L"missing.png" ), isNew );
+    CHECK( !isNew );
+    CHECK( waiter == loader );
+
+    std::atomic<bool> thrown{ false };
+    std::thread waiting( [&]()
+    {
+        try
+        {
+            TextureCache::GetResource( waiter );
+        }
+        catch ( const std::runtime_error& )
+        {
+            thrown = true;
+        }
+    } );
+
+    cache.Fail( loader, std::make_exception_ptr( std::runtime_error( "missing.png" ) ) );
+    waiting.join();
+
+    CHECK( thrown );
+    CHECK_THROWS( TextureCache::GetResource( loader ) );
+    CHECK( !cache.Contains( MakeKey( L"missing.png" ) ) );
+    CHECK( cache.GetStats().NumEntries == 0 );
+    CHECK( cache.GetStats().ResidentBytes == 0 );
+
+    TextureCache::Handle retry = cache.Acquire( MakeKey( L"missing.png" ), isNew );
+    CHECK( isNew );
+    CHECK( retry != loader );
+}
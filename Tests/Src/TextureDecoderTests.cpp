@@ -0,0 +1,247 @@
+#include "Test.h"
+#include "TestFiles.h"
+
+#include <Framework/ThreadPool.h>
+#include <Framework/Material/DDSFile.h>
+#include <Framework/Material/TextureDecoder.h>
+
+#include <External/DirectXTex/DirectXTex/DirectXTex.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // The WIC encoder needs COM on the test thread.
+    struct ComScope
+    {
+        bool Initialized = SUCCEEDED( CoInitializeEx( nullptr, COINIT_MULTITHREADED ) );
+        ~ComScope() { if ( Initialized ) CoUninitialize(); }
+    };
+
+    // RGBA8, opaque: a gradient, with noise (seed != 0) so the files don't compress to nothing.
+    void MakeImage( size_t width, size_t height, uint32_t seed, DirectX::ScratchImage& image )
+    {
+        REQUIRE( SUCCEEDED( image.Initialize2D( DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1 ) ) );
+
+        std::mt19937 random( seed );
+        std::uniform_int_distribution<int> noise( 0, seed != 0 ? 63 : 0 );
+
+        const DirectX::Image& pixels = *image.GetImage( 0, 0, 0 );
+        for ( size_t y = 0; y < height; ++y )
+        {
+            uint8_t* row = pixels.pixels + y * pixels.rowPitch;
+            for ( size_t x = 0; x < width; ++x )
+            {
+                row[x * 4 + 0] = static_cast<uint8_t>( ( x * 255 / width + noise( random ) ) & 0xFF );
+                row[x * 4 + 1] = static_cast<uint8_t>( ( y * 255 / height + noise( random ) ) & 0xFF );
+                row[x * 4 + 2] = static_cast<uint8_t>( ( ( x + y ) * 127 / ( width + height ) ) & 0xFF );
+                row[x * 4 + 3] = 0xFF;
+            }
+        }
+    }
+
+    // The pixels of a decoded image, in RGBA8, are the ones of the source.
+    bool IsSameImage( const DirectX::Image& source, const DirectX::Image& decoded )
+    {
+        DirectX::ScratchImage converted;
+        const DirectX::Image* image = &decoded;
+        if ( decoded.format != DXGI_FORMAT_R8G8B8A8_UNORM )
+        {
+            if ( FAILED( DirectX::Convert( decoded, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted ) ) )
+                return false;
+            image = converted.GetImage( 0, 0, 0 );
+        }
+
+        if ( image->width != source.width || image->height != source.height )
+            return false;
+
+        for ( size_t y = 0; y < source.height; ++y )
+        {
+            if ( std::memcmp( image->pixels + y * image->rowPitch, source.pixels + y * source.rowPitch, source.width * 4 ) != 0 )
+                return false;
+        }
+        return true;
+    }
+}
+
+// The lossless formats give the pixels back: decoded (PNG, TGA), or mapped in place (DDS).
+TEST( TextureDecoder_Formats )
+{
+    ComScope comScope;
+    TestFiles::TemporaryDirectory directory;
+
+    DirectX::ScratchImage source;
+    MakeImage( 64, 32, 1, source );
+    const DirectX::Image& sourceImage = *source.GetImage( 0, 0, 0 );
+
+    std::wstring pngFile = directory.GetFile( L"Image.png" );
+    std::wstring tgaFile = directory.GetFile( L"Image.tga" );
+    std::wstring ddsFile = directory.GetFile( L"Image.dds" );
+    REQUIRE( SUCCEEDED( DirectX::SaveToWICFile( sourceImage, DirectX::WIC_FLAGS_NONE, DirectX::GetWICCodec( DirectX::WIC_CODEC_PNG ), pngFile.c_str() ) ) );
+    REQUIRE( SUCCEEDED( DirectX::SaveToTGAFile( sourceImage, tgaFile.c_str() ) ) );
+    REQUIRE( SUCCEEDED( DirectX::SaveToDDSFile( sourceImage, DirectX::DDS_FLAGS_NONE, ddsFile.c_str() ) ) );
+
+    for ( const std::wstring& fileName : { pngFile, tgaFile } )
+    {
+        DDSFile file;
+        DirectX::TexMetadata metadata;
+        DirectX::ScratchImage image;
+        TextureDecoder::Decode( fileName, file, metadata, image );
+        CHECK( !file.IsOpen() );
+        CHECK( metadata.width == 64 );
+        CHECK( metadata.height == 32 );
+        CHECK( metadata.mipLevels == 1 );
+        CHECK( IsSameImage( sourceImage, *image.GetImage( 0, 0, 0 ) ) );
+    }
+
+    // 32-bit RGBA: read in place, nothing decoded.
+    DDSFile file;
+    DirectX::TexMetadata metadata;
+    DirectX::ScratchImage image;
+    TextureDecoder::Decode( ddsFile, file, metadata, image );
+    REQUIRE( file.IsOpen() );
+    CHECK( image.GetImageCount() == 0 );
+    CHECK( file.GetResourceDesc().Width == 64 );
+    CHECK( file.GetResourceDesc().Height == 32 );
+    CHECK( file.GetResourceDesc().Format == DXGI_FORMAT_R8G8B8A8_UNORM );
+    REQUIRE( file.GetSubresources().size() == 1 );
+
+    const D3D12_SUBRESOURCE_DATA& subresource = file.GetSubresources()[0];
+    DirectX::Image mappedImage = { 64, 32, DXGI_FORMAT_R8G8B8A8_UNORM, static_cast<size_t>( subresource.RowPitch ),
+                                   static_cast<size_t>( subresource.SlicePitch ), static_cast<uint8_t*>( const_cast<void*>( subresource.pData ) ) };
+    CHECK( IsSameImage( sourceImage, mappedImage ) );
+}
+
+// Radiance RGBE: 8 bits of mantissa per channel.
+TEST( TextureDecoder_HDR )
+{
+    TestFiles::TemporaryDirectory directory;
+
+    DirectX::ScratchImage source;
+    MakeImage( 16, 16, 0, source );
+    DirectX::ScratchImage floatSource;
+    REQUIRE( SUCCEEDED( DirectX::Convert( *source.GetImage( 0, 0, 0 ), DXGI_FORMAT_R32G32B32A32_FLOAT, DirectX::TEX_FILTER_DEFAULT,
+                                          DirectX::TEX_THRESHOLD_DEFAULT, floatSource ) ) );
+
+    std::wstring hdrFile = directory.GetFile( L"Image.hdr" );
+    REQUIRE( SUCCEEDED( DirectX::SaveToHDRFile( *floatSource.GetImage( 0, 0, 0 ), hdrFile.c_str() ) ) );
+
+    DDSFile file;
+    DirectX::TexMetadata metadata;
+    DirectX::ScratchImage image;
+    TextureDecoder::Decode( hdrFile, file, metadata, image );
+    REQUIRE( metadata.format == DXGI_FORMAT_R32G32B32A32_FLOAT );
+    REQUIRE( metadata.width == 16 );
+    REQUIRE( metadata.height == 16 );
+
+    const DirectX::Image& expected = *floatSource.GetImage( 0, 0, 0 );
+    const DirectX::Image& decoded = *image.GetImage( 0, 0, 0 );
+    for ( size_t y = 0; y < 16; ++y )
+    {
+        const float* expectedRow = reinterpret_cast<const float*>( expected.pixels + y * expected.rowPitch );
+        const float* decodedRow = reinterpret_cast<const float*>( decoded.pixels + y * decoded.rowPitch );
+        for ( size_t i = 0; i < 16 * 4; i += 4 )
+        {
+            // RGB only, the file has no alpha.
+            for ( size_t c = 0; c < 3; ++c )
+            {
+                CHECK( std::abs( decodedRow[i + c] - expectedRow[i + c] ) <= 0.01f );
+            }
+        }
+    }
+}
+
+TEST( TextureDecoder_Errors )
+{
+    TestFiles::TemporaryDirectory directory;
+
+    DDSFile file;
+    DirectX::TexMetadata metadata;
+    DirectX::ScratchImage image;
+    CHECK_THROWS( TextureDecoder::Decode( directory.GetFile( L"Missing.png" ), file, metadata, image ) );
+
+    // Not an image: refused by DDSFile, then by DirectXTex.
+    for ( const wchar_t* name : { L"Garbage.png", L"Garbage.dds", L"Garbage.tga" } )
+    {
+        std::wstring fileName = directory.GetFile( name );
+        {
+            std::ofstream stream( fileName, std::ios::binary );
+            stream << "Not an image file.";
+        }
+        CHECK_THROWS( TextureDecoder::Decode( fileName, file, metadata, image ) );
+        CHECK( !file.IsOpen() );
+    }
+}
+
+// The decode time of a set of files on 1, 2, 4... threads (the pool workers and the calling thread), as the texture
+// loads of a model.
+BENCHMARK( TextureDecoder_Benchmark )
+{
+    const uint32_t NumFiles = 16;
+
+    ComScope comScope;
+    TestFiles::TemporaryDirectory directory;
+
+    std::vector<std::wstring> fileNames;
+    for ( uint32_t i = 0; i < NumFiles; ++i )
+    {
+        DirectX::ScratchImage source;
+        MakeImage( 1024, 1024, i + 1, source );
+        fileNames.push_back( directory.GetFile( L"Image" + std::to_wstring( i ) + ( i % 2 ? L".png" : L".tga" ) ) );
+        if ( i % 2 )
+        {
+            REQUIRE( SUCCEEDED( DirectX::SaveToWICFile( *source.GetImage( 0, 0, 0 ), DirectX::WIC_FLAGS_NONE,
+                                                        DirectX::GetWICCodec( DirectX::WIC_CODEC_PNG ), fileNames.back().c_str() ) ) );
+        }
+        else
+        {
+            REQUIRE( SUCCEEDED( DirectX::SaveToTGAFile( *source.GetImage( 0, 0, 0 ), fileNames.back().c_str() ) ) );
+        }
+    }
+
+    // One task per file, the decoded images are dropped as they are done.
+    std::atomic<uint32_t> numDecoded{ 0 };
+    auto decodeFiles = [&]( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; ++i )
+        {
+            DDSFile file;
+            DirectX::TexMetadata metadata;
+            DirectX::ScratchImage image;
+            TextureDecoder::Decode( fileNames[i], file, metadata, image );
+            ++numDecoded;
+        }
+    };
+
+    // First pass not timed: the files are in the OS file cache for every timed pass.
+    decodeFiles( 0, 0, fileNames.size() );
+
+    uint32_t maxThreads = std::max( 1u, std::thread::hardware_concurrency() );
+    for ( uint32_t numThreads = 1; ; numThreads = std::min( numThreads * 2, maxThreads ) )
+    {
+        numDecoded = 0;
+        Test::Stopwatch stopwatch;
+        if ( numThreads == 1 )
+        {
+            decodeFiles( 0, 0, fileNames.size() );
+        }
+        else
+        {
+            ThreadPool threadPool( numThreads - 1 );
+            threadPool.ParallelFor( fileNames.size(), fileNames.size(), decodeFiles );
+        }
+        double timeMs = stopwatch.GetElapsedMs();
+        CHECK( numDecoded == NumFiles );
+
+        std::printf( "    %2u thread(s), %u files - %.1f ms\n", numThreads, NumFiles, timeMs );
+        if ( numThreads == maxThreads )
+            break;
+    }
+}
@@ -0,0 +1,107 @@
+#include "Test.h"
+
+#include <Framework/ThreadPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Every item once, with the chunk boundaries of (count, numChunks).
+TEST( ThreadPool_ParallelFor )
+{
+    ThreadPool threadPool( 3 );
+
+    for ( size_t numChunks : { size_t( 1 ), size_t( 4 ), size_t( 7 ), size_t( 100 ) } )
+    {
+        const size_t count = 37;
+        std::vector<std::atomic<uint32_t>> visits( count );
+        std::vector<std::atomic<uint32_t>> chunkVisits( numChunks );
+        std::atomic<bool> boundariesMatch{ true };
+        threadPool.ParallelFor( count, numChunks, [&]( size_t chunk, size_t begin, size_t end )
+        {
+            size_t chunks = std::min( numChunks, count );
+            if ( begin != count * chunk / chunks || end != count * ( chunk + 1 ) / chunks )
+                boundariesMatch = false;
+
+            ++chunkVisits[chunk];
+            for ( size_t i = begin; i < end; ++i )
+            {
+                ++visits[i];
+            }
+        } );
+
+        CHECK( boundariesMatch );
+        for ( size_t i = 0; i < count; ++i )
+        {
+            CHECK( visits[i] == 1 );
+        }
+        for ( size_t chunk = 0; chunk < std::min( numChunks, count ); ++chunk )
+        {
+            CHECK( chunkVisits[chunk] == 1 );
+        }
+    }
+}
+
+// The waiting caller runs the chunks of its call, not the other queued tasks.
+TEST( ThreadPool_ParallelForRunsOwnChunks )
+{
+    ThreadPool threadPool( 1 );
+
+    // The worker is busy until the gate opens, the second task stays queued.
+    std::promise<void> gate;
+    std::shared_future<void> gateOpen = gate.get_future().share();
+    std::future<void> blocker = threadPool.Submit( [gateOpen]() { gateOpen.wait(); } );
+    std::future<std::thread::id> queued = threadPool.Submit( []() { return std::this_thread::get_id(); } );
+
+    std::atomic<uint32_t> numChunksOnCaller{ 0 };
+    const std::thread::id caller = std::this_thread::get_id();
+    threadPool.ParallelFor( 8, 8, [&]( size_t, size_t, size_t )
+    {
+        if ( std::this_thread::get_id() == caller )
+            ++numChunksOnCaller;
+    } );
+
+    CHECK( numChunksOnCaller == 8 );
+    CHECK( queued.wait_for( std::chrono::seconds( 0 ) ) != std::future_status::ready );
+
+    gate.set_value();
+    blocker.get();
+    CHECK( queued.get() != caller );
+}
+
+// A ParallelFor within a chunk completes, whether or not a worker is free.
+TEST( ThreadPool_NestedParallelFor )
+{
+    ThreadPool threadPool( 2 );
+
+    std::atomic<uint32_t> numItems{ 0 };
+    threadPool.ParallelFor( 8, 8, [&]( size_t, size_t, size_t )
+    {
+        threadPool.ParallelFor( 16, 4, [&]( size_t, size_t begin, size_t end )
+        {
+            numItems += static_cast<uint32_t>( end - begin );
+        } );
+    } );
+
+    CHECK( numItems == 8 * 16 );
+}
+
+// The exception of a chunk is rethrown once all the chunks are done.
+TEST( ThreadPool_ParallelForException )
+{
+    ThreadPool threadPool( 3 );
+
+    std::atomic<uint32_t> numChunks{ 0 };
+    CHECK_THROWS( threadPool.ParallelFor( 16, 16, [&]( size_t chunk, size_t, size_t )
+    {
+        ++numChunks;
+        if ( chunk == 5 )
+            throw std::runtime_error( "chunk" );
+    } ) );
+
+    CHECK( numChunks == 16 );
+}
@@ -0,0 +1,185 @@
+#include "Test.h"
+
+#include <Framework/VertexQuantizer.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+    const VertexQuantizer::InstructionSet InstructionSets[] = {
+        VertexQuantizer::InstructionSet::Scalar,
+        VertexQuantizer::InstructionSet::SSE,
+        VertexQuantizer::InstructionSet::AVX,
+    };
+
+    // The layout of VertexPositionNormalTexture.
+    struct Vertex
+    {
+        XMFLOAT3    Position;
+        XMFLOAT3    Normal;
+        XMFLOAT2    TexCoord;
+    };
+
+    // Random vertices, the same ones on every run: positions in [-50, 50]^3, unit normals, texture coordinates that repeat.
+    std::vector<Vertex> MakeRandomVertices( uint32_t numVertices )
+    {
+        std::mt19937 random( 1234 );
+        std::uniform_real_distribution<float> position( -50.0f, 50.0f );
+        std::uniform_real_distribution<float> direction( -1.0f, 1.0f );
+        std::uniform_real_distribution<float> texCoord( -4.0f, 4.0f );
+
+        std::vector<Vertex> vertices( numVertices );
+        for ( Vertex& vertex : vertices )
+        {
+            vertex.Position = XMFLOAT3( position( random ), position( random ), position( random ) );
+
+            float x, y, z, length;
+            do
+            {
+                x = direction( random );
+                y = direction( random );
+                z = direction( random );
+                length = std::sqrt( x * x + y * y + z * z );
+            } while ( length < 0.01f );
+            vertex.Normal = XMFLOAT3( x / length, y / length, z / length );
+
+            vertex.TexCoord = XMFLOAT2( texCoord( random ), texCoord( random ) );
+        }
+        return vertices;
+    }
+
+    VertexQuantizer::Source MakeSource( const std::vector<Vertex>& vertices )
+    {
+        return { &vertices[0].Position, &vertices[0].Normal, &vertices[0].TexCoord, sizeof( Vertex ) };
+    }
+
+    VertexQuantizer::Dequantization MakeDequantization()
+    {
+        return VertexQuantizer::ComputeDequantization( XMFLOAT3( -50.0f, -50.0f, -50.0f ), XMFLOAT3( 50.0f, 50.0f, 50.0f ) );
+    }
+}
+
+// Every instruction set gives the bits of the scalar path, the counts that aren't multiples of 8 included.
+TEST( VertexQuantizer_InstructionSetsMatch )
+{
+    for ( uint32_t numVertices : { 1u, 7u, 1003u } )
+    {
+        std::vector<Vertex> vertices = MakeRandomVertices( numVertices );
+        VertexQuantizer::Source source = MakeSource( vertices );
+
+        std::vector<VertexQuantizer::QuantizedVertex> reference( numVertices );
+        VertexQuantizer::Encode( source, numVertices, MakeDequantization(), reference.data(), VertexQuantizer::InstructionSet::Scalar );
+
+        for ( VertexQuantizer::InstructionSet instructionSet : InstructionSets )
+        {
+            if ( !VertexQuantizer::IsSupported( instructionSet ) )
+                continue;
+
+            std::vector<VertexQuantizer::QuantizedVertex> quantized( numVertices );
+            VertexQuantizer::Encode( source, numVertices, MakeDequantization(), quantized.data(), instructionSet );
+            CHECK( std::memcmp( quantized.data(), reference.data(), numVertices * sizeof( VertexQuantizer::QuantizedVertex ) ) == 0 );
+        }
+    }
+}
+
+TEST( VertexQuantizer_Error )
+{
+    const uint32_t NumVertices = 10000;
+    std::vector<Vertex> vertices = MakeRandomVertices( NumVertices );
+    VertexQuantizer::Source source = MakeSource( vertices );
+    VertexQuantizer::Dequantization dequantization = MakeDequantization();
+
+    std::vector<VertexQuantizer::QuantizedVertex> quantized( NumVertices );
+    VertexQuantizer::Encode( source, NumVertices, dequantization, quantized.data() );
+
+    VertexQuantizer::Error error = VertexQuantizer::MeasureError( source, NumVertices, dequantization, quantized.data() );
+    // Half a step of 100 / 65535 per axis.
+    CHECK( error.Position <= 0.5f * 100.0f / 65535.0f * std::sqrt( 3.0f ) * 1.05f );
+    CHECK( error.NormalDegrees < 0.05f );
+    // Half floats of [-4, 4]: a step of 2^-8 at most.
+    CHECK( error.TexCoord <= 1.0f / 512.0f );
+
+    // Decode is the inverse, within those errors.
+    for ( uint32_t i = 0; i < NumVertices; i += 97 )
+    {
+        XMFLOAT3 position, normal;
+        XMFLOAT2 texCoord;
+        VertexQuantizer::Decode( quantized[i], dequantization, position, normal, texCoord );
+        CHECK( std::abs( position.x - vertices[i].Position.x ) <= error.Position * 1.001f );
+        CHECK( std::abs( texCoord.y - vertices[i].TexCoord.y ) <= error.TexCoord );
+        CHECK( std::abs( normal.x * normal.x + normal.y * normal.y + normal.z * normal.z - 1.0f ) < 1e-5f );
+    }
+}
+
+// The corners of the box are exact, the positions out of it are clamped.
+TEST( VertexQuantizer_Box )
+{
+    std::vector<Vertex> vertices( 3 );
+    vertices[0].Position = XMFLOAT3( -50.0f, -50.0f, -50.0f );
+    vertices[1].Position = XMFLOAT3( 50.0f, 50.0f, 50.0f );
+    vertices[2].Position = XMFLOAT3( 80.0f, -90.0f, 0.0f );
+    for ( Vertex& vertex : vertices )
+    {
+        vertex.Normal = XMFLOAT3( 0.0f, 0.0f, 1.0f );
+        vertex.TexCoord = XMFLOAT2( 0.5f, 0.25f );
+    }
+
+    VertexQuantizer::Dequantization dequantization = MakeDequantization();
+    std::vector<VertexQuantizer::QuantizedVertex> quantized( vertices.size() );
+    VertexQuantizer::Encode( MakeSource( vertices ), 3, dequantization, quantized.data(), VertexQuantizer::InstructionSet::Scalar );
+
+    CHECK( quantized[0].Position[0] == 0 );
+    CHECK( quantized[1].Position[0] == 0xFFFF );
+    CHECK( quantized[2].Position[0] == 0xFFFF );
+    CHECK( quantized[2].Position[1] == 0 );
+
+    XMFLOAT3 position, normal;
+    XMFLOAT2 texCoord;
+    VertexQuantizer::Decode( quantized[1], dequantization, position, normal, texCoord );
+    CHECK( std::abs( position.y - 50.0f ) < 1e-4f );
+    CHECK( normal.z == 1.0f );
+    CHECK( texCoord.x == 0.5f );
+    CHECK( texCoord.y == 0.25f );
+}
+
+BENCHMARK( VertexQuantizer_Benchmark )
+{
+    const uint32_t NumVertices = 1000000;
+    const uint32_t NumIterations = 10;
+
+    std::vector<Vertex> vertices = MakeRandomVertices( NumVertices );
+    VertexQuantizer::Source source = MakeSource( vertices );
+    VertexQuantizer::Dequantization dequantization = MakeDequantization();
+
+    std::vector<VertexQuantizer::QuantizedVertex> reference;
+    std::vector<VertexQuantizer::QuantizedVertex> quantized( NumVertices );
+
+    for ( VertexQuantizer::InstructionSet instructionSet : InstructionSets )
+    {
+        if ( !VertexQuantizer::IsSupported( instructionSet ) )
+            continue;
+
+        Test::Stopwatch stopwatch;
+        for ( uint32_t i = 0; i < NumIterations; ++i )
+        {
+            VertexQuantizer::Encode( source, NumVertices, dequantization, quantized.data(), instructionSet );
+        }
+        double totalTimeMs = stopwatch.GetElapsedMs();
+
+        // The scalar path is the reference, the others must give the same bits.
+        if ( instructionSet == VertexQuantizer::InstructionSet::Scalar )
+            reference = quantized;
+        CHECK( std::memcmp( quantized.data(), reference.data(), NumVertices * sizeof( VertexQuantizer::QuantizedVertex ) ) == 0 );
+
+        std::printf( "    %-10s: %.1f M vertices/s\n", VertexQuantizer::GetInstructionSetName( instructionSet ),
+                     static_cast<double>( NumVertices ) * NumIterations / ( totalTimeMs * 1000.0 ) );
+    }
+
+    VertexQuantizer::Error error = VertexQuantizer::MeasureError( source, NumVertices, dequantization, reference.data() );
+    std::printf( "    Max error: position %.5f, normal %.3f deg, texture coordinate %.5f\n", error.Position, error.NormalDegrees, error.TexCoord );
+}
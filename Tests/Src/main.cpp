@@ -0,0 +1,67 @@
+#include "Test.h"
+
+#include <cstring>
+#include <exception>
+
+namespace
+{
+    int g_NumFailures = 0;
+}
+
+std::vector<Test::Case>& Test::GetCases()
+{
+    static std::vector<Case> cases;
+    return cases;
+}
+
+void Test::ReportFailure( const char* file, int line, const char* expression )
+{
+    std::printf( "    %s(%d): failed: %s\n", file, line, expression );
+    ++g_NumFailures;
+}
+
+int main( int argc, char** argv )
+{
+    const char* filter = nullptr;
+    bool runBenchmarks = false;
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( std::strcmp( argv[i], "--benchmarks" ) == 0 )
+            runBenchmarks = true;
+        else
+            filter = argv[i];
+    }
+
+    int numTests = 0;
+    int numFailedTests = 0;
+    for ( const Test::Case& testCase : Test::GetCases() )
+    {
+        if ( filter && !std::strstr( testCase.Name, filter ) )
+            continue;
+        if ( testCase.IsBenchmark && !runBenchmarks )
+            continue;
+
+        int numFailures = g_NumFailures;
+        try
+        {
+            testCase.Function();
+        }
+        catch ( const Test::RequireFailed& )
+        {
+        }
+        catch ( const std::exception& e )
+        {
+            std::printf( "    unexpected exception: %s\n", e.what() );
+            ++g_NumFailures;
+        }
+
+        bool failed = g_NumFailures != numFailures;
+        std::printf( "[%s] %s\n", failed ? "FAIL" : " OK ", testCase.Name );
+
+        ++numTests;
+        numFailedTests += failed ? 1 : 0;
+    }
+
+    std::printf( "%d tests, %d failed.\n", numTests, numFailedTests );
+    return numFailedTests;
+}